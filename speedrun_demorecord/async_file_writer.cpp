@@ -0,0 +1,396 @@
+#include "async_file_writer.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "latency_stats.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static bool IsPathSeparator(char c)
+{
+    return c == '/' || c == '\\';
+}
+
+static bool IsAbsolutePath(const char* path)
+{
+    return IsPathSeparator(path[0]) || (path[0] != '\0' && path[1] == ':');
+}
+
+static void MakeDir(const char* path)
+{
+#ifdef _WIN32
+    _mkdir(path);
+#else
+    mkdir(path, 0777);
+#endif
+}
+
+// Creates every directory leading up to the file, existing ones are fine
+static void CreateParentDirs(const std::string& filePath)
+{
+    std::string dir;
+    for (size_t i = 0; i < filePath.size(); i++)
+    {
+        // Skip the root and drive letters
+        if (IsPathSeparator(filePath[i]) && i > 0 && filePath[i - 1] != ':')
+        {
+            dir.assign(filePath, 0, i);
+            MakeDir(dir.c_str());
+        }
+    }
+}
+
+static bool SyncFile(FILE* file)
+{
+    if (fflush(file) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+static void UpdateMax(std::atomic<uint64_t>& max, uint64_t value)
+{
+    uint64_t current = max.load(std::memory_order_relaxed);
+    while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: constructor/destructor
+//---------------------------------------------------------------------------------
+CAsyncFileWriter::CAsyncFileWriter(size_t queueSize)
+    : m_Queue(queueSize),
+      m_bHasLookahead(false),
+      m_bSleeping(false),
+      m_bStop(false),
+      m_Queued(0),
+      m_Completed(0),
+      m_Written(0),
+      m_Bytes(0),
+      m_Failed(0),
+      m_Syncs(0),
+      m_Dropped(0),
+      m_MaxDepth(0),
+      m_MaxJobLatency(0)
+{
+}
+
+CAsyncFileWriter::~CAsyncFileWriter()
+{
+    Shutdown();
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: thread control
+//---------------------------------------------------------------------------------
+void CAsyncFileWriter::Start(const char* rootDir)
+{
+    if (IsRunning())
+        return;
+
+    m_RootDir = rootDir ? rootDir : "";
+    if (!m_RootDir.empty() && !IsPathSeparator(m_RootDir[m_RootDir.size() - 1]))
+    {
+        m_RootDir += '/';
+    }
+
+    m_bStop = false;
+    m_Thread = std::thread(&CAsyncFileWriter::ThreadMain, this);
+}
+
+void CAsyncFileWriter::Shutdown()
+{
+    if (!IsRunning())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStop = true;
+        m_WakeWriter.notify_one();
+    }
+    m_Thread.join();
+}
+
+void CAsyncFileWriter::Flush()
+{
+    if (!IsRunning())
+        return;
+
+    const uint64_t target = GetTicket();
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_WakeWriter.notify_one();
+    m_JobsDone.wait(lock, [this, target] { return m_Completed.load() >= target; });
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: producers
+//---------------------------------------------------------------------------------
+bool CAsyncFileWriter::Write(const char* path, const void* data, size_t size, int flags)
+{
+    return Enqueue(FILEJOB_WRITE, path, data, size, flags);
+}
+
+bool CAsyncFileWriter::Append(const char* path, const void* data, size_t size, int flags)
+{
+    return Enqueue(FILEJOB_APPEND, path, data, size, flags);
+}
+
+bool CAsyncFileWriter::Remove(const char* path)
+{
+    return Enqueue(FILEJOB_REMOVE, path, NULL, 0, 0);
+}
+
+bool CAsyncFileWriter::Rename(const char* from, const char* to)
+{
+    return Enqueue(FILEJOB_RENAME, from, to, strlen(to), 0);
+}
+
+bool CAsyncFileWriter::Enqueue(FileJobOp op, const char* path, const void* data, size_t size, int flags)
+{
+    FileJob_t job;
+    job.op = op;
+    job.flags = flags;
+    job.path = path;
+    if (size > 0)
+    {
+        job.data.assign((const char*)data, size);
+    }
+    job.queuedTime = LatencyNow();
+
+    // Counted before the push so the writer never sees more completed than queued
+    const uint64_t queued = m_Queued.fetch_add(1) + 1;
+    if (!m_Queue.Push(job))
+    {
+        m_Dropped++;
+        m_Completed++;
+        return false;
+    }
+
+    const uint32_t depth = (uint32_t)(queued - m_Completed.load());
+    uint32_t maxDepth = m_MaxDepth.load(std::memory_order_relaxed);
+    while (depth > maxDepth && !m_MaxDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed))
+    {
+    }
+
+    // Only pay for the lock when the writer went to sleep
+    if (m_bSleeping.load())
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_WakeWriter.notify_one();
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: writer thread
+//---------------------------------------------------------------------------------
+void CAsyncFileWriter::ThreadMain()
+{
+    for (;;)
+    {
+        FileJob_t job;
+        const int jobCount = TakeJob(job);
+        if (jobCount > 0)
+        {
+            if (RunJob(job))
+            {
+                m_Written += (uint64_t)jobCount;
+                m_Bytes += job.op == FILEJOB_RENAME ? 0 : job.data.size();
+                if (job.flags & FILEJOB_FLAG_SYNC)
+                {
+                    m_Syncs++;
+                }
+            }
+            else
+            {
+                m_Failed += (uint64_t)jobCount;
+            }
+            UpdateMax(m_MaxJobLatency, LatencyNow() - job.queuedTime);
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Completed += (uint64_t)jobCount;
+            m_JobsDone.notify_all();
+            continue;
+        }
+
+        // A push may be half way done, only leave once everything counted has been written
+        const bool idle = m_Queued.load() == m_Completed.load();
+        if (idle && m_bStop.load())
+            break;
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_bSleeping = true;
+        if (m_Queued.load() == m_Completed.load() && !m_bStop.load())
+        {
+            // Timeout is only a safety net, producers wake us
+            m_WakeWriter.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        m_bSleeping = false;
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: next job to run, appends to the same file are merged into one. Returns how many queued jobs it covers.
+//---------------------------------------------------------------------------------
+int CAsyncFileWriter::TakeJob(FileJob_t& job)
+{
+    if (m_bHasLookahead)
+    {
+        job = std::move(m_Lookahead);
+        m_bHasLookahead = false;
+    }
+    else if (!m_Queue.Pop(job))
+    {
+        return 0;
+    }
+
+    int count = 1;
+    if (job.op != FILEJOB_APPEND)
+        return count;
+
+    FileJob_t next;
+    while (m_Queue.Pop(next))
+    {
+        if (next.op != FILEJOB_APPEND || next.path != job.path)
+        {
+            m_Lookahead = std::move(next);
+            m_bHasLookahead = true;
+            break;
+        }
+
+        // Keeps the oldest queued time for the latency stat
+        job.data += next.data;
+        job.flags |= next.flags;
+        count++;
+    }
+    return count;
+}
+
+bool CAsyncFileWriter::RunJob(const FileJob_t& job)
+{
+    std::string fullPath;
+    ResolvePath(job.path.c_str(), fullPath);
+
+    if (job.op == FILEJOB_REMOVE)
+        return remove(fullPath.c_str()) == 0 || errno == ENOENT;
+
+    if (job.op == FILEJOB_RENAME)
+    {
+        std::string toPath;
+        ResolvePath(job.data.c_str(), toPath);
+        if (rename(fullPath.c_str(), toPath.c_str()) == 0)
+            return true;
+        if (errno == ENOENT)
+            return true;
+
+        // Windows doesn't replace an existing file
+        remove(toPath.c_str());
+        return rename(fullPath.c_str(), toPath.c_str()) == 0;
+    }
+
+    const char* mode = job.op == FILEJOB_APPEND ? "ab" : "wb";
+    FILE* file = fopen(fullPath.c_str(), mode);
+    if (!file)
+    {
+        CreateParentDirs(fullPath);
+        file = fopen(fullPath.c_str(), mode);
+        if (!file)
+            return false;
+    }
+
+    bool ok = job.data.empty() || fwrite(job.data.data(), 1, job.data.size(), file) == job.data.size();
+    if (ok && (job.flags & FILEJOB_FLAG_SYNC))
+    {
+        ok = SyncFile(file);
+    }
+    ok = fclose(file) == 0 && ok;
+    return ok;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: helpers
+//---------------------------------------------------------------------------------
+void CAsyncFileWriter::ResolvePath(const char* path, std::string& fullPath) const
+{
+    if (IsAbsolutePath(path))
+    {
+        fullPath = path;
+    }
+    else
+    {
+        fullPath = m_RootDir + path;
+    }
+}
+
+void CAsyncFileWriter::GetStats(AsyncWriterStats_t& stats) const
+{
+    stats.queued = m_Queued.load() - m_Dropped.load();
+    stats.written = m_Written.load();
+    stats.bytes = m_Bytes.load();
+    stats.failed = m_Failed.load();
+    stats.syncs = m_Syncs.load();
+    stats.dropped = m_Dropped.load();
+    stats.depth = (uint32_t)(m_Queued.load() - m_Completed.load());
+    stats.maxDepth = m_MaxDepth.load();
+    stats.maxJobLatency = m_MaxJobLatency.load();
+}
+
+void CAsyncFileWriter::FormatTable(std::string& out) const
+{
+    AsyncWriterStats_t stats;
+    GetStats(stats);
+
+    char line[256];
+    snprintf(line,
+             sizeof(line),
+             "writer: depth %u (max %u/%u), %llu written (%llu bytes, %llu fsyncs), %llu failed, %llu dropped, slowest "
+             "job %.1f us\n",
+             stats.depth,
+             stats.maxDepth,
+             (unsigned)m_Queue.GetCapacity(),
+             (unsigned long long)stats.written,
+             (unsigned long long)stats.bytes,
+             (unsigned long long)stats.syncs,
+             (unsigned long long)stats.failed,
+             (unsigned long long)stats.dropped,
+             (double)stats.maxJobLatency / 1000.0);
+    out += line;
+}
+
+void CAsyncFileWriter::FormatJson(std::string& out) const
+{
+    AsyncWriterStats_t stats;
+    GetStats(stats);
+
+    char text[384];
+    snprintf(text,
+             sizeof(text),
+             "\"writer\": {\"queued\": %llu, \"written\": %llu, \"bytes\": %llu, \"syncs\": %llu, \"failed\": %llu, "
+             "\"dropped\": %llu, "
+             "\"depth\": %u, \"max_depth\": %u, \"capacity\": %u, \"max_job_latency\": %llu}",
+             (unsigned long long)stats.queued,
+             (unsigned long long)stats.written,
+             (unsigned long long)stats.bytes,
+             (unsigned long long)stats.syncs,
+             (unsigned long long)stats.failed,
+             (unsigned long long)stats.dropped,
+             stats.depth,
+             stats.maxDepth,
+             (unsigned)m_Queue.GetCapacity(),
+             (unsigned long long)stats.maxJobLatency);
+    out += text;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "mpsc_queue.h"
+
+#define ASYNC_WRITER_QUEUE_SIZE 1024
+
+enum FileJobOp
+{
+    FILEJOB_WRITE,
+    FILEJOB_APPEND,
+    FILEJOB_REMOVE,
+
+    // path is moved to the path in data, replacing it. Nothing to move counts as done, like removing a missing file.
+    FILEJOB_RENAME
+};
+
+// Flush the file to the disk (fsync) after the job, not just to the OS
+#define FILEJOB_FLAG_SYNC (1 << 0)
+
+struct FileJob_t
+{
+    FileJobOp op;
+    int flags;
+    std::string path;
+    std::string data;
+    uint64_t queuedTime;
+};
+
+struct AsyncWriterStats_t
+{
+    uint64_t queued;
+    uint64_t written;
+    uint64_t bytes;
+    uint64_t failed;
+
+    // fsyncs issued, consecutive synced appends to the same file share one
+    uint64_t syncs;
+
+    // Queue was full, the job was not written
+    uint64_t dropped;
+
+    // Jobs waiting or in progress, now and at most
+    uint32_t depth;
+    uint32_t maxDepth;
+
+    // Longest a job waited between Write/Append/Remove and being on disk
+    uint64_t maxJobLatency;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: background thread for every file the plugin writes (resume info, bookmarks, stats, ...). Write, Append,
+// Remove and Rename copy the job into a lock-free queue and return, the game thread never waits for the disk. Jobs run
+// in order. Flush waits for everything queued so far and is only meant for speedrun_stop and Unload, work that has to
+// follow a job on the game thread polls IsDone with a ticket instead.
+//
+// Appends to the same file that are waiting back to back are written with a single open/write/fsync.
+//
+// Relative paths are resolved against the root passed to Start (the game's write path), the same way the engine's
+// own filesystem resolves them. Missing parent directories are created.
+//---------------------------------------------------------------------------------
+class CAsyncFileWriter
+{
+    public:
+    CAsyncFileWriter(size_t queueSize = ASYNC_WRITER_QUEUE_SIZE);
+    ~CAsyncFileWriter();
+
+    void Start(const char* rootDir);
+
+    // Flushes and joins the thread, queued jobs are still written
+    void Shutdown();
+
+    bool IsRunning() const
+    {
+        return m_Thread.joinable();
+    }
+
+    // False if the queue is full, the job is dropped and counted
+    bool Write(const char* path, const void* data, size_t size, int flags = 0);
+    bool Append(const char* path, const void* data, size_t size, int flags = 0);
+    bool Remove(const char* path);
+    bool Rename(const char* from, const char* to);
+
+    // Blocks until every job queued before the call is done
+    void Flush();
+
+    // IsDone(GetTicket()) turns true once every job queued before GetTicket is done (or was dropped)
+    uint64_t GetTicket() const
+    {
+        return m_Queued.load();
+    }
+    bool IsDone(uint64_t ticket) const
+    {
+        return m_Completed.load() >= ticket;
+    }
+
+    void GetStats(AsyncWriterStats_t& stats) const;
+
+    // One line summary for the console, and "writer" object members for a JSON dump
+    void FormatTable(std::string& out) const;
+    void FormatJson(std::string& out) const;
+
+    const std::string& GetRootDir() const
+    {
+        return m_RootDir;
+    }
+    void ResolvePath(const char* path, std::string& fullPath) const;
+
+    private:
+    CAsyncFileWriter(const CAsyncFileWriter&);
+    CAsyncFileWriter& operator=(const CAsyncFileWriter&);
+
+    bool Enqueue(FileJobOp op, const char* path, const void* data, size_t size, int flags);
+    void ThreadMain();
+    bool RunJob(const FileJob_t& job);
+    int TakeJob(FileJob_t& job);
+
+    CBoundedMpscQueue<FileJob_t> m_Queue;
+
+    // Writer thread only, the job that ended the last append batch
+    FileJob_t m_Lookahead;
+    bool m_bHasLookahead;
+
+    std::string m_RootDir;
+    std::thread m_Thread;
+
+    // Wakes the writer when it went to sleep on an empty queue, and Flush when jobs complete
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeWriter;
+    std::condition_variable m_JobsDone;
+    std::atomic<bool> m_bSleeping;
+    std::atomic<bool> m_bStop;
+
+    std::atomic<uint64_t> m_Queued;
+    std::atomic<uint64_t> m_Completed;
+    std::atomic<uint64_t> m_Written;
+    std::atomic<uint64_t> m_Bytes;
+    std::atomic<uint64_t> m_Failed;
+    std::atomic<uint64_t> m_Syncs;
+    std::atomic<uint64_t> m_Dropped;
+    std::atomic<uint32_t> m_MaxDepth;
+    std::atomic<uint64_t> m_MaxJobLatency;
+};
@@ -0,0 +1,247 @@
+#include "attempt_history.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "crc32.h"
+
+const char* AttemptPromoteResultToString(AttemptPromoteResult result)
+{
+    switch (result)
+    {
+        case PROMOTE_OK:
+            return "ok";
+        case PROMOTE_NOT_FOUND:
+            return "no such attempt";
+        case PROMOTE_ALREADY_CANONICAL:
+            return "already the map's demo";
+        case PROMOTE_RECORDING:
+            return "the map's demo is being recorded";
+        case PROMOTE_FILE_ERROR:
+            return "slot demo missing or could not be renamed";
+    }
+    return "unknown";
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: index file
+//---------------------------------------------------------------------------------
+bool CAttemptHistory::Load(const std::string& contents)
+{
+    m_Records.clear();
+
+    attemptindexheader_t header;
+    if (contents.size() < sizeof(header))
+        return false;
+    memcpy(&header, contents.data(), sizeof(header));
+
+    const uint64_t recordBytes = (uint64_t)header.recordCount * sizeof(attemptrecord_t);
+    if (header.magic != ATTEMPT_MAGIC || header.version != ATTEMPT_VERSION ||
+        recordBytes != contents.size() - sizeof(header))
+        return false;
+
+    if (Crc32(contents.data() + sizeof(header), (size_t)recordBytes) != header.crc)
+        return false;
+
+    m_Records.resize(header.recordCount);
+    if (header.recordCount > 0)
+    {
+        memcpy(m_Records.data(), contents.data() + sizeof(header), (size_t)recordBytes);
+    }
+
+    // Names come from the disk, make sure they end
+    for (size_t i = 0; i < m_Records.size(); i++)
+    {
+        m_Records[i].mapName[ATTEMPT_MAP_NAME_SIZE - 1] = '\0';
+    }
+    return true;
+}
+
+void CAttemptHistory::Save(std::string& contents) const
+{
+    const size_t recordBytes = m_Records.size() * sizeof(attemptrecord_t);
+
+    attemptindexheader_t header;
+    header.magic = ATTEMPT_MAGIC;
+    header.version = ATTEMPT_VERSION;
+    header.recordCount = (uint32_t)m_Records.size();
+    header.crc = Crc32(m_Records.data(), recordBytes);
+
+    contents.assign((const char*)&header, sizeof(header));
+    contents.append((const char*)m_Records.data(), recordBytes);
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: lookups
+//---------------------------------------------------------------------------------
+attemptrecord_t* CAttemptHistory::Find(const char* mapName, uint32_t attempt)
+{
+    for (size_t i = 0; i < m_Records.size(); i++)
+    {
+        if (m_Records[i].attempt == attempt && strcmp(m_Records[i].mapName, mapName) == 0)
+            return &m_Records[i];
+    }
+    return NULL;
+}
+
+attemptrecord_t* CAttemptHistory::FindCanonical(const char* mapName)
+{
+    return const_cast<attemptrecord_t*>(static_cast<const CAttemptHistory*>(this)->FindCanonical(mapName));
+}
+
+const attemptrecord_t* CAttemptHistory::FindCanonical(const char* mapName) const
+{
+    for (size_t i = 0; i < m_Records.size(); i++)
+    {
+        if (m_Records[i].slot == ATTEMPT_CANONICAL && strcmp(m_Records[i].mapName, mapName) == 0)
+            return &m_Records[i];
+    }
+    return NULL;
+}
+
+uint32_t CAttemptHistory::GetNextAttempt(const char* mapName) const
+{
+    uint32_t last = 0;
+    for (size_t i = 0; i < m_Records.size(); i++)
+    {
+        if (strcmp(m_Records[i].mapName, mapName) == 0)
+        {
+            last = std::max(last, m_Records[i].attempt);
+        }
+    }
+    return last + 1;
+}
+
+void CAttemptHistory::GetAttempts(const char* mapName, std::vector<attemptrecord_t>& attempts) const
+{
+    for (size_t i = 0; i < m_Records.size(); i++)
+    {
+        if (!mapName || mapName[0] == '\0' || strcmp(m_Records[i].mapName, mapName) == 0)
+        {
+            attempts.push_back(m_Records[i]);
+        }
+    }
+
+    std::sort(attempts.begin(), attempts.end(), [](const attemptrecord_t& a, const attemptrecord_t& b) {
+        const int compare = strcmp(a.mapName, b.mapName);
+        return compare != 0 ? compare < 0 : a.attempt < b.attempt;
+    });
+}
+
+std::string CAttemptHistory::GetSlotDemoName(const char* mapName, uint32_t slot)
+{
+    char name[ATTEMPT_MAP_NAME_SIZE + 16];
+    snprintf(name, sizeof(name), "%s_slot%u", mapName, slot + 1);
+    return name;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: rotation
+//---------------------------------------------------------------------------------
+attemptrecord_t& CAttemptHistory::BeginAttempt(const char* mapName, int64_t startTime)
+{
+    const attemptrecord_t* previous = FindCanonical(mapName);
+    if (previous)
+    {
+        m_Records.erase(m_Records.begin() + (previous - m_Records.data()));
+    }
+
+    attemptrecord_t record;
+    memset(&record, 0, sizeof(record));
+    snprintf(record.mapName, sizeof(record.mapName), "%s", mapName);
+    record.attempt = GetNextAttempt(mapName);
+    record.slot = ATTEMPT_CANONICAL;
+    record.ticks = -1;
+    record.startTime = startTime;
+
+    m_Records.push_back(record);
+    return m_Records.back();
+}
+
+uint32_t CAttemptHistory::GetRotateSlot(const char* mapName, uint32_t keep) const
+{
+    keep = std::max(1u, std::min(keep, (uint32_t)ATTEMPT_MAX_KEEP));
+
+    // Attempt in each slot, 0 if free
+    uint32_t slotAttempts[ATTEMPT_MAX_KEEP] = {};
+    for (size_t i = 0; i < m_Records.size(); i++)
+    {
+        const attemptrecord_t& record = m_Records[i];
+        if (record.slot < keep && strcmp(record.mapName, mapName) == 0)
+        {
+            slotAttempts[record.slot] = record.attempt;
+        }
+    }
+
+    // A free slot, else the oldest attempt goes. Without promotions that is a plain ring.
+    uint32_t slot = 0;
+    for (uint32_t i = 0; i < keep; i++)
+    {
+        if (slotAttempts[i] == 0)
+            return i;
+        if (slotAttempts[i] < slotAttempts[slot])
+        {
+            slot = i;
+        }
+    }
+    return slot;
+}
+
+uint32_t CAttemptHistory::Rotate(const char* mapName, uint32_t keep, std::vector<uint32_t>& droppedSlots)
+{
+    keep = std::max(1u, std::min(keep, (uint32_t)ATTEMPT_MAX_KEEP));
+
+    if (!FindCanonical(mapName))
+    {
+        BeginAttempt(mapName, 0);
+    }
+    const uint32_t slot = GetRotateSlot(mapName, keep);
+
+    // The attempt that was in the slot is gone once the file is renamed over it
+    size_t write = 0;
+    for (size_t i = 0; i < m_Records.size(); i++)
+    {
+        const attemptrecord_t& record = m_Records[i];
+        if (record.slot != ATTEMPT_CANONICAL && (record.slot == slot || record.slot >= keep) &&
+            strcmp(record.mapName, mapName) == 0)
+        {
+            if (record.slot != slot)
+            {
+                droppedSlots.push_back(record.slot);
+            }
+            continue;
+        }
+        m_Records[write++] = record;
+    }
+    m_Records.resize(write);
+
+    FindCanonical(mapName)->slot = slot;
+    return slot;
+}
+
+void CAttemptHistory::Promote(const char* mapName, uint32_t attempt, bool bHadCanonical)
+{
+    const attemptrecord_t* chosen = Find(mapName, attempt);
+    if (!chosen || chosen->slot == ATTEMPT_CANONICAL)
+        return;
+
+    const uint32_t slot = chosen->slot;
+    attemptrecord_t* canonical = FindCanonical(mapName);
+    if (bHadCanonical && canonical)
+    {
+        canonical->slot = slot;
+    }
+    else if (bHadCanonical)
+    {
+        BeginAttempt(mapName, 0).slot = slot;
+    }
+    else if (canonical)
+    {
+        // Its demo was gone already
+        m_Records.erase(m_Records.begin() + (canonical - m_Records.data()));
+    }
+
+    // Looked up again, the records may have moved
+    Find(mapName, attempt)->slot = ATTEMPT_CANONICAL;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Attempt history of speedrun_segment: every reload records <map>.dem again, so the attempt before it is renamed into
+// one of keep slots (<map>_slot<N>.dem) first, over the oldest attempt kept. A rotation is a single rename however many
+// attempts are kept, and no demo bytes are ever copied. An index in the segment dir remembers which attempt is in which
+// slot and how it went.
+//
+// Index layout: header, then one fixed size record per attempt.
+
+#define ATTEMPT_INDEX_FILE_NAME "speedrun_democrecord_attempts.idx"
+
+// "SRH1"
+#define ATTEMPT_MAGIC 0x31485253u
+#define ATTEMPT_VERSION 1
+
+#define ATTEMPT_MAP_NAME_SIZE 64
+#define ATTEMPT_MAX_KEEP 99
+
+// Slot of the attempt that is <map>.dem
+#define ATTEMPT_CANONICAL 0xFFFFFFFFu
+
+#pragma pack(push, 1)
+struct attemptindexheader_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordCount;
+
+    // CRC-32 of the records
+    uint32_t crc;
+};
+
+struct attemptrecord_t
+{
+    char mapName[ATTEMPT_MAP_NAME_SIZE];
+
+    // Counts up per map from 1, never reused
+    uint32_t attempt;
+
+    // 0 based, or ATTEMPT_CANONICAL
+    uint32_t slot;
+
+    // Ticks recorded, -1 if unknown (a demo that was there before the index)
+    int32_t ticks;
+    uint32_t reserved;
+
+    // Wall clock time from the record command to the reload, 0 if unknown
+    uint64_t durationMs;
+
+    // Unix time of the record command, 0 if unknown
+    int64_t startTime;
+};
+#pragma pack(pop)
+
+enum AttemptPromoteResult
+{
+    PROMOTE_OK,
+
+    // No such attempt in the index
+    PROMOTE_NOT_FOUND,
+
+    // It already is <map>.dem
+    PROMOTE_ALREADY_CANONICAL,
+
+    // <map>.dem is being recorded
+    PROMOTE_RECORDING,
+
+    // Its slot file is missing or could not be renamed
+    PROMOTE_FILE_ERROR,
+};
+
+const char* AttemptPromoteResultToString(AttemptPromoteResult result);
+
+//---------------------------------------------------------------------------------
+// Purpose: the index in memory. Only bookkeeping, the caller does the renames the results ask for.
+//---------------------------------------------------------------------------------
+class CAttemptHistory
+{
+    public:
+    void Clear()
+    {
+        m_Records.clear();
+    }
+
+    // Replaces the records with the index in contents, false (and empty) if it is damaged
+    bool Load(const std::string& contents);
+    void Save(std::string& contents) const;
+
+    // NULL if there is none
+    attemptrecord_t* Find(const char* mapName, uint32_t attempt);
+    attemptrecord_t* FindCanonical(const char* mapName);
+
+    // A new attempt recorded as <map>.dem. An attempt that still is <map>.dem (not rotated, keep is 0 or its demo
+    // went missing) is forgotten, the new one overwrites it.
+    attemptrecord_t& BeginAttempt(const char* mapName, int64_t startTime);
+
+    // Slot Rotate would move <map>.dem to, so the caller can rename first and only rotate if that worked
+    uint32_t GetRotateSlot(const char* mapName, uint32_t keep) const;
+
+    // Moves the attempt that is <map>.dem into its slot, forgetting the attempt that was there. An untracked <map>.dem
+    // gets a record with unknown stats. Returns the slot. Attempts in slots past a keep that was lowered since are
+    // forgotten too, their slots are added to droppedSlots for the caller to delete.
+    uint32_t Rotate(const char* mapName, uint32_t keep, std::vector<uint32_t>& droppedSlots);
+
+    // After the caller swapped <map>.dem and the attempt's slot demo: the attempt becomes <map>.dem and the one that
+    // was (if bHadCanonical, an untracked one gets a record) takes its slot
+    void Promote(const char* mapName, uint32_t attempt, bool bHadCanonical);
+
+    // Every attempt of mapName (every map if NULL or empty), by map and attempt
+    void GetAttempts(const char* mapName, std::vector<attemptrecord_t>& attempts) const;
+
+    size_t Size() const
+    {
+        return m_Records.size();
+    }
+
+    // "<map>_slot<N>" without the extension, N counting from 1
+    static std::string GetSlotDemoName(const char* mapName, uint32_t slot);
+
+    private:
+    const attemptrecord_t* FindCanonical(const char* mapName) const;
+    uint32_t GetNextAttempt(const char* mapName) const;
+
+    std::vector<attemptrecord_t> m_Records;
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// Bit streams in the engine's bf_read/bf_write order: bits are taken from the lowest bit of each byte up, so on a
+// little endian machine a value that straddles bytes is simply the bits of a little endian word.
+
+//---------------------------------------------------------------------------------
+// Purpose: reads up to 32 bits at a time with one unaligned 64-bit load, no per-bit loop. Reading past the end
+// returns zero bits and sets the overflow flag, the same as bf_read.
+//---------------------------------------------------------------------------------
+class CBitReader
+{
+    public:
+    CBitReader(const uint8_t* data, size_t size) : m_pData(data), m_Size(size), m_BitCount((uint64_t)size * 8), m_Pos(0)
+    {
+    }
+
+    // The next bits without consuming them, count up to 57
+    uint64_t PeekBits(unsigned count) const
+    {
+        const size_t byte = (size_t)(m_Pos >> 3);
+        uint64_t word;
+        if (byte + sizeof(word) <= m_Size)
+        {
+            memcpy(&word, m_pData + byte, sizeof(word));
+        }
+        else
+        {
+            // The last few bytes, zero padded
+            word = 0;
+            if (byte < m_Size)
+            {
+                memcpy(&word, m_pData + byte, m_Size - byte);
+            }
+        }
+        return (word >> (m_Pos & 7)) & ((1ull << count) - 1);
+    }
+
+    uint32_t ReadBits(unsigned count)
+    {
+        const uint32_t value = (uint32_t)PeekBits(count);
+        m_Pos += count;
+        return value;
+    }
+
+    bool ReadBit()
+    {
+        return ReadBits(1) != 0;
+    }
+
+    int32_t ReadSignedBits(unsigned count)
+    {
+        const uint32_t value = ReadBits(count);
+        const uint32_t sign = 1u << (count - 1);
+        return (int32_t)((value ^ sign) - sign);
+    }
+
+    float ReadFloat()
+    {
+        const uint32_t bits = ReadBits(32);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // A presence bit followed by count bits if it is set, 0 otherwise. Reads both at once and advances by a multiple
+    // of the bit instead of branching on it, the fields of a usercmd are present about as often as not.
+    uint32_t ReadOptional(unsigned count, bool& bPresent)
+    {
+        const uint64_t bits = PeekBits(count + 1);
+        const uint64_t present = bits & 1;
+        bPresent = present != 0;
+        m_Pos += 1 + present * count;
+        return (uint32_t)((bits >> 1) & (0 - present));
+    }
+
+    void SkipBits(uint64_t count)
+    {
+        m_Pos += count;
+    }
+
+    uint64_t GetPosition() const
+    {
+        return m_Pos;
+    }
+    uint64_t GetBitsLeft() const
+    {
+        return m_Pos < m_BitCount ? m_BitCount - m_Pos : 0;
+    }
+
+    // True once anything was read past the end
+    bool IsOverflowed() const
+    {
+        return m_Pos > m_BitCount;
+    }
+
+    private:
+    const uint8_t* m_pData;
+    size_t m_Size;
+    uint64_t m_BitCount;
+    uint64_t m_Pos;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: the matching writer, for the tests, benchmarks and synthetic demos
+//---------------------------------------------------------------------------------
+class CBitWriter
+{
+    public:
+    CBitWriter() : m_Pos(0)
+    {
+    }
+
+    void WriteBits(uint32_t value, unsigned count)
+    {
+        for (unsigned i = 0; i < count; i++, m_Pos++)
+        {
+            if ((m_Pos & 7) == 0)
+            {
+                m_Bytes.push_back(0);
+            }
+            m_Bytes.back() |= (uint8_t)(((value >> i) & 1) << (m_Pos & 7));
+        }
+    }
+
+    void WriteBit(bool bValue)
+    {
+        WriteBits(bValue ? 1 : 0, 1);
+    }
+
+    void WriteFloat(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        WriteBits(bits, 32);
+    }
+
+    const std::vector<uint8_t>& GetBytes() const
+    {
+        return m_Bytes;
+    }
+    uint64_t GetBitCount() const
+    {
+        return m_Pos;
+    }
+
+    private:
+    std::vector<uint8_t> m_Bytes;
+    uint64_t m_Pos;
+};
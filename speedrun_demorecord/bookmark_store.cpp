@@ -0,0 +1,247 @@
+#include "bookmark_store.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "crc32.h"
+
+static uint32_t ComputeRecordCrc(const bookmarkrecord_t& record)
+{
+    return Crc32(&record, offsetof(bookmarkrecord_t, crc));
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: bookmark records
+//---------------------------------------------------------------------------------
+void BuildBookmarkRecord(bookmarkrecord_t& record,
+                         const char* session,
+                         const char* mapName,
+                         const char* demoName,
+                         const char* tag,
+                         int64_t wallClock,
+                         const struct tm& localTime,
+                         int tick,
+                         int serverTick)
+{
+    // Zeroed so the unused bytes of the names are deterministic and covered by the checksum
+    memset(&record, 0, sizeof(record));
+    record.magic = BOOKMARK_MAGIC;
+    record.tick = tick;
+    record.serverTick = serverTick;
+    record.wallClock = wallClock;
+    record.year = (uint16_t)localTime.tm_year;
+    record.month = (uint8_t)localTime.tm_mon;
+    record.day = (uint8_t)localTime.tm_mday;
+    record.hour = (uint8_t)localTime.tm_hour;
+    record.minute = (uint8_t)localTime.tm_min;
+    record.second = (uint8_t)localTime.tm_sec;
+    snprintf(record.session, sizeof(record.session), "%s", session ? session : "");
+    snprintf(record.mapName, sizeof(record.mapName), "%s", mapName ? mapName : "");
+    snprintf(record.demoName, sizeof(record.demoName), "%s", demoName ? demoName : "");
+    snprintf(record.tag, sizeof(record.tag), "%s", tag ? tag : "");
+    record.crc = ComputeRecordCrc(record);
+}
+
+bool IsValidBookmarkRecord(const bookmarkrecord_t& record)
+{
+    if (record.magic != BOOKMARK_MAGIC)
+        return false;
+
+    // The names have to end inside their fields, the zeroing guarantees it for anything BuildBookmarkRecord made
+    if (record.session[BOOKMARK_SESSION_SIZE - 1] != '\0' || record.mapName[BOOKMARK_MAP_NAME_SIZE - 1] != '\0' ||
+        record.demoName[BOOKMARK_DEMO_NAME_SIZE - 1] != '\0' || record.tag[BOOKMARK_TAG_SIZE - 1] != '\0')
+        return false;
+
+    return record.crc == ComputeRecordCrc(record);
+}
+
+BookmarkReadResult_t ReadBookmarks(const void* data, size_t size, std::vector<bookmarkrecord_t>& records)
+{
+    BookmarkReadResult_t result;
+    result.validBytes = 0;
+    result.torn = false;
+
+    const uint8_t* p = (const uint8_t*)data;
+    while (size - result.validBytes >= BOOKMARK_RECORD_SIZE)
+    {
+        bookmarkrecord_t record;
+        memcpy(&record, p + result.validBytes, sizeof(record));
+        if (!IsValidBookmarkRecord(record))
+            break;
+
+        records.push_back(record);
+        result.validBytes += BOOKMARK_RECORD_SIZE;
+    }
+
+    result.torn = result.validBytes != size;
+    return result;
+}
+
+void ParseBookmarkCatalog(const std::string& contents, std::vector<std::string>& sessions)
+{
+    size_t start = 0;
+    while (start < contents.size())
+    {
+        size_t end = contents.find_first_of("\r\n", start);
+        if (end == std::string::npos)
+        {
+            end = contents.size();
+        }
+
+        const std::string session = contents.substr(start, end - start);
+        if (!session.empty() && std::find(sessions.begin(), sessions.end(), session) == sessions.end())
+        {
+            sessions.push_back(session);
+        }
+        start = end + 1;
+    }
+}
+
+void FormatBookmarkText(const bookmarkrecord_t& record, const char* sessionDir, std::string& text)
+{
+    char line[512];
+    int length = snprintf(line,
+                          sizeof(line),
+                          "[%04i/%02i/%02i %02i:%02i] demo: %s%s\r\n\t\t   tick: %d\r\n",
+                          (int)record.year,
+                          (int)record.month,
+                          (int)record.day,
+                          (int)record.hour,
+                          (int)record.minute,
+                          sessionDir,
+                          record.demoName,
+                          record.tick);
+    text.append(line, std::min((size_t)std::max(length, 0), sizeof(line) - 1));
+
+    if (record.tag[0] != '\0')
+    {
+        length = snprintf(line, sizeof(line), "\t\t   tag: %s\r\n", record.tag);
+        text.append(line, std::min((size_t)std::max(length, 0), sizeof(line) - 1));
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: store
+//---------------------------------------------------------------------------------
+void CBookmarkStore::Clear()
+{
+    m_Records.clear();
+    m_RecordSessionDirs.clear();
+    m_SessionDirs.clear();
+    m_SessionIndex.clear();
+    m_MapIndex.clear();
+    m_TagIndex.clear();
+}
+
+BookmarkReadResult_t CBookmarkStore::AddFile(const std::string& sessionDir, const void* data, size_t size)
+{
+    std::vector<bookmarkrecord_t> records;
+    const BookmarkReadResult_t result = ReadBookmarks(data, size, records);
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        Add(sessionDir, records[i]);
+    }
+    return result;
+}
+
+uint32_t CBookmarkStore::Add(const std::string& sessionDir, const bookmarkrecord_t& record)
+{
+    // Few sessions are loaded at once compared to bookmarks, and they come in order, so the last one is the usual hit
+    uint32_t dirIndex = (uint32_t)m_SessionDirs.size();
+    for (size_t i = m_SessionDirs.size(); i-- > 0;)
+    {
+        if (m_SessionDirs[i] == sessionDir)
+        {
+            dirIndex = (uint32_t)i;
+            break;
+        }
+    }
+    if (dirIndex == m_SessionDirs.size())
+    {
+        m_SessionDirs.push_back(sessionDir);
+    }
+
+    const uint32_t id = (uint32_t)m_Records.size();
+    m_Records.push_back(record);
+    m_RecordSessionDirs.push_back(dirIndex);
+
+    m_SessionIndex[record.session].push_back(id);
+    m_MapIndex[record.mapName].push_back(id);
+    if (record.tag[0] != '\0')
+    {
+        m_TagIndex[record.tag].push_back(id);
+    }
+    return id;
+}
+
+const std::vector<uint32_t>* CBookmarkStore::Lookup(const IdIndex& index, const char* key)
+{
+    IdIndex::const_iterator it = index.find(key);
+    return it != index.end() ? &it->second : NULL;
+}
+
+void CBookmarkStore::Find(const BookmarkQuery_t& query, std::vector<uint32_t>& ids) const
+{
+    const bool bSession = query.session && query.session[0] != '\0';
+    const bool bMap = query.mapName && query.mapName[0] != '\0';
+    const bool bTag = query.tag && query.tag[0] != '\0';
+
+    if (!bSession && !bMap && !bTag)
+    {
+        for (uint32_t id = 0; id < (uint32_t)m_Records.size(); id++)
+        {
+            ids.push_back(id);
+        }
+        return;
+    }
+
+    // Any named key without bookmarks means nothing matches
+    const std::vector<uint32_t>* candidates = NULL;
+    const std::vector<uint32_t>* lists[3] = {bSession ? Lookup(m_SessionIndex, query.session) : NULL,
+                                             bMap ? Lookup(m_MapIndex, query.mapName) : NULL,
+                                             bTag ? Lookup(m_TagIndex, query.tag) : NULL};
+    const bool named[3] = {bSession, bMap, bTag};
+    for (int i = 0; i < 3; i++)
+    {
+        if (!named[i])
+            continue;
+        if (!lists[i])
+            return;
+        if (!candidates || lists[i]->size() < candidates->size())
+        {
+            candidates = lists[i];
+        }
+    }
+
+    for (size_t i = 0; i < candidates->size(); i++)
+    {
+        const bookmarkrecord_t& record = m_Records[(*candidates)[i]];
+        if ((bSession && strcmp(record.session, query.session) != 0) ||
+            (bMap && strcmp(record.mapName, query.mapName) != 0) || (bTag && strcmp(record.tag, query.tag) != 0))
+            continue;
+
+        ids.push_back((*candidates)[i]);
+    }
+}
+
+const char* CBookmarkStore::GetLastSession() const
+{
+    const bookmarkrecord_t* last = NULL;
+    for (size_t i = 0; i < m_Records.size(); i++)
+    {
+        if (!last || m_Records[i].wallClock >= last->wallClock)
+        {
+            last = &m_Records[i];
+        }
+    }
+    return last ? last->session : NULL;
+}
+
+void CBookmarkStore::FormatText(const std::vector<uint32_t>& ids, std::string& text) const
+{
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        FormatBookmarkText(m_Records[ids[i]], GetSessionDir(ids[i]).c_str(), text);
+    }
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Bookmarks of speedrun_bookmark. Every session dir gets its own append-only file of fixed size, individually
+// checksummed records (a torn append only loses that bookmark, like the journal). speedrun_dir keeps a catalog of the
+// sessions that have bookmarks, so they can all be loaded without scanning years of session dirs. Loaded, they are
+// indexed by session, map and tag and every query is a lookup.
+
+#define BOOKMARK_FILE_NAME "speedrun_democrecord.bookmarks"
+
+// One session dir name per line, relative to speedrun_dir. BOOKMARK_SEGMENT_SESSION is speedrun_dir itself.
+#define BOOKMARK_CATALOG_FILE_NAME "speedrun_democrecord_bookmarks.sessions"
+
+// Where speedrun_bookmark_export writes the text format speedrun_bookmark used to append to
+// speedrun_democrecord_bookmarks.txt, which is left alone
+#define BOOKMARK_EXPORT_FILE_NAME "speedrun_democrecord_bookmarks_export.txt"
+
+// Session name of speedrun_segment's bookmarks, its demos are straight in speedrun_dir
+#define BOOKMARK_SEGMENT_SESSION "."
+
+// "SRB1"
+#define BOOKMARK_MAGIC 0x31425253u
+#define BOOKMARK_RECORD_SIZE 256
+#define BOOKMARK_SESSION_SIZE 32
+#define BOOKMARK_MAP_NAME_SIZE 64
+#define BOOKMARK_DEMO_NAME_SIZE 96
+#define BOOKMARK_TAG_SIZE 32
+
+#pragma pack(push, 1)
+struct bookmarkrecord_t
+{
+    uint32_t magic;
+
+    // Demo tick the bookmark points at, and the server tick it was made at (-1 if unknown)
+    int32_t tick;
+    int32_t serverTick;
+
+    // Unix time, seconds
+    int64_t wallClock;
+
+    // Local time of the bookmark as speedrun_bookmark printed it
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t reserved;
+
+    // Session dir name ("2024.03.14-15.09.26" or BOOKMARK_SEGMENT_SESSION), map and demo without the extension
+    char session[BOOKMARK_SESSION_SIZE];
+    char mapName[BOOKMARK_MAP_NAME_SIZE];
+    char demoName[BOOKMARK_DEMO_NAME_SIZE];
+
+    // Optional, empty if untagged
+    char tag[BOOKMARK_TAG_SIZE];
+
+    // CRC-32 of everything above
+    uint32_t crc;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(bookmarkrecord_t) == BOOKMARK_RECORD_SIZE, "bookmark records must stay fixed size");
+
+// Fills a record and its checksum, names that don't fit are truncated. localTime is expected with the year and month
+// already normalized (1900 and 1 added).
+void BuildBookmarkRecord(bookmarkrecord_t& record,
+                         const char* session,
+                         const char* mapName,
+                         const char* demoName,
+                         const char* tag,
+                         int64_t wallClock,
+                         const struct tm& localTime,
+                         int tick,
+                         int serverTick);
+
+bool IsValidBookmarkRecord(const bookmarkrecord_t& record);
+
+struct BookmarkReadResult_t
+{
+    // Bytes covered by the valid records, anything after that is a torn or corrupt tail
+    size_t validBytes;
+    bool torn;
+};
+
+// Collects the valid records from the start of a bookmark file, stops at the first one that fails its checksum
+BookmarkReadResult_t ReadBookmarks(const void* data, size_t size, std::vector<bookmarkrecord_t>& records);
+
+// Session names of a catalog in the order they were added, each once
+void ParseBookmarkCatalog(const std::string& contents, std::vector<std::string>& sessions);
+
+// Appends the text speedrun_bookmark used to write: local time, sessionDir + demo and tick, then the tag if it has one
+void FormatBookmarkText(const bookmarkrecord_t& record, const char* sessionDir, std::string& text);
+
+// Any field that is NULL or empty matches everything, the others have to match exactly
+struct BookmarkQuery_t
+{
+    BookmarkQuery_t() : session(NULL), mapName(NULL), tag(NULL) {}
+
+    const char* session;
+    const char* mapName;
+    const char* tag;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: every loaded bookmark with an index per session, map and tag. Ids count up in the order bookmarks were
+// added, so a query returns them in that order.
+//---------------------------------------------------------------------------------
+class CBookmarkStore
+{
+    public:
+    CBookmarkStore() {}
+
+    void Clear();
+
+    // Adds the valid records of a session's bookmark file, sessionDir is the dir it is in ("<speedrun_dir><session>\\")
+    BookmarkReadResult_t AddFile(const std::string& sessionDir, const void* data, size_t size);
+    uint32_t Add(const std::string& sessionDir, const bookmarkrecord_t& record);
+
+    // Ids of the bookmarks matching query. Walks the shortest index list the query names and only compares the
+    // other fields of those.
+    void Find(const BookmarkQuery_t& query, std::vector<uint32_t>& ids) const;
+
+    const bookmarkrecord_t& Get(uint32_t id) const
+    {
+        return m_Records[id];
+    }
+    const std::string& GetSessionDir(uint32_t id) const
+    {
+        return m_SessionDirs[m_RecordSessionDirs[id]];
+    }
+    bool HasSession(const char* session) const
+    {
+        return m_SessionIndex.find(session) != m_SessionIndex.end();
+    }
+
+    // Session of the newest bookmark, NULL if there are none
+    const char* GetLastSession() const;
+
+    // The text of FormatBookmarkText for each id
+    void FormatText(const std::vector<uint32_t>& ids, std::string& text) const;
+
+    size_t Size() const
+    {
+        return m_Records.size();
+    }
+
+    private:
+    CBookmarkStore(const CBookmarkStore&);
+    CBookmarkStore& operator=(const CBookmarkStore&);
+
+    typedef std::unordered_map<std::string, std::vector<uint32_t>> IdIndex;
+
+    static const std::vector<uint32_t>* Lookup(const IdIndex& index, const char* key);
+
+    std::vector<bookmarkrecord_t> m_Records;
+
+    // Dir each record was loaded from, as an index into m_SessionDirs
+    std::vector<uint32_t> m_RecordSessionDirs;
+    std::vector<std::string> m_SessionDirs;
+
+    // Ids per session, map and tag, ascending
+    IdIndex m_SessionIndex;
+    IdIndex m_MapIndex;
+    IdIndex m_TagIndex;
+};
@@ -0,0 +1,826 @@
+#include "column_store.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits>
+#include <type_traits>
+
+#include "crc32.h"
+
+size_t GetColumnTypeSize(ColumnType type)
+{
+    static const size_t s_Sizes[COLTYPE_COUNT] = {1, 1, 2, 2, 4, 4, 8, 4};
+    return type < COLTYPE_COUNT ? s_Sizes[type] : 0;
+}
+
+const char* ColumnTypeToString(ColumnType type)
+{
+    static const char* s_Names[COLTYPE_COUNT] = {
+        "int8", "uint8", "int16", "uint16", "int32", "uint32", "int64", "float32"};
+    return type < COLTYPE_COUNT ? s_Names[type] : "unknown";
+}
+
+const char* ColumnEncodingToString(ColumnEncoding encoding)
+{
+    switch (encoding)
+    {
+        case COLENC_PLAIN:
+            return "plain";
+        case COLENC_DELTA:
+            return "delta";
+        case COLENC_RLE:
+            return "rle";
+    }
+    return "unknown";
+}
+
+// Calls fn with a value of the C++ type of the column type, so the templates below are instantiated once per type
+template <typename Fn>
+static void ForColumnType(ColumnType type, Fn fn)
+{
+    switch (type)
+    {
+        case COLTYPE_INT8:
+            fn((int8_t)0);
+            break;
+        case COLTYPE_UINT8:
+            fn((uint8_t)0);
+            break;
+        case COLTYPE_INT16:
+            fn((int16_t)0);
+            break;
+        case COLTYPE_UINT16:
+            fn((uint16_t)0);
+            break;
+        case COLTYPE_INT32:
+            fn((int32_t)0);
+            break;
+        case COLTYPE_UINT32:
+            fn((uint32_t)0);
+            break;
+        case COLTYPE_INT64:
+            fn((int64_t)0);
+            break;
+        case COLTYPE_FLOAT32:
+            fn(0.0f);
+            break;
+        default:
+            break;
+    }
+}
+
+template <typename T>
+static inline T LoadValue(const uint8_t* p)
+{
+    T value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: block encoding
+//---------------------------------------------------------------------------------
+template <typename T>
+static void ComputeStats(const T* values, uint32_t rows, columnblock_t& block)
+{
+    double minValue = (double)values[0];
+    double maxValue = minValue;
+    double sum = 0.0;
+    for (uint32_t i = 0; i < rows; i++)
+    {
+        const double value = (double)values[i];
+        minValue = value < minValue ? value : minValue;
+        maxValue = value > maxValue ? value : maxValue;
+        sum += value;
+    }
+    block.minValue = minValue;
+    block.maxValue = maxValue;
+
+    // A NaN makes the sum NaN, which keeps scans from answering the block from its stats
+    block.sum = sum;
+}
+
+// Runs of bit identical values, so 0.0 and -0.0 stay apart
+template <typename T>
+static uint32_t CountRuns(const T* values, uint32_t rows)
+{
+    uint32_t runs = 1;
+    for (uint32_t i = 1; i < rows; i++)
+    {
+        runs += memcmp(&values[i], &values[i - 1], sizeof(T)) != 0 ? 1 : 0;
+    }
+    return runs;
+}
+
+// Differences wrap around like the sums that undo them, so any int64 works
+template <typename T>
+static inline int64_t Difference(T value, T previous)
+{
+    return (int64_t)((uint64_t)(int64_t)value - (uint64_t)(int64_t)previous);
+}
+
+// Differences that don't fit the block's width (a jump from one demo's ticks to the next one's) are written as the
+// smallest value of the width followed by the whole difference as an int64
+template <typename D>
+static inline bool FitsDelta(int64_t diff)
+{
+    return diff > (int64_t)std::numeric_limits<D>::min() && diff <= (int64_t)std::numeric_limits<D>::max();
+}
+
+// Bytes per difference that makes the block smallest, 0 if the column can't be delta encoded
+template <typename T>
+static uint8_t GetDeltaWidth(const T* values, uint32_t rows, size_t& size)
+{
+    size = 0;
+    if (!std::numeric_limits<T>::is_integer)
+        return 0;
+
+    size_t escapes[3] = {};
+    for (uint32_t i = 1; i < rows; i++)
+    {
+        const int64_t diff = Difference(values[i], values[i - 1]);
+        escapes[0] += FitsDelta<int8_t>(diff) ? 0 : 1;
+        escapes[1] += FitsDelta<int16_t>(diff) ? 0 : 1;
+        escapes[2] += FitsDelta<int32_t>(diff) ? 0 : 1;
+    }
+
+    static const uint8_t s_Widths[3] = {1, 2, 4};
+    uint8_t width = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        const size_t widthSize = sizeof(int64_t) + (size_t)(rows - 1) * s_Widths[i] + escapes[i] * sizeof(int64_t);
+        if (width == 0 || widthSize < size)
+        {
+            width = s_Widths[i];
+            size = widthSize;
+        }
+    }
+    return width;
+}
+
+template <typename D>
+static inline uint8_t* WriteDelta(uint8_t* p, int64_t diff)
+{
+    if (!FitsDelta<D>(diff))
+    {
+        const D escape = std::numeric_limits<D>::min();
+        memcpy(p, &escape, sizeof(escape));
+        memcpy(p + sizeof(escape), &diff, sizeof(diff));
+        return p + sizeof(escape) + sizeof(diff);
+    }
+    const D narrow = (D)diff;
+    memcpy(p, &narrow, sizeof(narrow));
+    return p + sizeof(narrow);
+}
+
+template <typename T>
+static void EncodeBlock(const T* values, uint32_t rows, columnblock_t& block, std::vector<uint8_t>& out)
+{
+    ComputeStats(values, rows, block);
+
+    const size_t plainSize = (size_t)rows * sizeof(T);
+    const uint32_t runs = CountRuns(values, rows);
+    const size_t rleSize = sizeof(uint32_t) + (size_t)runs * (sizeof(T) + sizeof(uint32_t));
+    size_t deltaSize;
+    const uint8_t width = GetDeltaWidth(values, rows, deltaSize);
+    deltaSize = width != 0 ? deltaSize : plainSize;
+
+    // Plain wins ties, it is read in place
+    out.clear();
+    block.deltaWidth = 0;
+    if (rleSize < plainSize && rleSize <= deltaSize)
+    {
+        block.encoding = COLENC_RLE;
+        out.resize(rleSize);
+        memcpy(out.data(), &runs, sizeof(runs));
+        uint8_t* valueOut = out.data() + sizeof(runs);
+        uint8_t* countOut = valueOut + (size_t)runs * sizeof(T);
+        uint32_t run = 0;
+        uint32_t count = 1;
+        for (uint32_t i = 1; i <= rows; i++)
+        {
+            if (i < rows && memcmp(&values[i], &values[i - 1], sizeof(T)) == 0)
+            {
+                count++;
+                continue;
+            }
+            memcpy(valueOut + (size_t)run * sizeof(T), &values[i - 1], sizeof(T));
+            memcpy(countOut + (size_t)run * sizeof(uint32_t), &count, sizeof(count));
+            run++;
+            count = 1;
+        }
+    }
+    else if (deltaSize < plainSize)
+    {
+        block.encoding = COLENC_DELTA;
+        block.deltaWidth = width;
+        out.resize(deltaSize);
+        const int64_t first = (int64_t)values[0];
+        memcpy(out.data(), &first, sizeof(first));
+        uint8_t* p = out.data() + sizeof(first);
+        for (uint32_t i = 1; i < rows; i++)
+        {
+            const int64_t diff = Difference(values[i], values[i - 1]);
+            if (width == 1)
+            {
+                p = WriteDelta<int8_t>(p, diff);
+            }
+            else if (width == 2)
+            {
+                p = WriteDelta<int16_t>(p, diff);
+            }
+            else
+            {
+                p = WriteDelta<int32_t>(p, diff);
+            }
+        }
+    }
+    else
+    {
+        block.encoding = COLENC_PLAIN;
+        out.assign((const uint8_t*)values, (const uint8_t*)values + plainSize);
+    }
+}
+
+// Prefix sums of one difference width, the width is fixed per block so the loop only branches on the rare escapes
+template <typename T, typename D>
+static bool DecodeDeltas(const uint8_t* p, const uint8_t* end, int64_t first, uint32_t rows, T* out)
+{
+    uint64_t value = (uint64_t)first;
+    out[0] = (T)first;
+    for (uint32_t i = 1; i < rows; i++)
+    {
+        if (end - p < (ptrdiff_t)sizeof(D))
+            return false;
+        int64_t diff = (int64_t)LoadValue<D>(p);
+        p += sizeof(D);
+        if (diff == (int64_t)std::numeric_limits<D>::min())
+        {
+            if (end - p < (ptrdiff_t)sizeof(diff))
+                return false;
+            diff = LoadValue<int64_t>(p);
+            p += sizeof(diff);
+        }
+        value += (uint64_t)diff;
+        out[i] = (T)(int64_t)value;
+    }
+    return p == end;
+}
+
+template <typename T>
+static bool DecodeBlock(const uint8_t* data, const columnblock_t& block, T* out)
+{
+    if (block.encoding == COLENC_DELTA)
+    {
+        const size_t width = block.deltaWidth;
+        if ((width != 1 && width != 2 && width != 4) || block.size < sizeof(int64_t))
+            return false;
+
+        const int64_t first = LoadValue<int64_t>(data);
+        const uint8_t* p = data + sizeof(first);
+        const uint8_t* end = data + block.size;
+        if (width == 1)
+            return DecodeDeltas<T, int8_t>(p, end, first, block.rows, out);
+        if (width == 2)
+            return DecodeDeltas<T, int16_t>(p, end, first, block.rows, out);
+        return DecodeDeltas<T, int32_t>(p, end, first, block.rows, out);
+    }
+
+    if (block.encoding == COLENC_RLE)
+    {
+        if (block.size < sizeof(uint32_t))
+            return false;
+        const uint32_t runs = LoadValue<uint32_t>(data);
+        if (block.size != sizeof(uint32_t) + (uint64_t)runs * (sizeof(T) + sizeof(uint32_t)))
+            return false;
+
+        const uint8_t* values = data + sizeof(runs);
+        const uint8_t* counts = values + (size_t)runs * sizeof(T);
+        uint32_t row = 0;
+        for (uint32_t run = 0; run < runs; run++)
+        {
+            const T value = LoadValue<T>(values + (size_t)run * sizeof(T));
+            const uint32_t count = LoadValue<uint32_t>(counts + (size_t)run * sizeof(uint32_t));
+            if (count > block.rows - row)
+                return false;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                out[row + i] = value;
+            }
+            row += count;
+        }
+        return row == block.rows;
+    }
+
+    return false;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: scans over one decoded block, written without branches on the values so they vectorize
+//---------------------------------------------------------------------------------
+
+// [lo, hi] in the column's type, false if no value of the type can be in it
+template <typename T>
+static bool ToTypeRange(double lo, double hi, T& typeLo, T& typeHi)
+{
+    const double typeMin = (double)std::numeric_limits<T>::lowest();
+    const double typeMax = (double)std::numeric_limits<T>::max();
+    if (std::numeric_limits<T>::is_integer)
+    {
+        lo = ceil(lo);
+        hi = floor(hi);
+    }
+    if (!(lo <= hi) || lo > typeMax || hi < typeMin)
+        return false;
+
+    typeLo = lo <= typeMin ? std::numeric_limits<T>::lowest() : (lo >= typeMax ? std::numeric_limits<T>::max() : (T)lo);
+    typeHi = hi >= typeMax ? std::numeric_limits<T>::max() : (hi <= typeMin ? std::numeric_limits<T>::lowest() : (T)hi);
+    return true;
+}
+
+template <typename T, typename Sum>
+static void ScanValues(const T* values, uint32_t rows, T lo, T hi, ColumnScan_t& scan)
+{
+    uint64_t matches = 0;
+    Sum sum = 0;
+    T minValue = hi;
+    T maxValue = lo;
+    for (uint32_t i = 0; i < rows; i++)
+    {
+        const T value = values[i];
+        const bool bMatch = (value >= lo) & (value <= hi);
+        matches += bMatch;
+        sum += bMatch ? (Sum)value : (Sum)0;
+        minValue = bMatch & (value < minValue) ? value : minValue;
+        maxValue = bMatch & (value > maxValue) ? value : maxValue;
+    }
+
+    if (matches != 0)
+    {
+        scan.minValue = (double)minValue < scan.minValue ? (double)minValue : scan.minValue;
+        scan.maxValue = (double)maxValue > scan.maxValue ? (double)maxValue : scan.maxValue;
+    }
+    scan.matches += matches;
+    scan.sum += (double)sum;
+}
+
+template <typename T>
+static void FilterValues(const T* values, uint32_t rows, T lo, T hi, uint64_t firstRow, std::vector<uint64_t>& out)
+{
+    // Every row is written, only the matching ones advance the end
+    const size_t start = out.size();
+    out.resize(start + rows);
+    uint64_t* p = out.data() + start;
+    size_t count = 0;
+    for (uint32_t i = 0; i < rows; i++)
+    {
+        p[count] = firstRow + i;
+        count += (values[i] >= lo) & (values[i] <= hi);
+    }
+    out.resize(start + count);
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: writer
+//---------------------------------------------------------------------------------
+CColumnWriter::CColumnWriter(uint32_t blockRows)
+    : m_BlockRows(blockRows != 0 ? blockRows : COLUMN_BLOCK_ROWS), m_pFile(NULL), m_bFailed(false), m_DataEnd(0)
+{
+}
+
+CColumnWriter::~CColumnWriter()
+{
+    if (m_pFile)
+    {
+        fclose(m_pFile);
+    }
+}
+
+bool CColumnWriter::Open(const char* path)
+{
+    m_pFile = fopen(path, "wb");
+    if (!m_pFile)
+        return false;
+
+    // Rewritten by Close
+    columnheader_t header;
+    memset(&header, 0, sizeof(header));
+    m_bFailed = false;
+    m_DataEnd = 0;
+    WriteData(&header, sizeof(header));
+    return !m_bFailed;
+}
+
+int CColumnWriter::AddColumn(const char* name, ColumnType type)
+{
+    if (strlen(name) >= COLUMN_MAX_NAME || type >= COLTYPE_COUNT)
+        return -1;
+
+    for (size_t i = 0; i < m_Columns.size(); i++)
+    {
+        if (m_Columns[i].rows != 0 || strcmp(m_Columns[i].desc.name, name) == 0)
+            return -1;
+    }
+
+    Column_t column;
+    memset(&column.desc, 0, sizeof(column.desc));
+    strncpy(column.desc.name, name, sizeof(column.desc.name) - 1);
+    column.desc.type = (uint8_t)type;
+    column.rows = 0;
+    column.pending.reserve((size_t)m_BlockRows * GetColumnTypeSize(type));
+    m_Columns.push_back(column);
+    return (int)m_Columns.size() - 1;
+}
+
+void CColumnWriter::Append(int column, const void* values, size_t count)
+{
+    Column_t& target = m_Columns[(size_t)column];
+    const size_t typeSize = GetColumnTypeSize((ColumnType)target.desc.type);
+    const uint8_t* p = (const uint8_t*)values;
+    while (count > 0)
+    {
+        const size_t pendingRows = target.pending.size() / typeSize;
+        const size_t take = count < m_BlockRows - pendingRows ? count : m_BlockRows - pendingRows;
+        target.pending.insert(target.pending.end(), p, p + take * typeSize);
+        target.rows += take;
+        p += take * typeSize;
+        count -= take;
+
+        if (target.pending.size() == (size_t)m_BlockRows * typeSize)
+        {
+            FlushBlock(target);
+        }
+    }
+}
+
+void CColumnWriter::AppendInt(int column, int64_t value)
+{
+    ForColumnType((ColumnType)m_Columns[(size_t)column].desc.type, [&](auto type) {
+        const decltype(type) typed = (decltype(type))value;
+        Append(column, &typed, 1);
+    });
+}
+
+void CColumnWriter::AppendFloat(int column, float value)
+{
+    ForColumnType((ColumnType)m_Columns[(size_t)column].desc.type, [&](auto type) {
+        const decltype(type) typed = (decltype(type))value;
+        Append(column, &typed, 1);
+    });
+}
+
+uint32_t CColumnWriter::AddString(const std::string& text)
+{
+    std::map<std::string, uint32_t>::const_iterator it = m_StringIds.find(text);
+    if (it != m_StringIds.end())
+        return it->second;
+
+    const uint32_t id = (uint32_t)m_Strings.size();
+    m_Strings.push_back(text);
+    m_StringIds[text] = id;
+    return id;
+}
+
+void CColumnWriter::WriteData(const void* data, size_t size)
+{
+    if (!m_bFailed && size > 0 && fwrite(data, 1, size, m_pFile) != size)
+    {
+        m_bFailed = true;
+    }
+    m_DataEnd += size;
+}
+
+void CColumnWriter::FlushBlock(Column_t& column)
+{
+    const ColumnType type = (ColumnType)column.desc.type;
+    columnblock_t block;
+    memset(&block, 0, sizeof(block));
+    block.rows = (uint32_t)(column.pending.size() / GetColumnTypeSize(type));
+    if (block.rows == 0)
+        return;
+
+    ForColumnType(type, [&](auto typeTag) {
+        typedef decltype(typeTag) T;
+        EncodeBlock((const T*)column.pending.data(), block.rows, block, m_EncodeBuffer);
+    });
+
+    static const uint8_t s_Padding[COLUMN_ALIGNMENT] = {};
+    WriteData(s_Padding, (size_t)((COLUMN_ALIGNMENT - m_DataEnd % COLUMN_ALIGNMENT) % COLUMN_ALIGNMENT));
+    block.offset = m_DataEnd;
+    block.size = (uint32_t)m_EncodeBuffer.size();
+    WriteData(m_EncodeBuffer.data(), m_EncodeBuffer.size());
+
+    column.blocks.push_back(block);
+    column.pending.clear();
+}
+
+bool CColumnWriter::Close()
+{
+    if (!m_pFile)
+        return false;
+
+    for (size_t i = 0; i < m_Columns.size(); i++)
+    {
+        FlushBlock(m_Columns[i]);
+    }
+
+    columnheader_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = COLUMN_MAGIC;
+    header.version = COLUMN_VERSION;
+    header.columnCount = (uint32_t)m_Columns.size();
+    header.stringCount = (uint32_t)m_Strings.size();
+    header.blockRows = m_BlockRows;
+    header.rowCount = m_Columns.empty() ? 0 : m_Columns[0].rows;
+
+    std::vector<columndesc_t> descs;
+    std::vector<columnblock_t> blocks;
+    for (size_t i = 0; i < m_Columns.size(); i++)
+    {
+        Column_t& column = m_Columns[i];
+        if (column.rows != header.rowCount)
+        {
+            m_bFailed = true;
+        }
+        column.desc.firstBlock = (uint32_t)blocks.size();
+        column.desc.blockCount = (uint32_t)column.blocks.size();
+        descs.push_back(column.desc);
+        blocks.insert(blocks.end(), column.blocks.begin(), column.blocks.end());
+    }
+    header.blockCount = (uint32_t)blocks.size();
+
+    std::string directory;
+    directory.append((const char*)descs.data(), descs.size() * sizeof(columndesc_t));
+    directory.append((const char*)blocks.data(), blocks.size() * sizeof(columnblock_t));
+    for (size_t i = 0; i < m_Strings.size(); i++)
+    {
+        const uint16_t length = (uint16_t)(m_Strings[i].size() < 0xFFFF ? m_Strings[i].size() : 0xFFFF);
+        directory.append((const char*)&length, sizeof(length));
+        directory.append(m_Strings[i].data(), length);
+    }
+
+    header.directoryOffset = m_DataEnd;
+    header.directorySize = directory.size();
+    header.directoryCrc = Crc32(directory.data(), directory.size());
+    header.crc = Crc32(&header, offsetof(columnheader_t, crc));
+    WriteData(directory.data(), directory.size());
+
+    if (!m_bFailed &&
+        (fseek(m_pFile, 0, SEEK_SET) != 0 || fwrite(&header, 1, sizeof(header), m_pFile) != sizeof(header)))
+    {
+        m_bFailed = true;
+    }
+    if (fclose(m_pFile) != 0)
+    {
+        m_bFailed = true;
+    }
+    m_pFile = NULL;
+    return !m_bFailed;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: reader
+//---------------------------------------------------------------------------------
+CColumnReader::CColumnReader()
+{
+    memset(&m_Header, 0, sizeof(m_Header));
+}
+
+void CColumnReader::Close()
+{
+    m_File.Close();
+    memset(&m_Header, 0, sizeof(m_Header));
+    m_Columns.clear();
+    m_Blocks.clear();
+    m_Strings.clear();
+}
+
+bool CColumnReader::Open(const char* path)
+{
+    Close();
+
+    // Scans jump from block to block of one column
+    if (m_File.Open(path, false) != MAPERR_NONE || m_File.GetSize() < sizeof(columnheader_t))
+    {
+        Close();
+        return false;
+    }
+
+    const uint8_t* data = m_File.GetData();
+    const uint64_t fileSize = m_File.GetSize();
+    memcpy(&m_Header, data, sizeof(m_Header));
+    if (m_Header.magic != COLUMN_MAGIC || m_Header.version != COLUMN_VERSION ||
+        m_Header.crc != Crc32(&m_Header, offsetof(columnheader_t, crc)) || m_Header.blockRows == 0 ||
+        m_Header.directoryOffset > fileSize || m_Header.directorySize > fileSize - m_Header.directoryOffset)
+    {
+        Close();
+        return false;
+    }
+
+    const uint8_t* directory = data + m_Header.directoryOffset;
+    const size_t directorySize = (size_t)m_Header.directorySize;
+    const uint64_t tablesSize = (uint64_t)m_Header.columnCount * sizeof(columndesc_t) +
+                                (uint64_t)m_Header.blockCount * sizeof(columnblock_t);
+    if (Crc32(directory, directorySize) != m_Header.directoryCrc || tablesSize > directorySize)
+    {
+        Close();
+        return false;
+    }
+
+    m_Columns.resize(m_Header.columnCount);
+    m_Blocks.resize(m_Header.blockCount);
+    memcpy(m_Columns.data(), directory, m_Columns.size() * sizeof(columndesc_t));
+    memcpy(m_Blocks.data(),
+           directory + m_Columns.size() * sizeof(columndesc_t),
+           m_Blocks.size() * sizeof(columnblock_t));
+
+    // Checksummed, but the data the blocks point at isn't, so everything is checked against the file
+    for (size_t i = 0; i < m_Columns.size(); i++)
+    {
+        columndesc_t& column = m_Columns[i];
+        column.name[COLUMN_MAX_NAME - 1] = '\0';
+        if (column.type >= COLTYPE_COUNT || column.firstBlock > m_Blocks.size() ||
+            column.blockCount > m_Blocks.size() - column.firstBlock)
+        {
+            Close();
+            return false;
+        }
+
+        uint64_t rows = 0;
+        const size_t typeSize = GetColumnTypeSize((ColumnType)column.type);
+        for (uint32_t b = 0; b < column.blockCount; b++)
+        {
+            const columnblock_t& block = m_Blocks[column.firstBlock + b];
+            const bool bLast = b + 1 == column.blockCount;
+            if (block.offset > fileSize || block.size > fileSize - block.offset || block.rows == 0 ||
+                (bLast ? block.rows > m_Header.blockRows : block.rows != m_Header.blockRows) ||
+                (block.encoding == COLENC_PLAIN &&
+                 (block.size != (uint64_t)block.rows * typeSize || block.offset % COLUMN_ALIGNMENT != 0)))
+            {
+                Close();
+                return false;
+            }
+            rows += block.rows;
+        }
+        if (rows != m_Header.rowCount)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    size_t pos = (size_t)tablesSize;
+    for (uint32_t i = 0; i < m_Header.stringCount; i++)
+    {
+        uint16_t length;
+        if (directorySize - pos < sizeof(length))
+            break;
+        memcpy(&length, directory + pos, sizeof(length));
+        pos += sizeof(length);
+        if (directorySize - pos < length)
+            break;
+        m_Strings.push_back(std::string((const char*)directory + pos, length));
+        pos += length;
+    }
+    if (m_Strings.size() != m_Header.stringCount)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+int CColumnReader::FindColumn(const char* name) const
+{
+    for (size_t i = 0; i < m_Columns.size(); i++)
+    {
+        if (strcmp(m_Columns[i].name, name) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+const void* CColumnReader::ReadBlock(size_t column, uint32_t block, std::vector<uint8_t>& scratch) const
+{
+    const columnblock_t& info = GetBlock(column, block);
+    const uint8_t* data = m_File.GetData() + info.offset;
+    if (info.encoding == COLENC_PLAIN)
+        return data;
+
+    const ColumnType type = (ColumnType)m_Columns[column].type;
+    scratch.resize((size_t)info.rows * GetColumnTypeSize(type));
+    bool bDecoded = false;
+    ForColumnType(type, [&](auto typeTag) {
+        typedef decltype(typeTag) T;
+        bDecoded = DecodeBlock(data, info, (T*)scratch.data());
+    });
+    return bDecoded ? scratch.data() : NULL;
+}
+
+bool CColumnReader::ReadColumn(size_t column, std::vector<double>& values) const
+{
+    values.clear();
+    values.reserve((size_t)m_Header.rowCount);
+    std::vector<uint8_t> scratch;
+    bool ok = true;
+    for (uint32_t b = 0; b < m_Columns[column].blockCount && ok; b++)
+    {
+        const void* data = ReadBlock(column, b, scratch);
+        const uint32_t rows = GetBlock(column, b).rows;
+        ok = data != NULL;
+        ForColumnType((ColumnType)m_Columns[column].type, [&](auto typeTag) {
+            typedef decltype(typeTag) T;
+            for (uint32_t i = 0; ok && i < rows; i++)
+            {
+                values.push_back((double)LoadValue<T>((const uint8_t*)data + (size_t)i * sizeof(T)));
+            }
+        });
+    }
+    return ok;
+}
+
+bool CColumnReader::ScanColumn(size_t column, double lo, double hi, ColumnScan_t& scan) const
+{
+    memset(&scan, 0, sizeof(scan));
+    scan.rows = m_Header.rowCount;
+    scan.minValue = std::numeric_limits<double>::infinity();
+    scan.maxValue = -std::numeric_limits<double>::infinity();
+
+    std::vector<uint8_t> scratch;
+    bool ok = true;
+    ForColumnType((ColumnType)m_Columns[column].type, [&](auto typeTag) {
+        typedef decltype(typeTag) T;
+        typedef typename std::conditional<std::numeric_limits<T>::is_integer, int64_t, double>::type Sum;
+        T typeLo;
+        T typeHi;
+        if (!ToTypeRange(lo, hi, typeLo, typeHi))
+            return;
+
+        for (uint32_t b = 0; b < m_Columns[column].blockCount && ok; b++)
+        {
+            const columnblock_t& block = GetBlock(column, b);
+            if (block.maxValue < lo || block.minValue > hi)
+            {
+                scan.blocksSkipped++;
+                continue;
+            }
+            if (block.minValue >= lo && block.maxValue <= hi && !isnan(block.sum))
+            {
+                scan.blocksFromStats++;
+                scan.matches += block.rows;
+                scan.sum += block.sum;
+                scan.minValue = block.minValue < scan.minValue ? block.minValue : scan.minValue;
+                scan.maxValue = block.maxValue > scan.maxValue ? block.maxValue : scan.maxValue;
+                continue;
+            }
+
+            const T* values = (const T*)ReadBlock(column, b, scratch);
+            ok = values != NULL;
+            if (ok)
+            {
+                ScanValues<T, Sum>(values, block.rows, typeLo, typeHi, scan);
+                scan.blocksDecoded++;
+                scan.bytesRead += block.size;
+            }
+        }
+    });
+    return ok;
+}
+
+bool CColumnReader::FilterColumn(size_t column, double lo, double hi, std::vector<uint64_t>& rows) const
+{
+    std::vector<uint8_t> scratch;
+    bool ok = true;
+    ForColumnType((ColumnType)m_Columns[column].type, [&](auto typeTag) {
+        typedef decltype(typeTag) T;
+        T typeLo;
+        T typeHi;
+        if (!ToTypeRange(lo, hi, typeLo, typeHi))
+            return;
+
+        for (uint32_t b = 0; b < m_Columns[column].blockCount && ok; b++)
+        {
+            const columnblock_t& block = GetBlock(column, b);
+            const uint64_t firstRow = (uint64_t)b * m_Header.blockRows;
+            if (block.maxValue < lo || block.minValue > hi)
+                continue;
+            if (block.minValue >= lo && block.maxValue <= hi && !isnan(block.sum))
+            {
+                for (uint32_t i = 0; i < block.rows; i++)
+                {
+                    rows.push_back(firstRow + i);
+                }
+                continue;
+            }
+
+            const T* values = (const T*)ReadBlock(column, b, scratch);
+            ok = values != NULL;
+            if (ok)
+            {
+                FilterValues(values, block.rows, typeLo, typeHi, firstRow, rows);
+            }
+        }
+    });
+    return ok;
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+// Tick columns (.stc): tick level data of many sessions (usercmd fields, message sizes, which demo and map a row came
+// from) stored column by column, so a question about one column reads only that column.
+//
+// Every column is cut into blocks of up to COLUMN_BLOCK_ROWS rows. A block is stored plain (the values as they are in
+// memory, 8 byte aligned so a mapped file can be read in place), as differences to the previous value in 1, 2 or 4
+// bytes, or as runs of one value, whichever is smallest. Each block records the min, max and sum of its values, so a
+// scan skips blocks that can't match and answers blocks that match completely without reading them. Strings (demo
+// and map names) go into a dictionary and are stored in columns as their index.
+//
+// Layout: header, blocks as they were filled, directory (column table, block table, dictionary).
+
+#define COLUMN_EXTENSION ".stc"
+
+// "STC1"
+#define COLUMN_MAGIC 0x31435453u
+#define COLUMN_VERSION 1
+
+#define COLUMN_BLOCK_ROWS 65536
+#define COLUMN_MAX_NAME 32
+
+// Blocks start on this boundary, enough for every column type
+#define COLUMN_ALIGNMENT 8
+
+enum ColumnType
+{
+    COLTYPE_INT8,
+    COLTYPE_UINT8,
+    COLTYPE_INT16,
+    COLTYPE_UINT16,
+    COLTYPE_INT32,
+    COLTYPE_UINT32,
+    COLTYPE_INT64,
+    COLTYPE_FLOAT32,
+
+    COLTYPE_COUNT
+};
+
+enum ColumnEncoding
+{
+    COLENC_PLAIN,
+
+    // int64 first value, then the difference to the previous value for every other row in deltaWidth bytes. A
+    // difference that doesn't fit is the width's smallest value followed by the difference as an int64. Integer
+    // columns only.
+    COLENC_DELTA,
+
+    // uint32 run count, then that many values followed by that many uint32 run lengths
+    COLENC_RLE,
+};
+
+#pragma pack(push, 1)
+struct columnheader_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t columnCount;
+    uint32_t blockCount;
+    uint32_t stringCount;
+    uint32_t blockRows;
+    uint64_t rowCount;
+    uint64_t directoryOffset;
+    uint64_t directorySize;
+
+    // CRC-32 of the directory
+    uint32_t directoryCrc;
+
+    // CRC-32 of everything above
+    uint32_t crc;
+};
+
+struct columndesc_t
+{
+    char name[COLUMN_MAX_NAME];
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t blockCount;
+
+    // Index of the column's first block in the block table, its blocks are next to each other
+    uint32_t firstBlock;
+};
+
+struct columnblock_t
+{
+    uint64_t offset;
+    uint32_t size;
+    uint32_t rows;
+
+    // Of the block's values as doubles, exact for everything but int64 values past 2^53
+    double minValue;
+    double maxValue;
+    double sum;
+
+    uint8_t encoding;
+
+    // COLENC_DELTA: bytes per difference
+    uint8_t deltaWidth;
+    uint8_t reserved[6];
+};
+#pragma pack(pop)
+
+// Bytes per value
+size_t GetColumnTypeSize(ColumnType type);
+const char* ColumnTypeToString(ColumnType type);
+const char* ColumnEncodingToString(ColumnEncoding encoding);
+
+//---------------------------------------------------------------------------------
+// Purpose: writes a column file. Columns are declared first, then filled in any order and in pieces of any size, a
+// block is encoded and written as soon as it is full. Every column must have the same number of rows at Close.
+//---------------------------------------------------------------------------------
+class CColumnWriter
+{
+    public:
+    explicit CColumnWriter(uint32_t blockRows = COLUMN_BLOCK_ROWS);
+    ~CColumnWriter();
+
+    bool Open(const char* path);
+
+    // Index of the new column, -1 if the name is taken or too long or rows were already added
+    int AddColumn(const char* name, ColumnType type);
+
+    // count values of the column's type
+    void Append(int column, const void* values, size_t count);
+    void AppendInt(int column, int64_t value);
+    void AppendFloat(int column, float value);
+
+    // Index of the string in the dictionary, added if it isn't there yet
+    uint32_t AddString(const std::string& text);
+
+    // Writes what is left and the directory, false if anything failed since Open or the row counts differ
+    bool Close();
+
+    uint64_t GetBytesWritten() const
+    {
+        return m_DataEnd;
+    }
+
+    private:
+    CColumnWriter(const CColumnWriter&);
+    CColumnWriter& operator=(const CColumnWriter&);
+
+    struct Column_t
+    {
+        columndesc_t desc;
+        std::vector<uint8_t> pending;
+        uint64_t rows;
+        std::vector<columnblock_t> blocks;
+    };
+
+    void FlushBlock(Column_t& column);
+    void WriteData(const void* data, size_t size);
+
+    uint32_t m_BlockRows;
+    FILE* m_pFile;
+    bool m_bFailed;
+    uint64_t m_DataEnd;
+    std::vector<Column_t> m_Columns;
+    std::vector<std::string> m_Strings;
+    std::map<std::string, uint32_t> m_StringIds;
+    std::vector<uint8_t> m_EncodeBuffer;
+};
+
+// What ScanColumn found, and how much of the column it had to look at
+struct ColumnScan_t
+{
+    uint64_t rows;
+    uint64_t matches;
+    double sum;
+
+    // Of the matching values, +-infinity without any
+    double minValue;
+    double maxValue;
+
+    uint32_t blocksSkipped;
+    uint32_t blocksFromStats;
+    uint32_t blocksDecoded;
+
+    // Stored bytes of the decoded blocks
+    uint64_t bytesRead;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: maps a column file and reads or scans its columns. Plain blocks are used where they are in the mapping,
+// the others are decoded into a buffer of the caller's. Const methods may be called from several threads at once.
+//---------------------------------------------------------------------------------
+class CColumnReader
+{
+    public:
+    CColumnReader();
+
+    // False if the file is not a column file or its directory is damaged
+    bool Open(const char* path);
+    void Close();
+
+    uint64_t GetRowCount() const
+    {
+        return m_Header.rowCount;
+    }
+    size_t GetColumnCount() const
+    {
+        return m_Columns.size();
+    }
+    const columndesc_t& GetColumn(size_t column) const
+    {
+        return m_Columns[column];
+    }
+    uint32_t GetBlockCount(size_t column) const
+    {
+        return m_Columns[column].blockCount;
+    }
+    const columnblock_t& GetBlock(size_t column, uint32_t block) const
+    {
+        return m_Blocks[m_Columns[column].firstBlock + block];
+    }
+    size_t GetStringCount() const
+    {
+        return m_Strings.size();
+    }
+    const std::string& GetString(size_t index) const
+    {
+        return m_Strings[index];
+    }
+    uint64_t GetFileSize() const
+    {
+        return m_File.GetSize();
+    }
+
+    // -1 if there is no such column
+    int FindColumn(const char* name) const;
+
+    // The block's values as the column's type, NULL if the block is damaged
+    const void* ReadBlock(size_t column, uint32_t block, std::vector<uint8_t>& scratch) const;
+
+    // Every value of the column converted to double, for the tools and tests
+    bool ReadColumn(size_t column, std::vector<double>& values) const;
+
+    // Counts, sums and finds the range of the values in [lo, hi]
+    bool ScanColumn(size_t column, double lo, double hi, ColumnScan_t& scan) const;
+
+    // Appends the rows whose value is in [lo, hi]
+    bool FilterColumn(size_t column, double lo, double hi, std::vector<uint64_t>& rows) const;
+
+    private:
+    CColumnReader(const CColumnReader&);
+    CColumnReader& operator=(const CColumnReader&);
+
+    CMappedFile m_File;
+    columnheader_t m_Header;
+    std::vector<columndesc_t> m_Columns;
+    std::vector<columnblock_t> m_Blocks;
+    std::vector<std::string> m_Strings;
+};
@@ -0,0 +1,196 @@
+#include "crc32.h"
+
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CRC32C_X86
+#endif
+
+#ifdef CRC32C_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <nmmintrin.h>
+#define CRC32C_TARGET
+#else
+#include <cpuid.h>
+#include <nmmintrin.h>
+// Only the functions marked with it may use SSE 4.2, the rest of the build runs on any x86
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+#endif
+#endif
+
+//---------------------------------------------------------------------------------
+// Purpose: slicing-by-4 table driven CRC-32, tables are built on first use
+//---------------------------------------------------------------------------------
+struct Crc32Tables_t
+{
+    uint32_t table[4][256];
+
+    Crc32Tables_t()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+            }
+            table[0][i] = crc;
+        }
+
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            for (int slice = 1; slice < 4; slice++)
+            {
+                const uint32_t prev = table[slice - 1][i];
+                table[slice][i] = (prev >> 8) ^ table[0][prev & 0xFF];
+            }
+        }
+    }
+};
+
+uint32_t Crc32(const void* data, size_t size, uint32_t crc)
+{
+    static const Crc32Tables_t s_Tables;
+    const uint32_t(*t)[256] = s_Tables.table;
+
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+
+    while (size >= 4)
+    {
+        crc ^= (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        crc = t[3][crc & 0xFF] ^ t[2][(crc >> 8) & 0xFF] ^ t[1][(crc >> 16) & 0xFF] ^ t[0][crc >> 24];
+        p += 4;
+        size -= 4;
+    }
+
+    while (size--)
+    {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: CRC-32C, the same slicing-by-4 with the Castagnoli polynomial, and the SSE 4.2 instruction when there is one
+//---------------------------------------------------------------------------------
+struct Crc32cTables_t
+{
+    uint32_t table[4][256];
+
+    Crc32cTables_t()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+            }
+            table[0][i] = crc;
+        }
+
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            for (int slice = 1; slice < 4; slice++)
+            {
+                const uint32_t prev = table[slice - 1][i];
+                table[slice][i] = (prev >> 8) ^ table[0][prev & 0xFF];
+            }
+        }
+    }
+};
+
+uint32_t Crc32cPortable(const void* data, size_t size, uint32_t crc)
+{
+    static const Crc32cTables_t s_Tables;
+    const uint32_t(*t)[256] = s_Tables.table;
+
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+
+    while (size >= 4)
+    {
+        crc ^= (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        crc = t[3][crc & 0xFF] ^ t[2][(crc >> 8) & 0xFF] ^ t[1][(crc >> 16) & 0xFF] ^ t[0][crc >> 24];
+        p += 4;
+        size -= 4;
+    }
+
+    while (size--)
+    {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+#ifdef CRC32C_X86
+static bool DetectSse42()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2) != 0;
+#endif
+}
+
+CRC32C_TARGET static uint32_t Crc32cSse42(const void* data, size_t size, uint32_t crc)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+
+#if defined(_M_X64) || defined(__x86_64__)
+    uint64_t crc64 = crc;
+    while (size >= 8)
+    {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        crc64 = _mm_crc32_u64(crc64, value);
+        p += 8;
+        size -= 8;
+    }
+    crc = (uint32_t)crc64;
+#endif
+
+    while (size >= 4)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        crc = _mm_crc32_u32(crc, value);
+        p += 4;
+        size -= 4;
+    }
+
+    while (size--)
+    {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+
+    return ~crc;
+}
+#endif
+
+bool HasHardwareCrc32c()
+{
+#ifdef CRC32C_X86
+    static const bool s_bSse42 = DetectSse42();
+    return s_bSse42;
+#else
+    return false;
+#endif
+}
+
+uint32_t Crc32c(const void* data, size_t size, uint32_t crc)
+{
+#ifdef CRC32C_X86
+    if (HasHardwareCrc32c())
+        return Crc32cSse42(data, size, crc);
+#endif
+    return Crc32cPortable(data, size, crc);
+}
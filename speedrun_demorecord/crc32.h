@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3, same as zlib). Pass the previous result as crc to checksum data in pieces.
+uint32_t Crc32(const void* data, size_t size, uint32_t crc = 0);
+
+// CRC-32C (Castagnoli, iSCSI). Same usage as Crc32, but on CPUs with SSE 4.2 it runs on the crc32 instruction at
+// several GB/s, table driven elsewhere. Both give the same result.
+uint32_t Crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+// Table driven CRC-32C whatever the CPU, to check the hardware path against
+uint32_t Crc32cPortable(const void* data, size_t size, uint32_t crc = 0);
+
+bool HasHardwareCrc32c();
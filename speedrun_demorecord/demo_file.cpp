@@ -0,0 +1,233 @@
+#include "demo_file.h"
+
+#include <string.h>
+
+
+// Demos are always little endian and so is everything we run on
+static inline int32_t ReadInt32(const uint8_t* p)
+{
+    int32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: message iterator
+//---------------------------------------------------------------------------------
+CDemoMessageReader::CDemoMessageReader(const uint8_t* data, uint64_t size, uint64_t offset)
+    : m_pData(data), m_Size(size), m_Offset(offset), m_Error(DEMERR_NONE), m_bReachedStop(false)
+{
+}
+
+bool CDemoMessageReader::Next(DemoMessage_t& msg)
+{
+    if (m_Error != DEMERR_NONE || m_bReachedStop)
+        return false;
+
+    if (m_Offset >= m_Size)
+    {
+        // Ran out of data without seeing a stop message (crash, or the demo is still being written)
+        m_Error = DEMERR_TRUNCATED;
+        return false;
+    }
+
+    const uint8_t* p = m_pData + m_Offset;
+    const uint64_t remaining = m_Size - m_Offset;
+    const uint8_t cmd = p[0];
+
+    if (cmd > DEM_LASTCMD)
+    {
+        m_Error = DEMERR_UNKNOWN_MESSAGE;
+        return false;
+    }
+
+    msg.type = (DemoMessageType)cmd;
+    msg.offset = m_Offset;
+    msg.cmdInfo = NULL;
+    msg.sequence = 0;
+    msg.data = NULL;
+    msg.dataLength = 0;
+
+    if (cmd == DEM_STOP)
+    {
+        // The engine writes a tick after the stop command but older tools never relied on it
+        msg.tick = remaining >= DEMO_MSG_HEADER_SIZE ? ReadInt32(p + 1) : -1;
+        msg.size = remaining >= DEMO_MSG_HEADER_SIZE ? DEMO_MSG_HEADER_SIZE : remaining;
+        m_Offset += msg.size;
+        m_bReachedStop = true;
+        return true;
+    }
+
+    if (remaining < DEMO_MSG_HEADER_SIZE)
+    {
+        m_Error = DEMERR_TRUNCATED;
+        return false;
+    }
+
+    msg.tick = ReadInt32(p + 1);
+    uint64_t pos = DEMO_MSG_HEADER_SIZE;
+
+    switch (cmd)
+    {
+        case DEM_SYNCTICK:
+        case DEM_NOP:
+            msg.size = pos;
+            m_Offset += pos;
+            return true;
+
+        case DEM_SIGNON:
+        case DEM_PACKET:
+            msg.cmdInfo = p + pos;
+            pos += DEMO_CMDINFO_SIZE;
+            break;
+
+        case DEM_USERCMD:
+            if (remaining >= pos + DEMO_USERCMD_SEQUENCE_SIZE)
+            {
+                msg.sequence = ReadInt32(p + pos);
+            }
+            pos += DEMO_USERCMD_SEQUENCE_SIZE;
+            break;
+
+        default:
+            break;
+    }
+
+    if (remaining < pos + sizeof(int32_t))
+    {
+        m_Error = DEMERR_TRUNCATED;
+        return false;
+    }
+
+    const uint32_t dataLength = (uint32_t)ReadInt32(p + pos);
+    pos += sizeof(int32_t);
+
+    if (remaining - pos < dataLength)
+    {
+        m_Error = DEMERR_TRUNCATED;
+        return false;
+    }
+
+    msg.data = p + pos;
+    msg.dataLength = dataLength;
+    msg.size = pos + dataLength;
+    m_Offset += msg.size;
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: memory mapped demo file
+//---------------------------------------------------------------------------------
+CDemoFile::CDemoFile()
+{
+}
+
+CDemoFile::~CDemoFile()
+{
+    Close();
+}
+
+DemoError CDemoFile::Open(const char* path)
+{
+    Close();
+
+    const MappedFileError mapError = m_File.Open(path);
+    if (mapError != MAPERR_NONE)
+        return mapError == MAPERR_OPEN ? DEMERR_OPEN : DEMERR_MAP;
+
+    DemoError error = m_File.GetSize() < DEMO_HEADER_SIZE ? DEMERR_TOO_SMALL
+                                                          : ValidateDemoHeader(m_File.GetData(), m_File.GetSize());
+    if (error != DEMERR_NONE)
+    {
+        Close();
+    }
+    return error;
+}
+
+void CDemoFile::Close()
+{
+    m_File.Close();
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: helpers
+//---------------------------------------------------------------------------------
+DemoError ValidateDemoHeader(const uint8_t* data, uint64_t size)
+{
+    if (!data || size < DEMO_HEADER_SIZE)
+        return DEMERR_TOO_SMALL;
+
+    // Stamp includes the terminating null
+    if (memcmp(data, DEMO_HEADER_ID, sizeof(DEMO_HEADER_ID)) != 0)
+        return DEMERR_BAD_STAMP;
+
+    return DEMERR_NONE;
+}
+
+void SummarizeDemo(const uint8_t* data, uint64_t size, DemoSummary_t& summary)
+{
+    memset(&summary, 0, sizeof(summary));
+    summary.lastTick = -1;
+
+    summary.error = ValidateDemoHeader(data, size);
+    if (summary.error != DEMERR_NONE)
+        return;
+
+    CDemoMessageReader reader(data, size);
+    DemoMessage_t msg;
+    while (reader.Next(msg))
+    {
+        summary.messageCounts[msg.type]++;
+        summary.messageBytes[msg.type] += msg.size;
+
+        if (msg.type != DEM_STOP && msg.tick >= 0)
+        {
+            summary.lastTick = msg.tick;
+        }
+    }
+
+    summary.reachedStop = reader.ReachedStop();
+    summary.error = reader.GetError();
+    summary.errorOffset = reader.GetOffset();
+}
+
+const char* DemoErrorToString(DemoError error)
+{
+    switch (error)
+    {
+        case DEMERR_NONE:
+            return "ok";
+        case DEMERR_OPEN:
+            return "unable to open file";
+        case DEMERR_MAP:
+            return "unable to map file";
+        case DEMERR_TOO_SMALL:
+            return "file is smaller than the demo header";
+        case DEMERR_BAD_STAMP:
+            return "not an HL2DEMO file";
+        case DEMERR_TRUNCATED:
+            return "demo ends before a stop message";
+        case DEMERR_UNKNOWN_MESSAGE:
+            return "unknown message type";
+    }
+    return "unknown error";
+}
+
+const char* DemoMessageTypeToString(int type)
+{
+    static const char* const s_Names[DEMO_MSG_TYPE_COUNT] = {
+        "Nop",
+        "Signon",
+        "Packet",
+        "SyncTick",
+        "ConsoleCmd",
+        "UserCmd",
+        "DataTables",
+        "Stop",
+        "StringTables",
+    };
+
+    if (type < 0 || type >= DEMO_MSG_TYPE_COUNT)
+        return "Unknown";
+    return s_Names[type];
+}
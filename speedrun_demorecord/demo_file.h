@@ -0,0 +1,191 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mapped_file.h"
+
+// Standalone HL2DEMO reader. Nothing in here depends on the Source SDK so the same code is used by the plugin and by
+// the command line tools in tools/.
+
+#define DEMO_HEADER_ID "HL2DEMO"
+#define DEMO_HEADER_SIZE 0x430
+#define DEMO_MAX_OSPATH 260
+
+// democmdinfo_t that precedes the payload of signon and packet messages
+#define DEMO_CMDINFO_SIZE 0x54
+
+// outgoing sequence number that precedes the payload of usercmd messages
+#define DEMO_USERCMD_SEQUENCE_SIZE 4
+
+// command byte + tick
+#define DEMO_MSG_HEADER_SIZE 5
+
+enum DemoMessageType
+{
+    // Not written by the engine, tolerated the same way tests/demo_utils.py does
+    DEM_NOP = 0,
+
+    DEM_SIGNON,
+    DEM_PACKET,
+    DEM_SYNCTICK,
+    DEM_CONSOLECMD,
+    DEM_USERCMD,
+    DEM_DATATABLES,
+    DEM_STOP,
+    DEM_STRINGTABLES,
+
+    DEM_LASTCMD = DEM_STRINGTABLES
+};
+
+#define DEMO_MSG_TYPE_COUNT (DEM_LASTCMD + 1)
+
+enum DemoError
+{
+    DEMERR_NONE,
+    DEMERR_OPEN,
+    DEMERR_MAP,
+    DEMERR_TOO_SMALL,
+    DEMERR_BAD_STAMP,
+    DEMERR_TRUNCATED,
+    DEMERR_UNKNOWN_MESSAGE,
+};
+
+#pragma pack(push, 1)
+struct demoheader_t
+{
+    char demofilestamp[8]; // "HL2DEMO\0"
+    int32_t demoprotocol;
+    int32_t networkprotocol;
+    char servername[DEMO_MAX_OSPATH];
+    char clientname[DEMO_MAX_OSPATH];
+    char mapname[DEMO_MAX_OSPATH];
+    char gamedirectory[DEMO_MAX_OSPATH];
+    float playback_time;
+    int32_t playback_ticks;
+    int32_t playback_frames;
+    int32_t signonlength;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(demoheader_t) == DEMO_HEADER_SIZE, "demoheader_t must match the on-disk header");
+
+//---------------------------------------------------------------------------------
+// Purpose: a single message inside a demo. Pointers reference the caller's buffer, nothing is copied.
+//---------------------------------------------------------------------------------
+struct DemoMessage_t
+{
+    DemoMessageType type;
+    int32_t tick;
+
+    // Offset of the command byte from the start of the buffer and total bytes including framing
+    uint64_t offset;
+    uint64_t size;
+
+    // DEM_SIGNON/DEM_PACKET only, DEMO_CMDINFO_SIZE bytes
+    const uint8_t* cmdInfo;
+
+    // DEM_USERCMD only
+    int32_t sequence;
+
+    // Payload of signon, packet, consolecmd, usercmd, datatables and stringtables messages
+    const uint8_t* data;
+    uint32_t dataLength;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: streaming iterator over the messages that follow the header. Works on any contiguous buffer (a mapped
+// file, or the bytes of a demo that is still being written). A partially written trailing message stops iteration
+// with DEMERR_TRUNCATED and leaves GetOffset() at the start of that message so the caller can retry with more data.
+//---------------------------------------------------------------------------------
+class CDemoMessageReader
+{
+    public:
+    CDemoMessageReader(const uint8_t* data, uint64_t size, uint64_t offset = DEMO_HEADER_SIZE);
+
+    // Returns false at the stop message, at the end of the buffer or on error
+    bool Next(DemoMessage_t& msg);
+
+    DemoError GetError() const
+    {
+        return m_Error;
+    }
+    bool ReachedStop() const
+    {
+        return m_bReachedStop;
+    }
+    uint64_t GetOffset() const
+    {
+        return m_Offset;
+    }
+
+    private:
+    const uint8_t* m_pData;
+    uint64_t m_Size;
+    uint64_t m_Offset;
+    DemoError m_Error;
+    bool m_bReachedStop;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: read-only memory mapped demo file
+//---------------------------------------------------------------------------------
+class CDemoFile
+{
+    public:
+    CDemoFile();
+    ~CDemoFile();
+
+    // Maps the file and validates the header
+    DemoError Open(const char* path);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return m_File.IsOpen();
+    }
+    const demoheader_t* GetHeader() const
+    {
+        return reinterpret_cast<const demoheader_t*>(m_File.GetData());
+    }
+    const uint8_t* GetData() const
+    {
+        return m_File.GetData();
+    }
+    uint64_t GetSize() const
+    {
+        return m_File.GetSize();
+    }
+    CDemoMessageReader GetMessages() const
+    {
+        return CDemoMessageReader(m_File.GetData(), m_File.GetSize());
+    }
+
+    private:
+    CDemoFile(const CDemoFile&);
+    CDemoFile& operator=(const CDemoFile&);
+
+    CMappedFile m_File;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: everything a single pass over a demo can tell us
+//---------------------------------------------------------------------------------
+struct DemoSummary_t
+{
+    // Last non-negative tick before the stop message, -1 if there was none. Matches get_demo_tick_count().
+    int32_t lastTick;
+
+    uint32_t messageCounts[DEMO_MSG_TYPE_COUNT];
+    uint64_t messageBytes[DEMO_MSG_TYPE_COUNT];
+
+    bool reachedStop;
+    DemoError error;
+    uint64_t errorOffset;
+};
+
+DemoError ValidateDemoHeader(const uint8_t* data, uint64_t size);
+void SummarizeDemo(const uint8_t* data, uint64_t size, DemoSummary_t& summary);
+
+const char* DemoErrorToString(DemoError error);
+const char* DemoMessageTypeToString(int type);
@@ -0,0 +1,192 @@
+#include "demo_index.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "crc32.h"
+
+static bool TickLess(int32_t tick, const demoindexentry_t& entry)
+{
+    return tick < entry.tick;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: constructor
+//---------------------------------------------------------------------------------
+CDemoIndex::CDemoIndex()
+{
+    Clear();
+}
+
+void CDemoIndex::Clear()
+{
+    m_Stride = DEMO_INDEX_DEFAULT_STRIDE;
+    m_DemoSize = 0;
+    memset(&m_Summary, 0, sizeof(m_Summary));
+    m_Summary.lastTick = -1;
+    m_Entries.clear();
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: building
+//---------------------------------------------------------------------------------
+void CDemoIndex::Build(const uint8_t* data, uint64_t size, uint32_t stride)
+{
+    Clear();
+    m_Stride = stride > 0 ? stride : 1;
+    m_DemoSize = size;
+
+    m_Summary.error = ValidateDemoHeader(data, size);
+    if (m_Summary.error != DEMERR_NONE)
+        return;
+
+    // Same pass as SummarizeDemo, plus the entries
+    int64_t nextTick = 0;
+    CDemoMessageReader reader(data, size);
+    DemoMessage_t msg;
+    while (reader.Next(msg))
+    {
+        m_Summary.messageCounts[msg.type]++;
+        m_Summary.messageBytes[msg.type] += msg.size;
+
+        if (msg.type == DEM_STOP || msg.tick < 0)
+            continue;
+
+        m_Summary.lastTick = msg.tick;
+        if (msg.tick >= nextTick)
+        {
+            demoindexentry_t entry;
+            entry.tick = msg.tick;
+            entry.reserved = 0;
+            entry.offset = msg.offset;
+            m_Entries.push_back(entry);
+            nextTick = ((int64_t)msg.tick / m_Stride + 1) * m_Stride;
+        }
+    }
+
+    m_Summary.reachedStop = reader.ReachedStop();
+    m_Summary.error = reader.GetError();
+    m_Summary.errorOffset = reader.GetOffset();
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: on-disk format
+//---------------------------------------------------------------------------------
+void CDemoIndex::Serialize(std::string& out) const
+{
+    demoindexheader_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = DEMO_INDEX_MAGIC;
+    header.version = DEMO_INDEX_VERSION;
+    header.stride = m_Stride;
+    header.lastTick = m_Summary.lastTick;
+    header.demoSize = m_DemoSize;
+    header.entryCount = (uint32_t)m_Entries.size();
+    header.reachedStop = m_Summary.reachedStop ? 1 : 0;
+    header.error = (uint8_t)m_Summary.error;
+    memcpy(header.messageCounts, m_Summary.messageCounts, sizeof(header.messageCounts));
+    memcpy(header.messageBytes, m_Summary.messageBytes, sizeof(header.messageBytes));
+
+    const size_t entryBytes = m_Entries.size() * sizeof(demoindexentry_t);
+    header.crc = Crc32(&header, offsetof(demoindexheader_t, crc));
+    if (entryBytes > 0)
+    {
+        header.crc = Crc32(m_Entries.data(), entryBytes, header.crc);
+    }
+
+    out.assign((const char*)&header, sizeof(header));
+    if (entryBytes > 0)
+    {
+        out.append((const char*)m_Entries.data(), entryBytes);
+    }
+}
+
+bool CDemoIndex::Load(const void* data, size_t size)
+{
+    Clear();
+    if (!data || size < sizeof(demoindexheader_t))
+        return false;
+
+    demoindexheader_t header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != DEMO_INDEX_MAGIC || header.version != DEMO_INDEX_VERSION || header.stride == 0)
+        return false;
+
+    const size_t entryBytes = (size_t)header.entryCount * sizeof(demoindexentry_t);
+    if (size - sizeof(header) != entryBytes)
+        return false;
+
+    const uint8_t* entries = (const uint8_t*)data + sizeof(header);
+    uint32_t crc = Crc32(&header, offsetof(demoindexheader_t, crc));
+    crc = Crc32(entries, entryBytes, crc);
+    if (crc != header.crc)
+        return false;
+
+    m_Stride = header.stride;
+    m_DemoSize = header.demoSize;
+    m_Summary.lastTick = header.lastTick;
+    m_Summary.reachedStop = header.reachedStop != 0;
+    m_Summary.error = (DemoError)header.error;
+    memcpy(m_Summary.messageCounts, header.messageCounts, sizeof(m_Summary.messageCounts));
+    memcpy(m_Summary.messageBytes, header.messageBytes, sizeof(m_Summary.messageBytes));
+    m_Entries.resize(header.entryCount);
+    if (entryBytes > 0)
+    {
+        memcpy(m_Entries.data(), entries, entryBytes);
+    }
+    return true;
+}
+
+bool CDemoIndex::WriteFile(const char* path) const
+{
+    std::string bytes;
+    Serialize(bytes);
+
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return fclose(file) == 0 && ok;
+}
+
+bool CDemoIndex::ReadFile(const char* path)
+{
+    Clear();
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    std::string bytes;
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        bytes.append(buffer, read);
+    }
+    fclose(file);
+    return Load(bytes.data(), bytes.size());
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: lookups
+//---------------------------------------------------------------------------------
+uint64_t CDemoIndex::FindOffset(int32_t tick) const
+{
+    std::vector<demoindexentry_t>::const_iterator it =
+        std::upper_bound(m_Entries.begin(), m_Entries.end(), tick, TickLess);
+    if (it == m_Entries.begin())
+        return DEMO_HEADER_SIZE;
+    return (it - 1)->offset;
+}
+
+std::string GetDemoIndexPath(const char* demoPath)
+{
+    std::string path = demoPath;
+    const size_t length = path.size();
+    if (length >= 4 && path.compare(length - 4, 4, ".dem") == 0)
+    {
+        path.resize(length - 4);
+    }
+    return path + DEMO_INDEX_EXTENSION;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "demo_file.h"
+
+// Sidecar index next to every demo ("<name>.dmi"): byte offset of the first message at every stride ticks, the
+// message histogram and the last tick. Answers "last tick" and "where does tick N start" without reading the demo.
+
+#define DEMO_INDEX_EXTENSION ".dmi"
+
+// "DMI1"
+#define DEMO_INDEX_MAGIC 0x31494D44u
+#define DEMO_INDEX_VERSION 1
+
+// About a second of game time at the default tickrate
+#define DEMO_INDEX_DEFAULT_STRIDE 64
+
+#pragma pack(push, 1)
+struct demoindexheader_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t stride;
+
+    // Same meaning as DemoSummary_t::lastTick
+    int32_t lastTick;
+
+    // Size of the demo the index was built from, an index for a different size is stale
+    uint64_t demoSize;
+
+    uint32_t entryCount;
+    uint8_t reachedStop;
+    uint8_t error;
+    uint8_t reserved[2];
+
+    uint32_t messageCounts[DEMO_MSG_TYPE_COUNT];
+    uint64_t messageBytes[DEMO_MSG_TYPE_COUNT];
+
+    // CRC-32 of everything above and the entries that follow the header
+    uint32_t crc;
+};
+
+struct demoindexentry_t
+{
+    int32_t tick;
+    uint32_t reserved;
+    uint64_t offset;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(demoindexheader_t) == 144, "demoindexheader_t is an on-disk format");
+static_assert(sizeof(demoindexentry_t) == 16, "demoindexentry_t is an on-disk format");
+
+//---------------------------------------------------------------------------------
+// Purpose: tick -> offset index of one demo. Entries are sorted by tick, lookups are a binary search.
+//---------------------------------------------------------------------------------
+class CDemoIndex
+{
+    public:
+    CDemoIndex();
+
+    // Single pass over the demo. Adds an entry for the first message of the first tick at or after every multiple of
+    // stride. A truncated demo (still being written, or a crash) is indexed up to the last complete message.
+    void Build(const uint8_t* data, uint64_t size, uint32_t stride = DEMO_INDEX_DEFAULT_STRIDE);
+
+    void Serialize(std::string& out) const;
+
+    // False if the data is not a valid index, the index is left empty
+    bool Load(const void* data, size_t size);
+
+    bool WriteFile(const char* path) const;
+    bool ReadFile(const char* path);
+
+    // Where to start reading to reach tick: the offset of the last entry at or before it, the first message after
+    // the header for ticks before the first entry
+    uint64_t FindOffset(int32_t tick) const;
+
+    const DemoSummary_t& GetSummary() const
+    {
+        return m_Summary;
+    }
+    int32_t GetLastTick() const
+    {
+        return m_Summary.lastTick;
+    }
+    uint32_t GetStride() const
+    {
+        return m_Stride;
+    }
+    uint64_t GetDemoSize() const
+    {
+        return m_DemoSize;
+    }
+    const std::vector<demoindexentry_t>& GetEntries() const
+    {
+        return m_Entries;
+    }
+
+    private:
+    void Clear();
+
+    uint32_t m_Stride;
+    uint64_t m_DemoSize;
+    DemoSummary_t m_Summary;
+    std::vector<demoindexentry_t> m_Entries;
+};
+
+// "<path without .dem>.dmi"
+std::string GetDemoIndexPath(const char* demoPath);
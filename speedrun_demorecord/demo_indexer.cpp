@@ -0,0 +1,365 @@
+#include "demo_indexer.h"
+
+#include <stdio.h>
+#include <chrono>
+
+#include "file_list.h"
+#include "latency_stats.h"
+#include "mapped_file.h"
+
+static bool IsPathSeparator(char c)
+{
+    return c == '/' || c == '\\';
+}
+
+// The engine hands out paths with backslashes on Windows. One separator keeps a demo's path the same however it was
+// queued, it is the digest cache key and compared against its session's dir.
+static std::string NormalizeSeparators(const std::string& path)
+{
+    std::string normalized = path;
+    for (size_t i = 0; i < normalized.size(); i++)
+    {
+        if (normalized[i] == '\\')
+        {
+            normalized[i] = '/';
+        }
+    }
+    return normalized;
+}
+
+// Without the trailing separator, so a session dir compares equal to the parent of its demos
+static std::string TrimSeparators(const std::string& path)
+{
+    size_t length = path.size();
+    while (length > 1 && IsPathSeparator(path[length - 1]))
+    {
+        length--;
+    }
+    return path.substr(0, length);
+}
+
+static size_t GetFileNameOffset(const std::string& path)
+{
+    size_t offset = path.size();
+    while (offset > 0 && !IsPathSeparator(path[offset - 1]))
+    {
+        offset--;
+    }
+    return offset;
+}
+
+static const char* GetFileName(const std::string& path)
+{
+    return path.c_str() + GetFileNameOffset(path);
+}
+
+static std::string GetParentDir(const std::string& path)
+{
+    return TrimSeparators(path.substr(0, GetFileNameOffset(path)));
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: constructor/destructor
+//---------------------------------------------------------------------------------
+CDemoIndexer::CDemoIndexer()
+    : m_Stride(DEMO_INDEX_DEFAULT_STRIDE),
+      m_bStop(false),
+      m_PendingCount(0),
+      m_Built(0),
+      m_Incomplete(0),
+      m_Failed(0),
+      m_DigestsWritten(0),
+      m_DigestReads(0),
+      m_MaxBuildTime(0)
+{
+}
+
+CDemoIndexer::~CDemoIndexer()
+{
+    Shutdown();
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: thread control
+//---------------------------------------------------------------------------------
+void CDemoIndexer::Start(const char* rootDir, uint32_t stride)
+{
+    if (IsRunning())
+        return;
+
+    m_RootDir = rootDir ? rootDir : "";
+    if (!m_RootDir.empty() && !IsPathSeparator(m_RootDir[m_RootDir.size() - 1]))
+    {
+        m_RootDir += '/';
+    }
+    m_Stride = stride;
+
+    m_bStop = false;
+    m_Thread = std::thread(&CDemoIndexer::ThreadMain, this);
+}
+
+void CDemoIndexer::Shutdown()
+{
+    if (!IsRunning())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStop = true;
+        m_Wake.notify_one();
+    }
+    m_Thread.join();
+}
+
+std::string CDemoIndexer::ResolvePath(const char* path) const
+{
+    std::string resolved = path;
+    if (!resolved.empty() && !IsPathSeparator(resolved[0]) && resolved.find(':') == std::string::npos)
+    {
+        resolved = m_RootDir + resolved;
+    }
+    return NormalizeSeparators(resolved);
+}
+
+void CDemoIndexer::Queue(const char* demoPath)
+{
+    PendingDemo_t demo;
+    demo.path = ResolvePath(demoPath);
+    demo.attempts = 0;
+    demo.bDigest = false;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Pending.push_back(demo);
+    m_PendingCount++;
+    m_Wake.notify_one();
+}
+
+void CDemoIndexer::QueueSessionDigest(const char* sessionDir, const char* key)
+{
+    PendingDemo_t session;
+    session.path = TrimSeparators(ResolvePath(sessionDir));
+    session.attempts = 0;
+    session.bDigest = true;
+    session.key = key ? key : "";
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Pending.push_back(session);
+    m_PendingCount++;
+    m_Wake.notify_one();
+}
+
+void CDemoIndexer::WaitIdle()
+{
+    if (!IsRunning())
+        return;
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Idle.wait(lock, [this] { return m_PendingCount.load() == 0; });
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: indexer thread
+//---------------------------------------------------------------------------------
+void CDemoIndexer::ThreadMain()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    for (;;)
+    {
+        if (m_Pending.empty())
+        {
+            if (m_bStop)
+                break;
+            m_Wake.wait(lock);
+            continue;
+        }
+
+        std::vector<PendingDemo_t> work;
+        work.swap(m_Pending);
+        const bool lastTry = m_bStop;
+        lock.unlock();
+
+        std::vector<PendingDemo_t> retry;
+        uint32_t done = 0;
+        for (size_t i = 0; i < work.size(); i++)
+        {
+            if (work[i].bDigest ? TryWriteDigest(work[i], lastTry, retry) : TryIndex(work[i], lastTry))
+            {
+                done++;
+            }
+            else
+            {
+                retry.push_back(work[i]);
+            }
+        }
+
+        lock.lock();
+        m_PendingCount -= done;
+        m_Idle.notify_all();
+
+        if (!retry.empty())
+        {
+            m_Pending.insert(m_Pending.begin(), retry.begin(), retry.end());
+
+            // Nothing new came in, give the engine time to finish the file
+            if (m_Pending.size() == retry.size() && !m_bStop)
+            {
+                m_Wake.wait_for(lock, std::chrono::milliseconds(DEMO_INDEXER_RETRY_MS));
+            }
+        }
+    }
+}
+
+bool CDemoIndexer::TryIndex(PendingDemo_t& demo, bool lastTry)
+{
+    const bool giveUp = lastTry || ++demo.attempts >= DEMO_INDEXER_MAX_ATTEMPTS;
+
+    const uint64_t start = LatencyNow();
+    CDemoFile file;
+    const DemoError error = file.Open(demo.path.c_str());
+    if (error != DEMERR_NONE)
+    {
+        // The engine may not have flushed the header yet
+        if (!giveUp && (error == DEMERR_OPEN || error == DEMERR_TOO_SMALL))
+            return false;
+
+        m_Failed++;
+        return true;
+    }
+
+    CDemoIndex index;
+    index.Build(file.GetData(), file.GetSize(), m_Stride);
+
+    const bool complete = index.GetSummary().reachedStop;
+    if (!complete && index.GetSummary().error == DEMERR_TRUNCATED && !giveUp)
+        return false;
+
+    // The demo is in memory now, reading it again for the digest when the session stops would double the I/O
+    DemoDigest_t& digest = m_Digests[demo.path];
+    BuildDemoDigest(GetFileName(demo.path), file.GetData(), file.GetSize(), DIGEST_DEFAULT_BLOCK_SIZE, digest);
+    file.Close();
+
+    if (!index.WriteFile(GetDemoIndexPath(demo.path.c_str()).c_str()))
+    {
+        m_Failed++;
+        return true;
+    }
+
+    if (complete)
+    {
+        m_Built++;
+    }
+    else
+    {
+        m_Incomplete++;
+    }
+
+    const uint64_t buildTime = LatencyNow() - start;
+    uint64_t current = m_MaxBuildTime.load(std::memory_order_relaxed);
+    while (buildTime > current && !m_MaxBuildTime.compare_exchange_weak(current, buildTime, std::memory_order_relaxed))
+    {
+    }
+    return true;
+}
+
+bool CDemoIndexer::TryWriteDigest(PendingDemo_t& session, bool lastTry, const std::vector<PendingDemo_t>& retry)
+{
+    // The session's last demo is queued before it and may still be waiting for its stop message
+    if (!lastTry)
+    {
+        for (size_t i = 0; i < retry.size(); i++)
+        {
+            if (!retry[i].bDigest && GetParentDir(retry[i].path) == session.path)
+                return false;
+        }
+    }
+
+    std::vector<std::string> files;
+    ListDirectory(session.path, &files, NULL);
+
+    SessionDigest_t digest;
+    digest.blockSize = DIGEST_DEFAULT_BLOCK_SIZE;
+    digest.bKeyed = !session.key.empty();
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (!EndsWith(files[i], ".dem"))
+            continue;
+
+        const std::string path = session.path + '/' + files[i];
+        CMappedFile file;
+        if (file.Open(path.c_str()) != MAPERR_NONE)
+            continue;
+
+        // Demos of an earlier resume of the session, or one the engine appended to after it was indexed, are read now
+        digest.demos.push_back(DemoDigest_t());
+        std::map<std::string, DemoDigest_t>::iterator cached = m_Digests.find(path);
+        if (cached != m_Digests.end() && cached->second.size == file.GetSize())
+        {
+            digest.demos.back().blocks.swap(cached->second.blocks);
+            digest.demos.back().name = files[i];
+            digest.demos.back().size = cached->second.size;
+            digest.demos.back().lastTick = cached->second.lastTick;
+            digest.demos.back().reachedStop = cached->second.reachedStop;
+        }
+        else
+        {
+            BuildDemoDigest(files[i].c_str(), file.GetData(), file.GetSize(), digest.blockSize, digest.demos.back());
+            m_DigestReads++;
+        }
+    }
+
+    for (std::map<std::string, DemoDigest_t>::iterator it = m_Digests.begin(); it != m_Digests.end();)
+    {
+        if (GetParentDir(it->first) == session.path)
+        {
+            m_Digests.erase(it++);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (WriteSessionDigest(session.path, digest, session.key))
+    {
+        m_DigestsWritten++;
+    }
+    else
+    {
+        m_Failed++;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: stats
+//---------------------------------------------------------------------------------
+void CDemoIndexer::GetStats(DemoIndexerStats_t& stats) const
+{
+    stats.built = m_Built.load();
+    stats.incomplete = m_Incomplete.load();
+    stats.failed = m_Failed.load();
+    stats.digests = m_DigestsWritten.load();
+    stats.digestReads = m_DigestReads.load();
+    stats.pending = m_PendingCount.load();
+    stats.maxBuildTime = m_MaxBuildTime.load();
+}
+
+void CDemoIndexer::FormatTable(std::string& out) const
+{
+    DemoIndexerStats_t stats;
+    GetStats(stats);
+
+    char line[192];
+    snprintf(line,
+             sizeof(line),
+             "indexer: %llu built, %llu incomplete, %llu failed, %llu digests (%llu demos read again), %u pending, "
+             "slowest %.1f us\n",
+             (unsigned long long)stats.built,
+             (unsigned long long)stats.incomplete,
+             (unsigned long long)stats.failed,
+             (unsigned long long)stats.digests,
+             (unsigned long long)stats.digestReads,
+             stats.pending,
+             (double)stats.maxBuildTime / 1000.0);
+    out += line;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "demo_index.h"
+#include "session_digest.h"
+
+// How often a demo that doesn't end in a stop message yet is looked at again, and for how long
+#define DEMO_INDEXER_RETRY_MS 250
+#define DEMO_INDEXER_MAX_ATTEMPTS 40
+
+struct DemoIndexerStats_t
+{
+    uint64_t built;
+
+    // Never reached its stop message in time, indexed up to where it ended anyway
+    uint64_t incomplete;
+
+    // Demo missing or not a demo, or the index could not be written
+    uint64_t failed;
+
+    // Session digests written, and demos they had to read again because they weren't indexed since the last one
+    uint64_t digests;
+    uint64_t digestReads;
+
+    uint32_t pending;
+    uint64_t maxBuildTime;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: background thread that writes the .dmi of every demo the plugin stopped. The engine only finishes the file
+// once it runs the queued stop command, so a demo is retried until it ends in a stop message. The block CRCs of the
+// session digest are taken while the demo is mapped for its index, so sealing a session rarely reads a demo again.
+//
+// Relative paths are resolved against the root passed to Start, like CAsyncFileWriter.
+//---------------------------------------------------------------------------------
+class CDemoIndexer
+{
+    public:
+    CDemoIndexer();
+    ~CDemoIndexer();
+
+    void Start(const char* rootDir, uint32_t stride = DEMO_INDEX_DEFAULT_STRIDE);
+
+    // Gives every pending demo one last try and joins the thread
+    void Shutdown();
+
+    bool IsRunning() const
+    {
+        return m_Thread.joinable();
+    }
+
+    void Queue(const char* demoPath);
+
+    // Writes the digest of every demo in sessionDir once the demos queued before it are done with. An empty key seals
+    // with SHA-256.
+    void QueueSessionDigest(const char* sessionDir, const char* key);
+
+    // Blocks until nothing is pending, for tests and tools
+    void WaitIdle();
+
+    void GetStats(DemoIndexerStats_t& stats) const;
+    void FormatTable(std::string& out) const;
+
+    private:
+    CDemoIndexer(const CDemoIndexer&);
+    CDemoIndexer& operator=(const CDemoIndexer&);
+
+    struct PendingDemo_t
+    {
+        std::string path;
+        int attempts;
+
+        // A session digest for the directory in path rather than a demo
+        bool bDigest;
+        std::string key;
+    };
+
+    void ThreadMain();
+    std::string ResolvePath(const char* path) const;
+
+    // True once the demo is done with, indexed or given up on
+    bool TryIndex(PendingDemo_t& demo, bool lastTry);
+
+    // False while a demo of the session is still waiting in retry
+    bool TryWriteDigest(PendingDemo_t& session, bool lastTry, const std::vector<PendingDemo_t>& retry);
+
+    std::string m_RootDir;
+    uint32_t m_Stride;
+    std::thread m_Thread;
+
+    // Digest of every demo indexed since its session was sealed, by path. Only the thread touches it.
+    std::map<std::string, DemoDigest_t> m_Digests;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Idle;
+    std::vector<PendingDemo_t> m_Pending;
+    bool m_bStop;
+
+    // Queued and not done with yet, including the ones the thread is working on
+    std::atomic<uint32_t> m_PendingCount;
+
+    std::atomic<uint64_t> m_Built;
+    std::atomic<uint64_t> m_Incomplete;
+    std::atomic<uint64_t> m_Failed;
+    std::atomic<uint64_t> m_DigestsWritten;
+    std::atomic<uint64_t> m_DigestReads;
+    std::atomic<uint64_t> m_MaxBuildTime;
+};
@@ -0,0 +1,91 @@
+#include "demo_name_index.h"
+
+#include <ctype.h>
+#include <string.h>
+
+// Windows file names are case insensitive, so are the keys
+static std::string NormalizeMapName(const char* name, size_t length)
+{
+    std::string key(name, length);
+    for (size_t i = 0; i < key.size(); i++)
+    {
+        key[i] = (char)tolower((unsigned char)key[i]);
+    }
+    return key;
+}
+
+void CDemoNameIndex::Clear()
+{
+    m_NextRetry.clear();
+}
+
+void CDemoNameIndex::AddExistingDemo(const char* fileName)
+{
+    if (!fileName)
+        return;
+
+    size_t length = strlen(fileName);
+    static const char s_Extension[] = ".dem";
+    const size_t extensionLength = sizeof(s_Extension) - 1;
+
+    bool hasExtension = length > extensionLength;
+    for (size_t i = 0; hasExtension && i < extensionLength; i++)
+    {
+        hasExtension = tolower((unsigned char)fileName[length - extensionLength + i]) == s_Extension[i];
+    }
+
+    if (hasExtension)
+    {
+        length -= extensionLength;
+    }
+    else if (strchr(fileName, '.'))
+    {
+        return;
+    }
+
+    if (length == 0)
+        return;
+
+    // The stem itself is always a map that has at least one demo
+    Bump(NormalizeMapName(fileName, length), 1);
+
+    // <map>_<n>: n must look exactly like the "%d" the plugin writes
+    size_t underscore = length;
+    while (underscore > 0 && fileName[underscore - 1] != '_')
+    {
+        underscore--;
+    }
+    if (underscore < 2 || underscore == length || fileName[underscore] == '0')
+        return;
+
+    int retry = 0;
+    for (size_t i = underscore; i < length; i++)
+    {
+        if (!isdigit((unsigned char)fileName[i]) || retry > 100000000)
+            return;
+        retry = retry * 10 + (fileName[i] - '0');
+    }
+
+    Bump(NormalizeMapName(fileName, underscore - 1), retry + 1);
+}
+
+int CDemoNameIndex::GetNextRetry(const char* mapName) const
+{
+    std::unordered_map<std::string, int>::const_iterator it =
+        m_NextRetry.find(NormalizeMapName(mapName, strlen(mapName)));
+    return it == m_NextRetry.end() ? 0 : it->second;
+}
+
+void CDemoNameIndex::OnDemoRecorded(const char* mapName, int retry)
+{
+    Bump(NormalizeMapName(mapName, strlen(mapName)), retry + 1);
+}
+
+void CDemoNameIndex::Bump(const std::string& mapName, int nextRetry)
+{
+    int& stored = m_NextRetry[mapName];
+    if (stored < nextRetry)
+    {
+        stored = nextRetry;
+    }
+}
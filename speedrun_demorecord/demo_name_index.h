@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+//---------------------------------------------------------------------------------
+// Purpose: per-session map name -> next retry number. Built once from the demos already in the session directory
+// and then kept up to date as the plugin records, so picking a demo name never touches the filesystem.
+//
+// "d1_canals_06.dem" is retry 0 and "d1_canals_06_3.dem" is retry 3 of d1_canals_06. Only a canonical "_<n>" suffix
+// (n >= 1, no leading zeros, the way the plugin formats it) is treated as a retry, so the "_06" in d1_canals_06 is
+// never mistaken for one and d1_canals_060 does not count towards d1_canals_06.
+//---------------------------------------------------------------------------------
+class CDemoNameIndex
+{
+    public:
+    void Clear();
+
+    // Registers a demo found on disk, with or without the .dem extension. Anything else is ignored.
+    void AddExistingDemo(const char* fileName);
+
+    // Retry number the next demo of this map should be recorded with, 0 if there is no demo for it yet
+    int GetNextRetry(const char* mapName) const;
+
+    // Keeps the index in sync with a record command issued for mapName
+    void OnDemoRecorded(const char* mapName, int retry);
+
+    size_t GetMapCount() const
+    {
+        return m_NextRetry.size();
+    }
+
+    private:
+    void Bump(const std::string& mapName, int nextRetry);
+
+    std::unordered_map<std::string, int> m_NextRetry;
+};
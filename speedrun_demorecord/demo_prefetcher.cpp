@@ -0,0 +1,310 @@
+#include "demo_prefetcher.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef __linux__
+#include <fcntl.h>
+#endif
+
+static bool IsPathSeparator(char c)
+{
+    return c == '/' || c == '\\';
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: constructor/destructor
+//---------------------------------------------------------------------------------
+CDemoPrefetcher::CDemoPrefetcher()
+    : m_Depth(DEMO_PREFETCH_DEFAULT_DEPTH),
+      m_EndTime(0),
+      m_Started(0),
+      m_Generation(0),
+      m_bReading(false),
+      m_bStop(false),
+      m_BytesRead(0),
+      m_Failed(0)
+{
+    memset(m_Outcomes, 0, sizeof(m_Outcomes));
+}
+
+CDemoPrefetcher::~CDemoPrefetcher()
+{
+    Shutdown();
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: thread control
+//---------------------------------------------------------------------------------
+void CDemoPrefetcher::Start(const char* rootDir)
+{
+    if (IsRunning())
+        return;
+
+    m_RootDir = rootDir ? rootDir : "";
+    if (!m_RootDir.empty() && !IsPathSeparator(m_RootDir[m_RootDir.size() - 1]))
+    {
+        m_RootDir += '/';
+    }
+
+    m_bStop = false;
+    m_Thread = std::thread(&CDemoPrefetcher::ThreadMain, this);
+}
+
+void CDemoPrefetcher::Shutdown()
+{
+    if (!IsRunning())
+        return;
+
+    {
+        // A demo being read is abandoned at its next chunk
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStop = true;
+        m_Generation++;
+        m_Queue.clear();
+        m_Wake.notify_one();
+    }
+    m_Thread.join();
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: playback, game thread
+//---------------------------------------------------------------------------------
+void CDemoPrefetcher::SetPlaylist(const std::vector<std::string>& demoPaths, uint32_t depth)
+{
+    m_Playlist = demoPaths;
+    m_Depth = depth;
+    m_EndTime = 0;
+    m_Started = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Generation++;
+        m_Queue.clear();
+        m_States.assign(demoPaths.size(), PREFETCH_STATE_NONE);
+        m_Paths.resize(demoPaths.size());
+        for (size_t i = 0; i < demoPaths.size(); i++)
+        {
+            m_Paths[i] = demoPaths[i];
+            if (!m_Paths[i].empty() && !IsPathSeparator(m_Paths[i][0]) && m_Paths[i].find(':') == std::string::npos)
+            {
+                m_Paths[i] = m_RootDir + m_Paths[i];
+            }
+        }
+    }
+
+    // The first demo is being loaded by the engine right now, the ones after it aren't
+    QueueAhead(0);
+}
+
+void CDemoPrefetcher::OnDemoEnded()
+{
+    // LevelShutdown can come more than once per demo, the gap starts at the first
+    if (m_Started > 0 && m_EndTime == 0)
+    {
+        m_EndTime = LatencyNow();
+    }
+}
+
+bool CDemoPrefetcher::OnDemoStarted()
+{
+    if (!IsActive())
+        return false;
+
+    const size_t index = m_Started;
+    PrefetchState state;
+    {
+        // Taken before m_Started moves on, which abandons the read of this demo if it is still going
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        state = m_States[index];
+        m_Started = index + 1;
+    }
+
+    if (index > 0)
+    {
+        const PrefetchOutcome outcome = state == PREFETCH_STATE_DONE
+                                            ? PREFETCH_HIT
+                                            : (state == PREFETCH_STATE_READING ? PREFETCH_PARTIAL : PREFETCH_MISS);
+        m_Outcomes[outcome]++;
+        if (m_EndTime != 0)
+        {
+            m_Gaps[outcome].Record(LatencyNow() - m_EndTime);
+        }
+    }
+    m_EndTime = 0;
+
+    QueueAhead(index);
+    return index + 1 == m_Playlist.size();
+}
+
+void CDemoPrefetcher::QueueAhead(size_t index)
+{
+    if (!IsRunning())
+        return;
+
+    const size_t end = std::min<size_t>(m_Playlist.size(), index + 1 + m_Depth);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (size_t i = index + 1; i < end; i++)
+    {
+        if (m_States[i] == PREFETCH_STATE_NONE)
+        {
+            m_States[i] = PREFETCH_STATE_QUEUED;
+            m_Queue.push_back(i);
+        }
+    }
+    m_Wake.notify_one();
+}
+
+void CDemoPrefetcher::WaitIdle()
+{
+    if (!IsRunning())
+        return;
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Idle.wait(lock, [this] { return m_Queue.empty() && !m_bReading; });
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: prefetch thread
+//---------------------------------------------------------------------------------
+void CDemoPrefetcher::ThreadMain()
+{
+    m_Buffer.resize(DEMO_PREFETCH_CHUNK_SIZE);
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (!m_bStop)
+    {
+        if (m_Queue.empty())
+        {
+            m_Idle.notify_all();
+            m_Wake.wait(lock);
+            continue;
+        }
+
+        const size_t index = m_Queue.front();
+        m_Queue.pop_front();
+
+        // Playback already got there, the engine reads it itself
+        if (index < m_Started)
+        {
+            m_States[index] = PREFETCH_STATE_NONE;
+            continue;
+        }
+
+        const uint32_t generation = m_Generation;
+        const std::string path = m_Paths[index];
+        m_States[index] = PREFETCH_STATE_READING;
+        m_bReading = true;
+        lock.unlock();
+
+        const PrefetchState state = ReadDemo(path, index, generation);
+
+        lock.lock();
+        m_bReading = false;
+        if (generation == m_Generation)
+        {
+            m_States[index] = state;
+        }
+    }
+    m_Idle.notify_all();
+}
+
+CDemoPrefetcher::PrefetchState CDemoPrefetcher::ReadDemo(const std::string& path, size_t index, uint32_t generation)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        m_Failed++;
+        return PREFETCH_STATE_FAILED;
+    }
+
+    // The chunks go straight into the buffer, nothing is kept, the point is the copy the OS keeps in its cache
+    setvbuf(file, NULL, _IONBF, 0);
+#ifdef __linux__
+    // Queues the whole file with the kernel right away, the reads below then mostly find it cached
+    posix_fadvise(fileno(file), 0, 0, POSIX_FADV_WILLNEED);
+#endif
+
+    PrefetchState state = PREFETCH_STATE_DONE;
+    for (;;)
+    {
+        if (generation != m_Generation || index < m_Started)
+        {
+            state = PREFETCH_STATE_NONE;
+            break;
+        }
+
+        const size_t read = fread(m_Buffer.data(), 1, m_Buffer.size(), file);
+        m_BytesRead += read;
+        if (read < m_Buffer.size())
+        {
+            if (ferror(file))
+            {
+                m_Failed++;
+                state = PREFETCH_STATE_FAILED;
+            }
+            break;
+        }
+    }
+    fclose(file);
+    return state;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: stats
+//---------------------------------------------------------------------------------
+void CDemoPrefetcher::GetStats(DemoPrefetchStats_t& stats) const
+{
+    memcpy(stats.outcomes, m_Outcomes, sizeof(stats.outcomes));
+    stats.bytesRead = m_BytesRead.load();
+    stats.failed = m_Failed.load();
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    stats.pending = (uint32_t)m_Queue.size() + (m_bReading ? 1 : 0);
+}
+
+void CDemoPrefetcher::FormatTable(std::string& out) const
+{
+    DemoPrefetchStats_t stats;
+    GetStats(stats);
+
+    uint32_t demos = 0;
+    for (int i = 0; i < PREFETCH_OUTCOME_COUNT; i++)
+    {
+        demos += stats.outcomes[i];
+    }
+
+    char line[256];
+    snprintf(line,
+             sizeof(line),
+             "prefetch: %u demo changes, %u hits (%.1f%%), %u partial, %u misses, %.1f MB read ahead, %u unreadable, "
+             "%u pending\n",
+             demos,
+             stats.outcomes[PREFETCH_HIT],
+             demos ? 100.0 * stats.outcomes[PREFETCH_HIT] / demos : 0.0,
+             stats.outcomes[PREFETCH_PARTIAL],
+             stats.outcomes[PREFETCH_MISS],
+             (double)stats.bytesRead / 1e6,
+             stats.failed,
+             stats.pending);
+    out += line;
+
+    static const char* const s_OutcomeNames[PREFETCH_OUTCOME_COUNT] = {"hit", "partial", "miss"};
+    for (int i = 0; i < PREFETCH_OUTCOME_COUNT; i++)
+    {
+        const CLatencyHistogram& gaps = m_Gaps[i];
+        if (gaps.GetCount() == 0)
+            continue;
+
+        snprintf(line,
+                 sizeof(line),
+                 "  gap after a %-8s %6llu  p50 %9.1f ms  p99 %9.1f ms  max %9.1f ms\n",
+                 s_OutcomeNames[i],
+                 (unsigned long long)gaps.GetCount(),
+                 (double)gaps.GetPercentile(50.0) / 1e6,
+                 (double)gaps.GetPercentile(99.0) / 1e6,
+                 (double)gaps.GetMax() / 1e6);
+        out += line;
+    }
+}
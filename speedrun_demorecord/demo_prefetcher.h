@@ -0,0 +1,144 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "latency_stats.h"
+
+// Bytes read per call, the read ahead of a demo that is no longer wanted stops within one of these
+#define DEMO_PREFETCH_CHUNK_SIZE (1024 * 1024)
+
+// Demos speedrun_playback reads ahead of the one playing by default
+#define DEMO_PREFETCH_DEFAULT_DEPTH 2
+
+// How far the read ahead of a demo had come when its playback started
+enum PrefetchOutcome
+{
+    // All of it was read, the engine's read comes from the OS cache
+    PREFETCH_HIT,
+
+    // Still being read
+    PREFETCH_PARTIAL,
+
+    // Not started, not wanted (depth 0) or the file couldn't be read
+    PREFETCH_MISS,
+
+    PREFETCH_OUTCOME_COUNT
+};
+
+struct DemoPrefetchStats_t
+{
+    // Demos of the chain that started after the one before them, by outcome
+    uint32_t outcomes[PREFETCH_OUTCOME_COUNT];
+
+    uint64_t bytesRead;
+    uint32_t failed;
+    uint32_t pending;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: reads the next demos of a playlist into the OS cache on a background thread while the current one plays,
+// so the engine's playdemo at the end of a .vdm doesn't wait on a cold read from a slow or network disk. Measures the
+// gap from the end of one demo to the start of the next, split by how much of the next demo was read ahead.
+//
+// The playlist and the On* calls belong to the game thread. Relative paths are resolved against the root passed to
+// Start, like CDemoIndexer.
+//---------------------------------------------------------------------------------
+class CDemoPrefetcher
+{
+    public:
+    CDemoPrefetcher();
+    ~CDemoPrefetcher();
+
+    void Start(const char* rootDir);
+
+    // Drops what is queued and joins the thread
+    void Shutdown();
+
+    bool IsRunning() const
+    {
+        return m_Thread.joinable();
+    }
+
+    // demoPaths in play order, the first one is about to be played. depth is how many demos ahead of the one playing
+    // are read, 0 only measures the gaps.
+    void SetPlaylist(const std::vector<std::string>& demoPaths, uint32_t depth = DEMO_PREFETCH_DEFAULT_DEPTH);
+
+    // Until the last demo of the playlist started
+    bool IsActive() const
+    {
+        return m_Started < m_Playlist.size();
+    }
+
+    // A demo of the playlist stopped playing
+    void OnDemoEnded();
+
+    // The next demo of the playlist started playing. Returns true for the last one.
+    bool OnDemoStarted();
+
+    // Blocks until nothing is queued or being read, for tests and tools
+    void WaitIdle();
+
+    void GetStats(DemoPrefetchStats_t& stats) const;
+    const CLatencyHistogram& GetGaps(PrefetchOutcome outcome) const
+    {
+        return m_Gaps[outcome];
+    }
+    void FormatTable(std::string& out) const;
+
+    private:
+    CDemoPrefetcher(const CDemoPrefetcher&);
+    CDemoPrefetcher& operator=(const CDemoPrefetcher&);
+
+    enum PrefetchState
+    {
+        PREFETCH_STATE_NONE,
+        PREFETCH_STATE_QUEUED,
+        PREFETCH_STATE_READING,
+        PREFETCH_STATE_DONE,
+        PREFETCH_STATE_FAILED,
+    };
+
+    void ThreadMain();
+
+    // Queues the depth demos after index that weren't queued yet
+    void QueueAhead(size_t index);
+
+    // PREFETCH_STATE_NONE if the demo stopped being wanted while it was read
+    PrefetchState ReadDemo(const std::string& path, size_t index, uint32_t generation);
+
+    std::string m_RootDir;
+    std::thread m_Thread;
+
+    // Game thread only
+    std::vector<std::string> m_Playlist;
+    uint32_t m_Depth;
+    uint64_t m_EndTime;
+    CLatencyHistogram m_Gaps[PREFETCH_OUTCOME_COUNT];
+    uint32_t m_Outcomes[PREFETCH_OUTCOME_COUNT];
+
+    // Demos of the playlist that started, the one playing is m_Started - 1. The read ahead of any of them stops.
+    std::atomic<size_t> m_Started;
+
+    // Bumped by SetPlaylist, the thread drops work of an older playlist
+    std::atomic<uint32_t> m_Generation;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Idle;
+    std::vector<PrefetchState> m_States;
+    std::vector<std::string> m_Paths;
+    std::deque<size_t> m_Queue;
+    bool m_bReading;
+    bool m_bStop;
+
+    std::vector<uint8_t> m_Buffer;
+    std::atomic<uint64_t> m_BytesRead;
+    std::atomic<uint32_t> m_Failed;
+};
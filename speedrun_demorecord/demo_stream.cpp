@@ -0,0 +1,147 @@
+#include "demo_stream.h"
+
+#include <string.h>
+
+static bool GetStreamSize(FILE* file, uint64_t& size)
+{
+#ifdef _WIN32
+    if (_fseeki64(file, 0, SEEK_END) != 0)
+        return false;
+    const __int64 end = _ftelli64(file);
+#else
+    if (fseeko(file, 0, SEEK_END) != 0)
+        return false;
+    const off_t end = ftello(file);
+#endif
+    size = end > 0 ? (uint64_t)end : 0;
+    return end >= 0 && fseek(file, 0, SEEK_SET) == 0;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: constructor/destructor
+//---------------------------------------------------------------------------------
+CDemoStreamReader::CDemoStreamReader(size_t bufferSize)
+    : m_pFile(NULL),
+      m_FileSize(0),
+      m_Buffer(bufferSize > 0 ? bufferSize : 1),
+      m_BufferOffset(0),
+      m_Filled(0),
+      m_Pos(0),
+      m_LastPos(0),
+      m_bEof(false),
+      m_Error(DEMERR_NONE),
+      m_bReachedStop(false)
+{
+    memset(&m_Header, 0, sizeof(m_Header));
+}
+
+CDemoStreamReader::~CDemoStreamReader()
+{
+    Close();
+}
+
+DemoError CDemoStreamReader::Open(const char* path)
+{
+    Close();
+
+    m_pFile = fopen(path, "rb");
+    if (!m_pFile || !GetStreamSize(m_pFile, m_FileSize))
+        return m_Error = DEMERR_OPEN;
+
+    uint8_t header[DEMO_HEADER_SIZE];
+    const size_t read = fread(header, 1, sizeof(header), m_pFile);
+    m_Error = ValidateDemoHeader(header, read);
+    if (m_Error != DEMERR_NONE)
+        return m_Error;
+
+    memcpy(&m_Header, header, sizeof(m_Header));
+    m_BufferOffset = DEMO_HEADER_SIZE;
+    return DEMERR_NONE;
+}
+
+void CDemoStreamReader::Close()
+{
+    if (m_pFile)
+    {
+        fclose(m_pFile);
+        m_pFile = NULL;
+    }
+    m_FileSize = 0;
+    memset(&m_Header, 0, sizeof(m_Header));
+    m_BufferOffset = 0;
+    m_Filled = 0;
+    m_Pos = 0;
+    m_LastPos = 0;
+    m_bEof = false;
+    m_Error = DEMERR_NONE;
+    m_bReachedStop = false;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: moves the unread bytes to the front and reads more after them, false at the end of the file
+//---------------------------------------------------------------------------------
+bool CDemoStreamReader::Refill()
+{
+    if (m_bEof)
+        return false;
+
+    if (m_Pos > 0)
+    {
+        memmove(m_Buffer.data(), m_Buffer.data() + m_Pos, m_Filled - m_Pos);
+        m_BufferOffset += m_Pos;
+        m_Filled -= m_Pos;
+        m_Pos = 0;
+    }
+    else if (m_Filled == m_Buffer.size())
+    {
+        // A message bigger than the window
+        m_Buffer.resize(m_Buffer.size() * 2);
+    }
+
+    const size_t read = fread(m_Buffer.data() + m_Filled, 1, m_Buffer.size() - m_Filled, m_pFile);
+    m_Filled += read;
+    m_bEof = read == 0;
+    return !m_bEof;
+}
+
+bool CDemoStreamReader::Next(DemoMessage_t& msg)
+{
+    if (!m_pFile || m_Error != DEMERR_NONE || m_bReachedStop)
+        return false;
+
+    for (;;)
+    {
+        // The same parser as for mapped demos, a message cut by the end of the window comes back as truncated
+        CDemoMessageReader reader(m_Buffer.data() + m_Pos, m_Filled - m_Pos, 0);
+        const bool bParsed = reader.Next(msg);
+
+        // A stop message cut short may just need the rest of its tick
+        const bool bComplete = bParsed && (msg.type != DEM_STOP || msg.size == DEMO_MSG_HEADER_SIZE || m_bEof);
+        if (bComplete)
+        {
+            msg.offset = m_BufferOffset + m_Pos;
+            m_LastPos = m_Pos;
+            m_Pos += (size_t)msg.size;
+            m_bReachedStop = msg.type == DEM_STOP;
+            return true;
+        }
+
+        if (!bParsed && reader.GetError() != DEMERR_TRUNCATED)
+        {
+            m_Error = reader.GetError();
+            return false;
+        }
+
+        if (!Refill() && m_Pos == m_Filled)
+        {
+            m_Error = DEMERR_TRUNCATED;
+            return false;
+        }
+        if (m_bEof && !bParsed && m_Pos < m_Filled)
+        {
+            // Nothing more to read and still not a whole message
+            m_Error = DEMERR_TRUNCATED;
+            return false;
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "demo_file.h"
+
+// Read window of CDemoStreamReader. It only grows past this for a message that doesn't fit.
+#define DEMO_STREAM_BUFFER_SIZE (1024 * 1024)
+
+//---------------------------------------------------------------------------------
+// Purpose: reads the messages of a demo of any size through a fixed window instead of mapping it whole. Memory use is
+// the window, or twice the largest message if that is bigger.
+//---------------------------------------------------------------------------------
+class CDemoStreamReader
+{
+    public:
+    explicit CDemoStreamReader(size_t bufferSize = DEMO_STREAM_BUFFER_SIZE);
+    ~CDemoStreamReader();
+
+    // Reads and validates the header
+    DemoError Open(const char* path);
+    void Close();
+
+    const demoheader_t& GetHeader() const
+    {
+        return m_Header;
+    }
+
+    // Same as CDemoMessageReader::Next, msg.offset is the offset in the file. The pointers in msg stay valid until
+    // the next call.
+    bool Next(DemoMessage_t& msg);
+
+    DemoError GetError() const
+    {
+        return m_Error;
+    }
+    bool ReachedStop() const
+    {
+        return m_bReachedStop;
+    }
+
+    // Raw bytes of the message Next returned last, msg.size of them
+    const uint8_t* GetMessageBytes() const
+    {
+        return m_Buffer.data() + m_LastPos;
+    }
+
+    // File offset of the next message, of the broken one after an error
+    uint64_t GetOffset() const
+    {
+        return m_BufferOffset + m_Pos;
+    }
+
+    uint64_t GetFileSize() const
+    {
+        return m_FileSize;
+    }
+    size_t GetBufferSize() const
+    {
+        return m_Buffer.size();
+    }
+
+    private:
+    CDemoStreamReader(const CDemoStreamReader&);
+    CDemoStreamReader& operator=(const CDemoStreamReader&);
+
+    bool Refill();
+
+    FILE* m_pFile;
+    uint64_t m_FileSize;
+    demoheader_t m_Header;
+    std::vector<uint8_t> m_Buffer;
+
+    // File offset of m_Buffer[0], bytes of m_Buffer in use, start of the next message in m_Buffer
+    uint64_t m_BufferOffset;
+    size_t m_Filled;
+    size_t m_Pos;
+    size_t m_LastPos;
+
+    bool m_bEof;
+    DemoError m_Error;
+    bool m_bReachedStop;
+};
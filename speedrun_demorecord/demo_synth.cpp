@@ -0,0 +1,517 @@
+#include "demo_synth.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "file_list.h"
+#include "session_journal.h"
+#include "usercmd_decoder.h"
+
+// Bytes the file writer collects before each fwrite
+#define SYNTH_WRITE_CHUNK (1 << 20)
+
+// Packet payloads are slices of this much per demo noise, partly overwritten, which compresses about like real ones
+#define SYNTH_POOL_SIZE (64 * 1024)
+
+// Console commands a player's binds put in a demo
+static const char* const s_ConsoleCommands[] = {
+    "+jump", "-jump", "+duck", "-duck", "+use", "-use", "+attack", "-attack", "impulse 100", "save quick",
+};
+
+// Maps of a synthetic run, in order
+static const char* const s_MapNames[] = {
+    "d1_trainstation_01", "d1_trainstation_02", "d1_trainstation_03", "d1_trainstation_04", "d1_trainstation_05",
+    "d1_trainstation_06", "d1_canals_01",       "d1_canals_01a",      "d1_canals_02",       "d1_canals_03",
+    "d1_canals_05",       "d1_canals_06",       "d1_canals_07",       "d1_canals_08",       "d1_canals_09",
+    "d1_canals_10",       "d1_canals_11",       "d1_canals_12",       "d1_canals_13",       "d1_eli_01",
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: splitmix64, the same sequence everywhere
+//---------------------------------------------------------------------------------
+class CSynthRandom
+{
+    public:
+    explicit CSynthRandom(uint64_t seed) : m_State(seed) {}
+
+    uint64_t Next()
+    {
+        uint64_t z = (m_State += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // [0, count)
+    uint32_t Below(uint32_t count)
+    {
+        return count > 0 ? (uint32_t)(Next() % count) : 0;
+    }
+
+    private:
+    uint64_t m_State;
+};
+
+// FNV-1a, mixes names into seeds
+static uint64_t HashName(uint64_t seed, const std::string& name)
+{
+    uint64_t hash = 0xCBF29CE484222325ull ^ seed;
+    for (size_t i = 0; i < name.size(); i++)
+    {
+        hash = (hash ^ (uint8_t)name[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static void FillRandom(CSynthRandom& random, uint8_t* data, size_t size)
+{
+    for (size_t i = 0; i < size; i += 8)
+    {
+        const uint64_t value = random.Next();
+        memcpy(data + i, &value, size - i < 8 ? size - i : 8);
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: collects the demo and hands it to the file in chunks, or keeps all of it without a file
+//---------------------------------------------------------------------------------
+class CSynthSink
+{
+    public:
+    CSynthSink(FILE* fp, std::vector<uint8_t>& bytes) : m_pFile(fp), m_Bytes(bytes), m_Written(0), m_bFailed(false) {}
+
+    uint8_t* Grow(size_t size)
+    {
+        const size_t offset = m_Bytes.size();
+        m_Bytes.resize(offset + size);
+        return m_Bytes.data() + offset;
+    }
+
+    void Append(const void* data, size_t size)
+    {
+        memcpy(Grow(size), data, size);
+    }
+
+    // Everything appended so far can go, nothing before it will change
+    void Flush(bool bForce)
+    {
+        if (!m_pFile || m_Bytes.empty() || (!bForce && m_Bytes.size() < SYNTH_WRITE_CHUNK))
+            return;
+
+        m_bFailed = m_bFailed || fwrite(m_Bytes.data(), 1, m_Bytes.size(), m_pFile) != m_Bytes.size();
+        m_Written += m_Bytes.size();
+        m_Bytes.clear();
+    }
+
+    // Bytes so far, written or not
+    uint64_t GetSize() const
+    {
+        return m_Written + m_Bytes.size();
+    }
+
+    // Only before the first flush
+    uint8_t* GetData()
+    {
+        return m_Bytes.data();
+    }
+
+    bool HasFailed() const
+    {
+        return m_bFailed;
+    }
+
+    private:
+    FILE* m_pFile;
+    std::vector<uint8_t>& m_Bytes;
+    uint64_t m_Written;
+    bool m_bFailed;
+
+    CSynthSink(const CSynthSink&);
+    CSynthSink& operator=(const CSynthSink&);
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: the demo itself
+//---------------------------------------------------------------------------------
+class CSynthDemoWriter
+{
+    public:
+    CSynthDemoWriter(const SynthDemoOptions_t& options, CSynthSink& sink, SynthDemoResult_t& result)
+        : m_Options(options),
+          m_Sink(sink),
+          m_Result(result),
+          m_Random(HashName(options.seed ^ (options.variant * 0x9E3779B97F4A7C15ull), options.mapName))
+    {
+        memset(&m_Result, 0, sizeof(m_Result));
+        m_Pool.resize(SYNTH_POOL_SIZE);
+        FillRandom(m_Random, m_Pool.data(), m_Pool.size());
+    }
+
+    void Write()
+    {
+        const int32_t lead = m_Options.leadTicks > 0 ? m_Options.leadTicks : 0;
+        const int32_t ticks = m_Options.ticks > 0 ? m_Options.ticks : 0;
+        const int32_t tail = m_Options.tailTicks > 0 ? m_Options.tailTicks : 0;
+        const int32_t lastTick = lead + ticks + tail;
+        const uint32_t packetBytes = m_Options.packetBytes > 0 ? m_Options.packetBytes : 1;
+
+        m_Sink.Grow(sizeof(demoheader_t));
+        WriteSignon();
+        const uint64_t signonLength = m_Sink.GetSize() - sizeof(demoheader_t);
+        Message(DEM_SYNCTICK, 0);
+
+        // Nothing is written yet, the header can still be filled in
+        demoheader_t header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.demofilestamp, DEMO_HEADER_ID, sizeof(DEMO_HEADER_ID));
+        header.demoprotocol = 3;
+        header.networkprotocol = 24;
+        snprintf(header.servername, sizeof(header.servername), "localhost:27015");
+        snprintf(header.clientname, sizeof(header.clientname), "speedrunner");
+        snprintf(header.mapname, sizeof(header.mapname), "%s", m_Options.mapName.c_str());
+        snprintf(header.gamedirectory, sizeof(header.gamedirectory), "%s", m_Options.gameDir.c_str());
+        header.playback_time = (float)lastTick * 0.015f;
+        header.playback_ticks = lastTick;
+        header.playback_frames = lastTick + 1;
+        header.signonlength = (int32_t)signonLength;
+        memcpy(m_Sink.GetData(), &header, sizeof(header));
+
+        // Loading, the server sends the world before the player can move
+        for (int32_t tick = 1; tick <= lead; tick++)
+        {
+            Packet(tick, packetBytes * 2 + m_Random.Below(packetBytes));
+        }
+
+        UserCmd_t cmd;
+        memset(&cmd, 0, sizeof(cmd));
+        for (int32_t i = 0; i < ticks; i++)
+        {
+            const int32_t tick = lead + 1 + i;
+
+            uint32_t size = packetBytes / 2 + m_Random.Below(packetBytes + 1);
+            if (i == 0)
+            {
+                // The first full entity update
+                size = packetBytes * 32;
+            }
+            else if (m_Random.Below(64) == 0)
+            {
+                size *= 4 + m_Random.Below(12);
+            }
+            Packet(tick, size);
+
+            if (m_Random.Below(600) == 0)
+            {
+                const uint32_t commandCount = (uint32_t)(sizeof(s_ConsoleCommands) / sizeof(s_ConsoleCommands[0]));
+                const char* command = s_ConsoleCommands[m_Random.Below(commandCount)];
+                Message(DEM_CONSOLECMD, tick, command, strlen(command) + 1);
+            }
+
+            UserCmd(tick, i, cmd);
+            m_Sink.Flush(false);
+        }
+
+        // The engine keeps writing until the stop command runs
+        for (int32_t tick = lead + ticks + 1; tick <= lastTick; tick++)
+        {
+            Packet(tick, packetBytes / 2 + m_Random.Below(packetBytes + 1));
+        }
+
+        Message(DEM_STOP, lastTick);
+        m_Sink.Flush(true);
+
+        m_Result.bytes = m_Sink.GetSize();
+        m_Result.lastTick = lastTick;
+    }
+
+    private:
+    void WriteSignon()
+    {
+        // Signon and stringtables depend on the map, datatables on the game only, like in real demos
+        CSynthRandom mapRandom(HashName(m_Options.seed ^ 0x5349474Eull, m_Options.mapName));
+        CSynthRandom gameRandom(HashName(m_Options.seed ^ 0x44415441ull, m_Options.gameDir));
+
+        for (int i = 0; i < 3; i++)
+        {
+            Random(DEM_SIGNON, 0, mapRandom, 20000 + mapRandom.Below(30000));
+        }
+        Random(DEM_DATATABLES, 0, gameRandom, 150000 + gameRandom.Below(50000));
+        Random(DEM_STRINGTABLES, 0, mapRandom, 40000 + mapRandom.Below(60000));
+    }
+
+    uint8_t* Message(DemoMessageType type, int32_t tick, const void* data = NULL, size_t size = 0)
+    {
+        m_Result.messageCounts[type]++;
+
+        const uint8_t command = (uint8_t)type;
+        m_Sink.Append(&command, 1);
+        m_Sink.Append(&tick, sizeof(tick));
+        if (type == DEM_SYNCTICK || type == DEM_STOP)
+            return NULL;
+
+        if (type == DEM_SIGNON || type == DEM_PACKET)
+        {
+            uint8_t* cmdInfo = m_Sink.Grow(DEMO_CMDINFO_SIZE);
+            memset(cmdInfo, 0, DEMO_CMDINFO_SIZE);
+        }
+        else if (type == DEM_USERCMD)
+        {
+            // Outgoing sequence, one per tick
+            m_Sink.Append(&tick, sizeof(tick));
+        }
+
+        const int32_t length = (int32_t)size;
+        m_Sink.Append(&length, sizeof(length));
+        uint8_t* payload = m_Sink.Grow(size);
+        if (data)
+        {
+            memcpy(payload, data, size);
+        }
+        return payload;
+    }
+
+    void Random(DemoMessageType type, int32_t tick, CSynthRandom& random, uint32_t size)
+    {
+        FillRandom(random, Message(type, tick, NULL, size), size);
+    }
+
+    void Packet(int32_t tick, uint32_t size)
+    {
+        uint8_t* payload = Message(DEM_PACKET, tick, NULL, size);
+
+        // A slice of the pool with a quarter of its words replaced, entity deltas repeat a lot but never exactly
+        for (uint32_t done = 0; done < size;)
+        {
+            const uint32_t offset = m_Random.Below(SYNTH_POOL_SIZE - 64);
+            uint32_t count = size - done < SYNTH_POOL_SIZE - offset ? size - done : SYNTH_POOL_SIZE - offset;
+            memcpy(payload + done, m_Pool.data() + offset, count);
+            done += count;
+        }
+        for (uint32_t i = 0; i + 8 <= size; i += 8)
+        {
+            const uint64_t value = m_Random.Next();
+            if ((value & 3) == 0)
+            {
+                memcpy(payload + i, &value, 8);
+            }
+        }
+    }
+
+    void UserCmd(int32_t tick, int32_t index, UserCmd_t& cmd)
+    {
+        // The view turns every tick, movement and buttons change every few ticks, weapon switches are rare
+        const uint64_t value = m_Random.Next();
+        cmd.commandNumber = index + 1;
+        cmd.tickCount = tick + 40;
+        cmd.viewAngles[0] = (float)(value % 1780) / 20.0f - 89.0f;
+        cmd.viewAngles[1] = (float)(value >> 16 & 0xFFFF) * (360.0f / 65536.0f);
+        if (index % 8 == 0)
+        {
+            cmd.forwardMove = (value >> 32 & 1) ? 400.0f : 0.0f;
+            cmd.sideMove = (value >> 33 & 1) ? -400.0f : 0.0f;
+            cmd.buttons = (uint32_t)(value >> 40) & 0x27;
+        }
+        cmd.weaponSelect = (uint16_t)((value >> 48) % 500 == 0 ? 1 + (value >> 56) % 20 : 0);
+        cmd.mouseDx = (int16_t)((int)(value >> 24 & 31) - 16);
+        cmd.mouseDy = (int16_t)((int)(value >> 29 & 15) - 8);
+
+        m_Writer = CBitWriter();
+        EncodeUserCmd(cmd, m_Writer);
+        Message(DEM_USERCMD, tick, m_Writer.GetBytes().data(), m_Writer.GetBytes().size());
+    }
+
+    const SynthDemoOptions_t& m_Options;
+    CSynthSink& m_Sink;
+    SynthDemoResult_t& m_Result;
+    CSynthRandom m_Random;
+    std::vector<uint8_t> m_Pool;
+    CBitWriter m_Writer;
+
+    CSynthDemoWriter(const CSynthDemoWriter&);
+    CSynthDemoWriter& operator=(const CSynthDemoWriter&);
+};
+
+bool WriteSynthDemo(const char* path, const SynthDemoOptions_t& options, SynthDemoResult_t& result)
+{
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+        return false;
+
+    std::vector<uint8_t> buffer;
+    buffer.reserve(SYNTH_WRITE_CHUNK + 64 * 1024);
+    CSynthSink sink(fp, buffer);
+    CSynthDemoWriter writer(options, sink, result);
+    writer.Write();
+
+    const bool bClosed = fclose(fp) == 0;
+    return bClosed && !sink.HasFailed();
+}
+
+void BuildSynthDemo(const SynthDemoOptions_t& options, std::vector<uint8_t>& bytes, SynthDemoResult_t& result)
+{
+    bytes.clear();
+    CSynthSink sink(NULL, bytes);
+    CSynthDemoWriter writer(options, sink, result);
+    writer.Write();
+}
+
+int32_t GetSynthTicksForBytes(const SynthDemoOptions_t& options, uint64_t bytes)
+{
+    // Measured rather than worked out, so it stays right whatever the mix is
+    const int32_t sampleTicks = 4096;
+    SynthDemoOptions_t sample = options;
+    std::vector<uint8_t> demo;
+    SynthDemoResult_t result;
+
+    sample.ticks = 0;
+    BuildSynthDemo(sample, demo, result);
+    const uint64_t fixedBytes = result.bytes;
+
+    sample.ticks = sampleTicks;
+    BuildSynthDemo(sample, demo, result);
+    const uint64_t tickBytes = (result.bytes - fixedBytes) / (uint64_t)sampleTicks;
+
+    if (bytes <= fixedBytes || tickBytes == 0)
+        return 0;
+    const uint64_t ticks = (bytes - fixedBytes) / tickBytes;
+    return ticks > 0x7FFFFFF0ull ? 0x7FFFFFF0 : (int32_t)ticks;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: sessions
+//---------------------------------------------------------------------------------
+
+// "YYYY.MM.DD-hh.mm.ss" of a unix time in UTC, without gmtime so it is the same everywhere
+static std::string FormatSessionTime(int64_t unixTime)
+{
+    int64_t days = unixTime / 86400;
+    int64_t seconds = unixTime % 86400;
+    if (seconds < 0)
+    {
+        seconds += 86400;
+        days--;
+    }
+
+    // Civil from days, Howard Hinnant's algorithm
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t dayOfEra = days - era * 146097;
+    const int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const int64_t monthPart = (5 * dayOfYear + 2) / 153;
+    const int64_t day = dayOfYear - (153 * monthPart + 2) / 5 + 1;
+    const int64_t month = monthPart < 10 ? monthPart + 3 : monthPart - 9;
+    const int64_t year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+    char text[32];
+    snprintf(text,
+             sizeof(text),
+             "%04d.%02d.%02d-%02d.%02d.%02d",
+             (int)year,
+             (int)month,
+             (int)day,
+             (int)(seconds / 3600),
+             (int)(seconds / 60 % 60),
+             (int)(seconds % 60));
+    return text;
+}
+
+bool WriteSynthSession(const char* baseDir, const SynthSessionOptions_t& options, SynthSessionResult_t& result)
+{
+    result.sessionDir = std::string(baseDir) + FormatSessionTime(options.startTime) + "/";
+    result.demos.clear();
+    result.bytes = 0;
+    if (!MakeDirectory(result.sessionDir))
+        return false;
+
+    CSynthRandom random(options.seed ^ (uint64_t)options.startTime);
+    std::string journal;
+    uint32_t sequence = 0;
+    int64_t wallClock = options.startTime;
+    int32_t serverTick = 0;
+
+    journalrecord_t record;
+    BuildJournalRecord(record, JOURNAL_START, sequence++, "", 0, "", wallClock, -1);
+    journal.append((const char*)&record, sizeof(record));
+
+    const size_t mapCount = sizeof(s_MapNames) / sizeof(s_MapNames[0]);
+    for (uint32_t map = 0; map < options.maps; map++)
+    {
+        std::string mapName = s_MapNames[map % mapCount];
+        if (map >= mapCount)
+        {
+            char suffix[16];
+            snprintf(suffix, sizeof(suffix), "_%u", map / (uint32_t)mapCount);
+            mapName += suffix;
+        }
+
+        // Deaths and reloads first, then the demo that made it to the next map
+        const uint32_t retries = random.Below(options.maxRetries + 1);
+        for (uint32_t retry = 0; retry <= retries; retry++)
+        {
+            char demoName[JOURNAL_DEMO_NAME_SIZE];
+            if (retry == 0)
+            {
+                snprintf(demoName, sizeof(demoName), "%s", mapName.c_str());
+            }
+            else
+            {
+                snprintf(demoName, sizeof(demoName), "%s_%u", mapName.c_str(), retry);
+            }
+
+            SynthDemoOptions_t demoOptions;
+            demoOptions.seed = options.seed;
+            demoOptions.variant = HashName((uint64_t)options.startTime, demoName);
+            demoOptions.ticks = options.ticks;
+            if (retry < retries)
+            {
+                const uint32_t spread = (uint32_t)(options.ticks > 4 ? options.ticks : 4);
+                demoOptions.ticks = (int32_t)(spread / 4 + random.Below(spread * 3 / 4));
+            }
+            demoOptions.packetBytes = options.packetBytes;
+            demoOptions.mapName = mapName;
+            demoOptions.gameDir = options.gameDir;
+
+            BuildJournalRecord(record,
+                               JOURNAL_RECORD,
+                               sequence++,
+                               mapName.c_str(),
+                               (int)retry,
+                               demoName,
+                               wallClock,
+                               serverTick);
+            journal.append((const char*)&record, sizeof(record));
+
+            const std::string path = result.sessionDir + demoName + ".dem";
+            SynthDemoResult_t demo;
+            if (!WriteSynthDemo(path.c_str(), demoOptions, demo))
+                return false;
+            result.demos.push_back(path);
+            result.bytes += demo.bytes;
+
+            // A few seconds of loading between demos
+            serverTick += demo.lastTick + 200;
+            wallClock += (int64_t)((double)demo.lastTick * 0.015) + 4;
+
+            BuildJournalRecord(record,
+                               JOURNAL_STOP,
+                               sequence++,
+                               mapName.c_str(),
+                               (int)retry,
+                               demoName,
+                               wallClock,
+                               demo.lastTick);
+            journal.append((const char*)&record, sizeof(record));
+        }
+    }
+
+    const std::string journalPath = result.sessionDir + JOURNAL_FILE_NAME;
+    FILE* fp = fopen(journalPath.c_str(), "wb");
+    if (!fp)
+        return false;
+    const bool bWritten = fwrite(journal.data(), 1, journal.size(), fp) == journal.size();
+    if (fclose(fp) != 0 || !bWritten)
+        return false;
+    result.bytes += journal.size();
+    return true;
+}
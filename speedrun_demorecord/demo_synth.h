@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "demo_file.h"
+
+// Deterministic synthetic demos for benchmarks and tests, so the tools can be measured without a game install. The
+// bytes aren't game data, but the layout is what the engine writes for a single player load: signon, datatables and
+// stringtables at tick 0, a sync tick, loading packets without input, then a packet and an encoded usercmd every tick
+// with the odd console command and entity update burst, a few tail packets and the stop message. The same options
+// always give the same bytes, on every platform.
+
+// Average packet payload of a tick, about what a 2013 engine map with a few NPCs records
+#define SYNTH_DEFAULT_PACKET_BYTES 220
+
+struct SynthDemoOptions_t
+{
+    SynthDemoOptions_t()
+        : seed(1), variant(0), ticks(4000), leadTicks(24), tailTicks(6), packetBytes(SYNTH_DEFAULT_PACKET_BYTES),
+          mapName("d1_canals_06"), gameDir("hl2")
+    {
+    }
+
+    uint64_t seed;
+
+    // Only changes the ticks, reloads of a map keep its signon data
+    uint64_t variant;
+
+    // Ticks with player input, and the loading and tail ticks around them
+    int32_t ticks;
+    int32_t leadTicks;
+    int32_t tailTicks;
+
+    // Average packet payload, bursts and the first full update are several times that
+    uint32_t packetBytes;
+
+    std::string mapName;
+
+    // Datatables only depend on the game and the seed, like real demos of one game share them
+    std::string gameDir;
+};
+
+struct SynthDemoResult_t
+{
+    uint64_t bytes;
+    int32_t lastTick;
+    uint32_t messageCounts[DEMO_MSG_TYPE_COUNT];
+};
+
+// Streams the demo to path in 1 MB writes, any tick count works without the demo ever being in memory
+bool WriteSynthDemo(const char* path, const SynthDemoOptions_t& options, SynthDemoResult_t& result);
+
+// The same bytes into memory
+void BuildSynthDemo(const SynthDemoOptions_t& options, std::vector<uint8_t>& bytes, SynthDemoResult_t& result);
+
+// Input ticks that make a demo of about that many bytes
+int32_t GetSynthTicksForBytes(const SynthDemoOptions_t& options, uint64_t bytes);
+
+struct SynthSessionOptions_t
+{
+    SynthSessionOptions_t()
+        : seed(1), startTime(1710428966), maps(8), maxRetries(3), ticks(4000),
+          packetBytes(SYNTH_DEFAULT_PACKET_BYTES), gameDir("hl2")
+    {
+    }
+
+    uint64_t seed;
+
+    // Unix time of speedrun_start, names the session dir
+    int64_t startTime;
+
+    // Maps of the run, each recorded once plus 0 to maxRetries reloads (<map>_1.dem, ...)
+    uint32_t maps;
+    uint32_t maxRetries;
+
+    // Input ticks of a map's final demo, reloads are cut short somewhere before
+    int32_t ticks;
+    uint32_t packetBytes;
+    std::string gameDir;
+};
+
+struct SynthSessionResult_t
+{
+    // "<baseDir><YYYY.MM.DD-hh.mm.ss>/"
+    std::string sessionDir;
+
+    // Demo paths in recording order
+    std::vector<std::string> demos;
+    uint64_t bytes;
+};
+
+// A session dir like speedrun_start leaves behind after speedrun_stop: every demo plus the journal. The dir name uses
+// UTC, the plugin's uses local time.
+bool WriteSynthSession(const char* baseDir, const SynthSessionOptions_t& options, SynthSessionResult_t& result);
@@ -0,0 +1,168 @@
+#include "demo_tail.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+// Size of the file, leaves the position at offset
+static bool SeekTail(FILE* file, uint64_t offset, uint64_t& size)
+{
+#ifdef _WIN32
+    if (_fseeki64(file, 0, SEEK_END) != 0)
+        return false;
+    const __int64 end = _ftelli64(file);
+    size = end > 0 ? (uint64_t)end : 0;
+    return end >= 0 && (offset > size || _fseeki64(file, (__int64)offset, SEEK_SET) == 0);
+#else
+    if (fseeko(file, 0, SEEK_END) != 0)
+        return false;
+    const off_t end = ftello(file);
+    size = end > 0 ? (uint64_t)end : 0;
+    return end >= 0 && (offset > size || fseeko(file, (off_t)offset, SEEK_SET) == 0);
+#endif
+}
+
+FileTailResult ReadFileTail(const char* path, uint64_t offset, size_t maxBytes, std::vector<uint8_t>& bytes)
+{
+    bytes.clear();
+
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return FILETAIL_MISSING;
+
+    uint64_t size;
+    FileTailResult result = FILETAIL_MISSING;
+    if (SeekTail(file, offset, size))
+    {
+        if (size < offset)
+        {
+            result = FILETAIL_SHRANK;
+        }
+        else
+        {
+            // The writer may be appending right now, whatever it adds after the size was taken is read next time
+            bytes.resize((size_t)std::min<uint64_t>(size - offset, maxBytes));
+            bytes.resize(fread(bytes.data(), 1, bytes.size(), file));
+            result = bytes.empty() ? FILETAIL_UNCHANGED : FILETAIL_GREW;
+        }
+    }
+    fclose(file);
+    return result;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: constructor
+//---------------------------------------------------------------------------------
+CDemoTail::CDemoTail()
+{
+    Reset();
+}
+
+void CDemoTail::Reset()
+{
+    m_Pending.clear();
+    m_PendingOffset = 0;
+    m_BytesFed = 0;
+    m_bHeaderRead = false;
+    m_StopBytesMissing = 0;
+    m_MapName.clear();
+
+    // What SummarizeDemo says about no bytes at all
+    memset(&m_Summary, 0, sizeof(m_Summary));
+    m_Summary.lastTick = -1;
+    m_Summary.error = DEMERR_TOO_SMALL;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: parsing
+//---------------------------------------------------------------------------------
+uint32_t CDemoTail::Feed(const uint8_t* data, size_t size)
+{
+    m_BytesFed += size;
+    if (m_StopBytesMissing != 0)
+    {
+        // The tick of a stop message that was cut off, SummarizeDemo counts it in once it is there
+        const uint32_t rest = (uint32_t)std::min<size_t>(size, m_StopBytesMissing);
+        m_StopBytesMissing -= rest;
+        m_Summary.messageBytes[DEM_STOP] += rest;
+        m_Summary.errorOffset += rest;
+        m_PendingOffset += rest;
+        return 0;
+    }
+    if (size == 0 || IsFinished())
+        return 0;
+
+    // Parse straight from the caller's bytes unless they continue a message that is pending
+    const uint8_t* p = data;
+    size_t available = size;
+    if (!m_Pending.empty())
+    {
+        m_Pending.insert(m_Pending.end(), data, data + size);
+        p = m_Pending.data();
+        available = m_Pending.size();
+    }
+
+    uint64_t start = 0;
+    if (!m_bHeaderRead)
+    {
+        m_Summary.error = ValidateDemoHeader(p, available);
+        if (m_Summary.error == DEMERR_TOO_SMALL)
+        {
+            if (p == data)
+            {
+                m_Pending.assign(data, data + size);
+            }
+            return 0;
+        }
+        if (m_Summary.error != DEMERR_NONE)
+        {
+            m_Pending.clear();
+            return 0;
+        }
+
+        demoheader_t header;
+        memcpy(&header, p, sizeof(header));
+        const char* end = (const char*)memchr(header.mapname, '\0', sizeof(header.mapname));
+        m_MapName.assign(header.mapname, end ? (size_t)(end - header.mapname) : sizeof(header.mapname));
+        m_bHeaderRead = true;
+        start = DEMO_HEADER_SIZE;
+    }
+
+    uint32_t count = 0;
+    CDemoMessageReader reader(p, available, start);
+    DemoMessage_t msg;
+    while (reader.Next(msg))
+    {
+        m_Summary.messageCounts[msg.type]++;
+        m_Summary.messageBytes[msg.type] += msg.size;
+        if (msg.type != DEM_STOP && msg.tick >= 0)
+        {
+            m_Summary.lastTick = msg.tick;
+        }
+        count++;
+    }
+
+    const size_t consumed = (size_t)reader.GetOffset();
+    m_Summary.reachedStop = reader.ReachedStop();
+    m_Summary.error = reader.GetError();
+    m_Summary.errorOffset = m_PendingOffset + consumed;
+    if (m_Summary.reachedStop)
+    {
+        m_StopBytesMissing = (uint32_t)(DEMO_MSG_HEADER_SIZE - msg.size);
+    }
+
+    if (IsFinished())
+    {
+        m_Pending.clear();
+    }
+    else if (p == data)
+    {
+        m_Pending.assign(data + consumed, data + size);
+    }
+    else
+    {
+        m_Pending.erase(m_Pending.begin(), m_Pending.begin() + (ptrdiff_t)consumed);
+    }
+    m_PendingOffset += consumed;
+    return count;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "demo_file.h"
+
+// Most bytes ReadFileTail hands out per call, a demo seen for the first time when it is already long is read in
+// pieces of this instead of all at once
+#define FILE_TAIL_READ_SIZE (1024 * 1024)
+
+enum FileTailResult
+{
+    FILETAIL_MISSING,
+    FILETAIL_UNCHANGED,
+    FILETAIL_GREW,
+
+    // The file is shorter than offset: it was rewritten (a segmented reload records over the same name), nothing was
+    // read and the caller starts again from 0
+    FILETAIL_SHRANK,
+};
+
+// Reads up to maxBytes of what follows offset in the file into bytes (replacing its contents). Earlier bytes are
+// never read again.
+FileTailResult ReadFileTail(const char* path, uint64_t offset, size_t maxBytes, std::vector<uint8_t>& bytes);
+
+//---------------------------------------------------------------------------------
+// Purpose: parses a demo that is still being written from the bytes appended to it. Every byte is fed once: whole
+// messages are counted as they arrive, the start of a message that isn't complete yet is kept until the bytes that
+// complete it are fed. After any Feed, GetSummary() is what SummarizeDemo() says about all the bytes fed so far.
+//---------------------------------------------------------------------------------
+class CDemoTail
+{
+    public:
+    CDemoTail();
+
+    // Back to an empty demo, for a file that was rewritten
+    void Reset();
+
+    // Returns how many messages the bytes completed
+    uint32_t Feed(const uint8_t* data, size_t size);
+
+    const DemoSummary_t& GetSummary() const
+    {
+        return m_Summary;
+    }
+
+    // From the header, empty until it is complete
+    const std::string& GetMapName() const
+    {
+        return m_MapName;
+    }
+    uint64_t GetBytesFed() const
+    {
+        return m_BytesFed;
+    }
+
+    // Bytes of the message that is cut off, waiting for the rest
+    size_t GetPendingBytes() const
+    {
+        return m_Pending.size();
+    }
+
+    // At the stop message or a corrupt message, anything fed after that is only counted in GetBytesFed()
+    bool IsFinished() const
+    {
+        return m_Summary.reachedStop || (m_Summary.error != DEMERR_NONE && m_Summary.error != DEMERR_TRUNCATED &&
+                                         m_Summary.error != DEMERR_TOO_SMALL);
+    }
+
+    // At a stop message that is all there, nothing else is ever written after it
+    bool IsComplete() const
+    {
+        return m_Summary.reachedStop && m_StopBytesMissing == 0;
+    }
+
+    private:
+    std::vector<uint8_t> m_Pending;
+
+    // File offset of m_Pending[0], or of the next byte fed when nothing is pending
+    uint64_t m_PendingOffset;
+    uint64_t m_BytesFed;
+    bool m_bHeaderRead;
+
+    // Bytes of the stop message's tick that weren't fed yet
+    uint32_t m_StopBytesMissing;
+
+    DemoSummary_t m_Summary;
+    std::string m_MapName;
+};
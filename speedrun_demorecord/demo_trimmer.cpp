@@ -0,0 +1,228 @@
+#include "demo_trimmer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "demo_stream.h"
+
+// Tick length for headers that don't say, 66.67 ticks per second
+#define TRIM_DEFAULT_TICK_INTERVAL 0.015
+
+// What the first pass finds out, the second one writes
+struct TrimPlan_t
+{
+    // Messages before the stop message or the first broken one
+    uint64_t messageCount;
+
+    // Positions of the first and last usercmd among them, messageCount if there is none
+    uint64_t firstUserCmd;
+    uint64_t lastUserCmd;
+    int32_t firstUserCmdTick;
+    int32_t lastUserCmdTick;
+
+    // Ticks of the packets and console commands before the first usercmd's tick, -1 if there are none
+    int32_t leadInFirstTick;
+    int32_t leadInLastTick;
+
+    int32_t lastTick;
+};
+
+static bool IsLeadInMessage(DemoMessageType type)
+{
+    return type == DEM_PACKET || type == DEM_CONSOLECMD || type == DEM_NOP;
+}
+
+static void PlanTrim(CDemoStreamReader& reader, TrimPlan_t& plan)
+{
+    plan.messageCount = 0;
+    plan.firstUserCmd = UINT64_MAX;
+    plan.lastUserCmd = UINT64_MAX;
+    plan.firstUserCmdTick = -1;
+    plan.lastUserCmdTick = -1;
+    plan.leadInFirstTick = -1;
+    plan.leadInLastTick = -1;
+    plan.lastTick = -1;
+
+    // Ticks of the lead-in candidates, only known to be lead-in once a usercmd follows. The packet of the first
+    // usercmd's own tick comes before it but is already play.
+    std::vector<int32_t> leadInTicks;
+
+    DemoMessage_t msg;
+    while (reader.Next(msg) && msg.type != DEM_STOP)
+    {
+        if (msg.type == DEM_USERCMD)
+        {
+            if (plan.firstUserCmd == UINT64_MAX)
+            {
+                plan.firstUserCmd = plan.messageCount;
+                plan.firstUserCmdTick = msg.tick;
+                for (size_t i = 0; i < leadInTicks.size(); i++)
+                {
+                    if (leadInTicks[i] >= msg.tick)
+                        continue;
+                    if (plan.leadInFirstTick < 0 || leadInTicks[i] < plan.leadInFirstTick)
+                    {
+                        plan.leadInFirstTick = leadInTicks[i];
+                    }
+                    if (leadInTicks[i] > plan.leadInLastTick)
+                    {
+                        plan.leadInLastTick = leadInTicks[i];
+                    }
+                }
+                leadInTicks.clear();
+            }
+            plan.lastUserCmd = plan.messageCount;
+            plan.lastUserCmdTick = msg.tick;
+        }
+        else if (plan.firstUserCmd == UINT64_MAX && IsLeadInMessage(msg.type) && msg.tick >= 0)
+        {
+            leadInTicks.push_back(msg.tick);
+        }
+
+        plan.lastTick = msg.tick > plan.lastTick ? msg.tick : plan.lastTick;
+        plan.messageCount++;
+    }
+
+    if (plan.firstUserCmd == UINT64_MAX)
+    {
+        plan.firstUserCmd = plan.messageCount;
+        plan.lastUserCmd = plan.messageCount;
+    }
+}
+
+static void WriteMessage(FILE* out, const uint8_t* bytes, uint64_t size, int32_t tick, uint64_t& written, bool& ok)
+{
+    uint8_t head[DEMO_MSG_HEADER_SIZE];
+    head[0] = bytes[0];
+    memcpy(head + 1, &tick, sizeof(tick));
+    ok = ok && fwrite(head, 1, sizeof(head), out) == sizeof(head);
+    ok = ok && fwrite(bytes + DEMO_MSG_HEADER_SIZE, 1, (size_t)(size - DEMO_MSG_HEADER_SIZE), out) ==
+                   (size_t)(size - DEMO_MSG_HEADER_SIZE);
+    written += size;
+}
+
+bool TrimDemo(const char* inputPath, const char* outputPath, const TrimOptions_t& options, TrimResult_t& result)
+{
+    memset(&result, 0, sizeof(result));
+    result.inputTicks = -1;
+    result.outputTicks = -1;
+
+    CDemoStreamReader reader;
+    result.error = reader.Open(inputPath);
+    if (result.error != DEMERR_NONE)
+        return false;
+    result.inputBytes = reader.GetFileSize();
+
+    TrimPlan_t plan;
+    PlanTrim(reader, plan);
+    result.error = reader.GetError();
+    result.inputTicks = plan.lastTick;
+
+    reader.Close();
+    if (reader.Open(inputPath) != DEMERR_NONE)
+        return false;
+
+    FILE* out = fopen(outputPath, "wb");
+    if (!out)
+        return false;
+    std::vector<char> outBuffer(DEMO_STREAM_BUFFER_SIZE);
+    setvbuf(out, outBuffer.data(), _IOFBF, outBuffer.size());
+
+    // Rewritten at the end
+    demoheader_t header = reader.GetHeader();
+    bool ok = fwrite(&header, 1, sizeof(header), out) == sizeof(header);
+    uint64_t written = sizeof(header);
+
+    // Time the lead-in no longer takes, every later tick moves back by it
+    const bool bHasLeadIn = plan.leadInFirstTick >= 0;
+    const int32_t shift = bHasLeadIn && options.leadIn != TRIM_KEEP ? plan.leadInLastTick - plan.leadInFirstTick : 0;
+
+    uint32_t packets = 0;
+    uint32_t droppedPackets = 0;
+    DemoMessage_t msg;
+    for (uint64_t index = 0; index < plan.messageCount && reader.Next(msg); index++)
+    {
+        const bool bLeadIn = bHasLeadIn && index < plan.firstUserCmd && IsLeadInMessage(msg.type) && msg.tick >= 0 &&
+                             msg.tick < plan.firstUserCmdTick;
+        const bool bTail = index > plan.lastUserCmd;
+        const TrimAction action = bLeadIn ? options.leadIn : (bTail ? options.tail : TRIM_KEEP);
+
+        if (action == TRIM_DROP)
+        {
+            result.droppedMessages++;
+            droppedPackets += msg.type == DEM_PACKET ? 1 : 0;
+            continue;
+        }
+
+        int32_t tick = msg.tick;
+        if (action == TRIM_COLLAPSE)
+        {
+            tick = bLeadIn ? plan.leadInFirstTick : plan.lastUserCmdTick - shift;
+            result.collapsedMessages++;
+        }
+        else if (shift > 0 && tick > plan.leadInFirstTick)
+        {
+            tick = tick - shift > plan.leadInFirstTick ? tick - shift : plan.leadInFirstTick;
+        }
+
+        WriteMessage(out, reader.GetMessageBytes(), msg.size, tick, written, ok);
+        packets += msg.type == DEM_PACKET ? 1 : 0;
+        result.outputTicks = tick > result.outputTicks ? tick : result.outputTicks;
+    }
+
+    // The stop message is always there, even if the input was cut short
+    const int32_t endTick = result.outputTicks > 0 ? result.outputTicks : 0;
+    uint8_t stop[DEMO_MSG_HEADER_SIZE] = {DEM_STOP};
+    memcpy(stop + 1, &endTick, sizeof(endTick));
+    ok = ok && fwrite(stop, 1, sizeof(stop), out) == sizeof(stop);
+    written += sizeof(stop);
+
+    const double interval = header.playback_ticks > 0 && header.playback_time > 0.0f
+                                ? (double)header.playback_time / (double)header.playback_ticks
+                                : TRIM_DEFAULT_TICK_INTERVAL;
+    header.playback_ticks = endTick;
+    header.playback_time = (float)(endTick * interval);
+    header.playback_frames = header.playback_frames > (int32_t)droppedPackets
+                                 ? header.playback_frames - (int32_t)droppedPackets
+                                 : (int32_t)packets;
+
+    ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, 1, sizeof(header), out) == sizeof(header);
+    ok = fclose(out) == 0 && ok;
+    if (!ok)
+    {
+        remove(outputPath);
+        return false;
+    }
+
+    result.outputBytes = written;
+    result.written = true;
+    return true;
+}
+
+const char* TrimActionToString(TrimAction action)
+{
+    switch (action)
+    {
+        case TRIM_KEEP:
+            return "keep";
+        case TRIM_DROP:
+            return "drop";
+        case TRIM_COLLAPSE:
+            return "collapse";
+    }
+    return "unknown";
+}
+
+bool ParseTrimAction(const char* text, TrimAction& action)
+{
+    for (int i = TRIM_KEEP; i <= TRIM_COLLAPSE; i++)
+    {
+        if (strcmp(text, TrimActionToString((TrimAction)i)) == 0)
+        {
+            action = (TrimAction)i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "demo_file.h"
+
+// Rewrites a demo without the ticks nobody watches: the loading packets recorded between ClientConnect and the
+// player's first input, and whatever the engine still wrote after the last input before the stop. Signon data is
+// always kept as it is. Both files are streamed (demo_stream.h), so memory use doesn't depend on the demo's size.
+
+enum TrimAction
+{
+    TRIM_KEEP,
+
+    // Leave the messages out. Safe for the tail. Loading packets hold the first full entity update the rest of the
+    // demo is delta compressed against, a demo without them may not play back.
+    TRIM_DROP,
+
+    // Keep the messages but move them all to the first tick of their range, so playback skips through them
+    TRIM_COLLAPSE,
+};
+
+struct TrimOptions_t
+{
+    TrimOptions_t() : leadIn(TRIM_COLLAPSE), tail(TRIM_DROP) {}
+
+    // Packets and console commands before the first usercmd
+    TrimAction leadIn;
+
+    // Everything after the last usercmd up to the stop message
+    TrimAction tail;
+};
+
+struct TrimResult_t
+{
+    // Of the input. A demo cut short (DEMERR_TRUNCATED) or with garbage after its last good message is still written,
+    // up to that message and with a stop message added.
+    DemoError error;
+    bool written;
+
+    uint64_t inputBytes;
+    uint64_t outputBytes;
+
+    // Last tick before and after, what playback time depends on
+    int32_t inputTicks;
+    int32_t outputTicks;
+
+    uint32_t droppedMessages;
+    uint32_t collapsedMessages;
+};
+
+// outputPath must not be inputPath. The header's tick, frame and time counts are rewritten to match the output.
+bool TrimDemo(const char* inputPath, const char* outputPath, const TrimOptions_t& options, TrimResult_t& result);
+
+const char* TrimActionToString(TrimAction action);
+
+// "keep", "drop" or "collapse", false for anything else
+bool ParseTrimAction(const char* text, TrimAction& action);
@@ -0,0 +1,948 @@
+#include "demorecord_session.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+#include "demo_index.h"
+
+#ifdef _WIN32
+#define DEMREC_PATH_SEPARATOR '\\'
+#else
+#define DEMREC_PATH_SEPARATOR '/'
+#endif
+
+// Same as Q_FixSlashes, which isn't available outside of the SDK
+static void FixSlashes(char* path)
+{
+    for (; *path; ++path)
+    {
+        if (*path == '/' || *path == '\\')
+            *path = DEMREC_PATH_SEPARATOR;
+    }
+}
+
+static void CopyString(char* dest, size_t destSize, const char* src)
+{
+    snprintf(dest, destSize, "%s", src);
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: constructor
+//---------------------------------------------------------------------------------
+CDemoRecordSession::CDemoRecordSession(IDemoRecordHost& host, CLatencyStats& stats)
+    : m_Host(host),
+      m_Stats(stats),
+      m_Mode(DEMREC_DISABLED),
+      m_Retries(0),
+      m_LastMapName("UNKNOWN_MAP"),
+      m_CurrentMapName("UNKNOWN_MAP"),
+      m_JournalSequence(0),
+      m_bSessionDirReady(false),
+      m_PendingRetries(0),
+      m_StopIssuedTime(0),
+      m_bRecordStartPending(false),
+      m_SpawnTick(-1),
+      m_RecordStartTick(-1),
+      m_KeepAttempts(0),
+      m_RotateTicket(0),
+      m_AttemptStartTime(0),
+      m_AttemptStartTick(-1),
+      m_bAttemptFinished(true),
+      m_bBookmarksLoaded(false)
+{
+    m_SessionDir[0] = '\0';
+    m_CurrentDemoName[0] = '\0';
+    m_JournalPath[0] = '\0';
+    m_PendingRecordCommand[0] = '\0';
+    m_PendingDemoName[0] = '\0';
+    m_HeldRecordCommand[0] = '\0';
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: mode changes
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::Start(const char* baseDir, const struct tm& localTime)
+{
+    // Init standard recording mode
+    m_Mode = DEMREC_STANDARD;
+    m_LastMapName = "";
+    ClearAttempts();
+
+    char tmpDir[32] = {};
+    snprintf(tmpDir,
+             sizeof(tmpDir),
+             "%04i.%02i.%02i-%02i.%02i.%02i",
+             localTime.tm_year,
+             localTime.tm_mon,
+             localTime.tm_mday,
+             localTime.tm_hour,
+             localTime.tm_min,
+             localTime.tm_sec);
+
+    snprintf(m_SessionDir, sizeof(m_SessionDir), "%s%s\\", baseDir, tmpDir);
+    FixSlashes(m_SessionDir);
+    {
+        LATENCY_SCOPE(m_Stats, LATENCY_FS_CREATEDIR);
+        m_Host.CreateDirHierarchy(m_SessionDir);
+    }
+    m_bSessionDirReady = true;
+    m_DemoNameIndex.Clear();
+    BuildDemoNameIndex();
+
+    // Store dir in a resume txt file incase of crash
+    char path[SESSION_DIR_SIZE] = {};
+    GetResumeInfoPath(baseDir, path, sizeof(path));
+    {
+        LATENCY_SCOPE(m_Stats, LATENCY_FS_WRITE);
+        m_Host.WriteFile(path, m_SessionDir, strlen(m_SessionDir), false, true);
+    }
+
+    snprintf(m_JournalPath, sizeof(m_JournalPath), "%s" JOURNAL_FILE_NAME, m_SessionDir);
+    m_JournalSequence = 0;
+    m_JournalRecords.clear();
+    AppendJournal(JOURNAL_START, -1);
+}
+
+bool CDemoRecordSession::Resume(const char* baseDir)
+{
+    char path[SESSION_DIR_SIZE] = {};
+    GetResumeInfoPath(baseDir, path, sizeof(path));
+
+    std::string contents;
+    {
+        LATENCY_SCOPE(m_Stats, LATENCY_FS_READ);
+        if (!m_Host.ReadFile(path, contents))
+            return false;
+    }
+
+    // Only the first line is the session dir
+    contents = contents.substr(0, contents.find_first_of("\r\n"));
+    CopyString(m_SessionDir, sizeof(m_SessionDir), contents.c_str());
+    m_bSessionDirReady = false;
+
+    // Init standard recording mode
+    m_Mode = DEMREC_STANDARD;
+    m_LastMapName = "";
+    ClearAttempts();
+    m_DemoNameIndex.Clear();
+    m_JournalSequence = 0;
+    m_JournalRecords.clear();
+    snprintf(m_JournalPath, sizeof(m_JournalPath), "%s" JOURNAL_FILE_NAME, m_SessionDir);
+
+    std::string journal;
+    {
+        LATENCY_SCOPE(m_Stats, LATENCY_FS_READ);
+        if (m_Host.ReadFile(m_JournalPath, journal))
+        {
+            RestoreFromJournal(journal);
+        }
+    }
+
+    // The journal can lose or tear its last records while the demos they were about made it to disk, so the
+    // directory always gets merged in too
+    BuildDemoNameIndex();
+    RepairBookmarks();
+    return true;
+}
+
+void CDemoRecordSession::StartSegmented(const char* baseDir, uint32_t keepAttempts)
+{
+    // Init segment recording mode
+    m_Mode = DEMREC_SEGMENTED;
+    CopyString(m_SessionDir, sizeof(m_SessionDir), baseDir);
+    m_bSessionDirReady = false;
+
+    // speedrun_dir is shared by every segment, nothing to resume
+    m_JournalPath[0] = '\0';
+    m_JournalRecords.clear();
+
+    ClearAttempts();
+    m_KeepAttempts = std::min(keepAttempts, (uint32_t)ATTEMPT_MAX_KEEP);
+    if (m_KeepAttempts > 0)
+    {
+        LoadAttempts(m_SessionDir, m_Attempts, m_AttemptIndexPath);
+
+        std::vector<std::string> demos;
+        {
+            LATENCY_SCOPE(m_Stats, LATENCY_FS_FINDFILES);
+            m_Host.FindFiles((std::string(m_SessionDir) + "*.dem").c_str(), demos);
+        }
+        for (size_t i = 0; i < demos.size(); i++)
+        {
+            m_CanonicalDemos.insert(demos[i].substr(0, demos[i].size() - 4));
+        }
+    }
+}
+
+void CDemoRecordSession::Stop(const char* baseDir)
+{
+    if (m_Mode == DEMREC_DISABLED)
+        return;
+
+    m_LastMapName = m_CurrentMapName;
+
+    if (m_Host.IsRecordingDemo())
+    {
+        if (m_Mode == DEMREC_SEGMENTED)
+        {
+            FinishAttempt();
+        }
+        StopCurrentDemo();
+    }
+    ClearAttempts();
+
+    if (m_Mode == DEMREC_STANDARD)
+    {
+        // Delete resume file
+        char path[SESSION_DIR_SIZE] = {};
+        GetResumeInfoPath(baseDir, path, sizeof(path));
+        m_Host.RemoveFile(path);
+    }
+    if (m_Mode == DEMREC_STANDARD && m_SessionDir[0] != '\0')
+    {
+        m_Host.OnSessionStopped(m_SessionDir);
+    }
+
+    m_Mode = DEMREC_DISABLED;
+    m_PendingRecordCommand[0] = '\0';
+    m_bRecordStartPending = false;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: called on level start, resolves the demo name so ClientConnect only has to send the command
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::OnLevelInit(const char* mapName)
+{
+    if (m_Mode != DEMREC_DISABLED)
+    {
+        m_CurrentMapName = mapName;
+        PrepareRecordCommand();
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: called on level end, this can get called multiple times per map change
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::OnLevelShutdown()
+{
+    if (m_Mode == DEMREC_STANDARD)
+    {
+        if (!m_Host.IsPlayingDemo() && m_Host.IsRecordingDemo())
+        {
+            StopCurrentDemo();
+            m_StopIssuedTime = LatencyNow();
+        }
+    }
+    else if (m_Mode == DEMREC_SEGMENTED)
+    {
+        FinishAttempt();
+
+        // A record command still waiting for its rotation is for the level going away, its last attempt was moved
+        if (m_HeldRecordCommand[0] != '\0')
+        {
+            m_HeldRecordCommand[0] = '\0';
+            m_CanonicalDemos.erase(m_CurrentDemoName);
+        }
+    }
+
+    // Make sure the record command of the next map can't fail because of a missing folder, this is the last point
+    // before the load where disk access doesn't cost us recorded ticks
+    if (m_Mode != DEMREC_DISABLED && !m_bSessionDirReady)
+    {
+        EnsureSessionDir();
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: called when a client joins the server, sends the prepared record command and commits its state
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::OnClientConnect()
+{
+    if (m_Mode == DEMREC_DISABLED || m_Host.IsPlayingDemo())
+        return;
+
+    // Normally prepared in LevelInit, only do the work here if we somehow got no LevelInit for this connect
+    if (m_PendingRecordCommand[0] == '\0')
+    {
+        PrepareRecordCommand();
+    }
+
+    if (m_PendingRecordCommand[0] == '\0')
+        return;
+
+    if (m_Mode == DEMREC_SEGMENTED && m_KeepAttempts > 0)
+    {
+        // The last attempt has to be closed before it can be moved aside, and moved before record opens <map>.dem
+        // again. The move is a file job, the record command is held until it is done instead of waiting for it.
+        // A demo of another map stays where it is and is indexed there, OnRotateAttempt indexes one of this map in
+        // the slot it is moved to.
+        if (m_Host.IsRecordingDemo())
+        {
+            m_Host.ClientCmd("stop");
+            if (strcmp(m_CurrentDemoName, m_PendingDemoName) != 0)
+            {
+                ReportDemoStopped(m_CurrentDemoName);
+            }
+        }
+        m_RotateMapName = m_PendingDemoName;
+        CopyString(m_HeldRecordCommand, sizeof(m_HeldRecordCommand), m_PendingRecordCommand);
+        m_Host.ClientCmd(SEGMENT_ROTATE_COMMAND "\n");
+    }
+    else
+    {
+        m_Host.ClientCmd(m_PendingRecordCommand);
+    }
+    m_PendingRecordCommand[0] = '\0';
+
+    if (m_StopIssuedTime != 0)
+    {
+        m_Stats.Record(LATENCY_STOP_TO_RECORD, LatencyNow() - m_StopIssuedTime);
+        m_StopIssuedTime = 0;
+    }
+
+    m_Retries = m_PendingRetries;
+    m_LastMapName = m_CurrentMapName;
+    CopyString(m_CurrentDemoName, sizeof(m_CurrentDemoName), m_PendingDemoName);
+
+    if (m_Mode == DEMREC_STANDARD)
+    {
+        m_DemoNameIndex.OnDemoRecorded(m_CurrentMapName.c_str(), m_Retries);
+        AppendJournal(JOURNAL_RECORD, m_Host.GetServerTick());
+    }
+
+    m_bRecordStartPending = true;
+    m_SpawnTick = -1;
+    m_RecordStartTick = -1;
+
+    m_AttemptStartTime = LatencyNow();
+    m_AttemptStartTick = -1;
+    m_bAttemptFinished = false;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: called when the player spawns
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::OnClientActive()
+{
+    if (m_Mode == DEMREC_DISABLED)
+        return;
+
+    const int tick = m_Host.GetServerTick();
+    if (tick >= 0)
+    {
+        m_SpawnTick = tick;
+        ReportRecordStartLatency();
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: called every server frame, used to see when a requested recording actually starts
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::OnGameFrame()
+{
+    SendHeldRecordCommand();
+
+    if (!m_bRecordStartPending || !m_Host.IsRecordingDemo())
+        return;
+
+    const int tick = m_Host.GetServerTick();
+    if (tick >= 0)
+    {
+        m_bRecordStartPending = false;
+        m_RecordStartTick = tick;
+        m_AttemptStartTick = tick;
+        ReportRecordStartLatency();
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: segmented attempt history
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::OnRotateAttempt()
+{
+    if (m_Mode != DEMREC_SEGMENTED || m_KeepAttempts == 0 || m_RotateMapName.empty())
+        return;
+
+    const std::string mapName = m_RotateMapName;
+    m_RotateMapName.clear();
+
+    // Nothing to move on the first attempt. A .dmi is not moved along: the indexer may still be writing the one of
+    // <map>.dem, so both indexes are removed and the demo is indexed again once it is in its slot. The attempt the
+    // slot held goes first, the indexer then retries until the move is done rather than indexing that one.
+    const std::string dir = m_SessionDir;
+    m_RotateTicket = 0;
+    if (m_CanonicalDemos.count(mapName) != 0)
+    {
+        LATENCY_SCOPE(m_Stats, LATENCY_FS_RENAME);
+
+        std::vector<uint32_t> droppedSlots;
+        const uint32_t slot = m_Attempts.Rotate(mapName.c_str(), m_KeepAttempts, droppedSlots);
+        for (size_t i = 0; i < droppedSlots.size(); i++)
+        {
+            const std::string droppedPath = dir + CAttemptHistory::GetSlotDemoName(mapName.c_str(), droppedSlots[i]);
+            m_Host.RemoveFile((droppedPath + ".dem").c_str());
+            m_Host.RemoveFile((droppedPath + DEMO_INDEX_EXTENSION).c_str());
+        }
+
+        const std::string slotName = CAttemptHistory::GetSlotDemoName(mapName.c_str(), slot);
+        const std::string slotPath = dir + slotName;
+        m_Host.RemoveFile((slotPath + ".dem").c_str());
+        m_Host.RemoveFile((slotPath + DEMO_INDEX_EXTENSION).c_str());
+        m_Host.RemoveFile((dir + mapName + DEMO_INDEX_EXTENSION).c_str());
+        m_Host.QueueRenameFile((dir + mapName + ".dem").c_str(), (slotPath + ".dem").c_str());
+        m_RotateTicket = m_Host.GetFileJobTicket();
+        ReportDemoStopped(slotName.c_str());
+    }
+    m_CanonicalDemos.insert(mapName);
+
+    m_Attempts.BeginAttempt(mapName.c_str(), (int64_t)time(NULL));
+    SaveAttempts(m_Attempts, m_AttemptIndexPath);
+    SendHeldRecordCommand();
+}
+
+void CDemoRecordSession::SendHeldRecordCommand()
+{
+    if (m_HeldRecordCommand[0] == '\0' || !m_Host.IsFileJobDone(m_RotateTicket))
+        return;
+
+    m_Host.ClientCmd(m_HeldRecordCommand);
+    m_HeldRecordCommand[0] = '\0';
+}
+
+void CDemoRecordSession::GetAttempts(const char* baseDir, const char* mapName, std::vector<attemptrecord_t>& attempts)
+{
+    if (m_Mode == DEMREC_SEGMENTED && m_KeepAttempts > 0 && strcmp(baseDir, m_SessionDir) == 0)
+    {
+        m_Attempts.GetAttempts(mapName, attempts);
+        return;
+    }
+
+    CAttemptHistory history;
+    std::string indexPath;
+    LoadAttempts(baseDir, history, indexPath);
+    history.GetAttempts(mapName, attempts);
+}
+
+AttemptPromoteResult CDemoRecordSession::PromoteAttempt(const char* baseDir, const char* mapName, uint32_t attempt)
+{
+    // The live history when it is the one of the running segment, so the next rotation sees the swap
+    CAttemptHistory loaded;
+    std::string loadedPath;
+    const bool bLive = m_Mode == DEMREC_SEGMENTED && m_KeepAttempts > 0 && strcmp(baseDir, m_SessionDir) == 0;
+    if (!bLive)
+    {
+        LoadAttempts(baseDir, loaded, loadedPath);
+    }
+    CAttemptHistory& history = bLive ? m_Attempts : loaded;
+    const std::string& indexPath = bLive ? m_AttemptIndexPath : loadedPath;
+
+    const attemptrecord_t* chosen = history.Find(mapName, attempt);
+    if (!chosen)
+        return PROMOTE_NOT_FOUND;
+    if (chosen->slot == ATTEMPT_CANONICAL)
+        return PROMOTE_ALREADY_CANONICAL;
+    if (bLive && m_Host.IsRecordingDemo() && strcmp(m_CurrentDemoName, mapName) == 0)
+        return PROMOTE_RECORDING;
+
+    const std::string dir = baseDir;
+    const std::string demoPath = dir + mapName + ".dem";
+    const std::string slotPath = dir + CAttemptHistory::GetSlotDemoName(mapName, chosen->slot) + ".dem";
+    const std::string swapPath = dir + mapName + ".dem.promote";
+    const std::string demoIndexPath = dir + mapName + DEMO_INDEX_EXTENSION;
+    const std::string slotIndexPath = slotPath.substr(0, slotPath.size() - 4) + DEMO_INDEX_EXTENSION;
+    const std::string swapIndexPath = demoIndexPath + ".promote";
+
+    {
+        LATENCY_SCOPE(m_Stats, LATENCY_FS_RENAME);
+
+        // Three renames, <map>.dem may not exist
+        const bool bHadCanonical = m_Host.RenameFile(demoPath.c_str(), swapPath.c_str());
+        if (!m_Host.RenameFile(slotPath.c_str(), demoPath.c_str()))
+        {
+            if (bHadCanonical)
+            {
+                m_Host.RenameFile(swapPath.c_str(), demoPath.c_str());
+            }
+            return PROMOTE_FILE_ERROR;
+        }
+        if (bHadCanonical)
+        {
+            m_Host.RenameFile(swapPath.c_str(), slotPath.c_str());
+        }
+        history.Promote(mapName, attempt, bHadCanonical);
+
+        // The .dmi indexes swap the same way, a missing one stays missing on its new side
+        m_Host.QueueRenameFile(demoIndexPath.c_str(), swapIndexPath.c_str());
+        m_Host.QueueRenameFile(slotIndexPath.c_str(), demoIndexPath.c_str());
+        m_Host.QueueRenameFile(swapIndexPath.c_str(), slotIndexPath.c_str());
+    }
+    if (bLive)
+    {
+        m_CanonicalDemos.insert(mapName);
+    }
+
+    SaveAttempts(history, indexPath);
+    return PROMOTE_OK;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: writes down how the attempt being recorded went, before its demo is stopped
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::FinishAttempt()
+{
+    if (m_Mode != DEMREC_SEGMENTED || m_KeepAttempts == 0 || m_bAttemptFinished || !m_Host.IsRecordingDemo())
+        return;
+
+    m_bAttemptFinished = true;
+    attemptrecord_t* record = m_Attempts.FindCanonical(m_CurrentDemoName);
+    if (!record)
+        return;
+
+    int ticks = m_Host.GetDemoTick();
+    if (ticks < 0 && m_AttemptStartTick >= 0)
+    {
+        const int tick = m_Host.GetServerTick();
+        ticks = tick >= m_AttemptStartTick ? tick - m_AttemptStartTick : -1;
+    }
+    record->ticks = ticks;
+    record->durationMs = (LatencyNow() - m_AttemptStartTime) / 1000000;
+    SaveAttempts(m_Attempts, m_AttemptIndexPath);
+}
+
+// Only speedrun_segment keeps attempts, nothing of it may carry over into the next mode
+void CDemoRecordSession::ClearAttempts()
+{
+    m_KeepAttempts = 0;
+    m_Attempts.Clear();
+    m_AttemptIndexPath.clear();
+    m_RotateMapName.clear();
+    m_CanonicalDemos.clear();
+    m_HeldRecordCommand[0] = '\0';
+    m_bAttemptFinished = true;
+}
+
+void CDemoRecordSession::LoadAttempts(const char* baseDir, CAttemptHistory& attempts, std::string& indexPath)
+{
+    indexPath = std::string(baseDir) + ATTEMPT_INDEX_FILE_NAME;
+
+    std::string contents;
+    {
+        LATENCY_SCOPE(m_Stats, LATENCY_FS_READ);
+        if (!m_Host.ReadFile(indexPath.c_str(), contents))
+        {
+            attempts.Clear();
+            return;
+        }
+    }
+
+    // A damaged index starts over, the slot demos are still there to look at by hand
+    attempts.Load(contents);
+}
+
+void CDemoRecordSession::SaveAttempts(const CAttemptHistory& attempts, const std::string& indexPath)
+{
+    std::string contents;
+    attempts.Save(contents);
+
+    LATENCY_SCOPE(m_Stats, LATENCY_FS_WRITE);
+    m_Host.WriteFile(indexPath.c_str(), contents.data(), contents.size(), false, false);
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: bookmarks
+//---------------------------------------------------------------------------------
+bool CDemoRecordSession::AddBookmark(const char* baseDir, const char* tag, const struct tm& localTime, int demoTick)
+{
+    if (m_Mode == DEMREC_DISABLED || !m_Host.IsRecordingDemo() || m_CurrentDemoName[0] == '\0')
+        return false;
+
+    const std::string session = GetBookmarkSession();
+    bookmarkrecord_t record;
+    BuildBookmarkRecord(record,
+                        session.c_str(),
+                        m_CurrentMapName.c_str(),
+                        m_CurrentDemoName,
+                        tag,
+                        (int64_t)time(NULL),
+                        localTime,
+                        demoTick,
+                        m_Host.GetServerTick());
+
+    const std::string path = std::string(m_SessionDir) + BOOKMARK_FILE_NAME;
+    {
+        LATENCY_SCOPE(m_Stats, LATENCY_FS_WRITE);
+        m_Host.WriteFile(path.c_str(), &record, sizeof(record), true, false);
+    }
+    CatalogBookmarkSession(baseDir, session);
+
+    if (m_bBookmarksLoaded && m_BookmarkBaseDir == baseDir)
+    {
+        m_Bookmarks.Add(GetBookmarkSessionDir(baseDir, session), record);
+    }
+    return true;
+}
+
+const CBookmarkStore& CDemoRecordSession::GetBookmarks(const char* baseDir)
+{
+    if (m_bBookmarksLoaded && m_BookmarkBaseDir == baseDir)
+        return m_Bookmarks;
+
+    m_Bookmarks.Clear();
+    m_BookmarkBaseDir = baseDir;
+    m_bBookmarksLoaded = true;
+
+    LATENCY_SCOPE(m_Stats, LATENCY_FS_READ);
+
+    std::string catalog;
+    if (!m_Host.ReadFile((m_BookmarkBaseDir + BOOKMARK_CATALOG_FILE_NAME).c_str(), catalog))
+        return m_Bookmarks;
+
+    std::vector<std::string> sessions;
+    ParseBookmarkCatalog(catalog, sessions);
+    for (size_t i = 0; i < sessions.size(); i++)
+    {
+        // A session dir deleted by hand just has no bookmarks anymore
+        const std::string sessionDir = GetBookmarkSessionDir(baseDir, sessions[i]);
+        std::string contents;
+        if (m_Host.ReadFile((sessionDir + BOOKMARK_FILE_NAME).c_str(), contents))
+        {
+            m_Bookmarks.AddFile(sessionDir, contents.data(), contents.size());
+        }
+    }
+    return m_Bookmarks;
+}
+
+std::string CDemoRecordSession::GetBookmarkSession() const
+{
+    if (m_Mode == DEMREC_DISABLED)
+        return "";
+    if (m_Mode == DEMREC_SEGMENTED)
+        return BOOKMARK_SEGMENT_SESSION;
+
+    // The last component of the session dir, a resumed session may have been started with another speedrun_dir
+    std::string dir = m_SessionDir;
+    while (!dir.empty() && (dir[dir.size() - 1] == '/' || dir[dir.size() - 1] == '\\'))
+    {
+        dir.erase(dir.size() - 1);
+    }
+    const size_t slash = dir.find_last_of("/\\");
+    return slash == std::string::npos ? dir : dir.substr(slash + 1);
+}
+
+std::string CDemoRecordSession::GetBookmarkSessionDir(const char* baseDir, const std::string& session)
+{
+    if (session == BOOKMARK_SEGMENT_SESSION)
+        return baseDir;
+
+    char dir[SESSION_DIR_SIZE] = {};
+    snprintf(dir, sizeof(dir), "%s%s\\", baseDir, session.c_str());
+    FixSlashes(dir);
+    return dir;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: adds the session to baseDir's catalog unless it is in there already, checked once per session
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::CatalogBookmarkSession(const char* baseDir, const std::string& session)
+{
+    const std::string key = std::string(baseDir) + session;
+    if (m_CataloguedBookmarkDir == key)
+        return;
+
+    const std::string path = std::string(baseDir) + BOOKMARK_CATALOG_FILE_NAME;
+    bool bCatalogued = m_bBookmarksLoaded && m_BookmarkBaseDir == baseDir && m_Bookmarks.HasSession(session.c_str());
+    if (!bCatalogued)
+    {
+        std::string contents;
+        std::vector<std::string> sessions;
+        {
+            LATENCY_SCOPE(m_Stats, LATENCY_FS_READ);
+            if (m_Host.ReadFile(path.c_str(), contents))
+            {
+                ParseBookmarkCatalog(contents, sessions);
+            }
+        }
+        bCatalogued = std::find(sessions.begin(), sessions.end(), session) != sessions.end();
+    }
+
+    if (!bCatalogued)
+    {
+        const std::string line = session + "\n";
+        LATENCY_SCOPE(m_Stats, LATENCY_FS_WRITE);
+        m_Host.WriteFile(path.c_str(), line.data(), line.size(), true, false);
+    }
+    m_CataloguedBookmarkDir = key;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: cuts a torn bookmark off the resumed session's file so the next ones line up again
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::RepairBookmarks()
+{
+    const std::string path = std::string(m_SessionDir) + BOOKMARK_FILE_NAME;
+
+    std::string contents;
+    {
+        LATENCY_SCOPE(m_Stats, LATENCY_FS_READ);
+        if (!m_Host.ReadFile(path.c_str(), contents))
+            return;
+    }
+
+    std::vector<bookmarkrecord_t> records;
+    const BookmarkReadResult_t result = ReadBookmarks(contents.data(), contents.size(), records);
+    if (result.torn)
+    {
+        m_Host.WriteFile(path.c_str(), contents.data(), result.validBytes, false, true);
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: helpers
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::GetResumeInfoPath(const char* baseDir, char* path, size_t pathSize)
+{
+    snprintf(path, pathSize, "%s" RESUME_INFO_FILE_NAME, baseDir);
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: resolves the next demo name for the current map and formats the record command without changing any
+// state, OnClientConnect commits it once the command is actually sent
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::PrepareRecordCommand()
+{
+    m_PendingRecordCommand[0] = '\0';
+
+    const std::string& curMap = m_CurrentMapName;
+    if (curMap.find("background") != std::string::npos)
+        return;
+
+    // Q: Why does game crash when I record a demo?
+    // A: Strange character/letters in path OR your path exceeds 256 characters, windows max is 320.
+    if (m_Mode == DEMREC_SEGMENTED)
+    {
+        m_PendingRetries = 0;
+    }
+    else if (m_LastMapName == curMap)
+    {
+        // After a resume the index may know of demos the journal lost, never reuse one of their names
+        m_PendingRetries = std::max(m_Retries + 1, m_DemoNameIndex.GetNextRetry(curMap.c_str()));
+    }
+    else
+    {
+        m_PendingRetries = m_DemoNameIndex.GetNextRetry(curMap.c_str());
+    }
+
+    if (m_PendingRetries != 0)
+    {
+        snprintf(m_PendingDemoName, sizeof(m_PendingDemoName), "%s_%d", curMap.c_str(), m_PendingRetries);
+    }
+    else
+    {
+        CopyString(m_PendingDemoName, sizeof(m_PendingDemoName), curMap.c_str());
+    }
+
+    // Always ensure path exists before attempting to record
+    // Otherwise, record command will fail!
+    if (!m_bSessionDirReady)
+    {
+        EnsureSessionDir();
+    }
+
+    const int length = snprintf(
+        m_PendingRecordCommand, sizeof(m_PendingRecordCommand), "record %s%s\n", m_SessionDir, m_PendingDemoName);
+    if (length < 0 || (size_t)length >= sizeof(m_PendingRecordCommand))
+    {
+        // A truncated path would record somewhere else (or crash older engines), don't send it
+        m_PendingRecordCommand[0] = '\0';
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: scans the session dir once for demos so OnClientConnect can pick demo names without touching the disk.
+// Adds to whatever is already in the index.
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::BuildDemoNameIndex()
+{
+    LATENCY_SCOPE(m_Stats, LATENCY_FS_FINDFILES);
+
+    char wildcard[SESSION_DIR_SIZE + 8] = {};
+    snprintf(wildcard, sizeof(wildcard), "%s*.dem", m_SessionDir);
+
+    std::vector<std::string> fileNames;
+    m_Host.FindFiles(wildcard, fileNames);
+    for (size_t i = 0; i < fileNames.size(); ++i)
+    {
+        m_DemoNameIndex.AddExistingDemo(fileNames[i].c_str());
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: rebuilds the demo name index, retries and last map from the journal, false if it has no valid records
+//---------------------------------------------------------------------------------
+bool CDemoRecordSession::RestoreFromJournal(const std::string& journal)
+{
+    std::vector<journalrecord_t> records;
+    const JournalReadResult_t result = ReadJournal(journal.data(), journal.size(), records);
+    if (records.empty())
+        return false;
+
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const journalrecord_t& record = records[i];
+        if (record.type != JOURNAL_RECORD)
+            continue;
+
+        m_DemoNameIndex.OnDemoRecorded(record.mapName, record.retry);
+        m_Retries = record.retry;
+        m_LastMapName = record.mapName;
+        m_CurrentMapName = record.mapName;
+        CopyString(m_CurrentDemoName, sizeof(m_CurrentDemoName), record.demoName);
+    }
+    m_JournalSequence = records.back().sequence + 1;
+    m_JournalRecords.swap(records);
+
+    if (result.torn)
+    {
+        // Cut the torn record off so new records line up again. Whatever it was about may have made it to disk as a
+        // demo, Resume merges the directory into the names afterwards.
+        m_Host.WriteFile(m_JournalPath, journal.data(), result.validBytes, false, true);
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: appends a record about the current demo to the journal, synced to disk by the writer
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::AppendJournal(JournalRecordType type, int tick)
+{
+    if (m_JournalPath[0] == '\0')
+        return;
+
+    journalrecord_t record;
+    BuildJournalRecord(record,
+                       type,
+                       m_JournalSequence++,
+                       type == JOURNAL_START ? "" : m_CurrentMapName.c_str(),
+                       type == JOURNAL_START ? 0 : m_Retries,
+                       type == JOURNAL_START ? "" : m_CurrentDemoName,
+                       (int64_t)time(NULL),
+                       tick);
+
+    m_JournalRecords.push_back(record);
+
+    LATENCY_SCOPE(m_Stats, LATENCY_FS_WRITE);
+    m_Host.WriteFile(m_JournalPath, &record, sizeof(record), true, true);
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: writes the VDM chain of a session, the journal says which demos in what order and where they end
+//---------------------------------------------------------------------------------
+PlaylistResult_t CDemoRecordSession::WritePlaylist(const PlaylistOptions_t& options,
+                                                   const char* sessionDir,
+                                                   std::vector<std::string>* demoPaths)
+{
+    std::vector<journalrecord_t> records;
+    std::string dir;
+    if (sessionDir && sessionDir[0] != '\0')
+    {
+        dir = sessionDir;
+        if (dir[dir.size() - 1] != '\\' && dir[dir.size() - 1] != '/')
+        {
+            dir += '\\';
+        }
+
+        std::string journal;
+        LATENCY_SCOPE(m_Stats, LATENCY_FS_READ);
+        if (m_Host.ReadFile((dir + JOURNAL_FILE_NAME).c_str(), journal))
+        {
+            ReadJournal(journal.data(), journal.size(), records);
+        }
+    }
+    else
+    {
+        dir = m_SessionDir;
+        records = m_JournalRecords;
+    }
+
+    IDemoRecordHost& host = m_Host;
+    std::vector<PlaylistDemo_t> chain;
+    const PlaylistResult_t result = ::WritePlaylist(
+        records,
+        dir,
+        dir,
+        options,
+        [&host](const std::string& path, std::string& contents) { return host.ReadFile(path.c_str(), contents); },
+        [&host](const std::string& path, const std::string& contents) {
+            host.WriteFile(path.c_str(), contents.data(), contents.size(), false, false);
+        },
+        &chain);
+
+    if (demoPaths)
+    {
+        demoPaths->clear();
+        for (size_t i = 0; i < chain.size(); i++)
+        {
+            demoPaths->push_back(dir + chain[i].demoName + ".dem");
+        }
+    }
+    return result;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: stops the demo being recorded, journals it and hands it to the host for indexing
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::StopCurrentDemo()
+{
+    if (m_Mode == DEMREC_STANDARD)
+    {
+        AppendJournal(JOURNAL_STOP, m_Host.GetDemoTick());
+    }
+    m_Host.ClientCmd("stop");
+    ReportDemoStopped(m_CurrentDemoName);
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: hands a stopped demo of the session dir to the host for indexing
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::ReportDemoStopped(const char* demoName)
+{
+    char demoPath[CMD_SIZE];
+    const int length = snprintf(demoPath, sizeof(demoPath), "%s%s.dem", m_SessionDir, demoName);
+    if (demoName[0] != '\0' && length > 0 && (size_t)length < sizeof(demoPath))
+    {
+        m_Host.OnDemoStopped(demoPath);
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: checks if the session dir exists, if not attempts to create it
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::EnsureSessionDir()
+{
+    LATENCY_SCOPE(m_Stats, LATENCY_FS_CREATEDIR);
+
+    if (!m_Host.IsDirectory(m_SessionDir))
+    {
+        char path[SESSION_DIR_SIZE] = {};
+        CopyString(path, sizeof(path), m_SessionDir);
+        FixSlashes(path);
+        m_Host.CreateDirHierarchy(path);
+    }
+    m_bSessionDirReady = true;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: reports how many server ticks after the player spawned the demo started recording (negative = before the
+// spawn), once both ends are known
+//---------------------------------------------------------------------------------
+void CDemoRecordSession::ReportRecordStartLatency()
+{
+    if (m_SpawnTick < 0 || m_RecordStartTick < 0)
+        return;
+
+    m_Host.OnRecordingStarted(m_CurrentDemoName, m_RecordStartTick - m_SpawnTick);
+    m_SpawnTick = -1;
+    m_RecordStartTick = -1;
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "attempt_history.h"
+#include "bookmark_store.h"
+#include "demo_name_index.h"
+#include "latency_stats.h"
+#include "session_journal.h"
+#include "vdm_playlist.h"
+
+// Common command size
+#define CMD_SIZE 256
+#define SESSION_DIR_SIZE 256
+#define DEMO_NAME_SIZE 256
+
+#define RESUME_INFO_FILE_NAME "speedrun_democrecord_resume_info.txt"
+
+// Console command the plugin registers to run CDemoRecordSession::OnRotateAttempt, queued between "stop" and "record"
+// so the renames happen after the engine closed the demo and before it opens it again
+#define SEGMENT_ROTATE_COMMAND "speedrun_segment_rotate"
+
+enum RecordingMode
+{
+    DEMREC_DISABLED,
+
+    // standard speedrun (deaths/reloads/etc)
+    DEMREC_STANDARD,
+
+    // segmenting mode
+    // mainly one map, on map level changes do not stop recording
+    DEMREC_SEGMENTED
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: everything the recording state machine needs from the engine. The plugin implements this on top of
+// IVEngineClient/IFileSystem, the native tests and benchmarks use an in-memory fake.
+//
+// Paths are the same game relative paths the plugin always handed to IFileSystem.
+//---------------------------------------------------------------------------------
+class IDemoRecordHost
+{
+    public:
+    virtual bool IsPlayingDemo() = 0;
+    virtual bool IsRecordingDemo() = 0;
+    virtual void ClientCmd(const char* command) = 0;
+
+    // Current server tick and tick of the demo being recorded, -1 if unknown
+    virtual int GetServerTick() = 0;
+    virtual int GetDemoTick() = 0;
+
+    virtual bool IsDirectory(const char* path) = 0;
+    virtual void CreateDirHierarchy(const char* path) = 0;
+
+    // Appends the bare file names matching wildcard (e.g. "dir/*.dem")
+    virtual void FindFiles(const char* wildcard, std::vector<std::string>& fileNames) = 0;
+
+    virtual bool ReadFile(const char* path, std::string& contents) = 0;
+    // sync: make sure the data reaches the disk, not just the OS, before the write counts as done
+    virtual void WriteFile(const char* path, const void* data, size_t size, bool append, bool sync) = 0;
+    virtual void RemoveFile(const char* path) = 0;
+
+    // Renames right away (not queued like WriteFile and RemoveFile), replacing to if it exists. False if from doesn't
+    // exist or couldn't be renamed. Waits for the queued jobs, console commands only.
+    virtual bool RenameFile(const char* from, const char* to) = 0;
+
+    // Queued like WriteFile and RemoveFile and done after them, replacing to if it exists. Nothing happens if from
+    // doesn't exist.
+    virtual void QueueRenameFile(const char* from, const char* to) = 0;
+
+    // IsFileJobDone(GetFileJobTicket()) turns true once every file job queued so far is done, polled on the load path
+    // instead of waiting for the disk
+    virtual uint64_t GetFileJobTicket() = 0;
+    virtual bool IsFileJobDone(uint64_t ticket) = 0;
+
+    // How many server ticks after the player spawned a requested recording actually started (negative = before)
+    virtual void OnRecordingStarted(const char* demoName, int ticksAfterSpawn) = 0;
+
+    // A stop command was sent for demoPath ("<session dir><name>.dem"), the engine finishes the file once it runs it
+    virtual void OnDemoStopped(const char* demoPath) = 0;
+
+    // speedrun_stop ended the standard run in sessionDir, after the OnDemoStopped of its last demo. Not called for
+    // speedrun_segment, whose dir is the speedrun_dir every segment and run shares.
+    virtual void OnSessionStopped(const char* sessionDir) = 0;
+
+    protected:
+    ~IDemoRecordHost() {}
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: the recording state machine: modes, demo naming, retries and resume. The plugin forwards its callbacks
+// and speedrun_* commands here.
+//---------------------------------------------------------------------------------
+class CDemoRecordSession
+{
+    public:
+    CDemoRecordSession(IDemoRecordHost& host, CLatencyStats& stats);
+
+    // speedrun_start: new timestamped session folder under baseDir (speedrun_dir) + resume info.
+    // localTime is expected with the year and month already normalized (1900 and 1 added).
+    void Start(const char* baseDir, const struct tm& localTime);
+
+    // speedrun_resume: continues the session named in baseDir's resume info, false if there is none. State comes from
+    // the session's journal, sessions without one fall back to scanning the dir for demos.
+    bool Resume(const char* baseDir);
+
+    // speedrun_segment: every load records baseDir<map>.dem. With keepAttempts the last that many attempts of each map
+    // are kept in slots next to it (attempt_history.h).
+    void StartSegmented(const char* baseDir, uint32_t keepAttempts = 0);
+
+    // speedrun_stop
+    void Stop(const char* baseDir);
+
+    // speedrun_playlist: a .vdm next to every finished demo of the current or last standard run that plays the next
+    // one, from the journal records kept in memory. sessionDir ("<speedrun_dir><session>\\") reads that session's
+    // journal instead, for runs from before a restart. demoPaths, if given, gets the chained demos
+    // ("<session dir><name>.dem") in the order they play, for speedrun_playback.
+    PlaylistResult_t WritePlaylist(const PlaylistOptions_t& options,
+                                   const char* sessionDir = NULL,
+                                   std::vector<std::string>* demoPaths = NULL);
+
+    // speedrun_segment_attempts and speedrun_segment_promote: the attempts kept in baseDir (speedrun_dir), and making
+    // one of them <map>.dem again by swapping it with the current one
+    void GetAttempts(const char* baseDir, const char* mapName, std::vector<attemptrecord_t>& attempts);
+    AttemptPromoteResult PromoteAttempt(const char* baseDir, const char* mapName, uint32_t attempt);
+
+    // speedrun_bookmark: appends a bookmark at demoTick of the demo being recorded to the session dir's bookmark file,
+    // tagged unless tag is empty, and catalogs the session in baseDir (speedrun_dir). False if nothing is being
+    // recorded. localTime as for Start.
+    bool AddBookmark(const char* baseDir, const char* tag, const struct tm& localTime, int demoTick);
+
+    // speedrun_bookmark_list/find/export: the bookmarks of every session catalogued in baseDir, read on first use and
+    // kept up to date by AddBookmark after that
+    const CBookmarkStore& GetBookmarks(const char* baseDir);
+
+    // Session the bookmarks of the current run are filed under, "" if no run is going
+    std::string GetBookmarkSession() const;
+
+    // SEGMENT_ROTATE_COMMAND: queues the move of the last attempt of the map about to be recorded into its slot, its
+    // record command follows once the move is done
+    void OnRotateAttempt();
+
+    // Engine callbacks
+    void OnLevelInit(const char* mapName);
+    void OnLevelShutdown();
+    void OnClientConnect();
+    void OnClientActive();
+    void OnGameFrame();
+
+    RecordingMode GetMode() const
+    {
+        return m_Mode;
+    }
+    int GetRetries() const
+    {
+        return m_Retries;
+    }
+    const char* GetSessionDir() const
+    {
+        return m_SessionDir;
+    }
+    const char* GetCurrentDemoName() const
+    {
+        return m_CurrentDemoName;
+    }
+    const std::string& GetCurrentMapName() const
+    {
+        return m_CurrentMapName;
+    }
+    const std::string& GetLastMapName() const
+    {
+        return m_LastMapName;
+    }
+    const CDemoNameIndex& GetDemoNameIndex() const
+    {
+        return m_DemoNameIndex;
+    }
+
+    // Builds "<baseDir>speedrun_democrecord_resume_info.txt"
+    static void GetResumeInfoPath(const char* baseDir, char* path, size_t pathSize);
+
+    private:
+    void PrepareRecordCommand();
+    void BuildDemoNameIndex();
+    bool RestoreFromJournal(const std::string& journal);
+    void AppendJournal(JournalRecordType type, int tick);
+    void EnsureSessionDir();
+    void ReportRecordStartLatency();
+    void StopCurrentDemo();
+    void ReportDemoStopped(const char* demoName);
+    void FinishAttempt();
+    void ClearAttempts();
+    void SendHeldRecordCommand();
+    void LoadAttempts(const char* baseDir, CAttemptHistory& attempts, std::string& indexPath);
+    void SaveAttempts(const CAttemptHistory& attempts, const std::string& indexPath);
+    void CatalogBookmarkSession(const char* baseDir, const std::string& session);
+    void RepairBookmarks();
+    static std::string GetBookmarkSessionDir(const char* baseDir, const std::string& session);
+
+    IDemoRecordHost& m_Host;
+    CLatencyStats& m_Stats;
+
+    RecordingMode m_Mode;
+    int m_Retries;
+    std::string m_LastMapName;
+    std::string m_CurrentMapName;
+    char m_SessionDir[SESSION_DIR_SIZE];
+    char m_CurrentDemoName[DEMO_NAME_SIZE];
+
+    // Next retry number per map in the current session dir
+    CDemoNameIndex m_DemoNameIndex;
+
+    // <session dir>speedrun_democrecord.journal, standard runs only
+    char m_JournalPath[SESSION_DIR_SIZE + 32];
+    uint32_t m_JournalSequence;
+
+    // Every valid record of the journal, kept after speedrun_stop for speedrun_playlist
+    std::vector<journalrecord_t> m_JournalRecords;
+
+    // Session dir is known to exist, checked at most once per session instead of on every load
+    bool m_bSessionDirReady;
+
+    // Record command for the map being loaded, prepared in LevelInit and sent by ClientConnect
+    char m_PendingRecordCommand[CMD_SIZE];
+    char m_PendingDemoName[DEMO_NAME_SIZE];
+    int m_PendingRetries;
+
+    uint64_t m_StopIssuedTime;
+
+    // Server ticks of the last spawn and of the moment the last requested recording actually started
+    bool m_bRecordStartPending;
+    int m_SpawnTick;
+    int m_RecordStartTick;
+
+    // Segmented attempt history, m_KeepAttempts 0 overwrites <map>.dem every time like before
+    uint32_t m_KeepAttempts;
+    CAttemptHistory m_Attempts;
+    std::string m_AttemptIndexPath;
+
+    // Map whose <map>.dem the queued SEGMENT_ROTATE_COMMAND moves aside
+    std::string m_RotateMapName;
+
+    // Maps whose <map>.dem is in the segment dir, listed by StartSegmented and added by every rotation, so a rotation
+    // knows whether there is an attempt to move without looking
+    std::set<std::string> m_CanonicalDemos;
+
+    // Record command of the map being loaded, held until the file jobs up to m_RotateTicket moved its last attempt
+    char m_HeldRecordCommand[CMD_SIZE];
+    uint64_t m_RotateTicket;
+
+    // Start of the attempt being recorded, and whether LevelShutdown already wrote down how it went
+    uint64_t m_AttemptStartTime;
+    int m_AttemptStartTick;
+    bool m_bAttemptFinished;
+
+    // Every catalogued bookmark of m_BookmarkBaseDir once GetBookmarks loaded them
+    CBookmarkStore m_Bookmarks;
+    std::string m_BookmarkBaseDir;
+    bool m_bBookmarksLoaded;
+
+    // Session dir (with its base dir) known to be in the catalog, later bookmarks of it skip the check
+    std::string m_CataloguedBookmarkDir;
+};
@@ -0,0 +1,109 @@
+#include "directory_watcher.h"
+
+#include <stddef.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+CDirectoryWatcher::CDirectoryWatcher() : m_Fd(-1) {}
+
+CDirectoryWatcher::~CDirectoryWatcher()
+{
+    Close();
+}
+
+bool CDirectoryWatcher::Open(const char* dir)
+{
+    Close();
+
+#ifdef __linux__
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    // IN_MODIFY comes with every write the engine makes to the demo, the others are new, renamed and removed files
+    if (inotify_add_watch(fd, dir, IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_DELETE) < 0)
+    {
+        close(fd);
+        return false;
+    }
+    m_Fd = fd;
+    return true;
+#else
+    (void)dir;
+    return false;
+#endif
+}
+
+void CDirectoryWatcher::Close()
+{
+#ifdef __linux__
+    if (m_Fd >= 0)
+    {
+        close(m_Fd);
+    }
+#endif
+    m_Fd = -1;
+}
+
+WatchResult CDirectoryWatcher::Wait(int timeoutMs, std::vector<std::string>& fileNames)
+{
+#ifdef __linux__
+    if (m_Fd >= 0)
+    {
+        pollfd pfd;
+        pfd.fd = m_Fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        const int ready = poll(&pfd, 1, timeoutMs);
+        if (ready < 0)
+            return errno == EINTR ? WATCH_TIMEOUT : WATCH_RESCAN;
+        if (ready == 0)
+            return WATCH_TIMEOUT;
+
+        // Aligned for the inotify_event structs read into it
+        alignas(inotify_event) char buffer[16 * 1024];
+        bool overflow = false;
+        const size_t firstName = fileNames.size();
+        for (;;)
+        {
+            const ssize_t length = read(m_Fd, buffer, sizeof(buffer));
+            if (length <= 0)
+                break;
+
+            for (ssize_t pos = 0; pos < length;)
+            {
+                const inotify_event* event = (const inotify_event*)(buffer + pos);
+                pos += (ssize_t)(sizeof(inotify_event) + event->len);
+
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    overflow = true;
+                    continue;
+                }
+                if (event->len == 0 || (event->mask & IN_ISDIR))
+                    continue;
+
+                // A demo being recorded sends a burst of these for the same name
+                const std::string name = event->name;
+                if (std::find(fileNames.begin() + (ptrdiff_t)firstName, fileNames.end(), name) == fileNames.end())
+                {
+                    fileNames.push_back(name);
+                }
+            }
+        }
+        return overflow ? WATCH_RESCAN : (fileNames.size() != firstName ? WATCH_CHANGED : WATCH_TIMEOUT);
+    }
+#endif
+
+    (void)fileNames;
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+    return WATCH_RESCAN;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+enum WatchResult
+{
+    // Nothing happened before the timeout
+    WATCH_TIMEOUT,
+
+    // fileNames holds every file that was created, written, moved in or removed, each once
+    WATCH_CHANGED,
+
+    // Something may have changed but the watcher can't say what: the kernel's queue overflowed, or there is no
+    // watching at all on this platform and the timeout passed. The caller checks everything again.
+    WATCH_RESCAN,
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: tells which files of a directory changed. inotify on Linux, so a process following a recording sleeps
+// until the engine writes and then only looks at the file it wrote. Elsewhere Open fails and Wait only sleeps.
+//---------------------------------------------------------------------------------
+class CDirectoryWatcher
+{
+    public:
+    CDirectoryWatcher();
+    ~CDirectoryWatcher();
+
+    bool Open(const char* dir);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return m_Fd >= 0;
+    }
+
+    // Waits up to timeoutMs for the first change, then collects what else is already queued
+    WatchResult Wait(int timeoutMs, std::vector<std::string>& fileNames);
+
+    private:
+    CDirectoryWatcher(const CDirectoryWatcher&);
+    CDirectoryWatcher& operator=(const CDirectoryWatcher&);
+
+    int m_Fd;
+};
@@ -0,0 +1,137 @@
+#include "file_list.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+static bool IsDotEntry(const char* name)
+{
+    return strcmp(name, ".") == 0 || strcmp(name, "..") == 0;
+}
+
+void ListDirectory(const std::string& dir, std::vector<std::string>* files, std::vector<std::string>* subdirs)
+{
+    std::string prefix = dir;
+    if (!prefix.empty() && prefix[prefix.size() - 1] != '/' && prefix[prefix.size() - 1] != '\\')
+    {
+        prefix += '/';
+    }
+
+#ifdef _WIN32
+    struct _finddata_t data;
+    intptr_t handle = _findfirst((prefix + "*").c_str(), &data);
+    if (handle == -1)
+        return;
+
+    do
+    {
+        if (IsDotEntry(data.name))
+            continue;
+
+        std::vector<std::string>* list = (data.attrib & _A_SUBDIR) ? subdirs : files;
+        if (list)
+        {
+            list->push_back(data.name);
+        }
+    } while (_findnext(handle, &data) == 0);
+    _findclose(handle);
+#else
+    DIR* handle = opendir(prefix.empty() ? "." : prefix.c_str());
+    if (!handle)
+        return;
+
+    struct dirent* entry;
+    while ((entry = readdir(handle)) != NULL)
+    {
+        if (IsDotEntry(entry->d_name))
+            continue;
+
+        // d_type saves a stat per entry, not every filesystem fills it in
+        bool isDir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
+        {
+            struct stat st;
+            isDir = stat((prefix + entry->d_name).c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+        }
+
+        std::vector<std::string>* list = isDir ? subdirs : files;
+        if (list)
+        {
+            list->push_back(entry->d_name);
+        }
+    }
+    closedir(handle);
+#endif
+
+    if (files)
+    {
+        std::sort(files->begin(), files->end());
+    }
+    if (subdirs)
+    {
+        std::sort(subdirs->begin(), subdirs->end());
+    }
+}
+
+bool EndsWith(const std::string& text, const char* suffix)
+{
+    const size_t length = strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+static bool IsDirectory(const std::string& path)
+{
+#ifdef _WIN32
+    struct _stat st;
+    return _stat(path.c_str(), &st) == 0 && (st.st_mode & _S_IFDIR) != 0;
+#else
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+bool MakeDirectory(const std::string& dir)
+{
+    for (size_t i = 1; i <= dir.size(); i++)
+    {
+        if (i < dir.size() && dir[i] != '/' && dir[i] != '\\')
+            continue;
+
+        // Skip drive letters
+        const std::string parent = dir.substr(0, i);
+        if (parent[parent.size() - 1] == ':' || IsDirectory(parent))
+            continue;
+#ifdef _WIN32
+        _mkdir(parent.c_str());
+#else
+        mkdir(parent.c_str(), 0777);
+#endif
+    }
+    return IsDirectory(dir);
+}
+
+bool ReadWholeFile(const std::string& path, std::string& contents)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    char buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        contents.append(buffer, read);
+    }
+    const bool ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
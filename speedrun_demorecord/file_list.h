@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Names of the files and subdirectories in dir (either may be NULL), sorted, without "." and "..". dir may end in a
+// slash or not.
+void ListDirectory(const std::string& dir, std::vector<std::string>* files, std::vector<std::string>* subdirs);
+
+bool EndsWith(const std::string& text, const char* suffix);
+
+// Creates dir and its parents, true if it exists afterwards
+bool MakeDirectory(const std::string& dir);
+
+bool ReadWholeFile(const std::string& path, std::string& contents);
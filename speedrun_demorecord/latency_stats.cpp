@@ -0,0 +1,209 @@
+#include "latency_stats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+uint64_t LatencyNow()
+{
+    // QueryPerformanceCounter on Windows, CLOCK_MONOTONIC elsewhere
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Index of the highest set bit, value must not be 0. Split in halves so it also works for 32-bit builds.
+static int HighestBit(uint64_t value)
+{
+    int bit = 0;
+    uint32_t word = (uint32_t)(value >> 32);
+    if (word != 0)
+    {
+        bit = 32;
+    }
+    else
+    {
+        word = (uint32_t)value;
+    }
+
+    while (word >>= 1)
+    {
+        bit++;
+    }
+    return bit;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: histogram
+//---------------------------------------------------------------------------------
+CLatencyHistogram::CLatencyHistogram()
+{
+    Reset();
+}
+
+void CLatencyHistogram::Reset()
+{
+    memset(m_Buckets, 0, sizeof(m_Buckets));
+    m_Count = 0;
+    m_Sum = 0;
+    m_Max = 0;
+}
+
+int CLatencyHistogram::GetBucketIndex(uint64_t nanoseconds)
+{
+    if (nanoseconds < LATENCY_LINEAR_BUCKETS)
+        return (int)nanoseconds;
+
+    // Top bit picks the power of two, the next LATENCY_SUB_BUCKET_BITS bits pick the sub bucket
+    const int bit = HighestBit(nanoseconds);
+    const int sub = (int)(nanoseconds >> (bit - LATENCY_SUB_BUCKET_BITS)) & (LATENCY_SUB_BUCKETS - 1);
+    return LATENCY_LINEAR_BUCKETS + (bit - 4) * LATENCY_SUB_BUCKETS + sub;
+}
+
+uint64_t CLatencyHistogram::GetBucketUpperBound(int bucket)
+{
+    if (bucket < LATENCY_LINEAR_BUCKETS)
+        return (uint64_t)bucket;
+
+    const int bit = (bucket - LATENCY_LINEAR_BUCKETS) / LATENCY_SUB_BUCKETS + 4;
+    const uint64_t sub = (uint64_t)((bucket - LATENCY_LINEAR_BUCKETS) % LATENCY_SUB_BUCKETS);
+    const uint64_t lower = (LATENCY_SUB_BUCKETS + sub) << (bit - LATENCY_SUB_BUCKET_BITS);
+    return lower + ((uint64_t)1 << (bit - LATENCY_SUB_BUCKET_BITS)) - 1;
+}
+
+void CLatencyHistogram::Record(uint64_t nanoseconds)
+{
+    m_Buckets[GetBucketIndex(nanoseconds)]++;
+    m_Count++;
+    m_Sum += nanoseconds;
+    if (nanoseconds > m_Max)
+    {
+        m_Max = nanoseconds;
+    }
+}
+
+uint64_t CLatencyHistogram::GetPercentile(double percentile) const
+{
+    if (m_Count == 0)
+        return 0;
+
+    // Rank of the sample we are after, 1 based
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)m_Count + 0.5);
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < LATENCY_BUCKET_COUNT; bucket++)
+    {
+        seen += m_Buckets[bucket];
+        if (seen >= rank)
+        {
+            uint64_t upper = GetBucketUpperBound(bucket);
+            return upper < m_Max ? upper : m_Max;
+        }
+    }
+    return m_Max;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: all probes
+//---------------------------------------------------------------------------------
+void CLatencyStats::Reset()
+{
+    for (int probe = 0; probe < LATENCY_PROBE_COUNT; probe++)
+    {
+        m_Histograms[probe].Reset();
+    }
+}
+
+const char* CLatencyStats::GetProbeName(LatencyProbe probe)
+{
+    static const char* const s_Names[LATENCY_PROBE_COUNT] = {
+        "LevelInit",
+        "LevelShutdown",
+        "ClientConnect",
+        "speedrun_start",
+        "speedrun_bookmark",
+        "stop_to_record",
+        "fs_createdir",
+        "fs_findfiles",
+        "fs_fileexists",
+        "fs_read",
+        "fs_write",
+        "fs_rename",
+        "io_flush",
+    };
+    return s_Names[probe];
+}
+
+void CLatencyStats::FormatTable(std::string& out) const
+{
+    char line[256];
+    snprintf(line, sizeof(line), "%-18s %8s %12s %12s %12s\n", "probe", "count", "p50 (us)", "p99 (us)", "max (us)");
+    out += line;
+
+    for (int probe = 0; probe < LATENCY_PROBE_COUNT; probe++)
+    {
+        const CLatencyHistogram& histogram = m_Histograms[probe];
+        snprintf(line,
+                 sizeof(line),
+                 "%-18s %8llu %12.1f %12.1f %12.1f\n",
+                 GetProbeName((LatencyProbe)probe),
+                 (unsigned long long)histogram.GetCount(),
+                 (double)histogram.GetPercentile(50.0) / 1000.0,
+                 (double)histogram.GetPercentile(99.0) / 1000.0,
+                 (double)histogram.GetMax() / 1000.0);
+        out += line;
+    }
+}
+
+void CLatencyStats::FormatJson(std::string& out, const char* extraMembers) const
+{
+    char text[256];
+    out += "{\n  \"unit\": \"ns\",\n  \"probes\": [\n";
+
+    for (int probe = 0; probe < LATENCY_PROBE_COUNT; probe++)
+    {
+        const CLatencyHistogram& histogram = m_Histograms[probe];
+        snprintf(text,
+                 sizeof(text),
+                 "    {\"name\": \"%s\", \"count\": %llu, \"mean\": %llu, \"p50\": %llu, \"p99\": %llu, \"max\": %llu, "
+                 "\"buckets\": [",
+                 GetProbeName((LatencyProbe)probe),
+                 (unsigned long long)histogram.GetCount(),
+                 (unsigned long long)histogram.GetMean(),
+                 (unsigned long long)histogram.GetPercentile(50.0),
+                 (unsigned long long)histogram.GetPercentile(99.0),
+                 (unsigned long long)histogram.GetMax());
+        out += text;
+
+        // [upper bound, count] of every bucket that has samples
+        bool first = true;
+        for (int bucket = 0; bucket < LATENCY_BUCKET_COUNT; bucket++)
+        {
+            if (histogram.GetBucketCount(bucket) == 0)
+                continue;
+
+            snprintf(text,
+                     sizeof(text),
+                     "%s[%llu, %u]",
+                     first ? "" : ", ",
+                     (unsigned long long)CLatencyHistogram::GetBucketUpperBound(bucket),
+                     histogram.GetBucketCount(bucket));
+            out += text;
+            first = false;
+        }
+
+        out += probe + 1 < LATENCY_PROBE_COUNT ? "]},\n" : "]}\n";
+    }
+
+    out += "  ]";
+    if (extraMembers && *extraMembers)
+    {
+        out += ",\n  ";
+        out += extraMembers;
+    }
+    out += "\n}\n";
+}
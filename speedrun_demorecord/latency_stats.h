@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Fixed bucket latency histograms for the plugin callbacks. Recording a sample is a handful of integer ops and never
+// allocates, so it is safe to leave on in the load path.
+
+enum LatencyProbe
+{
+    LATENCY_LEVELINIT,
+    LATENCY_LEVELSHUTDOWN,
+    LATENCY_CLIENTCONNECT,
+    LATENCY_SPEEDRUN_START,
+    LATENCY_SPEEDRUN_BOOKMARK,
+
+    // Time from LevelShutdown sending "stop" to ClientConnect sending the next "record"
+    LATENCY_STOP_TO_RECORD,
+
+    // Filesystem calls made by the plugin
+    LATENCY_FS_CREATEDIR,
+    LATENCY_FS_FINDFILES,
+    LATENCY_FS_FILEEXISTS,
+    LATENCY_FS_READ,
+    LATENCY_FS_WRITE,
+    LATENCY_FS_RENAME,
+
+    // Time speedrun_stop/Unload waited for the background writer
+    LATENCY_IO_FLUSH,
+
+    LATENCY_PROBE_COUNT
+};
+
+// Values below this are exact, above it every power of two is split into LATENCY_SUB_BUCKETS (12.5% resolution)
+#define LATENCY_LINEAR_BUCKETS 16
+#define LATENCY_SUB_BUCKET_BITS 3
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_BUCKET_COUNT (LATENCY_LINEAR_BUCKETS + (64 - 4) * LATENCY_SUB_BUCKETS)
+
+// Monotonic high resolution clock
+uint64_t LatencyNow();
+
+//---------------------------------------------------------------------------------
+// Purpose: log-linear histogram of nanosecond samples
+//---------------------------------------------------------------------------------
+class CLatencyHistogram
+{
+    public:
+    CLatencyHistogram();
+
+    void Record(uint64_t nanoseconds);
+    void Reset();
+
+    uint64_t GetCount() const
+    {
+        return m_Count;
+    }
+    uint64_t GetMax() const
+    {
+        return m_Max;
+    }
+    uint64_t GetMean() const
+    {
+        return m_Count ? m_Sum / m_Count : 0;
+    }
+
+    // Upper bound of the bucket holding the given percentile (0-100), clamped to the max seen
+    uint64_t GetPercentile(double percentile) const;
+
+    uint32_t GetBucketCount(int bucket) const
+    {
+        return m_Buckets[bucket];
+    }
+
+    static int GetBucketIndex(uint64_t nanoseconds);
+    static uint64_t GetBucketUpperBound(int bucket);
+
+    private:
+    uint32_t m_Buckets[LATENCY_BUCKET_COUNT];
+    uint64_t m_Count;
+    uint64_t m_Sum;
+    uint64_t m_Max;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: one histogram per probe
+//---------------------------------------------------------------------------------
+class CLatencyStats
+{
+    public:
+    void Record(LatencyProbe probe, uint64_t nanoseconds)
+    {
+        m_Histograms[probe].Record(nanoseconds);
+    }
+    void Reset();
+
+    const CLatencyHistogram& Get(LatencyProbe probe) const
+    {
+        return m_Histograms[probe];
+    }
+
+    // Human readable table for the console, microseconds
+    void FormatTable(std::string& out) const;
+
+    // Machine readable dump with the raw non-empty buckets, nanoseconds. extraMembers (e.g. "\"writer\": {...}") is
+    // added to the top level object.
+    void FormatJson(std::string& out, const char* extraMembers = NULL) const;
+
+    static const char* GetProbeName(LatencyProbe probe);
+
+    private:
+    CLatencyHistogram m_Histograms[LATENCY_PROBE_COUNT];
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: times the enclosing scope
+//---------------------------------------------------------------------------------
+class CLatencyTimer
+{
+    public:
+    CLatencyTimer(CLatencyStats& stats, LatencyProbe probe) : m_Stats(stats), m_Probe(probe), m_Start(LatencyNow()) {}
+    ~CLatencyTimer()
+    {
+        m_Stats.Record(m_Probe, LatencyNow() - m_Start);
+    }
+
+    private:
+    CLatencyTimer(const CLatencyTimer&);
+    CLatencyTimer& operator=(const CLatencyTimer&);
+
+    CLatencyStats& m_Stats;
+    LatencyProbe m_Probe;
+    uint64_t m_Start;
+};
+
+#define LATENCY_SCOPE_CONCAT2(a, b) a##b
+#define LATENCY_SCOPE_CONCAT(a, b) LATENCY_SCOPE_CONCAT2(a, b)
+#define LATENCY_SCOPE(stats, probe) CLatencyTimer LATENCY_SCOPE_CONCAT(latencyTimer, __LINE__)(stats, probe)
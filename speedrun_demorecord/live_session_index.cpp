@@ -0,0 +1,394 @@
+#include "live_session_index.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "file_list.h"
+#include "latency_stats.h"
+#include "session_journal.h"
+
+static void CopyString(char* dest, size_t destSize, const char* src)
+{
+    snprintf(dest, destSize, "%s", src ? src : "");
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: constructor
+//---------------------------------------------------------------------------------
+CLiveSessionIndex::CLiveSessionIndex()
+{
+    Clear();
+}
+
+void CLiveSessionIndex::Clear()
+{
+    m_Dir.clear();
+    m_Demos.clear();
+    m_DemoIndex.clear();
+    m_Maps.clear();
+    m_MapIndex.clear();
+    m_JournalOffset = 0;
+    m_JournalPending.clear();
+    m_TotalTicks = 0;
+    m_BytesRead = 0;
+    m_FirstChangedDemo = 0;
+}
+
+void CLiveSessionIndex::Open(const char* sessionDir)
+{
+    Clear();
+    m_Dir = sessionDir;
+    if (!m_Dir.empty() && m_Dir[m_Dir.size() - 1] != '/' && m_Dir[m_Dir.size() - 1] != '\\')
+    {
+        m_Dir += '/';
+    }
+    Scan();
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: following the session dir
+//---------------------------------------------------------------------------------
+bool CLiveSessionIndex::Scan()
+{
+    bool changed = UpdateJournal();
+
+    // Demos the journal lost, or all of them for speedrun_segment which has no journal
+    std::vector<std::string> files;
+    ListDirectory(m_Dir, &files, NULL);
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (EndsWith(files[i], ".dem") && m_DemoIndex.find(files[i]) == m_DemoIndex.end())
+        {
+            FindOrAddDemo(files[i]);
+            changed = true;
+        }
+    }
+
+    // Finished demos only cost a seek to the end to find out they are still finished
+    for (size_t i = 0; i < m_Demos.size(); i++)
+    {
+        changed |= UpdateDemo(i);
+    }
+    return changed;
+}
+
+bool CLiveSessionIndex::Update(const char* fileName)
+{
+    if (strcmp(fileName, JOURNAL_FILE_NAME) == 0)
+        return UpdateJournal();
+
+    if (!EndsWith(fileName, ".dem"))
+        return false;
+
+    const size_t count = m_Demos.size();
+    const size_t demo = FindOrAddDemo(fileName);
+    if (UpdateDemo(demo))
+        return true;
+
+    // Removed (or still empty) before anything was read from it
+    if (demo == count)
+    {
+        m_DemoIndex.erase(fileName);
+        m_Demos.pop_back();
+        m_FirstChangedDemo = std::min(m_FirstChangedDemo, m_Demos.size());
+    }
+    return false;
+}
+
+bool CLiveSessionIndex::UpdateJournal()
+{
+    const std::string path = m_Dir + JOURNAL_FILE_NAME;
+    FileTailResult result = ReadFileTail(path.c_str(), m_JournalOffset, FILE_TAIL_READ_SIZE, m_ReadBuffer);
+    if (result == FILETAIL_SHRANK)
+    {
+        // speedrun_resume cut a torn record off, the demos already known keep their place
+        m_JournalOffset = 0;
+        m_JournalPending.clear();
+        result = ReadFileTail(path.c_str(), 0, FILE_TAIL_READ_SIZE, m_ReadBuffer);
+    }
+    if (result != FILETAIL_GREW)
+        return false;
+
+    // The buffer is reused for the demos below
+    const size_t readSize = m_ReadBuffer.size();
+    m_JournalOffset += readSize;
+    m_BytesRead += readSize;
+    m_JournalPending.insert(m_JournalPending.end(), m_ReadBuffer.begin(), m_ReadBuffer.end());
+
+    std::vector<journalrecord_t> records;
+    size_t used = ReadJournal(m_JournalPending.data(), m_JournalPending.size(), records).validBytes;
+
+    // Records are fixed size, a corrupt one is skipped instead of holding up the ones after it
+    if (records.empty() && m_JournalPending.size() >= JOURNAL_RECORD_SIZE)
+    {
+        used = JOURNAL_RECORD_SIZE;
+    }
+    m_JournalPending.erase(m_JournalPending.begin(), m_JournalPending.begin() + (ptrdiff_t)used);
+
+    bool changed = false;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        if (records[i].type != JOURNAL_RECORD)
+            continue;
+
+        // A segmented reload records over the same name, the demo keeps its first place
+        const std::string name = std::string(records[i].demoName) + ".dem";
+        const size_t count = m_Demos.size();
+        const size_t demo = FindOrAddDemo(name);
+        if (m_Demos[demo].map == LIVESESSION_NO_MAP && records[i].mapName[0] != '\0')
+        {
+            SetDemoMap(demo, records[i].mapName);
+        }
+        changed |= m_Demos.size() != count;
+
+        // The record command comes before the engine creates the file, but the journal may be read late
+        if (demo == count)
+        {
+            UpdateDemo(demo);
+        }
+    }
+
+    // More may have come in than one read takes
+    if (readSize == FILE_TAIL_READ_SIZE)
+    {
+        changed |= UpdateJournal();
+    }
+    return changed;
+}
+
+bool CLiveSessionIndex::UpdateDemo(size_t index)
+{
+    LiveSessionDemo_t& demo = m_Demos[index];
+    const std::string path = m_Dir + demo.name;
+
+    bool changed = false;
+    for (;;)
+    {
+        FileTailResult result =
+            ReadFileTail(path.c_str(), demo.tail.GetBytesFed(), FILE_TAIL_READ_SIZE, m_ReadBuffer);
+
+        // Nothing is written after the stop message, a stopped demo that grows was recorded over
+        if (result == FILETAIL_SHRANK || (result == FILETAIL_GREW && demo.tail.IsComplete()))
+        {
+            demo.tail.Reset();
+            changed = true;
+            continue;
+        }
+        if (result != FILETAIL_GREW)
+            break;
+
+        m_BytesRead += m_ReadBuffer.size();
+        demo.tail.Feed(m_ReadBuffer.data(), m_ReadBuffer.size());
+        changed = true;
+        if (m_ReadBuffer.size() < FILE_TAIL_READ_SIZE)
+            break;
+    }
+    if (!changed)
+        return false;
+
+    if (demo.map == LIVESESSION_NO_MAP && !demo.tail.GetMapName().empty())
+    {
+        SetDemoMap(index, demo.tail.GetMapName());
+    }
+    SetDemoTicks(index, demo.tail.GetSummary().lastTick);
+    m_FirstChangedDemo = std::min(m_FirstChangedDemo, index);
+    return true;
+}
+
+size_t CLiveSessionIndex::FindOrAddDemo(const std::string& name)
+{
+    std::unordered_map<std::string, size_t>::const_iterator it = m_DemoIndex.find(name);
+    if (it != m_DemoIndex.end())
+        return it->second;
+
+    LiveSessionDemo_t demo;
+    demo.name = name;
+    demo.map = LIVESESSION_NO_MAP;
+    demo.ticks = 0;
+    m_DemoIndex[name] = m_Demos.size();
+    m_Demos.push_back(demo);
+    m_FirstChangedDemo = std::min(m_FirstChangedDemo, m_Demos.size() - 1);
+    return m_Demos.size() - 1;
+}
+
+void CLiveSessionIndex::SetDemoMap(size_t index, const std::string& mapName)
+{
+    uint32_t map;
+    std::unordered_map<std::string, uint32_t>::const_iterator it = m_MapIndex.find(mapName);
+    if (it != m_MapIndex.end())
+    {
+        map = it->second;
+    }
+    else
+    {
+        LiveSessionMap_t entry;
+        entry.name = mapName;
+        entry.ticks = 0;
+        entry.demos = 0;
+        map = (uint32_t)m_Maps.size();
+        m_MapIndex[mapName] = map;
+        m_Maps.push_back(entry);
+    }
+
+    // Only ever set once, the journal and the header name the same map
+    LiveSessionDemo_t& demo = m_Demos[index];
+    demo.map = map;
+    m_Maps[map].ticks += demo.ticks;
+    m_Maps[map].demos++;
+    m_FirstChangedDemo = std::min(m_FirstChangedDemo, index);
+}
+
+void CLiveSessionIndex::SetDemoTicks(size_t index, int32_t ticks)
+{
+    LiveSessionDemo_t& demo = m_Demos[index];
+    ticks = std::max(ticks, 0);
+
+    const int64_t delta = (int64_t)ticks - demo.ticks;
+    demo.ticks = ticks;
+    m_TotalTicks += delta;
+    if (demo.map != LIVESESSION_NO_MAP)
+    {
+        m_Maps[demo.map].ticks += delta;
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: writer
+//---------------------------------------------------------------------------------
+CLiveSessionFeed::CLiveSessionFeed() : m_pBlock(NULL), m_PublishedDemos(0) {}
+
+bool CLiveSessionFeed::Open(const char* name)
+{
+    Close();
+
+    if (!m_Memory.Create(name, sizeof(livesessionblock_t)))
+        return false;
+
+    m_pBlock = (livesessionblock_t*)m_Memory.GetData();
+
+    // Same as the live split feed, readers of a segment left behind never mistake the new state for the old one
+    const uint32_t sequence = m_pBlock->sequence.load(std::memory_order_relaxed);
+    m_pBlock->sequence.store((sequence | 1) + 1, std::memory_order_relaxed);
+    m_pBlock->magic = LIVESESSION_MAGIC;
+    m_pBlock->version = LIVESESSION_VERSION;
+    m_pBlock->size = (uint32_t)sizeof(livesessionblock_t);
+    m_PublishedDemos = 0;
+    return true;
+}
+
+void CLiveSessionFeed::Close()
+{
+    m_pBlock = NULL;
+    m_Memory.Close();
+}
+
+void CLiveSessionFeed::Publish(CLiveSessionIndex& index)
+{
+    if (!m_pBlock)
+        return;
+
+    const uint32_t sequence = m_pBlock->sequence.load(std::memory_order_relaxed);
+    m_pBlock->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    livesessionstate_t& state = m_pBlock->state;
+    const size_t demoCount = std::min<size_t>(index.GetDemoCount(), LIVESESSION_MAX_DEMOS);
+    const size_t mapCount = std::min<size_t>(index.GetMapCount(), LIVESESSION_MAX_MAPS);
+    state.updateTime = LatencyNow();
+    state.totalTicks = index.GetTotalTicks();
+    state.bytesRead = index.GetBytesRead();
+    state.demoCount = (uint32_t)demoCount;
+    state.mapCount = (uint32_t)mapCount;
+    state.flags = (index.IsRecording() ? LIVESESSION_RECORDING : 0) |
+                  (demoCount < index.GetDemoCount() || mapCount < index.GetMapCount() ? LIVESESSION_TRUNCATED : 0);
+    CopyString(state.sessionDir, sizeof(state.sessionDir), index.GetSessionDir().c_str());
+
+    // Usually only the demo being recorded
+    for (size_t i = std::min(index.GetFirstChangedDemo(), m_PublishedDemos); i < demoCount; i++)
+    {
+        const LiveSessionDemo_t& demo = index.GetDemo(i);
+        livesessiondemo_t& entry = state.demos[i];
+        const DemoSummary_t& summary = demo.tail.GetSummary();
+        CopyString(entry.name, sizeof(entry.name), demo.name.c_str());
+        entry.ticks = demo.ticks;
+        entry.map = demo.map < mapCount ? demo.map : LIVESESSION_NO_MAP;
+        entry.bytes = demo.tail.GetBytesFed();
+        entry.flags = (summary.reachedStop ? LIVESESSION_DEMO_STOPPED : 0) |
+                      (demo.tail.IsFinished() && !summary.reachedStop ? LIVESESSION_DEMO_CORRUPT : 0);
+        entry.reserved = 0;
+    }
+    m_PublishedDemos = demoCount;
+
+    for (size_t i = 0; i < mapCount; i++)
+    {
+        const LiveSessionMap_t& map = index.GetMap(i);
+        livesessionmap_t& entry = state.maps[i];
+        CopyString(entry.name, sizeof(entry.name), map.name.c_str());
+        entry.ticks = map.ticks;
+        entry.demos = map.demos;
+        entry.reserved = 0;
+    }
+
+    m_pBlock->sequence.store(sequence + 2, std::memory_order_release);
+    index.ClearChanges();
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: reader
+//---------------------------------------------------------------------------------
+CLiveSessionReader::CLiveSessionReader() : m_pBlock(NULL) {}
+
+bool CLiveSessionReader::Open(const char* name)
+{
+    Close();
+
+    if (!m_Memory.Open(name, sizeof(livesessionblock_t)))
+        return false;
+
+    const livesessionblock_t* block = (const livesessionblock_t*)m_Memory.GetData();
+    if (block->magic != LIVESESSION_MAGIC || block->version != LIVESESSION_VERSION ||
+        block->size < sizeof(livesessionblock_t))
+    {
+        m_Memory.Close();
+        return false;
+    }
+
+    m_pBlock = block;
+    return true;
+}
+
+void CLiveSessionReader::Close()
+{
+    m_pBlock = NULL;
+    m_Memory.Close();
+}
+
+bool CLiveSessionReader::TryRead(livesessionstate_t& state) const
+{
+    const uint32_t before = m_pBlock->sequence.load(std::memory_order_acquire);
+    if (before & 1)
+        return false;
+
+    // The summary, then only the entries in use. The counts may be torn as well, they are clamped before use and the
+    // copy is thrown away if they were.
+    const livesessionstate_t& shared = m_pBlock->state;
+    memcpy(&state, (const void*)&shared, offsetof(livesessionstate_t, demos));
+    const size_t demoCount = std::min<size_t>(state.demoCount, LIVESESSION_MAX_DEMOS);
+    const size_t mapCount = std::min<size_t>(state.mapCount, LIVESESSION_MAX_MAPS);
+    memcpy(state.demos, (const void*)shared.demos, demoCount * sizeof(livesessiondemo_t));
+    memcpy(state.maps, (const void*)shared.maps, mapCount * sizeof(livesessionmap_t));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return m_pBlock->sequence.load(std::memory_order_relaxed) == before;
+}
+
+bool CLiveSessionReader::Read(livesessionstate_t& state, int maxAttempts) const
+{
+    for (int attempt = 0; attempt < maxAttempts; attempt++)
+    {
+        if (TryRead(state))
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "demo_tail.h"
+#include "shared_memory.h"
+
+// Live session index: follows a session dir while the run is being recorded, for overlays and dashboards that want
+// the demos and the ticks per map without waiting for speedrun_stop. The journal gives the recording order, each demo
+// is parsed from the bytes appended to it since the last look (CDemoTail), so a long run costs one pass over every
+// byte however often it is asked.
+//
+// session_indexd keeps the index and publishes it in shared memory the way the live split feed does: a seqlock the
+// daemon never waits on, so any number of clients copy the summary with a memcpy and no system call.
+
+#define LIVESESSION_SHM_NAME "speedrun_demorecord_session"
+
+// "SRI1"
+#define LIVESESSION_MAGIC 0x31495253u
+#define LIVESESSION_VERSION 1
+
+#define LIVESESSION_DIR_SIZE 260
+#define LIVESESSION_MAP_SIZE 64
+#define LIVESESSION_DEMO_SIZE 96
+
+// What the block has room for, a session with more leaves the newest out and says so with LIVESESSION_TRUNCATED
+#define LIVESESSION_MAX_DEMOS 1024
+#define LIVESESSION_MAX_MAPS 256
+
+// How often Read tries before giving up on a daemon that keeps getting in the way
+#define LIVESESSION_READ_ATTEMPTS 64
+
+// Map index of a demo whose map isn't known yet
+#define LIVESESSION_NO_MAP 0xffffffffu
+
+struct LiveSessionDemo_t
+{
+    // File name inside the session dir, "d1_canals_06_1.dem"
+    std::string name;
+
+    // Index into the maps, from the journal or else the demo header, LIVESESSION_NO_MAP before either is in
+    uint32_t map;
+
+    // Ticks the demo adds to the run like get_demo_tick_count(), 0 while it has none
+    int32_t ticks;
+
+    CDemoTail tail;
+};
+
+struct LiveSessionMap_t
+{
+    std::string name;
+
+    // Ticks of every demo recorded on the map, retries included, and how many there were
+    int64_t ticks;
+    uint32_t demos;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: the index. Scan looks at everything, Update at the one file a watcher said changed.
+//---------------------------------------------------------------------------------
+class CLiveSessionIndex
+{
+    public:
+    CLiveSessionIndex();
+
+    void Clear();
+
+    // Forgets everything and scans sessionDir
+    void Open(const char* sessionDir);
+
+    // New journal records, demos the journal doesn't know about (following by name), and growth of every demo.
+    // For the start, and for when the watcher can't tell what changed. True if anything did.
+    bool Scan();
+
+    // fileName (no dir) changed, only that file is read
+    bool Update(const char* fileName);
+
+    const std::string& GetSessionDir() const
+    {
+        return m_Dir;
+    }
+    size_t GetDemoCount() const
+    {
+        return m_Demos.size();
+    }
+    const LiveSessionDemo_t& GetDemo(size_t demo) const
+    {
+        return m_Demos[demo];
+    }
+
+    // In the order the maps were first recorded on
+    size_t GetMapCount() const
+    {
+        return m_Maps.size();
+    }
+    const LiveSessionMap_t& GetMap(size_t map) const
+    {
+        return m_Maps[map];
+    }
+    int64_t GetTotalTicks() const
+    {
+        return m_TotalTicks;
+    }
+
+    // The newest demo has no stop message yet
+    bool IsRecording() const
+    {
+        return !m_Demos.empty() && !m_Demos.back().tail.GetSummary().reachedStop;
+    }
+
+    // Bytes read from the session dir since Open, each byte once unless a demo was recorded over
+    uint64_t GetBytesRead() const
+    {
+        return m_BytesRead;
+    }
+
+    // Lowest demo that changed since the last ClearChanges, GetDemoCount() if none did. A publisher only rewrites
+    // the demos from here on.
+    size_t GetFirstChangedDemo() const
+    {
+        return m_FirstChangedDemo;
+    }
+    void ClearChanges()
+    {
+        m_FirstChangedDemo = m_Demos.size();
+    }
+
+    private:
+    CLiveSessionIndex(const CLiveSessionIndex&);
+    CLiveSessionIndex& operator=(const CLiveSessionIndex&);
+
+    bool UpdateJournal();
+    bool UpdateDemo(size_t demo);
+    size_t FindOrAddDemo(const std::string& name);
+    void SetDemoMap(size_t demo, const std::string& mapName);
+    void SetDemoTicks(size_t demo, int32_t ticks);
+
+    // Ends in a slash
+    std::string m_Dir;
+
+    std::vector<LiveSessionDemo_t> m_Demos;
+    std::unordered_map<std::string, size_t> m_DemoIndex;
+    std::vector<LiveSessionMap_t> m_Maps;
+    std::unordered_map<std::string, uint32_t> m_MapIndex;
+
+    // Journal bytes read, and the start of a record that was only partly there
+    uint64_t m_JournalOffset;
+    std::vector<uint8_t> m_JournalPending;
+
+    std::vector<uint8_t> m_ReadBuffer;
+    int64_t m_TotalTicks;
+    uint64_t m_BytesRead;
+    size_t m_FirstChangedDemo;
+};
+
+enum LiveSessionFlags
+{
+    // The newest demo has no stop message yet
+    LIVESESSION_RECORDING = (1 << 0),
+
+    // More demos or maps than the block holds
+    LIVESESSION_TRUNCATED = (1 << 1),
+};
+
+enum LiveSessionDemoFlags
+{
+    LIVESESSION_DEMO_STOPPED = (1 << 0),
+
+    // A message the parser doesn't know, the ticks are those before it
+    LIVESESSION_DEMO_CORRUPT = (1 << 1),
+};
+
+struct livesessiondemo_t
+{
+    char name[LIVESESSION_DEMO_SIZE];
+    int32_t ticks;
+
+    // Index into maps, LIVESESSION_NO_MAP if unknown
+    uint32_t map;
+    uint64_t bytes;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+struct livesessionmap_t
+{
+    char name[LIVESESSION_MAP_SIZE];
+    int64_t ticks;
+    uint32_t demos;
+    uint32_t reserved;
+};
+
+struct livesessionstate_t
+{
+    // LatencyNow() of the last change
+    uint64_t updateTime;
+
+    int64_t totalTicks;
+    uint64_t bytesRead;
+
+    // Entries of demos and maps in use
+    uint32_t demoCount;
+    uint32_t mapCount;
+    uint32_t flags;
+    uint32_t reserved;
+
+    char sessionDir[LIVESESSION_DIR_SIZE];
+
+    livesessiondemo_t demos[LIVESESSION_MAX_DEMOS];
+    livesessionmap_t maps[LIVESESSION_MAX_MAPS];
+};
+
+struct livesessionblock_t
+{
+    uint32_t magic;
+    uint32_t version;
+
+    // sizeof(livesessionblock_t), later versions only add to the end
+    uint32_t size;
+
+    // Odd while the state is being written
+    std::atomic<uint32_t> sequence;
+
+    livesessionstate_t state;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: the daemon's side, publishes an index
+//---------------------------------------------------------------------------------
+class CLiveSessionFeed
+{
+    public:
+    CLiveSessionFeed();
+
+    bool Open(const char* name = LIVESESSION_SHM_NAME);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return m_pBlock != NULL;
+    }
+
+    // Rewrites the summary, the maps and the demos that changed, and clears the index's changes
+    void Publish(CLiveSessionIndex& index);
+
+    private:
+    CLiveSessionFeed(const CLiveSessionFeed&);
+    CLiveSessionFeed& operator=(const CLiveSessionFeed&);
+
+    CSharedMemory m_Memory;
+    livesessionblock_t* m_pBlock;
+
+    // Demos in the block, a demo the index added since is written whether it changed or not
+    size_t m_PublishedDemos;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: a client's side, maps the segment read-only. A read copies the summary and only the demos and maps in use.
+//---------------------------------------------------------------------------------
+class CLiveSessionReader
+{
+    public:
+    CLiveSessionReader();
+
+    // False if there is no segment or it isn't a live session block of this version
+    bool Open(const char* name = LIVESESSION_SHM_NAME);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return m_pBlock != NULL;
+    }
+
+    // One attempt, false if the daemon was writing at the time. Never waits.
+    bool TryRead(livesessionstate_t& state) const;
+
+    // Up to maxAttempts of TryRead
+    bool Read(livesessionstate_t& state, int maxAttempts = LIVESESSION_READ_ATTEMPTS) const;
+
+    // Changes with every update, a client that only wants changes compares this first
+    uint32_t GetSequence() const
+    {
+        return m_pBlock->sequence.load(std::memory_order_acquire);
+    }
+
+    private:
+    CLiveSessionReader(const CLiveSessionReader&);
+    CLiveSessionReader& operator=(const CLiveSessionReader&);
+
+    CSharedMemory m_Memory;
+    const livesessionblock_t* m_pBlock;
+};
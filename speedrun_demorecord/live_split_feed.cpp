@@ -0,0 +1,225 @@
+#include "live_split_feed.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "latency_stats.h"
+
+static void CopyString(char* dest, size_t destSize, const char* src)
+{
+    snprintf(dest, destSize, "%s", src ? src : "");
+}
+
+uint64_t GetLiveSplitRunTime(const livesplitstate_t& state, uint64_t now)
+{
+    if (state.runStartTime == 0)
+        return 0;
+
+    const uint64_t end = state.runStopTime != 0 ? state.runStopTime : now;
+    return end > state.runStartTime ? end - state.runStartTime : 0;
+}
+
+uint64_t GetLiveSplitLoadTime(const livesplitstate_t& state, uint64_t now)
+{
+    uint64_t loadTime = state.loadTime;
+    if (state.loadStartTime != 0 && now > state.loadStartTime)
+    {
+        loadTime += now - state.loadStartTime;
+    }
+    return loadTime;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: writer
+//---------------------------------------------------------------------------------
+CLiveSplitFeed::CLiveSplitFeed() : m_pBlock(NULL)
+{
+    memset(&m_State, 0, sizeof(m_State));
+}
+
+bool CLiveSplitFeed::Open(const char* name)
+{
+    Close();
+
+    if (!m_Memory.Create(name, sizeof(livesplitblock_t)))
+        return false;
+
+    m_pBlock = (livesplitblock_t*)m_Memory.GetData();
+
+    // A segment left behind by a crashed game may still have readers, keep its sequence going from the next even
+    // number so none of them mistakes the new state for the one they last read
+    const uint32_t sequence = m_pBlock->sequence.load(std::memory_order_relaxed);
+    m_pBlock->sequence.store((sequence | 1) + 1, std::memory_order_relaxed);
+    m_pBlock->magic = LIVESPLIT_MAGIC;
+    m_pBlock->version = LIVESPLIT_VERSION;
+    m_pBlock->size = (uint32_t)sizeof(livesplitblock_t);
+    Publish(LatencyNow());
+    return true;
+}
+
+void CLiveSplitFeed::Close()
+{
+    m_pBlock = NULL;
+    m_Memory.Close();
+}
+
+void CLiveSplitFeed::Publish(uint64_t now)
+{
+    m_State.updateTime = now;
+    if (!m_pBlock)
+        return;
+
+    const uint32_t sequence = m_pBlock->sequence.load(std::memory_order_relaxed);
+    m_pBlock->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&m_pBlock->state, &m_State, sizeof(m_State));
+    m_pBlock->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: run state
+//---------------------------------------------------------------------------------
+void CLiveSplitFeed::StartRun(uint32_t mode)
+{
+    const uint64_t now = LatencyNow();
+    m_State.runStartTime = now;
+    m_State.runStopTime = 0;
+    m_State.loadTime = 0;
+    m_State.loadStartTime = 0;
+    m_State.loadCount = 0;
+    m_State.splitIndex = 0;
+    m_State.retries = 0;
+    m_State.mode = mode;
+    m_State.flags = LIVESPLIT_RUNNING;
+
+    // The map the run starts on counts once it is entered, not the one the command was typed on
+    m_State.mapName[0] = '\0';
+    m_State.demoName[0] = '\0';
+    Publish(now);
+}
+
+void CLiveSplitFeed::StopRun()
+{
+    if (!(m_State.flags & LIVESPLIT_RUNNING))
+        return;
+
+    const uint64_t now = LatencyNow();
+    if (m_State.loadStartTime != 0)
+    {
+        m_State.loadTime += now - m_State.loadStartTime;
+        m_State.loadCount++;
+        m_State.loadStartTime = 0;
+    }
+    m_State.runStopTime = now;
+    m_State.flags = 0;
+    Publish(now);
+}
+
+void CLiveSplitFeed::BeginLoad(uint64_t now)
+{
+    if (m_State.loadStartTime != 0 || !(m_State.flags & LIVESPLIT_RUNNING))
+        return;
+
+    m_State.loadStartTime = now;
+    m_State.flags |= LIVESPLIT_LOADING;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: engine callbacks
+//---------------------------------------------------------------------------------
+void CLiveSplitFeed::OnLevelInit(const char* mapName)
+{
+    const uint64_t now = LatencyNow();
+
+    // Loading from the menu has no LevelShutdown first
+    BeginLoad(now);
+
+    if ((m_State.flags & LIVESPLIT_RUNNING) && strcmp(m_State.mapName, mapName ? mapName : "") != 0)
+    {
+        m_State.splitIndex++;
+    }
+    CopyString(m_State.mapName, sizeof(m_State.mapName), mapName);
+    Publish(now);
+}
+
+void CLiveSplitFeed::OnLevelShutdown()
+{
+    // Called more than once per map change, only the first one starts the load
+    if (m_State.loadStartTime != 0 || !(m_State.flags & LIVESPLIT_RUNNING))
+        return;
+
+    const uint64_t now = LatencyNow();
+    BeginLoad(now);
+    Publish(now);
+}
+
+void CLiveSplitFeed::OnClientConnect(const char* demoName, int retries)
+{
+    CopyString(m_State.demoName, sizeof(m_State.demoName), demoName);
+    m_State.retries = retries;
+    Publish(LatencyNow());
+}
+
+void CLiveSplitFeed::OnClientActive()
+{
+    if (m_State.loadStartTime == 0)
+        return;
+
+    const uint64_t now = LatencyNow();
+    m_State.loadTime += now - m_State.loadStartTime;
+    m_State.loadCount++;
+    m_State.loadStartTime = 0;
+    m_State.flags &= ~(uint32_t)LIVESPLIT_LOADING;
+    Publish(now);
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: reader
+//---------------------------------------------------------------------------------
+CLiveSplitReader::CLiveSplitReader() : m_pBlock(NULL) {}
+
+bool CLiveSplitReader::Open(const char* name)
+{
+    Close();
+
+    if (!m_Memory.Open(name, sizeof(livesplitblock_t)))
+        return false;
+
+    const livesplitblock_t* block = (const livesplitblock_t*)m_Memory.GetData();
+    if (block->magic != LIVESPLIT_MAGIC || block->version != LIVESPLIT_VERSION ||
+        block->size < sizeof(livesplitblock_t))
+    {
+        m_Memory.Close();
+        return false;
+    }
+
+    m_pBlock = block;
+    return true;
+}
+
+void CLiveSplitReader::Close()
+{
+    m_pBlock = NULL;
+    m_Memory.Close();
+}
+
+bool CLiveSplitReader::TryRead(livesplitstate_t& state) const
+{
+    const uint32_t before = m_pBlock->sequence.load(std::memory_order_acquire);
+    if (before & 1)
+        return false;
+
+    memcpy(&state, (const void*)&m_pBlock->state, sizeof(state));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return m_pBlock->sequence.load(std::memory_order_relaxed) == before;
+}
+
+bool CLiveSplitReader::Read(livesplitstate_t& state, int maxAttempts) const
+{
+    for (int attempt = 0; attempt < maxAttempts; attempt++)
+    {
+        if (TryRead(state))
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "shared_memory.h"
+
+// Live split feed: the state of the run in a named shared memory segment, for external timers (LiveSplit and
+// friends) that would otherwise poll game memory or parse the console.
+//
+// The block is a seqlock. The plugin makes the sequence odd, rewrites the state and makes it even again, it never
+// waits for anyone. Readers map the segment read-only, copy the state and keep the copy if the sequence was the same
+// even number before and after. A read is a few hundred bytes of memcpy and no system call, so timers can read at
+// any rate without the game noticing.
+
+#define LIVESPLIT_SHM_NAME "speedrun_demorecord_livesplit"
+
+// "SRL1"
+#define LIVESPLIT_MAGIC 0x314c5253u
+#define LIVESPLIT_VERSION 1
+
+#define LIVESPLIT_MAP_SIZE 64
+#define LIVESPLIT_DEMO_SIZE 256
+
+// How often Read tries before giving up on a writer that keeps getting in the way
+#define LIVESPLIT_READ_ATTEMPTS 64
+
+enum LiveSplitFlags
+{
+    // Between speedrun_start/segment/resume and speedrun_stop
+    LIVESPLIT_RUNNING = (1 << 0),
+    LIVESPLIT_LOADING = (1 << 1),
+};
+
+// Times are LatencyNow() nanoseconds: the steady clock (QueryPerformanceCounter, CLOCK_MONOTONIC), which is the same
+// in every process on the machine, so a reader turns them into a live clock with its own LatencyNow().
+struct livesplitstate_t
+{
+    // speedrun_start (or resume), and speedrun_stop, 0 while the run goes on
+    uint64_t runStartTime;
+    uint64_t runStopTime;
+
+    // Finished loads of the run: from LevelShutdown, or LevelInit when no map was running, to the player spawning
+    uint64_t loadTime;
+
+    // Start of the load in progress, 0 if there is none
+    uint64_t loadStartTime;
+
+    // Last change of anything in here
+    uint64_t updateTime;
+
+    uint32_t loadCount;
+
+    // Maps entered during the run, the first one included. Reloads and deaths on the same map don't count.
+    uint32_t splitIndex;
+
+    int32_t retries;
+
+    // RecordingMode
+    uint32_t mode;
+    uint32_t flags;
+    uint32_t reserved;
+
+    char mapName[LIVESPLIT_MAP_SIZE];
+    char demoName[LIVESPLIT_DEMO_SIZE];
+};
+
+struct livesplitblock_t
+{
+    uint32_t magic;
+    uint32_t version;
+
+    // sizeof(livesplitblock_t), later versions only add to the end
+    uint32_t size;
+
+    // Odd while the state is being written. std::atomic<uint32_t> is lock-free, so it works across processes.
+    std::atomic<uint32_t> sequence;
+
+    livesplitstate_t state;
+};
+
+// Run time as a timer shows it, now being the reader's LatencyNow(). Game time is the run time minus the load time.
+uint64_t GetLiveSplitRunTime(const livesplitstate_t& state, uint64_t now);
+uint64_t GetLiveSplitLoadTime(const livesplitstate_t& state, uint64_t now);
+
+//---------------------------------------------------------------------------------
+// Purpose: the plugin's side. Keeps the state, follows the engine callbacks and speedrun_* commands, and republishes
+// the whole state on every change. Without a segment (Open failed) it still keeps the state.
+//---------------------------------------------------------------------------------
+class CLiveSplitFeed
+{
+    public:
+    CLiveSplitFeed();
+
+    bool Open(const char* name = LIVESPLIT_SHM_NAME);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return m_pBlock != NULL;
+    }
+    const livesplitstate_t& GetState() const
+    {
+        return m_State;
+    }
+
+    // speedrun_start/segment/resume and speedrun_stop
+    void StartRun(uint32_t mode);
+    void StopRun();
+
+    // Engine callbacks, the demo name and retries are the session's once ClientConnect sent the record command
+    void OnLevelInit(const char* mapName);
+    void OnLevelShutdown();
+    void OnClientConnect(const char* demoName, int retries);
+    void OnClientActive();
+
+    private:
+    CLiveSplitFeed(const CLiveSplitFeed&);
+    CLiveSplitFeed& operator=(const CLiveSplitFeed&);
+
+    void BeginLoad(uint64_t now);
+    void Publish(uint64_t now);
+
+    CSharedMemory m_Memory;
+    livesplitblock_t* m_pBlock;
+    livesplitstate_t m_State;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: a timer's side, maps the segment read-only
+//---------------------------------------------------------------------------------
+class CLiveSplitReader
+{
+    public:
+    CLiveSplitReader();
+
+    // False if there is no segment or it isn't a live split block of this version
+    bool Open(const char* name = LIVESPLIT_SHM_NAME);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return m_pBlock != NULL;
+    }
+
+    // One attempt, false if the plugin was writing at the time. Never waits.
+    bool TryRead(livesplitstate_t& state) const;
+
+    // Up to maxAttempts of TryRead
+    bool Read(livesplitstate_t& state, int maxAttempts = LIVESPLIT_READ_ATTEMPTS) const;
+
+    // Changes with every update, a reader that only wants changes compares this first
+    uint32_t GetSequence() const
+    {
+        return m_pBlock->sequence.load(std::memory_order_acquire);
+    }
+
+    private:
+    CLiveSplitReader(const CLiveSplitReader&);
+    CLiveSplitReader& operator=(const CLiveSplitReader&);
+
+    CSharedMemory m_Memory;
+    const livesplitblock_t* m_pBlock;
+};
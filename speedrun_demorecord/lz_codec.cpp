@@ -0,0 +1,179 @@
+#include "lz_codec.h"
+
+#include <string.h>
+#include <vector>
+
+#define LZ_HASH_BITS 14
+
+static uint32_t HashSequence(const uint8_t* p)
+{
+    uint32_t sequence;
+    memcpy(&sequence, p, sizeof(sequence));
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Length bytes after a nibble of 15
+static bool PutLength(uint8_t* dst, size_t capacity, size_t& out, size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        if (out >= capacity)
+            return false;
+        dst[out++] = 255;
+    }
+    if (out >= capacity)
+        return false;
+    dst[out++] = (uint8_t)length;
+    return true;
+}
+
+static bool GetLength(const uint8_t* src, size_t size, size_t& in, size_t& length)
+{
+    for (;;)
+    {
+        if (in >= size)
+            return false;
+        const uint8_t byte = src[in++];
+        length += byte;
+        if (byte != 255)
+            return true;
+    }
+}
+
+// matchLength 0 for the final literals-only sequence
+static bool PutSequence(uint8_t* dst,
+                        size_t capacity,
+                        size_t& out,
+                        const uint8_t* literals,
+                        size_t literalCount,
+                        size_t matchOffset,
+                        size_t matchLength)
+{
+    if (out >= capacity)
+        return false;
+
+    const size_t matchCode = matchLength > 0 ? matchLength - LZ_MIN_MATCH : 0;
+    uint8_t& token = dst[out++];
+    token = (uint8_t)(((literalCount < 15 ? literalCount : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+
+    if (literalCount >= 15 && !PutLength(dst, capacity, out, literalCount - 15))
+        return false;
+    if (capacity - out < literalCount)
+        return false;
+    memcpy(dst + out, literals, literalCount);
+    out += literalCount;
+
+    if (matchLength == 0)
+        return true;
+
+    if (capacity - out < 2)
+        return false;
+    dst[out++] = (uint8_t)(matchOffset & 0xFF);
+    dst[out++] = (uint8_t)(matchOffset >> 8);
+    return matchCode < 15 || PutLength(dst, capacity, out, matchCode - 15);
+}
+
+size_t LzCompressBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t LzCompress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity)
+{
+    if (size > 0xFFFFFFFFu)
+        return 0;
+
+    // Last position each hashed 4 byte sequence was seen at
+    std::vector<uint32_t> table((size_t)1 << LZ_HASH_BITS, 0);
+
+    size_t out = 0;
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + LZ_MIN_MATCH <= size)
+    {
+        const uint32_t hash = HashSequence(src + pos);
+        const size_t candidate = table[hash];
+        table[hash] = (uint32_t)pos;
+
+        if (candidate >= pos || pos - candidate > LZ_MAX_OFFSET ||
+            memcmp(src + candidate, src + pos, LZ_MIN_MATCH) != 0)
+        {
+            // Skip faster through data that doesn't compress
+            pos += 1 + ((pos - anchor) >> 6);
+            continue;
+        }
+
+        size_t length = LZ_MIN_MATCH;
+        while (pos + length < size && src[candidate + length] == src[pos + length])
+        {
+            length++;
+        }
+
+        if (!PutSequence(dst, capacity, out, src + anchor, pos - anchor, pos - candidate, length))
+            return 0;
+
+        // Keep the table useful for the next match without hashing every byte of this one
+        if (pos + length + LZ_MIN_MATCH <= size)
+        {
+            table[HashSequence(src + pos + length - 2)] = (uint32_t)(pos + length - 2);
+        }
+        pos += length;
+        anchor = pos;
+    }
+
+    if (!PutSequence(dst, capacity, out, src + anchor, size - anchor, 0, 0))
+        return 0;
+    return out;
+}
+
+bool LzDecompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize)
+{
+    size_t in = 0;
+    size_t out = 0;
+    for (;;)
+    {
+        if (in >= size)
+            return false;
+        const uint8_t token = src[in++];
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !GetLength(src, size, in, literalCount))
+            return false;
+        if (size - in < literalCount || dstSize - out < literalCount)
+            return false;
+        memcpy(dst + out, src + in, literalCount);
+        in += literalCount;
+        out += literalCount;
+
+        if (in == size)
+            return out == dstSize;
+
+        if (size - in < 2)
+            return false;
+        const size_t matchOffset = (size_t)src[in] | ((size_t)src[in + 1] << 8);
+        in += 2;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !GetLength(src, size, in, matchLength))
+            return false;
+        matchLength += LZ_MIN_MATCH;
+
+        if (matchOffset == 0 || matchOffset > out || dstSize - out < matchLength)
+            return false;
+
+        // Overlapping matches repeat the last matchOffset bytes
+        const uint8_t* match = dst + out - matchOffset;
+        if (matchOffset >= matchLength)
+        {
+            memcpy(dst + out, match, matchLength);
+        }
+        else
+        {
+            for (size_t i = 0; i < matchLength; i++)
+            {
+                dst[out + i] = match[i];
+            }
+        }
+        out += matchLength;
+    }
+}
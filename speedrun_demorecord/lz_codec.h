@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Small self-contained LZ77 codec for archive chunks, byte oriented like LZ4: every sequence is a token (literal
+// count in the high nibble, match length - LZ_MIN_MATCH in the low one, 15 meaning more length bytes follow), the
+// literals, and a 16-bit little endian match offset. The last sequence has literals only. Fast rather than small,
+// decompression runs at memory speed and never reads or writes outside the given buffers, whatever the input.
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 0xFFFF
+
+// Worst case compressed size of size bytes
+size_t LzCompressBound(size_t size);
+
+// Returns the compressed size, 0 if it doesn't fit in capacity or size is over 4 GB
+size_t LzCompress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity);
+
+// True only if src decompresses to exactly dstSize bytes
+bool LzDecompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize);
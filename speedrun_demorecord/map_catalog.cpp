@@ -0,0 +1,303 @@
+#include "map_catalog.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+static std::string ToLower(const std::string& text)
+{
+    std::string lower = text;
+    for (size_t i = 0; i < lower.size(); i++)
+    {
+        lower[i] = (char)tolower((unsigned char)lower[i]);
+    }
+    return lower;
+}
+
+std::string ParseChapterMap(const std::string& config)
+{
+    // Commands end at a line break or ';', like the engine splits them
+    size_t start = 0;
+    while (start < config.size())
+    {
+        size_t end = config.find_first_of("\r\n;", start);
+        if (end == std::string::npos)
+        {
+            end = config.size();
+        }
+
+        const std::string command = config.substr(start, end - start);
+        start = end + 1;
+
+        const size_t verb = command.find_first_not_of(" \t");
+        if (verb == std::string::npos || command.size() - verb < 4 || ToLower(command.substr(verb, 3)) != "map" ||
+            (command[verb + 3] != ' ' && command[verb + 3] != '\t'))
+            continue;
+
+        const size_t name = command.find_first_not_of(" \t\"", verb + 3);
+        if (name == std::string::npos)
+            continue;
+        const size_t nameEnd = command.find_first_of(" \t\"", name);
+        return command.substr(name, nameEnd == std::string::npos ? std::string::npos : nameEnd - name);
+    }
+    return "";
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: constructor
+//---------------------------------------------------------------------------------
+CMapCatalog::CMapCatalog() : m_MapDirTime(0), m_SaveDirTime(0), m_ChapterDirTime(0), m_bListed(false) {}
+
+void CMapCatalog::Clear()
+{
+    m_Maps.clear();
+    m_LoadedMaps.clear();
+    m_Saves.clear();
+    m_Chapters.clear();
+    m_MapDirTime = 0;
+    m_SaveDirTime = 0;
+    m_ChapterDirTime = 0;
+    m_bListed = false;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: refreshing
+//---------------------------------------------------------------------------------
+CatalogRefreshResult_t CMapCatalog::Refresh(IMapCatalogSource& source)
+{
+    CatalogRefreshResult_t result;
+    result.listings = 0;
+    result.configReads = 0;
+    result.bChanged = false;
+
+    std::vector<Entry_t> maps;
+    if (ListNames(source, CATALOG_MAP_WILDCARD, ".bsp", m_MapDirTime, maps, result))
+    {
+        // Maps the engine loaded that no listing showed stay known
+        for (size_t i = 0; i < m_LoadedMaps.size(); i++)
+        {
+            InsertEntry(maps, m_LoadedMaps[i]);
+        }
+        result.bChanged |= !SameKeys(maps, m_Maps);
+        m_Maps.swap(maps);
+    }
+
+    std::vector<Entry_t> saves;
+    if (ListNames(source, CATALOG_SAVE_WILDCARD, ".sav", m_SaveDirTime, saves, result))
+    {
+        result.bChanged |= !SameKeys(saves, m_Saves);
+        m_Saves.swap(saves);
+    }
+
+    RefreshChapters(source, result);
+    m_bListed = true;
+    return result;
+}
+
+CatalogRefreshResult_t CMapCatalog::RefreshSaves(IMapCatalogSource& source)
+{
+    CatalogRefreshResult_t result;
+    result.listings = 0;
+    result.configReads = 0;
+    result.bChanged = false;
+
+    std::vector<Entry_t> saves;
+    int64_t dirTime = 0;
+    ListNames(source, CATALOG_SAVE_WILDCARD, ".sav", dirTime, saves, result);
+    result.bChanged = !SameKeys(saves, m_Saves);
+    m_Saves.swap(saves);
+    m_SaveDirTime = dirTime;
+    return result;
+}
+
+// Lists the directory of wildcard into entries unless its time says it is unchanged, true if it was listed
+bool CMapCatalog::ListNames(IMapCatalogSource& source,
+                            const char* wildcard,
+                            const char* extension,
+                            int64_t& dirTime,
+                            std::vector<Entry_t>& entries,
+                            CatalogRefreshResult_t& result)
+{
+    const std::string dir(wildcard, strrchr(wildcard, '/') - wildcard);
+    const int64_t time = source.GetFileTime(dir.c_str());
+    if (time != 0 && time == dirTime)
+        return false;
+
+    std::vector<std::string> fileNames;
+    source.FindFiles(wildcard, fileNames);
+    result.listings++;
+    dirTime = time;
+
+    entries.clear();
+    entries.reserve(fileNames.size());
+    for (size_t i = 0; i < fileNames.size(); i++)
+    {
+        Entry_t entry;
+        entry.key = MakeKey(fileNames[i].c_str(), extension);
+        entry.name = fileNames[i].substr(0, entry.key.size());
+        entries.push_back(entry);
+    }
+
+    // Search paths can list a name more than once, the first one wins like in the engine
+    std::stable_sort(
+        entries.begin(), entries.end(), [](const Entry_t& a, const Entry_t& b) { return a.key < b.key; });
+    entries.erase(std::unique(entries.begin(),
+                              entries.end(),
+                              [](const Entry_t& a, const Entry_t& b) { return a.key == b.key; }),
+                  entries.end());
+    return true;
+}
+
+void CMapCatalog::RefreshChapters(IMapCatalogSource& source, CatalogRefreshResult_t& result)
+{
+    const int64_t dirTime = source.GetFileTime("cfg");
+    if (m_bListed && dirTime != 0 && dirTime == m_ChapterDirTime)
+        return;
+
+    std::vector<std::string> fileNames;
+    source.FindFiles(CATALOG_CHAPTER_WILDCARD, fileNames);
+    result.listings++;
+    m_ChapterDirTime = dirTime;
+
+    std::vector<CatalogChapter_t> chapters;
+    for (size_t i = 0; i < fileNames.size(); i++)
+    {
+        const std::string& fileName = fileNames[i];
+        const std::string lower = ToLower(fileName);
+        if (lower.compare(0, 7, "chapter") != 0 || !isdigit((unsigned char)lower[7]))
+            continue;
+
+        const std::string path = "cfg/" + fileName;
+        CatalogChapter_t chapter;
+        chapter.number = atoi(lower.c_str() + 7);
+        chapter.fileName = fileName;
+        chapter.fileTime = source.GetFileTime(path.c_str());
+
+        // A config that didn't change keeps its map, one without a time is only read once
+        std::vector<CatalogChapter_t>::const_iterator known =
+            std::find_if(m_Chapters.begin(), m_Chapters.end(), [&lower](const CatalogChapter_t& c) {
+                return ToLower(c.fileName) == lower;
+            });
+        if (known != m_Chapters.end() && (chapter.fileTime == 0 || chapter.fileTime == known->fileTime))
+        {
+            chapter.mapName = known->mapName;
+        }
+        else
+        {
+            std::string config;
+            if (source.ReadFile(path.c_str(), config))
+            {
+                chapter.mapName = ParseChapterMap(config);
+            }
+            result.configReads++;
+            result.bChanged = true;
+        }
+        chapters.push_back(chapter);
+    }
+
+    std::sort(chapters.begin(), chapters.end(), [](const CatalogChapter_t& a, const CatalogChapter_t& b) {
+        return a.number != b.number ? a.number < b.number : ToLower(a.fileName) < ToLower(b.fileName);
+    });
+    result.bChanged |= chapters.size() != m_Chapters.size();
+    m_Chapters.swap(chapters);
+}
+
+void CMapCatalog::AddMap(const char* mapName)
+{
+    Entry_t entry;
+    entry.key = MakeKey(mapName, ".bsp");
+    if (entry.key.empty() || Contains(m_Maps, entry.key))
+        return;
+
+    entry.name = std::string(mapName, entry.key.size());
+    InsertEntry(m_Maps, entry);
+    InsertEntry(m_LoadedMaps, entry);
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: lookups
+//---------------------------------------------------------------------------------
+std::string CMapCatalog::MakeKey(const char* name, const char* extension)
+{
+    std::string key = ToLower(name);
+    const size_t length = strlen(extension);
+    if (key.size() >= length && key.compare(key.size() - length, length, extension) == 0)
+    {
+        key.erase(key.size() - length);
+    }
+    return key;
+}
+
+bool CMapCatalog::Contains(const std::vector<Entry_t>& entries, const std::string& key)
+{
+    std::vector<Entry_t>::const_iterator it = std::lower_bound(
+        entries.begin(), entries.end(), key, [](const Entry_t& entry, const std::string& k) { return entry.key < k; });
+    return it != entries.end() && it->key == key;
+}
+
+void CMapCatalog::InsertEntry(std::vector<Entry_t>& entries, const Entry_t& entry)
+{
+    std::vector<Entry_t>::iterator it = std::lower_bound(
+        entries.begin(), entries.end(), entry, [](const Entry_t& a, const Entry_t& b) { return a.key < b.key; });
+    if (it == entries.end() || it->key != entry.key)
+    {
+        entries.insert(it, entry);
+    }
+}
+
+bool CMapCatalog::SameKeys(const std::vector<Entry_t>& a, const std::vector<Entry_t>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].key != b[i].key)
+            return false;
+    }
+    return true;
+}
+
+bool CMapCatalog::HasMap(const char* mapName) const
+{
+    return Contains(m_Maps, MakeKey(mapName, ".bsp"));
+}
+
+bool CMapCatalog::HasSave(const char* saveName) const
+{
+    return Contains(m_Saves, MakeKey(saveName, ".sav"));
+}
+
+void CMapCatalog::Complete(const std::vector<Entry_t>& entries,
+                           const char* prefix,
+                           std::vector<std::string>& names,
+                           size_t maxNames)
+{
+    const std::string key = ToLower(prefix);
+    std::vector<Entry_t>::const_iterator it = std::lower_bound(
+        entries.begin(), entries.end(), key, [](const Entry_t& entry, const std::string& k) { return entry.key < k; });
+    for (; it != entries.end() && names.size() < maxNames && it->key.compare(0, key.size(), key) == 0; ++it)
+    {
+        names.push_back(it->name);
+    }
+}
+
+void CMapCatalog::CompleteMaps(const char* prefix, std::vector<std::string>& names, size_t maxNames) const
+{
+    Complete(m_Maps, prefix, names, maxNames);
+}
+
+void CMapCatalog::CompleteSaves(const char* prefix, std::vector<std::string>& names, size_t maxNames) const
+{
+    Complete(m_Saves, prefix, names, maxNames);
+}
+
+const char* CMapCatalog::GetFirstMap() const
+{
+    for (size_t i = 0; i < m_Chapters.size(); i++)
+    {
+        if (!m_Chapters[i].mapName.empty())
+            return m_Chapters[i].mapName.c_str();
+    }
+    return "";
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Every map (maps/*.bsp), chapter start (cfg/chapter<N>.cfg) and save (SAVE/*.sav) the game can load, listed once when
+// the plugin loads and kept in sorted arrays. speedrun_map and speedrun_save are checked and completed against it, and
+// speedrun_start never touches the disk to find out whether the save exists. Refreshing only lists a directory again
+// if its time changed (or can't be told), and only reads the chapter configs that are new or changed.
+
+#define CATALOG_MAP_WILDCARD "maps/*.bsp"
+#define CATALOG_CHAPTER_WILDCARD "cfg/chapter*.cfg"
+#define CATALOG_SAVE_WILDCARD "SAVE/*.sav"
+
+//---------------------------------------------------------------------------------
+// Purpose: what the catalog needs from the filesystem, the plugin implements it on top of IFileSystem
+//---------------------------------------------------------------------------------
+class IMapCatalogSource
+{
+    public:
+    // Appends the bare file names matching wildcard (e.g. "maps/*.bsp")
+    virtual void FindFiles(const char* wildcard, std::vector<std::string>& fileNames) = 0;
+    virtual bool ReadFile(const char* path, std::string& contents) = 0;
+
+    // Modification time of a file or directory, 0 if unknown
+    virtual int64_t GetFileTime(const char* path) = 0;
+
+    protected:
+    ~IMapCatalogSource() {}
+};
+
+struct CatalogChapter_t
+{
+    // N of cfg/chapter<N>.cfg, chapters like "9a" sort after 9
+    int number;
+    std::string fileName;
+
+    // First map the config loads, empty if it loads none
+    std::string mapName;
+    int64_t fileTime;
+};
+
+struct CatalogRefreshResult_t
+{
+    // Directories listed and configs read, everything else was known to be unchanged
+    uint32_t listings;
+    uint32_t configReads;
+    bool bChanged;
+};
+
+// Map named by the first "map <name>" command of a config, empty if there is none
+std::string ParseChapterMap(const std::string& config);
+
+//---------------------------------------------------------------------------------
+// Purpose: the catalog. Names compare case insensitively, the way the engine finds them on Windows.
+//---------------------------------------------------------------------------------
+class CMapCatalog
+{
+    public:
+    CMapCatalog();
+
+    void Clear();
+
+    // Lists what changed since the last refresh, everything on the first one
+    CatalogRefreshResult_t Refresh(IMapCatalogSource& source);
+
+    // Only lists the saves again, for when one is needed that was made since the last refresh
+    CatalogRefreshResult_t RefreshSaves(IMapCatalogSource& source);
+
+    // A map the engine loaded, whatever the listing said (maps in packs of other games, ...)
+    void AddMap(const char* mapName);
+
+    // Names with or without their extension
+    bool HasMap(const char* mapName) const;
+    bool HasSave(const char* saveName) const;
+
+    // Up to maxNames maps or saves starting with prefix, sorted, without their extension
+    void CompleteMaps(const char* prefix, std::vector<std::string>& names, size_t maxNames) const;
+    void CompleteSaves(const char* prefix, std::vector<std::string>& names, size_t maxNames) const;
+
+    // Map of the lowest numbered chapter that loads one, "" if there is none
+    const char* GetFirstMap() const;
+
+    // Sorted by number
+    const std::vector<CatalogChapter_t>& GetChapters() const
+    {
+        return m_Chapters;
+    }
+    size_t GetMapCount() const
+    {
+        return m_Maps.size();
+    }
+    size_t GetSaveCount() const
+    {
+        return m_Saves.size();
+    }
+
+    private:
+    CMapCatalog(const CMapCatalog&);
+    CMapCatalog& operator=(const CMapCatalog&);
+
+    struct Entry_t
+    {
+        // Lower case and without the extension, what the arrays are sorted by
+        std::string key;
+        std::string name;
+    };
+
+    static std::string MakeKey(const char* name, const char* extension);
+    static bool ListNames(IMapCatalogSource& source,
+                          const char* wildcard,
+                          const char* extension,
+                          int64_t& dirTime,
+                          std::vector<Entry_t>& entries,
+                          CatalogRefreshResult_t& result);
+    static bool Contains(const std::vector<Entry_t>& entries, const std::string& key);
+    static void InsertEntry(std::vector<Entry_t>& entries, const Entry_t& entry);
+    static bool SameKeys(const std::vector<Entry_t>& a, const std::vector<Entry_t>& b);
+    static void Complete(const std::vector<Entry_t>& entries,
+                         const char* prefix,
+                         std::vector<std::string>& names,
+                         size_t maxNames);
+
+    void RefreshChapters(IMapCatalogSource& source, CatalogRefreshResult_t& result);
+
+    std::vector<Entry_t> m_Maps;
+
+    // Added by AddMap, kept across listings
+    std::vector<Entry_t> m_LoadedMaps;
+    std::vector<Entry_t> m_Saves;
+    std::vector<CatalogChapter_t> m_Chapters;
+
+    // Directory times of the last listing, 0 lists again every time
+    int64_t m_MapDirTime;
+    int64_t m_SaveDirTime;
+    int64_t m_ChapterDirTime;
+    bool m_bListed;
+};
@@ -0,0 +1,133 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CMappedFile::CMappedFile()
+    : m_pData(NULL),
+      m_Size(0),
+      m_bOpen(false)
+#ifdef _WIN32
+      ,
+      m_hFile(INVALID_HANDLE_VALUE),
+      m_hMapping(NULL)
+#endif
+{
+}
+
+CMappedFile::~CMappedFile()
+{
+    Close();
+}
+
+MappedFileError CMappedFile::Open(const char* path, bool bSequential)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE hFile = CreateFileA(path,
+                               GENERIC_READ,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               NULL,
+                               OPEN_EXISTING,
+                               bSequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS,
+                               NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return MAPERR_OPEN;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(hFile, &fileSize))
+    {
+        CloseHandle(hFile);
+        return MAPERR_OPEN;
+    }
+
+    // A 32-bit process cannot map a view larger than its address space
+    if ((uint64_t)fileSize.QuadPart > (uint64_t)(SIZE_T)-1)
+    {
+        CloseHandle(hFile);
+        return MAPERR_MAP;
+    }
+
+    if (fileSize.QuadPart != 0)
+    {
+        HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        const void* view = hMapping ? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if (!view)
+        {
+            if (hMapping)
+                CloseHandle(hMapping);
+            CloseHandle(hFile);
+            return MAPERR_MAP;
+        }
+        m_hMapping = hMapping;
+        m_pData = (const uint8_t*)view;
+    }
+
+    m_hFile = hFile;
+    m_Size = (uint64_t)fileSize.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return MAPERR_OPEN;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return MAPERR_OPEN;
+    }
+
+    if (st.st_size != 0)
+    {
+        void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED)
+        {
+            close(fd);
+            return MAPERR_MAP;
+        }
+        madvise(view, (size_t)st.st_size, bSequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+        m_pData = (const uint8_t*)view;
+    }
+    close(fd);
+
+    m_Size = (uint64_t)st.st_size;
+#endif
+
+    m_bOpen = true;
+    return MAPERR_NONE;
+}
+
+void CMappedFile::Close()
+{
+#ifdef _WIN32
+    if (m_pData)
+    {
+        UnmapViewOfFile(m_pData);
+        CloseHandle(m_hMapping);
+    }
+    if (m_hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_hFile);
+    }
+    m_hMapping = NULL;
+    m_hFile = INVALID_HANDLE_VALUE;
+#else
+    if (m_pData)
+    {
+        munmap((void*)m_pData, (size_t)m_Size);
+    }
+#endif
+
+    m_pData = NULL;
+    m_Size = 0;
+    m_bOpen = false;
+}
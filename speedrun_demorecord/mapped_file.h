@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+enum MappedFileError
+{
+    MAPERR_NONE,
+    MAPERR_OPEN,
+    MAPERR_MAP,
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: read-only memory mapping of a whole file. An empty file opens with no data.
+//---------------------------------------------------------------------------------
+class CMappedFile
+{
+    public:
+    CMappedFile();
+    ~CMappedFile();
+
+    // bSequential tells the OS to read ahead, for files that are read front to back
+    MappedFileError Open(const char* path, bool bSequential = true);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return m_bOpen;
+    }
+    const uint8_t* GetData() const
+    {
+        return m_pData;
+    }
+    uint64_t GetSize() const
+    {
+        return m_Size;
+    }
+
+    private:
+    CMappedFile(const CMappedFile&);
+    CMappedFile& operator=(const CMappedFile&);
+
+    const uint8_t* m_pData;
+    uint64_t m_Size;
+    bool m_bOpen;
+#ifdef _WIN32
+    void* m_hFile;
+    void* m_hMapping;
+#endif
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <utility>
+
+//---------------------------------------------------------------------------------
+// Purpose: bounded lock-free multi producer, single consumer queue (Dmitry Vyukov's bounded queue). Every cell
+// carries a sequence number that tells producers and the consumer whose turn it is, so a push is one CAS on the
+// enqueue position and never blocks. Push fails instead of waiting when the queue is full.
+//
+// Capacity is rounded up to a power of two.
+//---------------------------------------------------------------------------------
+template <typename T>
+class CBoundedMpscQueue
+{
+    public:
+    explicit CBoundedMpscQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+
+        m_Mask = size - 1;
+        m_pCells = new Cell_t[size];
+        for (size_t i = 0; i < size; i++)
+        {
+            m_pCells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_EnqueuePos.store(0, std::memory_order_relaxed);
+        m_DequeuePos = 0;
+    }
+
+    ~CBoundedMpscQueue()
+    {
+        delete[] m_pCells;
+    }
+
+    // Any thread
+    bool Push(T& value)
+    {
+        Cell_t* cell;
+        size_t pos = m_EnqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &m_pCells[pos & m_Mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+            if (diff == 0)
+            {
+                if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                // The consumer hasn't freed this cell yet
+                return false;
+            }
+            else
+            {
+                pos = m_EnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only
+    bool Pop(T& value)
+    {
+        Cell_t* cell = &m_pCells[m_DequeuePos & m_Mask];
+        if (cell->sequence.load(std::memory_order_acquire) != m_DequeuePos + 1)
+            return false;
+
+        value = std::move(cell->value);
+        cell->sequence.store(m_DequeuePos + m_Mask + 1, std::memory_order_release);
+        m_DequeuePos++;
+        return true;
+    }
+
+    size_t GetCapacity() const
+    {
+        return m_Mask + 1;
+    }
+
+    private:
+    CBoundedMpscQueue(const CBoundedMpscQueue&);
+    CBoundedMpscQueue& operator=(const CBoundedMpscQueue&);
+
+    struct Cell_t
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    Cell_t* m_pCells;
+    size_t m_Mask;
+
+    // Producers and the consumer write different positions, keep them off the same cache line. Padding instead of
+    // alignas since C++14 new doesn't honor over-alignment.
+    char m_Pad0[64];
+    std::atomic<size_t> m_EnqueuePos;
+    char m_Pad1[64];
+    size_t m_DequeuePos;
+};
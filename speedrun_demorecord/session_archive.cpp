@@ -0,0 +1,570 @@
+#include "session_archive.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "crc32.h"
+#include "demo_file.h"
+#include "lz_codec.h"
+
+static bool SeekFile(FILE* file, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// Messages whose payload repeats in every demo of a map
+static bool IsDedupCandidate(DemoMessageType type)
+{
+    return type == DEM_SIGNON || type == DEM_DATATABLES || type == DEM_STRINGTABLES;
+}
+
+uint64_t HashBlock(const void* data, size_t size)
+{
+    // FNV-1a, a word at a time
+    const uint64_t prime = 0x100000001B3ull;
+    uint64_t hash = 0xCBF29CE484222325ull ^ (uint64_t)size;
+
+    const uint8_t* p = (const uint8_t*)data;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, p + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; i++)
+    {
+        hash = (hash ^ p[i]) * prime;
+    }
+    return hash ^ (hash >> 32);
+}
+
+// Compresses one piece, keeping it as it is if that doesn't make it smaller
+static void StorePiece(const uint8_t* data, archivepiece_t& piece, std::string& stored)
+{
+    piece.crc = Crc32(data, piece.size);
+
+    stored.resize(LzCompressBound(piece.size));
+    const size_t compressed = LzCompress(data, piece.size, (uint8_t*)&stored[0], stored.size());
+    if (compressed > 0 && compressed < piece.size)
+    {
+        stored.resize(compressed);
+        piece.codec = ARCHIVE_CODEC_LZ;
+    }
+    else
+    {
+        stored.assign((const char*)data, piece.size);
+        piece.codec = ARCHIVE_CODEC_STORED;
+    }
+    piece.storedSize = (uint32_t)stored.size();
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: writer
+//---------------------------------------------------------------------------------
+CSessionArchiveWriter::CSessionArchiveWriter(unsigned threadCount)
+    : m_Pool(threadCount), m_pFile(NULL), m_bFailed(false), m_DataEnd(0)
+{
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+CSessionArchiveWriter::~CSessionArchiveWriter()
+{
+    if (m_pFile)
+    {
+        fclose(m_pFile);
+    }
+}
+
+bool CSessionArchiveWriter::Open(const char* path)
+{
+    m_pFile = fopen(path, "wb");
+    if (!m_pFile)
+        return false;
+
+    // Real header once the tables are known
+    archiveheader_t header;
+    memset(&header, 0, sizeof(header));
+    m_DataEnd = 0;
+    WriteData(&header, sizeof(header));
+    return !m_bFailed;
+}
+
+void CSessionArchiveWriter::WriteData(const void* data, uint64_t size)
+{
+    if (m_bFailed)
+        return;
+
+    if (fwrite(data, 1, (size_t)size, m_pFile) != (size_t)size)
+    {
+        m_bFailed = true;
+    }
+    m_DataEnd += size;
+}
+
+void CSessionArchiveWriter::AddChunks(std::vector<PendingPiece_t>& pieces,
+                                      const uint8_t* data,
+                                      uint64_t size,
+                                      int32_t firstTick,
+                                      int32_t lastTick)
+{
+    while (size > 0)
+    {
+        const uint32_t chunk = size > ARCHIVE_CHUNK_SIZE ? ARCHIVE_CHUNK_SIZE : (uint32_t)size;
+
+        PendingPiece_t pending;
+        memset(&pending.piece, 0, sizeof(pending.piece));
+        pending.data = data;
+        pending.piece.size = chunk;
+        pending.piece.block = ARCHIVE_LITERAL;
+        pending.piece.firstTick = firstTick;
+        pending.piece.lastTick = lastTick;
+        pending.bWrite = true;
+        pieces.push_back(pending);
+
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+void CSessionArchiveWriter::AddBlock(std::vector<PendingPiece_t>& pieces,
+                                     const uint8_t* data,
+                                     uint32_t size,
+                                     int32_t tick)
+{
+    const uint64_t hash = HashBlock(data, size);
+
+    uint32_t index = ARCHIVE_LITERAL;
+    typedef std::multimap<uint64_t, uint32_t>::const_iterator Iterator;
+    std::pair<Iterator, Iterator> candidates = m_BlocksByHash.equal_range(hash);
+    for (Iterator it = candidates.first; it != candidates.second; ++it)
+    {
+        const std::string& stored = m_BlockData[it->second];
+        if (stored.size() == size && memcmp(stored.data(), data, size) == 0)
+        {
+            index = it->second;
+            break;
+        }
+    }
+
+    PendingPiece_t pending;
+    memset(&pending.piece, 0, sizeof(pending.piece));
+    pending.data = data;
+    pending.piece.size = size;
+    pending.piece.firstTick = tick;
+    pending.piece.lastTick = tick;
+    pending.bWrite = index == ARCHIVE_LITERAL;
+
+    if (index == ARCHIVE_LITERAL)
+    {
+        // Offset and stored size are known once it is written
+        archiveblock_t block;
+        memset(&block, 0, sizeof(block));
+        block.hash = hash;
+        block.size = size;
+        index = (uint32_t)m_Blocks.size();
+        m_Blocks.push_back(block);
+        m_BlockData.push_back(std::string((const char*)data, size));
+        m_BlocksByHash.insert(std::make_pair(hash, index));
+    }
+    else
+    {
+        m_Stats.dedupedBytes += size;
+    }
+
+    m_Blocks[index].refs++;
+    m_Stats.blockRefs++;
+
+    pending.piece.block = index;
+    pieces.push_back(pending);
+}
+
+bool CSessionArchiveWriter::AddFile(const char* name, const uint8_t* data, uint64_t size)
+{
+    if (!m_pFile || m_bFailed)
+        return false;
+
+    ArchiveFile_t file;
+    file.name = name;
+    file.size = size;
+    file.crc = Crc32(data, (size_t)size);
+
+    std::vector<PendingPiece_t> pieces;
+    uint64_t chunkStart = 0;
+    if (ValidateDemoHeader(data, size) == DEMERR_NONE)
+    {
+        // Chunks end at message boundaries and know their ticks, a broken tail goes into the last chunk as it is
+        int32_t firstTick = ARCHIVE_NO_TICK;
+        int32_t lastTick = ARCHIVE_NO_TICK;
+        CDemoMessageReader reader(data, size);
+        DemoMessage_t msg;
+        while (reader.Next(msg))
+        {
+            const bool bBlock = IsDedupCandidate(msg.type) && msg.size >= ARCHIVE_MIN_BLOCK_SIZE &&
+                                msg.size <= 0x7FFFFFFFu;
+
+            if (msg.offset > chunkStart && (bBlock || msg.offset + msg.size - chunkStart > ARCHIVE_CHUNK_SIZE))
+            {
+                AddChunks(pieces, data + chunkStart, msg.offset - chunkStart, firstTick, lastTick);
+                chunkStart = msg.offset;
+                firstTick = ARCHIVE_NO_TICK;
+                lastTick = ARCHIVE_NO_TICK;
+            }
+
+            if (bBlock)
+            {
+                AddBlock(pieces, data + msg.offset, (uint32_t)msg.size, msg.tick);
+                chunkStart = msg.offset + msg.size;
+                continue;
+            }
+
+            if (firstTick == ARCHIVE_NO_TICK || msg.tick < firstTick)
+            {
+                firstTick = msg.tick;
+            }
+            if (lastTick == ARCHIVE_NO_TICK || msg.tick > lastTick)
+            {
+                lastTick = msg.tick;
+            }
+        }
+
+        if (size > chunkStart)
+        {
+            AddChunks(pieces, data + chunkStart, size - chunkStart, firstTick, lastTick);
+            chunkStart = size;
+        }
+    }
+    AddChunks(pieces, data + chunkStart, size - chunkStart, ARCHIVE_NO_TICK, ARCHIVE_NO_TICK);
+
+    // Compress on every core, then write in order
+    for (size_t i = 0; i < pieces.size(); i++)
+    {
+        PendingPiece_t* pending = &pieces[i];
+        if (pending->bWrite)
+        {
+            m_Pool.Submit([pending] { StorePiece(pending->data, pending->piece, pending->stored); });
+        }
+    }
+    m_Pool.Wait();
+
+    for (size_t i = 0; i < pieces.size(); i++)
+    {
+        archivepiece_t& piece = pieces[i].piece;
+        if (pieces[i].bWrite)
+        {
+            piece.offset = m_DataEnd;
+            WriteData(pieces[i].stored.data(), pieces[i].stored.size());
+        }
+
+        if (piece.block == ARCHIVE_LITERAL)
+        {
+            file.pieces.push_back(piece);
+            continue;
+        }
+
+        archiveblock_t& block = m_Blocks[piece.block];
+        if (pieces[i].bWrite)
+        {
+            block.offset = piece.offset;
+            block.storedSize = piece.storedSize;
+            block.crc = piece.crc;
+            block.codec = piece.codec;
+        }
+        piece.offset = block.offset;
+        piece.storedSize = block.storedSize;
+        piece.crc = block.crc;
+        piece.codec = block.codec;
+        file.pieces.push_back(piece);
+    }
+
+    m_Files.push_back(file);
+    m_Stats.files++;
+    m_Stats.inputBytes += size;
+    return !m_bFailed;
+}
+
+bool CSessionArchiveWriter::Close()
+{
+    if (!m_pFile)
+        return false;
+
+    archiveheader_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = ARCHIVE_MAGIC;
+    header.version = ARCHIVE_VERSION;
+    header.fileCount = (uint32_t)m_Files.size();
+    header.blockCount = (uint32_t)m_Blocks.size();
+
+    header.blockTableOffset = m_DataEnd;
+    const size_t blockTableSize = m_Blocks.size() * sizeof(archiveblock_t);
+    if (blockTableSize > 0)
+    {
+        WriteData(m_Blocks.data(), blockTableSize);
+    }
+
+    std::string fileTable;
+    for (size_t i = 0; i < m_Files.size(); i++)
+    {
+        const ArchiveFile_t& file = m_Files[i];
+        const uint16_t nameLength = (uint16_t)(file.name.size() < 0xFFFF ? file.name.size() : 0xFFFF);
+        const uint32_t pieceCount = (uint32_t)file.pieces.size();
+        fileTable.append((const char*)&nameLength, sizeof(nameLength));
+        fileTable.append(file.name.data(), nameLength);
+        fileTable.append((const char*)&file.size, sizeof(file.size));
+        fileTable.append((const char*)&file.crc, sizeof(file.crc));
+        fileTable.append((const char*)&pieceCount, sizeof(pieceCount));
+        fileTable.append((const char*)file.pieces.data(), file.pieces.size() * sizeof(archivepiece_t));
+        header.totalFileBytes += file.size;
+    }
+    header.fileTableOffset = m_DataEnd;
+    header.fileTableSize = fileTable.size();
+    WriteData(fileTable.data(), fileTable.size());
+
+    header.tablesCrc = Crc32(m_Blocks.data(), blockTableSize);
+    header.tablesCrc = Crc32(fileTable.data(), fileTable.size(), header.tablesCrc);
+    header.crc = Crc32(&header, offsetof(archiveheader_t, crc));
+
+    if (!m_bFailed && (!SeekFile(m_pFile, 0) || fwrite(&header, 1, sizeof(header), m_pFile) != sizeof(header)))
+    {
+        m_bFailed = true;
+    }
+    if (fclose(m_pFile) != 0)
+    {
+        m_bFailed = true;
+    }
+    m_pFile = NULL;
+
+    m_Stats.uniqueBlocks = (uint32_t)m_Blocks.size();
+    m_Stats.archiveBytes = m_DataEnd;
+    return !m_bFailed;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: reader
+//---------------------------------------------------------------------------------
+CSessionArchiveReader::CSessionArchiveReader() : m_pFile(NULL), m_ArchiveSize(0) {}
+
+CSessionArchiveReader::~CSessionArchiveReader()
+{
+    Close();
+}
+
+void CSessionArchiveReader::Close()
+{
+    if (m_pFile)
+    {
+        fclose(m_pFile);
+        m_pFile = NULL;
+    }
+    m_ArchiveSize = 0;
+    m_Blocks.clear();
+    m_Files.clear();
+}
+
+bool CSessionArchiveReader::ReadAt(uint64_t offset, void* data, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_ReadMutex);
+    return SeekFile(m_pFile, offset) && fread(data, 1, size, m_pFile) == size;
+}
+
+bool CSessionArchiveReader::Open(const char* path)
+{
+    Close();
+    m_pFile = fopen(path, "rb");
+    if (!m_pFile)
+        return false;
+
+    archiveheader_t header;
+    if (!ReadAt(0, &header, sizeof(header)) || header.magic != ARCHIVE_MAGIC || header.version != ARCHIVE_VERSION ||
+        header.crc != Crc32(&header, offsetof(archiveheader_t, crc)))
+    {
+        Close();
+        return false;
+    }
+
+    const uint64_t blockTableSize = (uint64_t)header.blockCount * sizeof(archiveblock_t);
+    std::string fileTable((size_t)header.fileTableSize, '\0');
+    m_Blocks.resize(header.blockCount);
+    if ((blockTableSize > 0 && !ReadAt(header.blockTableOffset, m_Blocks.data(), (size_t)blockTableSize)) ||
+        (!fileTable.empty() && !ReadAt(header.fileTableOffset, &fileTable[0], fileTable.size())))
+    {
+        Close();
+        return false;
+    }
+
+    uint32_t crc = Crc32(m_Blocks.data(), (size_t)blockTableSize);
+    crc = Crc32(fileTable.data(), fileTable.size(), crc);
+    if (crc != header.tablesCrc)
+    {
+        Close();
+        return false;
+    }
+
+    // Checksummed, only the lengths need to be kept inside the table
+    size_t pos = 0;
+    for (uint32_t i = 0; i < header.fileCount; i++)
+    {
+        ArchiveFile_t file;
+        uint16_t nameLength;
+        uint32_t pieceCount;
+        if (fileTable.size() - pos < sizeof(nameLength))
+            break;
+        memcpy(&nameLength, &fileTable[pos], sizeof(nameLength));
+        pos += sizeof(nameLength);
+        if (fileTable.size() - pos < (size_t)nameLength + sizeof(file.size) + sizeof(file.crc) + sizeof(pieceCount))
+            break;
+        file.name.assign(&fileTable[pos], nameLength);
+        pos += nameLength;
+        memcpy(&file.size, &fileTable[pos], sizeof(file.size));
+        pos += sizeof(file.size);
+        memcpy(&file.crc, &fileTable[pos], sizeof(file.crc));
+        pos += sizeof(file.crc);
+        memcpy(&pieceCount, &fileTable[pos], sizeof(pieceCount));
+        pos += sizeof(pieceCount);
+        if ((fileTable.size() - pos) / sizeof(archivepiece_t) < pieceCount)
+            break;
+        file.pieces.resize(pieceCount);
+        if (pieceCount > 0)
+        {
+            memcpy(file.pieces.data(), &fileTable[pos], pieceCount * sizeof(archivepiece_t));
+        }
+        pos += pieceCount * sizeof(archivepiece_t);
+        m_Files.push_back(file);
+    }
+
+    if (m_Files.size() != header.fileCount)
+    {
+        Close();
+        return false;
+    }
+
+    m_ArchiveSize = header.fileTableOffset + header.fileTableSize;
+    return true;
+}
+
+int CSessionArchiveReader::FindFile(const char* name) const
+{
+    for (size_t i = 0; i < m_Files.size(); i++)
+    {
+        if (m_Files[i].name == name)
+            return (int)i;
+    }
+    return -1;
+}
+
+bool CSessionArchiveReader::ReadPiece(const archivepiece_t& piece, std::string& stored, uint8_t* out)
+{
+    if (piece.codec == ARCHIVE_CODEC_STORED)
+    {
+        if (piece.storedSize != piece.size || (piece.size > 0 && !ReadAt(piece.offset, out, piece.size)))
+            return false;
+    }
+    else if (piece.codec == ARCHIVE_CODEC_LZ)
+    {
+        stored.resize(piece.storedSize);
+        if (piece.storedSize > 0 && !ReadAt(piece.offset, &stored[0], piece.storedSize))
+            return false;
+        if (!LzDecompress((const uint8_t*)stored.data(), stored.size(), out, piece.size))
+            return false;
+    }
+    else
+    {
+        return false;
+    }
+    return Crc32(out, piece.size) == piece.crc;
+}
+
+bool CSessionArchiveReader::ExtractRange(size_t index, uint64_t offset, uint64_t size, std::string& contents)
+{
+    contents.clear();
+    if (!m_pFile || index >= m_Files.size())
+        return false;
+
+    const ArchiveFile_t& file = m_Files[index];
+    if (offset > file.size || size > file.size - offset)
+        return false;
+    contents.resize((size_t)size);
+
+    // Pieces are checked whole, those cut by the range are rebuilt in a scratch buffer
+    std::string stored;
+    std::string scratch;
+    uint64_t pieceStart = 0;
+    for (size_t i = 0; i < file.pieces.size() && pieceStart < offset + size; i++)
+    {
+        const archivepiece_t& piece = file.pieces[i];
+        const uint64_t pieceEnd = pieceStart + piece.size;
+        if (pieceEnd > file.size)
+            return false;
+
+        if (pieceEnd > offset)
+        {
+            const uint64_t from = offset > pieceStart ? offset : pieceStart;
+            const uint64_t to = offset + size < pieceEnd ? offset + size : pieceEnd;
+            if (from == pieceStart && to == pieceEnd)
+            {
+                if (!ReadPiece(piece, stored, (uint8_t*)&contents[(size_t)(from - offset)]))
+                    return false;
+            }
+            else
+            {
+                scratch.resize(piece.size);
+                if (!ReadPiece(piece, stored, (uint8_t*)&scratch[0]))
+                    return false;
+                memcpy(&contents[(size_t)(from - offset)], &scratch[(size_t)(from - pieceStart)], (size_t)(to - from));
+            }
+        }
+        pieceStart = pieceEnd;
+    }
+
+    return pieceStart >= offset + size;
+}
+
+bool CSessionArchiveReader::Extract(size_t index, std::string& contents)
+{
+    if (index >= m_Files.size())
+        return false;
+
+    const ArchiveFile_t& file = m_Files[index];
+    uint64_t total = 0;
+    for (size_t i = 0; i < file.pieces.size(); i++)
+    {
+        total += file.pieces[i].size;
+    }
+
+    return total == file.size && ExtractRange(index, 0, file.size, contents) &&
+           Crc32(contents.data(), contents.size()) == file.crc;
+}
+
+bool CSessionArchiveReader::FindTickRange(size_t index,
+                                          int32_t firstTick,
+                                          int32_t lastTick,
+                                          uint64_t& offset,
+                                          uint64_t& size) const
+{
+    if (index >= m_Files.size())
+        return false;
+
+    bool bFound = false;
+    uint64_t pieceStart = 0;
+    const ArchiveFile_t& file = m_Files[index];
+    for (size_t i = 0; i < file.pieces.size(); i++)
+    {
+        const archivepiece_t& piece = file.pieces[i];
+        if (piece.firstTick != ARCHIVE_NO_TICK && piece.lastTick >= firstTick && piece.firstTick <= lastTick)
+        {
+            if (!bFound)
+            {
+                offset = pieceStart;
+                bFound = true;
+            }
+            size = pieceStart + piece.size - offset;
+        }
+        pieceStart += piece.size;
+    }
+    return bFound;
+}
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "work_stealing_pool.h"
+
+// Session archive (.sra): the demos of a session in one file that any demo, or any tick range of one, can be read
+// back from without touching the rest.
+//
+// Each reload records a new demo that starts with the same signon, datatables and stringtables messages for the map,
+// so a session with hundreds of deaths on one map stores those megabytes hundreds of times. Those messages are content
+// addressed (hashed and compared) and kept once. Everything else is cut into chunks of up to ARCHIVE_CHUNK_SIZE at
+// message boundaries. Blocks and chunks are compressed on their own (lz_codec.h) on every core, and each records the
+// ticks of its messages, which makes the file table an index from ticks to archive offsets. Unpacking rebuilds
+// bit-exact files, checked against the CRC-32 of every piece and of the original file.
+//
+// Layout: header, data (unique blocks and chunks as they were packed), block table, file table.
+
+#define ARCHIVE_EXTENSION ".sra"
+
+// "SRA1"
+#define ARCHIVE_MAGIC 0x31415253u
+#define ARCHIVE_VERSION 2
+
+// Smaller messages are not worth a block table entry
+#define ARCHIVE_MIN_BLOCK_SIZE 256
+
+// Piece that is not a shared block but a chunk of its own file
+#define ARCHIVE_LITERAL 0xFFFFFFFFu
+
+// Chunks end at the last message boundary before this, files that aren't demos (and single messages bigger than
+// this) are cut at exactly this
+#define ARCHIVE_CHUNK_SIZE (256 * 1024)
+
+#define ARCHIVE_CODEC_STORED 0
+#define ARCHIVE_CODEC_LZ 1
+
+// Ticks of a piece without messages (the demo header, files that aren't demos)
+#define ARCHIVE_NO_TICK -1
+
+#pragma pack(push, 1)
+struct archiveheader_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t fileCount;
+    uint32_t blockCount;
+    uint64_t blockTableOffset;
+    uint64_t fileTableOffset;
+    uint64_t fileTableSize;
+
+    // Sum of the original file sizes
+    uint64_t totalFileBytes;
+
+    // CRC-32 of the block and file tables
+    uint32_t tablesCrc;
+
+    // CRC-32 of everything above
+    uint32_t crc;
+};
+
+struct archiveblock_t
+{
+    uint64_t hash;
+    uint64_t offset;
+    uint32_t storedSize;
+    uint32_t size;
+
+    // How many pieces use the block
+    uint32_t refs;
+
+    // CRC-32 of the uncompressed bytes
+    uint32_t crc;
+    uint8_t codec;
+    uint8_t reserved[3];
+};
+
+struct archivepiece_t
+{
+    // Where the piece is stored and how many bytes it takes there, a block's piece repeats the block's
+    uint64_t offset;
+    uint32_t storedSize;
+
+    // Uncompressed
+    uint32_t size;
+
+    // Index into the block table, or ARCHIVE_LITERAL
+    uint32_t block;
+
+    // CRC-32 of the uncompressed bytes
+    uint32_t crc;
+
+    // Lowest and highest tick of the messages that start in the piece, ARCHIVE_NO_TICK if there are none
+    int32_t firstTick;
+    int32_t lastTick;
+
+    uint8_t codec;
+    uint8_t reserved[3];
+};
+#pragma pack(pop)
+
+struct ArchiveFile_t
+{
+    std::string name;
+    uint64_t size;
+    uint32_t crc;
+    std::vector<archivepiece_t> pieces;
+};
+
+struct ArchiveStats_t
+{
+    uint32_t files;
+    uint64_t inputBytes;
+    uint64_t archiveBytes;
+
+    uint32_t uniqueBlocks;
+    uint32_t blockRefs;
+
+    // Bytes that were not stored again because an identical block already was
+    uint64_t dedupedBytes;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: packs files into a new archive. Demos are split into messages, other files (the journal, indexes) into
+// fixed size chunks. The chunks of a file are compressed in parallel, files are written one after the other.
+//---------------------------------------------------------------------------------
+class CSessionArchiveWriter
+{
+    public:
+    // threadCount 0 uses every core
+    explicit CSessionArchiveWriter(unsigned threadCount = 0);
+    ~CSessionArchiveWriter();
+
+    bool Open(const char* path);
+
+    // name is how the file is called inside the archive, "d1_canals_06_1.dem"
+    bool AddFile(const char* name, const uint8_t* data, uint64_t size);
+
+    // Writes the tables and the header, false if anything failed since Open
+    bool Close();
+
+    const ArchiveStats_t& GetStats() const
+    {
+        return m_Stats;
+    }
+
+    private:
+    CSessionArchiveWriter(const CSessionArchiveWriter&);
+    CSessionArchiveWriter& operator=(const CSessionArchiveWriter&);
+
+    // A piece of the file being added, compressed before it is written
+    struct PendingPiece_t
+    {
+        const uint8_t* data;
+        archivepiece_t piece;
+
+        // Literal chunks and blocks seen for the first time are written, the rest only reference a block
+        bool bWrite;
+        std::string stored;
+    };
+
+    void AddChunks(std::vector<PendingPiece_t>& pieces,
+                   const uint8_t* data,
+                   uint64_t size,
+                   int32_t firstTick,
+                   int32_t lastTick);
+    void AddBlock(std::vector<PendingPiece_t>& pieces, const uint8_t* data, uint32_t size, int32_t tick);
+    void WriteData(const void* data, uint64_t size);
+
+    CWorkStealingPool m_Pool;
+    FILE* m_pFile;
+    bool m_bFailed;
+    uint64_t m_DataEnd;
+
+    std::vector<archiveblock_t> m_Blocks;
+
+    // Blocks by hash, the bytes are kept to rule out collisions
+    std::multimap<uint64_t, uint32_t> m_BlocksByHash;
+    std::vector<std::string> m_BlockData;
+
+    std::vector<ArchiveFile_t> m_Files;
+    ArchiveStats_t m_Stats;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: reads the tables of an archive and rebuilds its files
+//---------------------------------------------------------------------------------
+class CSessionArchiveReader
+{
+    public:
+    CSessionArchiveReader();
+    ~CSessionArchiveReader();
+
+    // False if the file is not an archive or its tables are damaged
+    bool Open(const char* path);
+    void Close();
+
+    size_t GetFileCount() const
+    {
+        return m_Files.size();
+    }
+    const ArchiveFile_t& GetFile(size_t index) const
+    {
+        return m_Files[index];
+    }
+    const std::vector<archiveblock_t>& GetBlocks() const
+    {
+        return m_Blocks;
+    }
+    uint64_t GetArchiveSize() const
+    {
+        return m_ArchiveSize;
+    }
+
+    // -1 if there is no such file
+    int FindFile(const char* name) const;
+
+    // False on read errors or if the result doesn't match the original's CRC. Extract and ExtractRange may be called
+    // from several threads at once.
+    bool Extract(size_t index, std::string& contents);
+
+    // size bytes of the original file starting at offset, only the pieces they overlap are read
+    bool ExtractRange(size_t index, uint64_t offset, uint64_t size, std::string& contents);
+
+    // Byte range of the original file holding every message from firstTick to lastTick, from the start of the
+    // first piece that has any of those ticks to the end of the last one. False if no piece has any.
+    bool FindTickRange(size_t index, int32_t firstTick, int32_t lastTick, uint64_t& offset, uint64_t& size) const;
+
+    private:
+    CSessionArchiveReader(const CSessionArchiveReader&);
+    CSessionArchiveReader& operator=(const CSessionArchiveReader&);
+
+    bool ReadAt(uint64_t offset, void* data, size_t size);
+    bool ReadPiece(const archivepiece_t& piece, std::string& stored, uint8_t* out);
+
+    FILE* m_pFile;
+    std::mutex m_ReadMutex;
+    uint64_t m_ArchiveSize;
+    std::vector<archiveblock_t> m_Blocks;
+    std::vector<ArchiveFile_t> m_Files;
+};
+
+// 64-bit content hash for blocks, not cryptographic
+uint64_t HashBlock(const void* data, size_t size);
@@ -0,0 +1,593 @@
+#include "session_digest.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+#include "crc32.h"
+#include "demo_file.h"
+#include "file_list.h"
+#include "mapped_file.h"
+#include "work_stealing_pool.h"
+
+// Blocks a verifier task checksums, 16 MB at the default block size: enough to keep the per-task overhead out of the
+// way, small enough that a single long demo is spread over every core
+#define DIGEST_VERIFY_TASK_BLOCKS 16
+
+static std::string JoinPath(const std::string& dir, const std::string& name)
+{
+    if (dir.empty() || dir[dir.size() - 1] == '/' || dir[dir.size() - 1] == '\\')
+        return dir + name;
+    return dir + '/' + name;
+}
+
+const char* DigestReadResultToString(DigestReadResult result)
+{
+    switch (result)
+    {
+        case DIGEST_OK:
+            return "ok";
+        case DIGEST_MISSING:
+            return "no digest";
+        case DIGEST_CORRUPT:
+            return "corrupt digest";
+        case DIGEST_BAD_SEAL:
+            return "digest seal doesn't match (digest edited or wrong key)";
+        case DIGEST_NEEDS_KEY:
+            return "digest is keyed, no key given";
+        case DIGEST_NOT_KEYED:
+            return "digest isn't keyed";
+    }
+    return "?";
+}
+
+const char* DigestMismatchKindToString(DigestMismatchKind kind)
+{
+    switch (kind)
+    {
+        case DIGEST_MODIFIED:
+            return "modified";
+        case DIGEST_RESIZED:
+            return "resized";
+        case DIGEST_DEMO_MISSING:
+            return "missing";
+        case DIGEST_DEMO_ADDED:
+            return "not in digest";
+    }
+    return "?";
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: building
+//---------------------------------------------------------------------------------
+static void AddBlock(DemoDigest_t& digest, const uint8_t* data, uint64_t offset, uint64_t end, int32_t firstTick,
+                     int32_t lastTick)
+{
+    digestblock_t block;
+    block.offset = offset;
+    block.size = (uint32_t)(end - offset);
+    block.firstTick = firstTick;
+    block.lastTick = lastTick;
+    block.crc = Crc32c(data + offset, block.size);
+    digest.blocks.push_back(block);
+}
+
+static void AddFixedBlocks(DemoDigest_t& digest, const uint8_t* data, uint64_t offset, uint64_t end,
+                           uint32_t blockSize)
+{
+    while (offset < end)
+    {
+        const uint64_t blockEnd = std::min<uint64_t>(end, offset + blockSize);
+        AddBlock(digest, data, offset, blockEnd, -1, -1);
+        offset = blockEnd;
+    }
+}
+
+void BuildDemoDigest(const char* name, const uint8_t* data, uint64_t size, uint32_t blockSize, DemoDigest_t& digest)
+{
+    digest.name = name;
+    digest.size = size;
+    digest.lastTick = -1;
+    digest.reachedStop = false;
+    digest.blocks.clear();
+    if (blockSize == 0)
+    {
+        blockSize = DIGEST_DEFAULT_BLOCK_SIZE;
+    }
+
+    if (ValidateDemoHeader(data, size) != DEMERR_NONE)
+    {
+        AddFixedBlocks(digest, data, 0, size, blockSize);
+        return;
+    }
+
+    // The header goes in the first block, a block is closed at the first message that starts blockSize past it
+    uint64_t blockStart = 0;
+    int32_t firstTick = -1;
+    int32_t lastTick = -1;
+    CDemoMessageReader reader(data, size);
+    DemoMessage_t msg;
+    while (reader.Next(msg))
+    {
+        if (msg.offset - blockStart >= blockSize)
+        {
+            AddBlock(digest, data, blockStart, msg.offset, firstTick, lastTick);
+            blockStart = msg.offset;
+            firstTick = -1;
+            lastTick = -1;
+        }
+        if (msg.type != DEM_STOP && msg.tick >= 0)
+        {
+            firstTick = firstTick < 0 ? msg.tick : firstTick;
+            lastTick = msg.tick;
+            digest.lastTick = msg.tick;
+        }
+    }
+    digest.reachedStop = reader.ReachedStop();
+
+    // Whatever follows the last whole message (the stop message, or a cut off or corrupt one) has no ticks
+    const uint64_t parsedEnd = std::min<uint64_t>(std::max<uint64_t>(reader.GetOffset(), blockStart), size);
+    if (parsedEnd > blockStart)
+    {
+        AddBlock(digest, data, blockStart, parsedEnd, firstTick, lastTick);
+    }
+    AddFixedBlocks(digest, data, parsedEnd, size, blockSize);
+}
+
+bool DigestDemoFile(const char* path, uint32_t blockSize, DemoDigest_t& digest)
+{
+    CMappedFile file;
+    if (file.Open(path) != MAPERR_NONE)
+        return false;
+
+    const char* name = path + strlen(path);
+    while (name > path && name[-1] != '/' && name[-1] != '\\')
+    {
+        name--;
+    }
+    BuildDemoDigest(name, file.GetData(), file.GetSize(), blockSize, digest);
+    return true;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: serialization
+//---------------------------------------------------------------------------------
+static void Seal(const std::string& key, const void* data, size_t size, uint8_t seal[SHA256_SIZE])
+{
+    if (key.empty())
+    {
+        Sha256(data, size, seal);
+    }
+    else
+    {
+        HmacSha256(key.data(), key.size(), data, size, seal);
+    }
+}
+
+void FormatSessionDigest(const SessionDigest_t& digest, const std::string& key, std::string& out)
+{
+    digestheader_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = DIGEST_MAGIC;
+    header.version = DIGEST_VERSION;
+    header.flags = key.empty() ? 0 : DIGEST_KEYED;
+    header.blockSize = digest.blockSize;
+    header.demoCount = (uint32_t)digest.demos.size();
+    for (size_t i = 0; i < digest.demos.size(); i++)
+    {
+        header.blockCount += (uint32_t)digest.demos[i].blocks.size();
+    }
+
+    out.clear();
+    out.append((const char*)&header, sizeof(header));
+
+    uint32_t firstBlock = 0;
+    for (size_t i = 0; i < digest.demos.size(); i++)
+    {
+        const DemoDigest_t& demo = digest.demos[i];
+        digestdemo_t record;
+        memset(&record, 0, sizeof(record));
+        strncpy(record.name, demo.name.c_str(), sizeof(record.name) - 1);
+        record.size = demo.size;
+        record.lastTick = demo.lastTick;
+        record.firstBlock = firstBlock;
+        record.blockCount = (uint32_t)demo.blocks.size();
+        record.reachedStop = demo.reachedStop ? 1 : 0;
+        out.append((const char*)&record, sizeof(record));
+        firstBlock += record.blockCount;
+    }
+    for (size_t i = 0; i < digest.demos.size(); i++)
+    {
+        const std::vector<digestblock_t>& blocks = digest.demos[i].blocks;
+        if (!blocks.empty())
+        {
+            out.append((const char*)blocks.data(), blocks.size() * sizeof(digestblock_t));
+        }
+    }
+
+    uint8_t seal[SHA256_SIZE];
+    Seal(key, out.data(), out.size(), seal);
+    out.append((const char*)seal, sizeof(seal));
+}
+
+DigestReadResult ParseSessionDigest(const void* data, size_t size, const std::string& key, SessionDigest_t& digest)
+{
+    digest.blockSize = 0;
+    digest.bKeyed = false;
+    digest.demos.clear();
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    digestheader_t header;
+    if (size < sizeof(header) + SHA256_SIZE)
+        return DIGEST_CORRUPT;
+    memcpy(&header, bytes, sizeof(header));
+
+    const uint64_t expected = sizeof(header) + (uint64_t)header.demoCount * sizeof(digestdemo_t) +
+                              (uint64_t)header.blockCount * sizeof(digestblock_t) + SHA256_SIZE;
+    if (header.magic != DIGEST_MAGIC || header.version != DIGEST_VERSION || expected != size)
+        return DIGEST_CORRUPT;
+
+    // Checked before anything else is believed
+    const bool keyed = (header.flags & DIGEST_KEYED) != 0;
+    if (keyed && key.empty())
+        return DIGEST_NEEDS_KEY;
+    if (!keyed && !key.empty())
+        return DIGEST_NOT_KEYED;
+
+    const size_t bodySize = size - SHA256_SIZE;
+    uint8_t seal[SHA256_SIZE];
+    Seal(key, bytes, bodySize, seal);
+    uint8_t difference = 0;
+    for (size_t i = 0; i < SHA256_SIZE; i++)
+    {
+        difference |= (uint8_t)(seal[i] ^ bytes[bodySize + i]);
+    }
+    if (difference != 0)
+        return DIGEST_BAD_SEAL;
+
+    const uint8_t* demoRecords = bytes + sizeof(header);
+    const uint8_t* blockRecords = demoRecords + (size_t)header.demoCount * sizeof(digestdemo_t);
+    digest.demos.resize(header.demoCount);
+    for (uint32_t i = 0; i < header.demoCount; i++)
+    {
+        digestdemo_t record;
+        memcpy(&record, demoRecords + (size_t)i * sizeof(record), sizeof(record));
+        if (record.firstBlock > header.blockCount || record.blockCount > header.blockCount - record.firstBlock)
+            return DIGEST_CORRUPT;
+
+        DemoDigest_t& demo = digest.demos[i];
+        demo.name.assign(record.name, strnlen(record.name, sizeof(record.name)));
+        demo.size = record.size;
+        demo.lastTick = record.lastTick;
+        demo.reachedStop = record.reachedStop != 0;
+        demo.blocks.resize(record.blockCount);
+        if (record.blockCount != 0)
+        {
+            memcpy(demo.blocks.data(),
+                   blockRecords + (size_t)record.firstBlock * sizeof(digestblock_t),
+                   record.blockCount * sizeof(digestblock_t));
+        }
+
+        for (size_t j = 0; j < demo.blocks.size(); j++)
+        {
+            const digestblock_t& block = demo.blocks[j];
+            if (block.offset > demo.size || block.size > demo.size - block.offset)
+                return DIGEST_CORRUPT;
+        }
+    }
+
+    digest.blockSize = header.blockSize;
+    digest.bKeyed = keyed;
+    return DIGEST_OK;
+}
+
+bool WriteSessionDigest(const std::string& sessionDir, const SessionDigest_t& digest, const std::string& key)
+{
+    std::string bytes;
+    FormatSessionDigest(digest, key, bytes);
+
+    // Written aside and renamed over, a verifier never sees half a digest
+    const std::string path = JoinPath(sessionDir, DIGEST_FILE_NAME);
+    const std::string tempPath = path + ".tmp";
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file)
+        return false;
+    const bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    if (fclose(file) != 0 || !ok)
+    {
+        remove(tempPath.c_str());
+        return false;
+    }
+
+    // rename() doesn't replace an existing file on Windows
+    remove(path.c_str());
+    return rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+DigestReadResult ReadSessionDigest(const std::string& sessionDir, const std::string& key, SessionDigest_t& digest)
+{
+    std::string bytes;
+    if (!ReadWholeFile(JoinPath(sessionDir, DIGEST_FILE_NAME), bytes))
+    {
+        digest.demos.clear();
+        return DIGEST_MISSING;
+    }
+    return ParseSessionDigest(bytes.data(), bytes.size(), key, digest);
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: verification
+//---------------------------------------------------------------------------------
+static void AddRange(DigestMismatch_t& mismatch, const digestblock_t& block)
+{
+    if (mismatch.firstTick < 0)
+    {
+        mismatch.firstTick = block.firstTick;
+    }
+    if (block.lastTick >= 0)
+    {
+        mismatch.lastTick = block.lastTick;
+    }
+}
+
+static DigestMismatch_t MakeMismatch(const DemoDigest_t& digest, DigestMismatchKind kind, uint64_t offset,
+                                     uint64_t size)
+{
+    DigestMismatch_t mismatch;
+    mismatch.demo = digest.name;
+    mismatch.kind = kind;
+    mismatch.offset = offset;
+    mismatch.size = size;
+    mismatch.firstTick = -1;
+    mismatch.lastTick = -1;
+    return mismatch;
+}
+
+void VerifyDemoBlocks(const DemoDigest_t& digest,
+                      const uint8_t* data,
+                      uint64_t size,
+                      size_t firstBlock,
+                      size_t endBlock,
+                      std::vector<DigestMismatch_t>& mismatches)
+{
+    const size_t firstNew = mismatches.size();
+    for (size_t i = firstBlock; i < endBlock && i < digest.blocks.size(); i++)
+    {
+        const digestblock_t& block = digest.blocks[i];
+        if (block.offset + block.size > size || Crc32c(data + block.offset, block.size) == block.crc)
+            continue;
+
+        if (mismatches.size() > firstNew && mismatches.back().offset + mismatches.back().size == block.offset)
+        {
+            mismatches.back().size += block.size;
+        }
+        else
+        {
+            mismatches.push_back(MakeMismatch(digest, DIGEST_MODIFIED, block.offset, block.size));
+        }
+        AddRange(mismatches.back(), block);
+    }
+}
+
+static bool CompareMismatches(const DigestMismatch_t& a, const DigestMismatch_t& b)
+{
+    if (a.sessionDir != b.sessionDir)
+        return a.sessionDir < b.sessionDir;
+    if (a.demo != b.demo)
+        return a.demo < b.demo;
+    return a.offset < b.offset;
+}
+
+static bool CompareSessions(const SessionVerification_t& a, const SessionVerification_t& b)
+{
+    return a.sessionDir < b.sessionDir;
+}
+
+// Directories at or below dir that hold a digest
+static void FindSessions(const std::string& dir, std::vector<std::string>& sessions)
+{
+    std::vector<std::string> files;
+    std::vector<std::string> subdirs;
+    ListDirectory(dir, &files, &subdirs);
+    if (std::find(files.begin(), files.end(), DIGEST_FILE_NAME) != files.end())
+    {
+        sessions.push_back(dir);
+    }
+    for (size_t i = 0; i < subdirs.size(); i++)
+    {
+        FindSessions(JoinPath(dir, subdirs[i]), sessions);
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: constructor
+//---------------------------------------------------------------------------------
+CDigestVerifier::CDigestVerifier(unsigned threadCount) : m_ThreadCount(threadCount), m_Seconds(0.0) {}
+
+//---------------------------------------------------------------------------------
+// Purpose: verification
+//---------------------------------------------------------------------------------
+void CDigestVerifier::Run(const std::vector<std::string>& paths, const std::string& key)
+{
+    m_Sessions.clear();
+    m_Mismatches.clear();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // A path without a digest anywhere below is reported as a session without one
+    std::vector<std::string> sessionDirs;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        const size_t found = sessionDirs.size();
+        FindSessions(paths[i], sessionDirs);
+        if (sessionDirs.size() == found)
+        {
+            sessionDirs.push_back(paths[i]);
+        }
+    }
+
+    CWorkStealingPool pool(m_ThreadCount);
+    m_ThreadCount = pool.GetThreadCount();
+
+    // A session reads its digest and queues its demos, a demo is mapped once and queues its blocks in groups
+    std::function<void(const std::string&)> verifySession = [this, &pool, &key](const std::string& dir) {
+        SessionVerification_t session;
+        session.sessionDir = dir;
+        session.demos = 0;
+        session.bytes = 0;
+
+        std::shared_ptr<SessionDigest_t> digest = std::make_shared<SessionDigest_t>();
+        session.result = ReadSessionDigest(dir, key, *digest);
+
+        std::vector<DigestMismatch_t> found;
+        if (session.result == DIGEST_OK)
+        {
+            std::vector<std::string> files;
+            ListDirectory(dir, &files, NULL);
+            for (size_t i = 0; i < files.size(); i++)
+            {
+                if (!EndsWith(files[i], ".dem"))
+                    continue;
+
+                bool listed = false;
+                for (size_t j = 0; j < digest->demos.size() && !listed; j++)
+                {
+                    listed = digest->demos[j].name == files[i];
+                }
+                if (!listed)
+                {
+                    DemoDigest_t added;
+                    added.name = files[i];
+                    found.push_back(MakeMismatch(added, DIGEST_DEMO_ADDED, 0, 0));
+                }
+            }
+
+            session.demos = (uint32_t)digest->demos.size();
+            for (size_t i = 0; i < digest->demos.size(); i++)
+            {
+                const DemoDigest_t& demo = digest->demos[i];
+                std::shared_ptr<CMappedFile> file = std::make_shared<CMappedFile>();
+                if (file->Open(JoinPath(dir, demo.name).c_str()) != MAPERR_NONE)
+                {
+                    DigestMismatch_t missing = MakeMismatch(demo, DIGEST_DEMO_MISSING, 0, demo.size);
+                    missing.lastTick = demo.lastTick;
+                    found.push_back(missing);
+                    continue;
+                }
+                session.bytes += file->GetSize();
+
+                // Blocks past the end of a cut off demo can't be compared, they make up the resized range
+                const uint64_t size = file->GetSize();
+                size_t endBlock = demo.blocks.size();
+                while (endBlock > 0 && demo.blocks[endBlock - 1].offset + demo.blocks[endBlock - 1].size > size)
+                {
+                    endBlock--;
+                }
+                if (size != demo.size)
+                {
+                    const uint64_t from = endBlock < demo.blocks.size() ? demo.blocks[endBlock].offset : demo.size;
+                    const uint64_t start = std::min(from, size);
+                    DigestMismatch_t resized =
+                        MakeMismatch(demo, DIGEST_RESIZED, start, std::max(size, demo.size) - start);
+                    for (size_t j = endBlock; j < demo.blocks.size(); j++)
+                    {
+                        AddRange(resized, demo.blocks[j]);
+                    }
+                    found.push_back(resized);
+                }
+
+                for (size_t first = 0; first < endBlock; first += DIGEST_VERIFY_TASK_BLOCKS)
+                {
+                    const size_t last = std::min<size_t>(endBlock, first + DIGEST_VERIFY_TASK_BLOCKS);
+                    pool.Submit([this, digest, file, dir, i, first, last] {
+                        std::vector<DigestMismatch_t> modified;
+                        VerifyDemoBlocks(digest->demos[i], file->GetData(), file->GetSize(), first, last, modified);
+                        if (modified.empty())
+                            return;
+
+                        std::lock_guard<std::mutex> lock(m_Mutex);
+                        for (size_t j = 0; j < modified.size(); j++)
+                        {
+                            modified[j].sessionDir = dir;
+                            m_Mismatches.push_back(modified[j]);
+                        }
+                    });
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (size_t i = 0; i < found.size(); i++)
+        {
+            found[i].sessionDir = dir;
+            m_Mismatches.push_back(found[i]);
+        }
+        m_Sessions.push_back(session);
+    };
+
+    for (size_t i = 0; i < sessionDirs.size(); i++)
+    {
+        const std::string dir = sessionDirs[i];
+        pool.Submit([&verifySession, dir] { verifySession(dir); });
+    }
+    pool.Wait();
+
+    std::sort(m_Sessions.begin(), m_Sessions.end(), CompareSessions);
+    std::sort(m_Mismatches.begin(), m_Mismatches.end(), CompareMismatches);
+
+    // A modified run that crossed a task boundary was found in pieces
+    std::vector<DigestMismatch_t> merged;
+    for (size_t i = 0; i < m_Mismatches.size(); i++)
+    {
+        const DigestMismatch_t& mismatch = m_Mismatches[i];
+        if (!merged.empty())
+        {
+            DigestMismatch_t& previous = merged.back();
+            if (mismatch.kind == DIGEST_MODIFIED && previous.kind == DIGEST_MODIFIED &&
+                previous.sessionDir == mismatch.sessionDir && previous.demo == mismatch.demo &&
+                previous.offset + previous.size == mismatch.offset)
+            {
+                previous.size += mismatch.size;
+                previous.firstTick = previous.firstTick < 0 ? mismatch.firstTick : previous.firstTick;
+                previous.lastTick = mismatch.lastTick >= 0 ? mismatch.lastTick : previous.lastTick;
+                continue;
+            }
+        }
+        merged.push_back(mismatch);
+    }
+    m_Mismatches.swap(merged);
+
+    m_Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: totals
+//---------------------------------------------------------------------------------
+uint32_t CDigestVerifier::GetFailedCount() const
+{
+    // Both are sorted by directory
+    uint32_t failed = 0;
+    size_t mismatch = 0;
+    for (size_t i = 0; i < m_Sessions.size(); i++)
+    {
+        const std::string& dir = m_Sessions[i].sessionDir;
+        while (mismatch < m_Mismatches.size() && m_Mismatches[mismatch].sessionDir < dir)
+        {
+            mismatch++;
+        }
+        const bool mismatched = mismatch < m_Mismatches.size() && m_Mismatches[mismatch].sessionDir == dir;
+        failed += (m_Sessions[i].result != DIGEST_OK || mismatched) ? 1 : 0;
+    }
+    return failed;
+}
+
+uint64_t CDigestVerifier::GetTotalBytes() const
+{
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < m_Sessions.size(); i++)
+    {
+        bytes += m_Sessions[i].bytes;
+    }
+    return bytes;
+}
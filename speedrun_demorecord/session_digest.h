@@ -0,0 +1,208 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "sha256.h"
+
+// Written next to the demos of a session when it stops: size, last tick and a CRC-32C of every block of every demo,
+// sealed with an HMAC-SHA256 (or a plain SHA-256 without a key). A verifier reads the demos back and names the demo
+// and tick range of every block that doesn't match.
+
+#define DIGEST_FILE_NAME "speedrun_democrecord.digest"
+
+// "SRD1"
+#define DIGEST_MAGIC 0x31445253u
+#define DIGEST_VERSION 1
+
+// Blocks end at the first message boundary past this many bytes, so a mismatch maps to whole ticks
+#define DIGEST_DEFAULT_BLOCK_SIZE (1024 * 1024)
+#define DIGEST_DEMO_NAME_SIZE 96
+
+enum DigestFlags
+{
+    // The seal is an HMAC keyed with speedrun_digest_key, a plain SHA-256 can be recomputed by whoever edits the demos
+    DIGEST_KEYED = 1 << 0,
+};
+
+#pragma pack(push, 1)
+struct digestheader_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t blockSize;
+    uint32_t demoCount;
+    uint32_t blockCount;
+};
+
+struct digestdemo_t
+{
+    // File name, the demos are next to the digest
+    char name[DIGEST_DEMO_NAME_SIZE];
+    uint64_t size;
+    int32_t lastTick;
+    uint32_t firstBlock;
+    uint32_t blockCount;
+    uint8_t reachedStop;
+    uint8_t reserved[3];
+};
+
+struct digestblock_t
+{
+    uint64_t offset;
+    uint32_t size;
+
+    // Ticks of the messages that start in the block, -1 for the header block and for a demo that doesn't parse
+    int32_t firstTick;
+    int32_t lastTick;
+
+    uint32_t crc;
+};
+#pragma pack(pop)
+
+// The demos follow the header, then the blocks, then the SHA256_SIZE seal of everything before it
+static_assert(sizeof(digestheader_t) == 24, "digestheader_t is an on-disk format");
+static_assert(sizeof(digestdemo_t) == 120, "digestdemo_t is an on-disk format");
+static_assert(sizeof(digestblock_t) == 24, "digestblock_t is an on-disk format");
+
+struct DemoDigest_t
+{
+    std::string name;
+    uint64_t size;
+    int32_t lastTick;
+    bool reachedStop;
+    std::vector<digestblock_t> blocks;
+};
+
+struct SessionDigest_t
+{
+    uint32_t blockSize;
+    bool bKeyed;
+    std::vector<DemoDigest_t> demos;
+};
+
+enum DigestReadResult
+{
+    DIGEST_OK,
+    DIGEST_MISSING,
+    DIGEST_CORRUPT,
+
+    // The seal doesn't match: the digest itself was edited, or the key is wrong
+    DIGEST_BAD_SEAL,
+
+    // Keyed, but no key was given to check it with
+    DIGEST_NEEDS_KEY,
+
+    // A key was given but the digest is only a SHA-256, anyone could have resealed it after editing the demos
+    DIGEST_NOT_KEYED,
+};
+
+const char* DigestReadResultToString(DigestReadResult result);
+
+// Blocks and CRCs of one demo in memory. Nothing has to parse, a demo that doesn't is cut into blockSize blocks.
+void BuildDemoDigest(const char* name, const uint8_t* data, uint64_t size, uint32_t blockSize, DemoDigest_t& digest);
+
+// Maps the demo, the name is the file name part of path
+bool DigestDemoFile(const char* path, uint32_t blockSize, DemoDigest_t& digest);
+
+// An empty key seals with SHA-256
+void FormatSessionDigest(const SessionDigest_t& digest, const std::string& key, std::string& out);
+DigestReadResult ParseSessionDigest(const void* data, size_t size, const std::string& key, SessionDigest_t& digest);
+
+bool WriteSessionDigest(const std::string& sessionDir, const SessionDigest_t& digest, const std::string& key);
+DigestReadResult ReadSessionDigest(const std::string& sessionDir, const std::string& key, SessionDigest_t& digest);
+
+enum DigestMismatchKind
+{
+    // Bytes inside the recorded size differ
+    DIGEST_MODIFIED,
+
+    // Bytes were added or cut off, the range is what differs from the recorded size
+    DIGEST_RESIZED,
+
+    DIGEST_DEMO_MISSING,
+
+    // A demo the session doesn't list
+    DIGEST_DEMO_ADDED,
+};
+
+const char* DigestMismatchKindToString(DigestMismatchKind kind);
+
+struct DigestMismatch_t
+{
+    std::string sessionDir;
+    std::string demo;
+    DigestMismatchKind kind;
+    uint64_t offset;
+    uint64_t size;
+
+    // -1 when the range has no ticks: the header, or a demo that didn't parse when it was sealed
+    int32_t firstTick;
+    int32_t lastTick;
+};
+
+// Compares blocks [firstBlock, endBlock) of digest with the demo in data, adjacent modified blocks are one mismatch
+void VerifyDemoBlocks(const DemoDigest_t& digest,
+                      const uint8_t* data,
+                      uint64_t size,
+                      size_t firstBlock,
+                      size_t endBlock,
+                      std::vector<DigestMismatch_t>& mismatches);
+
+struct SessionVerification_t
+{
+    std::string sessionDir;
+    DigestReadResult result;
+    uint32_t demos;
+    uint64_t bytes;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: checks sessions (or whole archives of them, every directory below that holds a digest) against their
+// digests. Demos are mapped and their blocks checksummed on a work-stealing pool, so a large demo is spread over
+// every core and the run goes at disk speed.
+//---------------------------------------------------------------------------------
+class CDigestVerifier
+{
+    public:
+    // threadCount 0 uses every core
+    explicit CDigestVerifier(unsigned threadCount = 0);
+
+    void Run(const std::vector<std::string>& paths, const std::string& key);
+
+    // Sorted by directory
+    const std::vector<SessionVerification_t>& GetSessions() const
+    {
+        return m_Sessions;
+    }
+
+    // Sorted by directory, demo and offset
+    const std::vector<DigestMismatch_t>& GetMismatches() const
+    {
+        return m_Mismatches;
+    }
+
+    // Sessions whose digest didn't read, or that have a mismatch
+    uint32_t GetFailedCount() const;
+    uint64_t GetTotalBytes() const;
+
+    double GetSeconds() const
+    {
+        return m_Seconds;
+    }
+    unsigned GetThreadCount() const
+    {
+        return m_ThreadCount;
+    }
+
+    private:
+    unsigned m_ThreadCount;
+    std::vector<SessionVerification_t> m_Sessions;
+    std::vector<DigestMismatch_t> m_Mismatches;
+    std::mutex m_Mutex;
+    double m_Seconds;
+};
@@ -0,0 +1,80 @@
+#include "session_journal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "crc32.h"
+
+static uint32_t ComputeRecordCrc(const journalrecord_t& record)
+{
+    return Crc32(&record, offsetof(journalrecord_t, crc));
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: journal records
+//---------------------------------------------------------------------------------
+void BuildJournalRecord(journalrecord_t& record,
+                        JournalRecordType type,
+                        uint32_t sequence,
+                        const char* mapName,
+                        int retry,
+                        const char* demoName,
+                        int64_t wallClock,
+                        int tick)
+{
+    // Zeroed so the unused bytes of the names are deterministic and covered by the checksum
+    memset(&record, 0, sizeof(record));
+    record.magic = JOURNAL_MAGIC;
+    record.type = (uint8_t)type;
+    record.sequence = sequence;
+    record.retry = retry;
+    record.tick = tick;
+    record.wallClock = wallClock;
+    snprintf(record.mapName, sizeof(record.mapName), "%s", mapName ? mapName : "");
+    snprintf(record.demoName, sizeof(record.demoName), "%s", demoName ? demoName : "");
+    record.crc = ComputeRecordCrc(record);
+}
+
+bool IsValidJournalRecord(const journalrecord_t& record)
+{
+    if (record.magic != JOURNAL_MAGIC || record.type < JOURNAL_START || record.type > JOURNAL_STOP)
+        return false;
+
+    return record.crc == ComputeRecordCrc(record);
+}
+
+JournalReadResult_t ReadJournal(const void* data, size_t size, std::vector<journalrecord_t>& records)
+{
+    JournalReadResult_t result;
+    result.validBytes = 0;
+    result.torn = false;
+
+    const uint8_t* p = (const uint8_t*)data;
+    while (size - result.validBytes >= JOURNAL_RECORD_SIZE)
+    {
+        journalrecord_t record;
+        memcpy(&record, p + result.validBytes, sizeof(record));
+        if (!IsValidJournalRecord(record))
+            break;
+
+        records.push_back(record);
+        result.validBytes += JOURNAL_RECORD_SIZE;
+    }
+
+    result.torn = result.validBytes != size;
+    return result;
+}
+
+const char* JournalRecordTypeToString(int type)
+{
+    switch (type)
+    {
+        case JOURNAL_START:
+            return "start";
+        case JOURNAL_RECORD:
+            return "record";
+        case JOURNAL_STOP:
+            return "stop";
+    }
+    return "unknown";
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Append-only log of everything a standard run recorded, one per session dir. speedrun_resume replays it instead of
+// scanning the directory. Records are fixed size and individually checksummed, so a crash half way through an
+// append (a torn record) only loses that record.
+
+#define JOURNAL_FILE_NAME "speedrun_democrecord.journal"
+
+// "SRJ1"
+#define JOURNAL_MAGIC 0x314A5253u
+#define JOURNAL_RECORD_SIZE 192
+#define JOURNAL_MAP_NAME_SIZE 64
+#define JOURNAL_DEMO_NAME_SIZE 96
+
+enum JournalRecordType
+{
+    // speedrun_start, no demo yet
+    JOURNAL_START = 1,
+
+    // record command sent: mapName, retry, demoName, tick is the server tick
+    JOURNAL_RECORD,
+
+    // stop command sent for demoName: tick is the demo tick it stopped at, -1 if the engine can't tell
+    JOURNAL_STOP,
+};
+
+#pragma pack(push, 1)
+struct journalrecord_t
+{
+    uint32_t magic;
+    uint8_t type;
+    uint8_t reserved[3];
+
+    // Increments with every record of the session
+    uint32_t sequence;
+
+    int32_t retry;
+    int32_t tick;
+
+    // Unix time, seconds
+    int64_t wallClock;
+
+    char mapName[JOURNAL_MAP_NAME_SIZE];
+    char demoName[JOURNAL_DEMO_NAME_SIZE];
+
+    // CRC-32 of everything above
+    uint32_t crc;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(journalrecord_t) == JOURNAL_RECORD_SIZE, "journal records must stay fixed size");
+
+// Fills a record and its checksum, names that don't fit are truncated
+void BuildJournalRecord(journalrecord_t& record,
+                        JournalRecordType type,
+                        uint32_t sequence,
+                        const char* mapName,
+                        int retry,
+                        const char* demoName,
+                        int64_t wallClock,
+                        int tick);
+
+bool IsValidJournalRecord(const journalrecord_t& record);
+
+struct JournalReadResult_t
+{
+    // Bytes covered by the valid records, anything after that is a torn or corrupt tail
+    size_t validBytes;
+    bool torn;
+};
+
+// Collects the valid records from the start of the journal, stops at the first one that fails its checksum
+JournalReadResult_t ReadJournal(const void* data, size_t size, std::vector<journalrecord_t>& records);
+
+const char* JournalRecordTypeToString(int type);
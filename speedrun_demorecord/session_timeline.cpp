@@ -0,0 +1,193 @@
+#include "session_timeline.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <set>
+
+#include "demo_file.h"
+#include "demo_index.h"
+#include "file_list.h"
+#include "session_journal.h"
+
+int32_t MeasureDemoTicks(const char* demoPath, uint64_t& size)
+{
+    size = 0;
+
+    // Mapping doesn't read anything, only the scan below touches the demo body
+    CDemoFile demo;
+    if (demo.Open(demoPath) != DEMERR_NONE)
+        return -1;
+    size = demo.GetSize();
+
+    CDemoIndex index;
+    if (index.ReadFile(GetDemoIndexPath(demoPath).c_str()) && index.GetDemoSize() == size)
+        return index.GetLastTick();
+
+    DemoSummary_t summary;
+    SummarizeDemo(demo.GetData(), demo.GetSize(), summary);
+    return summary.lastTick;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: constructor
+//---------------------------------------------------------------------------------
+CSessionTimeline::CSessionTimeline() : m_TotalTicks(0) {}
+
+void CSessionTimeline::Clear()
+{
+    m_Demos.clear();
+    m_Starts.clear();
+    m_TotalTicks = 0;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: building
+//---------------------------------------------------------------------------------
+void CSessionTimeline::AddDemo(const char* name, int32_t ticks, uint64_t size)
+{
+    TimelineDemo_t demo;
+    demo.name = name;
+    demo.ticks = ticks > 0 ? ticks : 0;
+    demo.size = size;
+    m_Demos.push_back(demo);
+    m_Starts.push_back(m_TotalTicks);
+    m_TotalTicks += demo.ticks;
+}
+
+void CSessionTimeline::UpdateLastDemo(int32_t ticks, uint64_t size)
+{
+    if (m_Demos.empty())
+        return;
+
+    TimelineDemo_t& demo = m_Demos.back();
+    demo.ticks = ticks > 0 ? ticks : 0;
+    demo.size = size;
+    m_TotalTicks = m_Starts.back() + demo.ticks;
+}
+
+size_t CSessionTimeline::Refresh(const char* sessionDir)
+{
+    std::string dir = sessionDir;
+    if (!dir.empty() && dir[dir.size() - 1] != '/' && dir[dir.size() - 1] != '\\')
+    {
+        dir += '/';
+    }
+
+    std::vector<std::string> files;
+    ListDirectory(dir, &files, NULL);
+    std::vector<std::string> onDisk;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (EndsWith(files[i], ".dem"))
+        {
+            onDisk.push_back(files[i]);
+        }
+    }
+    std::set<std::string> remaining(onDisk.begin(), onDisk.end());
+
+    // Recording order as the journal has it, duplicates are a segmented reload of the same name
+    std::vector<std::string> order;
+    std::string journal;
+    if (ReadWholeFile(dir + JOURNAL_FILE_NAME, journal))
+    {
+        std::vector<journalrecord_t> records;
+        ReadJournal(journal.data(), journal.size(), records);
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            if (records[i].type != JOURNAL_RECORD)
+                continue;
+
+            const std::string name = std::string(records[i].demoName) + ".dem";
+            if (remaining.erase(name) != 0)
+            {
+                order.push_back(name);
+            }
+        }
+    }
+    for (size_t i = 0; i < onDisk.size(); i++)
+    {
+        if (remaining.count(onDisk[i]) != 0)
+        {
+            order.push_back(onDisk[i]);
+        }
+    }
+
+    // Known demos must still be a prefix of the order, otherwise start over
+    size_t known = m_Demos.size();
+    bool rebuilt = false;
+    if (known > order.size())
+    {
+        rebuilt = true;
+    }
+    for (size_t i = 0; i < known && !rebuilt; i++)
+    {
+        rebuilt = m_Demos[i].name != order[i];
+    }
+    if (rebuilt)
+    {
+        Clear();
+        known = 0;
+    }
+
+    // The newest known demo may still have been recording last time
+    if (known > 0)
+    {
+        uint64_t size;
+        const int32_t ticks = MeasureDemoTicks((dir + m_Demos.back().name).c_str(), size);
+        if (size != m_Demos.back().size)
+        {
+            UpdateLastDemo(ticks, size);
+        }
+    }
+
+    for (size_t i = known; i < order.size(); i++)
+    {
+        uint64_t size;
+        const int32_t ticks = MeasureDemoTicks((dir + order[i]).c_str(), size);
+        AddDemo(order[i].c_str(), ticks, size);
+    }
+    return rebuilt ? m_Demos.size() : m_Demos.size() - known;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: lookups
+//---------------------------------------------------------------------------------
+bool CSessionTimeline::Locate(int64_t globalTick, TimelinePosition_t& position) const
+{
+    if (m_Demos.empty() || globalTick < 0 || globalTick > m_TotalTicks)
+        return false;
+
+    // Last demo starting at or before the tick, empty demos before it share its start and are skipped
+    std::vector<int64_t>::const_iterator it = std::upper_bound(m_Starts.begin(), m_Starts.end(), globalTick);
+    position.demo = (size_t)(it - m_Starts.begin()) - 1;
+    position.tick = (int32_t)(globalTick - m_Starts[position.demo]);
+    return true;
+}
+
+int64_t CSessionTimeline::ToGlobal(size_t demo, int32_t tick) const
+{
+    return m_Starts[demo] + tick;
+}
+
+void CSessionTimeline::GetRange(int64_t begin, int64_t end, std::vector<TimelineSpan_t>& spans) const
+{
+    begin = std::max<int64_t>(begin, 0);
+    end = std::min<int64_t>(end, m_TotalTicks);
+
+    TimelinePosition_t position;
+    if (begin >= end || !Locate(begin, position))
+        return;
+
+    for (size_t demo = position.demo; demo < m_Demos.size() && m_Starts[demo] < end; demo++)
+    {
+        TimelineSpan_t span;
+        span.demo = demo;
+        span.begin = (int32_t)(std::max<int64_t>(begin, m_Starts[demo]) - m_Starts[demo]);
+        span.end = (int32_t)(std::min<int64_t>(end, m_Starts[demo] + m_Demos[demo].ticks) - m_Starts[demo]);
+        if (span.begin < span.end)
+        {
+            spans.push_back(span);
+        }
+    }
+}
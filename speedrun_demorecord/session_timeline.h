@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Default tick interval of the Source engine, 0.015 s
+#define TIMELINE_DEFAULT_TICKRATE (1.0 / 0.015)
+
+struct TimelineDemo_t
+{
+    // File name inside the session dir, "d1_canals_06_1.dem"
+    std::string name;
+
+    // Ticks the demo adds to the run, its last tick like get_demo_tick_count()
+    int32_t ticks;
+
+    // Demo file size when ticks was measured, a different size means the demo grew
+    uint64_t size;
+};
+
+struct TimelinePosition_t
+{
+    size_t demo;
+    int32_t tick;
+};
+
+// Part of a global range that lies in one demo, local ticks [begin, end)
+struct TimelineSpan_t
+{
+    size_t demo;
+    int32_t begin;
+    int32_t end;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: a run laid out as one continuous tick line across its demos in recording order. Keeps the prefix sums of
+// the demo lengths, so global <-> local tick conversions are a binary search and adding a demo is O(1).
+//---------------------------------------------------------------------------------
+class CSessionTimeline
+{
+    public:
+    CSessionTimeline();
+
+    void Clear();
+
+    void AddDemo(const char* name, int32_t ticks, uint64_t size = 0);
+
+    // The last demo may still be recording, this moves the end of the timeline without touching the other demos
+    void UpdateLastDemo(int32_t ticks, uint64_t size);
+
+    // Demo and local tick of a global tick. The first tick of a demo belongs to it, not to the end of the previous
+    // one. False outside [0, total ticks].
+    bool Locate(int64_t globalTick, TimelinePosition_t& position) const;
+
+    int64_t ToGlobal(size_t demo, int32_t tick) const;
+
+    // Every demo piece of the global range [begin, end), in order
+    void GetRange(int64_t begin, int64_t end, std::vector<TimelineSpan_t>& spans) const;
+
+    // Brings the timeline up to date with the demos in sessionDir. Recording order comes from the session journal,
+    // demos it doesn't know about follow by name. Demos already on the timeline are kept, only the last one is
+    // measured again if it grew. Returns how many demos were added, or the new count if the order changed and the
+    // timeline was rebuilt.
+    size_t Refresh(const char* sessionDir);
+
+    size_t GetDemoCount() const
+    {
+        return m_Demos.size();
+    }
+    const TimelineDemo_t& GetDemo(size_t demo) const
+    {
+        return m_Demos[demo];
+    }
+    int64_t GetDemoStart(size_t demo) const
+    {
+        return m_Starts[demo];
+    }
+    int64_t GetTotalTicks() const
+    {
+        return m_TotalTicks;
+    }
+
+    private:
+    std::vector<TimelineDemo_t> m_Demos;
+
+    // m_Starts[i] = sum of the ticks of every demo before i
+    std::vector<int64_t> m_Starts;
+    int64_t m_TotalTicks;
+};
+
+// Ticks of a demo on disk, from its .dmi when that is up to date, -1 if it can't be read
+int32_t MeasureDemoTicks(const char* demoPath, uint64_t& size);
@@ -0,0 +1,195 @@
+#include "session_validator.h"
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+#include "file_list.h"
+#include "work_stealing_pool.h"
+
+static bool CompareByPath(const DemoCheck_t& a, const DemoCheck_t& b)
+{
+    return a.path < b.path;
+}
+
+static std::string GetParentDir(const std::string& path)
+{
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash);
+}
+
+static std::string JoinPath(const std::string& dir, const std::string& name)
+{
+    if (dir.empty() || dir[dir.size() - 1] == '/' || dir[dir.size() - 1] == '\\')
+        return dir + name;
+    return dir + '/' + name;
+}
+
+void CheckDemo(const char* path, DemoCheck_t& check)
+{
+    check.path = path;
+    check.session = GetParentDir(check.path);
+    check.mapName.clear();
+    check.lastTick = -1;
+    check.size = 0;
+    check.errorOffset = 0;
+
+    CDemoFile demo;
+    check.error = demo.Open(path);
+    if (check.error != DEMERR_NONE)
+        return;
+
+    const demoheader_t* header = demo.GetHeader();
+    check.mapName.assign(header->mapname, strnlen(header->mapname, sizeof(header->mapname)));
+    check.size = demo.GetSize();
+
+    DemoSummary_t summary;
+    SummarizeDemo(demo.GetData(), demo.GetSize(), summary);
+    check.lastTick = summary.lastTick;
+    check.error = summary.error;
+    check.errorOffset = summary.errorOffset;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: constructor
+//---------------------------------------------------------------------------------
+CSessionValidator::CSessionValidator(unsigned threadCount) : m_ThreadCount(threadCount), m_Seconds(0.0), m_Steals(0)
+{
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: validation
+//---------------------------------------------------------------------------------
+void CSessionValidator::Run(const std::vector<std::string>& paths)
+{
+    m_Results.clear();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    CWorkStealingPool pool(m_ThreadCount);
+    m_ThreadCount = pool.GetThreadCount();
+
+    std::function<void(const std::string&)> checkDemo = [this](const std::string& path) {
+        DemoCheck_t check;
+        CheckDemo(path.c_str(), check);
+
+        std::lock_guard<std::mutex> lock(m_ResultsMutex);
+        m_Results.push_back(check);
+    };
+
+    // A directory queues its demos and subdirectories on the worker that listed it, idle workers steal from there
+    std::function<void(const std::string&)> walkDir;
+    walkDir = [&pool, &walkDir, &checkDemo](const std::string& dir) {
+        std::vector<std::string> files;
+        std::vector<std::string> subdirs;
+        ListDirectory(dir, &files, &subdirs);
+
+        for (size_t i = 0; i < subdirs.size(); i++)
+        {
+            const std::string path = JoinPath(dir, subdirs[i]);
+            pool.Submit([&walkDir, path] { walkDir(path); });
+        }
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            if (EndsWith(files[i], ".dem"))
+            {
+                const std::string path = JoinPath(dir, files[i]);
+                pool.Submit([&checkDemo, path] { checkDemo(path); });
+            }
+        }
+    };
+
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        const std::string path = paths[i];
+        if (EndsWith(path, ".dem"))
+        {
+            pool.Submit([&checkDemo, path] { checkDemo(path); });
+        }
+        else
+        {
+            pool.Submit([&walkDir, path] { walkDir(path); });
+        }
+    }
+    pool.Wait();
+
+    m_Steals = pool.GetSteals();
+    m_Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::sort(m_Results.begin(), m_Results.end(), CompareByPath);
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: totals
+//---------------------------------------------------------------------------------
+void CSessionValidator::GetMapTicks(std::vector<MapTicks_t>& maps) const
+{
+    std::map<std::string, MapTicks_t> byName;
+    for (size_t i = 0; i < m_Results.size(); i++)
+    {
+        const DemoCheck_t& check = m_Results[i];
+        MapTicks_t& map = byName[check.mapName];
+        map.mapName = check.mapName;
+        map.demos++;
+        map.ticks += check.lastTick > 0 ? check.lastTick : 0;
+    }
+
+    maps.clear();
+    for (std::map<std::string, MapTicks_t>::const_iterator it = byName.begin(); it != byName.end(); ++it)
+    {
+        maps.push_back(it->second);
+    }
+}
+
+void CSessionValidator::GetSessionTicks(std::vector<SessionTicks_t>& sessions) const
+{
+    // Results are sorted by path, so a session's demos are next to each other
+    sessions.clear();
+    for (size_t i = 0; i < m_Results.size(); i++)
+    {
+        const DemoCheck_t& check = m_Results[i];
+        if (sessions.empty() || sessions.back().session != check.session)
+        {
+            SessionTicks_t session;
+            session.session = check.session;
+            session.demos = 0;
+            session.errors = 0;
+            session.ticks = 0;
+            sessions.push_back(session);
+        }
+
+        SessionTicks_t& session = sessions.back();
+        session.demos++;
+        session.errors += check.error != DEMERR_NONE ? 1 : 0;
+        session.ticks += check.lastTick > 0 ? check.lastTick : 0;
+    }
+}
+
+uint32_t CSessionValidator::GetErrorCount() const
+{
+    uint32_t errors = 0;
+    for (size_t i = 0; i < m_Results.size(); i++)
+    {
+        errors += m_Results[i].error != DEMERR_NONE ? 1 : 0;
+    }
+    return errors;
+}
+
+int64_t CSessionValidator::GetTotalTicks() const
+{
+    int64_t ticks = 0;
+    for (size_t i = 0; i < m_Results.size(); i++)
+    {
+        ticks += m_Results[i].lastTick > 0 ? m_Results[i].lastTick : 0;
+    }
+    return ticks;
+}
+
+uint64_t CSessionValidator::GetTotalBytes() const
+{
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < m_Results.size(); i++)
+    {
+        bytes += m_Results[i].size;
+    }
+    return bytes;
+}
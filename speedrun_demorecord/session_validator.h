@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "demo_file.h"
+
+struct DemoCheck_t
+{
+    std::string path;
+
+    // Directory the demo is in, the session it belongs to
+    std::string session;
+
+    std::string mapName;
+    int32_t lastTick;
+    uint64_t size;
+
+    // DEMERR_NONE only if the demo parsed cleanly up to its stop message
+    DemoError error;
+    uint64_t errorOffset;
+};
+
+struct MapTicks_t
+{
+    std::string mapName;
+    uint32_t demos;
+    int64_t ticks;
+};
+
+struct SessionTicks_t
+{
+    std::string session;
+    uint32_t demos;
+    uint32_t errors;
+    int64_t ticks;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: checks that every demo of one or more sessions (or whole archives of them) parses to a stop message and
+// adds up their ticks. Directories are walked and demos parsed on a work-stealing pool, every demo is read once.
+//---------------------------------------------------------------------------------
+class CSessionValidator
+{
+    public:
+    // threadCount 0 uses every core
+    explicit CSessionValidator(unsigned threadCount = 0);
+
+    // Demos given directly and every .dem below the given directories
+    void Run(const std::vector<std::string>& paths);
+
+    // Sorted by path
+    const std::vector<DemoCheck_t>& GetResults() const
+    {
+        return m_Results;
+    }
+
+    // Sorted by name
+    void GetMapTicks(std::vector<MapTicks_t>& maps) const;
+    void GetSessionTicks(std::vector<SessionTicks_t>& sessions) const;
+
+    uint32_t GetErrorCount() const;
+    int64_t GetTotalTicks() const;
+    uint64_t GetTotalBytes() const;
+
+    double GetSeconds() const
+    {
+        return m_Seconds;
+    }
+    unsigned GetThreadCount() const
+    {
+        return m_ThreadCount;
+    }
+    uint64_t GetSteals() const
+    {
+        return m_Steals;
+    }
+
+    private:
+    unsigned m_ThreadCount;
+    std::vector<DemoCheck_t> m_Results;
+    std::mutex m_ResultsMutex;
+    double m_Seconds;
+    uint64_t m_Steals;
+};
+
+// Parses one demo, what CSessionValidator does for every demo it finds
+void CheckDemo(const char* path, DemoCheck_t& check);
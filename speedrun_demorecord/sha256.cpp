@@ -0,0 +1,173 @@
+#include "sha256.h"
+
+#include <string.h>
+
+static const uint32_t s_RoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static inline uint32_t RotateRight(uint32_t value, int bits)
+{
+    return (value >> bits) | (value << (32 - bits));
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: hashing
+//---------------------------------------------------------------------------------
+CSha256::CSha256()
+{
+    Reset();
+}
+
+void CSha256::Reset()
+{
+    static const uint32_t s_Initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    memcpy(m_State, s_Initial, sizeof(m_State));
+    m_Buffered = 0;
+    m_Length = 0;
+}
+
+void CSha256::Update(const void* data, size_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    m_Length += size;
+
+    if (m_Buffered > 0)
+    {
+        const size_t take = size < SHA256_BLOCK_SIZE - m_Buffered ? size : SHA256_BLOCK_SIZE - m_Buffered;
+        memcpy(m_Buffer + m_Buffered, p, take);
+        m_Buffered += take;
+        p += take;
+        size -= take;
+        if (m_Buffered < SHA256_BLOCK_SIZE)
+            return;
+
+        Compress(m_Buffer);
+        m_Buffered = 0;
+    }
+
+    while (size >= SHA256_BLOCK_SIZE)
+    {
+        Compress(p);
+        p += SHA256_BLOCK_SIZE;
+        size -= SHA256_BLOCK_SIZE;
+    }
+
+    memcpy(m_Buffer, p, size);
+    m_Buffered = size;
+}
+
+void CSha256::Final(uint8_t hash[SHA256_SIZE])
+{
+    const uint64_t bits = m_Length * 8;
+
+    // 0x80, zeros up to 8 bytes short of a block, then the length in bits big endian
+    uint8_t padding[SHA256_BLOCK_SIZE + 8] = {0x80};
+    const size_t padSize = (m_Buffered < 56 ? 56 : 120) - m_Buffered;
+    for (int i = 0; i < 8; i++)
+    {
+        padding[padSize + (size_t)i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    Update(padding, padSize + 8);
+
+    for (int i = 0; i < 8; i++)
+    {
+        hash[4 * i] = (uint8_t)(m_State[i] >> 24);
+        hash[4 * i + 1] = (uint8_t)(m_State[i] >> 16);
+        hash[4 * i + 2] = (uint8_t)(m_State[i] >> 8);
+        hash[4 * i + 3] = (uint8_t)m_State[i];
+    }
+}
+
+void CSha256::Compress(const uint8_t* block)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = ((uint32_t)block[4 * i] << 24) | ((uint32_t)block[4 * i + 1] << 16) | ((uint32_t)block[4 * i + 2] << 8) |
+               (uint32_t)block[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++)
+    {
+        const uint32_t s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = m_State[0], b = m_State[1], c = m_State[2], d = m_State[3];
+    uint32_t e = m_State[4], f = m_State[5], g = m_State[6], h = m_State[7];
+    for (int i = 0; i < 64; i++)
+    {
+        const uint32_t s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+        const uint32_t choice = (e & f) ^ (~e & g);
+        const uint32_t t1 = h + s1 + choice + s_RoundConstants[i] + w[i];
+        const uint32_t s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+        const uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+        const uint32_t t2 = s0 + majority;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    m_State[0] += a;
+    m_State[1] += b;
+    m_State[2] += c;
+    m_State[3] += d;
+    m_State[4] += e;
+    m_State[5] += f;
+    m_State[6] += g;
+    m_State[7] += h;
+}
+
+void Sha256(const void* data, size_t size, uint8_t hash[SHA256_SIZE])
+{
+    CSha256 sha;
+    sha.Update(data, size);
+    sha.Final(hash);
+}
+
+void HmacSha256(const void* key, size_t keySize, const void* data, size_t size, uint8_t mac[SHA256_SIZE])
+{
+    // Keys longer than a block are hashed first
+    uint8_t block[SHA256_BLOCK_SIZE] = {};
+    if (keySize > SHA256_BLOCK_SIZE)
+    {
+        Sha256(key, keySize, block);
+    }
+    else if (keySize > 0)
+    {
+        memcpy(block, key, keySize);
+    }
+
+    uint8_t pad[SHA256_BLOCK_SIZE];
+    for (int i = 0; i < SHA256_BLOCK_SIZE; i++)
+    {
+        pad[i] = (uint8_t)(block[i] ^ 0x36);
+    }
+    uint8_t inner[SHA256_SIZE];
+    CSha256 sha;
+    sha.Update(pad, sizeof(pad));
+    sha.Update(data, size);
+    sha.Final(inner);
+
+    for (int i = 0; i < SHA256_BLOCK_SIZE; i++)
+    {
+        pad[i] = (uint8_t)(block[i] ^ 0x5c);
+    }
+    sha.Reset();
+    sha.Update(pad, sizeof(pad));
+    sha.Update(inner, sizeof(inner));
+    sha.Final(mac);
+}
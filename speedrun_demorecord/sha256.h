@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_SIZE 32
+#define SHA256_BLOCK_SIZE 64
+
+//---------------------------------------------------------------------------------
+// Purpose: SHA-256 (FIPS 180-4), fed in pieces. Only used on small things like a session digest, so plain C++.
+//---------------------------------------------------------------------------------
+class CSha256
+{
+    public:
+    CSha256();
+
+    void Reset();
+    void Update(const void* data, size_t size);
+
+    // Writes the hash, Reset before hashing anything else
+    void Final(uint8_t hash[SHA256_SIZE]);
+
+    private:
+    void Compress(const uint8_t* block);
+
+    uint32_t m_State[8];
+    uint8_t m_Buffer[SHA256_BLOCK_SIZE];
+    size_t m_Buffered;
+    uint64_t m_Length;
+};
+
+void Sha256(const void* data, size_t size, uint8_t hash[SHA256_SIZE]);
+
+// HMAC-SHA256 (RFC 2104) of data with key
+void HmacSha256(const void* key, size_t keySize, const void* data, size_t size, uint8_t mac[SHA256_SIZE]);
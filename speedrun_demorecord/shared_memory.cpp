@@ -0,0 +1,156 @@
+#include "shared_memory.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static std::string GetPlatformName(const char* name)
+{
+#ifdef _WIN32
+    return std::string("Local\\") + name;
+#else
+    return std::string("/") + name;
+#endif
+}
+
+CSharedMemory::CSharedMemory()
+    : m_pData(NULL),
+      m_Size(0),
+      m_bOwner(false)
+#ifdef _WIN32
+      ,
+      m_hMapping(NULL)
+#endif
+{
+}
+
+CSharedMemory::~CSharedMemory()
+{
+    Close();
+}
+
+bool CSharedMemory::Create(const char* name, size_t size)
+{
+    Close();
+
+    const std::string platformName = GetPlatformName(name);
+#ifdef _WIN32
+    HANDLE hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE,
+                                         NULL,
+                                         PAGE_READWRITE,
+                                         (DWORD)((uint64_t)size >> 32),
+                                         (DWORD)size,
+                                         platformName.c_str());
+    void* view = hMapping ? MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, size) : NULL;
+    if (!view)
+    {
+        if (hMapping)
+            CloseHandle(hMapping);
+        return false;
+    }
+    m_hMapping = hMapping;
+#else
+    int fd = shm_open(platformName.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+        return false;
+
+    if (ftruncate(fd, (off_t)size) != 0)
+    {
+        close(fd);
+        shm_unlink(platformName.c_str());
+        return false;
+    }
+
+    void* view = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+    {
+        shm_unlink(platformName.c_str());
+        return false;
+    }
+#endif
+
+    m_pData = view;
+    m_Size = size;
+    m_bOwner = true;
+    m_Name = platformName;
+    return true;
+}
+
+bool CSharedMemory::Open(const char* name, size_t size)
+{
+    Close();
+
+    const std::string platformName = GetPlatformName(name);
+#ifdef _WIN32
+    HANDLE hMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, platformName.c_str());
+    void* view = hMapping ? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view)
+    {
+        if (hMapping)
+            CloseHandle(hMapping);
+        return false;
+    }
+
+    MEMORY_BASIC_INFORMATION info;
+    if (VirtualQuery(view, &info, sizeof(info)) == 0 || info.RegionSize < size)
+    {
+        UnmapViewOfFile(view);
+        CloseHandle(hMapping);
+        return false;
+    }
+    m_hMapping = hMapping;
+#else
+    int fd = shm_open(platformName.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < (uint64_t)size)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* view = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+        return false;
+#endif
+
+    m_pData = view;
+    m_Size = size;
+    m_bOwner = false;
+    m_Name = platformName;
+    return true;
+}
+
+void CSharedMemory::Close()
+{
+    if (!m_pData)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_pData);
+    CloseHandle(m_hMapping);
+    m_hMapping = NULL;
+#else
+    munmap(m_pData, m_Size);
+    if (m_bOwner)
+    {
+        shm_unlink(m_Name.c_str());
+    }
+#endif
+
+    m_pData = NULL;
+    m_Size = 0;
+    m_bOwner = false;
+    m_Name.clear();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+//---------------------------------------------------------------------------------
+// Purpose: named shared memory segment other processes can map. Names are plain words ("speedrun_demorecord_live"),
+// the platform's prefix is added here: "Local\" on Windows (the user's session), "/" for shm_open elsewhere.
+//
+// The creator owns the name: on Linux it is unlinked again by Close, on Windows it goes away with the last handle.
+// Readers keep their mapping until they close it either way.
+//---------------------------------------------------------------------------------
+class CSharedMemory
+{
+    public:
+    CSharedMemory();
+    ~CSharedMemory();
+
+    // Creates (or takes over) the segment with size bytes, zeroed if it is new, mapped read/write
+    bool Create(const char* name, size_t size);
+
+    // Maps an existing segment read-only, false if there is none or it is smaller than size
+    bool Open(const char* name, size_t size);
+
+    void Close();
+
+    bool IsOpen() const
+    {
+        return m_pData != NULL;
+    }
+    void* GetData() const
+    {
+        return m_pData;
+    }
+    size_t GetSize() const
+    {
+        return m_Size;
+    }
+
+    private:
+    CSharedMemory(const CSharedMemory&);
+    CSharedMemory& operator=(const CSharedMemory&);
+
+    void* m_pData;
+    size_t m_Size;
+    bool m_bOwner;
+    std::string m_Name;
+#ifdef _WIN32
+    void* m_hMapping;
+#endif
+};
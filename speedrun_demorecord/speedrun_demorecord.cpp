@@ -57,17 +57,50 @@ static ConVar speedrun_dir("speedrun_dir",
                            "./",
                            FCVAR_ARCHIVE | FCVAR_DONTRECORD,
                            "Sets the directory for demos to record to.");
+static DEMREC_CONVAR_CALLBACK(OnSpeedrunMapChanged);
+static DEMREC_CONVAR_CALLBACK(OnSpeedrunSaveChanged);
 static ConVar speedrun_map("speedrun_map",
                            "",
                            FCVAR_ARCHIVE | FCVAR_DONTRECORD,
-                           "Sets the first map in the game which will be started when speedrun_start is executed.");
+                           "Sets the first map in the game which will be started when speedrun_start is executed.",
+                           OnSpeedrunMapChanged);
 static ConVar speedrun_save(
     "speedrun_save",
     "",
     FCVAR_ARCHIVE | FCVAR_DONTRECORD,
     "If empty, speedrun_start will start using map specifiec in speedrun_map. If save is specified, speedrun_start "
     "will start using the save instead of a map. If the specified save does not exist, the speedrun will start using "
-    "specified map. The save specified MUST BE in the SAVE folder!!");
+    "specified map. The save specified MUST BE in the SAVE folder!!",
+    OnSpeedrunSaveChanged);
+static ConVar speedrun_playlist_rate("speedrun_playlist_rate",
+                                     "10",
+                                     FCVAR_ARCHIVE | FCVAR_DONTRECORD,
+                                     "Playback rate the .vdm files of speedrun_playlist set, 0 leaves the rate alone.");
+static ConVar speedrun_playlist_end("speedrun_playlist_end",
+                                    "exit",
+                                    FCVAR_ARCHIVE | FCVAR_DONTRECORD,
+                                    "Commands speedrun_playlist runs at the end of the last demo.");
+static ConVar speedrun_playback_prefetch("speedrun_playback_prefetch",
+                                         "2",
+                                         FCVAR_ARCHIVE | FCVAR_DONTRECORD,
+                                         "How many demos ahead of the one playing speedrun_playback reads into the OS "
+                                         "cache, 0 only measures the gaps between demos.");
+static ConVar speedrun_telemetry("speedrun_telemetry",
+                                 "0",
+                                 FCVAR_ARCHIVE | FCVAR_DONTRECORD,
+                                 "Writes the host tick, frame time and recording state of every server frame of a run "
+                                 "to the session dir, read it with telemetry_dump.");
+static ConVar speedrun_segment_keep("speedrun_segment_keep",
+                                    "0",
+                                    FCVAR_ARCHIVE | FCVAR_DONTRECORD,
+                                    "How many earlier attempts of each map speedrun_segment keeps as "
+                                    "<map>_slot<N>.dem, 0 overwrites <map>.dem on every reload.");
+
+static ConVar speedrun_digest_key("speedrun_digest_key",
+                                  "",
+                                  FCVAR_DONTRECORD | FCVAR_PROTECTED,
+                                  "Key the digest speedrun_stop writes next to the demos is sealed with (HMAC-SHA256), "
+                                  "check it with verify_digest -k. Empty seals with a plain SHA-256.");
 
 //
 // The plugin is a static singleton that is exported as an interface
@@ -81,13 +114,7 @@ EXPOSE_SINGLE_INTERFACE_GLOBALVAR(CSpeedrunDemoRecord,
 //---------------------------------------------------------------------------------
 // Purpose: constructor/destructor
 //---------------------------------------------------------------------------------
-CSpeedrunDemoRecord::CSpeedrunDemoRecord()
-{
-    recordMode = DEMREC_DISABLED;
-    retries = 0;
-    lastMapName = "UNKNOWN_MAP";
-    currentMapName = "UNKNOWN_MAP";
-}
+CSpeedrunDemoRecord::CSpeedrunDemoRecord() {}
 
 CSpeedrunDemoRecord::~CSpeedrunDemoRecord() {}
 
@@ -108,6 +135,13 @@ bool CSpeedrunDemoRecord::Load(CreateInterfaceFn interfaceFactory, CreateInterfa
 
     filesystem = (IFileSystem*)interfaceFactory(FILESYSTEM_INTERFACE_VERSION, NULL);
 
+    // Only used for tick measurements, not required
+    playerinfomanager = (IPlayerInfoManager*)gameServerFactory(INTERFACEVERSION_PLAYERINFOMANAGER, NULL);
+    if (playerinfomanager)
+    {
+        gpGlobals = playerinfomanager->GetGlobalVars();
+    }
+
     // get the interfaces we want to use
     if (!(engine && clientEngine && filesystem && g_pFullFileSystem))
     {
@@ -131,7 +165,36 @@ bool CSpeedrunDemoRecord::Load(CreateInterfaceFn interfaceFactory, CreateInterfa
     ConVar_Register(0);
 #endif
 
-    findFirstMap();
+    // speedrun_map defaults to the start of the first chapter
+    RefreshMapCatalog();
+    if (FStrEq(speedrun_map.GetString(), ""))
+    {
+        speedrun_map.SetValue(mapCatalog.GetFirstMap());
+    }
+
+    // Background writes go straight to disk, relative to the same directory the engine writes to
+    char writePath[MAX_PATH] = {};
+    filesystem->GetSearchPath("DEFAULT_WRITE_PATH", false, writePath, sizeof(writePath));
+    if (writePath[0] == '\0')
+    {
+        filesystem->GetSearchPath("MOD", false, writePath, sizeof(writePath));
+    }
+
+    // Multiple search paths are separated by ';', the first one is where files get written
+    char* separator = strchr(writePath, ';');
+    if (separator)
+    {
+        *separator = '\0';
+    }
+    fileWriter.Start(writePath);
+    demoIndexer.Start(writePath);
+    demoPrefetcher.Start(writePath);
+
+    // Timers can still read the console if this fails, not worth refusing to load over
+    if (!liveSplitFeed.Open(LIVESPLIT_SHM_NAME))
+    {
+        DemRecMsgWarning("Could not create the live split feed, timers won't see the run.\n");
+    }
 
     DemRecMsgSuccess("Speedrun_demorecord Loaded\n");
 
@@ -143,6 +206,15 @@ bool CSpeedrunDemoRecord::Load(CreateInterfaceFn interfaceFactory, CreateInterfa
 //---------------------------------------------------------------------------------
 void CSpeedrunDemoRecord::Unload(void)
 {
+    {
+        LATENCY_SCOPE(latencyStats, LATENCY_IO_FLUSH);
+        fileWriter.Shutdown();
+    }
+    demoIndexer.Shutdown();
+    demoPrefetcher.Shutdown();
+    telemetrySampler.Stop();
+    liveSplitFeed.Close();
+
 #if !defined(SSDK2006)
     ConVar_Unregister();
 #endif
@@ -164,11 +236,12 @@ const char* CSpeedrunDemoRecord::GetPluginDescription(void)
 //---------------------------------------------------------------------------------
 void CSpeedrunDemoRecord::LevelInit(char const* pMapName)
 {
-    if (recordMode != DEMREC_DISABLED)
-    {
-        std::string str(pMapName);
-        currentMapName = str;
-    }
+    LATENCY_SCOPE(latencyStats, LATENCY_LEVELINIT);
+
+    // Resolves the demo name now so ClientConnect only has to send the command
+    demoRecordSession.OnLevelInit(pMapName);
+    mapCatalog.AddMap(pMapName);
+    liveSplitFeed.OnLevelInit(pMapName);
 }
 
 //---------------------------------------------------------------------------------
@@ -182,19 +255,52 @@ void CSpeedrunDemoRecord::ServerActivate(edict_t* pEdictList, int edictCount, in
 //---------------------------------------------------------------------------------
 void CSpeedrunDemoRecord::LevelShutdown(void) // !!!!this can get called multiple times per map change
 {
-    if (recordMode == DEMREC_STANDARD)
+    LATENCY_SCOPE(latencyStats, LATENCY_LEVELSHUTDOWN);
+
+    demoRecordSession.OnLevelShutdown();
+    liveSplitFeed.OnLevelShutdown();
+
+    // The demo speedrun_playback is playing ended, the gap to the next one starts
+    if (demoPrefetcher.IsActive() && clientEngine->IsPlayingDemo())
+    {
+        demoPrefetcher.OnDemoEnded();
+    }
+
+    // Picks up saves and maps made since, only while no run could lose ticks to it
+    if (demoRecordSession.GetMode() == DEMREC_DISABLED)
+    {
+        RefreshMapCatalog();
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: called every server frame, used to see when a requested recording actually starts
+//---------------------------------------------------------------------------------
+void CSpeedrunDemoRecord::GameFrame(bool simulating)
+{
+    demoRecordSession.OnGameFrame();
+
+    // A few field reads and a copy into the ring, the disk is the sampler thread's business
+    if (telemetrySampler.IsRunning())
     {
-        if (clientEngine->IsPlayingDemo() == false && clientEngine->IsRecordingDemo() == true)
-        {
-            clientEngine->ClientCmd("stop");
-        }
+        int flags = simulating ? TELEMETRY_SIMULATING : 0;
+        flags |= clientEngine->IsRecordingDemo() ? TELEMETRY_RECORDING : 0;
+        flags |= clientEngine->IsPlayingDemo() ? TELEMETRY_PLAYING : 0;
+        telemetrySampler.Sample(engineHost.GetServerTick(),
+                                engineHost.GetDemoTick(),
+                                gpGlobals ? gpGlobals->frametime : 0.0f,
+                                (uint8_t)flags);
     }
 }
 
 //---------------------------------------------------------------------------------
 // Purpose: called when a client spawns into a server (i.e as they begin to play)
 //---------------------------------------------------------------------------------
-void CSpeedrunDemoRecord::ClientActive(edict_t* pEntity) {}
+void CSpeedrunDemoRecord::ClientActive(edict_t* pEntity)
+{
+    demoRecordSession.OnClientActive();
+    liveSplitFeed.OnClientActive();
+}
 
 //---------------------------------------------------------------------------------
 // Purpose: called when a client leaves a server (or is timed out)
@@ -216,58 +322,17 @@ PLUGIN_RESULT CSpeedrunDemoRecord::ClientConnect(bool* bAllowConnect,
                                                  char* reject,
                                                  int maxrejectlen)
 {
-    if (recordMode != DEMREC_DISABLED)
-    {
-        if (clientEngine->IsPlayingDemo() == false)
-        {
-            std::string& curMap = currentMapName;
+    LATENCY_SCOPE(latencyStats, LATENCY_CLIENTCONNECT);
 
-            if (curMap.find("background") == -1)
-            {
-                // Max path length is 32000 but 256 is easier on RAM, I read that somewhere not sure if it's true tho.
-                // Might want to increase if people have problems...
-                char command[CMD_SIZE] = {};
-
-                // Q: Why does game crash when I record a demo?
-                // A: Strange character/letters in path OR your path exceeds 256 characters, windows max is 320.
-                if (lastMapName == curMap && recordMode == DEMREC_STANDARD)
-                {
-                    retries++;
-                    Q_snprintf(currentDemoName, DEMO_NAME_SIZE, "%s_%d", curMap.c_str(), retries);
-                }
-                else
-                {
-                    int storedretries;
-                    if (recordMode == DEMREC_SEGMENTED)
-                    {
-                        storedretries = 0;
-                    }
-                    else
-                    {
-                        storedretries = demoExists(curMap.c_str());
-                    }
-
-                    if (storedretries != 0)
-                    {
-                        retries = storedretries;
-                        Q_snprintf(currentDemoName, DEMO_NAME_SIZE, "%s_%d", curMap.c_str(), retries);
-                    }
-                    else
-                    {
-                        retries = 0;
-                        Q_snprintf(currentDemoName, DEMO_NAME_SIZE, "%s", curMap.c_str());
-                    }
-
-                    lastMapName = curMap;
-                }
-
-                // Always ensure path exists before attempting to record
-                // Otherwise, record command will fail!
-                createDirIfNonExistant(sessionDir);
-                Q_snprintf(command, sizeof(command) / sizeof(char), "record %s%s\n", sessionDir, currentDemoName);
-                clientEngine->ClientCmd(command);
-            }
-        }
+    demoRecordSession.OnClientConnect();
+    liveSplitFeed.OnClientConnect(demoRecordSession.GetCurrentDemoName(), demoRecordSession.GetRetries());
+
+    // The next demo of speedrun_playback started, read ahead of it
+    if (demoPrefetcher.IsActive() && clientEngine->IsPlayingDemo() && demoPrefetcher.OnDemoStarted())
+    {
+        std::string table;
+        demoPrefetcher.FormatTable(table);
+        DemRecMsgInfo("Last demo of the playback.\n%s", table.c_str());
     }
     return PLUGIN_CONTINUE;
 }
@@ -277,80 +342,225 @@ PLUGIN_RESULT CSpeedrunDemoRecord::ClientConnect(bool* bAllowConnect,
 //---------------------------------------------------------------------------------
 
 //---------------------------------------------------------------------------------
-// Purpose: checks if chosen directory exists, if not attempts to create folder (please dont hate me noobest)
+// Purpose: IDemoRecordHost on top of the engine interfaces
 //---------------------------------------------------------------------------------
-int demoExists(const char* curMap)
+bool CEngineDemoRecordHost::IsPlayingDemo()
 {
-    // 1) Search for demos with map name in filename
-    // 2) If none found, return 0
-    // 3) If found, check for an _#, if none return a 1, else if # > 1, add 1 to that number and return #+1
+    return clientEngine->IsPlayingDemo();
+}
 
-    FileFindHandle_t findHandle;
-    int retriesTmp = 0;
+bool CEngineDemoRecordHost::IsRecordingDemo()
+{
+    return clientEngine->IsRecordingDemo();
+}
 
-    char path[MAX_PATH] = {};
-    Q_snprintf(path, sizeof(path) / sizeof(char), "%s%s*", sessionDir, curMap);
+void CEngineDemoRecordHost::ClientCmd(const char* command)
+{
+    clientEngine->ClientCmd(command);
+}
+
+int CEngineDemoRecordHost::GetServerTick()
+{
+    return gpGlobals ? gpGlobals->tickcount : -1;
+}
+
+int CEngineDemoRecordHost::GetDemoTick()
+{
+    // clientEngine->GetDemoRecordingTick() only in 5135
+#ifdef SSDK2013
+    return clientEngine->GetDemoRecordingTick();
+#else
+    return -1;
+#endif
+}
+
+bool CEngineDemoRecordHost::IsDirectory(const char* path)
+{
+    return filesystem->IsDirectory(path, "MOD");
+}
+
+void CEngineDemoRecordHost::CreateDirHierarchy(const char* path)
+{
+    filesystem->CreateDirHierarchy(path, "DEFAULT_WRITE_PATH");
+}
 
-    const char* pFilename = filesystem->FindFirstEx(path, "MOD", &findHandle);
+void CEngineDemoRecordHost::FindFiles(const char* wildcard, std::vector<std::string>& fileNames)
+{
+    FileFindHandle_t findHandle;
+    const char* pFilename = filesystem->FindFirstEx(wildcard, "MOD", &findHandle);
     while (pFilename != NULL)
     {
+        fileNames.push_back(pFilename);
         pFilename = filesystem->FindNext(findHandle);
-        retriesTmp++;
     }
     filesystem->FindClose(findHandle);
+}
+
+bool CEngineDemoRecordHost::ReadFile(const char* path, std::string& contents)
+{
+    FileHandle_t file = filesystem->Open(path, "rb", "MOD");
+    if (!file)
+        return false;
 
-    return retriesTmp;
+    int file_len = filesystem->Size(file);
+    contents.resize(file_len > 0 ? (size_t)file_len : 0);
+    if (file_len > 0)
+    {
+        file_len = filesystem->Read(&contents[0], file_len, file);
+        contents.resize(file_len > 0 ? (size_t)file_len : 0);
+    }
+    filesystem->Close(file);
+    return true;
 }
 
-//---------------------------------------------------------------------------------
-// Purpose: checks if chosen directory exists, if not attempts to create folder
-//---------------------------------------------------------------------------------
-void createDirIfNonExistant(const char* modRelativePath)
+void CEngineDemoRecordHost::WriteFile(const char* path, const void* data, size_t size, bool append, bool sync)
 {
-    if (!modRelativePath)
-        return;
+    const int flags = sync ? FILEJOB_FLAG_SYNC : 0;
+    bool queued = append ? fileWriter.Append(path, data, size, flags) : fileWriter.Write(path, data, size, flags);
+    if (!queued)
+    {
+        DemRecMsgWarning("Write queue is full, %s was not written!\n", path);
+    }
+}
 
-    if (!filesystem->IsDirectory(modRelativePath), "MOD")
+void CEngineDemoRecordHost::RemoveFile(const char* path)
+{
+    // Queued behind any pending write of the same file
+    fileWriter.Remove(path);
+}
+
+bool CEngineDemoRecordHost::RenameFile(const char* from, const char* to)
+{
+    // Queued writes and removals of either name land first
+    fileWriter.Flush();
+
+    if (!filesystem->FileExists(from, "MOD"))
+        return false;
+    if (filesystem->FileExists(to, "MOD"))
     {
-        char path[MAX_PATH] = {};
-        Q_strncpy(path, modRelativePath, sizeof(path) / sizeof(char));
-        Q_FixSlashes(path);
-        filesystem->CreateDirHierarchy(path, "DEFAULT_WRITE_PATH");
+        filesystem->RemoveFile(to, "MOD");
     }
+    return filesystem->RenameFile(from, to, "MOD");
+}
+
+void CEngineDemoRecordHost::QueueRenameFile(const char* from, const char* to)
+{
+    if (!fileWriter.Rename(from, to))
+    {
+        DemRecMsgWarning("Write queue is full, %s was not moved!\n", from);
+    }
+}
+
+uint64_t CEngineDemoRecordHost::GetFileJobTicket()
+{
+    return fileWriter.GetTicket();
+}
+
+bool CEngineDemoRecordHost::IsFileJobDone(uint64_t ticket)
+{
+    return fileWriter.IsDone(ticket);
+}
+
+void CEngineDemoRecordHost::OnRecordingStarted(const char* demoName, int ticksAfterSpawn)
+{
+    // Visible with developer 1
+    DevMsg("[Speedrun] %s started recording %d ticks after spawn\n", demoName, ticksAfterSpawn);
+}
+
+void CEngineDemoRecordHost::OnDemoStopped(const char* demoPath)
+{
+    demoIndexer.Queue(demoPath);
+}
+
+void CEngineDemoRecordHost::OnSessionStopped(const char* sessionDir)
+{
+    demoIndexer.QueueSessionDigest(sessionDir, speedrun_digest_key.GetString());
 }
 
 //---------------------------------------------------------------------------------
-// Purpose: Tries to find first map in maplist.txt that doesnt have the word "background" in it.
-// Should only be ran first time? Returns char array
+// Purpose: IMapCatalogSource on top of the filesystem, "GAME" so maps of the base game in its packs count too
 //---------------------------------------------------------------------------------
-void findFirstMap()
+void CEngineMapCatalogSource::FindFiles(const char* wildcard, std::vector<std::string>& fileNames)
+{
+    FileFindHandle_t findHandle;
+    const char* pFilename = filesystem->FindFirstEx(wildcard, "GAME", &findHandle);
+    while (pFilename != NULL)
+    {
+        fileNames.push_back(pFilename);
+        pFilename = filesystem->FindNext(findHandle);
+    }
+    filesystem->FindClose(findHandle);
+}
+
+bool CEngineMapCatalogSource::ReadFile(const char* path, std::string& contents)
 {
-    // check if it is empty true: stop, false: cont
-    FileHandle_t firstMapConfig = filesystem->Open("cfg/chapter1.cfg", "r", "MOD");
+    FileHandle_t file = filesystem->Open(path, "rb", "GAME");
+    if (!file)
+        return false;
 
-    // check if it exists is there: cont, dne: stop
-    if (firstMapConfig)
+    int file_len = filesystem->Size(file);
+    contents.resize(file_len > 0 ? (size_t)file_len : 0);
+    if (file_len > 0)
     {
-        int file_len = filesystem->Size(firstMapConfig);
-        char* firstMap = new char[file_len + 1];
+        file_len = filesystem->Read(&contents[0], file_len, file);
+        contents.resize(file_len > 0 ? (size_t)file_len : 0);
+    }
+    filesystem->Close(file);
+    return true;
+}
 
-        filesystem->ReadLine(firstMap, file_len + 1, firstMapConfig);
-        firstMap[file_len] = '\0';
-        filesystem->Close(firstMapConfig);
+int64_t CEngineMapCatalogSource::GetFileTime(const char* path)
+{
+    return (int64_t)filesystem->GetFileTime(path, "GAME");
+}
 
-        *std::remove(firstMap, firstMap + strlen(firstMap), '\n') = '\0'; // Remove new lines
-        *std::remove(firstMap, firstMap + strlen(firstMap), '\r') = '\0'; // Remove returns
+//---------------------------------------------------------------------------------
+// Purpose: lists whatever changed in maps/, cfg/ and SAVE/ since the last refresh
+//---------------------------------------------------------------------------------
+void RefreshMapCatalog()
+{
+    LATENCY_SCOPE(latencyStats, LATENCY_FS_FINDFILES);
+    mapCatalog.Refresh(mapCatalogSource);
+}
 
-        std::string mapName =
-            std::string(firstMap).substr(std::string(firstMap).find("map ") + 4); // get rid of words "map "
+//---------------------------------------------------------------------------------
+// Purpose: telemetry of a run, one file per start so a resumed run or a shared segment dir never overwrites one
+//---------------------------------------------------------------------------------
+void StartTelemetry()
+{
+    if (!speedrun_telemetry.GetBool() || telemetrySampler.IsRunning())
+        return;
 
-        // Will this work? Might have to be FRstrEq(speedrun_map.GetString(), NULL) == true
-        if (FStrEq(speedrun_map.GetString(), ""))
-        {
-            speedrun_map.SetValue(mapName.c_str());
-        }
+    char relativePath[MAX_PATH] = {};
+    Q_snprintf(relativePath,
+               sizeof(relativePath) / sizeof(char),
+               "%sspeedrun_democrecord_%lld" TELEMETRY_EXTENSION,
+               demoRecordSession.GetSessionDir(),
+               (long long)time(NULL));
+    Q_FixSlashes(relativePath);
+
+    std::string path;
+    fileWriter.ResolvePath(relativePath, path);
+    if (!telemetrySampler.Start(path.c_str()))
+    {
+        DemRecMsgWarning("Could not create %s, no telemetry for this run.\n", relativePath);
+    }
+}
+
+void StopTelemetry()
+{
+    if (!telemetrySampler.IsRunning())
+        return;
+
+    telemetrySampler.Stop();
 
-        delete[] firstMap;
+    TelemetryStats_t stats;
+    telemetrySampler.GetStats(stats);
+    if (stats.dropped + stats.failed > 0)
+    {
+        DemRecMsgWarning("Telemetry lost %llu of %llu frames, see speedrun_stats.\n",
+                         (unsigned long long)(stats.dropped + stats.failed),
+                         (unsigned long long)(stats.sampled + stats.dropped));
     }
 }
 
@@ -377,72 +587,205 @@ void ConvertTimeToLocalTime(const time_t& t, struct tm& ltime)
 //---------------------------------------------------------------------------------
 // Purpose: Con Commands
 //---------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------
+// Purpose: speedrun_map and speedrun_save are checked against the catalog as soon as they are set, not when the
+// engine fails to load them
+//---------------------------------------------------------------------------------
+static DEMREC_CONVAR_CALLBACK(OnSpeedrunMapChanged)
+{
+    // An empty catalog can't tell, a mod may keep its maps where the listing doesn't see them
+    const char* mapName = speedrun_map.GetString();
+    if (mapName[0] != '\0' && mapCatalog.GetMapCount() > 0 && !mapCatalog.HasMap(mapName))
+    {
+        DemRecMsgWarning("speedrun_map: the game has no map %s, see speedrun_setmap.\n", mapName);
+    }
+}
+
+static DEMREC_CONVAR_CALLBACK(OnSpeedrunSaveChanged)
+{
+    const char* saveName = speedrun_save.GetString();
+    if (saveName[0] == '\0')
+        return;
+
+    // The save may have been made since the last refresh, speedrun_start looks again too if it is still missing
+    if (!mapCatalog.HasSave(saveName))
+    {
+        LATENCY_SCOPE(latencyStats, LATENCY_FS_FINDFILES);
+        mapCatalog.RefreshSaves(mapCatalogSource);
+    }
+    if (!mapCatalog.HasSave(saveName))
+    {
+        DemRecMsgWarning("speedrun_save: there is no SAVE/%s.sav, speedrun_start will load speedrun_map.\n", saveName);
+    }
+}
+
+// partial is the whole line so far ("speedrun_setmap d1_ca"), every item has to be the whole line too
+static int CompleteCatalogNames(const char* command,
+                                bool bSaves,
+                                const char* partial,
+                                char commands[COMMAND_COMPLETION_MAXITEMS][COMMAND_COMPLETION_ITEM_LENGTH])
+{
+    const char* prefix = strchr(partial, ' ');
+    prefix = prefix ? prefix + 1 : "";
+
+    std::vector<std::string> names;
+    if (bSaves)
+    {
+        mapCatalog.CompleteSaves(prefix, names, COMMAND_COMPLETION_MAXITEMS);
+    }
+    else
+    {
+        mapCatalog.CompleteMaps(prefix, names, COMMAND_COMPLETION_MAXITEMS);
+    }
+
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        Q_snprintf(commands[i], COMMAND_COMPLETION_ITEM_LENGTH, "%s %s", command, names[i].c_str());
+    }
+    return (int)names.size();
+}
+
+static int CompleteMapNames(const char* partial,
+                            char commands[COMMAND_COMPLETION_MAXITEMS][COMMAND_COMPLETION_ITEM_LENGTH])
+{
+    return CompleteCatalogNames("speedrun_setmap", false, partial, commands);
+}
+
+static int CompleteSaveNames(const char* partial,
+                             char commands[COMMAND_COMPLETION_MAXITEMS][COMMAND_COMPLETION_ITEM_LENGTH])
+{
+    return CompleteCatalogNames("speedrun_setsave", true, partial, commands);
+}
+
+// "name" without ".bsp"/".sav", the way the map and load commands take it
+static std::string StripCatalogExtension(const char* name, const char* extension)
+{
+    std::string stripped = name;
+    const size_t length = strlen(extension);
+    if (stripped.size() > length && Q_stricmp(stripped.c_str() + stripped.size() - length, extension) == 0)
+    {
+        stripped.erase(stripped.size() - length);
+    }
+    return stripped;
+}
+
+DEMREC_COMMAND_F_COMPLETION(speedrun_setmap,
+                            "speedrun_setmap <map> sets speedrun_map to one of the game's maps, tab completes them. "
+                            "Without a map it lists the chapter starts.",
+                            FCVAR_DONTRECORD,
+                            CompleteMapNames)
+{
+    if (DEMREC_ARGC() < 2)
+    {
+        const std::vector<CatalogChapter_t>& chapters = mapCatalog.GetChapters();
+        for (size_t i = 0; i < chapters.size(); i++)
+        {
+            Msg("%-16s %s\n", chapters[i].fileName.c_str(), chapters[i].mapName.c_str());
+        }
+        DemRecMsgInfo("%u maps, %u chapters. speedrun_map is \"%s\".\n",
+                      (unsigned)mapCatalog.GetMapCount(),
+                      (unsigned)chapters.size(),
+                      speedrun_map.GetString());
+        return;
+    }
+
+    if (!mapCatalog.HasMap(DEMREC_ARGV(1)))
+    {
+        DemRecMsgWarning("The game has no map %s. Added just now? Run speedrun_catalog_refresh.\n", DEMREC_ARGV(1));
+        return;
+    }
+
+    speedrun_map.SetValue(StripCatalogExtension(DEMREC_ARGV(1), ".bsp").c_str());
+    DemRecMsgSuccess("speedrun_map is %s.\n", speedrun_map.GetString());
+}
+
+DEMREC_COMMAND_F_COMPLETION(speedrun_setsave,
+                            "speedrun_setsave <save> sets speedrun_save to one of the saves in SAVE, tab completes "
+                            "them. speedrun_setsave \"\" starts runs from speedrun_map again.",
+                            FCVAR_DONTRECORD,
+                            CompleteSaveNames)
+{
+    if (DEMREC_ARGC() < 2)
+    {
+        DemRecMsgInfo("%u saves. speedrun_save is \"%s\".\n",
+                      (unsigned)mapCatalog.GetSaveCount(),
+                      speedrun_save.GetString());
+        return;
+    }
+
+    const char* saveName = DEMREC_ARGV(1);
+    if (saveName[0] != '\0' && !mapCatalog.HasSave(saveName))
+    {
+        LATENCY_SCOPE(latencyStats, LATENCY_FS_FINDFILES);
+        mapCatalog.RefreshSaves(mapCatalogSource);
+    }
+    if (saveName[0] != '\0' && !mapCatalog.HasSave(saveName))
+    {
+        DemRecMsgWarning("There is no SAVE/%s.sav.\n", StripCatalogExtension(saveName, ".sav").c_str());
+        return;
+    }
+
+    speedrun_save.SetValue(StripCatalogExtension(saveName, ".sav").c_str());
+    DemRecMsgSuccess("speedrun_save is \"%s\".\n", speedrun_save.GetString());
+}
+
+CON_COMMAND_F(speedrun_catalog_refresh,
+              "lists maps, chapter configs and saves again now, instead of on the next load outside of a run",
+              FCVAR_DONTRECORD)
+{
+    RefreshMapCatalog();
+    DemRecMsgInfo("%u maps, %u chapters, %u saves.\n",
+                  (unsigned)mapCatalog.GetMapCount(),
+                  (unsigned)mapCatalog.GetChapters().size(),
+                  (unsigned)mapCatalog.GetSaveCount());
+}
+
 CON_COMMAND_F(speedrun_start, "starts run", FCVAR_DONTRECORD)
 {
+    LATENCY_SCOPE(latencyStats, LATENCY_SPEEDRUN_START);
+
     // Already recording segments? Throw error
-    if (recordMode == DEMREC_SEGMENTED)
+    if (demoRecordSession.GetMode() == DEMREC_SEGMENTED)
     {
         DemRecMsgWarning("Please stop segmented recording with speedrun_stop.\n");
     }
     else
     {
+        // Check to see if a save is specified in speedrun_save, if not use specified map in speedrun_map
+        // Make sure save exisits (only checking in SAVE folder), if none load specified map. The catalog knows, it
+        // only looks again when the save was made after its last refresh.
+        const char* saveName = speedrun_save.GetString();
+        if (saveName[0] != '\0' && !mapCatalog.HasSave(saveName))
+        {
+            LATENCY_SCOPE(latencyStats, LATENCY_FS_FINDFILES);
+            mapCatalog.RefreshSaves(mapCatalogSource);
+        }
+        const bool saveExists = saveName[0] != '\0' && mapCatalog.HasSave(saveName);
+
         // No map or save set? Throw error
         if (FStrEq(speedrun_map.GetString(), "") && FStrEq(speedrun_save.GetString(), ""))
         {
             DemRecMsgWarning("Please set a map with speedrun_map or save with speedrun_save first.\n");
         }
+        else if (!saveExists && mapCatalog.GetMapCount() > 0 && !mapCatalog.HasMap(speedrun_map.GetString()))
+        {
+            // Would only make an empty session dir
+            DemRecMsgWarning("The game has no map %s, set one with speedrun_setmap.\n", speedrun_map.GetString());
+        }
         else
         {
             // Let the user know
             DemRecMsgSuccess("Speedrun starting now...\n");
 
-            // Init standard recording mode
-            recordMode = DEMREC_STANDARD;
-            lastMapName = "";
-
-            // Get current time
+            // Creates the session dir and stores it in a resume txt file incase of crash
             struct tm ltime;
             ConvertTimeToLocalTime(time(NULL), ltime);
-
-            // Parse time
-            char tmpDir[32] = {};
-            Q_snprintf(tmpDir,
-                       sizeof(tmpDir) / sizeof(char),
-                       "%04i.%02i.%02i-%02i.%02i.%02i",
-                       ltime.tm_year,
-                       ltime.tm_mon,
-                       ltime.tm_mday,
-                       ltime.tm_hour,
-                       ltime.tm_min,
-                       ltime.tm_sec);
-
-            // Create dir
-            Q_snprintf(sessionDir, SESSION_DIR_SIZE, "%s%s\\", speedrun_dir.GetString(), tmpDir);
-            Q_FixSlashes(sessionDir);
-            filesystem->CreateDirHierarchy(sessionDir, "DEFAULT_WRITE_PATH");
-
-            // Store dir in a resume txt file incase of crash
-            int sessionDirLen = Q_strlen(sessionDir);
-
-            // Path to default directory
-            char path[MAX_PATH] = {};
-            Q_snprintf(path,
-                       sizeof(path) / sizeof(char),
-                       "%sspeedrun_democrecord_resume_info.txt",
-                       speedrun_dir.GetString());
-
-            // Print to file, let us know it was successful and play a silly sound :P
-            filesystem->AsyncWrite(path, sessionDir, sessionDirLen, false);
-            filesystem->AsyncFinishAllWrites();
-
-            // Check to see if a save is specified in speedrun_save, if not use specified map in speedrun_map
-            // Make sure save exisits (only checking in SAVE folder), if none load specified map.
-            char tmpSav[MAX_PATH] = {};
-            Q_snprintf(tmpSav, sizeof(tmpSav) / sizeof(char), ".\\SAVE\\%s.sav", speedrun_save.GetString());
-            Q_FixSlashes(tmpSav);
+            demoRecordSession.Start(speedrun_dir.GetString(), ltime);
+            liveSplitFeed.StartRun(DEMREC_STANDARD);
+            StartTelemetry();
 
             char command[CMD_SIZE] = {};
-            if (filesystem->FileExists(tmpSav, "MOD"))
+            if (saveExists)
             {
                 // Load save else...
                 DemRecMsgInfo("Loading from save...\n");
@@ -461,7 +804,7 @@ CON_COMMAND_F(speedrun_start, "starts run", FCVAR_DONTRECORD)
 
 CON_COMMAND_F(speedrun_segment, "segmenting mode", FCVAR_DONTRECORD)
 {
-    if (recordMode != DEMREC_DISABLED)
+    if (demoRecordSession.GetMode() != DEMREC_DISABLED)
     {
         // Already in standard record mode? Throw error!
         DemRecMsgWarning("Please stop all other speedruns with speedrun_stop.\n");
@@ -472,42 +815,90 @@ CON_COMMAND_F(speedrun_segment, "segmenting mode", FCVAR_DONTRECORD)
         DemRecMsgSuccess("Segment demo record activated, please reload/load a map to start recording...\n");
 
         // Init segment recording mode
-        recordMode = DEMREC_SEGMENTED;
-        Q_snprintf(sessionDir, SESSION_DIR_SIZE, "%s", speedrun_dir.GetString());
+        const int keep = speedrun_segment_keep.GetInt();
+        demoRecordSession.StartSegmented(speedrun_dir.GetString(), keep > 0 ? (uint32_t)keep : 0);
+        liveSplitFeed.StartRun(DEMREC_SEGMENTED);
+        StartTelemetry();
     }
 }
 
-CON_COMMAND_F(speedrun_resume, "resume a speedrun after a crash", FCVAR_DONTRECORD)
+// Queued by the session between stop and record, not meant to be typed
+CON_COMMAND_F(speedrun_segment_rotate,
+              "moves the last segment attempt of the map being loaded into its slot",
+              FCVAR_DONTRECORD)
 {
-    if (recordMode == DEMREC_DISABLED)
+    demoRecordSession.OnRotateAttempt();
+}
+
+CON_COMMAND_F(speedrun_segment_attempts,
+              "lists the segment attempts kept in speedrun_dir. speedrun_segment_attempts <map> lists one map.",
+              FCVAR_DONTRECORD)
+{
+    std::vector<attemptrecord_t> attempts;
+    demoRecordSession.GetAttempts(speedrun_dir.GetString(), DEMREC_ARGC() > 1 ? DEMREC_ARGV(1) : NULL, attempts);
+    if (attempts.empty())
     {
-        // Path to default directory
-        char path[MAX_PATH] = {};
-        Q_snprintf(path,
-                   sizeof(path) / sizeof(char),
-                   "%sspeedrun_democrecord_resume_info.txt",
-                   speedrun_dir.GetString());
-        FileHandle_t resumeFile = filesystem->Open(path, "r", "MOD");
-        if (resumeFile)
-        {
-            int file_len = filesystem->Size(resumeFile);
-            char* contents = new char[file_len + 1];
+        DemRecMsgInfo("No segment attempts kept, see speedrun_segment_keep.\n");
+        return;
+    }
 
-            filesystem->ReadLine(contents, file_len + 1, resumeFile);
-            contents[file_len] = '\0';
-            filesystem->Close(resumeFile);
-            Q_snprintf(sessionDir, SESSION_DIR_SIZE, "%s", contents);
+    for (size_t i = 0; i < attempts.size(); i++)
+    {
+        const attemptrecord_t& attempt = attempts[i];
+        const std::string demoName = attempt.slot == ATTEMPT_CANONICAL
+                                         ? std::string(attempt.mapName)
+                                         : CAttemptHistory::GetSlotDemoName(attempt.mapName, attempt.slot);
+        Msg("%-32s attempt %3u  %-40s ticks %7d  %6.1f s\n",
+            attempt.mapName,
+            attempt.attempt,
+            (demoName + ".dem").c_str(),
+            attempt.ticks,
+            (double)attempt.durationMs / 1000.0);
+    }
+}
 
-            // Init standard recording mode
-            recordMode = DEMREC_STANDARD;
-            lastMapName = "";
+CON_COMMAND_F(speedrun_segment_promote,
+              "speedrun_segment_promote <map> <attempt> makes a kept segment attempt <map>.dem again, the current "
+              "one takes its slot.",
+              FCVAR_DONTRECORD)
+{
+    if (DEMREC_ARGC() < 3)
+    {
+        DemRecMsgWarning("Usage: speedrun_segment_promote <map> <attempt>, see speedrun_segment_attempts.\n");
+        return;
+    }
 
+    const int attempt = Q_atoi(DEMREC_ARGV(2));
+    const AttemptPromoteResult result =
+        demoRecordSession.PromoteAttempt(speedrun_dir.GetString(), DEMREC_ARGV(1), attempt > 0 ? (uint32_t)attempt : 0);
+    if (result == PROMOTE_OK)
+    {
+        DemRecMsgSuccess("Attempt %d is %s.dem now.\n", attempt, DEMREC_ARGV(1));
+    }
+    else
+    {
+        DemRecMsgWarning("Could not promote attempt %d of %s: %s.\n",
+                         attempt,
+                         DEMREC_ARGV(1),
+                         AttemptPromoteResultToString(result));
+    }
+}
+
+CON_COMMAND_F(speedrun_resume, "resume a speedrun after a crash", FCVAR_DONTRECORD)
+{
+    if (demoRecordSession.GetMode() == DEMREC_DISABLED)
+    {
+        if (demoRecordSession.Resume(speedrun_dir.GetString()))
+        {
             DemRecMsgSuccess("Past speedrun successfully loaded, please load your last save now.\n");
-            delete[] contents;
+
+            // The clock of the crashed game is gone, timers keep their own total across the resume
+            liveSplitFeed.StartRun(demoRecordSession.GetMode());
+            StartTelemetry();
         }
         else
         {
-            DemRecMsgWarning("Error opening speedrun_democrecord_resume_info.txt, cannot resume speedrun!\n");
+            DemRecMsgWarning("Error opening " RESUME_INFO_FILE_NAME ", cannot resume speedrun!\n");
         }
     }
     else
@@ -516,14 +907,17 @@ CON_COMMAND_F(speedrun_resume, "resume a speedrun after a crash", FCVAR_DONTRECO
     }
 }
 
-// Bookmark buffer and other parts of this command inspired by SizzlingCalamari, https://github.com/SizzlingCalamari/
-// I wasnt too sure what a buffer was until now, pretty useful :D!!
+// Bookmark command inspired by SizzlingCalamari, https://github.com/SizzlingCalamari/
 // clientEngine->GetDemoRecordingTick() only in 5135 :/
 #ifdef SSDK2013
-CON_COMMAND_F(speedrun_bookmark, "create a bookmark for those ep0ch moments.", FCVAR_DONTRECORD)
+CON_COMMAND_F(speedrun_bookmark,
+              "create a bookmark for those ep0ch moments. speedrun_bookmark <tag> tags it for speedrun_bookmark_find.",
+              FCVAR_DONTRECORD)
 {
+    LATENCY_SCOPE(latencyStats, LATENCY_SPEEDRUN_BOOKMARK);
+
     // You have to be in speedrun and recording demo to do this!
-    if (recordMode == DEMREC_DISABLED || clientEngine->IsRecordingDemo() == false)
+    if (demoRecordSession.GetMode() == DEMREC_DISABLED || clientEngine->IsRecordingDemo() == false)
     {
         DemRecMsgWarning("Please start a speedrun and be ingame.\n");
     }
@@ -533,65 +927,294 @@ CON_COMMAND_F(speedrun_bookmark, "create a bookmark for those ep0ch moments.", F
         struct tm ltime;
         ConvertTimeToLocalTime(time(NULL), ltime);
 
-        // Clear buffer and place a return for ease of reading
-        char bookmarkBuffer[4096] = {};
-        Q_snprintf(bookmarkBuffer,
-                   sizeof(bookmarkBuffer) / sizeof(char),
-                   "[%04i/%02i/%02i %02i:%02i] demo: %s%s\r\n\t\t   tick: %d\r\n",
-                   ltime.tm_year,
-                   ltime.tm_mon,
-                   ltime.tm_mday,
-                   ltime.tm_hour,
-                   ltime.tm_min,
-                   sessionDir,
-                   currentDemoName,
-                   clientEngine->GetDemoRecordingTick());
-        int bookmarkStrLen = Q_strlen(bookmarkBuffer);
+        // One fixed size record appended to the session's bookmark file, let use know and play a sound
+        const char* tag = DEMREC_ARGC() > 1 ? DEMREC_ARGV(1) : "";
+        if (demoRecordSession.AddBookmark(speedrun_dir.GetString(), tag, ltime, clientEngine->GetDemoRecordingTick()))
+        {
+            DemRecMsgInfo("Bookmarked!\n");
+            soundEngine->EmitAmbientSound(BOOKMARK_SOUND_FILE, DEFAULT_SOUND_PACKET_VOLUME);
+        }
+    }
+}
+#endif
 
-        // Path to default directory
-        char path[MAX_PATH] = {};
-        Q_snprintf(path, sizeof(path) / sizeof(char), "%sspeedrun_democrecord_bookmarks.txt", speedrun_dir.GetString());
+//---------------------------------------------------------------------------------
+// Purpose: reads "session <name>", "map <name>" and "tag <tag>" pairs from the command arguments, false if there is
+// anything else
+//---------------------------------------------------------------------------------
+#if defined(SSDK2006)
+static bool ParseBookmarkQuery(BookmarkQuery_t& query)
+#else
+static bool ParseBookmarkQuery(const CCommand& args, BookmarkQuery_t& query)
+#endif
+{
+    for (int i = 1; i < DEMREC_ARGC(); i += 2)
+    {
+        if (i + 1 >= DEMREC_ARGC())
+            return false;
 
-        // Print to file, let use know it was successful and play a sound
-        filesystem->AsyncAppend(path, bookmarkBuffer, bookmarkStrLen, false);
-        filesystem->AsyncFinishAllWrites();
-        DemRecMsgInfo("Bookmarked!\n");
-        soundEngine->EmitAmbientSound(BOOKMARK_SOUND_FILE, DEFAULT_SOUND_PACKET_VOLUME);
+        const char* value = DEMREC_ARGV(i + 1);
+        if (FStrEq(DEMREC_ARGV(i), "session"))
+        {
+            query.session = value;
+        }
+        else if (FStrEq(DEMREC_ARGV(i), "map"))
+        {
+            query.mapName = value;
+        }
+        else if (FStrEq(DEMREC_ARGV(i), "tag"))
+        {
+            query.tag = value;
+        }
+        else
+        {
+            return false;
+        }
     }
+    return true;
 }
+
+#if defined(SSDK2006)
+#define DEMREC_PARSE_BOOKMARK_QUERY(query) ParseBookmarkQuery(query)
+#else
+#define DEMREC_PARSE_BOOKMARK_QUERY(query) ParseBookmarkQuery(args, query)
 #endif
 
+static void PrintBookmarks(const CBookmarkStore& bookmarks, const std::vector<uint32_t>& ids)
+{
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        const bookmarkrecord_t& bookmark = bookmarks.Get(ids[i]);
+        Msg("%04u/%02u/%02u %02u:%02u:%02u  %-20s %-32s tick %7d  %s\n",
+            (unsigned)bookmark.year,
+            (unsigned)bookmark.month,
+            (unsigned)bookmark.day,
+            (unsigned)bookmark.hour,
+            (unsigned)bookmark.minute,
+            (unsigned)bookmark.second,
+            bookmark.session,
+            bookmark.demoName,
+            bookmark.tick,
+            bookmark.tag);
+    }
+}
+
+CON_COMMAND_F(speedrun_bookmark_list,
+              "lists the bookmarks of the current run, or of the last one with bookmarks. speedrun_bookmark_list "
+              "<session> lists that session's.",
+              FCVAR_DONTRECORD)
+{
+    // Bookmarks still in the write queue are on disk before the first load reads them
+    fileWriter.Flush();
+    const CBookmarkStore& bookmarks = demoRecordSession.GetBookmarks(speedrun_dir.GetString());
+
+    const std::string current = demoRecordSession.GetBookmarkSession();
+    BookmarkQuery_t query;
+    query.session = DEMREC_ARGC() > 1 ? DEMREC_ARGV(1)
+                    : current.empty() ? bookmarks.GetLastSession()
+                                      : current.c_str();
+
+    std::vector<uint32_t> ids;
+    if (query.session)
+    {
+        bookmarks.Find(query, ids);
+    }
+    if (ids.empty())
+    {
+        DemRecMsgInfo("No bookmarks in %s.\n", query.session ? query.session : "speedrun_dir");
+        return;
+    }
+    PrintBookmarks(bookmarks, ids);
+}
+
+CON_COMMAND_F(speedrun_bookmark_find,
+              "speedrun_bookmark_find [session <name>] [map <name>] [tag <tag>] lists the bookmarks of every session "
+              "that match all of them.",
+              FCVAR_DONTRECORD)
+{
+    BookmarkQuery_t query;
+    if (!DEMREC_PARSE_BOOKMARK_QUERY(query))
+    {
+        DemRecMsgWarning("Usage: speedrun_bookmark_find [session <name>] [map <name>] [tag <tag>]\n");
+        return;
+    }
+
+    fileWriter.Flush();
+    const CBookmarkStore& bookmarks = demoRecordSession.GetBookmarks(speedrun_dir.GetString());
+
+    std::vector<uint32_t> ids;
+    bookmarks.Find(query, ids);
+    if (ids.empty())
+    {
+        DemRecMsgInfo("No matching bookmarks.\n");
+        return;
+    }
+    PrintBookmarks(bookmarks, ids);
+    DemRecMsgInfo("%u of %u bookmarks.\n", (unsigned)ids.size(), (unsigned)bookmarks.Size());
+}
+
+CON_COMMAND_F(speedrun_bookmark_export,
+              "writes the bookmarks speedrun_bookmark_find would list to " BOOKMARK_EXPORT_FILE_NAME
+              " in speedrun_dir, in the text format of speedrun_democrecord_bookmarks.txt.",
+              FCVAR_DONTRECORD)
+{
+    BookmarkQuery_t query;
+    if (!DEMREC_PARSE_BOOKMARK_QUERY(query))
+    {
+        DemRecMsgWarning("Usage: speedrun_bookmark_export [session <name>] [map <name>] [tag <tag>]\n");
+        return;
+    }
+
+    fileWriter.Flush();
+    const CBookmarkStore& bookmarks = demoRecordSession.GetBookmarks(speedrun_dir.GetString());
+
+    std::vector<uint32_t> ids;
+    bookmarks.Find(query, ids);
+    std::string text;
+    bookmarks.FormatText(ids, text);
+
+    // Path to default directory
+    char path[MAX_PATH] = {};
+    Q_snprintf(path, sizeof(path) / sizeof(char), "%s" BOOKMARK_EXPORT_FILE_NAME, speedrun_dir.GetString());
+
+    if (fileWriter.Write(path, text.data(), text.size()))
+    {
+        DemRecMsgInfo("%u bookmarks written to %s\n", (unsigned)ids.size(), path);
+    }
+    else
+    {
+        DemRecMsgWarning("Write queue is full, bookmarks were not exported!\n");
+    }
+}
+
 CON_COMMAND_F(speedrun_stop, "stops run", FCVAR_DONTRECORD)
 {
-    if (recordMode == DEMREC_DISABLED)
+    if (demoRecordSession.GetMode() == DEMREC_DISABLED)
     {
         DemRecMsgWarning("No speedrun in progress.\n");
     }
     else
     {
         DemRecMsgSuccess("Speedrun will STOP now...\n");
+        demoRecordSession.Stop(speedrun_dir.GetString());
+        liveSplitFeed.StopRun();
+        StopTelemetry();
+
+        // Resume info removal, bookmarks etc. are on disk once the run is over
+        LATENCY_SCOPE(latencyStats, LATENCY_IO_FLUSH);
+        fileWriter.Flush();
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: the .vdm chain of the last run, or of session (a folder in speedrun_dir) if it isn't NULL
+//---------------------------------------------------------------------------------
+static PlaylistResult_t WriteSessionPlaylist(const char* session, std::vector<std::string>* demoPaths)
+{
+    PlaylistOptions_t options;
+    options.playbackRate = speedrun_playlist_rate.GetFloat();
+    options.finalCommands = speedrun_playlist_end.GetString();
 
-        lastMapName = currentMapName;
+    char sessionDir[MAX_PATH] = {};
+    if (session)
+    {
+        Q_snprintf(sessionDir, sizeof(sessionDir) / sizeof(char), "%s%s", speedrun_dir.GetString(), session);
+        Q_FixSlashes(sessionDir);
+    }
 
-        if (clientEngine->IsRecordingDemo() == true)
+    const PlaylistResult_t result = demoRecordSession.WritePlaylist(options, sessionDir, demoPaths);
+    if (result.written == 0)
+    {
+        DemRecMsgWarning("No finished demos found, run this after speedrun_stop or name a session dir.\n");
+    }
+    if (result.skipped > 0)
+    {
+        DemRecMsgWarning("%u demos left out, their end tick is unknown (still recording or crashed).\n",
+                         result.skipped);
+    }
+    return result;
+}
+
+CON_COMMAND_F(speedrun_playlist,
+              "writes a .vdm next to every demo of the last speedrun that plays the next one at its end. "
+              "speedrun_playlist <session dir> does the same for an older session.",
+              FCVAR_DONTRECORD)
+{
+    const PlaylistResult_t result = WriteSessionPlaylist(DEMREC_ARGC() > 1 ? DEMREC_ARGV(1) : NULL, NULL);
+    if (result.written > 0)
+    {
+        DemRecMsgSuccess("Wrote %u .vdm files, play the first demo to watch the run.\n", result.written);
+    }
+}
+
+CON_COMMAND_F(speedrun_playback,
+              "writes the playlist of the last speedrun (or of speedrun_playback <session dir>) and plays it, reading "
+              "the next demos ahead. speedrun_stats shows the gaps between demos and the prefetch hit rate.",
+              FCVAR_DONTRECORD)
+{
+    if (demoRecordSession.GetMode() != DEMREC_DISABLED)
+    {
+        DemRecMsgWarning("Please stop all other speedruns with speedrun_stop.\n");
+        return;
+    }
+
+    std::vector<std::string> demoPaths;
+    WriteSessionPlaylist(DEMREC_ARGC() > 1 ? DEMREC_ARGV(1) : NULL, &demoPaths);
+    if (demoPaths.empty())
+        return;
+
+    // The chain is known from here on, every ClientConnect during playback is the next demo of it
+    const int depth = speedrun_playback_prefetch.GetInt() > 0 ? speedrun_playback_prefetch.GetInt() : 0;
+    demoPrefetcher.SetPlaylist(demoPaths, (uint32_t)depth);
+    DemRecMsgSuccess("Playing %u demos, reading %d ahead.\n", (unsigned)demoPaths.size(), depth);
+
+    const std::string& first = demoPaths[0];
+    char command[CMD_SIZE] = {};
+    Q_snprintf(command, sizeof(command) / sizeof(char), "playdemo %s\n", first.substr(0, first.size() - 4).c_str());
+    clientEngine->ClientCmd(command);
+}
+
+CON_COMMAND(speedrun_stats,
+            "prints callback latencies. speedrun_stats dump writes them to speedrun_dir, speedrun_stats reset clears "
+            "them.")
+{
+    const char* action = DEMREC_ARGC() > 1 ? DEMREC_ARGV(1) : "";
+
+    if (FStrEq(action, "reset"))
+    {
+        latencyStats.Reset();
+        DemRecMsgInfo("Stats reset.\n");
+    }
+    else if (FStrEq(action, "dump"))
+    {
+        std::string writer;
+        fileWriter.FormatJson(writer);
+
+        std::string json;
+        latencyStats.FormatJson(json, writer.c_str());
+
+        // Path to default directory
+        char path[MAX_PATH] = {};
+        Q_snprintf(path, sizeof(path) / sizeof(char), "%sspeedrun_democrecord_stats.json", speedrun_dir.GetString());
+
+        if (fileWriter.Write(path, json.c_str(), json.size()))
         {
-            clientEngine->ClientCmd("stop");
+            DemRecMsgInfo("Stats written to %s\n", path);
         }
-
-        if (recordMode == DEMREC_STANDARD)
+        else
         {
-            // Path to default directory
-            char path[MAX_PATH] = {};
-            Q_snprintf(path,
-                       sizeof(path) / sizeof(char),
-                       "%sspeedrun_democrecord_resume_info.txt",
-                       speedrun_dir.GetString());
-
-            // Delete resume file
-            filesystem->RemoveFile(path, "MOD");
+            DemRecMsgWarning("Write queue is full, stats were not written!\n");
         }
-
-        recordMode = DEMREC_DISABLED;
+    }
+    else
+    {
+        std::string table;
+        latencyStats.FormatTable(table);
+        fileWriter.FormatTable(table);
+        demoIndexer.FormatTable(table);
+        demoPrefetcher.FormatTable(table);
+        telemetrySampler.FormatTable(table);
+        DemRecMsgInfo("%s", table.c_str());
     }
 }
 
@@ -17,6 +17,16 @@
 #include "utlbuffer.h"
 
 #include "cdll_int.h"
+#include "game/server/iplayerinfo.h"
+
+#include "async_file_writer.h"
+#include "demo_indexer.h"
+#include "demo_prefetcher.h"
+#include "demorecord_session.h"
+#include "latency_stats.h"
+#include "live_split_feed.h"
+#include "map_catalog.h"
+#include "telemetry_sampler.h"
 
 // Utility Macros
 #if defined(SSDK2007) || defined(SSDK2013)
@@ -31,10 +41,27 @@
 #define DemRecMsgInfo(msg, ...) (Msg(msg, __VA_ARGS__))
 #endif
 
-// Common command size
-#define CMD_SIZE 256
-#define SESSION_DIR_SIZE 256
-#define DEMO_NAME_SIZE 256
+// Command arguments, CCommand only exists from the 2007 SDK on
+#if defined(SSDK2006)
+#define DEMREC_ARGC() (engine->Cmd_Argc())
+#define DEMREC_ARGV(i) (engine->Cmd_Argv(i))
+#else
+#define DEMREC_ARGC() (args.ArgC())
+#define DEMREC_ARGV(i) (args.Arg(i))
+#endif
+
+// ConVar change callbacks and commands with completion, both changed signature with the 2007 SDK
+#if defined(SSDK2006)
+#define DEMREC_CONVAR_CALLBACK(name) void name(ConVar*, char const*)
+#define DEMREC_COMMAND_F_COMPLETION(name, description, flags, completion)                                          \
+    static void name();                                                                                            \
+    static ConCommand name##_command(#name, name, description, flags, completion);                                 \
+    static void name()
+#else
+#define DEMREC_CONVAR_CALLBACK(name) void name(IConVar*, const char*, float)
+#define DEMREC_COMMAND_F_COMPLETION(name, description, flags, completion)                                          \
+    CON_COMMAND_F_COMPLETION(name, description, flags, completion)
+#endif
 
 #define DEMO_LIST_SIZE 8
 
@@ -55,7 +82,7 @@ class CSpeedrunDemoRecord : public IServerPluginCallbacks
     virtual const char* GetPluginDescription(void);
     virtual void LevelInit(char const* pMapName);
     virtual void ServerActivate(edict_t* pEdictList, int edictCount, int clientMax);
-    virtual void GameFrame(bool simulating){};
+    virtual void GameFrame(bool simulating);
     virtual void LevelShutdown(void);
     virtual void ClientActive(edict_t* pEntity);
     virtual void ClientDisconnect(edict_t* pEntity);
@@ -105,16 +132,41 @@ class CSpeedrunDemoRecord : public IServerPluginCallbacks
 #endif
 };
 
-enum RecordingMode
+//---------------------------------------------------------------------------------
+// Purpose: runs the recording state machine against the real engine and filesystem
+//---------------------------------------------------------------------------------
+class CEngineDemoRecordHost : public IDemoRecordHost
 {
-    DEMREC_DISABLED,
-
-    // standard speedrun (deaths/reloads/etc)
-    DEMREC_STANDARD,
+    public:
+    virtual bool IsPlayingDemo();
+    virtual bool IsRecordingDemo();
+    virtual void ClientCmd(const char* command);
+    virtual int GetServerTick();
+    virtual int GetDemoTick();
+    virtual bool IsDirectory(const char* path);
+    virtual void CreateDirHierarchy(const char* path);
+    virtual void FindFiles(const char* wildcard, std::vector<std::string>& fileNames);
+    virtual bool ReadFile(const char* path, std::string& contents);
+    virtual void WriteFile(const char* path, const void* data, size_t size, bool append, bool sync);
+    virtual void RemoveFile(const char* path);
+    virtual bool RenameFile(const char* from, const char* to);
+    virtual void QueueRenameFile(const char* from, const char* to);
+    virtual uint64_t GetFileJobTicket();
+    virtual bool IsFileJobDone(uint64_t ticket);
+    virtual void OnRecordingStarted(const char* demoName, int ticksAfterSpawn);
+    virtual void OnDemoStopped(const char* demoPath);
+    virtual void OnSessionStopped(const char* sessionDir);
+};
 
-    // segmenting mode
-    // mainly one map, on map level changes do not stop recording
-    DEMREC_SEGMENTED
+//---------------------------------------------------------------------------------
+// Purpose: lists maps, chapter configs and saves for the map catalog, across every game search path
+//---------------------------------------------------------------------------------
+class CEngineMapCatalogSource : public IMapCatalogSource
+{
+    public:
+    virtual void FindFiles(const char* wildcard, std::vector<std::string>& fileNames);
+    virtual bool ReadFile(const char* path, std::string& contents);
+    virtual int64_t GetFileTime(const char* path);
 };
 
 // Interfaces from the engine
@@ -126,17 +178,40 @@ IEngineSound* soundEngine = NULL;
 //Filesystem for I/O, use this instead of fopen and whatnot
 IFileSystem* filesystem = NULL;
 
+// Server globals, for the current tick
+IPlayerInfoManager* playerinfomanager = NULL;
+CGlobalVars* gpGlobals = NULL;
+
 // GlobalVars
-RecordingMode recordMode = DEMREC_DISABLED;
-int retries = 0;
-std::string lastMapName;
-std::string currentMapName;
-char sessionDir[SESSION_DIR_SIZE] = {};
-char currentDemoName[DEMO_NAME_SIZE] = {};
+// Time spent in callbacks and filesystem calls, see speedrun_stats
+CLatencyStats latencyStats;
+
+// Every file the plugin writes goes through here, see speedrun_stop/Unload for the flushes
+CAsyncFileWriter fileWriter;
+
+// Writes a .dmi next to every demo once the engine finished it
+CDemoIndexer demoIndexer;
+
+// Reads the next demos of speedrun_playback into the OS cache while one plays
+CDemoPrefetcher demoPrefetcher;
+
+// Run state for external timers, in shared memory
+CLiveSplitFeed liveSplitFeed;
+
+// Per frame samples of a run while speedrun_telemetry is on
+CTelemetrySampler telemetrySampler;
+
+// Modes, demo naming, retries and resume
+CEngineDemoRecordHost engineHost;
+CDemoRecordSession demoRecordSession(engineHost, latencyStats);
+
+// Maps, chapters and saves speedrun_map and speedrun_save are checked against
+CEngineMapCatalogSource mapCatalogSource;
+CMapCatalog mapCatalog;
 
 // Function protos
-void findFirstMap();
-void createDirIfNonExistant(const char* modRelativePath);
+void RefreshMapCatalog();
+void StartTelemetry();
+void StopTelemetry();
 void GetDateAndTime(struct tm& ltime);
 void ConvertTimeToLocalTime(const time_t& t, struct tm& ltime);
-int demoExists(const char* curMap);
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+//---------------------------------------------------------------------------------
+// Purpose: bounded lock-free single producer, single consumer ring of trivially copyable values. Each side owns one
+// position and only reads the other's, a push is a copy and a release store. The producer keeps the last consumer
+// position it saw and only loads the real one when that says the ring is full, so a push normally touches no cache
+// line the consumer writes. Push fails instead of waiting when the ring is full.
+//
+// Capacity is rounded up to a power of two, all storage is allocated by the constructor.
+//---------------------------------------------------------------------------------
+template <typename T>
+class CSpscRing
+{
+    public:
+    explicit CSpscRing(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+
+        m_Mask = size - 1;
+        m_pItems = new T[size];
+        m_Head.store(0, std::memory_order_relaxed);
+        m_CachedTail = 0;
+        m_Tail.store(0, std::memory_order_relaxed);
+    }
+
+    ~CSpscRing()
+    {
+        delete[] m_pItems;
+    }
+
+    // Producer thread only
+    bool Push(const T& value)
+    {
+        const size_t head = m_Head.load(std::memory_order_relaxed);
+        if (head - m_CachedTail > m_Mask)
+        {
+            m_CachedTail = m_Tail.load(std::memory_order_acquire);
+            if (head - m_CachedTail > m_Mask)
+                return false;
+        }
+
+        m_pItems[head & m_Mask] = value;
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only, moves up to maxCount values to out and returns how many
+    size_t PopBatch(T* out, size_t maxCount)
+    {
+        const size_t tail = m_Tail.load(std::memory_order_relaxed);
+        const size_t available = m_Head.load(std::memory_order_acquire) - tail;
+        const size_t count = available < maxCount ? available : maxCount;
+        for (size_t i = 0; i < count; i++)
+        {
+            out[i] = m_pItems[(tail + i) & m_Mask];
+        }
+        m_Tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Values waiting, exact from either side while the other one is idle
+    size_t GetSize() const
+    {
+        return m_Head.load(std::memory_order_acquire) - m_Tail.load(std::memory_order_acquire);
+    }
+
+    size_t GetCapacity() const
+    {
+        return m_Mask + 1;
+    }
+
+    private:
+    CSpscRing(const CSpscRing&);
+    CSpscRing& operator=(const CSpscRing&);
+
+    T* m_pItems;
+    size_t m_Mask;
+
+    // The producer's and the consumer's positions on separate cache lines, padding instead of alignas since C++14
+    // new doesn't honor over-alignment
+    char m_Pad0[64];
+    std::atomic<size_t> m_Head;
+    size_t m_CachedTail;
+    char m_Pad1[64];
+    std::atomic<size_t> m_Tail;
+    char m_Pad2[64];
+};
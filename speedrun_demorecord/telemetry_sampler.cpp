@@ -0,0 +1,199 @@
+#include "telemetry_sampler.h"
+
+#include <string.h>
+#include <time.h>
+#include <chrono>
+
+#include "file_list.h"
+
+// Samples written per fwrite
+#define TELEMETRY_BATCH_SIZE 1024
+
+//---------------------------------------------------------------------------------
+// Purpose: constructor/destructor
+//---------------------------------------------------------------------------------
+CTelemetrySampler::CTelemetrySampler(size_t ringSize)
+    : m_Ring(ringSize),
+      m_StartTime(0),
+      m_pFile(NULL),
+      m_Batch(TELEMETRY_BATCH_SIZE),
+      m_bStop(false),
+      m_Sampled(0),
+      m_Dropped(0),
+      m_Written(0),
+      m_Failed(0),
+      m_MaxDepth(0)
+{
+    memset(&m_Header, 0, sizeof(m_Header));
+}
+
+CTelemetrySampler::~CTelemetrySampler()
+{
+    Stop();
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: thread control
+//---------------------------------------------------------------------------------
+bool CTelemetrySampler::Start(const char* path)
+{
+    if (IsRunning())
+        return false;
+
+    m_Path = path;
+    const size_t separator = m_Path.find_last_of("/\\");
+    if (separator != std::string::npos && separator > 0)
+    {
+        MakeDirectory(m_Path.substr(0, separator));
+    }
+
+    m_pFile = fopen(path, "wb");
+    if (!m_pFile)
+        return false;
+
+    memset(&m_Header, 0, sizeof(m_Header));
+    m_Header.magic = TELEMETRY_MAGIC;
+    m_Header.version = TELEMETRY_VERSION;
+    m_Header.sampleSize = (uint32_t)sizeof(telemetrysample_t);
+    m_Header.startTime = (int64_t)time(NULL);
+    if (fwrite(&m_Header, sizeof(m_Header), 1, m_pFile) != 1)
+    {
+        fclose(m_pFile);
+        m_pFile = NULL;
+        return false;
+    }
+    fflush(m_pFile);
+
+    m_Sampled = 0;
+    m_Dropped = 0;
+    m_Written = 0;
+    m_Failed = 0;
+    m_MaxDepth = 0;
+    m_StartTime = LatencyNow();
+
+    m_bStop = false;
+    m_Thread = std::thread(&CTelemetrySampler::ThreadMain, this);
+    return true;
+}
+
+void CTelemetrySampler::Stop()
+{
+    if (!IsRunning())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStop = true;
+        m_Wake.notify_one();
+    }
+    m_Thread.join();
+
+    // The thread drained everything pushed before the stop, nothing can be pushed anymore
+    m_Header.sampleCount = m_Written.load();
+    m_Header.dropped = m_Dropped.load() + m_Failed.load();
+    if (fseek(m_pFile, 0, SEEK_SET) == 0)
+    {
+        fwrite(&m_Header, sizeof(m_Header), 1, m_pFile);
+    }
+    fclose(m_pFile);
+    m_pFile = NULL;
+}
+
+void CTelemetrySampler::ThreadMain()
+{
+    for (;;)
+    {
+        while (DrainBatch())
+        {
+        }
+        fflush(m_pFile);
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        if (m_bStop)
+            break;
+        m_Wake.wait_for(lock, std::chrono::milliseconds(TELEMETRY_DRAIN_MS));
+    }
+
+    // Anything pushed between the last drain and the stop
+    while (DrainBatch())
+    {
+    }
+}
+
+bool CTelemetrySampler::DrainBatch()
+{
+    const uint32_t depth = (uint32_t)m_Ring.GetSize();
+    if (depth > m_MaxDepth.load(std::memory_order_relaxed))
+    {
+        m_MaxDepth.store(depth, std::memory_order_relaxed);
+    }
+
+    const size_t count = m_Ring.PopBatch(m_Batch.data(), m_Batch.size());
+    if (count == 0)
+        return false;
+
+    if (fwrite(m_Batch.data(), sizeof(telemetrysample_t), count, m_pFile) == count)
+    {
+        m_Written += count;
+    }
+    else
+    {
+        m_Failed += count;
+    }
+    return count == m_Batch.size();
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: stats
+//---------------------------------------------------------------------------------
+void CTelemetrySampler::GetStats(TelemetryStats_t& stats) const
+{
+    stats.sampled = m_Sampled.load();
+    stats.dropped = m_Dropped.load();
+    stats.written = m_Written.load();
+    stats.failed = m_Failed.load();
+    stats.maxDepth = m_MaxDepth.load();
+    stats.capacity = (uint32_t)m_Ring.GetCapacity();
+}
+
+void CTelemetrySampler::FormatTable(std::string& out) const
+{
+    TelemetryStats_t stats;
+    GetStats(stats);
+
+    char line[192];
+    snprintf(line,
+             sizeof(line),
+             "telemetry: %s, %llu sampled, %llu written, %llu dropped, %llu failed, max depth %u/%u\n",
+             IsRunning() ? "on" : "off",
+             (unsigned long long)stats.sampled,
+             (unsigned long long)stats.written,
+             (unsigned long long)stats.dropped,
+             (unsigned long long)stats.failed,
+             stats.maxDepth,
+             stats.capacity);
+    out += line;
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: reading
+//---------------------------------------------------------------------------------
+bool ReadTelemetryFile(const char* path, telemetryheader_t& header, std::vector<telemetrysample_t>& samples)
+{
+    std::string contents;
+    if (!ReadWholeFile(path, contents) || contents.size() < sizeof(header))
+        return false;
+
+    memcpy(&header, contents.data(), sizeof(header));
+    if (header.magic != TELEMETRY_MAGIC || header.version != TELEMETRY_VERSION ||
+        header.sampleSize != sizeof(telemetrysample_t))
+        return false;
+
+    const size_t count = (contents.size() - sizeof(header)) / sizeof(telemetrysample_t);
+    samples.resize(count);
+    if (count > 0)
+    {
+        memcpy(samples.data(), contents.data() + sizeof(header), count * sizeof(telemetrysample_t));
+    }
+    return true;
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "latency_stats.h"
+#include "spsc_ring.h"
+
+// Telemetry (.telemetry): a few cheap values of every server frame of a run, for finding hitches and frames where
+// recording wasn't on. Layout: header, then one sample per frame until the file ends.
+
+#define TELEMETRY_EXTENSION ".telemetry"
+
+// "SRT1"
+#define TELEMETRY_MAGIC 0x31545253u
+#define TELEMETRY_VERSION 1
+
+// Samples the ring holds, two minutes at 66 ticks per second
+#define TELEMETRY_RING_SIZE 8192
+
+// How long the drain thread sleeps when the ring is empty
+#define TELEMETRY_DRAIN_MS 50
+
+enum TelemetryFlags
+{
+    // GameFrame's simulating, false while paused or in a menu
+    TELEMETRY_SIMULATING = (1 << 0),
+    TELEMETRY_RECORDING = (1 << 1),
+    TELEMETRY_PLAYING = (1 << 2),
+};
+
+#pragma pack(push, 1)
+struct telemetryheader_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sampleSize;
+    uint32_t reserved;
+
+    // Unix time of Start, sample times count from there
+    int64_t startTime;
+
+    // Filled in by Stop, both zero if the game crashed, the samples then simply run to the end of the file
+    uint64_t sampleCount;
+    uint64_t dropped;
+};
+
+struct telemetrysample_t
+{
+    // Nanoseconds since Start
+    uint64_t time;
+
+    int32_t hostTick;
+
+    // -1 unless recording and the engine tells
+    int32_t demoTick;
+
+    // Simulated time of the frame (gpGlobals->frametime)
+    float frameTime;
+
+    uint8_t flags;
+    uint8_t reserved[3];
+};
+#pragma pack(pop)
+
+struct TelemetryStats_t
+{
+    // Pushed into the ring, and dropped because it was full
+    uint64_t sampled;
+    uint64_t dropped;
+
+    uint64_t written;
+
+    // fwrite failed, the samples are lost
+    uint64_t failed;
+
+    // Samples waiting at most, of the ring's capacity
+    uint32_t maxDepth;
+    uint32_t capacity;
+};
+
+//---------------------------------------------------------------------------------
+// Purpose: per frame samples without touching the disk from the game thread. Sample copies into a ring that is
+// allocated once, a thread drains it to the file in batches. Sample never locks, allocates or waits, if the drain
+// thread falls behind far enough to fill the ring the sample is dropped and counted.
+//
+// Start and Stop open and finish one file, for speedrun_start and speedrun_stop.
+//---------------------------------------------------------------------------------
+class CTelemetrySampler
+{
+    public:
+    explicit CTelemetrySampler(size_t ringSize = TELEMETRY_RING_SIZE);
+    ~CTelemetrySampler();
+
+    // Creates path (and its parent directories) and starts draining into it, false if it can't be created
+    bool Start(const char* path);
+
+    // Writes what is left in the ring, fills in the header's counts and joins the thread
+    void Stop();
+
+    bool IsRunning() const
+    {
+        return m_Thread.joinable();
+    }
+
+    // Game thread only, and only while running
+    void Sample(int hostTick, int demoTick, float frameTime, uint8_t flags)
+    {
+        telemetrysample_t sample;
+        sample.time = LatencyNow() - m_StartTime;
+        sample.hostTick = hostTick;
+        sample.demoTick = demoTick;
+        sample.frameTime = frameTime;
+        sample.flags = flags;
+        sample.reserved[0] = sample.reserved[1] = sample.reserved[2] = 0;
+
+        // Only this thread writes the counters, no read-modify-write needed
+        if (m_Ring.Push(sample))
+        {
+            m_Sampled.store(m_Sampled.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        else
+        {
+            m_Dropped.store(m_Dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    const std::string& GetPath() const
+    {
+        return m_Path;
+    }
+
+    // Of the current file, or of the last one once stopped
+    void GetStats(TelemetryStats_t& stats) const;
+    void FormatTable(std::string& out) const;
+
+    private:
+    CTelemetrySampler(const CTelemetrySampler&);
+    CTelemetrySampler& operator=(const CTelemetrySampler&);
+
+    void ThreadMain();
+
+    // Drain thread only, false once the ring was empty
+    bool DrainBatch();
+
+    CSpscRing<telemetrysample_t> m_Ring;
+    uint64_t m_StartTime;
+
+    std::string m_Path;
+    FILE* m_pFile;
+    telemetryheader_t m_Header;
+    std::vector<telemetrysample_t> m_Batch;
+    std::thread m_Thread;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    bool m_bStop;
+
+    std::atomic<uint64_t> m_Sampled;
+    std::atomic<uint64_t> m_Dropped;
+    std::atomic<uint64_t> m_Written;
+    std::atomic<uint64_t> m_Failed;
+    std::atomic<uint32_t> m_MaxDepth;
+};
+
+// Header and samples of a telemetry file, false if it isn't one. A file that was never stopped reads fine, a
+// trailing partial sample is ignored.
+bool ReadTelemetryFile(const char* path, telemetryheader_t& header, std::vector<telemetrysample_t>& samples);
@@ -0,0 +1,188 @@
+#include "usercmd_decoder.h"
+
+#include <string.h>
+
+#include "demo_file.h"
+
+// A present field's value and its bit in fields, without a branch on the presence bit
+static inline uint32_t ReadField(CBitReader& reader, unsigned bits, UserCmdField field, uint32_t& fields)
+{
+    bool bPresent;
+    const uint32_t value = reader.ReadOptional(bits, bPresent);
+    fields |= (uint32_t)bPresent << field;
+    return value;
+}
+
+static inline float BitsToFloat(uint32_t bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+bool DecodeUserCmd(const uint8_t* data, size_t size, UserCmd_t& cmd)
+{
+    CBitReader reader(data, size);
+    uint32_t fields = 0;
+
+    // The counters are only written if they aren't the null command's + 1
+    const uint32_t commandNumber = ReadField(reader, 32, USERCMD_COMMAND_NUMBER, fields);
+    const uint32_t tickCount = ReadField(reader, 32, USERCMD_TICK_COUNT, fields);
+    cmd.commandNumber = (int32_t)(commandNumber | ((~fields >> USERCMD_COMMAND_NUMBER) & 1));
+    cmd.tickCount = (int32_t)(tickCount | ((~fields >> USERCMD_TICK_COUNT) & 1));
+
+    cmd.viewAngles[0] = BitsToFloat(ReadField(reader, 32, USERCMD_VIEWANGLE_PITCH, fields));
+    cmd.viewAngles[1] = BitsToFloat(ReadField(reader, 32, USERCMD_VIEWANGLE_YAW, fields));
+    cmd.viewAngles[2] = BitsToFloat(ReadField(reader, 32, USERCMD_VIEWANGLE_ROLL, fields));
+    cmd.forwardMove = BitsToFloat(ReadField(reader, 32, USERCMD_FORWARDMOVE, fields));
+    cmd.sideMove = BitsToFloat(ReadField(reader, 32, USERCMD_SIDEMOVE, fields));
+    cmd.upMove = BitsToFloat(ReadField(reader, 32, USERCMD_UPMOVE, fields));
+    cmd.buttons = ReadField(reader, 32, USERCMD_BUTTONS, fields);
+    cmd.impulse = (uint8_t)ReadField(reader, 8, USERCMD_IMPULSE, fields);
+
+    // The subtype is only there if the weapon is, weapon switches are rare enough for the branch
+    cmd.weaponSelect = (uint16_t)ReadField(reader, USERCMD_WEAPON_BITS, USERCMD_WEAPONSELECT, fields);
+    cmd.weaponSubtype = 0;
+    if (fields & (1u << USERCMD_WEAPONSELECT))
+    {
+        cmd.weaponSubtype = (uint8_t)ReadField(reader, USERCMD_WEAPON_SUBTYPE_BITS, USERCMD_WEAPONSUBTYPE, fields);
+    }
+
+    cmd.mouseDx = (int16_t)ReadField(reader, 16, USERCMD_MOUSEDX, fields);
+    cmd.mouseDy = (int16_t)ReadField(reader, 16, USERCMD_MOUSEDY, fields);
+
+    cmd.fields = (uint16_t)fields;
+    return !reader.IsOverflowed();
+}
+
+static void WriteField(CBitWriter& writer, bool bPresent, uint32_t value, unsigned bits)
+{
+    writer.WriteBit(bPresent);
+    if (bPresent)
+    {
+        writer.WriteBits(value, bits);
+    }
+}
+
+static void WriteFloatField(CBitWriter& writer, float value)
+{
+    writer.WriteBit(value != 0.0f);
+    if (value != 0.0f)
+    {
+        writer.WriteFloat(value);
+    }
+}
+
+void EncodeUserCmd(const UserCmd_t& cmd, CBitWriter& writer)
+{
+    WriteField(writer, cmd.commandNumber != 1, (uint32_t)cmd.commandNumber, 32);
+    WriteField(writer, cmd.tickCount != 1, (uint32_t)cmd.tickCount, 32);
+    WriteFloatField(writer, cmd.viewAngles[0]);
+    WriteFloatField(writer, cmd.viewAngles[1]);
+    WriteFloatField(writer, cmd.viewAngles[2]);
+    WriteFloatField(writer, cmd.forwardMove);
+    WriteFloatField(writer, cmd.sideMove);
+    WriteFloatField(writer, cmd.upMove);
+    WriteField(writer, cmd.buttons != 0, cmd.buttons, 32);
+    WriteField(writer, cmd.impulse != 0, cmd.impulse, 8);
+    WriteField(writer, cmd.weaponSelect != 0, cmd.weaponSelect, USERCMD_WEAPON_BITS);
+    if (cmd.weaponSelect != 0)
+    {
+        WriteField(writer, cmd.weaponSubtype != 0, cmd.weaponSubtype, USERCMD_WEAPON_SUBTYPE_BITS);
+    }
+    WriteField(writer, cmd.mouseDx != 0, (uint16_t)cmd.mouseDx, 16);
+    WriteField(writer, cmd.mouseDy != 0, (uint16_t)cmd.mouseDy, 16);
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: columns
+//---------------------------------------------------------------------------------
+void UserCmdTable_t::Clear()
+{
+    demoTick.clear();
+    sequence.clear();
+    commandNumber.clear();
+    tickCount.clear();
+    pitch.clear();
+    yaw.clear();
+    roll.clear();
+    forwardMove.clear();
+    sideMove.clear();
+    upMove.clear();
+    buttons.clear();
+    impulse.clear();
+    weaponSelect.clear();
+    weaponSubtype.clear();
+    mouseDx.clear();
+    mouseDy.clear();
+    fields.clear();
+    truncated = 0;
+}
+
+void UserCmdTable_t::Reserve(size_t rows)
+{
+    demoTick.reserve(rows);
+    sequence.reserve(rows);
+    commandNumber.reserve(rows);
+    tickCount.reserve(rows);
+    pitch.reserve(rows);
+    yaw.reserve(rows);
+    roll.reserve(rows);
+    forwardMove.reserve(rows);
+    sideMove.reserve(rows);
+    upMove.reserve(rows);
+    buttons.reserve(rows);
+    impulse.reserve(rows);
+    weaponSelect.reserve(rows);
+    weaponSubtype.reserve(rows);
+    mouseDx.reserve(rows);
+    mouseDy.reserve(rows);
+    fields.reserve(rows);
+}
+
+void UserCmdTable_t::Append(int32_t tick, int32_t seq, const UserCmd_t& cmd)
+{
+    demoTick.push_back(tick);
+    sequence.push_back(seq);
+    commandNumber.push_back(cmd.commandNumber);
+    tickCount.push_back(cmd.tickCount);
+    pitch.push_back(cmd.viewAngles[0]);
+    yaw.push_back(cmd.viewAngles[1]);
+    roll.push_back(cmd.viewAngles[2]);
+    forwardMove.push_back(cmd.forwardMove);
+    sideMove.push_back(cmd.sideMove);
+    upMove.push_back(cmd.upMove);
+    buttons.push_back(cmd.buttons);
+    impulse.push_back(cmd.impulse);
+    weaponSelect.push_back(cmd.weaponSelect);
+    weaponSubtype.push_back(cmd.weaponSubtype);
+    mouseDx.push_back(cmd.mouseDx);
+    mouseDy.push_back(cmd.mouseDy);
+    fields.push_back(cmd.fields);
+}
+
+size_t DecodeDemoUserCmds(const uint8_t* data, uint64_t size, UserCmdTable_t& table)
+{
+    // Counting them first over the framing alone is cheaper than growing every column as we go
+    DemoSummary_t summary;
+    SummarizeDemo(data, size, summary);
+    table.Reserve(table.Size() + summary.messageCounts[DEM_USERCMD]);
+
+    size_t count = 0;
+    CDemoMessageReader reader(data, size);
+    DemoMessage_t msg;
+    while (reader.Next(msg))
+    {
+        if (msg.type != DEM_USERCMD)
+            continue;
+
+        UserCmd_t cmd;
+        if (!DecodeUserCmd(msg.data, msg.dataLength, cmd))
+        {
+            table.truncated++;
+        }
+        table.Append(msg.tick, msg.sequence, cmd);
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "bit_buffer.h"
+
+// Decoder for the payload of DEM_USERCMD messages, the player's input for one tick. The client writes each command
+// with WriteUsercmd() as a delta against an all zero command: one bit per field saying whether it is there, followed
+// by the value if it is. The 2006, 2007 and 2013 engines all write the same fields in the same order, so one decoder
+// covers every game the plugin supports. Game specific extras some clients add after the mouse deltas are skipped.
+
+// Bits of UserCmd_t::fields, set for the fields the payload had
+enum UserCmdField
+{
+    USERCMD_COMMAND_NUMBER,
+    USERCMD_TICK_COUNT,
+    USERCMD_VIEWANGLE_PITCH,
+    USERCMD_VIEWANGLE_YAW,
+    USERCMD_VIEWANGLE_ROLL,
+    USERCMD_FORWARDMOVE,
+    USERCMD_SIDEMOVE,
+    USERCMD_UPMOVE,
+    USERCMD_BUTTONS,
+    USERCMD_IMPULSE,
+    USERCMD_WEAPONSELECT,
+    USERCMD_WEAPONSUBTYPE,
+    USERCMD_MOUSEDX,
+    USERCMD_MOUSEDY,
+
+    USERCMD_FIELD_COUNT
+};
+
+// MAX_EDICT_BITS and WEAPON_SUBTYPE_BITS
+#define USERCMD_WEAPON_BITS 11
+#define USERCMD_WEAPON_SUBTYPE_BITS 6
+
+struct UserCmd_t
+{
+    // Fields that weren't written are what the engine fills in: 1 for the two counters, 0 for the rest
+    int32_t commandNumber;
+    int32_t tickCount;
+    float viewAngles[3];
+    float forwardMove;
+    float sideMove;
+    float upMove;
+    uint32_t buttons;
+    uint8_t impulse;
+    uint8_t weaponSubtype;
+    uint16_t weaponSelect;
+    int16_t mouseDx;
+    int16_t mouseDy;
+
+    // 1 << UserCmdField for every field that was written
+    uint16_t fields;
+};
+
+// False if the payload ended before the mouse deltas, cmd is still filled in with what was there
+bool DecodeUserCmd(const uint8_t* data, size_t size, UserCmd_t& cmd);
+
+// Writes cmd the way the client does, for the tests and benchmarks. Fields equal to the defaults are left out.
+void EncodeUserCmd(const UserCmd_t& cmd, CBitWriter& writer);
+
+//---------------------------------------------------------------------------------
+// Purpose: the usercmds of one or more demos, one column per field so a question about one field ("every tick the
+// buttons changed") only touches that column
+//---------------------------------------------------------------------------------
+struct UserCmdTable_t
+{
+    // Of the message, not of the command
+    std::vector<int32_t> demoTick;
+    std::vector<int32_t> sequence;
+
+    std::vector<int32_t> commandNumber;
+    std::vector<int32_t> tickCount;
+    std::vector<float> pitch;
+    std::vector<float> yaw;
+    std::vector<float> roll;
+    std::vector<float> forwardMove;
+    std::vector<float> sideMove;
+    std::vector<float> upMove;
+    std::vector<uint32_t> buttons;
+    std::vector<uint8_t> impulse;
+    std::vector<uint16_t> weaponSelect;
+    std::vector<uint8_t> weaponSubtype;
+    std::vector<int16_t> mouseDx;
+    std::vector<int16_t> mouseDy;
+    std::vector<uint16_t> fields;
+
+    // Payloads that ended early, their rows are still added
+    uint32_t truncated;
+
+    UserCmdTable_t() : truncated(0) {}
+
+    size_t Size() const
+    {
+        return demoTick.size();
+    }
+
+    void Clear();
+    void Reserve(size_t rows);
+    void Append(int32_t tick, int32_t seq, const UserCmd_t& cmd);
+};
+
+// Decodes every usercmd of a demo (the whole file, header included) into the table, returns how many
+size_t DecodeDemoUserCmds(const uint8_t* data, uint64_t size, UserCmdTable_t& table);
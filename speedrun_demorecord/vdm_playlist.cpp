@@ -0,0 +1,169 @@
+#include "vdm_playlist.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+
+#include "demo_index.h"
+
+void BuildPlaylist(const std::vector<journalrecord_t>& records, std::vector<PlaylistDemo_t>& demos)
+{
+    demos.clear();
+
+    // Position of each name in demos
+    std::map<std::string, size_t> byName;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const journalrecord_t& record = records[i];
+        if (record.type != JOURNAL_RECORD && record.type != JOURNAL_STOP)
+            continue;
+
+        const std::string name(record.demoName, strnlen(record.demoName, sizeof(record.demoName)));
+        if (name.empty())
+            continue;
+
+        std::map<std::string, size_t>::iterator it = byName.find(name);
+        if (record.type == JOURNAL_RECORD)
+        {
+            if (it != byName.end())
+            {
+                // Overwritten, the old entry stays in the list but without a tick it is left out of the chain
+                demos[it->second].demoName.clear();
+                demos[it->second].endTick = PLAYLIST_NO_TICK;
+            }
+
+            PlaylistDemo_t demo;
+            demo.demoName = name;
+            demo.endTick = PLAYLIST_NO_TICK;
+            byName[name] = demos.size();
+            demos.push_back(demo);
+        }
+        else if (it != byName.end() && record.tick >= 0)
+        {
+            demos[it->second].endTick = record.tick;
+        }
+    }
+
+    // Drop the overwritten entries
+    size_t kept = 0;
+    for (size_t i = 0; i < demos.size(); i++)
+    {
+        if (!demos[i].demoName.empty())
+        {
+            demos[kept++] = demos[i];
+        }
+    }
+    demos.resize(kept);
+}
+
+void FormatVdm(const PlaylistOptions_t& options, int32_t endTick, const char* nextDemo, std::string& vdm)
+{
+    std::string commands;
+    if (options.waitFrames > 0)
+    {
+        commands = "wait " + std::to_string(options.waitFrames) + "; ";
+    }
+    if (nextDemo)
+    {
+        commands += "playdemo ";
+        commands += nextDemo;
+    }
+    else
+    {
+        commands += options.finalCommands;
+    }
+    std::replace(commands.begin(), commands.end(), '"', '\'');
+
+    // Same layout construct_vdm in tests/demo_utils.py writes
+    const int32_t startTick = endTick > PLAYLIST_END_TICK_MARGIN ? endTick - PLAYLIST_END_TICK_MARGIN : 0;
+    vdm = "demoactions\n"
+          "{\n"
+          "    \"1\"\n"
+          "    {\n"
+          "        factory \"PlayCommands\"\n"
+          "        name \"Execute command\"\n"
+          "        starttick \"";
+    vdm += std::to_string(startTick);
+    vdm += "\"\n"
+           "        commands \"";
+    vdm += commands;
+    vdm += "\"\n"
+           "    }\n";
+
+    if (options.playbackRate > 0.0)
+    {
+        char rate[32];
+        snprintf(rate, sizeof(rate), "%f", options.playbackRate);
+        vdm += "    \"2\"\n"
+               "    {\n"
+               "        factory \"ChangePlaybackRate\"\n"
+               "        name \"Play demo fast\"\n"
+               "        starttick \"0\"\n"
+               "        playbackrate \"";
+        vdm += rate;
+        vdm += "\"\n"
+               "    }\n";
+    }
+    vdm += "}";
+}
+
+int32_t GetIndexedEndTick(const std::string& index)
+{
+    CDemoIndex demoIndex;
+    if (!demoIndex.Load(index.data(), index.size()) || demoIndex.GetLastTick() < 0)
+        return PLAYLIST_NO_TICK;
+    return demoIndex.GetLastTick();
+}
+
+PlaylistResult_t WritePlaylist(const std::vector<journalrecord_t>& records,
+                               const std::string& sessionDir,
+                               const std::string& playDir,
+                               const PlaylistOptions_t& options,
+                               const PlaylistReadFn& readFile,
+                               const PlaylistWriteFn& writeFile,
+                               std::vector<PlaylistDemo_t>* chain)
+{
+    PlaylistResult_t result;
+    memset(&result, 0, sizeof(result));
+
+    std::vector<PlaylistDemo_t> demos;
+    BuildPlaylist(records, demos);
+
+    // Engines before 2013 can't tell the tick a demo stopped at, the indexer wrote it down instead. Demos without
+    // either (the one still recording, crashes) can't be chained.
+    size_t kept = 0;
+    std::string index;
+    for (size_t i = 0; i < demos.size(); i++)
+    {
+        PlaylistDemo_t& demo = demos[i];
+        if (demo.endTick == PLAYLIST_NO_TICK && readFile(sessionDir + demo.demoName + DEMO_INDEX_EXTENSION, index))
+        {
+            demo.endTick = GetIndexedEndTick(index);
+            result.fromIndex += demo.endTick != PLAYLIST_NO_TICK ? 1 : 0;
+        }
+
+        if (demo.endTick == PLAYLIST_NO_TICK)
+        {
+            result.skipped++;
+            continue;
+        }
+        demos[kept++] = demo;
+    }
+    demos.resize(kept);
+
+    std::string vdm;
+    for (size_t i = 0; i < demos.size(); i++)
+    {
+        const std::string next = i + 1 < demos.size() ? playDir + demos[i + 1].demoName : std::string();
+        FormatVdm(options, demos[i].endTick, next.empty() ? NULL : next.c_str(), vdm);
+        writeFile(sessionDir + demos[i].demoName + ".vdm", vdm);
+        result.written++;
+    }
+
+    if (chain)
+    {
+        chain->swap(demos);
+    }
+    return result;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "session_journal.h"
+
+// VDM chains for playing a whole session back: every demo gets a <name>.vdm next to it that runs "playdemo <next>"
+// at its end tick, the last one runs PlaylistOptions_t::finalCommands instead. Order and end ticks come from the
+// session journal (and the .dmi indexes for demos the journal has no end tick for), demos are never parsed.
+
+#define PLAYLIST_DEFAULT_RATE 10.0
+
+// The PlayCommands action is placed this many ticks before the end so it fires before playback stops
+#define PLAYLIST_END_TICK_MARGIN 2
+
+#define PLAYLIST_NO_TICK -1
+
+struct PlaylistDemo_t
+{
+    // Bare name without extension, as in the journal
+    std::string demoName;
+
+    // Last tick of the demo, PLAYLIST_NO_TICK if it isn't known
+    int32_t endTick;
+};
+
+struct PlaylistOptions_t
+{
+    PlaylistOptions_t() : playbackRate(PLAYLIST_DEFAULT_RATE), waitFrames(200), finalCommands("exit") {}
+
+    // ChangePlaybackRate from tick 0, leaves the rate alone if <= 0
+    double playbackRate;
+
+    // "wait" before the next demo or the final commands, 0 for none
+    int waitFrames;
+
+    // Run at the end of the last demo. VDM strings can't hold double quotes, they become single quotes.
+    std::string finalCommands;
+};
+
+struct PlaylistResult_t
+{
+    // .vdm files written, one per demo in the chain
+    uint32_t written;
+
+    // End ticks that came from a .dmi rather than the journal
+    uint32_t fromIndex;
+
+    // Demos left out of the chain because their end tick isn't known
+    uint32_t skipped;
+};
+
+// Demos in recording order with the tick their stop record was journaled at. A demo recorded again under the same
+// name (after a resume) counts where it was recorded last.
+void BuildPlaylist(const std::vector<journalrecord_t>& records, std::vector<PlaylistDemo_t>& demos);
+
+// The .vdm of one demo. nextDemo is what playdemo gets (game relative, without extension), NULL for the last demo.
+void FormatVdm(const PlaylistOptions_t& options, int32_t endTick, const char* nextDemo, std::string& vdm);
+
+// Last tick recorded in a .dmi, PLAYLIST_NO_TICK if the index doesn't load
+int32_t GetIndexedEndTick(const std::string& index);
+
+typedef std::function<bool(const std::string& path, std::string& contents)> PlaylistReadFn;
+typedef std::function<void(const std::string& path, const std::string& contents)> PlaylistWriteFn;
+
+// Writes the chain for the session in sessionDir (with a trailing slash) that records describe. playDir is the same
+// directory as playdemo should see it, relative to the game. readFile is only used for .dmi files. chain, if given,
+// gets the demos in the order they play.
+PlaylistResult_t WritePlaylist(const std::vector<journalrecord_t>& records,
+                               const std::string& sessionDir,
+                               const std::string& playDir,
+                               const PlaylistOptions_t& options,
+                               const PlaylistReadFn& readFile,
+                               const PlaylistWriteFn& writeFile,
+                               std::vector<PlaylistDemo_t>* chain = NULL);
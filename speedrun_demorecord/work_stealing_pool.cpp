@@ -0,0 +1,148 @@
+#include "work_stealing_pool.h"
+
+// Which pool and worker the current thread belongs to, so Submit from a task stays on that worker
+static thread_local CWorkStealingPool* s_pCurrentPool = NULL;
+static thread_local unsigned s_CurrentWorker = 0;
+
+//---------------------------------------------------------------------------------
+// Purpose: constructor/destructor
+//---------------------------------------------------------------------------------
+CWorkStealingPool::CWorkStealingPool(unsigned threadCount)
+    : m_Queued(0),
+      m_Unfinished(0),
+      m_Steals(0),
+      m_NextWorker(0),
+      m_bStop(false)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::thread::hardware_concurrency();
+        if (threadCount == 0)
+        {
+            threadCount = 1;
+        }
+    }
+
+    for (unsigned i = 0; i < threadCount; i++)
+    {
+        m_Workers.push_back(std::unique_ptr<Worker_t>(new Worker_t));
+    }
+    for (unsigned i = 0; i < threadCount; i++)
+    {
+        m_Threads.push_back(std::thread(&CWorkStealingPool::ThreadMain, this, i));
+    }
+}
+
+CWorkStealingPool::~CWorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_bStop = true;
+        m_Wake.notify_all();
+    }
+    for (size_t i = 0; i < m_Threads.size(); i++)
+    {
+        m_Threads[i].join();
+    }
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: producers
+//---------------------------------------------------------------------------------
+void CWorkStealingPool::Submit(Task task)
+{
+    unsigned index;
+    if (s_pCurrentPool == this)
+    {
+        index = s_CurrentWorker;
+    }
+    else
+    {
+        index = m_NextWorker++ % (unsigned)m_Workers.size();
+    }
+
+    // Counted first so a worker that takes the task right away never sees the counts go below zero
+    m_Unfinished++;
+    m_Queued++;
+    {
+        Worker_t& worker = *m_Workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+
+    // Workers check m_Queued under this lock before sleeping, so the wake can't be missed
+    std::lock_guard<std::mutex> lock(m_SleepMutex);
+    m_Wake.notify_one();
+}
+
+void CWorkStealingPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_SleepMutex);
+    m_Done.wait(lock, [this] { return m_Unfinished.load() == 0; });
+}
+
+//---------------------------------------------------------------------------------
+// Purpose: workers
+//---------------------------------------------------------------------------------
+void CWorkStealingPool::ThreadMain(unsigned index)
+{
+    s_pCurrentPool = this;
+    s_CurrentWorker = index;
+
+    for (;;)
+    {
+        Task task;
+        if (PopOwn(index, task) || Steal(index, task))
+        {
+            m_Queued--;
+            task();
+            task = Task();
+
+            if (--m_Unfinished == 0)
+            {
+                std::lock_guard<std::mutex> lock(m_SleepMutex);
+                m_Done.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_SleepMutex);
+        if (m_Queued.load() != 0)
+            continue;
+        if (m_bStop)
+            break;
+        m_Wake.wait(lock);
+    }
+
+    s_pCurrentPool = NULL;
+}
+
+bool CWorkStealingPool::PopOwn(unsigned index, Task& task)
+{
+    Worker_t& worker = *m_Workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty())
+        return false;
+
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool CWorkStealingPool::Steal(unsigned index, Task& task)
+{
+    const unsigned count = (unsigned)m_Workers.size();
+    for (unsigned i = 1; i < count; i++)
+    {
+        Worker_t& victim = *m_Workers[(index + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty())
+            continue;
+
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        m_Steals++;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//---------------------------------------------------------------------------------
+// Purpose: thread pool where every worker has its own task deque. A worker runs its newest task first (LIFO, the data
+// it just touched is still warm) and an idle worker steals the oldest task of another (FIFO, usually the biggest piece
+// of work left). Tasks submitted from inside a task go to the submitting worker's deque, so a task that fans out
+// (a directory that queues a task per file) keeps its workers busy without a shared queue everyone fights over.
+//
+// Each deque has its own lock, tasks are meant to be coarse (a file, not a message).
+//---------------------------------------------------------------------------------
+class CWorkStealingPool
+{
+    public:
+    typedef std::function<void()> Task;
+
+    // threadCount 0 uses every core
+    explicit CWorkStealingPool(unsigned threadCount = 0);
+
+    // Runs whatever is still queued, then joins
+    ~CWorkStealingPool();
+
+    // Any thread, including tasks of this pool
+    void Submit(Task task);
+
+    // Blocks until every submitted task has run, including tasks submitted by tasks. Not from inside a task.
+    void Wait();
+
+    unsigned GetThreadCount() const
+    {
+        return (unsigned)m_Threads.size();
+    }
+
+    // Tasks that ran on a different worker than they were queued on
+    uint64_t GetSteals() const
+    {
+        return m_Steals.load();
+    }
+
+    private:
+    CWorkStealingPool(const CWorkStealingPool&);
+    CWorkStealingPool& operator=(const CWorkStealingPool&);
+
+    struct Worker_t
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void ThreadMain(unsigned index);
+    bool PopOwn(unsigned index, Task& task);
+    bool Steal(unsigned index, Task& task);
+
+    std::vector<std::unique_ptr<Worker_t> > m_Workers;
+    std::vector<std::thread> m_Threads;
+
+    // Queued and not started, workers only sleep when this is 0
+    std::atomic<uint64_t> m_Queued;
+
+    // Submitted and not finished
+    std::atomic<uint64_t> m_Unfinished;
+
+    std::atomic<uint64_t> m_Steals;
+    std::atomic<unsigned> m_NextWorker;
+
+    std::mutex m_SleepMutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Done;
+    bool m_bStop;
+};
@@ -0,0 +1,276 @@
+"""Run every demo tool over a synthetic corpus and report throughput and
+peak memory.
+
+Usage:
+    python bench_corpus.py --tools DIR [--corpus DIR] [-S SESSIONS]
+                           [-t TICKS] [--big SIZE] [--json PATH]
+
+--tools is the directory the top level CMakeLists.txt built the tools into,
+the bench_corpus target passes it. The corpus is made by demo_gen: SESSIONS
+session dirs (4 by default) named like the plugin's, and with --big one
+more demo of SIZE ("2G") on its own for the tools that read single demos.
+The same arguments always make the same bytes, so two builds can be compared
+run for run. --corpus keeps the corpus there and only makes it again when the
+arguments changed, by default it goes to a temporary dir.
+
+Every tool runs once. MB/s is of the bytes it read, peak RSS is the tool's
+own high-water mark (mapped demo pages count, they are what it touched). On
+Linux it is polled every millisecond, a tool that exits before the first poll
+shows at least this interpreter's RSS, like everywhere else but Windows.
+--json writes the same rows for tracking them over time.
+"""
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from typing import Dict, List, NamedTuple, Optional, Tuple
+
+CORPUS_STAMP = "bench_corpus.json"
+
+
+class Row(NamedTuple):
+    tool: str
+    corpus: str
+    input_bytes: int
+    seconds: float
+    peak_rss: Optional[int]
+
+
+def windows_peak_rss(process: subprocess.Popen) -> Optional[int]:
+    import ctypes
+    from ctypes import wintypes
+
+    class ProcessMemoryCounters(ctypes.Structure):
+        _fields_ = [("cb", wintypes.DWORD), ("PageFaultCount", wintypes.DWORD),
+                    ("PeakWorkingSetSize", ctypes.c_size_t),
+                    ("WorkingSetSize", ctypes.c_size_t),
+                    ("QuotaPeakPagedPoolUsage", ctypes.c_size_t),
+                    ("QuotaPagedPoolUsage", ctypes.c_size_t),
+                    ("QuotaPeakNonPagedPoolUsage", ctypes.c_size_t),
+                    ("QuotaNonPagedPoolUsage", ctypes.c_size_t),
+                    ("PagefileUsage", ctypes.c_size_t),
+                    ("PeakPagefileUsage", ctypes.c_size_t)]
+
+    counters = ProcessMemoryCounters()
+    counters.cb = ctypes.sizeof(counters)
+    # The handle stays open until the Popen object goes away
+    if not ctypes.windll.kernel32.K32GetProcessMemoryInfo(
+            int(process._handle), ctypes.byref(counters), counters.cb):
+        return None
+    return counters.PeakWorkingSetSize
+
+
+def read_vm_hwm(pid: int) -> Optional[int]:
+    """Linux' high-water mark of a running process' RSS, in bytes."""
+    try:
+        with open(f"/proc/{pid}/status", encoding="ascii") as fd:
+            for line in fd:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1]) * 1024
+    except (OSError, ValueError):
+        pass
+    return None
+
+
+def run_measured(args: List[str]) -> Tuple[float, Optional[int]]:
+    """Seconds and peak RSS in bytes of one run, which must succeed."""
+    start: float = time.perf_counter()
+    process = subprocess.Popen(args, stdout=subprocess.DEVNULL)
+    if not hasattr(os, "wait4"):
+        code: int = process.wait()
+        seconds: float = time.perf_counter() - start
+        peak_rss: Optional[int] = windows_peak_rss(process)
+    else:
+        # ru_maxrss never goes below what this interpreter had when it forked,
+        # so poll the tool's own mark while it runs where the kernel shows it
+        polled: Optional[int] = None
+        while True:
+            pid, status, usage = os.wait4(process.pid, os.WNOHANG)
+            if pid != 0:
+                break
+            hwm: Optional[int] = read_vm_hwm(process.pid)
+            if hwm is not None:
+                polled = max(polled or 0, hwm)
+            time.sleep(0.001)
+        seconds = time.perf_counter() - start
+        code = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+        process.returncode = code
+
+        # Kilobytes on Linux, bytes on macOS
+        scale: int = 1 if sys.platform == "darwin" else 1024
+        peak_rss = polled if polled is not None else usage.ru_maxrss * scale
+
+    if code != 0:
+        raise Exception(f"{' '.join(args)} exited with {code}")
+    return seconds, peak_rss
+
+
+def find_tool(tools_dir: str, name: str) -> str:
+    for file_name in (name, f"{name}.exe"):
+        path: str = os.path.join(tools_dir, file_name)
+        if os.path.isfile(path):
+            return path
+    raise Exception(f"{name} not found in {tools_dir}, build it first")
+
+
+def list_files(root: str, suffix: str) -> List[str]:
+    paths: List[str] = []
+    for dir_path, _, file_names in os.walk(root):
+        paths += [os.path.join(dir_path, name) for name in file_names
+                  if name.endswith(suffix)]
+    return sorted(paths)
+
+
+def make_corpus(tools_dir: str, corpus_dir: str, args: argparse.Namespace,
+                rows: List[Row]) -> None:
+    # A rebuilt demo_gen may write different bytes
+    demo_gen: str = find_tool(tools_dir, "demo_gen")
+    stamp: Dict[str, object] = {
+        "demo_gen": os.path.getmtime(demo_gen),
+        "sessions": args.sessions,
+        "ticks": args.ticks,
+        "seed": args.seed,
+        "big": args.big,
+    }
+    stamp_path: str = os.path.join(corpus_dir, CORPUS_STAMP)
+    try:
+        with open(stamp_path, encoding="utf-8") as fd:
+            if json.load(fd) == stamp:
+                print(f"reusing {corpus_dir}")
+                return
+    except (OSError, ValueError):
+        pass
+
+    shutil.rmtree(os.path.join(corpus_dir, "sessions"), ignore_errors=True)
+    shutil.rmtree(os.path.join(corpus_dir, "big"), ignore_errors=True)
+
+    sessions_dir: str = os.path.join(corpus_dir, "sessions")
+    os.makedirs(sessions_dir)
+    seconds, peak_rss = run_measured([
+        demo_gen, "-S", str(args.sessions), "-t", str(args.ticks), "-s",
+        str(args.seed), sessions_dir
+    ])
+    rows.append(Row("demo_gen", "sessions", dir_size(sessions_dir), seconds,
+                    peak_rss))
+
+    if args.big:
+        big_dir: str = os.path.join(corpus_dir, "big")
+        os.makedirs(big_dir)
+        big_path: str = os.path.join(big_dir, "big.dem")
+        seconds, peak_rss = run_measured(
+            [demo_gen, "-b", args.big, "-s", str(args.seed), big_path])
+        rows.append(Row("demo_gen", "big", os.path.getsize(big_path), seconds,
+                        peak_rss))
+
+    with open(stamp_path, "w", encoding="utf-8") as fd:
+        json.dump(stamp, fd)
+
+
+def dir_size(root: str) -> int:
+    return sum(os.path.getsize(path) for path in list_files(root, ""))
+
+
+def bench_demos(tools_dir: str, corpus: str, root: str,
+                session_dirs: List[str], work_dir: str,
+                rows: List[Row]) -> None:
+    """Runs every tool that reads demos over the ones under root."""
+    demos: List[str] = list_files(root, ".dem")
+    demo_bytes: int = sum(os.path.getsize(path) for path in demos)
+
+    def run(tool: str, args: List[str], input_bytes: int = demo_bytes,
+            label: Optional[str] = None) -> None:
+        seconds, peak_rss = run_measured([find_tool(tools_dir, tool)] + args)
+        rows.append(Row(label or tool, corpus, input_bytes, seconds,
+                        peak_rss))
+
+    # The dir tools walk it themselves, the rest get the demos
+    inputs: List[str] = session_dirs or demos
+    run("demo_info", demos)
+    run("bench_demo_parse", ["-n", "1"] + demos)
+    run("usercmd_dump", ["-s"] + demos)
+    run("validate_sessions", inputs)
+    run("demo_trim", ["-o", os.path.join(work_dir, "trim")] + inputs)
+
+    stc_path: str = os.path.join(work_dir, "ticks.stc")
+    run("tick_export", ["-o", stc_path] + inputs)
+    run("tick_scan", ["-c", "yaw", stc_path], os.path.getsize(stc_path))
+
+    archive_path: str = os.path.join(work_dir, "corpus.sra")
+    run("session_archive", ["pack", archive_path] + inputs,
+        label="session_archive pack")
+    run("session_archive",
+        ["unpack", archive_path, os.path.join(work_dir, "unpacked")],
+        label="session_archive unpack")
+
+    # These write next to the demos, the corpus is cleaned up after
+    run("demo_index", demos)
+    if session_dirs:
+        run("vdm_playlist", session_dirs, 0)
+        run("session_timeline", [session_dirs[0]], 0)
+
+    for suffix in (".dmi", ".vdm"):
+        for path in list_files(root, suffix):
+            os.remove(path)
+    shutil.rmtree(work_dir)
+    os.makedirs(work_dir)
+
+
+def report(rows: List[Row]) -> None:
+    print(f"{'tool':26} {'corpus':9} {'MB':>9} {'seconds':>9} {'MB/s':>9} "
+          f"{'peak RSS MB':>12}")
+    for row in rows:
+        mbps: str = f"{row.input_bytes / 1e6 / row.seconds:9.1f}" \
+            if row.input_bytes and row.seconds > 0 else f"{'-':>9}"
+        rss: str = f"{row.peak_rss / 1e6:12.1f}" \
+            if row.peak_rss is not None else f"{'-':>12}"
+        print(f"{row.tool:26} {row.corpus:9} {row.input_bytes / 1e6:9.1f} "
+              f"{row.seconds:9.3f} {mbps} {rss}")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawTextHelpFormatter)
+    parser.add_argument("--tools", required=True,
+                        help="directory with demo_gen and the other tools")
+    parser.add_argument("--corpus", help="where to keep the corpus")
+    parser.add_argument("-S", type=int, default=4, dest="sessions")
+    parser.add_argument("-t", type=int, default=4000, dest="ticks",
+                        help="input ticks of each map's final demo")
+    parser.add_argument("-s", type=int, default=1, dest="seed")
+    parser.add_argument("--big", help="size of the single demo, e.g. 2G")
+    parser.add_argument("--json", help="also write the rows here")
+    args = parser.parse_args()
+
+    corpus_dir: str = args.corpus or tempfile.mkdtemp()
+    os.makedirs(corpus_dir, exist_ok=True)
+    work_dir: str = tempfile.mkdtemp()
+    rows: List[Row] = []
+    try:
+        make_corpus(args.tools, corpus_dir, args, rows)
+
+        sessions_dir: str = os.path.join(corpus_dir, "sessions")
+        session_dirs: List[str] = sorted(
+            os.path.join(sessions_dir, name) for name in os.listdir(sessions_dir))
+        bench_demos(args.tools, "sessions", sessions_dir, session_dirs,
+                    work_dir, rows)
+
+        big_dir: str = os.path.join(corpus_dir, "big")
+        if args.big:
+            bench_demos(args.tools, "big", big_dir, [], work_dir, rows)
+    finally:
+        shutil.rmtree(work_dir, ignore_errors=True)
+        if not args.corpus:
+            shutil.rmtree(corpus_dir, ignore_errors=True)
+
+    report(rows)
+    if args.json:
+        with open(args.json, "w", encoding="utf-8") as fd:
+            json.dump([row._asdict() for row in rows], fd, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,62 @@
+"""Compare demo parse throughput of demo_utils.py against the native reader.
+
+Usage:
+    python bench_demo_parse.py [--native PATH] [-n ITERATIONS] DEMO [DEMO ...]
+
+--native points at the bench_demo_parse binary built by the top level
+CMakeLists.txt. Both sides parse the same files the same number of times and
+report GB/s.
+"""
+import argparse
+import os
+import re
+import subprocess
+import time
+from typing import List, Optional
+
+from demo_utils import get_demo_tick_count
+
+RE_NATIVE_GBPS = re.compile(r"^GB/s\s+([0-9.]+)$", re.MULTILINE)
+
+
+def bench_python(demo_paths: List[str], iterations: int) -> float:
+    total_bytes: int = 0
+    start: float = time.perf_counter()
+    for _ in range(iterations):
+        for demo_path in demo_paths:
+            get_demo_tick_count(demo_path)
+            total_bytes += os.path.getsize(demo_path)
+    seconds: float = time.perf_counter() - start
+    return total_bytes / seconds / 1e9
+
+
+def bench_native(native_path: str, demo_paths: List[str],
+                 iterations: int) -> Optional[float]:
+    result = subprocess.run([native_path, "-n", str(iterations)] + demo_paths,
+                            stdout=subprocess.PIPE,
+                            universal_newlines=True,
+                            check=True)
+    match = RE_NATIVE_GBPS.search(result.stdout)
+    return float(match.group(1)) if match else None
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--native", help="path to bench_demo_parse")
+    parser.add_argument("-n", type=int, default=3, dest="iterations")
+    parser.add_argument("demos", nargs="+")
+    args = parser.parse_args()
+
+    python_gbps: float = bench_python(args.demos, args.iterations)
+    print(f"python  {python_gbps:.4f} GB/s")
+
+    if args.native:
+        native_gbps: Optional[float] = bench_native(args.native, args.demos,
+                                                    args.iterations)
+        if native_gbps is not None:
+            print(f"native  {native_gbps:.4f} GB/s")
+            print(f"speedup {native_gbps / python_gbps:.1f}x")
+
+
+if __name__ == "__main__":
+    main()
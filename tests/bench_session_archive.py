@@ -0,0 +1,108 @@
+"""Compare session_archive against a plain zip of the same session.
+
+Usage:
+    python bench_session_archive.py --native PATH [-j THREADS] SESSION_DIR
+
+--native points at the session_archive binary built by the top level
+CMakeLists.txt. The session is packed and unpacked with it and zipped and
+unzipped with zipfile (deflate, what a zip made by hand usually is). Both
+report the compression ratio and MB/s of the original data, and the unpacked
+files are compared with the originals.
+"""
+import argparse
+import filecmp
+import os
+import shutil
+import subprocess
+import tempfile
+import time
+import zipfile
+from typing import List, Optional
+
+
+def list_session(session_dir: str) -> List[str]:
+    return sorted(name for name in os.listdir(session_dir)
+                  if os.path.isfile(os.path.join(session_dir, name)))
+
+
+def same_files(session_dir: str, out_dir: str, names: List[str]) -> bool:
+    _, mismatch, errors = filecmp.cmpfiles(session_dir, out_dir, names,
+                                           shallow=False)
+    return not mismatch and not errors
+
+
+def report(name: str, input_bytes: int, archive_bytes: int, pack_seconds: float,
+           unpack_seconds: float, ok: bool) -> None:
+    print(f"{name:8} {archive_bytes / 1e6:9.1f} MB  "
+          f"ratio {input_bytes / archive_bytes:6.2f}  "
+          f"pack {input_bytes / 1e6 / pack_seconds:8.1f} MB/s  "
+          f"unpack {input_bytes / 1e6 / unpack_seconds:8.1f} MB/s  "
+          f"{'identical' if ok else 'MISMATCH'}")
+
+
+def bench_zip(session_dir: str, names: List[str], work_dir: str,
+              input_bytes: int) -> None:
+    archive_path: str = os.path.join(work_dir, "session.zip")
+    out_dir: str = os.path.join(work_dir, "zip_out")
+
+    start: float = time.perf_counter()
+    with zipfile.ZipFile(archive_path, "w", zipfile.ZIP_DEFLATED) as archive:
+        for name in names:
+            archive.write(os.path.join(session_dir, name), name)
+    pack_seconds: float = time.perf_counter() - start
+
+    start = time.perf_counter()
+    with zipfile.ZipFile(archive_path) as archive:
+        archive.extractall(out_dir)
+    unpack_seconds: float = time.perf_counter() - start
+
+    report("zip", input_bytes, os.path.getsize(archive_path), pack_seconds,
+           unpack_seconds, same_files(session_dir, out_dir, names))
+
+
+def bench_native(native_path: str, threads: Optional[int], session_dir: str,
+                 names: List[str], work_dir: str, input_bytes: int) -> None:
+    archive_path: str = os.path.join(work_dir, "session.sra")
+    out_dir: str = os.path.join(work_dir, "sra_out")
+    thread_args: List[str] = ["-j", str(threads)] if threads else []
+
+    start: float = time.perf_counter()
+    subprocess.run([native_path] + thread_args +
+                   ["pack", archive_path, session_dir],
+                   stdout=subprocess.DEVNULL, check=True)
+    pack_seconds: float = time.perf_counter() - start
+
+    start = time.perf_counter()
+    subprocess.run([native_path] + thread_args +
+                   ["unpack", archive_path, out_dir],
+                   stdout=subprocess.DEVNULL, check=True)
+    unpack_seconds: float = time.perf_counter() - start
+
+    report("sra", input_bytes, os.path.getsize(archive_path), pack_seconds,
+           unpack_seconds, same_files(session_dir, out_dir, names))
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--native", required=True,
+                        help="path to session_archive")
+    parser.add_argument("-j", type=int, dest="threads")
+    parser.add_argument("session_dir")
+    args = parser.parse_args()
+
+    names: List[str] = list_session(args.session_dir)
+    input_bytes: int = sum(os.path.getsize(os.path.join(args.session_dir, name))
+                           for name in names)
+    print(f"{len(names)} files, {input_bytes / 1e6:.1f} MB")
+
+    work_dir: str = tempfile.mkdtemp()
+    try:
+        bench_native(args.native, args.threads, args.session_dir, names,
+                     work_dir, input_bytes)
+        bench_zip(args.session_dir, names, work_dir, input_bytes)
+    finally:
+        shutil.rmtree(work_dir)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,5 +1,7 @@
 """Utilities for Source Engine demos."""
 import os
+import struct
+import zlib
 from enum import IntEnum, auto
 from typing import List, Optional
 
@@ -23,6 +25,13 @@ DEM_MSG_DATA: List[DemMsgType] = [
 DEM_MSG_OTHER: List[DemMsgType] = [DemMsgType.SyncTick, DemMsgType.Nop]
 DEM_HEADER_SIZE = 0x430
 
+# .dmi tick index written next to each demo, see demo_index.h
+DMI_MAGIC = 0x31494D44
+DMI_VERSION = 1
+DMI_HEADER_FORMAT = "<IIIiQIBB2x9I9QI"
+DMI_HEADER_SIZE = struct.calcsize(DMI_HEADER_FORMAT)
+DMI_ENTRY_SIZE = 16
+
 
 def get_demo_tick_count(demo_path: str) -> Optional[int]:
     with open(demo_path, 'rb') as fd:
@@ -70,9 +79,39 @@ def get_demo_tick_count(demo_path: str) -> Optional[int]:
         return tick
 
 
+def get_demo_index_tick_count(demo_path: str) -> Optional[int]:
+    """Last tick from the demo's .dmi, None if it is missing, corrupt or
+    was built for a different version of the demo."""
+    index_path: str = f"{os.path.splitext(demo_path)[0]}.dmi"
+    try:
+        with open(index_path, 'rb') as fd:
+            index: bytes = fd.read()
+    except OSError:
+        return None
+
+    if len(index) < DMI_HEADER_SIZE:
+        return None
+
+    (magic, version, _stride, last_tick, demo_size, entry_count, _stop,
+     _error, *_counts, crc) = struct.unpack_from(DMI_HEADER_FORMAT, index)
+    if magic != DMI_MAGIC or version != DMI_VERSION:
+        return None
+    if len(index) != DMI_HEADER_SIZE + entry_count * DMI_ENTRY_SIZE:
+        return None
+    if zlib.crc32(index[:DMI_HEADER_SIZE - 4] +
+                  index[DMI_HEADER_SIZE:]) != crc:
+        return None
+    if demo_size != os.path.getsize(demo_path) or last_tick < 0:
+        return None
+    return last_tick
+
+
 def construct_vdm(demo_path: str, next_demo: Optional[str]):
     # next_demo should be a path relative to the game folder (?)
-    demo_endtick: Optional[int] = get_demo_tick_count(demo_path)
+    # The plugin's index saves reading the whole demo
+    demo_endtick: Optional[int] = get_demo_index_tick_count(demo_path)
+    if demo_endtick is None:
+        demo_endtick = get_demo_tick_count(demo_path)
     if not demo_endtick:
         raise Exception("Failed to parse end tick from demo \"{demo_path}\"")
 
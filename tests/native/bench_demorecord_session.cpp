@@ -0,0 +1,139 @@
+//---------------------------------------------------------------------------------
+// Purpose: throughput of the recording state machine against the in-memory engine, no game required
+//
+//  bench_demorecord_session [-n sequences]
+//
+// One sequence is the hl2 playback.cfg run: speedrun_start, eight loads, speedrun_stop. Afterwards speedrun_resume of a
+// long session is timed. It replays the journal, the in-memory disk would make a directory scan look free. Then the
+// speedrun_playlist VDM chain of that session is timed.
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "demorecord_session.h"
+#include "fake_demorecord_host.h"
+#include "latency_stats.h"
+
+int main(int argc, char** argv)
+{
+    int sequences = 100000;
+    if (argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+        sequences = atoi(argv[2]);
+    }
+    else if (argc > 1)
+    {
+        sequences = 0;
+    }
+
+    if (sequences <= 0)
+    {
+        fprintf(stderr, "usage: %s [-n sequences]\n", argv[0]);
+        return 2;
+    }
+
+    static const char* const s_Maps[] = {"d1_canals_06",
+                                         "d1_canals_06",
+                                         "d1_canals_06",
+                                         "d1_canals_07",
+                                         "d1_canals_06",
+                                         "d1_canals_06",
+                                         "d1_canals_08",
+                                         "d2_coast_01"};
+    const int mapCount = (int)(sizeof(s_Maps) / sizeof(s_Maps[0]));
+
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+    CLatencyHistogram loadLatency;
+
+    struct tm ltime;
+    memset(&ltime, 0, sizeof(ltime));
+    ltime.tm_year = 2024;
+    ltime.tm_mon = 1;
+    ltime.tm_mday = 1;
+
+    uint64_t demos = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < sequences; i++)
+    {
+        // Fresh session dir each time, like a new run
+        ltime.tm_sec = i % 60;
+        ltime.tm_min = (i / 60) % 60;
+        ltime.tm_hour = i / 3600;
+        session.Start("speedrun/", ltime);
+
+        for (int map = 0; map < mapCount; map++)
+        {
+            const uint64_t loadStart = LatencyNow();
+            host.LoadMap(session, s_Maps[map], 1);
+            loadLatency.Record(LatencyNow() - loadStart);
+        }
+        session.Stop("speedrun/");
+        host.RunCommands();
+
+        demos += host.m_RecordedDemos.size();
+        host.m_RecordedDemos.clear();
+        host.m_RecordStarts.clear();
+        host.m_StoppedDemos.clear();
+        host.m_Files.clear();
+        host.m_Dirs.clear();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (demos != (uint64_t)sequences * (uint64_t)mapCount)
+    {
+        fprintf(stderr, "expected %d demos per sequence, got %llu in total\n", mapCount, (unsigned long long)demos);
+        return 1;
+    }
+
+    printf("sequences  %d x %d loads\n", sequences, mapCount);
+    printf("time       %.3f s\n", seconds);
+    printf("throughput %.0f sequences/s\n", seconds > 0.0 ? sequences / seconds : 0.0);
+    printf("load       p50 %.2f us  p99 %.2f us  max %.2f us\n",
+           (double)loadLatency.GetPercentile(50.0) / 1000.0,
+           (double)loadLatency.GetPercentile(99.0) / 1000.0,
+           (double)loadLatency.GetMax() / 1000.0);
+
+    // A long run with lots of resets, then a crash
+    session.Start("speedrun/", ltime);
+    for (int load = 0; load < 4000; load++)
+    {
+        host.LoadMap(session, s_Maps[load % mapCount], 1);
+    }
+    const std::string journalPath = std::string(session.GetSessionDir()) + JOURNAL_FILE_NAME;
+    host.m_bRecording = false;
+
+    CDemoRecordSession resumed(host, stats);
+    const uint64_t resumeStart = LatencyNow();
+    resumed.Resume("speedrun/");
+    const uint64_t resumeTime = LatencyNow() - resumeStart;
+    if (resumed.GetDemoNameIndex().GetNextRetry(s_Maps[0]) != session.GetDemoNameIndex().GetNextRetry(s_Maps[0]))
+    {
+        fprintf(stderr, "resume did not restore the demo names\n");
+        return 1;
+    }
+
+    printf("resume     %llu journal bytes in %.2f us\n",
+           (unsigned long long)host.m_Files[journalPath].size(),
+           (double)resumeTime / 1000.0);
+
+    // Every demo but the one the crash interrupted
+    const uint64_t playlistStart = LatencyNow();
+    const PlaylistResult_t playlist = resumed.WritePlaylist(PlaylistOptions_t());
+    const uint64_t playlistTime = LatencyNow() - playlistStart;
+    if (playlist.written != 3999 || playlist.skipped != 1)
+    {
+        fprintf(stderr,
+                "expected 3999 .vdm files and 1 demo left out, got %u and %u\n",
+                playlist.written,
+                playlist.skipped);
+        return 1;
+    }
+
+    printf("playlist   %u .vdm files in %.2f ms\n", playlist.written, (double)playlistTime / 1e6);
+    return 0;
+}
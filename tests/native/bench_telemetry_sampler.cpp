@@ -0,0 +1,72 @@
+//---------------------------------------------------------------------------------
+// Purpose: cost of CTelemetrySampler::Sample on the game thread while the drain thread writes the file
+//
+//  bench_telemetry_sampler [-n samples]
+//
+// The ring is big enough to hold every sample, so the time is that of the push and never of a dropped sample. The file
+// goes to $TMPDIR (or /tmp) and is removed afterwards.
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "latency_stats.h"
+#include "telemetry_sampler.h"
+
+int main(int argc, char** argv)
+{
+    int samples = 200000;
+    if (argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+        samples = atoi(argv[2]);
+    }
+    else if (argc > 1)
+    {
+        samples = 0;
+    }
+
+    if (samples <= 0)
+    {
+        fprintf(stderr, "usage: %s [-n samples]\n", argv[0]);
+        return 2;
+    }
+
+    const char* dir = getenv("TMPDIR");
+    std::string path = dir && *dir ? dir : "/tmp";
+    path += "/bench_telemetry_sampler" TELEMETRY_EXTENSION;
+
+    CTelemetrySampler sampler((size_t)samples);
+    if (!sampler.Start(path.c_str()))
+    {
+        fprintf(stderr, "can't create %s\n", path.c_str());
+        return 1;
+    }
+
+    const uint64_t start = LatencyNow();
+    for (int tick = 0; tick < samples; tick++)
+    {
+        sampler.Sample(tick, tick, 0.015f, TELEMETRY_SIMULATING);
+    }
+    const uint64_t sampleTime = LatencyNow() - start;
+    sampler.Stop();
+
+    TelemetryStats_t stats;
+    sampler.GetStats(stats);
+    remove(path.c_str());
+    if (stats.sampled != (uint64_t)samples || stats.written != (uint64_t)samples)
+    {
+        fprintf(stderr,
+                "expected %d samples, sampled %llu and wrote %llu\n",
+                samples,
+                (unsigned long long)stats.sampled,
+                (unsigned long long)stats.written);
+        return 1;
+    }
+
+    printf("samples    %d\n", samples);
+    printf("time       %.3f ms\n", (double)sampleTime / 1e6);
+    printf("sample     %.1f ns\n", (double)sampleTime / samples);
+    return 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "demo_file.h"
+
+//---------------------------------------------------------------------------------
+// Purpose: builds small hand made demos in memory for the native tests
+//---------------------------------------------------------------------------------
+class CDemoBuilder
+{
+    public:
+    explicit CDemoBuilder(const char* mapName = "d1_canals_06")
+    {
+        demoheader_t header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.demofilestamp, DEMO_HEADER_ID, sizeof(DEMO_HEADER_ID));
+        header.demoprotocol = 3;
+        header.networkprotocol = 7;
+        strncpy(header.mapname, mapName, sizeof(header.mapname) - 1);
+        strncpy(header.gamedirectory, "hl2", sizeof(header.gamedirectory) - 1);
+        Append(&header, sizeof(header));
+    }
+
+    CDemoBuilder& Message(DemoMessageType type, int32_t tick, const std::string& payload = std::string())
+    {
+        uint8_t cmd = (uint8_t)type;
+        Append(&cmd, 1);
+        Append(&tick, sizeof(tick));
+
+        if (type == DEM_SYNCTICK || type == DEM_NOP)
+            return *this;
+
+        if (type == DEM_STOP)
+            return *this;
+
+        if (type == DEM_SIGNON || type == DEM_PACKET)
+        {
+            uint8_t cmdInfo[DEMO_CMDINFO_SIZE] = {};
+            Append(cmdInfo, sizeof(cmdInfo));
+        }
+        else if (type == DEM_USERCMD)
+        {
+            int32_t sequence = tick;
+            Append(&sequence, sizeof(sequence));
+        }
+
+        int32_t length = (int32_t)payload.size();
+        Append(&length, sizeof(length));
+        Append(payload.data(), payload.size());
+        return *this;
+    }
+
+    // A typical recording: signon data, then a packet and usercmd per tick, then stop
+    CDemoBuilder& Typical(int32_t ticks)
+    {
+        Message(DEM_SIGNON, 0, std::string(300, 's'));
+        Message(DEM_DATATABLES, 0, std::string(1000, 'd'));
+        Message(DEM_STRINGTABLES, 0, std::string(500, 't'));
+        Message(DEM_SYNCTICK, 0);
+        for (int32_t tick = 1; tick <= ticks; tick++)
+        {
+            Message(DEM_PACKET, tick, std::string(40 + tick % 7, 'p'));
+            Message(DEM_USERCMD, tick, std::string(12, 'u'));
+        }
+        return Message(DEM_STOP, ticks);
+    }
+
+    const std::vector<uint8_t>& Bytes() const
+    {
+        return m_Bytes;
+    }
+
+    bool WriteTo(const std::string& path) const
+    {
+        FILE* fp = fopen(path.c_str(), "wb");
+        if (!fp)
+            return false;
+        bool ok = fwrite(m_Bytes.data(), 1, m_Bytes.size(), fp) == m_Bytes.size();
+        return fclose(fp) == 0 && ok;
+    }
+
+    private:
+    void Append(const void* data, size_t size)
+    {
+        const uint8_t* p = (const uint8_t*)data;
+        m_Bytes.insert(m_Bytes.end(), p, p + size);
+    }
+
+    std::vector<uint8_t> m_Bytes;
+};
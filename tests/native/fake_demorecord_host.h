@@ -0,0 +1,285 @@
+#pragma once
+
+#include <string.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "demorecord_session.h"
+
+//---------------------------------------------------------------------------------
+// Purpose: in-memory stand-in for the engine and its filesystem. Console commands are queued like the engine's
+// command buffer and run on the next frame, so a record command takes effect a frame after ClientConnect sent it.
+//---------------------------------------------------------------------------------
+class CFakeDemoRecordHost : public IDemoRecordHost
+{
+    public:
+    CFakeDemoRecordHost()
+        : m_bPlayingDemo(false),
+          m_bRecording(false),
+          m_Tick(0),
+          m_RecordStartTick(0),
+          m_Syncs(0),
+          m_SignonFrames(0),
+          m_BlockingFsCalls(0),
+          m_ConnectFsCalls(0),
+          m_bHoldFileJobs(false),
+          m_pSession(NULL),
+          m_bLevelRunning(false),
+          m_FileJobsQueued(0)
+    {
+    }
+
+    // Every demo the fake engine started recording, in order, as written ("<dir><name>.dem")
+    std::vector<std::string> m_RecordedDemos;
+
+    // Files and directories on the fake disk
+    std::map<std::string, std::string> m_Files;
+    std::set<std::string> m_Dirs;
+
+    std::vector<std::pair<std::string, int> > m_RecordStarts;
+
+    // Demos the session sent a stop for
+    std::vector<std::string> m_StoppedDemos;
+    std::vector<std::string> m_StoppedSessions;
+
+    bool m_bPlayingDemo;
+    bool m_bRecording;
+    int m_Tick;
+    int m_RecordStartTick;
+    int m_Syncs;
+
+    // Frames the engine runs (and runs the command buffer in) between ClientConnect and the spawn, 0 spawns before the
+    // record command ClientConnect queued runs
+    int m_SignonFrames;
+
+    // Filesystem calls the plugin makes on the game thread (writes and removals are queued), and how many of them
+    // came from ClientConnect
+    int m_BlockingFsCalls;
+    int m_ConnectFsCalls;
+
+    // QueueRenameFile keeps its renames until RunFileJobs while set, like a file writer thread that is behind
+    bool m_bHoldFileJobs;
+
+    //---------------------------------------------------------------------------------
+    // Purpose: drive the session like the engine does on a map/load/changelevel
+    //---------------------------------------------------------------------------------
+    void LoadMap(CDemoRecordSession& session, const char* mapName, int frames = 2)
+    {
+        m_pSession = &session;
+        if (m_bLevelRunning)
+        {
+            session.OnLevelShutdown();
+            RunCommands();
+        }
+
+        session.OnLevelInit(mapName);
+        const int fsCalls = m_BlockingFsCalls;
+        session.OnClientConnect();
+        m_ConnectFsCalls += m_BlockingFsCalls - fsCalls;
+        m_bLevelRunning = true;
+
+        for (int i = 0; i < m_SignonFrames; i++)
+        {
+            RunFrame(session);
+        }
+
+        // Signon takes a few ticks, without signon frames the player spawns before the queued record command runs
+        m_Tick += 3;
+        session.OnClientActive();
+
+        for (int i = 0; i < frames; i++)
+        {
+            RunFrame(session);
+        }
+    }
+
+    void RunFrame(CDemoRecordSession& session)
+    {
+        m_pSession = &session;
+        m_Tick++;
+        RunCommands();
+        session.OnGameFrame();
+    }
+
+    void RunCommands()
+    {
+        std::vector<std::string> commands;
+        commands.swap(m_Commands);
+        for (size_t i = 0; i < commands.size(); i++)
+        {
+            const std::string& command = commands[i];
+            if (command == "stop")
+            {
+                m_bRecording = false;
+            }
+            else if (command.compare(0, 7, "record ") == 0)
+            {
+                // The engine appends the extension and quietly stops a demo that is still running
+                std::string path = command.substr(7, command.find_first_of("\r\n") - 7) + ".dem";
+                m_Files[path] = "HL2DEMO";
+                m_RecordedDemos.push_back(path);
+                m_bRecording = true;
+                m_RecordStartTick = m_Tick;
+            }
+            else if (command.compare(0, strlen(SEGMENT_ROTATE_COMMAND), SEGMENT_ROTATE_COMMAND) == 0 && m_pSession)
+            {
+                // Registered by the plugin
+                m_pSession->OnRotateAttempt();
+            }
+        }
+    }
+
+    void RunFileJobs()
+    {
+        for (size_t i = 0; i < m_HeldRenames.size(); i++)
+        {
+            MoveFile(m_HeldRenames[i].first, m_HeldRenames[i].second);
+        }
+        m_HeldRenames.clear();
+    }
+
+    // Bare names of the recorded demos, what tests/test_speedrun_demorecord.py compares against
+    std::vector<std::string> GetRecordedDemoNames() const
+    {
+        std::vector<std::string> names;
+        for (size_t i = 0; i < m_RecordedDemos.size(); i++)
+        {
+            const std::string& path = m_RecordedDemos[i];
+            const size_t slash = path.find_last_of("/\\");
+            names.push_back(slash == std::string::npos ? path : path.substr(slash + 1));
+        }
+        return names;
+    }
+
+    //---------------------------------------------------------------------------------
+    // Purpose: IDemoRecordHost
+    //---------------------------------------------------------------------------------
+    virtual bool IsPlayingDemo()
+    {
+        return m_bPlayingDemo;
+    }
+    virtual bool IsRecordingDemo()
+    {
+        return m_bRecording;
+    }
+    virtual void ClientCmd(const char* command)
+    {
+        m_Commands.push_back(command);
+    }
+    virtual int GetServerTick()
+    {
+        return m_Tick;
+    }
+    virtual int GetDemoTick()
+    {
+        return m_bRecording ? m_Tick - m_RecordStartTick : -1;
+    }
+    virtual bool IsDirectory(const char* path)
+    {
+        m_BlockingFsCalls++;
+        return m_Dirs.count(path) != 0;
+    }
+    virtual void CreateDirHierarchy(const char* path)
+    {
+        m_BlockingFsCalls++;
+        m_Dirs.insert(path);
+    }
+    virtual void FindFiles(const char* wildcard, std::vector<std::string>& fileNames)
+    {
+        m_BlockingFsCalls++;
+
+        // Only "<dir>*<suffix>" is used
+        const char* star = strchr(wildcard, '*');
+        const std::string dir(wildcard, star ? (size_t)(star - wildcard) : strlen(wildcard));
+        const std::string suffix(star ? star + 1 : "");
+
+        for (std::map<std::string, std::string>::const_iterator it = m_Files.lower_bound(dir);
+             it != m_Files.end() && it->first.compare(0, dir.size(), dir) == 0;
+             ++it)
+        {
+            const std::string name = it->first.substr(dir.size());
+            if (name.find_first_of("/\\") == std::string::npos && name.size() >= suffix.size() &&
+                name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+            {
+                fileNames.push_back(name);
+            }
+        }
+    }
+    virtual bool ReadFile(const char* path, std::string& contents)
+    {
+        m_BlockingFsCalls++;
+        std::map<std::string, std::string>::const_iterator it = m_Files.find(path);
+        if (it == m_Files.end())
+            return false;
+        contents = it->second;
+        return true;
+    }
+    virtual void WriteFile(const char* path, const void* data, size_t size, bool append, bool sync)
+    {
+        m_Syncs += sync ? 1 : 0;
+        std::string& file = m_Files[path];
+        if (!append)
+        {
+            file.clear();
+        }
+        file.append((const char*)data, size);
+    }
+    virtual void RemoveFile(const char* path)
+    {
+        m_Files.erase(path);
+    }
+    virtual bool RenameFile(const char* from, const char* to)
+    {
+        m_BlockingFsCalls++;
+        return MoveFile(from, to);
+    }
+    virtual void QueueRenameFile(const char* from, const char* to)
+    {
+        m_FileJobsQueued++;
+        m_HeldRenames.push_back(std::make_pair(std::string(from), std::string(to)));
+        if (!m_bHoldFileJobs)
+        {
+            RunFileJobs();
+        }
+    }
+    virtual uint64_t GetFileJobTicket()
+    {
+        return m_FileJobsQueued;
+    }
+    virtual bool IsFileJobDone(uint64_t ticket)
+    {
+        return m_FileJobsQueued - m_HeldRenames.size() >= ticket;
+    }
+    virtual void OnRecordingStarted(const char* demoName, int ticksAfterSpawn)
+    {
+        m_RecordStarts.push_back(std::make_pair(std::string(demoName), ticksAfterSpawn));
+    }
+    virtual void OnDemoStopped(const char* demoPath)
+    {
+        m_StoppedDemos.push_back(demoPath);
+    }
+    virtual void OnSessionStopped(const char* sessionDir)
+    {
+        m_StoppedSessions.push_back(sessionDir);
+    }
+
+    private:
+    bool MoveFile(const std::string& from, const std::string& to)
+    {
+        std::map<std::string, std::string>::iterator it = m_Files.find(from);
+        if (it == m_Files.end())
+            return false;
+        const std::string contents = it->second;
+        m_Files.erase(it);
+        m_Files[to] = contents;
+        return true;
+    }
+
+    std::vector<std::string> m_Commands;
+    std::vector<std::pair<std::string, std::string> > m_HeldRenames;
+    CDemoRecordSession* m_pSession;
+    bool m_bLevelRunning;
+    uint64_t m_FileJobsQueued;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Tiny self-registering test runner for the SDK-free parts of the plugin. Each test_*.cpp in this directory is its
+// own executable and registered with ctest in the top level CMakeLists.txt.
+
+typedef void (*NativeTestFn)();
+
+struct NativeTestCase_t
+{
+    const char* name;
+    NativeTestFn fn;
+};
+
+inline std::vector<NativeTestCase_t>& GetNativeTests()
+{
+    static std::vector<NativeTestCase_t> s_Tests;
+    return s_Tests;
+}
+
+inline int& GetNativeTestFailures()
+{
+    static int s_Failures = 0;
+    return s_Failures;
+}
+
+struct CNativeTestRegistrar
+{
+    CNativeTestRegistrar(const char* name, NativeTestFn fn)
+    {
+        NativeTestCase_t test = {name, fn};
+        GetNativeTests().push_back(test);
+    }
+};
+
+#define TEST_CASE(name)                                                \
+    static void name();                                                \
+    static CNativeTestRegistrar name##_registrar(#name, name);         \
+    static void name()
+
+#define TEST_CHECK(expr)                                                          \
+    do                                                                            \
+    {                                                                             \
+        if (!(expr))                                                              \
+        {                                                                         \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+            GetNativeTestFailures()++;                                            \
+        }                                                                         \
+    } while (0)
+
+#define TEST_CHECK_EQ(a, b)                                                                   \
+    do                                                                                        \
+    {                                                                                         \
+        if (!((a) == (b)))                                                                    \
+        {                                                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s == %s\n", __FILE__, __LINE__, #a, #b); \
+            GetNativeTestFailures()++;                                                        \
+        }                                                                                     \
+    } while (0)
+
+// Scratch location for tests that need real files, removed by the caller
+inline std::string GetNativeTestTempPath(const char* name)
+{
+    const char* dir = getenv("TMPDIR");
+    std::string path = dir && *dir ? dir : "/tmp";
+    path += "/speedrun_demorecord_";
+    path += name;
+    return path;
+}
+
+int main()
+{
+    std::vector<NativeTestCase_t>& tests = GetNativeTests();
+    for (size_t i = 0; i < tests.size(); i++)
+    {
+        const int failuresBefore = GetNativeTestFailures();
+        tests[i].fn();
+        printf("[%s] %s\n", GetNativeTestFailures() == failuresBefore ? "PASS" : "FAIL", tests[i].name);
+    }
+
+    if (GetNativeTestFailures() != 0)
+    {
+        printf("%d check(s) failed\n", GetNativeTestFailures());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include "async_file_writer.h"
+#include "latency_stats.h"
+#include "mpsc_queue.h"
+#include "native_test.h"
+
+static std::string ReadWholeFile(const std::string& path)
+{
+    std::string contents;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return "<missing>";
+
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        contents.append(buffer, read);
+    }
+    fclose(file);
+    return contents;
+}
+
+static bool FileExists(const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file)
+    {
+        fclose(file);
+    }
+    return file != NULL;
+}
+
+TEST_CASE(QueueKeepsPerProducerOrder)
+{
+    const int producers = 4;
+    const int perProducer = 20000;
+    CBoundedMpscQueue<int> queue(64);
+    TEST_CHECK_EQ(queue.GetCapacity(), 64u);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++)
+    {
+        threads.push_back(std::thread([&queue, p] {
+            for (int i = 0; i < perProducer; i++)
+            {
+                int value = p * perProducer + i;
+                while (!queue.Push(value))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+
+    std::vector<int> next(producers, 0);
+    int received = 0;
+    bool ordered = true;
+    while (received < producers * perProducer)
+    {
+        int value;
+        if (!queue.Pop(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        const int p = value / perProducer;
+        ordered = ordered && value % perProducer == next[p];
+        next[p]++;
+        received++;
+    }
+
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+
+    int value;
+    TEST_CHECK(ordered);
+    TEST_CHECK(!queue.Pop(value));
+}
+
+TEST_CASE(QueueRejectsWhenFull)
+{
+    CBoundedMpscQueue<int> queue(3);
+    TEST_CHECK_EQ(queue.GetCapacity(), 4u);
+
+    for (int i = 0; i < 4; i++)
+    {
+        TEST_CHECK(queue.Push(i));
+    }
+    int value = 4;
+    TEST_CHECK(!queue.Push(value));
+
+    TEST_CHECK(queue.Pop(value));
+    TEST_CHECK_EQ(value, 0);
+    value = 4;
+    TEST_CHECK(queue.Push(value));
+}
+
+TEST_CASE(WritesAppendsAndRemovesInOrder)
+{
+    const std::string root = GetNativeTestTempPath("async_writer") + "/";
+
+    CAsyncFileWriter writer;
+    writer.Start(root.c_str());
+
+    // Parent directories are created on demand
+    TEST_CHECK(writer.Write("session/resume.txt", "first", 5));
+    TEST_CHECK(writer.Write("session/resume.txt", "second", 6, FILEJOB_FLAG_SYNC));
+    for (int i = 0; i < 100; i++)
+    {
+        char line[32];
+        const int length = snprintf(line, sizeof(line), "bookmark %d\n", i);
+        TEST_CHECK(writer.Append("session/bookmarks.txt", line, (size_t)length));
+    }
+    TEST_CHECK(writer.Write("session/gone.txt", "x", 1));
+    TEST_CHECK(writer.Remove("session/gone.txt"));
+    writer.Flush();
+
+    TEST_CHECK_EQ(ReadWholeFile(root + "session/resume.txt"), "second");
+    std::string bookmarks = ReadWholeFile(root + "session/bookmarks.txt");
+    TEST_CHECK(bookmarks.compare(0, 11, "bookmark 0\n") == 0);
+    TEST_CHECK(bookmarks.find("bookmark 99\n") != std::string::npos);
+    TEST_CHECK(!FileExists(root + "session/gone.txt"));
+
+    AsyncWriterStats_t stats;
+    writer.GetStats(stats);
+    TEST_CHECK_EQ(stats.queued, 104u);
+    TEST_CHECK_EQ(stats.written, 104u);
+    TEST_CHECK_EQ(stats.failed, 0u);
+    TEST_CHECK_EQ(stats.dropped, 0u);
+    TEST_CHECK_EQ(stats.depth, 0u);
+    TEST_CHECK(stats.maxDepth >= 1u);
+
+    std::string json;
+    writer.FormatJson(json);
+    CLatencyStats latency;
+    std::string dump;
+    latency.FormatJson(dump, json.c_str());
+    TEST_CHECK(dump.find("\"writer\": {\"queued\": 104, \"written\": 104") != std::string::npos);
+
+    writer.Shutdown();
+    remove((root + "session/resume.txt").c_str());
+    remove((root + "session/bookmarks.txt").c_str());
+}
+
+TEST_CASE(RenamesAfterTheJobsBeforeIt)
+{
+    const std::string root = GetNativeTestTempPath("async_writer_rename") + "/";
+
+    // Queued before Start, so the ticket can't be done before the writer ran
+    CAsyncFileWriter writer;
+    TEST_CHECK(writer.Write("attempt.dem", "attempt 2", 9));
+    TEST_CHECK(writer.Write("attempt_slot1.dem", "attempt 1", 9));
+    TEST_CHECK(writer.Rename("attempt.dem", "attempt_slot1.dem"));
+    TEST_CHECK(writer.Rename("missing.dem", "attempt.dem"));
+    const uint64_t ticket = writer.GetTicket();
+    TEST_CHECK(!writer.IsDone(ticket));
+
+    writer.Start(root.c_str());
+    writer.Flush();
+    TEST_CHECK(writer.IsDone(ticket));
+
+    // Replaced the slot, and nothing to move isn't a failure
+    TEST_CHECK_EQ(ReadWholeFile(root + "attempt_slot1.dem"), "attempt 2");
+    TEST_CHECK(!FileExists(root + "attempt.dem"));
+
+    AsyncWriterStats_t stats;
+    writer.GetStats(stats);
+    TEST_CHECK_EQ(stats.written, 4u);
+    TEST_CHECK_EQ(stats.failed, 0u);
+    TEST_CHECK_EQ(stats.bytes, 18u);
+
+    writer.Shutdown();
+    remove((root + "attempt_slot1.dem").c_str());
+}
+
+TEST_CASE(BatchesAppendsToTheSameFile)
+{
+    const std::string root = GetNativeTestTempPath("async_writer_batch") + "/";
+
+    // Queued before Start so the writer finds them all waiting
+    CAsyncFileWriter writer;
+    for (int i = 0; i < 10; i++)
+    {
+        TEST_CHECK(writer.Append("journal.bin", "0123456789", 10, FILEJOB_FLAG_SYNC));
+    }
+    TEST_CHECK(writer.Write("other.txt", "x", 1));
+    TEST_CHECK(writer.Append("journal.bin", "tail", 4, FILEJOB_FLAG_SYNC));
+
+    writer.Start(root.c_str());
+    writer.Flush();
+
+    TEST_CHECK_EQ(ReadWholeFile(root + "journal.bin").size(), 104u);
+    TEST_CHECK_EQ(ReadWholeFile(root + "other.txt"), "x");
+
+    AsyncWriterStats_t stats;
+    writer.GetStats(stats);
+    TEST_CHECK_EQ(stats.written, 12u);
+    TEST_CHECK_EQ(stats.syncs, 2u);
+
+    writer.Shutdown();
+    remove((root + "journal.bin").c_str());
+    remove((root + "other.txt").c_str());
+}
+
+TEST_CASE(DropsWhenQueueIsFull)
+{
+    const std::string root = GetNativeTestTempPath("async_writer_full") + "/";
+
+    // Not started yet, nothing drains the queue
+    CAsyncFileWriter writer(4);
+    for (int i = 0; i < 4; i++)
+    {
+        TEST_CHECK(writer.Append("full.txt", "a", 1));
+    }
+    TEST_CHECK(!writer.Append("full.txt", "b", 1));
+
+    AsyncWriterStats_t stats;
+    writer.GetStats(stats);
+    TEST_CHECK_EQ(stats.dropped, 1u);
+    TEST_CHECK_EQ(stats.depth, 4u);
+
+    // Jobs queued before Start are written once it runs
+    writer.Start(root.c_str());
+    writer.Flush();
+    TEST_CHECK_EQ(ReadWholeFile(root + "full.txt"), "aaaa");
+    writer.Shutdown();
+    remove((root + "full.txt").c_str());
+}
+
+TEST_CASE(ReportsFailedJobs)
+{
+    CAsyncFileWriter writer;
+    writer.Start("/dev/null/");
+    TEST_CHECK(writer.Write("cannot/exist.txt", "x", 1));
+    writer.Shutdown();
+
+    AsyncWriterStats_t stats;
+    writer.GetStats(stats);
+    TEST_CHECK_EQ(stats.failed, 1u);
+    TEST_CHECK_EQ(stats.written, 0u);
+}
+
+TEST_CASE(ProducersNeverWaitForTheDisk)
+{
+    const std::string root = GetNativeTestTempPath("async_writer_threads") + "/";
+    CAsyncFileWriter writer;
+    writer.Start(root.c_str());
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.push_back(std::thread([&writer] {
+            for (int i = 0; i < 200; i++)
+            {
+                writer.Append("threads.txt", "0123456789", 10);
+            }
+        }));
+    }
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+    writer.Flush();
+
+    AsyncWriterStats_t stats;
+    writer.GetStats(stats);
+    TEST_CHECK_EQ(ReadWholeFile(root + "threads.txt").size(), (size_t)(stats.written * 10));
+    TEST_CHECK_EQ(stats.written + stats.dropped, 800u);
+    writer.Shutdown();
+    remove((root + "threads.txt").c_str());
+}
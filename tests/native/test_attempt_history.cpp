@@ -0,0 +1,155 @@
+#include <string.h>
+
+#include "attempt_history.h"
+#include "native_test.h"
+
+// Attempt numbers of mapName by slot, 0 for a free slot, the canonical one last
+static std::vector<uint32_t> GetSlots(CAttemptHistory& history, const char* mapName, uint32_t keep)
+{
+    std::vector<uint32_t> slots(keep + 1, 0);
+    std::vector<attemptrecord_t> attempts;
+    history.GetAttempts(mapName, attempts);
+    for (size_t i = 0; i < attempts.size(); i++)
+    {
+        slots[attempts[i].slot == ATTEMPT_CANONICAL ? keep : attempts[i].slot] = attempts[i].attempt;
+    }
+    return slots;
+}
+
+TEST_CASE(RotationIsARing)
+{
+    CAttemptHistory history;
+    std::vector<uint32_t> dropped;
+
+    history.BeginAttempt("testchmb_a_00", 100);
+    for (int i = 0; i < 4; i++)
+    {
+        TEST_CHECK_EQ(history.Rotate("testchmb_a_00", 3, dropped), (uint32_t)(i % 3));
+        history.BeginAttempt("testchmb_a_00", 101 + i);
+    }
+    TEST_CHECK(dropped.empty());
+
+    const uint32_t expected[] = {4, 2, 3, 5};
+    TEST_CHECK(GetSlots(history, "testchmb_a_00", 3) == std::vector<uint32_t>(expected, expected + 4));
+    TEST_CHECK_EQ(history.Size(), 4u);
+    TEST_CHECK_EQ(history.FindCanonical("testchmb_a_00")->startTime, 104);
+
+    // Other maps have their own slots and numbers
+    history.BeginAttempt("testchmb_a_01", 200);
+    TEST_CHECK_EQ(history.GetRotateSlot("testchmb_a_01", 3), 0u);
+    TEST_CHECK_EQ(history.FindCanonical("testchmb_a_01")->attempt, 1u);
+
+    std::vector<attemptrecord_t> all;
+    history.GetAttempts(NULL, all);
+    TEST_CHECK_EQ(all.size(), 5u);
+    TEST_CHECK_EQ(strcmp(all.back().mapName, "testchmb_a_01"), 0);
+}
+
+TEST_CASE(UntrackedDemoGetsARecord)
+{
+    // <map>.dem from before the index
+    CAttemptHistory history;
+    std::vector<uint32_t> dropped;
+    TEST_CHECK_EQ(history.Rotate("d1_canals_06", 2, dropped), 0u);
+
+    const attemptrecord_t* record = history.Find("d1_canals_06", 1);
+    TEST_CHECK(record != NULL);
+    TEST_CHECK_EQ(record->slot, 0u);
+    TEST_CHECK_EQ(record->ticks, -1);
+    TEST_CHECK(history.FindCanonical("d1_canals_06") == NULL);
+}
+
+TEST_CASE(LoweredKeepDropsSlots)
+{
+    CAttemptHistory history;
+    std::vector<uint32_t> dropped;
+    for (int i = 0; i < 5; i++)
+    {
+        history.BeginAttempt("d1_canals_06", 0);
+        history.Rotate("d1_canals_06", 4, dropped);
+    }
+    TEST_CHECK(dropped.empty());
+
+    // Slots 0-3 hold 5, 2, 3, 4, keeping 2 leaves the newest of 0 and 1
+    history.BeginAttempt("d1_canals_06", 0);
+    TEST_CHECK_EQ(history.GetRotateSlot("d1_canals_06", 2), 1u);
+    TEST_CHECK_EQ(history.Rotate("d1_canals_06", 2, dropped), 1u);
+    TEST_CHECK_EQ(dropped.size(), 2u);
+    TEST_CHECK_EQ(dropped[0], 2u);
+    TEST_CHECK_EQ(dropped[1], 3u);
+
+    const uint32_t expected[] = {5, 6, 0};
+    TEST_CHECK(GetSlots(history, "d1_canals_06", 2) == std::vector<uint32_t>(expected, expected + 3));
+}
+
+TEST_CASE(PromoteSwapsSlots)
+{
+    CAttemptHistory history;
+    std::vector<uint32_t> dropped;
+    for (int i = 0; i < 3; i++)
+    {
+        history.BeginAttempt("d1_canals_06", 0);
+        history.Rotate("d1_canals_06", 2, dropped);
+    }
+    history.BeginAttempt("d1_canals_06", 0);
+
+    // 3, 2 and 4 as the demo
+    history.Promote("d1_canals_06", 2, true);
+    const uint32_t expected[] = {3, 4, 2};
+    TEST_CHECK(GetSlots(history, "d1_canals_06", 2) == std::vector<uint32_t>(expected, expected + 3));
+
+    // The oldest one still goes first, not the one that was swapped out
+    TEST_CHECK_EQ(history.GetRotateSlot("d1_canals_06", 2), 0u);
+
+    // The demo was gone, its record goes with it
+    history.Promote("d1_canals_06", 3, false);
+    const uint32_t promoted[] = {0, 4, 3};
+    TEST_CHECK(GetSlots(history, "d1_canals_06", 2) == std::vector<uint32_t>(promoted, promoted + 3));
+    TEST_CHECK(history.Find("d1_canals_06", 2) == NULL);
+
+    // No demo was tracked, the one that was there gets a record
+    CAttemptHistory untracked;
+    untracked.Rotate("d1_canals_06", 2, dropped);
+    untracked.Promote("d1_canals_06", 1, true);
+    TEST_CHECK_EQ(untracked.Find("d1_canals_06", 1)->slot, ATTEMPT_CANONICAL);
+    TEST_CHECK_EQ(untracked.Find("d1_canals_06", 2)->slot, 0u);
+}
+
+TEST_CASE(IndexRoundTrips)
+{
+    CAttemptHistory history;
+    std::vector<uint32_t> dropped;
+    history.BeginAttempt("d1_canals_06", 1700000000).ticks = 1234;
+    history.Rotate("d1_canals_06", 2, dropped);
+    history.BeginAttempt("d1_canals_06", 1700000100).durationMs = 5678;
+
+    std::string contents;
+    history.Save(contents);
+    TEST_CHECK_EQ(contents.size(), sizeof(attemptindexheader_t) + 2 * sizeof(attemptrecord_t));
+
+    CAttemptHistory loaded;
+    TEST_CHECK(loaded.Load(contents));
+    TEST_CHECK_EQ(loaded.Size(), 2u);
+    TEST_CHECK_EQ(loaded.Find("d1_canals_06", 1)->ticks, 1234);
+    TEST_CHECK_EQ(loaded.Find("d1_canals_06", 1)->startTime, 1700000000);
+    TEST_CHECK_EQ(loaded.FindCanonical("d1_canals_06")->durationMs, 5678u);
+
+    // Damaged or cut short
+    std::string damaged = contents;
+    damaged[sizeof(attemptindexheader_t) + 3] ^= 0x20;
+    TEST_CHECK(!loaded.Load(damaged));
+    TEST_CHECK_EQ(loaded.Size(), 0u);
+    TEST_CHECK(!loaded.Load(contents.substr(0, contents.size() - 1)));
+    TEST_CHECK(!loaded.Load(""));
+
+    CAttemptHistory empty;
+    empty.Save(contents);
+    TEST_CHECK(loaded.Load(contents));
+    TEST_CHECK_EQ(loaded.Size(), 0u);
+}
+
+TEST_CASE(SlotDemoNames)
+{
+    TEST_CHECK_EQ(CAttemptHistory::GetSlotDemoName("d1_canals_06", 0), "d1_canals_06_slot1");
+    TEST_CHECK_EQ(CAttemptHistory::GetSlotDemoName("d1_canals_06", 11), "d1_canals_06_slot12");
+}
@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "bookmark_store.h"
+#include "native_test.h"
+
+static struct tm MakeLocalTime(int minute)
+{
+    struct tm ltime;
+    memset(&ltime, 0, sizeof(ltime));
+    ltime.tm_year = 2024;
+    ltime.tm_mon = 3;
+    ltime.tm_mday = 14;
+    ltime.tm_hour = 15;
+    ltime.tm_min = minute;
+    ltime.tm_sec = 26;
+    return ltime;
+}
+
+static std::string MakeBookmarks(const char* session, int count)
+{
+    std::string file;
+    for (int i = 0; i < count; i++)
+    {
+        bookmarkrecord_t record;
+        BuildBookmarkRecord(record,
+                            session,
+                            i % 2 ? "d1_canals_06" : "d1_canals_07",
+                            i % 2 ? "d1_canals_06_1" : "d1_canals_07",
+                            i % 3 == 0 ? "clip" : "",
+                            1710428966 + i,
+                            MakeLocalTime(i % 60),
+                            100 + i,
+                            5000 + i);
+        file.append((const char*)&record, sizeof(record));
+    }
+    return file;
+}
+
+TEST_CASE(RecordsRoundTrip)
+{
+    bookmarkrecord_t record;
+    BuildBookmarkRecord(record,
+                        "2024.03.14-15.09.26",
+                        "d1_canals_06",
+                        "d1_canals_06_2",
+                        "skip",
+                        1710428966,
+                        MakeLocalTime(9),
+                        1234,
+                        56789);
+    TEST_CHECK(IsValidBookmarkRecord(record));
+    TEST_CHECK_EQ(record.tick, 1234);
+    TEST_CHECK_EQ(record.serverTick, 56789);
+    TEST_CHECK_EQ(record.year, 2024);
+    TEST_CHECK_EQ(record.minute, 9);
+    TEST_CHECK(strcmp(record.demoName, "d1_canals_06_2") == 0);
+    TEST_CHECK(strcmp(record.tag, "skip") == 0);
+
+    bookmarkrecord_t corrupt = record;
+    corrupt.tick ^= 4;
+    TEST_CHECK(!IsValidBookmarkRecord(corrupt));
+
+    // Overlong names are cut, not overflowed
+    const std::string longName(200, 'a');
+    BuildBookmarkRecord(record,
+                        longName.c_str(),
+                        longName.c_str(),
+                        longName.c_str(),
+                        longName.c_str(),
+                        0,
+                        MakeLocalTime(0),
+                        0,
+                        0);
+    TEST_CHECK(IsValidBookmarkRecord(record));
+    TEST_CHECK_EQ(strlen(record.tag), (size_t)(BOOKMARK_TAG_SIZE - 1));
+
+    // Same text the command used to append, the tag on a line of its own
+    std::string text;
+    BuildBookmarkRecord(record, "s", "d1_canals_06", "d1_canals_06_2", "", 0, MakeLocalTime(9), 1234, 0);
+    FormatBookmarkText(record, "speedrun/2024.03.14-15.09.26/", text);
+    TEST_CHECK_EQ(text, std::string("[2024/03/14 15:09] demo: speedrun/2024.03.14-15.09.26/d1_canals_06_2\r\n"
+                                    "\t\t   tick: 1234\r\n"));
+    text.clear();
+    BuildBookmarkRecord(record, "s", "d1_canals_06", "d1_canals_06_2", "skip", 0, MakeLocalTime(9), 1234, 0);
+    FormatBookmarkText(record, "", text);
+    TEST_CHECK(text.find("\t\t   tag: skip\r\n") != std::string::npos);
+}
+
+TEST_CASE(TornTailLosesOneBookmark)
+{
+    std::string file = MakeBookmarks("a", 5);
+    file.append(file.data(), 100);
+
+    std::vector<bookmarkrecord_t> records;
+    BookmarkReadResult_t result = ReadBookmarks(file.data(), file.size(), records);
+    TEST_CHECK(result.torn);
+    TEST_CHECK_EQ(result.validBytes, 5u * BOOKMARK_RECORD_SIZE);
+    TEST_CHECK_EQ(records.size(), 5u);
+
+    records.clear();
+    result = ReadBookmarks(file.data(), 5 * BOOKMARK_RECORD_SIZE, records);
+    TEST_CHECK(!result.torn);
+}
+
+TEST_CASE(CatalogListsEachSessionOnce)
+{
+    std::vector<std::string> sessions;
+    ParseBookmarkCatalog("2024.03.14-15.09.26\r\n.\n\n2024.03.14-15.09.26\n2024.03.15-10.00.00", sessions);
+    TEST_CHECK_EQ(sessions.size(), 3u);
+    TEST_CHECK_EQ(sessions[0], "2024.03.14-15.09.26");
+    TEST_CHECK_EQ(sessions[1], BOOKMARK_SEGMENT_SESSION);
+    TEST_CHECK_EQ(sessions[2], "2024.03.15-10.00.00");
+}
+
+TEST_CASE(QueriesBySessionMapAndTag)
+{
+    CBookmarkStore store;
+    std::string a = MakeBookmarks("a", 6);
+    std::string b = MakeBookmarks("b", 4);
+    store.AddFile("speedrun/a/", a.data(), a.size());
+    store.AddFile("speedrun/b/", b.data(), b.size());
+    TEST_CHECK_EQ(store.Size(), 10u);
+    TEST_CHECK(store.HasSession("b"));
+    TEST_CHECK(!store.HasSession("c"));
+    TEST_CHECK_EQ(strcmp(store.GetLastSession(), "a"), 0);
+
+    std::vector<uint32_t> ids;
+    BookmarkQuery_t query;
+    store.Find(query, ids);
+    TEST_CHECK_EQ(ids.size(), 10u);
+
+    ids.clear();
+    query.session = "b";
+    store.Find(query, ids);
+    TEST_CHECK_EQ(ids.size(), 4u);
+    TEST_CHECK_EQ(ids[0], 6u);
+    TEST_CHECK_EQ(store.GetSessionDir(ids[0]), "speedrun/b/");
+
+    // Every field named has to match, in the order the bookmarks were made
+    ids.clear();
+    query.session = NULL;
+    query.tag = "clip";
+    store.Find(query, ids);
+    TEST_CHECK_EQ(ids.size(), 4u);
+    ids.clear();
+    query.mapName = "d1_canals_06";
+    store.Find(query, ids);
+    TEST_CHECK_EQ(ids.size(), 2u);
+    TEST_CHECK_EQ(ids[0], 3u);
+    TEST_CHECK_EQ(ids[1], 9u);
+
+    ids.clear();
+    query.mapName = "d3_breen_01";
+    store.Find(query, ids);
+    TEST_CHECK(ids.empty());
+
+    std::string text;
+    ids.assign(1, 3u);
+    store.FormatText(ids, text);
+    TEST_CHECK(text.find("demo: speedrun/a/d1_canals_06_1\r\n\t\t   tick: 103\r\n\t\t   tag: clip") !=
+               std::string::npos);
+}
+
+TEST_CASE(FindsInYearsOfBookmarksQuickly)
+{
+    // A few bookmarks in each of a few thousand sessions, one tag is rare
+    CBookmarkStore store;
+    char session[32];
+    for (int i = 0; i < 5000; i++)
+    {
+        snprintf(session, sizeof(session), "s%04d", i);
+        const std::string file = MakeBookmarks(session, 20);
+        store.AddFile(std::string("speedrun/") + session + "/", file.data(), file.size());
+    }
+    bookmarkrecord_t record;
+    BuildBookmarkRecord(record, "s4999", "d3_breen_01", "d3_breen_01", "wr", 0, MakeLocalTime(0), 1, 1);
+    store.Add("speedrun/s4999/", record);
+
+    std::vector<uint32_t> ids;
+    BookmarkQuery_t query;
+    query.tag = "wr";
+    query.mapName = "d3_breen_01";
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 100; i++)
+    {
+        ids.clear();
+        store.Find(query, ids);
+    }
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    TEST_CHECK_EQ(ids.size(), 1u);
+    TEST_CHECK_EQ(ids[0], 100000u);
+
+    // Generous, debug builds on a loaded CI machine included
+    TEST_CHECK(ms / 100 < 1.0);
+}
@@ -0,0 +1,235 @@
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#include "column_store.h"
+#include "native_test.h"
+
+// 1000 rows per block so a few thousand rows cover every encoding and a partial last block
+#define TEST_BLOCK_ROWS 1000
+#define TEST_ROWS 4500
+
+static bool WriteTestFile(const std::string& path)
+{
+    CColumnWriter writer(TEST_BLOCK_ROWS);
+    if (!writer.Open(path.c_str()))
+        return false;
+
+    const int tick = writer.AddColumn("tick", COLTYPE_INT32);
+    const int map = writer.AddColumn("map", COLTYPE_UINT32);
+    const int yaw = writer.AddColumn("yaw", COLTYPE_FLOAT32);
+    const int mouse = writer.AddColumn("mousedx", COLTYPE_INT16);
+    TEST_CHECK_EQ(writer.AddColumn("tick", COLTYPE_INT8), -1);
+    TEST_CHECK_EQ(writer.AddColumn("a_name_that_is_far_too_long_for_a_column", COLTYPE_INT8), -1);
+
+    const uint32_t canals = writer.AddString("d1_canals_06");
+    const uint32_t eli = writer.AddString("d1_eli_01");
+    TEST_CHECK_EQ(writer.AddString("d1_canals_06"), canals);
+
+    // Ticks count up (delta), the map changes once (rle), yaw is noise (plain), mouse is mostly still
+    std::vector<int32_t> ticks;
+    for (int32_t i = 0; i < TEST_ROWS; i++)
+    {
+        ticks.push_back(1000 + i);
+    }
+    writer.Append(tick, ticks.data(), 1234);
+    writer.Append(tick, ticks.data() + 1234, TEST_ROWS - 1234);
+
+    uint32_t seed = 1;
+    for (int i = 0; i < TEST_ROWS; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        writer.AppendInt(map, i < 2500 ? canals : eli);
+        writer.AppendFloat(yaw, (float)(seed % 36000) / 100.0f);
+        writer.AppendInt(mouse, i % 100 == 0 ? -5 : 0);
+    }
+
+    // No new columns once there are rows
+    TEST_CHECK_EQ(writer.AddColumn("late", COLTYPE_INT8), -1);
+    return writer.Close();
+}
+
+TEST_CASE(RoundTripsEveryEncoding)
+{
+    const std::string path = GetNativeTestTempPath("columns.stc");
+    TEST_CHECK(WriteTestFile(path));
+
+    CColumnReader reader;
+    TEST_CHECK(reader.Open(path.c_str()));
+    TEST_CHECK_EQ(reader.GetRowCount(), (uint64_t)TEST_ROWS);
+    TEST_CHECK_EQ(reader.GetColumnCount(), 4u);
+    TEST_CHECK_EQ(reader.GetStringCount(), 2u);
+    TEST_CHECK_EQ(reader.GetString(1), "d1_eli_01");
+    TEST_CHECK_EQ(reader.FindColumn("yaw"), 2);
+    TEST_CHECK_EQ(reader.FindColumn("pitch"), -1);
+
+    const int tick = reader.FindColumn("tick");
+    TEST_CHECK_EQ(reader.GetBlockCount((size_t)tick), 5u);
+    TEST_CHECK_EQ(reader.GetBlock((size_t)tick, 0).encoding, COLENC_DELTA);
+    TEST_CHECK_EQ(reader.GetBlock((size_t)tick, 0).deltaWidth, 1);
+    TEST_CHECK_EQ(reader.GetBlock((size_t)tick, 4).rows, 500u);
+    TEST_CHECK(reader.GetBlock((size_t)tick, 1).minValue == 2000.0);
+    TEST_CHECK(reader.GetBlock((size_t)tick, 1).maxValue == 2999.0);
+    TEST_CHECK_EQ(reader.GetBlock(1, 0).encoding, COLENC_RLE);
+    TEST_CHECK_EQ(reader.GetBlock(2, 0).encoding, COLENC_PLAIN);
+    TEST_CHECK_EQ(reader.GetBlock(3, 0).encoding, COLENC_RLE);
+
+    std::vector<double> values;
+    TEST_CHECK(reader.ReadColumn((size_t)tick, values));
+    TEST_CHECK_EQ(values.size(), (size_t)TEST_ROWS);
+    bool bTicksMatch = true;
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        bTicksMatch = bTicksMatch && values[i] == (double)(1000 + i);
+    }
+    TEST_CHECK(bTicksMatch);
+
+    TEST_CHECK(reader.ReadColumn(1, values));
+    TEST_CHECK(values[2499] == 0.0 && values[2500] == 1.0);
+    TEST_CHECK(reader.ReadColumn(3, values));
+    TEST_CHECK(values[0] == -5.0 && values[1] == 0.0 && values[4400] == -5.0);
+
+    TEST_CHECK(reader.ReadColumn(2, values));
+    uint32_t seed = 1;
+    bool bYawMatches = true;
+    for (int i = 0; i < TEST_ROWS; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        bYawMatches = bYawMatches && values[(size_t)i] == (double)((float)(seed % 36000) / 100.0f);
+    }
+    TEST_CHECK(bYawMatches);
+
+    // Plain blocks are read where they are
+    std::vector<uint8_t> scratch;
+    TEST_CHECK(reader.ReadBlock(2, 1, scratch) != NULL);
+    TEST_CHECK(scratch.empty());
+    reader.Close();
+    remove(path.c_str());
+}
+
+TEST_CASE(ScansUseTheBlockStats)
+{
+    const std::string path = GetNativeTestTempPath("columns_scan.stc");
+    TEST_CHECK(WriteTestFile(path));
+    CColumnReader reader;
+    TEST_CHECK(reader.Open(path.c_str()));
+
+    // Ticks 2500 to 4499: half of block 1 and 3 decoded, block 2 from stats, blocks 0 and 4 skipped
+    ColumnScan_t scan;
+    TEST_CHECK(reader.ScanColumn(0, 2500.0, 4499.0, scan));
+    TEST_CHECK_EQ(scan.rows, (uint64_t)TEST_ROWS);
+    TEST_CHECK_EQ(scan.matches, 2000u);
+    TEST_CHECK(scan.sum == (2500.0 + 4499.0) * 1000.0);
+    TEST_CHECK(scan.minValue == 2500.0);
+    TEST_CHECK(scan.maxValue == 4499.0);
+    TEST_CHECK_EQ(scan.blocksSkipped, 2u);
+    TEST_CHECK_EQ(scan.blocksFromStats, 1u);
+    TEST_CHECK_EQ(scan.blocksDecoded, 2u);
+
+    // Fractional bounds on an integer column
+    TEST_CHECK(reader.ScanColumn(0, 1000.5, 1002.5, scan));
+    TEST_CHECK_EQ(scan.matches, 2u);
+
+    TEST_CHECK(reader.ScanColumn(3, -10.0, -1.0, scan));
+    TEST_CHECK_EQ(scan.matches, 45u);
+    TEST_CHECK(scan.sum == -225.0);
+
+    // Outside of what the type can hold
+    TEST_CHECK(reader.ScanColumn(3, 40000.0, 50000.0, scan));
+    TEST_CHECK_EQ(scan.matches, 0u);
+
+    TEST_CHECK(reader.ScanColumn(2, 90.0, 180.0, scan));
+    TEST_CHECK(scan.matches > 1000u && scan.matches < 1500u);
+    TEST_CHECK(scan.minValue >= 90.0 && scan.maxValue <= 180.0);
+
+    std::vector<uint64_t> rows;
+    TEST_CHECK(reader.FilterColumn(3, -5.0, -5.0, rows));
+    TEST_CHECK_EQ(rows.size(), 45u);
+    TEST_CHECK_EQ(rows[0], 0u);
+    TEST_CHECK_EQ(rows[44], 4400u);
+
+    rows.clear();
+    TEST_CHECK(reader.FilterColumn(1, 1.0, 1.0, rows));
+    TEST_CHECK_EQ(rows.size(), 2000u);
+    TEST_CHECK_EQ(rows[0], 2500u);
+    reader.Close();
+    remove(path.c_str());
+}
+
+TEST_CASE(EscapesDeltasThatDontFit)
+{
+    const std::string path = GetNativeTestTempPath("columns_delta.stc");
+    CColumnWriter writer(TEST_BLOCK_ROWS);
+    TEST_CHECK(writer.Open(path.c_str()));
+    const int tick = writer.AddColumn("tick", COLTYPE_INT64);
+
+    // Each demo's ticks count up from 1, the jumps between demos (and one past int32) are escaped
+    std::vector<int64_t> expected;
+    for (int64_t demo = 0; demo < 4; demo++)
+    {
+        for (int64_t i = 1; i <= 250; i++)
+        {
+            expected.push_back(demo == 3 && i == 100 ? INT64_C(1) << 40 : i);
+        }
+    }
+    writer.Append(tick, expected.data(), expected.size());
+    TEST_CHECK(writer.Close());
+
+    CColumnReader reader;
+    TEST_CHECK(reader.Open(path.c_str()));
+    const columnblock_t& block = reader.GetBlock(0, 0);
+    TEST_CHECK_EQ(block.encoding, COLENC_DELTA);
+    TEST_CHECK_EQ(block.deltaWidth, 1);
+    TEST_CHECK_EQ(block.size, 8u + 999u + 5u * 8u);
+
+    std::vector<double> values;
+    TEST_CHECK(reader.ReadColumn(0, values));
+    TEST_CHECK_EQ(values.size(), expected.size());
+    bool bMatch = true;
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        bMatch = bMatch && values[i] == (double)expected[i];
+    }
+    TEST_CHECK(bMatch);
+    reader.Close();
+    remove(path.c_str());
+}
+
+TEST_CASE(RejectsDamagedFiles)
+{
+    const std::string path = GetNativeTestTempPath("columns_bad.stc");
+    TEST_CHECK(WriteTestFile(path));
+
+    std::vector<uint8_t> bytes;
+    FILE* fp = fopen(path.c_str(), "rb");
+    TEST_CHECK(fp != NULL);
+    int c;
+    while ((c = fgetc(fp)) != EOF)
+    {
+        bytes.push_back((uint8_t)c);
+    }
+    fclose(fp);
+
+    // A byte of the directory
+    bytes[bytes.size() - 20] ^= 0xFF;
+    fp = fopen(path.c_str(), "wb");
+    fwrite(bytes.data(), 1, bytes.size(), fp);
+    fclose(fp);
+    CColumnReader reader;
+    TEST_CHECK(!reader.Open(path.c_str()));
+
+    // Cut short
+    fp = fopen(path.c_str(), "wb");
+    fwrite(bytes.data(), 1, 100, fp);
+    fclose(fp);
+    TEST_CHECK(!reader.Open(path.c_str()));
+
+    // Rows missing from a column
+    CColumnWriter writer(TEST_BLOCK_ROWS);
+    TEST_CHECK(writer.Open(path.c_str()));
+    const int a = writer.AddColumn("a", COLTYPE_INT8);
+    writer.AddColumn("b", COLTYPE_INT8);
+    writer.AppendInt(a, 1);
+    TEST_CHECK(!writer.Close());
+    remove(path.c_str());
+}
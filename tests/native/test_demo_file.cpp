@@ -0,0 +1,139 @@
+#include <stdio.h>
+
+#include "demo_builder.h"
+#include "demo_file.h"
+#include "native_test.h"
+
+TEST_CASE(IteratesEveryMessageWithoutCopying)
+{
+    CDemoBuilder builder;
+    builder.Typical(10);
+    const std::vector<uint8_t>& bytes = builder.Bytes();
+
+    CDemoMessageReader reader(bytes.data(), bytes.size());
+    DemoMessage_t msg;
+    int count = 0;
+    int usercmds = 0;
+    uint64_t expectedOffset = DEMO_HEADER_SIZE;
+    while (reader.Next(msg))
+    {
+        TEST_CHECK_EQ(msg.offset, expectedOffset);
+        expectedOffset += msg.size;
+
+        if (msg.data)
+        {
+            // Payload points straight into the source buffer
+            TEST_CHECK(msg.data > bytes.data() && msg.data + msg.dataLength <= bytes.data() + bytes.size());
+        }
+        if (msg.type == DEM_USERCMD)
+        {
+            TEST_CHECK_EQ(msg.sequence, msg.tick);
+            TEST_CHECK_EQ(msg.dataLength, 12u);
+            usercmds++;
+        }
+        count++;
+    }
+
+    TEST_CHECK(reader.ReachedStop());
+    TEST_CHECK_EQ(reader.GetError(), DEMERR_NONE);
+    TEST_CHECK_EQ(reader.GetOffset(), (uint64_t)bytes.size());
+    TEST_CHECK_EQ(count, 4 + 20 + 1);
+    TEST_CHECK_EQ(usercmds, 10);
+}
+
+TEST_CASE(SummaryMatchesPythonTickCount)
+{
+    // get_demo_tick_count ignores negative ticks and does not count the stop tick
+    CDemoBuilder builder;
+    builder.Typical(5);
+    CDemoBuilder odd;
+    odd.Message(DEM_SIGNON, 0, "x").Message(DEM_PACKET, 42).Message(DEM_CONSOLECMD, -1, "echo").Message(DEM_STOP, 99);
+
+    DemoSummary_t summary;
+    SummarizeDemo(builder.Bytes().data(), builder.Bytes().size(), summary);
+    TEST_CHECK_EQ(summary.lastTick, 5);
+    TEST_CHECK_EQ(summary.messageCounts[DEM_PACKET], 5u);
+    TEST_CHECK_EQ(summary.messageCounts[DEM_STOP], 1u);
+    TEST_CHECK(summary.reachedStop);
+
+    SummarizeDemo(odd.Bytes().data(), odd.Bytes().size(), summary);
+    TEST_CHECK_EQ(summary.lastTick, 42);
+    TEST_CHECK_EQ(summary.error, DEMERR_NONE);
+}
+
+TEST_CASE(PartialTrailingMessageIsResumable)
+{
+    CDemoBuilder builder;
+    builder.Typical(3);
+    const std::vector<uint8_t>& bytes = builder.Bytes();
+
+    // Cut the demo in the middle of the second packet
+    CDemoMessageReader full(bytes.data(), bytes.size());
+    DemoMessage_t msg;
+    uint64_t cut = 0;
+    int packets = 0;
+    while (full.Next(msg))
+    {
+        if (msg.type == DEM_PACKET && ++packets == 2)
+        {
+            cut = msg.offset + msg.size / 2;
+            break;
+        }
+    }
+
+    CDemoMessageReader partial(bytes.data(), cut);
+    uint64_t lastComplete = 0;
+    while (partial.Next(msg))
+    {
+        lastComplete = msg.offset + msg.size;
+    }
+    TEST_CHECK_EQ(partial.GetError(), DEMERR_TRUNCATED);
+    TEST_CHECK_EQ(partial.GetOffset(), lastComplete);
+
+    // Picking up from the reported offset with the full buffer finishes the demo
+    CDemoMessageReader resumed(bytes.data(), bytes.size(), partial.GetOffset());
+    while (resumed.Next(msg))
+    {
+    }
+    TEST_CHECK(resumed.ReachedStop());
+}
+
+TEST_CASE(RejectsBadInput)
+{
+    CDemoBuilder builder;
+    builder.Message(DEM_PACKET, 1, "abc");
+    std::vector<uint8_t> bytes = builder.Bytes();
+    bytes.push_back(0x7f);
+
+    CDemoMessageReader reader(bytes.data(), bytes.size());
+    DemoMessage_t msg;
+    TEST_CHECK(reader.Next(msg));
+    TEST_CHECK(!reader.Next(msg));
+    TEST_CHECK_EQ(reader.GetError(), DEMERR_UNKNOWN_MESSAGE);
+
+    bytes[0] = 'X';
+    TEST_CHECK_EQ(ValidateDemoHeader(bytes.data(), bytes.size()), DEMERR_BAD_STAMP);
+    TEST_CHECK_EQ(ValidateDemoHeader(bytes.data(), DEMO_HEADER_SIZE - 1), DEMERR_TOO_SMALL);
+}
+
+TEST_CASE(MapsFilesFromDisk)
+{
+    std::string path = GetNativeTestTempPath("demo_file.dem");
+    CDemoBuilder builder("testchmb_a_07");
+    builder.Typical(100);
+    TEST_CHECK(builder.WriteTo(path));
+
+    CDemoFile demo;
+    TEST_CHECK_EQ(demo.Open(path.c_str()), DEMERR_NONE);
+    TEST_CHECK(demo.IsOpen());
+    TEST_CHECK_EQ(demo.GetSize(), (uint64_t)builder.Bytes().size());
+    TEST_CHECK(strcmp(demo.GetHeader()->mapname, "testchmb_a_07") == 0);
+
+    DemoSummary_t summary;
+    SummarizeDemo(demo.GetData(), demo.GetSize(), summary);
+    TEST_CHECK_EQ(summary.lastTick, 100);
+    demo.Close();
+    remove(path.c_str());
+
+    TEST_CHECK_EQ(demo.Open(path.c_str()), DEMERR_OPEN);
+}
@@ -0,0 +1,177 @@
+#include <stdio.h>
+
+#include "demo_builder.h"
+#include "demo_index.h"
+#include "demo_indexer.h"
+#include "native_test.h"
+
+// What an index lookup has to agree with: the first message of the last tick at or before target
+static uint64_t FindOffsetByScan(const std::vector<uint8_t>& bytes, int32_t target)
+{
+    uint64_t found = DEMO_HEADER_SIZE;
+    int32_t foundTick = -1;
+    CDemoMessageReader reader(bytes.data(), bytes.size());
+    DemoMessage_t msg;
+    while (reader.Next(msg))
+    {
+        if (msg.type == DEM_STOP || msg.tick < 0 || msg.tick > target)
+            continue;
+        if (msg.tick != foundTick)
+        {
+            found = msg.offset;
+            foundTick = msg.tick;
+        }
+    }
+    return found;
+}
+
+TEST_CASE(IndexesEveryStride)
+{
+    CDemoBuilder builder;
+    builder.Typical(1000);
+    const std::vector<uint8_t>& bytes = builder.Bytes();
+
+    CDemoIndex index;
+    index.Build(bytes.data(), bytes.size(), 64);
+
+    DemoSummary_t summary;
+    SummarizeDemo(bytes.data(), bytes.size(), summary);
+    TEST_CHECK_EQ(index.GetLastTick(), summary.lastTick);
+    TEST_CHECK_EQ(index.GetLastTick(), 1000);
+    TEST_CHECK(index.GetSummary().reachedStop);
+    for (int type = 0; type < DEMO_MSG_TYPE_COUNT; type++)
+    {
+        TEST_CHECK_EQ(index.GetSummary().messageCounts[type], summary.messageCounts[type]);
+        TEST_CHECK_EQ(index.GetSummary().messageBytes[type], summary.messageBytes[type]);
+    }
+
+    // Tick 0 (signon) and then one entry per 64 ticks
+    TEST_CHECK_EQ(index.GetEntries().size(), 1u + 1000u / 64u);
+    TEST_CHECK_EQ(index.GetEntries()[0].offset, (uint64_t)DEMO_HEADER_SIZE);
+    TEST_CHECK_EQ(index.GetEntries()[1].tick, 64);
+
+    // Seeking from the returned offset reaches the tick without passing it
+    const int32_t ticks[] = {-5, 0, 1, 63, 64, 65, 500, 999, 1000, 5000};
+    for (size_t i = 0; i < sizeof(ticks) / sizeof(ticks[0]); i++)
+    {
+        const uint64_t offset = index.FindOffset(ticks[i]);
+        TEST_CHECK(offset <= FindOffsetByScan(bytes, ticks[i]));
+
+        CDemoMessageReader reader(bytes.data(), bytes.size(), offset);
+        DemoMessage_t msg;
+        TEST_CHECK(reader.Next(msg));
+        TEST_CHECK(msg.tick <= (ticks[i] < 0 ? 0 : ticks[i]));
+    }
+    TEST_CHECK_EQ(index.FindOffset(640), FindOffsetByScan(bytes, 640));
+}
+
+TEST_CASE(RoundTripsThroughTheFileFormat)
+{
+    CDemoBuilder builder;
+    builder.Typical(300);
+    CDemoIndex index;
+    index.Build(builder.Bytes().data(), builder.Bytes().size(), 32);
+
+    std::string bytes;
+    index.Serialize(bytes);
+    TEST_CHECK_EQ(bytes.size(), sizeof(demoindexheader_t) + index.GetEntries().size() * sizeof(demoindexentry_t));
+
+    CDemoIndex loaded;
+    TEST_CHECK(loaded.Load(bytes.data(), bytes.size()));
+    TEST_CHECK_EQ(loaded.GetStride(), 32u);
+    TEST_CHECK_EQ(loaded.GetLastTick(), 300);
+    TEST_CHECK_EQ(loaded.GetDemoSize(), (uint64_t)builder.Bytes().size());
+    TEST_CHECK_EQ(loaded.GetEntries().size(), index.GetEntries().size());
+    TEST_CHECK_EQ(loaded.GetSummary().messageCounts[DEM_PACKET], 300u);
+    TEST_CHECK_EQ(loaded.FindOffset(150), index.FindOffset(150));
+
+    // Corruption anywhere, or a cut off file, is rejected
+    std::string corrupt = bytes;
+    corrupt[corrupt.size() - 3] ^= 0x40;
+    TEST_CHECK(!loaded.Load(corrupt.data(), corrupt.size()));
+    TEST_CHECK(loaded.GetEntries().empty());
+    TEST_CHECK(!loaded.Load(bytes.data(), bytes.size() - 1));
+    TEST_CHECK(!loaded.Load(bytes.data(), 10));
+}
+
+TEST_CASE(IndexesTruncatedDemos)
+{
+    CDemoBuilder builder;
+    builder.Typical(200);
+    std::vector<uint8_t> bytes = builder.Bytes();
+    bytes.resize(bytes.size() - 30);
+
+    CDemoIndex index;
+    index.Build(bytes.data(), bytes.size());
+    TEST_CHECK(!index.GetSummary().reachedStop);
+    TEST_CHECK_EQ(index.GetSummary().error, DEMERR_TRUNCATED);
+    TEST_CHECK(index.GetLastTick() > 190);
+}
+
+TEST_CASE(IndexPathReplacesExtension)
+{
+    TEST_CHECK_EQ(GetDemoIndexPath("speedrun/run/d1_canals_06_1.dem"), "speedrun/run/d1_canals_06_1.dmi");
+    TEST_CHECK_EQ(GetDemoIndexPath("noext"), "noext.dmi");
+}
+
+TEST_CASE(IndexerWaitsForTheStopMessage)
+{
+    const std::string demoPath = GetNativeTestTempPath("indexed.dem");
+    const std::string crashedPath = GetNativeTestTempPath("crashed.dem");
+    remove(GetDemoIndexPath(demoPath.c_str()).c_str());
+
+    // The engine is still writing the demo
+    CDemoBuilder builder;
+    builder.Typical(100);
+    std::vector<uint8_t> bytes = builder.Bytes();
+    bytes.resize(bytes.size() - 200);
+    FILE* file = fopen(demoPath.c_str(), "wb");
+    TEST_CHECK(file != NULL);
+    if (!file)
+        return;
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+
+    // Absolute paths ignore the root
+    CDemoIndexer indexer;
+    indexer.Start("unused/");
+    indexer.Queue(demoPath.c_str());
+
+    DemoIndexerStats_t stats;
+    indexer.GetStats(stats);
+    TEST_CHECK_EQ(stats.pending, 1u);
+
+    // The stop command ran
+    TEST_CHECK(builder.WriteTo(demoPath));
+    indexer.WaitIdle();
+
+    indexer.GetStats(stats);
+    TEST_CHECK_EQ(stats.built, 1u);
+    TEST_CHECK_EQ(stats.incomplete, 0u);
+    TEST_CHECK_EQ(stats.pending, 0u);
+
+    CDemoIndex index;
+    TEST_CHECK(index.ReadFile(GetDemoIndexPath(demoPath.c_str()).c_str()));
+    TEST_CHECK_EQ(index.GetLastTick(), 100);
+    TEST_CHECK_EQ(index.GetDemoSize(), (uint64_t)builder.Bytes().size());
+
+    // A demo that never finishes is indexed as far as it goes on shutdown
+    file = fopen(crashedPath.c_str(), "wb");
+    TEST_CHECK(file != NULL);
+    if (file)
+    {
+        fwrite(bytes.data(), 1, bytes.size(), file);
+        fclose(file);
+    }
+    indexer.Queue(crashedPath.c_str());
+    indexer.Queue(GetNativeTestTempPath("missing.dem").c_str());
+    indexer.Shutdown();
+    indexer.GetStats(stats);
+    TEST_CHECK_EQ(stats.incomplete, 1u);
+    TEST_CHECK_EQ(stats.failed, 1u);
+
+    remove(demoPath.c_str());
+    remove(GetDemoIndexPath(demoPath.c_str()).c_str());
+    remove(crashedPath.c_str());
+    remove(GetDemoIndexPath(crashedPath.c_str()).c_str());
+}
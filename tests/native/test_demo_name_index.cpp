@@ -0,0 +1,53 @@
+#include "demo_name_index.h"
+#include "native_test.h"
+
+TEST_CASE(EmptySessionStartsAtZero)
+{
+    CDemoNameIndex index;
+    TEST_CHECK_EQ(index.GetNextRetry("d1_canals_06"), 0);
+}
+
+TEST_CASE(ContinuesFromDemosOnDisk)
+{
+    CDemoNameIndex index;
+    index.AddExistingDemo("d1_canals_06.dem");
+    index.AddExistingDemo("d1_canals_06_1.dem");
+    index.AddExistingDemo("d1_canals_06_2.dem");
+    index.AddExistingDemo("d1_canals_07.dem");
+
+    TEST_CHECK_EQ(index.GetNextRetry("d1_canals_06"), 3);
+    TEST_CHECK_EQ(index.GetNextRetry("d1_canals_07"), 1);
+    TEST_CHECK_EQ(index.GetNextRetry("d1_canals_08"), 0);
+
+    // Gaps (a deleted demo) never make us overwrite the highest retry
+    index.AddExistingDemo("d1_canals_07_5.DEM");
+    TEST_CHECK_EQ(index.GetNextRetry("D1_CANALS_07"), 6);
+}
+
+TEST_CASE(NoPrefixCollisions)
+{
+    CDemoNameIndex index;
+    index.AddExistingDemo("d1_canals_060.dem");
+    index.AddExistingDemo("d1_canals_06a.dem");
+    index.AddExistingDemo("speedrun_democrecord_resume_info.txt");
+
+    TEST_CHECK_EQ(index.GetNextRetry("d1_canals_06"), 0);
+    TEST_CHECK_EQ(index.GetNextRetry("d1_canals_060"), 1);
+
+    // Zero padded map suffixes are not retries
+    TEST_CHECK_EQ(index.GetNextRetry("d1_canals"), 0);
+    TEST_CHECK_EQ(index.GetMapCount(), 2u);
+}
+
+TEST_CASE(TracksRecordCommands)
+{
+    CDemoNameIndex index;
+    index.OnDemoRecorded("testchmb_a_07", 0);
+    TEST_CHECK_EQ(index.GetNextRetry("testchmb_a_07"), 1);
+    index.OnDemoRecorded("testchmb_a_07", 1);
+    index.OnDemoRecorded("testchmb_a_07", 2);
+    TEST_CHECK_EQ(index.GetNextRetry("testchmb_a_07"), 3);
+
+    index.Clear();
+    TEST_CHECK_EQ(index.GetNextRetry("testchmb_a_07"), 0);
+}
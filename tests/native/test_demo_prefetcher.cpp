@@ -0,0 +1,117 @@
+#include <stdio.h>
+
+#include "demo_builder.h"
+#include "demo_prefetcher.h"
+#include "file_list.h"
+#include "native_test.h"
+
+// Writes count demos to <root>/playback/ and returns their paths relative to root, in play order
+static std::vector<std::string> WriteChain(const std::string& root, size_t count, uint64_t& totalBytes)
+{
+    MakeDirectory(root + "/playback");
+
+    std::vector<std::string> names;
+    totalBytes = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        CDemoBuilder builder;
+        builder.Typical(200 + (int32_t)i * 100);
+        const std::string name = "playback/demo_" + std::to_string(i) + ".dem";
+        TEST_CHECK(builder.WriteTo(root + "/" + name));
+        names.push_back(name);
+        totalBytes += builder.Bytes().size();
+    }
+    return names;
+}
+
+TEST_CASE(ReadsAheadOfThePlayingDemo)
+{
+    const std::string root = GetNativeTestTempPath("prefetch");
+    uint64_t totalBytes;
+    const std::vector<std::string> names = WriteChain(root, 4, totalBytes);
+
+    CDemoPrefetcher prefetcher;
+    prefetcher.Start(root.c_str());
+    prefetcher.SetPlaylist(names, 1);
+    TEST_CHECK(prefetcher.IsActive());
+
+    // playdemo of the first one runs, the second is read meanwhile
+    TEST_CHECK(!prefetcher.OnDemoStarted());
+    prefetcher.WaitIdle();
+
+    DemoPrefetchStats_t stats;
+    prefetcher.GetStats(stats);
+    TEST_CHECK_EQ(stats.pending, 0u);
+    TEST_CHECK_EQ(stats.failed, 0u);
+    TEST_CHECK(stats.bytesRead > 0);
+
+    for (int i = 1; i < 4; i++)
+    {
+        prefetcher.OnDemoEnded();
+        prefetcher.OnDemoEnded();
+        TEST_CHECK_EQ(prefetcher.OnDemoStarted(), i == 3);
+        prefetcher.WaitIdle();
+    }
+    TEST_CHECK(!prefetcher.IsActive());
+
+    // Every demo but the first was read ahead, the first one is the engine's business
+    prefetcher.GetStats(stats);
+    TEST_CHECK_EQ(stats.outcomes[PREFETCH_HIT], 3u);
+    TEST_CHECK_EQ(stats.outcomes[PREFETCH_PARTIAL], 0u);
+    TEST_CHECK_EQ(stats.outcomes[PREFETCH_MISS], 0u);
+    TEST_CHECK(stats.bytesRead < totalBytes);
+    TEST_CHECK_EQ(prefetcher.GetGaps(PREFETCH_HIT).GetCount(), 3u);
+
+    // Nothing happens past the end of the chain
+    prefetcher.OnDemoEnded();
+    TEST_CHECK(!prefetcher.OnDemoStarted());
+    prefetcher.GetStats(stats);
+    TEST_CHECK_EQ(stats.outcomes[PREFETCH_HIT], 3u);
+
+    std::string table;
+    prefetcher.FormatTable(table);
+    TEST_CHECK(table.find("3 hits (100.0%)") != std::string::npos);
+    TEST_CHECK(table.find("gap after a hit") != std::string::npos);
+    prefetcher.Shutdown();
+}
+
+TEST_CASE(MissesWithoutReadAhead)
+{
+    const std::string root = GetNativeTestTempPath("prefetch_off");
+    uint64_t totalBytes;
+    std::vector<std::string> names = WriteChain(root, 3, totalBytes);
+    names.push_back("playback/missing.dem");
+
+    CDemoPrefetcher prefetcher;
+    prefetcher.Start(root.c_str());
+
+    // Depth 0 only measures
+    prefetcher.SetPlaylist(names, 0);
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        prefetcher.OnDemoEnded();
+        prefetcher.OnDemoStarted();
+    }
+    prefetcher.WaitIdle();
+
+    DemoPrefetchStats_t stats;
+    prefetcher.GetStats(stats);
+    TEST_CHECK_EQ(stats.outcomes[PREFETCH_MISS], 3u);
+    TEST_CHECK_EQ(stats.bytesRead, 0u);
+
+    // A demo that can't be read is a miss too, a new playlist starts over
+    prefetcher.SetPlaylist(names, 3);
+    TEST_CHECK(!prefetcher.OnDemoStarted());
+    prefetcher.WaitIdle();
+    for (size_t i = 1; i < names.size(); i++)
+    {
+        prefetcher.OnDemoEnded();
+        prefetcher.OnDemoStarted();
+    }
+
+    prefetcher.GetStats(stats);
+    TEST_CHECK_EQ(stats.failed, 1u);
+    TEST_CHECK_EQ(stats.outcomes[PREFETCH_HIT], 2u);
+    TEST_CHECK_EQ(stats.outcomes[PREFETCH_MISS], 4u);
+    TEST_CHECK_EQ(prefetcher.GetGaps(PREFETCH_MISS).GetCount(), 4u);
+}
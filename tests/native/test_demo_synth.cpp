@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "demo_synth.h"
+#include "file_list.h"
+#include "native_test.h"
+#include "session_journal.h"
+#include "usercmd_decoder.h"
+
+TEST_CASE(SameOptionsSameBytes)
+{
+    SynthDemoOptions_t options;
+    options.ticks = 500;
+
+    std::vector<uint8_t> first;
+    std::vector<uint8_t> second;
+    SynthDemoResult_t result;
+    BuildSynthDemo(options, first, result);
+    BuildSynthDemo(options, second, result);
+    TEST_CHECK(first == second);
+    TEST_CHECK_EQ(result.bytes, (uint64_t)first.size());
+
+    // Streamed to disk in chunks, the same
+    options.ticks = 6000;
+    BuildSynthDemo(options, first, result);
+    TEST_CHECK(first.size() > 2u << 20);
+    const std::string path = GetNativeTestTempPath("synth.dem");
+    TEST_CHECK(WriteSynthDemo(path.c_str(), options, result));
+    std::string written;
+    TEST_CHECK(ReadWholeFile(path, written));
+    TEST_CHECK(written.size() == first.size() && memcmp(written.data(), first.data(), first.size()) == 0);
+    remove(path.c_str());
+
+    options.seed = 2;
+    BuildSynthDemo(options, second, result);
+    TEST_CHECK(first != second);
+}
+
+TEST_CASE(ParsesLikeARecording)
+{
+    SynthDemoOptions_t options;
+    options.ticks = 3000;
+    options.mapName = "d1_trainstation_01";
+    std::vector<uint8_t> bytes;
+    SynthDemoResult_t result;
+    BuildSynthDemo(options, bytes, result);
+
+    const demoheader_t* header = (const demoheader_t*)bytes.data();
+    TEST_CHECK_EQ(ValidateDemoHeader(bytes.data(), bytes.size()), DEMERR_NONE);
+    TEST_CHECK_EQ(strcmp(header->mapname, "d1_trainstation_01"), 0);
+    TEST_CHECK_EQ(header->playback_ticks, options.leadTicks + 3000 + options.tailTicks);
+
+    DemoSummary_t summary;
+    SummarizeDemo(bytes.data(), bytes.size(), summary);
+    TEST_CHECK(summary.reachedStop);
+    TEST_CHECK_EQ(summary.error, DEMERR_NONE);
+    TEST_CHECK_EQ(summary.lastTick, result.lastTick);
+    TEST_CHECK_EQ(summary.lastTick, header->playback_ticks);
+    TEST_CHECK_EQ(summary.messageCounts[DEM_USERCMD], 3000u);
+    TEST_CHECK_EQ(summary.messageCounts[DEM_PACKET], (uint32_t)result.lastTick);
+    TEST_CHECK_EQ(summary.messageBytes[DEM_SIGNON] + summary.messageBytes[DEM_DATATABLES] +
+                      summary.messageBytes[DEM_STRINGTABLES],
+                  (uint64_t)header->signonlength);
+    for (int type = 0; type < DEMO_MSG_TYPE_COUNT; type++)
+    {
+        TEST_CHECK_EQ(summary.messageCounts[type], result.messageCounts[type]);
+    }
+
+    // Every usercmd decodes, numbered from 1
+    UserCmdTable_t table;
+    TEST_CHECK_EQ(DecodeDemoUserCmds(bytes.data(), bytes.size(), table), 3000u);
+    TEST_CHECK_EQ(table.commandNumber[0], 1);
+    TEST_CHECK_EQ(table.commandNumber[2999], 3000);
+
+    // Sized by bytes
+    const int32_t ticks = GetSynthTicksForBytes(options, 8u << 20);
+    options.ticks = ticks;
+    BuildSynthDemo(options, bytes, result);
+    TEST_CHECK(result.bytes > (8u << 20) * 98 / 100 && result.bytes < (8u << 20) * 102 / 100);
+}
+
+TEST_CASE(SessionLooksLikeTheLastRun)
+{
+    const std::string root = GetNativeTestTempPath("synth_sessions/");
+    SynthSessionOptions_t options;
+    options.maps = 3;
+    options.ticks = 200;
+
+    SynthSessionResult_t result;
+    TEST_CHECK(WriteSynthSession(root.c_str(), options, result));
+    TEST_CHECK_EQ(result.sessionDir, root + "2024.03.14-15.09.26/");
+    TEST_CHECK(result.demos.size() >= 3u && result.demos.size() <= 12u);
+    TEST_CHECK_EQ(result.demos[0], result.sessionDir + "d1_trainstation_01.dem");
+
+    std::string journal;
+    TEST_CHECK(ReadWholeFile(result.sessionDir + JOURNAL_FILE_NAME, journal));
+    std::vector<journalrecord_t> records;
+    const JournalReadResult_t read = ReadJournal(journal.data(), journal.size(), records);
+    TEST_CHECK(!read.torn);
+    TEST_CHECK_EQ(records.size(), 1 + 2 * result.demos.size());
+    TEST_CHECK_EQ(records[0].type, (uint8_t)JOURNAL_START);
+
+    // Retries of a map carry their number, and only the last one of each map has all the ticks
+    for (size_t i = 0; i < result.demos.size(); i++)
+    {
+        const journalrecord_t& record = records[1 + 2 * i];
+        const journalrecord_t& stop = records[2 + 2 * i];
+        TEST_CHECK_EQ(record.type, (uint8_t)JOURNAL_RECORD);
+        TEST_CHECK_EQ(stop.type, (uint8_t)JOURNAL_STOP);
+        TEST_CHECK_EQ(result.sessionDir + record.demoName + ".dem", result.demos[i]);
+        TEST_CHECK(record.retry == 0 || strstr(record.demoName, "_") != NULL);
+
+        std::string demo;
+        TEST_CHECK(ReadWholeFile(result.demos[i], demo));
+        DemoSummary_t summary;
+        SummarizeDemo((const uint8_t*)demo.data(), demo.size(), summary);
+        TEST_CHECK_EQ(summary.error, DEMERR_NONE);
+        TEST_CHECK_EQ(summary.lastTick, stop.tick);
+        remove(result.demos[i].c_str());
+    }
+
+    // Reloads of a map repeat its signon, every map shares the datatables
+    std::vector<uint8_t> first;
+    std::vector<uint8_t> second;
+    SynthDemoResult_t demo;
+    SynthDemoOptions_t demoOptions;
+    BuildSynthDemo(demoOptions, first, demo);
+    demoOptions.variant = 7;
+    BuildSynthDemo(demoOptions, second, demo);
+    DemoSummary_t summary;
+    SummarizeDemo(first.data(), first.size(), summary);
+    const uint64_t signonBytes = DEMO_HEADER_SIZE + summary.messageBytes[DEM_SIGNON] +
+                                 summary.messageBytes[DEM_DATATABLES] + summary.messageBytes[DEM_STRINGTABLES];
+    TEST_CHECK(memcmp(first.data(), second.data(), (size_t)signonBytes) == 0);
+    TEST_CHECK(first != second);
+
+    remove((result.sessionDir + JOURNAL_FILE_NAME).c_str());
+}
@@ -0,0 +1,249 @@
+#include <stdio.h>
+
+#include "demo_builder.h"
+#include "demo_stream.h"
+#include "demo_trimmer.h"
+#include "native_test.h"
+
+// Signon data, 100 ticks of loading packets, 100 ticks of play and 50 ticks after the last input
+static CDemoBuilder BuildLoadingDemo()
+{
+    CDemoBuilder builder;
+    builder.Message(DEM_SIGNON, 0, std::string(300, 's'));
+    builder.Message(DEM_DATATABLES, 0, std::string(1000, 'd'));
+    builder.Message(DEM_STRINGTABLES, 0, std::string(500, 't'));
+    builder.Message(DEM_SYNCTICK, 0);
+    for (int32_t tick = 1; tick <= 100; tick++)
+    {
+        builder.Message(DEM_PACKET, tick, std::string(200, 'l'));
+    }
+    for (int32_t tick = 101; tick <= 200; tick++)
+    {
+        builder.Message(DEM_PACKET, tick, std::string(40, 'p'));
+        builder.Message(DEM_USERCMD, tick, std::string(12, 'u'));
+    }
+    for (int32_t tick = 201; tick <= 250; tick++)
+    {
+        builder.Message(DEM_PACKET, tick, std::string(40, 't'));
+    }
+    return builder.Message(DEM_STOP, 250);
+}
+
+static std::vector<DemoMessage_t> ReadMessages(CDemoFile& demo)
+{
+    std::vector<DemoMessage_t> messages;
+    CDemoMessageReader reader(demo.GetData(), demo.GetSize());
+    DemoMessage_t msg;
+    while (reader.Next(msg))
+    {
+        messages.push_back(msg);
+    }
+    TEST_CHECK(reader.ReachedStop());
+    return messages;
+}
+
+TEST_CASE(StreamReaderMatchesTheMappedReader)
+{
+    const std::string path = GetNativeTestTempPath("stream.dem");
+    CDemoBuilder builder;
+    builder.Typical(300).WriteTo(path);
+
+    CDemoFile demo;
+    TEST_CHECK_EQ(demo.Open(path.c_str()), DEMERR_NONE);
+    const std::vector<DemoMessage_t> expected = ReadMessages(demo);
+
+    // Smaller than the datatables message, the window has to grow and refill
+    CDemoStreamReader stream(64);
+    TEST_CHECK_EQ(stream.Open(path.c_str()), DEMERR_NONE);
+    TEST_CHECK_EQ(stream.GetFileSize(), (uint64_t)builder.Bytes().size());
+    TEST_CHECK(strcmp(stream.GetHeader().mapname, "d1_canals_06") == 0);
+
+    size_t count = 0;
+    DemoMessage_t msg;
+    while (stream.Next(msg))
+    {
+        TEST_CHECK(count < expected.size());
+        if (count >= expected.size())
+            break;
+        TEST_CHECK_EQ(msg.type, expected[count].type);
+        TEST_CHECK_EQ(msg.tick, expected[count].tick);
+        TEST_CHECK_EQ(msg.offset, expected[count].offset);
+        TEST_CHECK_EQ(msg.size, expected[count].size);
+        TEST_CHECK(memcmp(stream.GetMessageBytes(), demo.GetData() + msg.offset, (size_t)msg.size) == 0);
+        count++;
+    }
+    TEST_CHECK_EQ(count, expected.size());
+    TEST_CHECK(stream.ReachedStop());
+    TEST_CHECK_EQ(stream.GetError(), DEMERR_NONE);
+    TEST_CHECK(stream.GetBufferSize() >= 1005u);
+    demo.Close();
+    remove(path.c_str());
+}
+
+TEST_CASE(StreamReaderStopsAtATruncatedMessage)
+{
+    const std::string path = GetNativeTestTempPath("stream_cut.dem");
+    CDemoBuilder builder;
+    builder.Typical(20);
+    FILE* fp = fopen(path.c_str(), "wb");
+    TEST_CHECK(fp != NULL);
+    fwrite(builder.Bytes().data(), 1, builder.Bytes().size() - 30, fp);
+    fclose(fp);
+
+    CDemoStreamReader stream(128);
+    TEST_CHECK_EQ(stream.Open(path.c_str()), DEMERR_NONE);
+    DemoMessage_t msg;
+    uint64_t end = 0;
+    while (stream.Next(msg))
+    {
+        end = msg.offset + msg.size;
+    }
+    TEST_CHECK_EQ(stream.GetError(), DEMERR_TRUNCATED);
+    TEST_CHECK(!stream.ReachedStop());
+    TEST_CHECK_EQ(stream.GetOffset(), end);
+    remove(path.c_str());
+}
+
+TEST_CASE(CollapsesTheLeadInAndDropsTheTail)
+{
+    const std::string input = GetNativeTestTempPath("loading.dem");
+    const std::string output = GetNativeTestTempPath("loading_trimmed.dem");
+    CDemoBuilder builder = BuildLoadingDemo();
+    builder.WriteTo(input);
+
+    TrimResult_t result;
+    TEST_CHECK(TrimDemo(input.c_str(), output.c_str(), TrimOptions_t(), result));
+    TEST_CHECK(result.written);
+    TEST_CHECK_EQ(result.error, DEMERR_NONE);
+    TEST_CHECK_EQ(result.inputBytes, (uint64_t)builder.Bytes().size());
+    TEST_CHECK_EQ(result.inputTicks, 250);
+    TEST_CHECK_EQ(result.collapsedMessages, 100u);
+    TEST_CHECK_EQ(result.droppedMessages, 50u);
+
+    // Loading packets all on tick 1, play moved back by the 99 ticks they took
+    TEST_CHECK_EQ(result.outputTicks, 101);
+
+    CDemoFile demo;
+    TEST_CHECK_EQ(demo.Open(output.c_str()), DEMERR_NONE);
+    TEST_CHECK_EQ(demo.GetSize(), result.outputBytes);
+    TEST_CHECK_EQ(demo.GetHeader()->playback_ticks, 101);
+    TEST_CHECK_EQ(demo.GetHeader()->playback_frames, 200);
+
+    const std::vector<DemoMessage_t> messages = ReadMessages(demo);
+    TEST_CHECK_EQ(messages.size(), 4u + 100u + 200u + 1u);
+    TEST_CHECK_EQ(messages[1].type, DEM_DATATABLES);
+    TEST_CHECK_EQ(messages[1].dataLength, 1000u);
+    TEST_CHECK_EQ(messages[4].tick, 1);
+    TEST_CHECK_EQ(messages[103].tick, 1);
+    TEST_CHECK_EQ(messages[103].dataLength, 200u);
+    TEST_CHECK_EQ(messages[104].tick, 2);
+    TEST_CHECK_EQ(messages[105].type, DEM_USERCMD);
+    TEST_CHECK_EQ(messages[105].sequence, 101);
+    TEST_CHECK_EQ(messages.back().type, DEM_STOP);
+    TEST_CHECK_EQ(messages.back().tick, 101);
+    demo.Close();
+    remove(input.c_str());
+    remove(output.c_str());
+}
+
+TEST_CASE(DropsTheLeadInAndCollapsesTheTail)
+{
+    const std::string input = GetNativeTestTempPath("loading2.dem");
+    const std::string output = GetNativeTestTempPath("loading2_trimmed.dem");
+    BuildLoadingDemo().WriteTo(input);
+
+    TrimOptions_t options;
+    options.leadIn = TRIM_DROP;
+    options.tail = TRIM_COLLAPSE;
+    TrimResult_t result;
+    TEST_CHECK(TrimDemo(input.c_str(), output.c_str(), options, result));
+    TEST_CHECK_EQ(result.droppedMessages, 100u);
+    TEST_CHECK_EQ(result.collapsedMessages, 50u);
+    TEST_CHECK_EQ(result.outputTicks, 101);
+
+    CDemoFile demo;
+    TEST_CHECK_EQ(demo.Open(output.c_str()), DEMERR_NONE);
+    const std::vector<DemoMessage_t> messages = ReadMessages(demo);
+    TEST_CHECK_EQ(messages.size(), 4u + 200u + 50u + 1u);
+    TEST_CHECK_EQ(messages[4].tick, 2);
+    TEST_CHECK_EQ(messages[253].tick, 101);
+    TEST_CHECK_EQ(demo.GetHeader()->playback_frames, 150);
+    demo.Close();
+    remove(input.c_str());
+    remove(output.c_str());
+}
+
+TEST_CASE(KeepingEverythingCopiesTheDemo)
+{
+    const std::string input = GetNativeTestTempPath("keep.dem");
+    const std::string output = GetNativeTestTempPath("keep_trimmed.dem");
+    CDemoBuilder builder = BuildLoadingDemo();
+    builder.WriteTo(input);
+
+    TrimOptions_t options;
+    options.leadIn = TRIM_KEEP;
+    options.tail = TRIM_KEEP;
+    TrimResult_t result;
+    TEST_CHECK(TrimDemo(input.c_str(), output.c_str(), options, result));
+    TEST_CHECK_EQ(result.outputBytes, result.inputBytes);
+    TEST_CHECK_EQ(result.outputTicks, 250);
+
+    CDemoFile demo;
+    TEST_CHECK_EQ(demo.Open(output.c_str()), DEMERR_NONE);
+    TEST_CHECK_EQ(demo.GetSize(), (uint64_t)builder.Bytes().size());
+    TEST_CHECK(memcmp(demo.GetData() + DEMO_HEADER_SIZE,
+                      builder.Bytes().data() + DEMO_HEADER_SIZE,
+                      builder.Bytes().size() - DEMO_HEADER_SIZE) == 0);
+    demo.Close();
+    remove(input.c_str());
+    remove(output.c_str());
+}
+
+TEST_CASE(FinishesATruncatedDemo)
+{
+    const std::string input = GetNativeTestTempPath("crashed.dem");
+    const std::string output = GetNativeTestTempPath("crashed_trimmed.dem");
+    CDemoBuilder builder = BuildLoadingDemo();
+    FILE* fp = fopen(input.c_str(), "wb");
+    TEST_CHECK(fp != NULL);
+    fwrite(builder.Bytes().data(), 1, builder.Bytes().size() - 10000, fp);
+    fclose(fp);
+
+    TrimResult_t result;
+    TEST_CHECK(TrimDemo(input.c_str(), output.c_str(), TrimOptions_t(), result));
+    TEST_CHECK_EQ(result.error, DEMERR_TRUNCATED);
+    TEST_CHECK(result.outputTicks > 1 && result.outputTicks < 101);
+
+    // Written up to the last whole message and closed with a stop message
+    CDemoFile demo;
+    TEST_CHECK_EQ(demo.Open(output.c_str()), DEMERR_NONE);
+    const std::vector<DemoMessage_t> messages = ReadMessages(demo);
+    TEST_CHECK_EQ(messages.back().tick, result.outputTicks);
+    demo.Close();
+    remove(input.c_str());
+    remove(output.c_str());
+}
+
+TEST_CASE(RejectsWhatIsNotADemo)
+{
+    const std::string input = GetNativeTestTempPath("notes.dem");
+    const std::string output = GetNativeTestTempPath("notes_trimmed.dem");
+    FILE* fp = fopen(input.c_str(), "wb");
+    TEST_CHECK(fp != NULL);
+    fputs("not a demo", fp);
+    fclose(fp);
+    remove(output.c_str());
+
+    TrimResult_t result;
+    TEST_CHECK(!TrimDemo(input.c_str(), output.c_str(), TrimOptions_t(), result));
+    TEST_CHECK(!result.written);
+    TEST_CHECK(result.error != DEMERR_NONE);
+    TEST_CHECK(fopen(output.c_str(), "rb") == NULL);
+    remove(input.c_str());
+
+    TrimAction action = TRIM_KEEP;
+    TEST_CHECK(ParseTrimAction("collapse", action));
+    TEST_CHECK_EQ(action, TRIM_COLLAPSE);
+    TEST_CHECK(!ParseTrimAction("squash", action));
+    TEST_CHECK(strcmp(TrimActionToString(TRIM_DROP), "drop") == 0);
+}
@@ -0,0 +1,701 @@
+#include "demorecord_session.h"
+#include "fake_demorecord_host.h"
+#include "native_test.h"
+
+static struct tm MakeSessionTime()
+{
+    struct tm ltime;
+    memset(&ltime, 0, sizeof(ltime));
+    ltime.tm_year = 2024;
+    ltime.tm_mon = 3;
+    ltime.tm_mday = 14;
+    ltime.tm_hour = 15;
+    ltime.tm_min = 9;
+    ltime.tm_sec = 26;
+    return ltime;
+}
+
+// Loads of tests/reproduction/*/cfg/int_test/playback.cfg: start, save/load, load endofmap, changelevel trigger,
+// death reload, manual changelevel, map command
+static void RunPlayback(const char* const* maps, size_t mapCount, const char* const* expected)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    session.Start("speedrun/", MakeSessionTime());
+    for (size_t i = 0; i < mapCount; i++)
+    {
+        host.LoadMap(session, maps[i]);
+    }
+    session.Stop("speedrun/");
+
+    std::vector<std::string> names = host.GetRecordedDemoNames();
+    TEST_CHECK_EQ(names.size(), mapCount);
+    for (size_t i = 0; i < mapCount && i < names.size(); i++)
+    {
+        if (names[i] != expected[i])
+        {
+            fprintf(stderr, "demo %u: got %s, expected %s\n", (unsigned)i, names[i].c_str(), expected[i]);
+        }
+        TEST_CHECK(names[i] == expected[i]);
+    }
+    TEST_CHECK(!host.m_bRecording || session.GetMode() == DEMREC_DISABLED);
+}
+
+TEST_CASE(Hl2Playback)
+{
+    static const char* const s_Maps[] = {"d1_canals_06",
+                                         "d1_canals_06",
+                                         "d1_canals_06",
+                                         "d1_canals_07",
+                                         "d1_canals_06",
+                                         "d1_canals_06",
+                                         "d1_canals_08",
+                                         "d2_coast_01"};
+    static const char* const s_Expected[] = {"d1_canals_06.dem",
+                                             "d1_canals_06_1.dem",
+                                             "d1_canals_06_2.dem",
+                                             "d1_canals_07.dem",
+                                             "d1_canals_06_3.dem",
+                                             "d1_canals_06_4.dem",
+                                             "d1_canals_08.dem",
+                                             "d2_coast_01.dem"};
+    RunPlayback(s_Maps, sizeof(s_Maps) / sizeof(s_Maps[0]), s_Expected);
+}
+
+TEST_CASE(PortalPlayback)
+{
+    static const char* const s_Maps[] = {"testchmb_a_07",
+                                         "testchmb_a_07",
+                                         "testchmb_a_07",
+                                         "testchmb_a_08",
+                                         "testchmb_a_08",
+                                         "testchmb_a_09",
+                                         "escape_01"};
+    static const char* const s_Expected[] = {"testchmb_a_07.dem",
+                                             "testchmb_a_07_1.dem",
+                                             "testchmb_a_07_2.dem",
+                                             "testchmb_a_08.dem",
+                                             "testchmb_a_08_1.dem",
+                                             "testchmb_a_09.dem",
+                                             "escape_01.dem"};
+    RunPlayback(s_Maps, sizeof(s_Maps) / sizeof(s_Maps[0]), s_Expected);
+}
+
+TEST_CASE(Ep2Playback)
+{
+    static const char* const s_Maps[] = {"ep2_outland_06a",
+                                         "ep2_outland_06a",
+                                         "ep2_outland_06a",
+                                         "ep2_outland_07",
+                                         "ep2_outland_07",
+                                         "ep2_outland_08",
+                                         "ep2_outland_12a"};
+    static const char* const s_Expected[] = {"ep2_outland_06a.dem",
+                                             "ep2_outland_06a_1.dem",
+                                             "ep2_outland_06a_2.dem",
+                                             "ep2_outland_07.dem",
+                                             "ep2_outland_07_1.dem",
+                                             "ep2_outland_08.dem",
+                                             "ep2_outland_12a.dem"};
+    RunPlayback(s_Maps, sizeof(s_Maps) / sizeof(s_Maps[0]), s_Expected);
+}
+
+TEST_CASE(StartCreatesSessionDirAndResumeInfo)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    session.Start("speedrun/", MakeSessionTime());
+    TEST_CHECK_EQ(session.GetMode(), DEMREC_STANDARD);
+
+    std::string sessionDir = session.GetSessionDir();
+    TEST_CHECK(host.m_Dirs.count(sessionDir) == 1);
+    TEST_CHECK_EQ(host.m_Files["speedrun/" RESUME_INFO_FILE_NAME], sessionDir);
+
+    // Timestamped folder with a trailing separator
+    TEST_CHECK(sessionDir.compare(0, 28, "speedrun/2024.03.14-15.09.26") == 0);
+    TEST_CHECK_EQ(sessionDir.size(), 29u);
+
+    host.LoadMap(session, "d1_trainstation_01");
+    TEST_CHECK(host.m_bRecording);
+
+    session.Stop("speedrun/");
+    host.RunCommands();
+    TEST_CHECK_EQ(session.GetMode(), DEMREC_DISABLED);
+    TEST_CHECK(!host.m_bRecording);
+    TEST_CHECK(host.m_Files.count("speedrun/" RESUME_INFO_FILE_NAME) == 0);
+}
+
+TEST_CASE(ResumeContinuesRetries)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    std::string sessionDir;
+    {
+        CDemoRecordSession session(host, stats);
+        session.Start("speedrun/", MakeSessionTime());
+        host.LoadMap(session, "d1_canals_06");
+        host.LoadMap(session, "d1_canals_06");
+        sessionDir = session.GetSessionDir();
+
+        // Game crashes, the session is gone but the demos and resume info are not
+    }
+
+    CDemoRecordSession session(host, stats);
+    TEST_CHECK(session.Resume("speedrun/"));
+    TEST_CHECK_EQ(session.GetMode(), DEMREC_STANDARD);
+    TEST_CHECK_EQ(std::string(session.GetSessionDir()), sessionDir);
+
+    host.LoadMap(session, "d1_canals_06");
+    host.LoadMap(session, "d1_canals_07");
+
+    std::vector<std::string> names = host.GetRecordedDemoNames();
+    TEST_CHECK_EQ(names.size(), 4u);
+    TEST_CHECK_EQ(names[2], "d1_canals_06_2.dem");
+    TEST_CHECK_EQ(names[3], "d1_canals_07.dem");
+    TEST_CHECK_EQ(host.m_RecordedDemos[3], sessionDir + "d1_canals_07.dem");
+}
+
+TEST_CASE(ResumeWithoutInfoFails)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    TEST_CHECK(!session.Resume("speedrun/"));
+    TEST_CHECK_EQ(session.GetMode(), DEMREC_DISABLED);
+}
+
+TEST_CASE(ResumeReadsFirstLineOnly)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    host.m_Files["speedrun/" RESUME_INFO_FILE_NAME] = "speedrun/old/\r\n";
+    TEST_CHECK(session.Resume("speedrun/"));
+    TEST_CHECK_EQ(std::string(session.GetSessionDir()), "speedrun/old/");
+
+    // Dir did not survive, recreated before the first record command
+    host.LoadMap(session, "d1_canals_06");
+    TEST_CHECK(host.m_Dirs.count("speedrun/old/") == 1);
+    TEST_CHECK_EQ(host.m_RecordedDemos.size(), 1u);
+    TEST_CHECK_EQ(host.m_RecordedDemos[0], "speedrun/old/d1_canals_06.dem");
+}
+
+TEST_CASE(SegmentedRecordsOneDemoPerMap)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    session.StartSegmented("segments/");
+    host.LoadMap(session, "testchmb_a_00");
+    host.LoadMap(session, "testchmb_a_00");
+    host.LoadMap(session, "testchmb_a_01");
+
+    TEST_CHECK_EQ(host.m_RecordedDemos.size(), 3u);
+    TEST_CHECK_EQ(host.m_RecordedDemos[0], "segments/testchmb_a_00.dem");
+    TEST_CHECK_EQ(host.m_RecordedDemos[1], "segments/testchmb_a_00.dem");
+    TEST_CHECK_EQ(host.m_RecordedDemos[2], "segments/testchmb_a_01.dem");
+    TEST_CHECK(host.m_Dirs.count("segments/") == 1);
+
+    // No resume info to remove, and nothing to seal: the dir holds every segment ever recorded
+    session.Stop("segments/");
+    TEST_CHECK(host.m_Files.count("segments/" RESUME_INFO_FILE_NAME) == 0);
+    TEST_CHECK(host.m_StoppedSessions.empty());
+}
+
+TEST_CASE(SegmentedKeepsLastAttempts)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    session.StartSegmented("segments/", 2);
+
+    // Tells the attempts apart on the fake disk
+    char contents[32];
+    for (int i = 1; i <= 4; i++)
+    {
+        host.LoadMap(session, "testchmb_a_00", 2 + i);
+        snprintf(contents, sizeof(contents), "attempt %d", i);
+        host.m_Files["segments/testchmb_a_00.dem"] = contents;
+    }
+
+    TEST_CHECK_EQ(host.m_RecordedDemos.size(), 4u);
+    TEST_CHECK_EQ(host.m_RecordedDemos.back(), "segments/testchmb_a_00.dem");
+    TEST_CHECK_EQ(host.m_Files["segments/testchmb_a_00.dem"], "attempt 4");
+    TEST_CHECK_EQ(host.m_Files["segments/testchmb_a_00_slot1.dem"], "attempt 3");
+    TEST_CHECK_EQ(host.m_Files["segments/testchmb_a_00_slot2.dem"], "attempt 2");
+    TEST_CHECK(host.m_Files.count("segments/" ATTEMPT_INDEX_FILE_NAME) == 1);
+
+    // Stats of the finished ones, ticks from the record command running to the reload. The record command runs a frame
+    // after the rotation, which queues it once the move is done.
+    std::vector<attemptrecord_t> attempts;
+    session.GetAttempts("segments/", "testchmb_a_00", attempts);
+    TEST_CHECK_EQ(attempts.size(), 3u);
+    TEST_CHECK_EQ(attempts[0].attempt, 2u);
+    TEST_CHECK_EQ(attempts[0].slot, 1u);
+    TEST_CHECK_EQ(attempts[0].ticks, 2);
+    TEST_CHECK_EQ(attempts[1].ticks, 3);
+    TEST_CHECK_EQ(attempts[2].slot, ATTEMPT_CANONICAL);
+    TEST_CHECK_EQ(attempts[2].ticks, -1);
+    TEST_CHECK(attempts[2].startTime != 0);
+
+    TEST_CHECK_EQ(session.PromoteAttempt("segments/", "testchmb_a_00", 2), PROMOTE_RECORDING);
+    host.LoadMap(session, "testchmb_a_01");
+
+    // The attempt of the other map stays where it is and is indexed there
+    TEST_CHECK_EQ(host.m_StoppedDemos.back(), "segments/testchmb_a_00.dem");
+    TEST_CHECK_EQ(session.PromoteAttempt("segments/", "testchmb_a_00", 9), PROMOTE_NOT_FOUND);
+    TEST_CHECK_EQ(session.PromoteAttempt("segments/", "testchmb_a_00", 2), PROMOTE_OK);
+    TEST_CHECK_EQ(session.PromoteAttempt("segments/", "testchmb_a_00", 2), PROMOTE_ALREADY_CANONICAL);
+    TEST_CHECK_EQ(host.m_Files["segments/testchmb_a_00.dem"], "attempt 2");
+    TEST_CHECK_EQ(host.m_Files["segments/testchmb_a_00_slot2.dem"], "attempt 4");
+    TEST_CHECK_EQ(host.m_Files.count("segments/testchmb_a_00.dem.promote"), 0u);
+
+    // The attempt that was swapped out finished on the map change
+    session.Stop("segments/");
+    host.RunCommands();
+    attempts.clear();
+    session.GetAttempts("segments/", "testchmb_a_00", attempts);
+    TEST_CHECK_EQ(attempts.size(), 3u);
+    TEST_CHECK_EQ(attempts[2].attempt, 4u);
+    TEST_CHECK_EQ(attempts[2].slot, 1u);
+    TEST_CHECK_EQ(attempts[2].ticks, 4);
+
+    // Read back from the index, the oldest kept attempt goes on the next reload
+    CDemoRecordSession resumed(host, stats);
+    resumed.StartSegmented("segments/", 2);
+    host.LoadMap(resumed, "testchmb_a_00");
+    TEST_CHECK_EQ(host.m_Files["segments/testchmb_a_00_slot1.dem"], "attempt 2");
+    TEST_CHECK_EQ(host.m_Files["segments/testchmb_a_00_slot2.dem"], "attempt 4");
+    attempts.clear();
+    resumed.GetAttempts("segments/", NULL, attempts);
+    TEST_CHECK_EQ(attempts.size(), 4u);
+    TEST_CHECK_EQ(attempts[2].attempt, 5u);
+    TEST_CHECK_EQ(strcmp(attempts[3].mapName, "testchmb_a_01"), 0);
+}
+
+TEST_CASE(SegmentedRotationWaitsForTheMove)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    // An attempt from an earlier segment session, with its index
+    host.m_Files["segments/testchmb_a_00.dem"] = "attempt 1";
+    host.m_Files["segments/testchmb_a_00.dmi"] = "index 1";
+    session.StartSegmented("segments/", 2);
+
+    // The file writer is behind: the old attempt is still <map>.dem, so record must not run yet
+    host.m_bHoldFileJobs = true;
+    host.LoadMap(session, "testchmb_a_00");
+    TEST_CHECK(host.m_RecordedDemos.empty());
+    TEST_CHECK_EQ(host.m_Files["segments/testchmb_a_00.dem"], "attempt 1");
+    TEST_CHECK(!host.m_bRecording);
+
+    // The index is not moved along, the attempt is indexed again in its slot
+    TEST_CHECK_EQ(host.m_Files.count("segments/testchmb_a_00.dmi"), 0u);
+    TEST_CHECK_EQ(host.m_StoppedDemos.size(), 1u);
+    TEST_CHECK_EQ(host.m_StoppedDemos.back(), "segments/testchmb_a_00_slot1.dem");
+
+    // Once the move is done the next frame sends it
+    host.RunFileJobs();
+    host.RunFrame(session);
+    host.RunFrame(session);
+    TEST_CHECK_EQ(host.m_RecordedDemos.size(), 1u);
+    TEST_CHECK_EQ(host.m_Files["segments/testchmb_a_00_slot1.dem"], "attempt 1");
+    TEST_CHECK_EQ(host.m_Files.count("segments/testchmb_a_00_slot1.dmi"), 0u);
+    TEST_CHECK_EQ(host.m_RecordStarts.size(), 1u);
+
+    // Attempts take the oldest slot, the index of the attempt that was there goes with it
+    host.m_bHoldFileJobs = false;
+    host.m_Files["segments/testchmb_a_00.dem"] = "attempt 2";
+    host.LoadMap(session, "testchmb_a_00");
+    host.m_Files["segments/testchmb_a_00_slot1.dmi"] = "index 1";
+    host.m_Files["segments/testchmb_a_00.dem"] = "attempt 3";
+    host.LoadMap(session, "testchmb_a_00");
+    TEST_CHECK_EQ(host.m_Files["segments/testchmb_a_00_slot1.dem"], "attempt 3");
+    TEST_CHECK_EQ(host.m_Files["segments/testchmb_a_00_slot2.dem"], "attempt 2");
+    TEST_CHECK_EQ(host.m_Files.count("segments/testchmb_a_00_slot1.dmi"), 0u);
+    TEST_CHECK_EQ(host.m_RecordedDemos.size(), 3u);
+    TEST_CHECK_EQ(host.m_StoppedDemos.size(), 3u);
+    TEST_CHECK_EQ(host.m_StoppedDemos[1], "segments/testchmb_a_00_slot2.dem");
+    TEST_CHECK_EQ(host.m_StoppedDemos[2], "segments/testchmb_a_00_slot1.dem");
+
+    // A load that ends before its move was done drops the held record command
+    host.m_bHoldFileJobs = true;
+    host.LoadMap(session, "testchmb_a_00");
+    host.LoadMap(session, "testchmb_a_01");
+    host.RunFileJobs();
+    host.RunFrame(session);
+    TEST_CHECK_EQ(host.m_RecordedDemos.size(), 4u);
+    TEST_CHECK_EQ(host.m_RecordedDemos.back(), "segments/testchmb_a_01.dem");
+    TEST_CHECK_EQ(host.m_StoppedDemos.size(), 4u);
+    session.Stop("segments/");
+}
+
+TEST_CASE(StandardRunAfterSegmentLeavesAttemptsAlone)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    session.StartSegmented("speedrun/", 2);
+    host.LoadMap(session, "d1_canals_06");
+    host.LoadMap(session, "d1_canals_06");
+    session.Stop("speedrun/");
+    host.RunCommands();
+
+    const std::string index = host.m_Files["speedrun/" ATTEMPT_INDEX_FILE_NAME];
+    std::vector<attemptrecord_t> attempts;
+    session.GetAttempts("speedrun/", NULL, attempts);
+    TEST_CHECK_EQ(attempts.size(), 2u);
+
+    // The same map in a standard run below the same speedrun_dir: its demo has the name of the segment's current
+    // attempt, but neither its load nor its stop end up in the segment index
+    session.Start("speedrun/", MakeSessionTime());
+    host.LoadMap(session, "d1_canals_06", 5);
+    session.Stop("speedrun/");
+    host.RunCommands();
+
+    TEST_CHECK_EQ(host.m_RecordedDemos.back(), std::string(session.GetSessionDir()) + "d1_canals_06.dem");
+    TEST_CHECK(host.m_Files["speedrun/" ATTEMPT_INDEX_FILE_NAME] == index);
+
+    std::vector<attemptrecord_t> after;
+    session.GetAttempts("speedrun/", NULL, after);
+    TEST_CHECK_EQ(after.size(), attempts.size());
+    for (size_t i = 0; i < after.size() && i < attempts.size(); i++)
+    {
+        TEST_CHECK(memcmp(&after[i], &attempts[i], sizeof(attemptrecord_t)) == 0);
+    }
+}
+
+TEST_CASE(SkipsBackgroundMapsAndDemoPlayback)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    host.LoadMap(session, "d1_canals_06");
+    TEST_CHECK(host.m_RecordedDemos.empty());
+
+    session.Start("speedrun/", MakeSessionTime());
+    host.LoadMap(session, "background01");
+    TEST_CHECK(host.m_RecordedDemos.empty());
+
+    host.m_bPlayingDemo = true;
+    host.LoadMap(session, "d1_canals_06");
+    TEST_CHECK(host.m_RecordedDemos.empty());
+
+    host.m_bPlayingDemo = false;
+    host.LoadMap(session, "d1_canals_06");
+    TEST_CHECK_EQ(host.m_RecordedDemos.size(), 1u);
+}
+
+TEST_CASE(ReportsRecordStartLatency)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    session.Start("speedrun/", MakeSessionTime());
+    host.LoadMap(session, "d1_canals_06");
+    host.LoadMap(session, "d1_canals_06");
+
+    // The fake runs the record command on the first frame after the spawn
+    TEST_CHECK_EQ(host.m_RecordStarts.size(), 2u);
+    TEST_CHECK_EQ(host.m_RecordStarts[0].first, "d1_canals_06");
+    TEST_CHECK_EQ(host.m_RecordStarts[0].second, 1);
+    TEST_CHECK_EQ(host.m_RecordStarts[1].first, "d1_canals_06_1");
+
+    // The stop -> record gap of the reload is measured
+    TEST_CHECK_EQ(stats.Get(LATENCY_STOP_TO_RECORD).GetCount(), 1u);
+}
+
+TEST_CASE(RecordingStartsBeforeSpawn)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    // Like the engine: the command buffer runs while the client signs on, so a record command sent by ClientConnect
+    // without touching the disk starts the demo before the player spawns
+    host.m_SignonFrames = 2;
+    session.Start("speedrun/", MakeSessionTime());
+    host.LoadMap(session, "d1_canals_06");
+    host.LoadMap(session, "d1_canals_06");
+    host.LoadMap(session, "d1_canals_07");
+    session.Stop("speedrun/");
+
+    TEST_CHECK_EQ(host.m_RecordStarts.size(), 3u);
+    for (size_t i = 0; i < host.m_RecordStarts.size(); i++)
+    {
+        TEST_CHECK(host.m_RecordStarts[i].second <= 0);
+    }
+
+    // The folder check and name lookup happened in Start and LevelInit, ClientConnect only sent the command
+    TEST_CHECK_EQ(host.m_ConnectFsCalls, 0);
+
+    // Same after speedrun_resume, whose folder check waits for the first LevelShutdown
+    session.Start("speedrun/", MakeSessionTime());
+    host.LoadMap(session, "d1_canals_08");
+    CDemoRecordSession resumed(host, stats);
+    TEST_CHECK(resumed.Resume("speedrun/"));
+    host.m_RecordStarts.clear();
+    host.m_ConnectFsCalls = 0;
+    host.LoadMap(resumed, "d1_canals_08");
+    host.LoadMap(resumed, "d1_canals_09");
+    TEST_CHECK_EQ(host.m_RecordStarts.size(), 2u);
+    for (size_t i = 0; i < host.m_RecordStarts.size(); i++)
+    {
+        TEST_CHECK(host.m_RecordStarts[i].second <= 0);
+    }
+    TEST_CHECK_EQ(host.m_ConnectFsCalls, 0);
+}
+
+TEST_CASE(ResumeReplaysJournal)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    std::string sessionDir;
+    {
+        CDemoRecordSession session(host, stats);
+        session.Start("speedrun/", MakeSessionTime());
+        host.LoadMap(session, "d1_canals_06");
+        host.LoadMap(session, "d1_canals_06");
+        host.LoadMap(session, "d1_canals_07");
+        host.LoadMap(session, "d1_canals_06");
+        sessionDir = session.GetSessionDir();
+    }
+
+    // start, 4 records and 3 stops from the reloads, each synced
+    const std::string journalPath = sessionDir + JOURNAL_FILE_NAME;
+    TEST_CHECK_EQ(host.m_Files[journalPath].size(), (size_t)(8 * JOURNAL_RECORD_SIZE));
+
+    std::vector<journalrecord_t> records;
+    ReadJournal(host.m_Files[journalPath].data(), host.m_Files[journalPath].size(), records);
+    TEST_CHECK_EQ(records.size(), 8u);
+    TEST_CHECK_EQ(records[0].type, JOURNAL_START);
+    TEST_CHECK_EQ(records[1].type, JOURNAL_RECORD);
+    TEST_CHECK_EQ(records[2].type, JOURNAL_STOP);
+    TEST_CHECK(strcmp(records[2].demoName, "d1_canals_06") == 0);
+    TEST_CHECK(records[2].tick > 0);
+    TEST_CHECK(strcmp(records[7].demoName, "d1_canals_06_2") == 0);
+    TEST_CHECK_EQ(records[7].sequence, 7u);
+
+    // Demos are not looked at, the journal alone restores the state
+    for (size_t i = 0; i < host.m_RecordedDemos.size(); i++)
+    {
+        host.m_Files.erase(host.m_RecordedDemos[i]);
+    }
+    host.m_RecordedDemos.clear();
+    host.m_bRecording = false;
+
+    CDemoRecordSession session(host, stats);
+    TEST_CHECK(session.Resume("speedrun/"));
+    TEST_CHECK_EQ(session.GetLastMapName(), "d1_canals_06");
+    TEST_CHECK_EQ(session.GetRetries(), 2);
+    TEST_CHECK_EQ(std::string(session.GetCurrentDemoName()), "d1_canals_06_2");
+    TEST_CHECK_EQ(session.GetDemoNameIndex().GetNextRetry("d1_canals_07"), 1);
+
+    host.LoadMap(session, "d1_canals_06");
+    host.LoadMap(session, "d1_canals_07");
+    std::vector<std::string> names = host.GetRecordedDemoNames();
+    TEST_CHECK_EQ(names.size(), 2u);
+    TEST_CHECK_EQ(names[0], "d1_canals_06_3.dem");
+    TEST_CHECK_EQ(names[1], "d1_canals_07_1.dem");
+
+    // Sequence numbers carry on
+    records.clear();
+    ReadJournal(host.m_Files[journalPath].data(), host.m_Files[journalPath].size(), records);
+    TEST_CHECK_EQ(records.back().sequence, (uint32_t)(records.size() - 1));
+}
+
+TEST_CASE(ResumeTrimsTornJournal)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    std::string sessionDir;
+    {
+        CDemoRecordSession session(host, stats);
+        session.Start("speedrun/", MakeSessionTime());
+        host.LoadMap(session, "d1_canals_06");
+        host.LoadMap(session, "d1_canals_07");
+        sessionDir = session.GetSessionDir();
+    }
+
+    // The crash tore the record of d1_canals_07, its demo made it to disk
+    const std::string journalPath = sessionDir + JOURNAL_FILE_NAME;
+    std::string& journal = host.m_Files[journalPath];
+    journal.resize(journal.size() - 100);
+    host.m_bRecording = false;
+
+    CDemoRecordSession session(host, stats);
+    TEST_CHECK(session.Resume("speedrun/"));
+    TEST_CHECK_EQ(host.m_Files[journalPath].size(), (size_t)(3 * JOURNAL_RECORD_SIZE));
+
+    // The demo on disk still counts
+    host.LoadMap(session, "d1_canals_07");
+    TEST_CHECK_EQ(host.GetRecordedDemoNames().back(), "d1_canals_07_1.dem");
+
+    std::vector<journalrecord_t> records;
+    JournalReadResult_t result =
+        ReadJournal(host.m_Files[journalPath].data(), host.m_Files[journalPath].size(), records);
+    TEST_CHECK(!result.torn);
+    TEST_CHECK_EQ(records.size(), 4u);
+}
+
+// Records d1_canals_06 three times, then cuts `lost` bytes off the journal the way a crash would
+static void ResumeAfterLosingLastRecord(size_t lost)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    std::string sessionDir;
+    {
+        CDemoRecordSession session(host, stats);
+        session.Start("speedrun/", MakeSessionTime());
+        host.LoadMap(session, "d1_canals_06");
+        host.LoadMap(session, "d1_canals_06");
+        host.LoadMap(session, "d1_canals_06");
+        sessionDir = session.GetSessionDir();
+    }
+    TEST_CHECK_EQ(host.GetRecordedDemoNames().back(), "d1_canals_06_2.dem");
+
+    std::string& journal = host.m_Files[sessionDir + JOURNAL_FILE_NAME];
+    journal.resize(journal.size() - lost);
+    host.m_bRecording = false;
+
+    // The journal ends on d1_canals_06_1, d1_canals_06_2.dem on disk must not be recorded over
+    CDemoRecordSession session(host, stats);
+    TEST_CHECK(session.Resume("speedrun/"));
+    TEST_CHECK_EQ(session.GetLastMapName(), "d1_canals_06");
+    TEST_CHECK_EQ(session.GetRetries(), 1);
+
+    host.LoadMap(session, "d1_canals_06");
+    TEST_CHECK_EQ(host.GetRecordedDemoNames().back(), "d1_canals_06_3.dem");
+}
+
+TEST_CASE(ResumeKeepsDemoOfLostRecord)
+{
+    ResumeAfterLosingLastRecord(JOURNAL_RECORD_SIZE);
+}
+
+TEST_CASE(ResumeKeepsDemoOfTornRecord)
+{
+    ResumeAfterLosingLastRecord(100);
+}
+
+TEST_CASE(BookmarksAreFiledPerSession)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    TEST_CHECK(!session.AddBookmark("speedrun/", "", MakeSessionTime(), 0));
+
+    session.Start("speedrun/", MakeSessionTime());
+    host.LoadMap(session, "d1_canals_06", 5);
+    TEST_CHECK_EQ(session.GetBookmarkSession(), "2024.03.14-15.09.26");
+    TEST_CHECK(session.AddBookmark("speedrun/", "", MakeSessionTime(), 3));
+    host.LoadMap(session, "d1_canals_06");
+    TEST_CHECK(session.AddBookmark("speedrun/", "clip", MakeSessionTime(), 1));
+    const std::string sessionDir = session.GetSessionDir();
+    TEST_CHECK_EQ(host.m_Files[sessionDir + BOOKMARK_FILE_NAME].size(), (size_t)(2 * BOOKMARK_RECORD_SIZE));
+    TEST_CHECK_EQ(host.m_Files["speedrun/" BOOKMARK_CATALOG_FILE_NAME], "2024.03.14-15.09.26\n");
+    session.Stop("speedrun/");
+
+    // Loaded from the catalog, then kept up to date without reading again
+    const CBookmarkStore& bookmarks = session.GetBookmarks("speedrun/");
+    TEST_CHECK_EQ(bookmarks.Size(), 2u);
+    TEST_CHECK_EQ(bookmarks.GetSessionDir(0), sessionDir);
+    TEST_CHECK_EQ(strcmp(bookmarks.Get(1).demoName, "d1_canals_06_1"), 0);
+    TEST_CHECK_EQ(bookmarks.Get(1).tick, 1);
+
+    session.StartSegmented("speedrun/");
+    host.LoadMap(session, "d1_canals_07");
+    TEST_CHECK(session.AddBookmark("speedrun/", "clip", MakeSessionTime(), 2));
+    TEST_CHECK_EQ(host.m_Files["speedrun/" BOOKMARK_CATALOG_FILE_NAME], "2024.03.14-15.09.26\n.\n");
+    TEST_CHECK_EQ(bookmarks.Size(), 3u);
+    TEST_CHECK_EQ(bookmarks.GetSessionDir(2), "speedrun/");
+
+    std::vector<uint32_t> ids;
+    BookmarkQuery_t query;
+    query.tag = "clip";
+    bookmarks.Find(query, ids);
+    TEST_CHECK_EQ(ids.size(), 2u);
+
+    // Same answer from the disk
+    CDemoRecordSession fresh(host, stats);
+    ids.clear();
+    fresh.GetBookmarks("speedrun/").Find(query, ids);
+    TEST_CHECK_EQ(ids.size(), 2u);
+    TEST_CHECK_EQ(strcmp(fresh.GetBookmarks("speedrun/").Get(ids[1]).session, BOOKMARK_SEGMENT_SESSION), 0);
+}
+
+TEST_CASE(ResumeTrimsTornBookmark)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    std::string sessionDir;
+    {
+        CDemoRecordSession session(host, stats);
+        session.Start("speedrun/", MakeSessionTime());
+        host.LoadMap(session, "d1_canals_06");
+        session.AddBookmark("speedrun/", "", MakeSessionTime(), 1);
+        session.AddBookmark("speedrun/", "", MakeSessionTime(), 2);
+        sessionDir = session.GetSessionDir();
+    }
+
+    const std::string path = sessionDir + BOOKMARK_FILE_NAME;
+    host.m_Files[path].resize(BOOKMARK_RECORD_SIZE + 40);
+    host.m_bRecording = false;
+
+    CDemoRecordSession session(host, stats);
+    TEST_CHECK(session.Resume("speedrun/"));
+    host.LoadMap(session, "d1_canals_06");
+    TEST_CHECK(session.AddBookmark("speedrun/", "", MakeSessionTime(), 3));
+    TEST_CHECK_EQ(session.GetBookmarks("speedrun/").Size(), 2u);
+    TEST_CHECK_EQ(session.GetBookmarks("speedrun/").Get(1).tick, 3);
+}
+
+TEST_CASE(SegmentedWritesNoJournal)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    session.StartSegmented("segments/");
+    host.LoadMap(session, "testchmb_a_00");
+    host.LoadMap(session, "testchmb_a_00");
+    TEST_CHECK(host.m_Files.count("segments/" JOURNAL_FILE_NAME) == 0);
+}
+
+TEST_CASE(ReportsEveryStoppedDemo)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    session.Start("speedrun/", MakeSessionTime());
+    host.LoadMap(session, "d1_canals_06");
+    host.LoadMap(session, "d1_canals_06");
+    host.LoadMap(session, "d1_canals_07");
+    session.Stop("speedrun/");
+    host.RunCommands();
+
+    // Same paths the engine wrote, so the indexer finds them
+    TEST_CHECK(host.m_StoppedDemos == host.m_RecordedDemos);
+
+    // Once, for the directory the demos are in
+    TEST_CHECK_EQ(host.m_StoppedSessions.size(), 1u);
+    TEST_CHECK_EQ(host.m_StoppedSessions[0], session.GetSessionDir());
+    TEST_CHECK_EQ(host.m_StoppedDemos[0].compare(0, host.m_StoppedSessions[0].size(), host.m_StoppedSessions[0]), 0);
+    session.Stop("speedrun/");
+    TEST_CHECK_EQ(host.m_StoppedSessions.size(), 1u);
+}
@@ -0,0 +1,67 @@
+#include "latency_stats.h"
+#include "native_test.h"
+
+TEST_CASE(BucketsCoverEveryValue)
+{
+    // Every value lands in a bucket whose upper bound is at or above it and within 12.5%
+    uint64_t values[] = {0, 1, 15, 16, 17, 100, 999, 1000, 123456, 1000000007ull, 0xffffffffull, 0x123456789abcull};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        int bucket = CLatencyHistogram::GetBucketIndex(values[i]);
+        TEST_CHECK(bucket >= 0 && bucket < LATENCY_BUCKET_COUNT);
+
+        uint64_t upper = CLatencyHistogram::GetBucketUpperBound(bucket);
+        TEST_CHECK(upper >= values[i]);
+        TEST_CHECK(upper - values[i] <= values[i] / 8);
+        if (bucket > 0)
+        {
+            TEST_CHECK(CLatencyHistogram::GetBucketUpperBound(bucket - 1) < values[i]);
+        }
+    }
+
+    TEST_CHECK_EQ(CLatencyHistogram::GetBucketIndex(~0ull), LATENCY_BUCKET_COUNT - 1);
+}
+
+TEST_CASE(Percentiles)
+{
+    CLatencyHistogram histogram;
+    for (uint64_t i = 1; i <= 1000; i++)
+    {
+        histogram.Record(i * 1000);
+    }
+
+    TEST_CHECK_EQ(histogram.GetCount(), 1000u);
+    TEST_CHECK_EQ(histogram.GetMax(), 1000000u);
+    TEST_CHECK_EQ(histogram.GetMean(), 500500u);
+
+    uint64_t p50 = histogram.GetPercentile(50.0);
+    uint64_t p99 = histogram.GetPercentile(99.0);
+    TEST_CHECK(p50 >= 500000 && p50 <= 500000 + 500000 / 8);
+    TEST_CHECK(p99 >= 990000 && p99 <= 1000000);
+    TEST_CHECK_EQ(histogram.GetPercentile(100.0), 1000000u);
+
+    histogram.Reset();
+    TEST_CHECK_EQ(histogram.GetPercentile(50.0), 0u);
+}
+
+TEST_CASE(ScopedTimerAndReports)
+{
+    CLatencyStats stats;
+    {
+        LATENCY_SCOPE(stats, LATENCY_CLIENTCONNECT);
+    }
+    stats.Record(LATENCY_STOP_TO_RECORD, 2500);
+    TEST_CHECK_EQ(stats.Get(LATENCY_CLIENTCONNECT).GetCount(), 1u);
+
+    std::string table;
+    stats.FormatTable(table);
+    TEST_CHECK(table.find("ClientConnect") != std::string::npos);
+
+    std::string json;
+    stats.FormatJson(json);
+    TEST_CHECK(json.find("\"name\": \"stop_to_record\", \"count\": 1") != std::string::npos);
+    TEST_CHECK(json.find("[2559, 1]") != std::string::npos);
+
+    stats.Reset();
+    TEST_CHECK_EQ(stats.Get(LATENCY_STOP_TO_RECORD).GetCount(), 0u);
+}
@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "demo_builder.h"
+#include "demo_tail.h"
+#include "directory_watcher.h"
+#include "file_list.h"
+#include "live_session_index.h"
+#include "native_test.h"
+#include "session_journal.h"
+
+// Own name so the tests never meet a running daemon's index
+#define TEST_INDEX_NAME "speedrun_demorecord_test_session"
+
+static void AppendFile(const std::string& path, const uint8_t* data, size_t size)
+{
+    FILE* fp = fopen(path.c_str(), "ab");
+    if (fp)
+    {
+        fwrite(data, 1, size, fp);
+        fclose(fp);
+    }
+}
+
+static void AppendJournalRecord(const std::string& dir, uint32_t sequence, const char* mapName, const char* demoName)
+{
+    journalrecord_t record;
+    BuildJournalRecord(record, JOURNAL_RECORD, sequence, mapName, 0, demoName, 0, 0);
+    AppendFile(dir + JOURNAL_FILE_NAME, (const uint8_t*)&record, sizeof(record));
+}
+
+static bool SameSummary(const DemoSummary_t& a, const DemoSummary_t& b)
+{
+    return a.lastTick == b.lastTick && memcmp(a.messageCounts, b.messageCounts, sizeof(a.messageCounts)) == 0 &&
+           memcmp(a.messageBytes, b.messageBytes, sizeof(a.messageBytes)) == 0 && a.reachedStop == b.reachedStop &&
+           a.error == b.error && a.errorOffset == b.errorOffset;
+}
+
+TEST_CASE(TailMatchesSummaryAtEveryCut)
+{
+    CDemoBuilder builder("d1_canals_08");
+    builder.Typical(150);
+    const std::vector<uint8_t>& bytes = builder.Bytes();
+
+    // Pieces that cut the header, the message framing and the payloads everywhere
+    const size_t pieces[] = {1, 7, 333, 4096, 2, 61};
+    for (size_t p = 0; p < sizeof(pieces) / sizeof(pieces[0]); p++)
+    {
+        CDemoTail tail;
+        size_t fed = 0;
+        bool same = true;
+        while (fed < bytes.size())
+        {
+            const size_t size = std::min(pieces[p], bytes.size() - fed);
+            tail.Feed(bytes.data() + fed, size);
+            fed += size;
+
+            DemoSummary_t summary;
+            SummarizeDemo(bytes.data(), fed, summary);
+            same = same && SameSummary(tail.GetSummary(), summary);
+        }
+        TEST_CHECK(same);
+        TEST_CHECK(tail.GetSummary().reachedStop);
+        TEST_CHECK_EQ(tail.GetSummary().lastTick, 150);
+        TEST_CHECK_EQ(tail.GetPendingBytes(), 0u);
+        TEST_CHECK_EQ(tail.GetBytesFed(), (uint64_t)bytes.size());
+        TEST_CHECK_EQ(tail.GetMapName(), "d1_canals_08");
+    }
+
+    // Only the message that is cut off is kept
+    CDemoTail tail;
+    const size_t half = bytes.size() / 2;
+    tail.Feed(bytes.data(), half);
+    TEST_CHECK(!tail.IsFinished());
+    TEST_CHECK(tail.GetPendingBytes() < 200);
+    TEST_CHECK_EQ(tail.GetSummary().error, DEMERR_TRUNCATED);
+    TEST_CHECK_EQ(tail.GetSummary().errorOffset + tail.GetPendingBytes(), (uint64_t)half);
+}
+
+TEST_CASE(TailStopsAtCorruptMessage)
+{
+    CDemoBuilder builder;
+    builder.Message(DEM_SIGNON, 0, "s").Message(DEM_PACKET, 5, "p");
+    std::vector<uint8_t> bytes = builder.Bytes();
+    const size_t corrupt = bytes.size();
+    bytes.push_back(0x42);
+    bytes.insert(bytes.end(), 64, 0);
+
+    CDemoTail tail;
+    tail.Feed(bytes.data(), bytes.size());
+    TEST_CHECK(tail.IsFinished());
+    TEST_CHECK_EQ(tail.GetSummary().error, DEMERR_UNKNOWN_MESSAGE);
+    TEST_CHECK_EQ(tail.GetSummary().errorOffset, (uint64_t)corrupt);
+    TEST_CHECK_EQ(tail.GetSummary().lastTick, 5);
+
+    // More bytes after it are counted and ignored
+    TEST_CHECK_EQ(tail.Feed(bytes.data(), 16), 0u);
+    TEST_CHECK_EQ(tail.GetPendingBytes(), 0u);
+
+    CDemoTail stamp;
+    bytes[0] = 'X';
+    stamp.Feed(bytes.data(), bytes.size());
+    TEST_CHECK(stamp.IsFinished());
+    TEST_CHECK_EQ(stamp.GetSummary().error, DEMERR_BAD_STAMP);
+}
+
+TEST_CASE(FollowsASessionBeingRecorded)
+{
+    const std::string dir = GetNativeTestTempPath("live_session") + "/";
+    MakeDirectory(dir);
+    const char* files[] = {"d1_canals_06.dem", "d1_canals_06_1.dem", "d1_canals_07.dem", JOURNAL_FILE_NAME};
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        remove((dir + files[i]).c_str());
+    }
+
+    CDemoBuilder first("d1_canals_06");
+    first.Typical(300);
+    CDemoBuilder retry("d1_canals_06");
+    retry.Typical(400);
+    CDemoBuilder next("d1_canals_07");
+    next.Typical(250);
+
+    // Recorded out of name order, only the journal knows
+    AppendJournalRecord(dir, 0, "d1_canals_07", "d1_canals_07");
+    AppendFile(dir + "d1_canals_07.dem", next.Bytes().data(), next.Bytes().size());
+
+    CLiveSessionIndex index;
+    index.Open(dir.c_str());
+    TEST_CHECK_EQ(index.GetDemoCount(), 1u);
+    TEST_CHECK_EQ(index.GetTotalTicks(), 250);
+    TEST_CHECK(!index.IsRecording());
+
+    // The next demo arrives in pieces, every byte is read once
+    AppendJournalRecord(dir, 1, "d1_canals_06", "d1_canals_06");
+    TEST_CHECK(index.Update(JOURNAL_FILE_NAME));
+    const std::vector<uint8_t>& bytes = first.Bytes();
+    for (size_t fed = 0; fed < bytes.size();)
+    {
+        const size_t size = std::min<size_t>(777, bytes.size() - fed);
+        AppendFile(dir + "d1_canals_06.dem", bytes.data() + fed, size);
+        fed += size;
+        TEST_CHECK(index.Update("d1_canals_06.dem"));
+        TEST_CHECK(index.IsRecording() == (fed < bytes.size()));
+    }
+    TEST_CHECK(!index.Update("d1_canals_06.dem"));
+    TEST_CHECK_EQ(index.GetDemo(1).name, "d1_canals_06.dem");
+    TEST_CHECK_EQ(index.GetDemo(1).ticks, 300);
+    TEST_CHECK_EQ(index.GetBytesRead(), (uint64_t)(2 * JOURNAL_RECORD_SIZE + next.Bytes().size() + bytes.size()));
+
+    // A demo only the watcher told about, then the journal record for it
+    AppendFile(dir + "d1_canals_06_1.dem", retry.Bytes().data(), retry.Bytes().size() / 2);
+    TEST_CHECK(index.Update("d1_canals_06_1.dem"));
+    AppendJournalRecord(dir, 2, "d1_canals_06", "d1_canals_06_1");
+    index.Update(JOURNAL_FILE_NAME);
+    TEST_CHECK_EQ(index.GetDemoCount(), 3u);
+    TEST_CHECK(index.IsRecording());
+    const int32_t partialTicks = index.GetDemo(2).ticks;
+    TEST_CHECK(partialTicks > 0 && partialTicks < 400);
+
+    // Per map in the order they were first recorded, retries count towards their map
+    TEST_CHECK_EQ(index.GetMapCount(), 2u);
+    TEST_CHECK_EQ(index.GetMap(0).name, "d1_canals_07");
+    TEST_CHECK_EQ(index.GetMap(1).name, "d1_canals_06");
+    TEST_CHECK_EQ(index.GetMap(1).demos, 2u);
+    TEST_CHECK_EQ(index.GetMap(1).ticks, 300 + partialTicks);
+    TEST_CHECK_EQ(index.GetTotalTicks(), 550 + partialTicks);
+
+    // Publishing only rewrites what changed, readers see all of it
+    CLiveSessionFeed feed;
+    TEST_CHECK(feed.Open(TEST_INDEX_NAME));
+    feed.Publish(index);
+    TEST_CHECK_EQ(index.GetFirstChangedDemo(), 3u);
+
+    CLiveSessionReader reader;
+    TEST_CHECK(reader.Open(TEST_INDEX_NAME));
+    static livesessionstate_t state;
+    TEST_CHECK(reader.Read(state));
+    TEST_CHECK_EQ(state.demoCount, 3u);
+    TEST_CHECK_EQ(state.mapCount, 2u);
+    TEST_CHECK_EQ(state.flags, (uint32_t)LIVESESSION_RECORDING);
+    TEST_CHECK_EQ(state.totalTicks, 550 + partialTicks);
+    TEST_CHECK_EQ(strcmp(state.demos[0].name, "d1_canals_07.dem"), 0);
+    TEST_CHECK_EQ(state.demos[0].flags, (uint32_t)LIVESESSION_DEMO_STOPPED);
+    TEST_CHECK_EQ(state.demos[2].map, 1u);
+    TEST_CHECK_EQ(state.demos[2].flags, 0u);
+    TEST_CHECK_EQ(state.maps[1].ticks, 300 + partialTicks);
+
+    const uint32_t sequence = reader.GetSequence();
+    AppendFile(dir + "d1_canals_06_1.dem",
+               retry.Bytes().data() + retry.Bytes().size() / 2,
+               retry.Bytes().size() - retry.Bytes().size() / 2);
+    TEST_CHECK(index.Scan());
+    TEST_CHECK_EQ(index.GetFirstChangedDemo(), 2u);
+    feed.Publish(index);
+    TEST_CHECK(reader.GetSequence() != sequence);
+    TEST_CHECK(reader.Read(state));
+    TEST_CHECK_EQ(state.flags, 0u);
+    TEST_CHECK_EQ(state.demos[2].ticks, 400);
+    TEST_CHECK_EQ(state.maps[1].ticks, 700);
+    TEST_CHECK_EQ(state.totalTicks, 950);
+
+    // A segmented reload records over a finished demo, it is read again from the start
+    remove((dir + "d1_canals_07.dem").c_str());
+    CDemoBuilder shorter("d1_canals_07");
+    shorter.Typical(90);
+    AppendFile(dir + "d1_canals_07.dem", shorter.Bytes().data(), shorter.Bytes().size());
+    TEST_CHECK(index.Update("d1_canals_07.dem"));
+    TEST_CHECK_EQ(index.GetDemo(0).ticks, 90);
+    TEST_CHECK_EQ(index.GetMap(0).ticks, 90);
+    TEST_CHECK_EQ(index.GetTotalTicks(), 790);
+
+    // Files that aren't demos, and demos removed before they were seen, change nothing
+    TEST_CHECK(!index.Update("speedrun_democrecord.bookmarks"));
+    TEST_CHECK(!index.Update("gone.dem"));
+    TEST_CHECK_EQ(index.GetDemoCount(), 3u);
+
+    reader.Close();
+    feed.Close();
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        remove((dir + files[i]).c_str());
+    }
+}
+
+TEST_CASE(WatcherReportsWrittenFiles)
+{
+    const std::string dir = GetNativeTestTempPath("live_session_watch") + "/";
+    MakeDirectory(dir);
+    remove((dir + "a.dem").c_str());
+
+    CDirectoryWatcher watcher;
+    std::vector<std::string> fileNames;
+#ifdef __linux__
+    TEST_CHECK(watcher.Open(dir.c_str()));
+    TEST_CHECK_EQ(watcher.Wait(0, fileNames), WATCH_TIMEOUT);
+
+    const uint8_t bytes[16] = {};
+    AppendFile(dir + "a.dem", bytes, sizeof(bytes));
+    AppendFile(dir + "a.dem", bytes, sizeof(bytes));
+    TEST_CHECK_EQ(watcher.Wait(1000, fileNames), WATCH_CHANGED);
+    TEST_CHECK_EQ(fileNames.size(), 1u);
+    TEST_CHECK(!fileNames.empty() && fileNames[0] == "a.dem");
+#else
+    // Nothing to watch with, the caller rescans after every wait
+    TEST_CHECK(!watcher.Open(dir.c_str()));
+    TEST_CHECK_EQ(watcher.Wait(1, fileNames), WATCH_RESCAN);
+#endif
+
+    watcher.Close();
+    remove((dir + "a.dem").c_str());
+}
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "latency_stats.h"
+#include "live_split_feed.h"
+#include "native_test.h"
+#include "shared_memory.h"
+
+// Own names so the tests never meet a running game's feed
+#define TEST_FEED_NAME "speedrun_demorecord_test_livesplit"
+
+TEST_CASE(ReaderSeesPublishedState)
+{
+    CLiveSplitFeed feed;
+    TEST_CHECK(feed.Open(TEST_FEED_NAME));
+
+    CLiveSplitReader reader;
+    TEST_CHECK(reader.Open(TEST_FEED_NAME));
+
+    livesplitstate_t state;
+    TEST_CHECK(reader.Read(state));
+    TEST_CHECK_EQ(state.flags, 0u);
+    TEST_CHECK_EQ(GetLiveSplitRunTime(state, LatencyNow()), 0u);
+
+    const uint32_t sequence = reader.GetSequence();
+    TEST_CHECK_EQ(sequence & 1, 0u);
+
+    feed.StartRun(1);
+    feed.OnLevelInit("d1_trainstation_01");
+    feed.OnClientConnect("d1_trainstation_01", 0);
+    TEST_CHECK(reader.GetSequence() != sequence);
+
+    TEST_CHECK(reader.Read(state));
+    TEST_CHECK_EQ(state.flags, (uint32_t)(LIVESPLIT_RUNNING | LIVESPLIT_LOADING));
+    TEST_CHECK_EQ(state.mode, 1u);
+    TEST_CHECK_EQ(state.splitIndex, 1u);
+    TEST_CHECK_EQ(strcmp(state.mapName, "d1_trainstation_01"), 0);
+    TEST_CHECK_EQ(strcmp(state.demoName, "d1_trainstation_01"), 0);
+    TEST_CHECK(state.runStartTime != 0);
+    TEST_CHECK(state.updateTime >= state.runStartTime);
+    TEST_CHECK_EQ(memcmp(&state, &feed.GetState(), sizeof(state)), 0);
+
+    reader.Close();
+    feed.Close();
+    TEST_CHECK(!reader.Open(TEST_FEED_NAME));
+}
+
+TEST_CASE(SplitsAndLoadTotals)
+{
+    // Works the same without a segment
+    CLiveSplitFeed feed;
+    feed.OnLevelInit("menu_background");
+    TEST_CHECK_EQ(feed.GetState().splitIndex, 0u);
+    TEST_CHECK_EQ(feed.GetState().loadStartTime, 0u);
+
+    feed.StartRun(1);
+    TEST_CHECK_EQ(feed.GetState().mapName[0], '\0');
+
+    // First map from the menu, then a death on it, then the next map
+    feed.OnLevelShutdown();
+    feed.OnLevelShutdown();
+    feed.OnLevelInit("d1_canals_01");
+    feed.OnClientConnect("d1_canals_01", 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    feed.OnClientActive();
+    TEST_CHECK_EQ(feed.GetState().loadCount, 1u);
+    TEST_CHECK_EQ(feed.GetState().splitIndex, 1u);
+    TEST_CHECK(feed.GetState().loadTime >= 5000000u);
+    TEST_CHECK_EQ(feed.GetState().flags, (uint32_t)LIVESPLIT_RUNNING);
+
+    feed.OnLevelShutdown();
+    feed.OnLevelInit("d1_canals_01");
+    feed.OnClientConnect("d1_canals_01_1", 1);
+    feed.OnClientActive();
+    TEST_CHECK_EQ(feed.GetState().loadCount, 2u);
+    TEST_CHECK_EQ(feed.GetState().splitIndex, 1u);
+    TEST_CHECK_EQ(feed.GetState().retries, 1);
+
+    feed.OnLevelShutdown();
+    feed.OnLevelInit("d1_canals_01a");
+    feed.OnClientConnect("d1_canals_01a", 0);
+    TEST_CHECK(feed.GetState().flags & LIVESPLIT_LOADING);
+    const uint64_t now = LatencyNow();
+    TEST_CHECK(GetLiveSplitLoadTime(feed.GetState(), now) > feed.GetState().loadTime);
+    feed.OnClientActive();
+    TEST_CHECK_EQ(feed.GetState().loadCount, 3u);
+    TEST_CHECK_EQ(feed.GetState().splitIndex, 2u);
+    TEST_CHECK_EQ(strcmp(feed.GetState().demoName, "d1_canals_01a"), 0);
+
+    // The clocks stop with the run
+    feed.StopRun();
+    const livesplitstate_t stopped = feed.GetState();
+    TEST_CHECK_EQ(stopped.flags, 0u);
+    TEST_CHECK(stopped.runStopTime >= stopped.runStartTime);
+    const uint64_t runTime = GetLiveSplitRunTime(stopped, LatencyNow());
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    TEST_CHECK_EQ(GetLiveSplitRunTime(stopped, LatencyNow()), runTime);
+    TEST_CHECK(runTime >= stopped.loadTime);
+
+    // Nothing counts after the run
+    feed.OnLevelShutdown();
+    feed.OnLevelInit("d1_canals_02");
+    feed.OnClientActive();
+    TEST_CHECK_EQ(feed.GetState().loadCount, 3u);
+    TEST_CHECK_EQ(feed.GetState().splitIndex, 2u);
+}
+
+TEST_CASE(SnapshotsAreNeverTorn)
+{
+    CLiveSplitFeed feed;
+    TEST_CHECK(feed.Open(TEST_FEED_NAME));
+    feed.StartRun(1);
+
+    CLiveSplitReader reader;
+    TEST_CHECK(reader.Open(TEST_FEED_NAME));
+
+    // Every update writes a demo name that matches its retries, a torn copy would mix two of them
+    const int updates = 200000;
+    std::atomic<bool> bDone(false);
+    std::thread writer([&feed, &bDone] {
+        char demoName[32];
+        for (int i = 1; i <= updates; i++)
+        {
+            snprintf(demoName, sizeof(demoName), "demo_%d", i);
+            feed.OnClientConnect(demoName, i);
+        }
+        bDone = true;
+    });
+
+    uint64_t snapshots = 0;
+    uint64_t torn = 0;
+    int lastRetries = 0;
+    bool bMonotonic = true;
+    livesplitstate_t state;
+    char expected[32];
+    while (!bDone || snapshots == 0)
+    {
+        if (!reader.TryRead(state))
+            continue;
+
+        snapshots++;
+        if (state.retries == 0)
+            continue;
+        snprintf(expected, sizeof(expected), "demo_%d", state.retries);
+        torn += strcmp(state.demoName, expected) != 0 ? 1 : 0;
+        bMonotonic = bMonotonic && state.retries >= lastRetries;
+        lastRetries = state.retries;
+    }
+    writer.join();
+
+    TEST_CHECK(snapshots > 0);
+    TEST_CHECK_EQ(torn, 0u);
+    TEST_CHECK(bMonotonic);
+    TEST_CHECK(reader.Read(state));
+    TEST_CHECK_EQ(state.retries, updates);
+}
+
+TEST_CASE(ForeignSegmentIsRejected)
+{
+    CLiveSplitReader reader;
+    TEST_CHECK(!reader.Open("speedrun_demorecord_test_missing"));
+
+    CSharedMemory memory;
+    TEST_CHECK(memory.Create("speedrun_demorecord_test_foreign", sizeof(livesplitblock_t)));
+    memset(memory.GetData(), 0x5A, sizeof(livesplitblock_t));
+    TEST_CHECK(!reader.Open("speedrun_demorecord_test_foreign"));
+
+    // Too small for the block
+    TEST_CHECK(memory.Create("speedrun_demorecord_test_foreign", 16));
+    TEST_CHECK(!reader.Open("speedrun_demorecord_test_foreign"));
+    memory.Close();
+}
@@ -0,0 +1,92 @@
+#include <random>
+
+#include "lz_codec.h"
+#include "native_test.h"
+
+static bool RoundTrip(const std::vector<uint8_t>& input, size_t* compressedSize = NULL)
+{
+    std::vector<uint8_t> compressed(LzCompressBound(input.size()));
+    const size_t size = LzCompress(input.data(), input.size(), compressed.data(), compressed.size());
+    if (size == 0)
+        return false;
+    if (compressedSize)
+    {
+        *compressedSize = size;
+    }
+
+    std::vector<uint8_t> output(input.size());
+    return LzDecompress(compressed.data(), size, output.data(), output.size()) && output == input;
+}
+
+TEST_CASE(RoundTripsAnyInput)
+{
+    std::mt19937 random(1234);
+
+    TEST_CHECK(RoundTrip(std::vector<uint8_t>()));
+    for (size_t size = 1; size < 40; size++)
+    {
+        TEST_CHECK(RoundTrip(std::vector<uint8_t>(size, 'x')));
+    }
+
+    // Incompressible, stays within the bound
+    std::vector<uint8_t> noise(300000);
+    for (size_t i = 0; i < noise.size(); i++)
+    {
+        noise[i] = (uint8_t)random();
+    }
+    TEST_CHECK(RoundTrip(noise));
+
+    // Long runs, overlapping matches and literal runs longer than 255
+    std::vector<uint8_t> mixed;
+    for (int i = 0; i < 200; i++)
+    {
+        mixed.insert(mixed.end(), (size_t)(random() % 2000), (uint8_t)i);
+        for (int j = 0; j < (int)(random() % 600); j++)
+        {
+            mixed.push_back((uint8_t)random());
+        }
+        mixed.insert(mixed.end(), mixed.end() - 3, mixed.end());
+    }
+    size_t compressed = 0;
+    TEST_CHECK(RoundTrip(mixed, &compressed));
+    TEST_CHECK(compressed < mixed.size() / 2);
+
+    // Matches up to the largest offset
+    std::vector<uint8_t> far(LZ_MAX_OFFSET + 100);
+    for (size_t i = 0; i < far.size(); i++)
+    {
+        far[i] = i < LZ_MAX_OFFSET ? (uint8_t)random() : far[i - LZ_MAX_OFFSET];
+    }
+    TEST_CHECK(RoundTrip(far));
+}
+
+TEST_CASE(RejectsDamagedInput)
+{
+    std::vector<uint8_t> input(50000);
+    for (size_t i = 0; i < input.size(); i++)
+    {
+        input[i] = (uint8_t)(i * 7 % 251 + i / 1000);
+    }
+    std::vector<uint8_t> compressed(LzCompressBound(input.size()));
+    compressed.resize(LzCompress(input.data(), input.size(), compressed.data(), compressed.size()));
+    TEST_CHECK(!compressed.empty());
+
+    // Not enough room is an error rather than an overflow
+    std::vector<uint8_t> small(compressed.size() - 1);
+    TEST_CHECK_EQ(LzCompress(input.data(), input.size(), small.data(), small.size()), 0u);
+
+    std::vector<uint8_t> output(input.size());
+    TEST_CHECK(!LzDecompress(compressed.data(), compressed.size() - 1, output.data(), output.size()));
+    TEST_CHECK(!LzDecompress(compressed.data(), compressed.size(), output.data(), output.size() - 1));
+    TEST_CHECK(!LzDecompress(compressed.data(), 0, output.data(), output.size()));
+
+    // Whatever the damage, decompression stays inside its buffers (run under a sanitizer to be sure)
+    std::mt19937 random(99);
+    for (int i = 0; i < 2000; i++)
+    {
+        std::vector<uint8_t> damaged = compressed;
+        damaged[random() % damaged.size()] = (uint8_t)random();
+        damaged.resize(damaged.size() - random() % 16);
+        LzDecompress(damaged.data(), damaged.size(), output.data(), output.size());
+    }
+}
@@ -0,0 +1,167 @@
+#include <string.h>
+#include <map>
+
+#include "map_catalog.h"
+#include "native_test.h"
+
+//---------------------------------------------------------------------------------
+// Purpose: a game dir in memory that counts what the catalog asks of it
+//---------------------------------------------------------------------------------
+class CFakeCatalogSource : public IMapCatalogSource
+{
+    public:
+    CFakeCatalogSource() : m_FindCalls(0), m_ReadCalls(0) {}
+
+    // Relative path to contents and times, directories only have a time
+    std::map<std::string, std::string> m_Files;
+    std::map<std::string, int64_t> m_Times;
+    int m_FindCalls;
+    int m_ReadCalls;
+
+    void AddFile(const std::string& path, const std::string& contents, int64_t time)
+    {
+        m_Files[path] = contents;
+        m_Times[path] = time;
+        m_Times[path.substr(0, path.find('/'))] = time;
+    }
+
+    virtual void FindFiles(const char* wildcard, std::vector<std::string>& fileNames)
+    {
+        // Only "<dir>/<prefix>*<suffix>" is used
+        m_FindCalls++;
+        const char* star = strchr(wildcard, '*');
+        const std::string prefix(wildcard, (size_t)(star - wildcard));
+        const std::string suffix(star + 1);
+        for (std::map<std::string, std::string>::const_iterator it = m_Files.begin(); it != m_Files.end(); ++it)
+        {
+            const std::string& path = it->first;
+            if (path.compare(0, prefix.size(), prefix) == 0 && path.size() >= prefix.size() + suffix.size() &&
+                path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0)
+            {
+                fileNames.push_back(path.substr(path.find('/') + 1));
+            }
+        }
+    }
+    virtual bool ReadFile(const char* path, std::string& contents)
+    {
+        m_ReadCalls++;
+        std::map<std::string, std::string>::const_iterator it = m_Files.find(path);
+        if (it == m_Files.end())
+            return false;
+        contents = it->second;
+        return true;
+    }
+    virtual int64_t GetFileTime(const char* path)
+    {
+        std::map<std::string, int64_t>::const_iterator it = m_Times.find(path);
+        return it != m_Times.end() ? it->second : 0;
+    }
+};
+
+TEST_CASE(ParsesChapterConfigs)
+{
+    TEST_CHECK_EQ(ParseChapterMap("map d1_trainstation_01\r\n"), "d1_trainstation_01");
+    TEST_CHECK_EQ(ParseChapterMap("echo starting; MAP \"ep2_outland_01\" \n"), "ep2_outland_01");
+    TEST_CHECK_EQ(ParseChapterMap("maps\nmap_background\nmap\n  map\tc1a0 extra\n"), "c1a0");
+    TEST_CHECK_EQ(ParseChapterMap("exec something\n"), "");
+}
+
+TEST_CASE(ListsMapsChaptersAndSaves)
+{
+    CFakeCatalogSource source;
+    source.AddFile("maps/d1_trainstation_01.bsp", "", 10);
+    source.AddFile("maps/d1_trainstation_02.bsp", "", 10);
+    source.AddFile("maps/D1_Canals_01.bsp", "", 10);
+    source.AddFile("maps/background01.bsp", "", 10);
+    source.AddFile("cfg/chapter10.cfg", "map d3_c17_01\n", 10);
+    source.AddFile("cfg/chapter1.cfg", "map d1_trainstation_01\n", 10);
+    source.AddFile("cfg/chapter9a.cfg", "map d2_prison_05\n", 10);
+    source.AddFile("cfg/config.cfg", "bind w +forward\n", 10);
+    source.AddFile("SAVE/quick.sav", "", 10);
+    source.AddFile("SAVE/canals start.sav", "", 10);
+
+    CMapCatalog catalog;
+    TEST_CHECK_EQ(catalog.GetFirstMap(), std::string(""));
+    const CatalogRefreshResult_t result = catalog.Refresh(source);
+    TEST_CHECK(result.bChanged);
+    TEST_CHECK_EQ(result.listings, 3u);
+    TEST_CHECK_EQ(result.configReads, 3u);
+
+    TEST_CHECK_EQ(catalog.GetMapCount(), 4u);
+    TEST_CHECK(catalog.HasMap("d1_canals_01"));
+    TEST_CHECK(catalog.HasMap("D1_TRAINSTATION_02.bsp"));
+    TEST_CHECK(!catalog.HasMap("d1_trainstation"));
+    TEST_CHECK(catalog.HasSave("Quick"));
+    TEST_CHECK(catalog.HasSave("canals start.sav"));
+    TEST_CHECK(!catalog.HasSave("auto"));
+
+    TEST_CHECK_EQ(catalog.GetChapters().size(), 3u);
+    TEST_CHECK_EQ(catalog.GetChapters()[1].fileName, "chapter9a.cfg");
+    TEST_CHECK_EQ(catalog.GetFirstMap(), std::string("d1_trainstation_01"));
+
+    // Prefixes ignore case, names come back as listed
+    std::vector<std::string> names;
+    catalog.CompleteMaps("d1_", names, 64);
+    TEST_CHECK_EQ(names.size(), 3u);
+    TEST_CHECK_EQ(names[0], "D1_Canals_01");
+    TEST_CHECK_EQ(names[1], "d1_trainstation_01");
+    names.clear();
+    catalog.CompleteMaps("", names, 2);
+    TEST_CHECK_EQ(names.size(), 2u);
+    names.clear();
+    catalog.CompleteSaves("Q", names, 64);
+    TEST_CHECK_EQ(names.size(), 1u);
+    TEST_CHECK_EQ(names[0], "quick");
+    names.clear();
+    catalog.CompleteMaps("d9", names, 64);
+    TEST_CHECK(names.empty());
+}
+
+TEST_CASE(RefreshOnlyRereadsWhatChanged)
+{
+    CFakeCatalogSource source;
+    source.AddFile("maps/d1_canals_01.bsp", "", 10);
+    source.AddFile("cfg/chapter1.cfg", "map d1_canals_01\n", 10);
+    source.AddFile("SAVE/quick.sav", "", 10);
+
+    CMapCatalog catalog;
+    catalog.Refresh(source);
+    TEST_CHECK_EQ(source.m_FindCalls, 3);
+    TEST_CHECK_EQ(source.m_ReadCalls, 1);
+
+    // Nothing changed, nothing listed or read
+    CatalogRefreshResult_t result = catalog.Refresh(source);
+    TEST_CHECK(!result.bChanged);
+    TEST_CHECK_EQ(result.listings, 0u);
+    TEST_CHECK_EQ(source.m_FindCalls, 3);
+
+    // A new save lists SAVE again, only the config that changed is read
+    source.AddFile("SAVE/canals.sav", "", 11);
+    source.AddFile("cfg/chapter2.cfg", "map d1_canals_05\n", 11);
+    result = catalog.Refresh(source);
+    TEST_CHECK(result.bChanged);
+    TEST_CHECK_EQ(result.listings, 2u);
+    TEST_CHECK_EQ(result.configReads, 1u);
+    TEST_CHECK(catalog.HasSave("canals"));
+    TEST_CHECK_EQ(catalog.GetChapters().size(), 2u);
+
+    // Gone is gone, except for maps the engine loaded
+    source.m_Files.erase("maps/d1_canals_01.bsp");
+    source.m_Times["maps"] = 12;
+    catalog.AddMap("d1_canals_02");
+    TEST_CHECK(catalog.HasMap("d1_canals_02"));
+    catalog.Refresh(source);
+    TEST_CHECK(!catalog.HasMap("d1_canals_01"));
+    TEST_CHECK(catalog.HasMap("d1_canals_02"));
+
+    // Without times everything is listed every time, but configs are read once
+    source.m_Times.clear();
+    const int reads = source.m_ReadCalls;
+    result = catalog.Refresh(source);
+    TEST_CHECK_EQ(result.listings, 3u);
+    TEST_CHECK_EQ(source.m_ReadCalls, reads);
+
+    source.m_Files.erase("SAVE/quick.sav");
+    TEST_CHECK(catalog.RefreshSaves(source).bChanged);
+    TEST_CHECK(!catalog.HasSave("quick"));
+}
@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <atomic>
+#include <string>
+
+#include "demo_builder.h"
+#include "native_test.h"
+#include "session_archive.h"
+#include "work_stealing_pool.h"
+
+// A death: same map, same signon data, different gameplay
+static CDemoBuilder MakeRetry(int retry)
+{
+    CDemoBuilder builder("d1_canals_06");
+    builder.Message(DEM_SIGNON, 0, std::string(20000, 's'));
+    builder.Message(DEM_SIGNON, 0, std::string(8000, 'S'));
+    builder.Message(DEM_DATATABLES, 0, std::string(60000, 'd'));
+    builder.Message(DEM_STRINGTABLES, 0, std::string(30000, 't'));
+    builder.Message(DEM_SYNCTICK, 0);
+    for (int32_t tick = 1; tick <= 100 + retry * 10; tick++)
+    {
+        builder.Message(DEM_PACKET, tick, std::string(40, (char)('a' + (tick + retry) % 26)));
+        builder.Message(DEM_USERCMD, tick, std::string(12, 'u'));
+    }
+    return builder.Message(DEM_STOP, 100 + retry * 10);
+}
+
+TEST_CASE(StoresRepeatedBlocksOnce)
+{
+    const std::string path = GetNativeTestTempPath("archive.sra");
+    std::vector<std::vector<uint8_t> > demos;
+
+    CSessionArchiveWriter writer;
+    TEST_CHECK(writer.Open(path.c_str()));
+    for (int retry = 0; retry < 20; retry++)
+    {
+        demos.push_back(MakeRetry(retry).Bytes());
+        char name[64];
+        snprintf(name, sizeof(name), "d1_canals_06_%d.dem", retry);
+        TEST_CHECK(writer.AddFile(name, demos.back().data(), demos.back().size()));
+    }
+
+    // Not a demo, stored whole
+    const std::string journal(500, 'j');
+    TEST_CHECK(writer.AddFile("speedrun_democrecord.journal", (const uint8_t*)journal.data(), journal.size()));
+    TEST_CHECK(writer.Close());
+
+    const ArchiveStats_t& stats = writer.GetStats();
+    TEST_CHECK_EQ(stats.files, 21u);
+    TEST_CHECK_EQ(stats.uniqueBlocks, 4u);
+    TEST_CHECK_EQ(stats.blockRefs, 80u);
+    TEST_CHECK(stats.inputBytes > 3 * stats.archiveBytes);
+
+    CSessionArchiveReader reader;
+    TEST_CHECK(reader.Open(path.c_str()));
+    TEST_CHECK_EQ(reader.GetFileCount(), 21u);
+    TEST_CHECK_EQ(reader.GetArchiveSize(), stats.archiveBytes);
+    TEST_CHECK_EQ(reader.FindFile("d1_canals_06_7.dem"), 7);
+    TEST_CHECK_EQ(reader.FindFile("missing.dem"), -1);
+
+    // Every block was stored by the first retry and reused by the 19 others
+    uint64_t blockBytes = 0;
+    for (size_t i = 0; i < reader.GetBlocks().size(); i++)
+    {
+        TEST_CHECK_EQ(reader.GetBlocks()[i].refs, 20u);
+        blockBytes += reader.GetBlocks()[i].size;
+    }
+    TEST_CHECK(blockBytes > 118000u);
+    TEST_CHECK_EQ(stats.dedupedBytes, 19u * blockBytes);
+
+    // Bit exact
+    std::string contents;
+    for (size_t i = 0; i < demos.size(); i++)
+    {
+        TEST_CHECK(reader.Extract(i, contents));
+        TEST_CHECK(contents.size() == demos[i].size() &&
+                   memcmp(contents.data(), demos[i].data(), contents.size()) == 0);
+    }
+    TEST_CHECK(reader.Extract(20, contents));
+    TEST_CHECK_EQ(contents, journal);
+    reader.Close();
+    remove(path.c_str());
+}
+
+TEST_CASE(KeepsBrokenDemosAsTheyAre)
+{
+    const std::string path = GetNativeTestTempPath("archive_broken.sra");
+    std::vector<uint8_t> crashed = MakeRetry(3).Bytes();
+    crashed.resize(crashed.size() - 77);
+    std::vector<uint8_t> garbage = MakeRetry(4).Bytes();
+    garbage[DEMO_HEADER_SIZE + 30000] = 0xEE;
+
+    CSessionArchiveWriter writer;
+    TEST_CHECK(writer.Open(path.c_str()));
+    TEST_CHECK(writer.AddFile("crashed.dem", crashed.data(), crashed.size()));
+    TEST_CHECK(writer.AddFile("garbage.dem", garbage.data(), garbage.size()));
+    TEST_CHECK(writer.AddFile("empty.dem", NULL, 0));
+    TEST_CHECK(writer.Close());
+
+    CSessionArchiveReader reader;
+    TEST_CHECK(reader.Open(path.c_str()));
+    std::string contents;
+    TEST_CHECK(reader.Extract(0, contents));
+    TEST_CHECK(contents.size() == crashed.size() && memcmp(contents.data(), crashed.data(), contents.size()) == 0);
+    TEST_CHECK(reader.Extract(1, contents));
+    TEST_CHECK(contents.size() == garbage.size() && memcmp(contents.data(), garbage.data(), contents.size()) == 0);
+    TEST_CHECK(reader.Extract(2, contents));
+    TEST_CHECK(contents.empty());
+    reader.Close();
+
+    // Damaged data is caught by the file's CRC, damaged tables by the header
+    FILE* file = fopen(path.c_str(), "r+b");
+    TEST_CHECK(file != NULL);
+    if (file)
+    {
+        fseek(file, (long)(sizeof(archiveheader_t) + 10), SEEK_SET);
+        fputc(0x55, file);
+        fclose(file);
+    }
+    TEST_CHECK(reader.Open(path.c_str()));
+    TEST_CHECK(!reader.Extract(0, contents));
+    reader.Close();
+
+    file = fopen(path.c_str(), "r+b");
+    if (file)
+    {
+        fseek(file, -3, SEEK_END);
+        fputc(0x55, file);
+        fclose(file);
+    }
+    TEST_CHECK(!reader.Open(path.c_str()));
+    remove(path.c_str());
+}
+
+// Long enough to need several chunks, with gameplay that compresses like real packets somewhat do
+static CDemoBuilder MakeLongDemo(int32_t ticks)
+{
+    CDemoBuilder builder("d1_trainstation_01");
+    builder.Message(DEM_SIGNON, 0, std::string(5000, 's'));
+    builder.Message(DEM_DATATABLES, 0, std::string(9000, 'd'));
+    builder.Message(DEM_SYNCTICK, 0);
+    uint32_t state = 1;
+    for (int32_t tick = 1; tick <= ticks; tick++)
+    {
+        std::string packet(100, 'p');
+        for (size_t i = 0; i < packet.size(); i += 4)
+        {
+            state = state * 1103515245u + 12345u;
+            packet[i] = (char)(state >> 24);
+        }
+        builder.Message(DEM_PACKET, tick, packet);
+        builder.Message(DEM_USERCMD, tick, std::string(12, 'u'));
+    }
+    return builder.Message(DEM_STOP, ticks);
+}
+
+TEST_CASE(ExtractsTickRangesFromChunks)
+{
+    const std::string path = GetNativeTestTempPath("archive_ticks.sra");
+    const std::vector<uint8_t> demo = MakeLongDemo(20000).Bytes();
+
+    CSessionArchiveWriter writer(2);
+    TEST_CHECK(writer.Open(path.c_str()));
+    TEST_CHECK(writer.AddFile("long.dem", demo.data(), demo.size()));
+    TEST_CHECK(writer.Close());
+    TEST_CHECK(writer.GetStats().archiveBytes < demo.size());
+
+    CSessionArchiveReader reader;
+    TEST_CHECK(reader.Open(path.c_str()));
+    const ArchiveFile_t& file = reader.GetFile(0);
+    TEST_CHECK(file.pieces.size() > 5);
+
+    // Chunks are compressed, end at message boundaries near the chunk size and cover ticks in order
+    uint64_t pieceStart = 0;
+    for (size_t i = 0; i < file.pieces.size(); i++)
+    {
+        const archivepiece_t& piece = file.pieces[i];
+        TEST_CHECK(piece.size <= ARCHIVE_CHUNK_SIZE);
+        if (piece.block == ARCHIVE_LITERAL && piece.size > 1000u)
+        {
+            TEST_CHECK_EQ(piece.codec, ARCHIVE_CODEC_LZ);
+        }
+        if (i > 0 && pieceStart + piece.size < demo.size())
+        {
+            CDemoMessageReader messages(demo.data(), demo.size(), pieceStart + piece.size);
+            DemoMessage_t msg;
+            if (messages.Next(msg))
+            {
+                TEST_CHECK(msg.tick >= file.pieces[i].lastTick);
+            }
+            TEST_CHECK_EQ(messages.GetError(), DEMERR_NONE);
+        }
+        pieceStart += piece.size;
+    }
+
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    TEST_CHECK(reader.FindTickRange(0, 12000, 12100, offset, size));
+    TEST_CHECK(size < demo.size() / 4);
+
+    // The range holds every message of those ticks and starts on a message
+    std::string range;
+    TEST_CHECK(reader.ExtractRange(0, offset, size, range));
+    TEST_CHECK(memcmp(range.data(), demo.data() + offset, (size_t)size) == 0);
+    int32_t first = -1;
+    int32_t last = -1;
+    CDemoMessageReader messages((const uint8_t*)range.data(), range.size(), 0);
+    DemoMessage_t msg;
+    while (messages.Next(msg))
+    {
+        first = first < 0 ? msg.tick : first;
+        last = msg.tick;
+    }
+    TEST_CHECK(first > 0 && first <= 12000);
+    TEST_CHECK(last >= 12100);
+    TEST_CHECK(!reader.FindTickRange(0, 30000, 40000, offset, size));
+
+    // Any byte range, across piece borders
+    TEST_CHECK(reader.ExtractRange(0, 1000, 300000, range));
+    TEST_CHECK(memcmp(range.data(), demo.data() + 1000, 300000) == 0);
+    TEST_CHECK(!reader.ExtractRange(0, demo.size() - 10, 11, range));
+    reader.Close();
+    remove(path.c_str());
+}
+
+TEST_CASE(ExtractsFromSeveralThreads)
+{
+    const std::string path = GetNativeTestTempPath("archive_threads.sra");
+    std::vector<std::vector<uint8_t> > demos;
+
+    CSessionArchiveWriter writer;
+    TEST_CHECK(writer.Open(path.c_str()));
+    for (int retry = 0; retry < 8; retry++)
+    {
+        demos.push_back(MakeLongDemo(3000 + retry * 500).Bytes());
+        TEST_CHECK(writer.AddFile(std::to_string(retry).c_str(), demos.back().data(), demos.back().size()));
+    }
+    TEST_CHECK(writer.Close());
+
+    CSessionArchiveReader reader;
+    TEST_CHECK(reader.Open(path.c_str()));
+    std::atomic<int> matching(0);
+    CWorkStealingPool pool(4);
+    for (size_t i = 0; i < demos.size(); i++)
+    {
+        pool.Submit([&reader, &demos, &matching, i] {
+            std::string contents;
+            if (reader.Extract(i, contents) && contents.size() == demos[i].size() &&
+                memcmp(contents.data(), demos[i].data(), contents.size()) == 0)
+            {
+                matching++;
+            }
+        });
+    }
+    pool.Wait();
+    TEST_CHECK_EQ(matching.load(), 8);
+    reader.Close();
+    remove(path.c_str());
+}
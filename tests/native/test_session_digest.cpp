@@ -0,0 +1,362 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "crc32.h"
+#include "demo_builder.h"
+#include "demo_indexer.h"
+#include "file_list.h"
+#include "native_test.h"
+#include "session_digest.h"
+#include "sha256.h"
+
+static std::string ToHex(const uint8_t* bytes, size_t size)
+{
+    std::string hex;
+    char digits[3];
+    for (size_t i = 0; i < size; i++)
+    {
+        snprintf(digits, sizeof(digits), "%02x", bytes[i]);
+        hex += digits;
+    }
+    return hex;
+}
+
+static std::string Sha256Hex(const std::string& text)
+{
+    uint8_t hash[SHA256_SIZE];
+    Sha256(text.data(), text.size(), hash);
+    return ToHex(hash, sizeof(hash));
+}
+
+// Offset of the first message at tick
+static uint64_t FindTick(const std::vector<uint8_t>& bytes, int32_t tick)
+{
+    CDemoMessageReader reader(bytes.data(), bytes.size());
+    DemoMessage_t msg;
+    while (reader.Next(msg))
+    {
+        if (msg.tick == tick)
+            return msg.offset;
+    }
+    return 0;
+}
+
+TEST_CASE(Crc32cMatchesKnownValues)
+{
+    TEST_CHECK_EQ(Crc32c("123456789", 9), 0xE3069283u);
+    TEST_CHECK_EQ(Crc32cPortable("123456789", 9), 0xE3069283u);
+    TEST_CHECK_EQ(Crc32c("", 0), 0u);
+
+    // In pieces
+    TEST_CHECK_EQ(Crc32c("6789", 4, Crc32c("12345", 5)), 0xE3069283u);
+
+    // The hardware path on every alignment and tail length gives what the tables give
+    std::vector<uint8_t> bytes(4096);
+    for (size_t i = 0; i < bytes.size(); i++)
+    {
+        bytes[i] = (uint8_t)(i * 131 + (i >> 5));
+    }
+    for (size_t offset = 0; offset < 9; offset++)
+    {
+        for (size_t size = 0; size < 40; size++)
+        {
+            TEST_CHECK_EQ(Crc32c(&bytes[offset], size), Crc32cPortable(&bytes[offset], size));
+        }
+        TEST_CHECK_EQ(Crc32c(&bytes[offset], bytes.size() - offset),
+                      Crc32cPortable(&bytes[offset], bytes.size() - offset));
+    }
+}
+
+TEST_CASE(Sha256MatchesKnownValues)
+{
+    // FIPS 180-4 examples
+    TEST_CHECK_EQ(Sha256Hex(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    TEST_CHECK_EQ(Sha256Hex("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    TEST_CHECK_EQ(Sha256Hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+                  "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+    // Fed in pieces that straddle the block size
+    const std::string text(1000, 'a');
+    CSha256 sha;
+    sha.Update(text.data(), 1);
+    sha.Update(text.data() + 1, 100);
+    sha.Update(text.data() + 101, text.size() - 101);
+    uint8_t hash[SHA256_SIZE];
+    sha.Final(hash);
+    TEST_CHECK_EQ(ToHex(hash, sizeof(hash)), Sha256Hex(text));
+
+    // RFC 4231 test cases 2 and 6 (a key longer than a block)
+    uint8_t mac[SHA256_SIZE];
+    const char* data = "what do ya want for nothing?";
+    HmacSha256("Jefe", 4, data, strlen(data), mac);
+    TEST_CHECK_EQ(ToHex(mac, sizeof(mac)), "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+
+    const std::string longKey(131, '\xaa');
+    data = "Test Using Larger Than Block-Size Key - Hash Key First";
+    HmacSha256(longKey.data(), longKey.size(), data, strlen(data), mac);
+    TEST_CHECK_EQ(ToHex(mac, sizeof(mac)), "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+}
+
+TEST_CASE(BlocksEndAtMessages)
+{
+    CDemoBuilder builder;
+    builder.Typical(1000);
+    const std::vector<uint8_t>& bytes = builder.Bytes();
+
+    DemoDigest_t digest;
+    BuildDemoDigest("a.dem", bytes.data(), bytes.size(), 4096, digest);
+    TEST_CHECK_EQ(digest.name, "a.dem");
+    TEST_CHECK_EQ(digest.size, (uint64_t)bytes.size());
+    TEST_CHECK_EQ(digest.lastTick, 1000);
+    TEST_CHECK(digest.reachedStop);
+    TEST_CHECK(digest.blocks.size() > 10);
+
+    // Contiguous, every block but the last at least the block size, ticks rising from block to block (a tick's
+    // usercmd may start the block after the one its packet is in)
+    uint64_t offset = 0;
+    int32_t lastTick = -1;
+    for (size_t i = 0; i < digest.blocks.size(); i++)
+    {
+        const digestblock_t& block = digest.blocks[i];
+        TEST_CHECK_EQ(block.offset, offset);
+        TEST_CHECK(i + 1 == digest.blocks.size() || block.size >= 4096);
+        TEST_CHECK_EQ(block.crc, Crc32c(&bytes[block.offset], block.size));
+        if (block.lastTick >= 0)
+        {
+            TEST_CHECK(block.firstTick >= lastTick && block.lastTick <= lastTick + 30);
+            lastTick = block.lastTick;
+        }
+        offset += block.size;
+    }
+    TEST_CHECK_EQ(offset, (uint64_t)bytes.size());
+    TEST_CHECK_EQ(lastTick, 1000);
+
+    // Not a demo at all: fixed blocks without ticks
+    const std::vector<uint8_t> garbage(10000, 'x');
+    BuildDemoDigest("b.dem", garbage.data(), garbage.size(), 4096, digest);
+    TEST_CHECK_EQ(digest.blocks.size(), 3u);
+    TEST_CHECK_EQ(digest.blocks[2].size, 10000u - 8192u);
+    TEST_CHECK_EQ(digest.blocks[0].lastTick, -1);
+    TEST_CHECK_EQ(digest.lastTick, -1);
+}
+
+TEST_CASE(DigestSealIsChecked)
+{
+    CDemoBuilder builder;
+    builder.Typical(200);
+    SessionDigest_t digest;
+    digest.blockSize = 1024;
+    digest.bKeyed = false;
+    digest.demos.resize(2);
+    BuildDemoDigest("a.dem", builder.Bytes().data(), builder.Bytes().size(), 1024, digest.demos[0]);
+    BuildDemoDigest("b.dem", builder.Bytes().data(), 100, 1024, digest.demos[1]);
+
+    std::string bytes;
+    FormatSessionDigest(digest, "secret", bytes);
+
+    SessionDigest_t read;
+    TEST_CHECK_EQ(ParseSessionDigest(bytes.data(), bytes.size(), "secret", read), DIGEST_OK);
+    TEST_CHECK(read.bKeyed);
+    TEST_CHECK_EQ(read.blockSize, 1024u);
+    TEST_CHECK_EQ(read.demos.size(), 2u);
+    TEST_CHECK_EQ(read.demos[0].name, "a.dem");
+    TEST_CHECK_EQ(read.demos[0].lastTick, 200);
+    TEST_CHECK_EQ(read.demos[0].blocks.size(), digest.demos[0].blocks.size());
+    TEST_CHECK_EQ(read.demos[1].blocks.size(), 1u);
+    TEST_CHECK(!read.demos[1].reachedStop);
+    TEST_CHECK_EQ(read.demos[1].blocks[0].crc, digest.demos[1].blocks[0].crc);
+
+    TEST_CHECK_EQ(ParseSessionDigest(bytes.data(), bytes.size(), "", read), DIGEST_NEEDS_KEY);
+    TEST_CHECK_EQ(ParseSessionDigest(bytes.data(), bytes.size(), "guess", read), DIGEST_BAD_SEAL);
+    TEST_CHECK_EQ(ParseSessionDigest(bytes.data(), bytes.size() - 1, "secret", read), DIGEST_CORRUPT);
+
+    // A block CRC edited to match edited demos
+    std::string edited = bytes;
+    edited[bytes.size() - SHA256_SIZE - 1] ^= 1;
+    TEST_CHECK_EQ(ParseSessionDigest(edited.data(), edited.size(), "secret", read), DIGEST_BAD_SEAL);
+
+    // Without a key anyone can reseal, a verifier that has the key refuses it
+    FormatSessionDigest(digest, "", bytes);
+    TEST_CHECK_EQ(ParseSessionDigest(bytes.data(), bytes.size(), "", read), DIGEST_OK);
+    TEST_CHECK(!read.bKeyed);
+    TEST_CHECK_EQ(ParseSessionDigest(bytes.data(), bytes.size(), "secret", read), DIGEST_NOT_KEYED);
+}
+
+TEST_CASE(VerifierNamesTheModifiedTicks)
+{
+    const std::string root = GetNativeTestTempPath("digest");
+    const std::string session = root + "/run1";
+    MakeDirectory(session);
+    remove((session + "/" + DIGEST_FILE_NAME).c_str());
+    remove((session + "/extra.dem").c_str());
+
+    CDemoBuilder canals6("d1_canals_06");
+    canals6.Typical(2000);
+    CDemoBuilder canals7("d1_canals_07");
+    canals7.Typical(500);
+    TEST_CHECK(canals6.WriteTo(session + "/d1_canals_06.dem"));
+    TEST_CHECK(canals7.WriteTo(session + "/d1_canals_07.dem"));
+
+    SessionDigest_t digest;
+    digest.blockSize = 4096;
+    digest.bKeyed = true;
+    digest.demos.resize(2);
+    TEST_CHECK(DigestDemoFile((session + "/d1_canals_06.dem").c_str(), 4096, digest.demos[0]));
+    TEST_CHECK(DigestDemoFile((session + "/d1_canals_07.dem").c_str(), 4096, digest.demos[1]));
+    TEST_CHECK_EQ(digest.demos[0].name, "d1_canals_06.dem");
+    TEST_CHECK(WriteSessionDigest(session, digest, "secret"));
+
+    // Found below the archive root
+    std::vector<std::string> paths;
+    paths.push_back(root);
+    CDigestVerifier verifier(4);
+    verifier.Run(paths, "secret");
+    TEST_CHECK_EQ(verifier.GetSessions().size(), 1u);
+    TEST_CHECK_EQ(verifier.GetSessions()[0].sessionDir, session);
+    TEST_CHECK_EQ(verifier.GetSessions()[0].result, DIGEST_OK);
+    TEST_CHECK_EQ(verifier.GetSessions()[0].demos, 2u);
+    TEST_CHECK_EQ(verifier.GetMismatches().size(), 0u);
+    TEST_CHECK_EQ(verifier.GetFailedCount(), 0u);
+    TEST_CHECK_EQ(verifier.GetTotalBytes(), (uint64_t)(canals6.Bytes().size() + canals7.Bytes().size()));
+
+    // Ticks 300 to 1500 rewritten: dozens of blocks over several verifier tasks, reported as one range
+    std::vector<uint8_t> edited = canals6.Bytes();
+    const uint64_t from = FindTick(edited, 300);
+    const uint64_t to = FindTick(edited, 1500);
+    for (uint64_t i = from; i < to; i += 50)
+    {
+        edited[i + 10] ^= 0x20;
+    }
+    FILE* file = fopen((session + "/d1_canals_06.dem").c_str(), "wb");
+    TEST_CHECK(file != NULL);
+    fwrite(edited.data(), 1, edited.size(), file);
+    fclose(file);
+
+    // The last 100 ticks of the other demo cut off, and a demo that wasn't recorded in the run
+    const std::vector<uint8_t>& canals7Bytes = canals7.Bytes();
+    std::vector<uint8_t> cut(canals7Bytes.begin(), canals7Bytes.begin() + (ptrdiff_t)FindTick(canals7Bytes, 400));
+    file = fopen((session + "/d1_canals_07.dem").c_str(), "wb");
+    TEST_CHECK(file != NULL);
+    fwrite(cut.data(), 1, cut.size(), file);
+    fclose(file);
+    TEST_CHECK(canals7.WriteTo(session + "/extra.dem"));
+
+    verifier.Run(paths, "secret");
+    TEST_CHECK_EQ(verifier.GetFailedCount(), 1u);
+    const std::vector<DigestMismatch_t>& mismatches = verifier.GetMismatches();
+    TEST_CHECK_EQ(mismatches.size(), 3u);
+    if (mismatches.size() == 3)
+    {
+        TEST_CHECK_EQ(mismatches[0].demo, "d1_canals_06.dem");
+        TEST_CHECK_EQ(mismatches[0].kind, DIGEST_MODIFIED);
+        TEST_CHECK(mismatches[0].offset <= from && mismatches[0].offset + mismatches[0].size >= to);
+        TEST_CHECK(mismatches[0].firstTick <= 300 && mismatches[0].firstTick > 250);
+        TEST_CHECK(mismatches[0].lastTick >= 1499 && mismatches[0].lastTick < 1550);
+
+        TEST_CHECK_EQ(mismatches[1].demo, "d1_canals_07.dem");
+        TEST_CHECK_EQ(mismatches[1].kind, DIGEST_RESIZED);
+        TEST_CHECK(mismatches[1].offset <= cut.size());
+        TEST_CHECK_EQ(mismatches[1].offset + mismatches[1].size, (uint64_t)canals7.Bytes().size());
+        TEST_CHECK(mismatches[1].firstTick <= 400 && mismatches[1].lastTick == 500);
+
+        TEST_CHECK_EQ(mismatches[2].demo, "extra.dem");
+        TEST_CHECK_EQ(mismatches[2].kind, DIGEST_DEMO_ADDED);
+    }
+
+    // Wrong key
+    verifier.Run(paths, "guess");
+    TEST_CHECK_EQ(verifier.GetSessions()[0].result, DIGEST_BAD_SEAL);
+    TEST_CHECK_EQ(verifier.GetFailedCount(), 1u);
+
+    // A directory without a digest
+    paths[0] = root + "/nothing_here";
+    verifier.Run(paths, "secret");
+    TEST_CHECK_EQ(verifier.GetSessions().size(), 1u);
+    TEST_CHECK_EQ(verifier.GetSessions()[0].result, DIGEST_MISSING);
+}
+
+TEST_CASE(IndexerSealsTheSessionOnceItsDemosAreDone)
+{
+    const std::string session = GetNativeTestTempPath("digest_indexer");
+    MakeDirectory(session);
+    remove((session + "/" + DIGEST_FILE_NAME).c_str());
+
+    // One demo of an earlier resume of the session, and the last one that the engine is still writing
+    CDemoBuilder earlier("d1_canals_05");
+    earlier.Typical(300);
+    TEST_CHECK(earlier.WriteTo(session + "/d1_canals_05.dem"));
+    CDemoBuilder last("d1_canals_06");
+    last.Typical(400);
+    std::vector<uint8_t> bytes = last.Bytes();
+    bytes.resize(bytes.size() - 100);
+    FILE* file = fopen((session + "/d1_canals_06.dem").c_str(), "wb");
+    TEST_CHECK(file != NULL);
+    if (!file)
+        return;
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+
+    CDemoIndexer indexer;
+    indexer.Start("unused/");
+    indexer.Queue((session + "/d1_canals_06.dem").c_str());
+    indexer.QueueSessionDigest((session + "/").c_str(), "secret");
+
+    DemoIndexerStats_t stats;
+    indexer.GetStats(stats);
+    TEST_CHECK_EQ(stats.pending, 2u);
+    TEST_CHECK_EQ(stats.digests, 0u);
+
+    // The stop command ran
+    TEST_CHECK(last.WriteTo(session + "/d1_canals_06.dem"));
+    indexer.WaitIdle();
+    indexer.GetStats(stats);
+    TEST_CHECK_EQ(stats.built, 1u);
+    TEST_CHECK_EQ(stats.digests, 1u);
+    TEST_CHECK_EQ(stats.digestReads, 1u);
+
+    SessionDigest_t digest;
+    TEST_CHECK_EQ(ReadSessionDigest(session, "secret", digest), DIGEST_OK);
+    TEST_CHECK_EQ(digest.demos.size(), 2u);
+    if (digest.demos.size() == 2)
+    {
+        TEST_CHECK_EQ(digest.demos[0].name, "d1_canals_05.dem");
+        TEST_CHECK_EQ(digest.demos[0].lastTick, 300);
+        TEST_CHECK_EQ(digest.demos[1].name, "d1_canals_06.dem");
+        TEST_CHECK_EQ(digest.demos[1].size, (uint64_t)last.Bytes().size());
+        TEST_CHECK(digest.demos[1].reachedStop);
+    }
+
+    std::vector<std::string> paths;
+    paths.push_back(session);
+    CDigestVerifier verifier(2);
+    verifier.Run(paths, "secret");
+    TEST_CHECK_EQ(verifier.GetFailedCount(), 0u);
+}
+
+TEST_CASE(IndexerDigestUsesDemosQueuedWithBackslashes)
+{
+    const std::string session = GetNativeTestTempPath("digest_backslashes");
+    MakeDirectory(session);
+    remove((session + "/" + DIGEST_FILE_NAME).c_str());
+
+    CDemoBuilder demo("d1_canals_06");
+    demo.Typical(200);
+    TEST_CHECK(demo.WriteTo(session + "/d1_canals_06.dem"));
+
+    // The way OnDemoStopped passes them on Windows
+    CDemoIndexer indexer;
+    indexer.Start("unused/");
+    indexer.Queue((session + "\\d1_canals_06.dem").c_str());
+    indexer.QueueSessionDigest((session + "\\").c_str(), "");
+    indexer.WaitIdle();
+
+    DemoIndexerStats_t stats;
+    indexer.GetStats(stats);
+    TEST_CHECK_EQ(stats.built, 1u);
+    TEST_CHECK_EQ(stats.digests, 1u);
+    TEST_CHECK_EQ(stats.digestReads, 0u);
+
+    SessionDigest_t digest;
+    TEST_CHECK_EQ(ReadSessionDigest(session, "", digest), DIGEST_OK);
+    TEST_CHECK_EQ(digest.demos.size(), 1u);
+}
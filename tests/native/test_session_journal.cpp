@@ -0,0 +1,102 @@
+#include <string.h>
+
+#include "crc32.h"
+#include "native_test.h"
+#include "session_journal.h"
+
+static std::string MakeJournal(int records)
+{
+    std::string journal;
+    for (int i = 0; i < records; i++)
+    {
+        journalrecord_t record;
+        BuildJournalRecord(record,
+                           JOURNAL_RECORD,
+                           (uint32_t)i,
+                           "d1_canals_06",
+                           i,
+                           "d1_canals_06_x",
+                           1700000000,
+                           100 + i);
+        journal.append((const char*)&record, sizeof(record));
+    }
+    return journal;
+}
+
+TEST_CASE(Crc32MatchesZlib)
+{
+    TEST_CHECK_EQ(Crc32("123456789", 9), 0xCBF43926u);
+    TEST_CHECK_EQ(Crc32("", 0), 0u);
+
+    // Incremental and unaligned pieces give the same result
+    const char* text = "The quick brown fox jumps over the lazy dog";
+    const size_t length = strlen(text);
+    TEST_CHECK_EQ(Crc32(text, length), 0x414FA339u);
+    TEST_CHECK_EQ(Crc32(text + 7, length - 7, Crc32(text, 7)), 0x414FA339u);
+}
+
+TEST_CASE(RecordsRoundTrip)
+{
+    journalrecord_t record;
+    BuildJournalRecord(record, JOURNAL_STOP, 7, "testchmb_a_08", 1, "testchmb_a_08_1", 1712345678, 1234);
+    TEST_CHECK(IsValidJournalRecord(record));
+    TEST_CHECK_EQ(record.type, JOURNAL_STOP);
+    TEST_CHECK_EQ(record.sequence, 7u);
+    TEST_CHECK_EQ(record.retry, 1);
+    TEST_CHECK_EQ(record.tick, 1234);
+    TEST_CHECK_EQ(record.wallClock, 1712345678);
+    TEST_CHECK(strcmp(record.mapName, "testchmb_a_08") == 0);
+    TEST_CHECK(strcmp(record.demoName, "testchmb_a_08_1") == 0);
+
+    // Any flipped bit is caught
+    journalrecord_t corrupt = record;
+    corrupt.demoName[3] ^= 0x10;
+    TEST_CHECK(!IsValidJournalRecord(corrupt));
+    corrupt = record;
+    corrupt.crc ^= 1;
+    TEST_CHECK(!IsValidJournalRecord(corrupt));
+
+    // Overlong names are cut, not overflowed
+    std::string longName(200, 'a');
+    BuildJournalRecord(record, JOURNAL_RECORD, 0, longName.c_str(), 0, longName.c_str(), 0, 0);
+    TEST_CHECK(IsValidJournalRecord(record));
+    TEST_CHECK_EQ(strlen(record.mapName), (size_t)(JOURNAL_MAP_NAME_SIZE - 1));
+    TEST_CHECK_EQ(strlen(record.demoName), (size_t)(JOURNAL_DEMO_NAME_SIZE - 1));
+}
+
+TEST_CASE(ReadsCompleteJournal)
+{
+    std::string journal = MakeJournal(5);
+    std::vector<journalrecord_t> records;
+    JournalReadResult_t result = ReadJournal(journal.data(), journal.size(), records);
+    TEST_CHECK_EQ(records.size(), 5u);
+    TEST_CHECK_EQ(result.validBytes, journal.size());
+    TEST_CHECK(!result.torn);
+    TEST_CHECK_EQ(records[4].retry, 4);
+
+    records.clear();
+    result = ReadJournal(NULL, 0, records);
+    TEST_CHECK(records.empty());
+    TEST_CHECK(!result.torn);
+}
+
+TEST_CASE(ToleratesTornTail)
+{
+    // Crash half way through writing the fourth record
+    std::string journal = MakeJournal(4);
+    journal.resize(3 * JOURNAL_RECORD_SIZE + 50);
+
+    std::vector<journalrecord_t> records;
+    JournalReadResult_t result = ReadJournal(journal.data(), journal.size(), records);
+    TEST_CHECK_EQ(records.size(), 3u);
+    TEST_CHECK_EQ(result.validBytes, (size_t)(3 * JOURNAL_RECORD_SIZE));
+    TEST_CHECK(result.torn);
+
+    // A full sized record with garbage (e.g. zeroes from a preallocated block) ends the journal too
+    journal = MakeJournal(4);
+    memset(&journal[2 * JOURNAL_RECORD_SIZE + 20], 0, 30);
+    records.clear();
+    result = ReadJournal(journal.data(), journal.size(), records);
+    TEST_CHECK_EQ(records.size(), 2u);
+    TEST_CHECK(result.torn);
+}
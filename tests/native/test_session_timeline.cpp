@@ -0,0 +1,152 @@
+#include <stdio.h>
+
+#include "async_file_writer.h"
+#include "demo_builder.h"
+#include "demo_index.h"
+#include "native_test.h"
+#include "session_journal.h"
+#include "session_timeline.h"
+
+static void WriteDemo(CAsyncFileWriter& writer, const char* name, int32_t ticks)
+{
+    CDemoBuilder builder;
+    builder.Typical(ticks);
+    writer.Write(name, builder.Bytes().data(), builder.Bytes().size());
+}
+
+static void AppendJournalRecord(CAsyncFileWriter& writer, uint32_t sequence, const char* demoName)
+{
+    journalrecord_t record;
+    BuildJournalRecord(record, JOURNAL_RECORD, sequence, "map", 0, demoName, 0, 0);
+    writer.Append(JOURNAL_FILE_NAME, &record, sizeof(record));
+}
+
+TEST_CASE(MapsGlobalTicksToDemos)
+{
+    CSessionTimeline timeline;
+    timeline.AddDemo("a.dem", 100);
+    timeline.AddDemo("empty.dem", 0);
+    timeline.AddDemo("b.dem", 50);
+    timeline.AddDemo("c.dem", 200);
+    TEST_CHECK_EQ(timeline.GetTotalTicks(), 350);
+    TEST_CHECK_EQ(timeline.GetDemoStart(3), 150);
+
+    TimelinePosition_t position;
+    TEST_CHECK(timeline.Locate(0, position));
+    TEST_CHECK_EQ(position.demo, 0u);
+    TEST_CHECK_EQ(position.tick, 0);
+    TEST_CHECK(timeline.Locate(99, position));
+    TEST_CHECK_EQ(position.demo, 0u);
+    TEST_CHECK_EQ(position.tick, 99);
+
+    // A boundary is the start of the next non-empty demo
+    TEST_CHECK(timeline.Locate(100, position));
+    TEST_CHECK_EQ(position.demo, 2u);
+    TEST_CHECK_EQ(position.tick, 0);
+    TEST_CHECK(timeline.Locate(349, position));
+    TEST_CHECK_EQ(position.demo, 3u);
+    TEST_CHECK_EQ(position.tick, 199);
+    TEST_CHECK(timeline.Locate(350, position));
+    TEST_CHECK_EQ(position.demo, 3u);
+    TEST_CHECK_EQ(position.tick, 200);
+    TEST_CHECK(!timeline.Locate(351, position));
+    TEST_CHECK(!timeline.Locate(-1, position));
+
+    TEST_CHECK_EQ(timeline.ToGlobal(3, 10), 160);
+
+    // The last demo keeps growing while it records
+    timeline.UpdateLastDemo(300, 0);
+    TEST_CHECK_EQ(timeline.GetTotalTicks(), 450);
+    TEST_CHECK(timeline.Locate(449, position));
+    TEST_CHECK_EQ(position.tick, 299);
+}
+
+TEST_CASE(SplitsRangesAcrossDemos)
+{
+    CSessionTimeline timeline;
+    timeline.AddDemo("a.dem", 100);
+    timeline.AddDemo("b.dem", 50);
+    timeline.AddDemo("c.dem", 200);
+
+    std::vector<TimelineSpan_t> spans;
+    timeline.GetRange(90, 160, spans);
+    TEST_CHECK_EQ(spans.size(), 3u);
+    TEST_CHECK_EQ(spans[0].demo, 0u);
+    TEST_CHECK_EQ(spans[0].begin, 90);
+    TEST_CHECK_EQ(spans[0].end, 100);
+    TEST_CHECK_EQ(spans[1].begin, 0);
+    TEST_CHECK_EQ(spans[1].end, 50);
+    TEST_CHECK_EQ(spans[2].begin, 0);
+    TEST_CHECK_EQ(spans[2].end, 10);
+
+    // Clamped to the run, empty ranges give nothing
+    spans.clear();
+    timeline.GetRange(-50, 1000, spans);
+    TEST_CHECK_EQ(spans.size(), 3u);
+    TEST_CHECK_EQ(spans[2].end, 200);
+    spans.clear();
+    timeline.GetRange(120, 120, spans);
+    TEST_CHECK(spans.empty());
+}
+
+TEST_CASE(RefreshesFromTheSessionDir)
+{
+    const std::string dir = GetNativeTestTempPath("timeline") + "/";
+    CAsyncFileWriter writer;
+    writer.Start(dir.c_str());
+
+    // Recorded out of name order, only the journal knows
+    WriteDemo(writer, "d1_canals_07.dem", 300);
+    WriteDemo(writer, "d1_canals_06.dem", 100);
+    AppendJournalRecord(writer, 0, "d1_canals_07");
+    AppendJournalRecord(writer, 1, "d1_canals_06");
+    writer.Flush();
+
+    CSessionTimeline timeline;
+    TEST_CHECK_EQ(timeline.Refresh(dir.c_str()), 2u);
+    TEST_CHECK_EQ(timeline.GetDemo(0).name, "d1_canals_07.dem");
+    TEST_CHECK_EQ(timeline.GetDemo(0).ticks, 300);
+    TEST_CHECK_EQ(timeline.GetTotalTicks(), 400);
+
+    // A new demo is still being written, the one before is indexed
+    CDemoBuilder growing;
+    growing.Typical(500);
+    std::vector<uint8_t> partial = growing.Bytes();
+    partial.resize(partial.size() / 2);
+    writer.Write("d1_canals_06_1.dem", partial.data(), partial.size());
+    AppendJournalRecord(writer, 2, "d1_canals_06_1");
+    writer.Flush();
+
+    TEST_CHECK_EQ(timeline.Refresh(dir.c_str()), 1u);
+    TEST_CHECK_EQ(timeline.GetDemoCount(), 3u);
+    TEST_CHECK(timeline.GetDemo(2).ticks < 500);
+    TEST_CHECK(timeline.GetDemo(2).ticks > 0);
+
+    // It finished, and a demo the journal lost follows it
+    WriteDemo(writer, "d1_canals_06_1.dem", 500);
+    WriteDemo(writer, "d1_canals_08.dem", 20);
+    writer.Flush();
+    TEST_CHECK_EQ(timeline.Refresh(dir.c_str()), 1u);
+    TEST_CHECK_EQ(timeline.GetDemo(2).ticks, 500);
+    TEST_CHECK_EQ(timeline.GetDemo(3).name, "d1_canals_08.dem");
+    TEST_CHECK_EQ(timeline.GetTotalTicks(), 920);
+
+    // An up to date index is trusted over the demo
+    CDemoIndex index;
+    CDemoBuilder builder;
+    builder.Typical(100);
+    index.Build(builder.Bytes().data(), builder.Bytes().size());
+    index.WriteFile((dir + "d1_canals_06.dmi").c_str());
+    uint64_t size;
+    TEST_CHECK_EQ(MeasureDemoTicks((dir + "d1_canals_06.dem").c_str(), size), 100);
+    TEST_CHECK_EQ(size, (uint64_t)builder.Bytes().size());
+
+    const char* files[] = {
+        "d1_canals_06.dem", "d1_canals_06.dmi", "d1_canals_06_1.dem", "d1_canals_07.dem", "d1_canals_08.dem",
+        JOURNAL_FILE_NAME};
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        writer.Remove(files[i]);
+    }
+    writer.Shutdown();
+}
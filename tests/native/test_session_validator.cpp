@@ -0,0 +1,86 @@
+#include <stdio.h>
+
+#include "async_file_writer.h"
+#include "demo_builder.h"
+#include "native_test.h"
+#include "session_validator.h"
+
+static void WriteDemo(CAsyncFileWriter& writer, const char* path, const char* mapName, int32_t ticks, size_t cut = 0)
+{
+    CDemoBuilder builder(mapName);
+    builder.Typical(ticks);
+    writer.Write(path, builder.Bytes().data(), builder.Bytes().size() - cut);
+}
+
+TEST_CASE(ValidatesAnArchiveOfSessions)
+{
+    const std::string root = GetNativeTestTempPath("validator");
+    CAsyncFileWriter writer;
+    writer.Start(root.c_str());
+
+    const char* files[] = {"run1/d1_canals_06.dem",
+                           "run1/d1_canals_06_1.dem",
+                           "run1/d1_canals_07.dem",
+                           "run2/d1_canals_06.dem",
+                           "run2/nested/d1_canals_07.dem",
+                           "run2/crashed.dem",
+                           "run2/notes.txt"};
+    WriteDemo(writer, files[0], "d1_canals_06", 100);
+    WriteDemo(writer, files[1], "d1_canals_06", 200);
+    WriteDemo(writer, files[2], "d1_canals_07", 300);
+    WriteDemo(writer, files[3], "d1_canals_06", 50);
+    WriteDemo(writer, files[4], "d1_canals_07", 10);
+    WriteDemo(writer, files[5], "d1_canals_07", 40, 100);
+    writer.Write(files[6], "not a demo", 10);
+    writer.Flush();
+
+    CSessionValidator validator(3);
+    std::vector<std::string> paths;
+    paths.push_back(root);
+    validator.Run(paths);
+
+    const std::vector<DemoCheck_t>& results = validator.GetResults();
+    TEST_CHECK_EQ(results.size(), 6u);
+    TEST_CHECK_EQ(validator.GetErrorCount(), 1u);
+    TEST_CHECK_EQ(validator.GetThreadCount(), 3u);
+
+    // Sorted by path
+    TEST_CHECK_EQ(results[0].path, root + "/run1/d1_canals_06.dem");
+    TEST_CHECK_EQ(results[0].session, root + "/run1");
+    TEST_CHECK_EQ(results[0].mapName, "d1_canals_06");
+    TEST_CHECK_EQ(results[0].lastTick, 100);
+    TEST_CHECK_EQ(results[3].path, root + "/run2/crashed.dem");
+    TEST_CHECK_EQ(results[3].error, DEMERR_TRUNCATED);
+
+    // The crashed demo still counts up to where it ends
+    TEST_CHECK(validator.GetTotalTicks() > 660 && validator.GetTotalTicks() < 700);
+
+    std::vector<MapTicks_t> maps;
+    validator.GetMapTicks(maps);
+    TEST_CHECK_EQ(maps.size(), 2u);
+    TEST_CHECK_EQ(maps[0].mapName, "d1_canals_06");
+    TEST_CHECK_EQ(maps[0].demos, 3u);
+    TEST_CHECK_EQ(maps[0].ticks, 350);
+
+    std::vector<SessionTicks_t> sessions;
+    validator.GetSessionTicks(sessions);
+    TEST_CHECK_EQ(sessions.size(), 3u);
+    TEST_CHECK_EQ(sessions[0].ticks, 600);
+    TEST_CHECK_EQ(sessions[1].session, root + "/run2");
+    TEST_CHECK_EQ(sessions[1].errors, 1u);
+
+    // Single demos work too, missing ones are errors
+    paths.clear();
+    paths.push_back(root + "/run1/d1_canals_07.dem");
+    paths.push_back(root + "/run1/missing.dem");
+    validator.Run(paths);
+    TEST_CHECK_EQ(validator.GetResults().size(), 2u);
+    TEST_CHECK_EQ(validator.GetResults()[1].error, DEMERR_OPEN);
+    TEST_CHECK_EQ(validator.GetTotalTicks(), 300);
+
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        writer.Remove(files[i]);
+    }
+    writer.Shutdown();
+}
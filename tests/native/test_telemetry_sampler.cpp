@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include "latency_stats.h"
+#include "native_test.h"
+#include "spsc_ring.h"
+#include "telemetry_sampler.h"
+
+TEST_CASE(RingFailsWhenFull)
+{
+    CSpscRing<int> ring(5);
+    TEST_CHECK_EQ(ring.GetCapacity(), 8u);
+
+    for (int i = 0; i < 8; i++)
+    {
+        TEST_CHECK(ring.Push(i));
+    }
+    TEST_CHECK(!ring.Push(8));
+    TEST_CHECK_EQ(ring.GetSize(), 8u);
+
+    int values[4];
+    TEST_CHECK_EQ(ring.PopBatch(values, 3), 3u);
+    TEST_CHECK_EQ(values[0], 0);
+    TEST_CHECK_EQ(values[2], 2);
+    TEST_CHECK(ring.Push(8));
+    TEST_CHECK_EQ(ring.PopBatch(values, 4), 4u);
+    TEST_CHECK_EQ(values[0], 3);
+    TEST_CHECK_EQ(ring.GetSize(), 2u);
+}
+
+TEST_CASE(RingKeepsOrderAcrossThreads)
+{
+    const int count = 200000;
+    CSpscRing<int> ring(64);
+
+    std::thread producer([&ring] {
+        for (int i = 0; i < count; i++)
+        {
+            while (!ring.Push(i))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected = 0;
+    bool bOrdered = true;
+    int values[16];
+    while (expected < count)
+    {
+        const size_t popped = ring.PopBatch(values, 16);
+        for (size_t i = 0; i < popped; i++)
+        {
+            bOrdered = bOrdered && values[i] == expected;
+            expected++;
+        }
+        if (popped == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    TEST_CHECK(bOrdered);
+    TEST_CHECK_EQ(ring.GetSize(), 0u);
+}
+
+TEST_CASE(SamplerWritesEveryFrame)
+{
+    const std::string path = GetNativeTestTempPath("telemetry_frames" TELEMETRY_EXTENSION);
+    CTelemetrySampler sampler;
+    TEST_CHECK(sampler.Start(path.c_str()));
+    TEST_CHECK(sampler.IsRunning());
+    TEST_CHECK(!sampler.Start(path.c_str()));
+
+    for (int tick = 0; tick < 3000; tick++)
+    {
+        const uint8_t flags = tick >= 100 ? (TELEMETRY_SIMULATING | TELEMETRY_RECORDING) : TELEMETRY_SIMULATING;
+        sampler.Sample(tick, tick >= 100 ? tick - 100 : -1, 0.015f, flags);
+        if (tick % 1000 == 999)
+        {
+            // Let the drain thread catch up, the ring holds less than a run
+            std::this_thread::sleep_for(std::chrono::milliseconds(2 * TELEMETRY_DRAIN_MS));
+        }
+    }
+    sampler.Stop();
+    TEST_CHECK(!sampler.IsRunning());
+
+    TelemetryStats_t stats;
+    sampler.GetStats(stats);
+    TEST_CHECK_EQ(stats.sampled, 3000u);
+    TEST_CHECK_EQ(stats.dropped, 0u);
+    TEST_CHECK_EQ(stats.written, 3000u);
+    TEST_CHECK(stats.maxDepth <= stats.capacity);
+
+    telemetryheader_t header;
+    std::vector<telemetrysample_t> samples;
+    TEST_CHECK(ReadTelemetryFile(path.c_str(), header, samples));
+    TEST_CHECK_EQ(header.sampleCount, 3000u);
+    TEST_CHECK_EQ(header.dropped, 0u);
+    TEST_CHECK_EQ(samples.size(), 3000u);
+
+    bool bInOrder = true;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        bInOrder = bInOrder && samples[i].hostTick == (int32_t)i;
+        bInOrder = bInOrder && (i == 0 || samples[i].time >= samples[i - 1].time);
+    }
+    TEST_CHECK(bInOrder);
+    TEST_CHECK_EQ(samples[99].demoTick, -1);
+    TEST_CHECK_EQ(samples[99].flags, (uint8_t)TELEMETRY_SIMULATING);
+    TEST_CHECK_EQ(samples[150].demoTick, 50);
+    TEST_CHECK_EQ(samples[150].flags, (uint8_t)(TELEMETRY_SIMULATING | TELEMETRY_RECORDING));
+    TEST_CHECK(samples[150].frameTime == 0.015f);
+
+    remove(path.c_str());
+}
+
+TEST_CASE(FullRingDropsInsteadOfWaiting)
+{
+    const std::string path = GetNativeTestTempPath("telemetry_drops" TELEMETRY_EXTENSION);
+    CTelemetrySampler sampler(16);
+    TEST_CHECK(sampler.Start(path.c_str()));
+
+    // Far faster than the drain thread wakes up
+    const int frames = 100000;
+    for (int tick = 0; tick < frames; tick++)
+    {
+        sampler.Sample(tick, -1, 0.015f, 0);
+    }
+    sampler.Stop();
+
+    TelemetryStats_t stats;
+    sampler.GetStats(stats);
+    TEST_CHECK_EQ(stats.sampled + stats.dropped, (uint64_t)frames);
+    TEST_CHECK(stats.dropped > 0);
+    TEST_CHECK_EQ(stats.written, stats.sampled);
+
+    telemetryheader_t header;
+    std::vector<telemetrysample_t> samples;
+    TEST_CHECK(ReadTelemetryFile(path.c_str(), header, samples));
+    TEST_CHECK_EQ(header.dropped, stats.dropped);
+    TEST_CHECK_EQ(samples.size(), (size_t)stats.written);
+
+    std::string table;
+    sampler.FormatTable(table);
+    TEST_CHECK(table.find("dropped") != std::string::npos);
+
+    remove(path.c_str());
+}
+
+TEST_CASE(UnfinishedFileStillReads)
+{
+    const std::string path = GetNativeTestTempPath("telemetry_crash" TELEMETRY_EXTENSION);
+    CTelemetrySampler sampler;
+    TEST_CHECK(sampler.Start(path.c_str()));
+    for (int tick = 0; tick < 10; tick++)
+    {
+        sampler.Sample(tick, -1, 0.015f, 0);
+    }
+    sampler.Stop();
+
+    // What a crash leaves behind: no counts in the header, half a sample at the end
+    FILE* file = fopen(path.c_str(), "r+b");
+    TEST_CHECK(file != NULL);
+    telemetryheader_t header;
+    TEST_CHECK_EQ(fread(&header, sizeof(header), 1, file), 1u);
+    header.sampleCount = 0;
+    header.dropped = 0;
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    fseek(file, 0, SEEK_END);
+    fwrite("junk", 4, 1, file);
+    fclose(file);
+
+    std::vector<telemetrysample_t> samples;
+    TEST_CHECK(ReadTelemetryFile(path.c_str(), header, samples));
+    TEST_CHECK_EQ(header.sampleCount, 0u);
+    TEST_CHECK_EQ(samples.size(), 10u);
+    TEST_CHECK_EQ(samples[9].hostTick, 9);
+
+    header.magic = 0;
+    file = fopen(path.c_str(), "r+b");
+    fwrite(&header, sizeof(header), 1, file);
+    fclose(file);
+    TEST_CHECK(!ReadTelemetryFile(path.c_str(), header, samples));
+
+    remove(path.c_str());
+}
+
+TEST_CASE(RingLargeEnoughKeepsEverySample)
+{
+    const std::string path = GetNativeTestTempPath("telemetry_burst" TELEMETRY_EXTENSION);
+    CTelemetrySampler sampler(1 << 20);
+    TEST_CHECK(sampler.Start(path.c_str()));
+
+    const int frames = 200000;
+    for (int tick = 0; tick < frames; tick++)
+    {
+        sampler.Sample(tick, tick, 0.015f, TELEMETRY_SIMULATING);
+    }
+    sampler.Stop();
+
+    TelemetryStats_t stats;
+    sampler.GetStats(stats);
+    TEST_CHECK_EQ(stats.sampled, (uint64_t)frames);
+    TEST_CHECK_EQ(stats.dropped, 0u);
+    TEST_CHECK_EQ(stats.written, (uint64_t)frames);
+
+    telemetryheader_t header;
+    std::vector<telemetrysample_t> samples;
+    TEST_CHECK(ReadTelemetryFile(path.c_str(), header, samples));
+    TEST_CHECK_EQ(samples.size(), (size_t)frames);
+    TEST_CHECK_EQ(samples.back().hostTick, frames - 1);
+
+    remove(path.c_str());
+}
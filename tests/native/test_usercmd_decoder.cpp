@@ -0,0 +1,176 @@
+#include <string.h>
+
+#include "bit_buffer.h"
+#include "demo_builder.h"
+#include "native_test.h"
+#include "usercmd_decoder.h"
+
+static UserCmd_t MakeCmd()
+{
+    UserCmd_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.commandNumber = 4711;
+    cmd.tickCount = 1234;
+    cmd.viewAngles[0] = -12.5f;
+    cmd.viewAngles[1] = 270.25f;
+    cmd.forwardMove = 400.0f;
+    cmd.sideMove = -175.0f;
+    cmd.buttons = 0x00000022;
+    cmd.impulse = 101;
+    cmd.weaponSelect = 1500;
+    cmd.weaponSubtype = 3;
+    cmd.mouseDx = -42;
+    cmd.mouseDy = 7;
+    return cmd;
+}
+
+static std::string Encode(const UserCmd_t& cmd)
+{
+    CBitWriter writer;
+    EncodeUserCmd(cmd, writer);
+    return std::string(writer.GetBytes().begin(), writer.GetBytes().end());
+}
+
+TEST_CASE(ReadsBitsAcrossBytes)
+{
+    CBitWriter writer;
+    writer.WriteBits(5, 3);
+    writer.WriteBits(0xDEADBEEF, 32);
+    writer.WriteBits(0x7FF, 11);
+    writer.WriteBits(0xFFFF, 16);
+    writer.WriteFloat(3.5f);
+    TEST_CHECK_EQ(writer.GetBitCount(), 94u);
+
+    CBitReader reader(writer.GetBytes().data(), writer.GetBytes().size());
+    TEST_CHECK_EQ(reader.ReadBits(3), 5u);
+    TEST_CHECK_EQ(reader.ReadBits(32), 0xDEADBEEFu);
+    TEST_CHECK_EQ(reader.PeekBits(11), 0x7FFu);
+    TEST_CHECK_EQ(reader.ReadBits(11), 0x7FFu);
+    TEST_CHECK_EQ(reader.ReadSignedBits(16), -1);
+    TEST_CHECK(reader.ReadFloat() == 3.5f);
+    TEST_CHECK(!reader.IsOverflowed());
+    TEST_CHECK_EQ(reader.GetBitsLeft(), 2u);
+
+    // Past the end reads zeros and says so
+    TEST_CHECK_EQ(reader.ReadBits(8), 0u);
+    TEST_CHECK(reader.IsOverflowed());
+}
+
+TEST_CASE(ReadsOptionalFields)
+{
+    CBitWriter writer;
+    writer.WriteBit(false);
+    writer.WriteBit(true);
+    writer.WriteBits(0x12345678, 32);
+    writer.WriteBit(true);
+    writer.WriteBits(0xAB, 8);
+
+    CBitReader reader(writer.GetBytes().data(), writer.GetBytes().size());
+    bool bPresent = true;
+    TEST_CHECK_EQ(reader.ReadOptional(32, bPresent), 0u);
+    TEST_CHECK(!bPresent);
+    TEST_CHECK_EQ(reader.GetPosition(), 1u);
+    TEST_CHECK_EQ(reader.ReadOptional(32, bPresent), 0x12345678u);
+    TEST_CHECK(bPresent);
+    TEST_CHECK_EQ(reader.ReadOptional(8, bPresent), 0xABu);
+    TEST_CHECK_EQ(reader.GetPosition(), 43u);
+    TEST_CHECK(!reader.IsOverflowed());
+}
+
+TEST_CASE(DecodesWhatTheClientWrites)
+{
+    const UserCmd_t expected = MakeCmd();
+    const std::string payload = Encode(expected);
+
+    UserCmd_t cmd;
+    TEST_CHECK(DecodeUserCmd((const uint8_t*)payload.data(), payload.size(), cmd));
+    TEST_CHECK_EQ(cmd.commandNumber, 4711);
+    TEST_CHECK_EQ(cmd.tickCount, 1234);
+    TEST_CHECK(cmd.viewAngles[0] == -12.5f);
+    TEST_CHECK(cmd.viewAngles[1] == 270.25f);
+    TEST_CHECK(cmd.viewAngles[2] == 0.0f);
+    TEST_CHECK(cmd.forwardMove == 400.0f);
+    TEST_CHECK(cmd.sideMove == -175.0f);
+    TEST_CHECK(cmd.upMove == 0.0f);
+    TEST_CHECK_EQ(cmd.buttons, 0x22u);
+    TEST_CHECK_EQ(cmd.impulse, 101);
+    TEST_CHECK_EQ(cmd.weaponSelect, 1500);
+    TEST_CHECK_EQ(cmd.weaponSubtype, 3);
+    TEST_CHECK_EQ(cmd.mouseDx, -42);
+    TEST_CHECK_EQ(cmd.mouseDy, 7);
+    TEST_CHECK_EQ(cmd.fields & (1 << USERCMD_VIEWANGLE_ROLL), 0);
+    TEST_CHECK(cmd.fields & (1 << USERCMD_WEAPONSUBTYPE));
+    TEST_CHECK(cmd.fields & (1 << USERCMD_MOUSEDY));
+}
+
+TEST_CASE(FillsInFieldsThatWereLeftOut)
+{
+    // The null command's counters + 1 and zeros for everything else, 14 zero bits
+    UserCmd_t empty;
+    memset(&empty, 0, sizeof(empty));
+    empty.commandNumber = 1;
+    empty.tickCount = 1;
+    const std::string payload = Encode(empty);
+    TEST_CHECK_EQ(payload.size(), 2u);
+
+    UserCmd_t cmd = MakeCmd();
+    TEST_CHECK(DecodeUserCmd((const uint8_t*)payload.data(), payload.size(), cmd));
+    TEST_CHECK_EQ(cmd.commandNumber, 1);
+    TEST_CHECK_EQ(cmd.tickCount, 1);
+    TEST_CHECK_EQ(cmd.buttons, 0u);
+    TEST_CHECK_EQ(cmd.weaponSubtype, 0);
+    TEST_CHECK_EQ(cmd.mouseDx, 0);
+    TEST_CHECK_EQ(cmd.fields, 0);
+
+    // Extra bits a game adds after the mouse deltas don't matter
+    const std::string padded = payload + std::string(4, '\xff');
+    TEST_CHECK(DecodeUserCmd((const uint8_t*)padded.data(), padded.size(), cmd));
+    TEST_CHECK_EQ(cmd.fields, 0);
+}
+
+TEST_CASE(ReportsTruncatedPayloads)
+{
+    const std::string payload = Encode(MakeCmd());
+    UserCmd_t cmd;
+    TEST_CHECK(!DecodeUserCmd((const uint8_t*)payload.data(), payload.size() - 3, cmd));
+    TEST_CHECK_EQ(cmd.commandNumber, 4711);
+    TEST_CHECK(!DecodeUserCmd(NULL, 0, cmd));
+}
+
+TEST_CASE(DecodesEveryUserCmdOfADemo)
+{
+    CDemoBuilder builder;
+    builder.Message(DEM_SIGNON, 0, std::string(300, 's'));
+    builder.Message(DEM_SYNCTICK, 0);
+    UserCmd_t cmd = MakeCmd();
+    for (int32_t tick = 1; tick <= 50; tick++)
+    {
+        cmd.commandNumber = 1000 + tick;
+        cmd.buttons = tick % 10 < 5 ? 2u : 0u;
+        cmd.viewAngles[1] = (float)tick;
+        builder.Message(DEM_PACKET, tick, std::string(40, 'p'));
+        builder.Message(DEM_USERCMD, tick, Encode(cmd));
+    }
+    builder.Message(DEM_USERCMD, 51, "\x01");
+    builder.Message(DEM_STOP, 51);
+
+    UserCmdTable_t table;
+    TEST_CHECK_EQ(DecodeDemoUserCmds(builder.Bytes().data(), builder.Bytes().size(), table), 51u);
+    TEST_CHECK_EQ(table.Size(), 51u);
+    TEST_CHECK_EQ(table.truncated, 1u);
+    TEST_CHECK_EQ(table.demoTick[0], 1);
+    TEST_CHECK_EQ(table.sequence[9], 10);
+    TEST_CHECK_EQ(table.commandNumber[9], 1010);
+    TEST_CHECK(table.yaw[9] == 10.0f);
+    TEST_CHECK_EQ(table.buttons[4], 0u);
+    TEST_CHECK_EQ(table.buttons[3], 2u);
+    TEST_CHECK_EQ(table.mouseDx[49], -42);
+    TEST_CHECK_EQ(table.fields.size(), 51u);
+
+    // Appends to what is already there
+    DecodeDemoUserCmds(builder.Bytes().data(), builder.Bytes().size(), table);
+    TEST_CHECK_EQ(table.Size(), 102u);
+    table.Clear();
+    TEST_CHECK_EQ(table.Size(), 0u);
+    TEST_CHECK_EQ(table.truncated, 0u);
+}
@@ -0,0 +1,188 @@
+#include <string.h>
+
+#include "demo_builder.h"
+#include "demo_index.h"
+#include "demorecord_session.h"
+#include "fake_demorecord_host.h"
+#include "native_test.h"
+#include "vdm_playlist.h"
+
+static journalrecord_t MakeRecord(JournalRecordType type, uint32_t sequence, const char* demoName, int tick)
+{
+    journalrecord_t record;
+    BuildJournalRecord(record, type, sequence, "d1_canals_06", 0, demoName, 0, tick);
+    return record;
+}
+
+static struct tm MakeSessionTime()
+{
+    struct tm ltime;
+    memset(&ltime, 0, sizeof(ltime));
+    ltime.tm_year = 2024;
+    ltime.tm_mon = 3;
+    ltime.tm_mday = 14;
+    return ltime;
+}
+
+TEST_CASE(OrdersDemosByJournal)
+{
+    std::vector<journalrecord_t> records;
+    records.push_back(MakeRecord(JOURNAL_START, 0, "", -1));
+    records.push_back(MakeRecord(JOURNAL_RECORD, 1, "b", 100));
+    records.push_back(MakeRecord(JOURNAL_STOP, 2, "b", 500));
+    records.push_back(MakeRecord(JOURNAL_RECORD, 3, "a", 700));
+    records.push_back(MakeRecord(JOURNAL_STOP, 4, "a", -1));
+    records.push_back(MakeRecord(JOURNAL_RECORD, 5, "c", 900));
+
+    // Recorded again after a resume, the first take is gone
+    records.push_back(MakeRecord(JOURNAL_RECORD, 6, "b", 1000));
+    records.push_back(MakeRecord(JOURNAL_STOP, 7, "b", 250));
+
+    std::vector<PlaylistDemo_t> demos;
+    BuildPlaylist(records, demos);
+    TEST_CHECK_EQ(demos.size(), 3u);
+    TEST_CHECK_EQ(demos[0].demoName, "a");
+    TEST_CHECK_EQ(demos[0].endTick, PLAYLIST_NO_TICK);
+    TEST_CHECK_EQ(demos[1].demoName, "c");
+    TEST_CHECK_EQ(demos[1].endTick, PLAYLIST_NO_TICK);
+    TEST_CHECK_EQ(demos[2].demoName, "b");
+    TEST_CHECK_EQ(demos[2].endTick, 250);
+}
+
+TEST_CASE(FormatsLikeConstructVdm)
+{
+    PlaylistOptions_t options;
+    std::string vdm;
+    FormatVdm(options, 1234, "./2024.03.14-00.00.00/d1_canals_07", vdm);
+    TEST_CHECK_EQ(vdm,
+                  "demoactions\n"
+                  "{\n"
+                  "    \"1\"\n"
+                  "    {\n"
+                  "        factory \"PlayCommands\"\n"
+                  "        name \"Execute command\"\n"
+                  "        starttick \"1232\"\n"
+                  "        commands \"wait 200; playdemo ./2024.03.14-00.00.00/d1_canals_07\"\n"
+                  "    }\n"
+                  "    \"2\"\n"
+                  "    {\n"
+                  "        factory \"ChangePlaybackRate\"\n"
+                  "        name \"Play demo fast\"\n"
+                  "        starttick \"0\"\n"
+                  "        playbackrate \"10.000000\"\n"
+                  "    }\n"
+                  "}");
+
+    // No rate change, no wait, quotes can't end the string early
+    options.playbackRate = 0.0;
+    options.waitFrames = 0;
+    options.finalCommands = "echo \"done\"; exit";
+    FormatVdm(options, 1, NULL, vdm);
+    TEST_CHECK(vdm.find("ChangePlaybackRate") == std::string::npos);
+    TEST_CHECK(vdm.find("starttick \"0\"") != std::string::npos);
+    TEST_CHECK(vdm.find("commands \"echo 'done'; exit\"") != std::string::npos);
+}
+
+TEST_CASE(ChainsTheSessionWithoutReadingDemos)
+{
+    CFakeDemoRecordHost host;
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+
+    session.Start("speedrun/", MakeSessionTime());
+    const std::string dir = session.GetSessionDir();
+    host.LoadMap(session, "d1_canals_06", 50);
+    host.LoadMap(session, "d1_canals_06", 20);
+    host.LoadMap(session, "d1_canals_07", 30);
+    session.Stop("speedrun/");
+    host.RunCommands();
+
+    // The engine's files are placeholders, a demo read would fail to find any tick
+    const PlaylistResult_t result = session.WritePlaylist(PlaylistOptions_t());
+    TEST_CHECK_EQ(result.written, 3u);
+    TEST_CHECK_EQ(result.fromIndex, 0u);
+    TEST_CHECK_EQ(result.skipped, 0u);
+
+    const std::vector<std::string> names = host.GetRecordedDemoNames();
+    TEST_CHECK_EQ(names.size(), 3u);
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        const std::string name = names[i].substr(0, names[i].size() - 4);
+        const std::string& vdm = host.m_Files[dir + name + ".vdm"];
+        if (i + 1 < names.size())
+        {
+            const std::string next = names[i + 1].substr(0, names[i + 1].size() - 4);
+            TEST_CHECK(vdm.find("playdemo " + dir + next + "\"") != std::string::npos);
+        }
+        else
+        {
+            TEST_CHECK(vdm.find("wait 200; exit\"") != std::string::npos);
+        }
+    }
+
+    // Ticks are where the fake engine stopped each demo
+    std::vector<journalrecord_t> records;
+    const std::string& journal = host.m_Files[dir + JOURNAL_FILE_NAME];
+    ReadJournal(journal.data(), journal.size(), records);
+    TEST_CHECK_EQ(records.size(), 7u);
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        if (records[i].type != JOURNAL_STOP)
+            continue;
+        TEST_CHECK(records[i].tick > 10);
+        const std::string& vdm = host.m_Files[dir + records[i].demoName + ".vdm"];
+        TEST_CHECK(vdm.find("starttick \"" + std::to_string(records[i].tick - PLAYLIST_END_TICK_MARGIN) + "\"") !=
+                   std::string::npos);
+    }
+
+    // After a restart the journal on disk gives the same chain
+    CDemoRecordSession restarted(host, stats);
+    std::map<std::string, std::string> before = host.m_Files;
+    std::vector<std::string> demoPaths;
+    TEST_CHECK_EQ(restarted.WritePlaylist(PlaylistOptions_t(), dir.c_str(), &demoPaths).written, 3u);
+    TEST_CHECK(host.m_Files == before);
+
+    // In play order, as the engine wrote them
+    TEST_CHECK(demoPaths == host.m_RecordedDemos);
+}
+
+TEST_CASE(FallsBackToTheIndex)
+{
+    CFakeDemoRecordHost host;
+    const std::string dir = "speedrun/2024.03.14-00.00.00\\";
+
+    // An engine that can't tell the demo tick journals -1
+    std::string journal;
+    const char* const s_Names[] = {"d1_canals_06", "d1_canals_06_1", "d1_canals_07"};
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        journalrecord_t record = MakeRecord(JOURNAL_RECORD, i * 2, s_Names[i], 0);
+        journal.append((const char*)&record, sizeof(record));
+        record = MakeRecord(JOURNAL_STOP, i * 2 + 1, s_Names[i], -1);
+        journal.append((const char*)&record, sizeof(record));
+    }
+    host.m_Files[dir + JOURNAL_FILE_NAME] = journal;
+
+    // The indexer got to two of them
+    for (int i = 0; i < 2; i++)
+    {
+        CDemoBuilder builder;
+        builder.Typical(300 + i * 100);
+        CDemoIndex index;
+        index.Build(builder.Bytes().data(), builder.Bytes().size());
+        index.Serialize(host.m_Files[dir + s_Names[i] + DEMO_INDEX_EXTENSION]);
+    }
+
+    CLatencyStats stats;
+    CDemoRecordSession session(host, stats);
+    const PlaylistResult_t result = session.WritePlaylist(PlaylistOptions_t(), "speedrun/2024.03.14-00.00.00");
+    TEST_CHECK_EQ(result.written, 2u);
+    TEST_CHECK_EQ(result.fromIndex, 2u);
+    TEST_CHECK_EQ(result.skipped, 1u);
+    TEST_CHECK(host.m_Files[dir + "d1_canals_06.vdm"].find("starttick \"298\"") != std::string::npos);
+    TEST_CHECK(host.m_Files[dir + "d1_canals_06.vdm"].find("playdemo " + dir + "d1_canals_06_1\"") !=
+               std::string::npos);
+    TEST_CHECK(host.m_Files[dir + "d1_canals_06_1.vdm"].find("starttick \"398\"") != std::string::npos);
+    TEST_CHECK(host.m_Files[dir + "d1_canals_06_1.vdm"].find("exit\"") != std::string::npos);
+    TEST_CHECK(host.m_Files.count(dir + "d1_canals_07.vdm") == 0);
+}
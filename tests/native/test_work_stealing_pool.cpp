@@ -0,0 +1,75 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "native_test.h"
+#include "work_stealing_pool.h"
+
+TEST_CASE(RunsEveryTaskOnce)
+{
+    std::vector<std::atomic<int> > runs(1000);
+    {
+        CWorkStealingPool pool(4);
+        TEST_CHECK_EQ(pool.GetThreadCount(), 4u);
+        for (size_t i = 0; i < runs.size(); i++)
+        {
+            pool.Submit([&runs, i] { runs[i]++; });
+        }
+        pool.Wait();
+    }
+
+    for (size_t i = 0; i < runs.size(); i++)
+    {
+        TEST_CHECK_EQ(runs[i].load(), 1);
+    }
+}
+
+TEST_CASE(WaitsForTasksSubmittedByTasks)
+{
+    std::atomic<int> leaves(0);
+    CWorkStealingPool pool(3);
+
+    // A tree like a directory walk: every task fans out until depth 6
+    std::function<void(int)> fanOut;
+    fanOut = [&](int depth) {
+        if (depth == 6)
+        {
+            leaves++;
+            return;
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            pool.Submit([&fanOut, depth] { fanOut(depth + 1); });
+        }
+    };
+    pool.Submit([&fanOut] { fanOut(0); });
+    pool.Wait();
+    TEST_CHECK_EQ(leaves.load(), 729);
+
+    // Reusable after a Wait
+    pool.Submit([&leaves] { leaves++; });
+    pool.Wait();
+    TEST_CHECK_EQ(leaves.load(), 730);
+}
+
+TEST_CASE(IdleWorkersSteal)
+{
+    CWorkStealingPool pool(4);
+    std::atomic<int> done(0);
+
+    // Everything lands on the worker running this task, the others only get work by stealing
+    pool.Submit([&pool, &done] {
+        for (int i = 0; i < 64; i++)
+        {
+            pool.Submit([&done] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                done++;
+            });
+        }
+    });
+    pool.Wait();
+
+    TEST_CHECK_EQ(done.load(), 64);
+    TEST_CHECK(pool.GetSteals() > 0u);
+}
@@ -36,6 +36,8 @@ RE_LOADED_PLUGINS = re.compile(
     r"Loaded plugins:\n-+\n((?:(?:[0-9]+:[ \t]+\"[^\"]+\")\n?)*)-+",
     re.MULTILINE)
 RE_QUOTE_GROUP = re.compile(r"[0-9]:+[\t\s]+\"([^\"]+)\"")
+RE_RECORD_START_LATENCY = re.compile(
+    r"\[Speedrun\] (\S+) started recording (-?[0-9]+) ticks after spawn")
 SPEEDRUN_DEMORECORD_DEMO_FOLDER: str = "./integration_tests/"
 SPEEDRUN_DEMORECORD_DESCRIPTION: str = "Speedrun Demo Record, Maxx"
 SPEEDRUN_DEMORECORD_PLUGIN_NAME: str = "speedrun_demorecord"
@@ -163,8 +165,9 @@ def test_demo_playback_doesnt_crash(setup_teardown) -> None:
     # Execute commands and speedrun_start accordingly
     proc_args: List[str] = source_game.launch_args
     proc_args.extend([
-        "-nomouse", "+plugin_load", SPEEDRUN_DEMORECORD_PLUGIN_NAME,
-        "+speedrun_dir", SPEEDRUN_DEMORECORD_DEMO_FOLDER, "+exec",
+        "-nomouse", "+developer", "1", "+plugin_load",
+        SPEEDRUN_DEMORECORD_PLUGIN_NAME, "+speedrun_dir",
+        SPEEDRUN_DEMORECORD_DEMO_FOLDER, "+exec",
         source_game.test_data_playback_cfg_path
     ])
 
@@ -180,7 +183,13 @@ def test_demo_playback_doesnt_crash(setup_teardown) -> None:
                    stderr=subprocess.STDOUT,
                    check=True)
 
-    con_log_contents: List[str] = get_console_output(source_game).split()
+    con_log_raw: str = get_console_output(source_game)
+    con_log_contents: List[str] = con_log_raw.split()
+
+    # Report how far from the spawn each demo started recording (developer 1)
+    for demo_name, ticks in RE_RECORD_START_LATENCY.findall(con_log_raw):
+        print(f"{source_game.game_tag}: {demo_name} started recording "
+              f"{ticks} ticks after spawn")
 
     # Ensure the expected version exists
     assert SPEEDRUN_DEMORECORD_VERSION in con_log_contents
@@ -199,14 +208,24 @@ def test_demo_playback_doesnt_crash(setup_teardown) -> None:
     # Ensure the folder has the correct date/time format
     assert RE_EXPECTED_DATETIME_DIR.fullmatch(game_srdf_folder) is not None
 
-    # Ensure all the files in this folder are .dem files and also have the
-    # expected names. Ensure expected number of demos as well.
+    # Ensure the .dem files in this folder have the expected names. Ensure
+    # expected number of demos as well. The only other files are the session
+    # journal, the .dmi tick indexes of the demos, the digest speedrun_stop
+    # seals the session with and the bookmarks of the games whose
+    # playback.cfg runs speedrun_bookmark.
     game_srdf_folder_abspath: str = os.path.join(game_srdf, game_srdf_folder)
+    game_srdf_folder_contents: List[str] = os.listdir(game_srdf_folder_abspath)
+    assert "speedrun_democrecord.journal" in game_srdf_folder_contents
     sorted_file_list: List[str] = sorted([
         os.path.join(game_srdf_folder_abspath, x)
-        for x in os.listdir(game_srdf_folder_abspath)
+        for x in game_srdf_folder_contents if x.endswith(".dem")
     ],
                                          key=lambda x: os.path.getctime(x))
+    for item in game_srdf_folder_contents:
+        assert item.endswith((".dem", ".dmi")) or \
+            item in ("speedrun_democrecord.journal",
+                     "speedrun_democrecord.digest",
+                     "speedrun_democrecord.bookmarks")
 
     # Assert that the number of expected demo files matches. Required so we
     # match file names in next test.
@@ -0,0 +1,67 @@
+//---------------------------------------------------------------------------------
+// Purpose: parse throughput of the native demo reader, compare with tests/bench_demo_parse.py
+//
+//  bench_demo_parse [-n iterations] <demo.dem>...
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "demo_file.h"
+
+int main(int argc, char** argv)
+{
+    int iterations = 10;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+        iterations = atoi(argv[2]);
+        first += 2;
+    }
+
+    if (first >= argc || iterations <= 0)
+    {
+        fprintf(stderr, "usage: %s [-n iterations] <demo.dem>...\n", argv[0]);
+        return 2;
+    }
+
+    uint64_t bytes = 0;
+    uint64_t messages = 0;
+    int64_t tickChecksum = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        for (int i = first; i < argc; i++)
+        {
+            // Open inside the loop so mapping cost is part of the measurement, same as the Python open()
+            CDemoFile demo;
+            DemoError error = demo.Open(argv[i]);
+            if (error != DEMERR_NONE)
+            {
+                fprintf(stderr, "%s: %s\n", argv[i], DemoErrorToString(error));
+                return 1;
+            }
+
+            DemoSummary_t summary;
+            SummarizeDemo(demo.GetData(), demo.GetSize(), summary);
+            for (int type = 0; type < DEMO_MSG_TYPE_COUNT; type++)
+            {
+                messages += summary.messageCounts[type];
+            }
+            tickChecksum += summary.lastTick;
+            bytes += demo.GetSize();
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("files      %d x %d\n", argc - first, iterations);
+    printf("bytes      %llu\n", (unsigned long long)bytes);
+    printf("messages   %llu\n", (unsigned long long)messages);
+    printf("ticks      %lld\n", (long long)tickChecksum);
+    printf("seconds    %.6f\n", seconds);
+    printf("GB/s       %.3f\n", seconds > 0.0 ? (double)bytes / seconds / 1e9 : 0.0);
+    return 0;
+}
@@ -0,0 +1,140 @@
+//---------------------------------------------------------------------------------
+// Purpose: usercmd decoding throughput
+//
+//  bench_usercmd_decode [-n iterations] [-c commands] [demo.dem...]
+//      without demos, decodes that many synthetic commands (1000000 by default) shaped like real input: the view
+//      turns every tick, movement and buttons change every few ticks, weapon switches are rare
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "demo_file.h"
+#include "usercmd_decoder.h"
+
+struct Payload_t
+{
+    size_t offset;
+    size_t size;
+};
+
+static void BuildCommands(uint32_t count, std::vector<uint8_t>& bytes, std::vector<Payload_t>& payloads)
+{
+    uint32_t seed = 12345;
+    UserCmd_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    for (uint32_t i = 0; i < count; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        cmd.commandNumber = (int32_t)(i + 100);
+        cmd.tickCount = (int32_t)(i + 40);
+        cmd.viewAngles[0] = (float)(seed % 1780) / 20.0f - 89.0f;
+        cmd.viewAngles[1] = (float)(seed % 3600) / 10.0f;
+        if (i % 8 == 0)
+        {
+            cmd.forwardMove = seed & 1 ? 400.0f : 0.0f;
+            cmd.sideMove = seed & 2 ? -400.0f : 0.0f;
+            cmd.buttons = (seed >> 8) & 0x27;
+        }
+        cmd.weaponSelect = (uint16_t)(i % 500 == 0 ? 1 + seed % 20 : 0);
+        cmd.mouseDx = (int16_t)((int)(seed >> 16 & 31) - 16);
+        cmd.mouseDy = (int16_t)((int)(seed >> 21 & 15) - 8);
+
+        CBitWriter writer;
+        EncodeUserCmd(cmd, writer);
+        Payload_t payload = {bytes.size(), writer.GetBytes().size()};
+        bytes.insert(bytes.end(), writer.GetBytes().begin(), writer.GetBytes().end());
+        payloads.push_back(payload);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = 10;
+    uint32_t commands = 1000000;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            iterations = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            commands = (uint32_t)atoi(argv[++i]);
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (iterations <= 0 || commands == 0)
+    {
+        fprintf(stderr, "usage: %s [-n iterations] [-c commands] [demo.dem...]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> bytes;
+    std::vector<Payload_t> payloads;
+    if (paths.empty())
+    {
+        BuildCommands(commands, bytes, payloads);
+    }
+
+    uint64_t decoded = 0;
+    uint64_t payloadBytes = 0;
+    int64_t checksum = 0;
+    UserCmdTable_t table;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        table.Clear();
+        if (paths.empty())
+        {
+            table.Reserve(payloads.size());
+            for (size_t i = 0; i < payloads.size(); i++)
+            {
+                UserCmd_t cmd;
+                DecodeUserCmd(bytes.data() + payloads[i].offset, payloads[i].size, cmd);
+                table.Append((int32_t)i, (int32_t)i, cmd);
+            }
+            payloadBytes += bytes.size();
+        }
+        else
+        {
+            for (size_t i = 0; i < paths.size(); i++)
+            {
+                CDemoFile demo;
+                DemoError error = demo.Open(paths[i].c_str());
+                if (error != DEMERR_NONE)
+                {
+                    fprintf(stderr, "%s: %s\n", paths[i].c_str(), DemoErrorToString(error));
+                    return 1;
+                }
+                DecodeDemoUserCmds(demo.GetData(), demo.GetSize(), table);
+                payloadBytes += demo.GetSize();
+            }
+        }
+
+        decoded += table.Size();
+        for (size_t i = 0; i < table.Size(); i += 97)
+        {
+            checksum += table.commandNumber[i] + (int64_t)table.buttons[i];
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("usercmds   %llu\n", (unsigned long long)decoded);
+    printf("bytes      %llu\n", (unsigned long long)payloadBytes);
+    printf("checksum   %lld\n", (long long)checksum);
+    printf("seconds    %.6f\n", seconds);
+    printf("M cmds/s   %.2f\n", seconds > 0.0 ? (double)decoded / seconds / 1e6 : 0.0);
+    printf("MB/s       %.1f\n", seconds > 0.0 ? (double)payloadBytes / seconds / 1e6 : 0.0);
+    return 0;
+}
@@ -0,0 +1,123 @@
+//---------------------------------------------------------------------------------
+// Purpose: prints the bookmarks of every session in a speedrun_dir, see bookmark_store.h
+//
+//  bookmark_export [-l] [-s session] [-m map] [-t tag] <speedrun_dir>
+//      the text speedrun_bookmark used to append to speedrun_democrecord_bookmarks.txt, of the bookmarks matching all
+//      the filters given. -l prints one line per bookmark instead.
+//
+// Every session dir is looked at, the catalog the plugin keeps is only there to save it the walk.
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "bookmark_store.h"
+#include "file_list.h"
+
+static void PrintUsage(const char* name)
+{
+    fprintf(stderr, "usage: %s [-l] [-s session] [-m map] [-t tag] <speedrun_dir>\n", name);
+}
+
+int main(int argc, char** argv)
+{
+    BookmarkQuery_t query;
+    bool bLines = false;
+    const char* speedrunDir = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-l") == 0)
+        {
+            bLines = true;
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            query.session = argv[++i];
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            query.mapName = argv[++i];
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            query.tag = argv[++i];
+        }
+        else if (argv[i][0] != '-' && !speedrunDir)
+        {
+            speedrunDir = argv[i];
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (!speedrunDir)
+    {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    std::string baseDir = speedrunDir;
+    if (baseDir.find_last_of("/\\") != baseDir.size() - 1)
+    {
+        baseDir += "/";
+    }
+
+    // speedrun_segment's bookmarks are in speedrun_dir itself
+    std::vector<std::string> sessionDirs(1, baseDir);
+    std::vector<std::string> subdirs;
+    ListDirectory(baseDir, NULL, &subdirs);
+    for (size_t i = 0; i < subdirs.size(); i++)
+    {
+        sessionDirs.push_back(baseDir + subdirs[i] + "/");
+    }
+
+    CBookmarkStore store;
+    for (size_t i = 0; i < sessionDirs.size(); i++)
+    {
+        std::string contents;
+        if (!ReadWholeFile(sessionDirs[i] + BOOKMARK_FILE_NAME, contents))
+            continue;
+
+        if (store.AddFile(sessionDirs[i], contents.data(), contents.size()).torn)
+        {
+            fprintf(stderr,
+                    "%s%s: torn or damaged after the last valid bookmark\n",
+                    sessionDirs[i].c_str(),
+                    BOOKMARK_FILE_NAME);
+        }
+    }
+
+    std::vector<uint32_t> ids;
+    store.Find(query, ids);
+    if (!bLines)
+    {
+        std::string text;
+        store.FormatText(ids, text);
+        fwrite(text.data(), 1, text.size(), stdout);
+        return 0;
+    }
+
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        const bookmarkrecord_t& bookmark = store.Get(ids[i]);
+        printf("%04u/%02u/%02u %02u:%02u:%02u\t%s\t%s\t%s\t%d\t%s\n",
+               (unsigned)bookmark.year,
+               (unsigned)bookmark.month,
+               (unsigned)bookmark.day,
+               (unsigned)bookmark.hour,
+               (unsigned)bookmark.minute,
+               (unsigned)bookmark.second,
+               bookmark.session,
+               bookmark.mapName,
+               bookmark.demoName,
+               bookmark.tick,
+               bookmark.tag);
+    }
+    return 0;
+}
@@ -0,0 +1,182 @@
+//---------------------------------------------------------------------------------
+// Purpose: writes deterministic synthetic demos and sessions to benchmark the other tools on, see demo_synth.h
+//
+//  demo_gen [-s seed] [-t ticks | -b size] [-p packetBytes] [-m map] [-g gameDir] <out.dem>
+//      one demo, 4000 ticks of input by default. -b sizes it by bytes instead (K, M or G suffix, "4G" works), it is
+//      streamed to disk so any size takes constant memory.
+//  demo_gen -S sessions [-s seed] [-t ticks] [-p packetBytes] [-n maps] [-r maxRetries] <baseDir>
+//      that many session dirs named like speedrun_start's, a day apart, each with 8 maps by default recorded once
+//      plus up to 3 cut short reloads, and the journal
+//
+// The same arguments always write the same bytes.
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "demo_synth.h"
+
+static bool ParseSize(const char* text, uint64_t& bytes)
+{
+    char* end = NULL;
+    const double value = strtod(text, &end);
+    if (end == text || value <= 0.0)
+        return false;
+
+    double scale = 1.0;
+    switch (*end)
+    {
+        case 'K':
+        case 'k':
+            scale = 1024.0;
+            break;
+        case 'M':
+        case 'm':
+            scale = 1024.0 * 1024.0;
+            break;
+        case 'G':
+        case 'g':
+            scale = 1024.0 * 1024.0 * 1024.0;
+            break;
+        case '\0':
+            break;
+        default:
+            return false;
+    }
+    bytes = (uint64_t)(value * scale);
+    return true;
+}
+
+static void PrintUsage(const char* name)
+{
+    fprintf(stderr,
+            "usage: %s [-s seed] [-t ticks | -b size] [-p packetBytes] [-m map] [-g gameDir] <out.dem>\n"
+            "       %s -S sessions [-s seed] [-t ticks] [-p packetBytes] [-n maps] [-r maxRetries] <baseDir>\n",
+            name,
+            name);
+}
+
+int main(int argc, char** argv)
+{
+    SynthDemoOptions_t demoOptions;
+    SynthSessionOptions_t sessionOptions;
+    uint64_t sizeBytes = 0;
+    long sessions = 0;
+    const char* out = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            demoOptions.seed = strtoull(argv[++i], NULL, 10);
+            sessionOptions.seed = demoOptions.seed;
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            demoOptions.ticks = atoi(argv[++i]);
+            sessionOptions.ticks = demoOptions.ticks;
+        }
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            if (!ParseSize(argv[++i], sizeBytes))
+            {
+                PrintUsage(argv[0]);
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            demoOptions.packetBytes = (uint32_t)atoi(argv[++i]);
+            sessionOptions.packetBytes = demoOptions.packetBytes;
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            demoOptions.mapName = argv[++i];
+        }
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+        {
+            demoOptions.gameDir = argv[++i];
+            sessionOptions.gameDir = demoOptions.gameDir;
+        }
+        else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc)
+        {
+            sessions = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            sessionOptions.maps = (uint32_t)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            sessionOptions.maxRetries = (uint32_t)atoi(argv[++i]);
+        }
+        else if (argv[i][0] != '-' && !out)
+        {
+            out = argv[i];
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (!out || demoOptions.ticks < 0 || demoOptions.packetBytes == 0 || sessions < 0 ||
+        (sessions > 0 && sizeBytes > 0))
+    {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t bytes = 0;
+    if (sessions == 0)
+    {
+        if (sizeBytes > 0)
+        {
+            demoOptions.ticks = GetSynthTicksForBytes(demoOptions, sizeBytes);
+        }
+
+        SynthDemoResult_t result;
+        if (!WriteSynthDemo(out, demoOptions, result))
+        {
+            fprintf(stderr, "%s: could not be written\n", out);
+            return 1;
+        }
+        printf("%s\t%llu bytes\t%d ticks\n", out, (unsigned long long)result.bytes, result.lastTick);
+        bytes = result.bytes;
+    }
+    else
+    {
+        std::string baseDir = out;
+        if (baseDir.find_last_of("/\\") != baseDir.size() - 1)
+        {
+            baseDir += "/";
+        }
+
+        for (long session = 0; session < sessions; session++)
+        {
+            SynthSessionResult_t result;
+            if (!WriteSynthSession(baseDir.c_str(), sessionOptions, result))
+            {
+                fprintf(stderr, "%s: could not be written\n", result.sessionDir.c_str());
+                return 1;
+            }
+            printf("%s\t%llu bytes\t%u demos\n",
+                   result.sessionDir.c_str(),
+                   (unsigned long long)result.bytes,
+                   (unsigned)result.demos.size());
+            bytes += result.bytes;
+            sessionOptions.startTime += 86400;
+        }
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("wrote %.1f MB in %.2f s, %.1f MB/s\n",
+           (double)bytes / 1e6,
+           seconds,
+           seconds > 0.0 ? (double)bytes / 1e6 / seconds : 0.0);
+    return 0;
+}
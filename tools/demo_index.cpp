@@ -0,0 +1,145 @@
+//---------------------------------------------------------------------------------
+// Purpose: builds and queries the .dmi tick indexes that sit next to demos
+//
+//  demo_index [-s stride] <demo.dem>...
+//      writes <demo>.dmi for every demo, one thread per core
+//  demo_index -q <demo.dem|demo.dmi> [tick]...
+//      prints the last tick and message histogram from the index, and the offset to start reading at for each tick
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "demo_file.h"
+#include "demo_index.h"
+
+static bool BuildIndex(const char* path, uint32_t stride)
+{
+    CDemoFile demo;
+    DemoError error = demo.Open(path);
+    if (error != DEMERR_NONE)
+    {
+        fprintf(stderr, "%s: %s\n", path, DemoErrorToString(error));
+        return false;
+    }
+
+    CDemoIndex index;
+    index.Build(demo.GetData(), demo.GetSize(), stride);
+
+    const std::string indexPath = GetDemoIndexPath(path);
+    if (!index.WriteFile(indexPath.c_str()))
+    {
+        fprintf(stderr, "%s: unable to write\n", indexPath.c_str());
+        return false;
+    }
+
+    if (index.GetSummary().error != DEMERR_NONE)
+    {
+        fprintf(stderr,
+                "%s: %s at offset %llu, indexed up to there\n",
+                path,
+                DemoErrorToString(index.GetSummary().error),
+                (unsigned long long)index.GetSummary().errorOffset);
+    }
+    return true;
+}
+
+static int BuildIndexes(char** paths, int count, uint32_t stride)
+{
+    std::atomic<int> next(0);
+    std::atomic<int> failed(0);
+
+    unsigned threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0 || threadCount > (unsigned)count)
+    {
+        threadCount = (unsigned)count;
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; t++)
+    {
+        threads.push_back(std::thread([&] {
+            for (int i = next++; i < count; i = next++)
+            {
+                if (!BuildIndex(paths[i], stride))
+                {
+                    failed++;
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        threads[t].join();
+    }
+
+    printf("%d indexes written, %d failed\n", count - failed.load(), failed.load());
+    return failed.load() == 0 ? 0 : 1;
+}
+
+static int QueryIndex(const char* path, char** ticks, int tickCount)
+{
+    std::string indexPath = path;
+    if (indexPath.size() < 4 || indexPath.compare(indexPath.size() - 4, 4, DEMO_INDEX_EXTENSION) != 0)
+    {
+        indexPath = GetDemoIndexPath(path);
+    }
+
+    CDemoIndex index;
+    if (!index.ReadFile(indexPath.c_str()))
+    {
+        fprintf(stderr, "%s: missing or corrupt index\n", indexPath.c_str());
+        return 1;
+    }
+
+    const DemoSummary_t& summary = index.GetSummary();
+    printf("%s\n", indexPath.c_str());
+    printf("  demo size       %llu\n", (unsigned long long)index.GetDemoSize());
+    printf("  stride          %u ticks, %u entries\n", index.GetStride(), (unsigned)index.GetEntries().size());
+    printf("  complete        %s\n", summary.reachedStop ? "yes" : DemoErrorToString(summary.error));
+    for (int type = 0; type < DEMO_MSG_TYPE_COUNT; type++)
+    {
+        if (summary.messageCounts[type] != 0)
+        {
+            printf("  %-12s %8u msgs %12llu bytes\n",
+                   DemoMessageTypeToString(type),
+                   summary.messageCounts[type],
+                   (unsigned long long)summary.messageBytes[type]);
+        }
+    }
+    printf("  last tick       %d\n", summary.lastTick);
+
+    for (int i = 0; i < tickCount; i++)
+    {
+        const int32_t tick = (int32_t)atoi(ticks[i]);
+        printf("  tick %-10d offset %llu\n", tick, (unsigned long long)index.FindOffset(tick));
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 2 && strcmp(argv[1], "-q") == 0)
+        return QueryIndex(argv[2], argv + 3, argc - 3);
+
+    uint32_t stride = DEMO_INDEX_DEFAULT_STRIDE;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-s") == 0)
+    {
+        stride = (uint32_t)atoi(argv[2]);
+        first += 2;
+    }
+
+    if (first >= argc || stride == 0)
+    {
+        fprintf(stderr, "usage: %s [-s stride] <demo.dem>...\n", argv[0]);
+        fprintf(stderr, "       %s -q <demo.dem|demo.dmi> [tick]...\n", argv[0]);
+        return 2;
+    }
+    return BuildIndexes(argv + first, argc - first, stride);
+}
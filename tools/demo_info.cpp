@@ -0,0 +1,103 @@
+//---------------------------------------------------------------------------------
+// Purpose: prints the header, message histogram and last tick of one or more demos
+//
+//  demo_info [-m] <demo.dem>...
+//      -m  also list every message (offset, type, tick, size)
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+
+#include "demo_file.h"
+
+static void PrintMessages(const CDemoFile& demo)
+{
+    CDemoMessageReader reader = demo.GetMessages();
+    DemoMessage_t msg;
+    while (reader.Next(msg))
+    {
+        printf("  %12llu %-12s tick %7d size %u\n",
+               (unsigned long long)msg.offset,
+               DemoMessageTypeToString(msg.type),
+               msg.tick,
+               (unsigned)msg.size);
+    }
+}
+
+static bool PrintDemo(const char* path, bool listMessages)
+{
+    CDemoFile demo;
+    DemoError error = demo.Open(path);
+    if (error != DEMERR_NONE)
+    {
+        fprintf(stderr, "%s: %s\n", path, DemoErrorToString(error));
+        return false;
+    }
+
+    const demoheader_t* header = demo.GetHeader();
+    printf("%s\n", path);
+    printf("  demoprotocol    %d\n", header->demoprotocol);
+    printf("  networkprotocol %d\n", header->networkprotocol);
+    printf("  servername      %.*s\n", DEMO_MAX_OSPATH, header->servername);
+    printf("  clientname      %.*s\n", DEMO_MAX_OSPATH, header->clientname);
+    printf("  mapname         %.*s\n", DEMO_MAX_OSPATH, header->mapname);
+    printf("  gamedirectory   %.*s\n", DEMO_MAX_OSPATH, header->gamedirectory);
+    printf("  playback_time   %f\n", header->playback_time);
+    printf("  playback_ticks  %d\n", header->playback_ticks);
+    printf("  playback_frames %d\n", header->playback_frames);
+    printf("  signonlength    %d\n", header->signonlength);
+
+    if (listMessages)
+    {
+        PrintMessages(demo);
+    }
+
+    DemoSummary_t summary;
+    SummarizeDemo(demo.GetData(), demo.GetSize(), summary);
+    for (int type = 0; type < DEMO_MSG_TYPE_COUNT; type++)
+    {
+        if (summary.messageCounts[type] != 0)
+        {
+            printf("  %-12s %8u msgs %12llu bytes\n",
+                   DemoMessageTypeToString(type),
+                   summary.messageCounts[type],
+                   (unsigned long long)summary.messageBytes[type]);
+        }
+    }
+    printf("  last tick       %d\n", summary.lastTick);
+
+    if (summary.error != DEMERR_NONE)
+    {
+        fprintf(stderr,
+                "%s: %s at offset %llu\n",
+                path,
+                DemoErrorToString(summary.error),
+                (unsigned long long)summary.errorOffset);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    bool listMessages = false;
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "-m") == 0)
+    {
+        listMessages = true;
+        first++;
+    }
+
+    if (first >= argc)
+    {
+        fprintf(stderr, "usage: %s [-m] <demo.dem>...\n", argv[0]);
+        return 2;
+    }
+
+    bool ok = true;
+    for (int i = first; i < argc; i++)
+    {
+        ok = PrintDemo(argv[i], listMessages) && ok;
+    }
+    return ok ? 0 : 1;
+}
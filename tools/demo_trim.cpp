@@ -0,0 +1,178 @@
+//---------------------------------------------------------------------------------
+// Purpose: rewrites demos without their loading and tail ticks, see demo_trimmer.h
+//
+//  demo_trim [-j threads] [--lead keep|drop|collapse] [--tail keep|drop|collapse] -o <outDir> <dir|demo.dem>...
+//      -j      worker threads, every core by default
+//      --lead  what to do with the packets before the first usercmd, collapse by default
+//      --tail  what to do with the messages after the last usercmd, drop by default
+//      -o      where the trimmed demos go, under their own name. Directories are not walked recursively.
+//
+// Exits with 1 if any demo couldn't be written.
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "demo_trimmer.h"
+#include "file_list.h"
+#include "work_stealing_pool.h"
+
+struct TrimJob_t
+{
+    std::string input;
+    std::string output;
+    TrimResult_t result;
+};
+
+static std::string GetFileName(const std::string& path)
+{
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static std::string JoinPath(const std::string& dir, const std::string& name)
+{
+    if (dir.empty() || dir[dir.size() - 1] == '/' || dir[dir.size() - 1] == '\\')
+        return dir + name;
+    return dir + '/' + name;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned threads = 0;
+    TrimOptions_t options;
+    std::string outDir;
+    std::vector<std::string> paths;
+    bool bUsage = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            threads = (unsigned)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--lead") == 0 && i + 1 < argc)
+        {
+            bUsage |= !ParseTrimAction(argv[++i], options.leadIn);
+        }
+        else if (strcmp(argv[i], "--tail") == 0 && i + 1 < argc)
+        {
+            bUsage |= !ParseTrimAction(argv[++i], options.tail);
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            outDir = argv[++i];
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (bUsage || paths.empty() || outDir.empty())
+    {
+        fprintf(stderr,
+                "usage: %s [-j threads] [--lead keep|drop|collapse] [--tail keep|drop|collapse] -o <outDir> "
+                "<dir|demo.dem>...\n",
+                argv[0]);
+        return 2;
+    }
+    if (!MakeDirectory(outDir))
+    {
+        fprintf(stderr, "can't create %s\n", outDir.c_str());
+        return 1;
+    }
+
+    std::vector<TrimJob_t> jobs;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        std::vector<std::string> demos;
+        if (EndsWith(paths[i], ".dem"))
+        {
+            demos.push_back(paths[i]);
+        }
+        else
+        {
+            std::vector<std::string> files;
+            ListDirectory(paths[i], &files, NULL);
+            for (size_t j = 0; j < files.size(); j++)
+            {
+                if (EndsWith(files[j], ".dem"))
+                {
+                    demos.push_back(JoinPath(paths[i], files[j]));
+                }
+            }
+        }
+
+        for (size_t j = 0; j < demos.size(); j++)
+        {
+            TrimJob_t job;
+            job.input = demos[j];
+            job.output = JoinPath(outDir, GetFileName(demos[j]));
+            jobs.push_back(job);
+        }
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    CWorkStealingPool pool(threads);
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        TrimJob_t* job = &jobs[i];
+        const TrimOptions_t* jobOptions = &options;
+        pool.Submit([job, jobOptions] {
+            TrimDemo(job->input.c_str(), job->output.c_str(), *jobOptions, job->result);
+        });
+    }
+    pool.Wait();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t inputBytes = 0;
+    uint64_t outputBytes = 0;
+    int64_t inputTicks = 0;
+    int64_t outputTicks = 0;
+    unsigned failed = 0;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        const TrimJob_t& job = jobs[i];
+        if (!job.result.written)
+        {
+            fprintf(stderr, "%s: %s\n", job.input.c_str(), DemoErrorToString(job.result.error));
+            failed++;
+            continue;
+        }
+
+        printf("%-40s %10llu -> %10llu bytes %7d -> %7d ticks, %u dropped, %u collapsed%s%s\n",
+               GetFileName(job.input).c_str(),
+               (unsigned long long)job.result.inputBytes,
+               (unsigned long long)job.result.outputBytes,
+               job.result.inputTicks,
+               job.result.outputTicks,
+               job.result.droppedMessages,
+               job.result.collapsedMessages,
+               job.result.error != DEMERR_NONE ? ", input " : "",
+               job.result.error != DEMERR_NONE ? DemoErrorToString(job.result.error) : "");
+        inputBytes += job.result.inputBytes;
+        outputBytes += job.result.outputBytes;
+        inputTicks += std::max(job.result.inputTicks, 0);
+        outputTicks += std::max(job.result.outputTicks, 0);
+    }
+
+    printf("%u demos, %.1f -> %.1f MB (%.1f MB saved), %lld -> %lld ticks (%lld saved)\n",
+           (unsigned)(jobs.size() - failed),
+           (double)inputBytes / 1e6,
+           (double)outputBytes / 1e6,
+           ((double)inputBytes - (double)outputBytes) / 1e6,
+           (long long)inputTicks,
+           (long long)outputTicks,
+           (long long)(inputTicks - outputTicks));
+    printf("%.3f s on %u threads, %.1f MB/s\n",
+           seconds,
+           pool.GetThreadCount(),
+           (double)inputBytes / 1e6 / (seconds > 0.0 ? seconds : 1e-9));
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+//---------------------------------------------------------------------------------
+// Purpose: stand-in for an external timer, reads the live split feed the plugin publishes in shared memory
+//
+//  live_split_reader [-n name] [-i ms] [-c count]
+//      prints the run clock, game time (run time without loads), map, split, demo and retries every -i ms (100 by
+//      default), -c stops after that many lines
+//  live_split_reader -b [-n name] [seconds]
+//      reads as fast as it can for a while (1 second by default) and prints snapshots per second and how many
+//      attempts ran into an update
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#include "latency_stats.h"
+#include "live_split_feed.h"
+
+static void FormatClock(uint64_t ns, char* text, size_t textSize)
+{
+    const uint64_t ms = ns / 1000000;
+    snprintf(text,
+             textSize,
+             "%u:%02u:%02u.%03u",
+             (unsigned)(ms / 3600000),
+             (unsigned)(ms / 60000 % 60),
+             (unsigned)(ms / 1000 % 60),
+             (unsigned)(ms % 1000));
+}
+
+static void PrintState(const livesplitstate_t& state)
+{
+    const uint64_t now = LatencyNow();
+    const uint64_t runTime = GetLiveSplitRunTime(state, now);
+    const uint64_t loadTime = GetLiveSplitLoadTime(state, now);
+
+    char run[32];
+    char game[32];
+    char loads[32];
+    FormatClock(runTime, run, sizeof(run));
+    FormatClock(runTime > loadTime ? runTime - loadTime : 0, game, sizeof(game));
+    FormatClock(loadTime, loads, sizeof(loads));
+
+    printf("%s run %s game %s loads %s (%u) split %u map %s demo %s retries %d\n",
+           (state.flags & LIVESPLIT_RUNNING) ? ((state.flags & LIVESPLIT_LOADING) ? "loading" : "running") : "stopped",
+           run,
+           game,
+           loads,
+           state.loadCount,
+           state.splitIndex,
+           state.mapName[0] ? state.mapName : "-",
+           state.demoName[0] ? state.demoName : "-",
+           state.retries);
+    fflush(stdout);
+}
+
+static int Benchmark(const CLiveSplitReader& reader, double seconds)
+{
+    uint64_t snapshots = 0;
+    uint64_t collisions = 0;
+    livesplitstate_t state;
+    const uint64_t start = LatencyNow();
+    const uint64_t end = start + (uint64_t)(seconds * 1e9);
+    uint64_t now = start;
+    while (now < end)
+    {
+        // Check the clock every 1024 reads, it costs about as much as a read
+        for (int i = 0; i < 1024; i++)
+        {
+            if (reader.TryRead(state))
+            {
+                snapshots++;
+            }
+            else
+            {
+                collisions++;
+            }
+        }
+        now = LatencyNow();
+    }
+
+    const double elapsed = (double)(now - start) / 1e9;
+    printf("%llu snapshots in %.2f s, %.1f M/s, %.1f ns each, %llu attempts ran into an update\n",
+           (unsigned long long)snapshots,
+           elapsed,
+           (double)snapshots / elapsed / 1e6,
+           elapsed * 1e9 / (double)(snapshots + collisions),
+           (unsigned long long)collisions);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* name = LIVESPLIT_SHM_NAME;
+    int intervalMs = 100;
+    long count = -1;
+    bool benchmark = false;
+    double seconds = 1.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            name = argv[++i];
+        }
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+        {
+            intervalMs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            count = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-b") == 0)
+        {
+            benchmark = true;
+        }
+        else if (benchmark && argv[i][0] != '-')
+        {
+            seconds = atof(argv[i]);
+        }
+        else
+        {
+            fprintf(stderr,
+                    "usage: %s [-n name] [-i ms] [-c count]\n       %s -b [-n name] [seconds]\n",
+                    argv[0],
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    CLiveSplitReader reader;
+    if (!reader.Open(name))
+    {
+        fprintf(stderr, "no live split feed named %s, is the plugin loaded?\n", name);
+        return 1;
+    }
+
+    if (benchmark)
+        return Benchmark(reader, seconds > 0.0 ? seconds : 1.0);
+
+    livesplitstate_t state;
+    for (long line = 0; count < 0 || line < count; line++)
+    {
+        if (reader.Read(state))
+        {
+            PrintState(state);
+        }
+        if (count >= 0 && line + 1 >= count)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs > 0 ? intervalMs : 1));
+    }
+    return 0;
+}
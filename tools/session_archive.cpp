@@ -0,0 +1,289 @@
+//---------------------------------------------------------------------------------
+// Purpose: packs sessions into compressed, deduplicated .sra archives and unpacks them bit-exact
+//
+//  session_archive [-j threads] pack <archive.sra> <sessionDir|file>...
+//      every file of the session dirs (demos, journal, indexes) plus the files given directly
+//  session_archive [-j threads] unpack <archive.sra> <outDir> [name]...
+//      every file, or only the named ones
+//  session_archive ticks <archive.sra> <name> <firstTick> <lastTick> <out.dem>
+//      the header and the messages of those ticks of one demo, without unpacking anything else
+//  session_archive list <archive.sra>
+//
+// -j is the number of threads compressing or unpacking, every core by default.
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "demo_file.h"
+#include "file_list.h"
+#include "session_archive.h"
+#include "work_stealing_pool.h"
+
+static unsigned s_ThreadCount = 0;
+
+static double SecondsSince(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool WriteWholeFile(const std::string& path, const std::string& contents)
+{
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out)
+        return false;
+    const bool ok = fwrite(contents.data(), 1, contents.size(), out) == contents.size();
+    return fclose(out) == 0 && ok;
+}
+
+static std::string GetFileName(const std::string& path)
+{
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static bool PackFile(CSessionArchiveWriter& writer, const std::string& path)
+{
+    std::string contents;
+    if (!ReadWholeFile(path, contents))
+    {
+        fprintf(stderr, "%s: unable to read\n", path.c_str());
+        return false;
+    }
+    return writer.AddFile(GetFileName(path).c_str(), (const uint8_t*)contents.data(), contents.size());
+}
+
+static int Pack(const char* archivePath, char** inputs, int inputCount)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    CSessionArchiveWriter writer(s_ThreadCount);
+    if (!writer.Open(archivePath))
+    {
+        fprintf(stderr, "%s: unable to create\n", archivePath);
+        return 1;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < inputCount && ok; i++)
+    {
+        std::vector<std::string> files;
+        ListDirectory(inputs[i], &files, NULL);
+        if (files.empty())
+        {
+            ok = PackFile(writer, inputs[i]);
+            continue;
+        }
+
+        std::string dir = inputs[i];
+        if (dir[dir.size() - 1] != '/' && dir[dir.size() - 1] != '\\')
+        {
+            dir += '/';
+        }
+        for (size_t f = 0; f < files.size() && ok; f++)
+        {
+            ok = PackFile(writer, dir + files[f]);
+        }
+    }
+
+    if (!writer.Close() || !ok)
+    {
+        fprintf(stderr, "%s: packing failed\n", archivePath);
+        return 1;
+    }
+
+    const ArchiveStats_t& stats = writer.GetStats();
+    const double seconds = SecondsSince(start);
+    printf("%u files, %.1f MB -> %.1f MB (%.2fx), %u unique blocks for %u uses, %.1f MB deduplicated\n",
+           stats.files,
+           (double)stats.inputBytes / 1e6,
+           (double)stats.archiveBytes / 1e6,
+           stats.archiveBytes > 0 ? (double)stats.inputBytes / (double)stats.archiveBytes : 0.0,
+           stats.uniqueBlocks,
+           stats.blockRefs,
+           (double)stats.dedupedBytes / 1e6);
+    printf("packed in %.3f s, %.1f MB/s\n", seconds, (double)stats.inputBytes / 1e6 / (seconds > 0.0 ? seconds : 1e-9));
+    return 0;
+}
+
+static int Unpack(const char* archivePath, const char* outDir, char** names, int nameCount)
+{
+    CSessionArchiveReader reader;
+    if (!reader.Open(archivePath))
+    {
+        fprintf(stderr, "%s: not an archive or damaged\n", archivePath);
+        return 1;
+    }
+
+    std::string dir = outDir;
+    if (!MakeDirectory(dir))
+    {
+        fprintf(stderr, "%s: unable to create\n", outDir);
+        return 1;
+    }
+    if (dir[dir.size() - 1] != '/' && dir[dir.size() - 1] != '\\')
+    {
+        dir += '/';
+    }
+
+    std::vector<size_t> indexes;
+    for (int i = 0; i < nameCount; i++)
+    {
+        const int index = reader.FindFile(names[i]);
+        if (index < 0)
+        {
+            fprintf(stderr, "%s: not in the archive\n", names[i]);
+            return 1;
+        }
+        indexes.push_back((size_t)index);
+    }
+    if (nameCount == 0)
+    {
+        for (size_t i = 0; i < reader.GetFileCount(); i++)
+        {
+            indexes.push_back(i);
+        }
+    }
+
+    // Files are independent, each one is read back and decompressed on its own core
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::atomic<int> failed(0);
+    std::atomic<uint64_t> bytes(0);
+    {
+        CWorkStealingPool pool(s_ThreadCount);
+        for (size_t i = 0; i < indexes.size(); i++)
+        {
+            const size_t index = indexes[i];
+            pool.Submit([&reader, &dir, &failed, &bytes, index] {
+                const ArchiveFile_t& file = reader.GetFile(index);
+                std::string contents;
+                if (!reader.Extract(index, contents) || !WriteWholeFile(dir + GetFileName(file.name), contents))
+                {
+                    fprintf(stderr, "%s: extraction failed\n", file.name.c_str());
+                    failed++;
+                }
+                bytes += contents.size();
+            });
+        }
+        pool.Wait();
+    }
+
+    const double seconds = SecondsSince(start);
+    printf("%d files unpacked, %d failed, %.3f s, %.1f MB/s\n",
+           (int)indexes.size() - failed.load(),
+           failed.load(),
+           seconds,
+           (double)bytes.load() / 1e6 / (seconds > 0.0 ? seconds : 1e-9));
+    return failed.load() == 0 ? 0 : 1;
+}
+
+static int ExtractTicks(const char* archivePath,
+                        const char* name,
+                        int32_t firstTick,
+                        int32_t lastTick,
+                        const char* outPath)
+{
+    CSessionArchiveReader reader;
+    if (!reader.Open(archivePath))
+    {
+        fprintf(stderr, "%s: not an archive or damaged\n", archivePath);
+        return 1;
+    }
+
+    const int index = reader.FindFile(name);
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    if (index < 0 || !reader.FindTickRange((size_t)index, firstTick, lastTick, offset, size))
+    {
+        fprintf(stderr, "%s: no such demo or no messages in ticks %d-%d\n", name, firstTick, lastTick);
+        return 1;
+    }
+
+    // Header as it was, the messages follow it directly
+    std::string header;
+    std::string messages;
+    if (reader.GetFile((size_t)index).size < DEMO_HEADER_SIZE || offset < DEMO_HEADER_SIZE ||
+        !reader.ExtractRange((size_t)index, 0, DEMO_HEADER_SIZE, header) ||
+        !reader.ExtractRange((size_t)index, offset, size, messages) || !WriteWholeFile(outPath, header + messages))
+    {
+        fprintf(stderr, "%s: extraction failed\n", name);
+        return 1;
+    }
+
+    printf("%s: bytes %llu-%llu hold ticks %d-%d, written to %s\n",
+           name,
+           (unsigned long long)offset,
+           (unsigned long long)(offset + size),
+           firstTick,
+           lastTick,
+           outPath);
+    return 0;
+}
+
+static int List(const char* archivePath)
+{
+    CSessionArchiveReader reader;
+    if (!reader.Open(archivePath))
+    {
+        fprintf(stderr, "%s: not an archive or damaged\n", archivePath);
+        return 1;
+    }
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < reader.GetFileCount(); i++)
+    {
+        const ArchiveFile_t& file = reader.GetFile(i);
+        uint32_t shared = 0;
+        uint64_t stored = 0;
+        for (size_t p = 0; p < file.pieces.size(); p++)
+        {
+            shared += file.pieces[p].block != ARCHIVE_LITERAL ? 1 : 0;
+            stored += file.pieces[p].block == ARCHIVE_LITERAL ? file.pieces[p].storedSize : 0;
+        }
+        printf("%12llu  %12llu  %08x  %3u blocks  %4u chunks  %s\n",
+               (unsigned long long)file.size,
+               (unsigned long long)stored,
+               file.crc,
+               shared,
+               (unsigned)file.pieces.size() - shared,
+               file.name.c_str());
+        total += file.size;
+    }
+    printf("%u files, %llu bytes in a %llu byte archive, %u unique blocks\n",
+           (unsigned)reader.GetFileCount(),
+           (unsigned long long)total,
+           (unsigned long long)reader.GetArchiveSize(),
+           (unsigned)reader.GetBlocks().size());
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    int arg = 1;
+    if (argc > 2 && strcmp(argv[1], "-j") == 0)
+    {
+        s_ThreadCount = (unsigned)atoi(argv[2]);
+        arg = 3;
+    }
+    const int count = argc - arg;
+
+    if (count > 2 && strcmp(argv[arg], "pack") == 0)
+        return Pack(argv[arg + 1], argv + arg + 2, count - 2);
+    if (count > 2 && strcmp(argv[arg], "unpack") == 0)
+        return Unpack(argv[arg + 1], argv[arg + 2], argv + arg + 3, count - 3);
+    if (count == 6 && strcmp(argv[arg], "ticks") == 0)
+        return ExtractTicks(argv[arg + 1], argv[arg + 2], atoi(argv[arg + 3]), atoi(argv[arg + 4]), argv[arg + 5]);
+    if (count == 2 && strcmp(argv[arg], "list") == 0)
+        return List(argv[arg + 1]);
+
+    fprintf(stderr, "usage: %s [-j threads] pack <archive.sra> <sessionDir|file>...\n", argv[0]);
+    fprintf(stderr, "       %s [-j threads] unpack <archive.sra> <outDir> [name]...\n", argv[0]);
+    fprintf(stderr, "       %s ticks <archive.sra> <name> <firstTick> <lastTick> <out.dem>\n", argv[0]);
+    fprintf(stderr, "       %s list <archive.sra>\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,181 @@
+//---------------------------------------------------------------------------------
+// Purpose: keeps a live index of a session that is being recorded and publishes it in shared memory
+//
+//  session_indexd [-n name] [-v] <sessionDir>
+//      follows the session dir (inotify on Linux, a rescan every second elsewhere), parsing only what the engine
+//      appends to the demos, and republishes the summary after every change until interrupted. -v prints a line for
+//      every change as well.
+//  session_indexd -q [-n name]
+//      prints what the daemon publishes: the demos with their map and ticks, and the ticks per map
+//---------------------------------------------------------------------------------
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "directory_watcher.h"
+#include "live_session_index.h"
+
+static volatile sig_atomic_t s_bStop = 0;
+
+static void OnSignal(int)
+{
+    s_bStop = 1;
+}
+
+// Far too big for the stack
+static livesessionstate_t s_State;
+
+static void PrintSummary(const livesessionstate_t& state)
+{
+    printf("%s%s: %u demos, %lld ticks, %llu bytes read%s\n",
+           state.sessionDir,
+           (state.flags & LIVESESSION_RECORDING) ? " (recording)" : "",
+           state.demoCount,
+           (long long)state.totalTicks,
+           (unsigned long long)state.bytesRead,
+           (state.flags & LIVESESSION_TRUNCATED) ? ", more than the feed holds" : "");
+}
+
+static int Query(const char* name)
+{
+    CLiveSessionReader reader;
+    if (!reader.Open(name))
+    {
+        fprintf(stderr, "no live session index named %s, is session_indexd running?\n", name);
+        return 1;
+    }
+    if (!reader.Read(s_State))
+    {
+        fprintf(stderr, "the index kept changing, try again\n");
+        return 1;
+    }
+
+    PrintSummary(s_State);
+    for (uint32_t i = 0; i < s_State.demoCount; i++)
+    {
+        const livesessiondemo_t& demo = s_State.demos[i];
+        printf("%5u  %-40s %-24s %7d ticks%s%s\n",
+               i,
+               demo.name,
+               demo.map < s_State.mapCount ? s_State.maps[demo.map].name : "-",
+               demo.ticks,
+               (demo.flags & LIVESESSION_DEMO_STOPPED) ? "" : " (recording)",
+               (demo.flags & LIVESESSION_DEMO_CORRUPT) ? " (corrupt)" : "");
+    }
+    for (uint32_t i = 0; i < s_State.mapCount; i++)
+    {
+        const livesessionmap_t& map = s_State.maps[i];
+        printf("  %-24s %3u demos %9lld ticks\n", map.name, map.demos, (long long)map.ticks);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* name = LIVESESSION_SHM_NAME;
+    const char* sessionDir = NULL;
+    bool query = false;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            name = argv[++i];
+        }
+        else if (strcmp(argv[i], "-q") == 0)
+        {
+            query = true;
+        }
+        else if (strcmp(argv[i], "-v") == 0)
+        {
+            verbose = true;
+        }
+        else if (argv[i][0] != '-' && !sessionDir)
+        {
+            sessionDir = argv[i];
+        }
+        else
+        {
+            sessionDir = NULL;
+            break;
+        }
+    }
+
+    if (query)
+        return Query(name);
+
+    if (!sessionDir)
+    {
+        fprintf(stderr, "usage: %s [-n name] [-v] <sessionDir>\n       %s -q [-n name]\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    CLiveSessionFeed feed;
+    if (!feed.Open(name))
+    {
+        fprintf(stderr, "can't create the shared memory %s\n", name);
+        return 1;
+    }
+
+    // Watching first, anything written while the first scan runs is then still reported
+    CDirectoryWatcher watcher;
+    if (!watcher.Open(sessionDir))
+    {
+        fprintf(stderr, "can't watch %s, rescanning every second instead\n", sessionDir);
+    }
+
+    CLiveSessionIndex index;
+    index.Open(sessionDir);
+    feed.Publish(index);
+
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+
+    std::vector<std::string> fileNames;
+    while (!s_bStop)
+    {
+        fileNames.clear();
+        bool changed = false;
+        switch (watcher.Wait(1000, fileNames))
+        {
+            case WATCH_CHANGED:
+                for (size_t i = 0; i < fileNames.size(); i++)
+                {
+                    changed |= index.Update(fileNames[i].c_str());
+                }
+                break;
+
+            case WATCH_RESCAN:
+                changed = index.Scan();
+                break;
+
+            case WATCH_TIMEOUT:
+                break;
+        }
+
+        if (changed)
+        {
+            feed.Publish(index);
+            if (verbose && index.GetDemoCount() > 0)
+            {
+                const LiveSessionDemo_t& demo = index.GetDemo(index.GetDemoCount() - 1);
+                printf("%u demos, %lld ticks, %llu bytes read, %s at %d%s\n",
+                       (unsigned)index.GetDemoCount(),
+                       (long long)index.GetTotalTicks(),
+                       (unsigned long long)index.GetBytesRead(),
+                       demo.name.c_str(),
+                       demo.ticks,
+                       index.IsRecording() ? " (recording)" : "");
+                fflush(stdout);
+            }
+        }
+    }
+
+    // Unlinks the segment, clients keep what they mapped
+    feed.Close();
+    return 0;
+}
@@ -0,0 +1,191 @@
+//---------------------------------------------------------------------------------
+// Purpose: lays out a run across its demos and converts run time to demo ticks
+//
+//  session_timeline [-r tickrate] <sessionDir> [position|range]...
+//      lists the demos with their start in the run, then resolves each position ("14:32", "1:02:03.5", or a run
+//      tick like "t58133") to a demo and tick, and each range ("14:00-15:00") to the demo pieces it covers
+//  session_timeline [-r tickrate] -w <sessionDir>
+//      follows a run that is being recorded, printing demos as they land
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "session_timeline.h"
+
+static double s_TickRate = TIMELINE_DEFAULT_TICKRATE;
+
+static void FormatTime(int64_t tick, char* out, size_t outSize)
+{
+    const double seconds = (double)tick / s_TickRate;
+    const int64_t whole = (int64_t)seconds;
+    snprintf(out,
+             outSize,
+             "%d:%02d:%06.3f",
+             (int)(whole / 3600),
+             (int)(whole / 60 % 60),
+             seconds - (double)(whole - whole % 60));
+}
+
+// "t<tick>", or [[h:]m:]s with optional fraction, as a run tick. -1 if it is neither.
+static int64_t ParsePosition(const char* text)
+{
+    if (text[0] == 't')
+    {
+        char* end;
+        const long long tick = strtoll(text + 1, &end, 10);
+        return *end == '\0' && end != text + 1 ? (int64_t)tick : -1;
+    }
+
+    double seconds = 0.0;
+    const char* p = text;
+    for (;;)
+    {
+        char* end;
+        const double part = strtod(p, &end);
+        if (end == p || part < 0.0)
+            return -1;
+
+        seconds = seconds * 60.0 + part;
+        if (*end == '\0')
+            break;
+        if (*end != ':')
+            return -1;
+        p = end + 1;
+    }
+    return (int64_t)(seconds * s_TickRate + 0.5);
+}
+
+static void PrintDemos(const CSessionTimeline& timeline, size_t first)
+{
+    char start[32];
+    for (size_t i = first; i < timeline.GetDemoCount(); i++)
+    {
+        FormatTime(timeline.GetDemoStart(i), start, sizeof(start));
+        printf("%5u  %-40s start %s (t%lld)  %7d ticks\n",
+               (unsigned)i,
+               timeline.GetDemo(i).name.c_str(),
+               start,
+               (long long)timeline.GetDemoStart(i),
+               timeline.GetDemo(i).ticks);
+    }
+}
+
+static bool PrintPosition(const CSessionTimeline& timeline, const char* text)
+{
+    const int64_t tick = ParsePosition(text);
+    TimelinePosition_t position;
+    if (tick < 0 || !timeline.Locate(tick, position))
+    {
+        fprintf(stderr, "%s: not a position in the run\n", text);
+        return false;
+    }
+
+    printf("%s = t%lld = %s tick %d\n",
+           text,
+           (long long)tick,
+           timeline.GetDemo(position.demo).name.c_str(),
+           position.tick);
+    return true;
+}
+
+static bool PrintRange(const CSessionTimeline& timeline, const char* text)
+{
+    const std::string range = text;
+    const size_t dash = range.find('-');
+    const int64_t begin = ParsePosition(range.substr(0, dash).c_str());
+    const int64_t end = ParsePosition(range.substr(dash + 1).c_str());
+    if (begin < 0 || end < begin)
+    {
+        fprintf(stderr, "%s: not a range in the run\n", text);
+        return false;
+    }
+
+    std::vector<TimelineSpan_t> spans;
+    timeline.GetRange(begin, end, spans);
+    printf("%s = t%lld-t%lld\n", text, (long long)begin, (long long)end);
+    for (size_t i = 0; i < spans.size(); i++)
+    {
+        printf("  %-40s ticks %d-%d\n", timeline.GetDemo(spans[i].demo).name.c_str(), spans[i].begin, spans[i].end);
+    }
+    return true;
+}
+
+static void PrintTotal(const CSessionTimeline& timeline)
+{
+    char total[32];
+    FormatTime(timeline.GetTotalTicks(), total, sizeof(total));
+    printf("%u demos, %lld ticks, %s\n", (unsigned)timeline.GetDemoCount(), (long long)timeline.GetTotalTicks(), total);
+}
+
+int main(int argc, char** argv)
+{
+    int first = 1;
+    if (argc > first + 1 && strcmp(argv[first], "-r") == 0)
+    {
+        s_TickRate = atof(argv[first + 1]);
+        first += 2;
+    }
+
+    bool watch = false;
+    if (argc > first && strcmp(argv[first], "-w") == 0)
+    {
+        watch = true;
+        first++;
+    }
+
+    if (first >= argc || s_TickRate <= 0.0)
+    {
+        fprintf(stderr, "usage: %s [-r tickrate] <sessionDir> [position|range]...\n", argv[0]);
+        fprintf(stderr, "       %s [-r tickrate] -w <sessionDir>\n", argv[0]);
+        return 2;
+    }
+
+    const char* sessionDir = argv[first];
+    CSessionTimeline timeline;
+    timeline.Refresh(sessionDir);
+    PrintDemos(timeline, 0);
+    PrintTotal(timeline);
+
+    if (watch)
+    {
+        for (;;)
+        {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+
+            const size_t known = timeline.GetDemoCount();
+            const int64_t totalTicks = timeline.GetTotalTicks();
+            const size_t added = timeline.Refresh(sessionDir);
+            if (added != 0 || timeline.GetTotalTicks() != totalTicks)
+            {
+                // The previous last demo may have grown as well
+                size_t from = timeline.GetDemoCount() - added;
+                if (known > 0 && from == known)
+                {
+                    from--;
+                }
+                PrintDemos(timeline, from);
+                PrintTotal(timeline);
+            }
+        }
+    }
+
+    bool ok = true;
+    for (int i = first + 1; i < argc; i++)
+    {
+        if (strchr(argv[i], '-'))
+        {
+            ok = PrintRange(timeline, argv[i]) && ok;
+        }
+        else
+        {
+            ok = PrintPosition(timeline, argv[i]) && ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+//---------------------------------------------------------------------------------
+// Purpose: prints the per frame samples speedrun_telemetry wrote during a run
+//
+//  telemetry_dump [-s] [-h <ms>] <file.telemetry>...
+//      prints the samples tab separated: file, time (ms since start), host tick, demo tick, frame time, flags
+//      -s  only a summary per file: frames, drops, the spread of the real time between frames, hitches, host ticks
+//          that were skipped and frames simulated while no demo was recording
+//      -h  real time between frames that counts as a hitch, 50 ms by default
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "telemetry_sampler.h"
+
+static void PrintRows(const char* path, const std::vector<telemetrysample_t>& samples)
+{
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        const telemetrysample_t& sample = samples[i];
+        printf("%s\t%.3f\t%d\t%d\t%g\t%s%s%s\n",
+               path,
+               (double)sample.time / 1e6,
+               sample.hostTick,
+               sample.demoTick,
+               (double)sample.frameTime,
+               (sample.flags & TELEMETRY_SIMULATING) ? "S" : "-",
+               (sample.flags & TELEMETRY_RECORDING) ? "R" : "-",
+               (sample.flags & TELEMETRY_PLAYING) ? "P" : "-");
+    }
+}
+
+static void PrintSummary(const char* path,
+                         const telemetryheader_t& header,
+                         const std::vector<telemetrysample_t>& samples,
+                         double hitchMs)
+{
+    std::vector<uint64_t> intervals;
+    intervals.reserve(samples.size());
+    uint32_t hitches = 0;
+    uint32_t skippedTicks = 0;
+    uint32_t notRecording = 0;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        const telemetrysample_t& sample = samples[i];
+        if ((sample.flags & TELEMETRY_SIMULATING) && !(sample.flags & TELEMETRY_RECORDING))
+        {
+            notRecording++;
+        }
+        if (i == 0)
+            continue;
+
+        const uint64_t interval = sample.time - samples[i - 1].time;
+        intervals.push_back(interval);
+        hitches += (double)interval / 1e6 >= hitchMs ? 1 : 0;
+
+        // A new map starts counting again, only forward jumps are skipped ticks
+        const int32_t step = sample.hostTick - samples[i - 1].hostTick;
+        skippedTicks += step > 1 ? (uint32_t)(step - 1) : 0;
+    }
+
+    double median = 0.0;
+    double p99 = 0.0;
+    double worst = 0.0;
+    if (!intervals.empty())
+    {
+        std::sort(intervals.begin(), intervals.end());
+        median = (double)intervals[intervals.size() / 2] / 1e6;
+        p99 = (double)intervals[(intervals.size() * 99) / 100] / 1e6;
+        worst = (double)intervals.back() / 1e6;
+    }
+
+    printf("%s: %u frames over %.1f s, %llu dropped%s, frame interval median %.2f ms, p99 %.2f ms, max %.2f ms, "
+           "%u hitches, %u skipped ticks, %u frames not recording\n",
+           path,
+           (unsigned)samples.size(),
+           samples.empty() ? 0.0 : (double)samples.back().time / 1e9,
+           (unsigned long long)header.dropped,
+           header.sampleCount == 0 && !samples.empty() ? " (not stopped, count unknown)" : "",
+           median,
+           p99,
+           worst,
+           hitches,
+           skippedTicks,
+           notRecording);
+}
+
+int main(int argc, char** argv)
+{
+    bool summaryOnly = false;
+    double hitchMs = 50.0;
+    int first = 1;
+    while (first < argc && argv[first][0] == '-')
+    {
+        if (strcmp(argv[first], "-s") == 0)
+        {
+            summaryOnly = true;
+            first++;
+        }
+        else if (strcmp(argv[first], "-h") == 0 && first + 1 < argc)
+        {
+            hitchMs = atof(argv[first + 1]);
+            first += 2;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (first >= argc || hitchMs <= 0.0)
+    {
+        fprintf(stderr, "usage: %s [-s] [-h <ms>] <file.telemetry>...\n", argv[0]);
+        return 2;
+    }
+
+    if (!summaryOnly)
+    {
+        printf("file\ttime\thosttick\tdemotick\tframetime\tflags\n");
+    }
+
+    int result = 0;
+    for (int i = first; i < argc; i++)
+    {
+        telemetryheader_t header;
+        std::vector<telemetrysample_t> samples;
+        if (!ReadTelemetryFile(argv[i], header, samples))
+        {
+            fprintf(stderr, "%s: not a telemetry file\n", argv[i]);
+            result = 1;
+            continue;
+        }
+
+        if (summaryOnly)
+        {
+            PrintSummary(argv[i], header, samples, hitchMs);
+        }
+        else
+        {
+            PrintRows(argv[i], samples);
+        }
+    }
+    return result;
+}
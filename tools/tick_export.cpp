@@ -0,0 +1,222 @@
+//---------------------------------------------------------------------------------
+// Purpose: exports the usercmds of sessions into a tick column file (column_store.h), a row per usercmd
+//
+//  tick_export [-b blockRows] -o <out.stc> <dir|demo.dem>...
+//      directories are walked recursively, demos are added in path order
+//
+// Columns: demo and map (dictionary indexes of the demo's path and map name), tick, command, buttons, pitch, yaw,
+// forwardmove, sidemove, upmove, mousedx, mousedy and packet_bytes (bytes of the packets recorded since the previous
+// usercmd).
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "column_store.h"
+#include "demo_file.h"
+#include "file_list.h"
+#include "usercmd_decoder.h"
+
+enum ExportColumn
+{
+    EXPORT_DEMO,
+    EXPORT_MAP,
+    EXPORT_TICK,
+    EXPORT_COMMAND,
+    EXPORT_BUTTONS,
+    EXPORT_PITCH,
+    EXPORT_YAW,
+    EXPORT_FORWARDMOVE,
+    EXPORT_SIDEMOVE,
+    EXPORT_UPMOVE,
+    EXPORT_MOUSEDX,
+    EXPORT_MOUSEDY,
+    EXPORT_PACKET_BYTES,
+
+    EXPORT_COLUMN_COUNT
+};
+
+static std::string JoinPath(const std::string& dir, const std::string& name)
+{
+    if (dir.empty() || dir[dir.size() - 1] == '/' || dir[dir.size() - 1] == '\\')
+        return dir + name;
+    return dir + '/' + name;
+}
+
+static void FindDemos(const std::string& path, std::vector<std::string>& demos)
+{
+    if (EndsWith(path, ".dem"))
+    {
+        demos.push_back(path);
+        return;
+    }
+
+    std::vector<std::string> files;
+    std::vector<std::string> subdirs;
+    ListDirectory(path, &files, &subdirs);
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (EndsWith(files[i], ".dem"))
+        {
+            demos.push_back(JoinPath(path, files[i]));
+        }
+    }
+    for (size_t i = 0; i < subdirs.size(); i++)
+    {
+        FindDemos(JoinPath(path, subdirs[i]), demos);
+    }
+}
+
+static bool ExportDemo(CColumnWriter& writer, const std::string& path, uint64_t& bytes)
+{
+    CDemoFile demo;
+    DemoError error = demo.Open(path.c_str());
+    if (error != DEMERR_NONE)
+    {
+        fprintf(stderr, "%s: %s\n", path.c_str(), DemoErrorToString(error));
+        return false;
+    }
+    bytes += demo.GetSize();
+
+    const demoheader_t* header = demo.GetHeader();
+    const uint32_t demoId = writer.AddString(path);
+    const uint32_t mapId =
+        writer.AddString(std::string(header->mapname, strnlen(header->mapname, sizeof(header->mapname))));
+
+    UserCmdTable_t table;
+    std::vector<uint32_t> packetBytes;
+    uint32_t packets = 0;
+    CDemoMessageReader reader = demo.GetMessages();
+    DemoMessage_t msg;
+    while (reader.Next(msg))
+    {
+        if (msg.type == DEM_PACKET)
+        {
+            packets += (uint32_t)msg.size;
+        }
+        else if (msg.type == DEM_USERCMD)
+        {
+            UserCmd_t cmd;
+            if (!DecodeUserCmd(msg.data, msg.dataLength, cmd))
+            {
+                table.truncated++;
+            }
+            table.Append(msg.tick, msg.sequence, cmd);
+            packetBytes.push_back(packets);
+            packets = 0;
+        }
+    }
+
+    const size_t rows = table.Size();
+    const std::vector<uint32_t> demoIds(rows, demoId);
+    const std::vector<uint32_t> mapIds(rows, mapId);
+    writer.Append(EXPORT_DEMO, demoIds.data(), rows);
+    writer.Append(EXPORT_MAP, mapIds.data(), rows);
+    writer.Append(EXPORT_TICK, table.demoTick.data(), rows);
+    writer.Append(EXPORT_COMMAND, table.commandNumber.data(), rows);
+    writer.Append(EXPORT_BUTTONS, table.buttons.data(), rows);
+    writer.Append(EXPORT_PITCH, table.pitch.data(), rows);
+    writer.Append(EXPORT_YAW, table.yaw.data(), rows);
+    writer.Append(EXPORT_FORWARDMOVE, table.forwardMove.data(), rows);
+    writer.Append(EXPORT_SIDEMOVE, table.sideMove.data(), rows);
+    writer.Append(EXPORT_UPMOVE, table.upMove.data(), rows);
+    writer.Append(EXPORT_MOUSEDX, table.mouseDx.data(), rows);
+    writer.Append(EXPORT_MOUSEDY, table.mouseDy.data(), rows);
+    writer.Append(EXPORT_PACKET_BYTES, packetBytes.data(), rows);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t blockRows = COLUMN_BLOCK_ROWS;
+    std::string outPath;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            blockRows = (uint32_t)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            outPath = argv[++i];
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.empty() || outPath.empty() || blockRows == 0)
+    {
+        fprintf(stderr, "usage: %s [-b blockRows] -o <out.stc> <dir|demo.dem>...\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<std::string> demos;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        FindDemos(paths[i], demos);
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    CColumnWriter writer(blockRows);
+    if (!writer.Open(outPath.c_str()))
+    {
+        fprintf(stderr, "can't create %s\n", outPath.c_str());
+        return 1;
+    }
+
+    static const struct
+    {
+        const char* name;
+        ColumnType type;
+    } s_Columns[EXPORT_COLUMN_COUNT] = {
+        {"demo", COLTYPE_UINT32},
+        {"map", COLTYPE_UINT32},
+        {"tick", COLTYPE_INT32},
+        {"command", COLTYPE_INT32},
+        {"buttons", COLTYPE_UINT32},
+        {"pitch", COLTYPE_FLOAT32},
+        {"yaw", COLTYPE_FLOAT32},
+        {"forwardmove", COLTYPE_FLOAT32},
+        {"sidemove", COLTYPE_FLOAT32},
+        {"upmove", COLTYPE_FLOAT32},
+        {"mousedx", COLTYPE_INT16},
+        {"mousedy", COLTYPE_INT16},
+        {"packet_bytes", COLTYPE_UINT32},
+    };
+    for (int i = 0; i < EXPORT_COLUMN_COUNT; i++)
+    {
+        writer.AddColumn(s_Columns[i].name, s_Columns[i].type);
+    }
+
+    int result = 0;
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < demos.size(); i++)
+    {
+        if (!ExportDemo(writer, demos[i], bytes))
+        {
+            result = 1;
+        }
+    }
+
+    if (!writer.Close())
+    {
+        fprintf(stderr, "%s: write failed\n", outPath.c_str());
+        return 1;
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%u demos, %.1f MB of demos -> %.1f MB in %.3f s, %.1f MB/s\n",
+           (unsigned)demos.size(),
+           (double)bytes / 1e6,
+           (double)writer.GetBytesWritten() / 1e6,
+           seconds,
+           (double)bytes / 1e6 / (seconds > 0.0 ? seconds : 1e-9));
+    return result;
+}
@@ -0,0 +1,189 @@
+//---------------------------------------------------------------------------------
+// Purpose: lists and scans tick column files (column_store.h)
+//
+//  tick_scan <file.stc>...
+//      lists the columns of each file with their type, blocks, encodings, min and max
+//  tick_scan -c <column> [-r lo hi] [-f] <file.stc>...
+//      counts and sums the values of one column in [lo, hi] (every value by default) over all files and prints how
+//      many blocks it skipped, answered from their stats or decoded, and the throughput
+//      -f  also prints every matching row, with its demo and tick if the file has those columns
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "column_store.h"
+
+static void ListColumns(const char* path, const CColumnReader& reader)
+{
+    printf("%s: %llu rows, %u strings, %.1f MB\n",
+           path,
+           (unsigned long long)reader.GetRowCount(),
+           (unsigned)reader.GetStringCount(),
+           (double)reader.GetFileSize() / 1e6);
+    for (size_t i = 0; i < reader.GetColumnCount(); i++)
+    {
+        const columndesc_t& column = reader.GetColumn(i);
+        uint32_t encodings[3] = {};
+        uint64_t stored = 0;
+        double minValue = std::numeric_limits<double>::infinity();
+        double maxValue = -std::numeric_limits<double>::infinity();
+        for (uint32_t b = 0; b < column.blockCount; b++)
+        {
+            const columnblock_t& block = reader.GetBlock(i, b);
+            encodings[block.encoding < 3 ? block.encoding : 0]++;
+            stored += block.size;
+            minValue = block.minValue < minValue ? block.minValue : minValue;
+            maxValue = block.maxValue > maxValue ? block.maxValue : maxValue;
+        }
+
+        const uint64_t raw = reader.GetRowCount() * GetColumnTypeSize((ColumnType)column.type);
+        printf("  %-16s %-8s %5u blocks (%u plain, %u delta, %u rle) %10llu bytes %5.1fx  min %g max %g\n",
+               column.name,
+               ColumnTypeToString((ColumnType)column.type),
+               column.blockCount,
+               encodings[COLENC_PLAIN],
+               encodings[COLENC_DELTA],
+               encodings[COLENC_RLE],
+               (unsigned long long)stored,
+               stored > 0 ? (double)raw / (double)stored : 0.0,
+               minValue,
+               maxValue);
+    }
+}
+
+static bool PrintRows(const char* path, const CColumnReader& reader, int column, double lo, double hi)
+{
+    std::vector<uint64_t> rows;
+    std::vector<double> values;
+    std::vector<double> demos;
+    std::vector<double> ticks;
+    const int demoColumn = reader.FindColumn("demo");
+    const int tickColumn = reader.FindColumn("tick");
+    if (!reader.FilterColumn((size_t)column, lo, hi, rows) || !reader.ReadColumn((size_t)column, values) ||
+        (demoColumn >= 0 && !reader.ReadColumn((size_t)demoColumn, demos)) ||
+        (tickColumn >= 0 && !reader.ReadColumn((size_t)tickColumn, ticks)))
+        return false;
+
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        const size_t row = (size_t)rows[i];
+        const size_t demo = demoColumn >= 0 ? (size_t)demos[row] : 0;
+        printf("%s\t%llu\t%s\t%g\t%g\n",
+               path,
+               (unsigned long long)row,
+               demo < reader.GetStringCount() && demoColumn >= 0 ? reader.GetString(demo).c_str() : "",
+               tickColumn >= 0 ? ticks[row] : -1.0,
+               values[row]);
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* columnName = NULL;
+    double lo = -std::numeric_limits<double>::infinity();
+    double hi = std::numeric_limits<double>::infinity();
+    bool printRows = false;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            columnName = argv[++i];
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 2 < argc)
+        {
+            lo = atof(argv[++i]);
+            hi = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-f") == 0)
+        {
+            printRows = true;
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.empty())
+    {
+        fprintf(stderr, "usage: %s <file.stc>...\n", argv[0]);
+        fprintf(stderr, "       %s -c <column> [-r lo hi] [-f] <file.stc>...\n", argv[0]);
+        return 2;
+    }
+
+    int result = 0;
+    ColumnScan_t total;
+    memset(&total, 0, sizeof(total));
+    total.minValue = std::numeric_limits<double>::infinity();
+    total.maxValue = -std::numeric_limits<double>::infinity();
+    uint64_t columnBytes = 0;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        CColumnReader reader;
+        if (!reader.Open(paths[i]))
+        {
+            fprintf(stderr, "%s: not a tick column file\n", paths[i]);
+            result = 1;
+            continue;
+        }
+
+        if (!columnName)
+        {
+            ListColumns(paths[i], reader);
+            continue;
+        }
+
+        const int column = reader.FindColumn(columnName);
+        ColumnScan_t scan;
+        if (column < 0 || !reader.ScanColumn((size_t)column, lo, hi, scan) ||
+            (printRows && !PrintRows(paths[i], reader, column, lo, hi)))
+        {
+            fprintf(stderr, "%s: %s %s\n", paths[i], column < 0 ? "no column" : "damaged column", columnName);
+            result = 1;
+            continue;
+        }
+
+        columnBytes += reader.GetRowCount() * GetColumnTypeSize((ColumnType)reader.GetColumn((size_t)column).type);
+        total.rows += scan.rows;
+        total.matches += scan.matches;
+        total.sum += scan.sum;
+        total.minValue = scan.minValue < total.minValue ? scan.minValue : total.minValue;
+        total.maxValue = scan.maxValue > total.maxValue ? scan.maxValue : total.maxValue;
+        total.blocksSkipped += scan.blocksSkipped;
+        total.blocksFromStats += scan.blocksFromStats;
+        total.blocksDecoded += scan.blocksDecoded;
+        total.bytesRead += scan.bytesRead;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (columnName)
+    {
+        printf("%s: %llu of %llu rows, sum %g, min %g, max %g\n",
+               columnName,
+               (unsigned long long)total.matches,
+               (unsigned long long)total.rows,
+               total.sum,
+               total.minValue,
+               total.maxValue);
+        printf("blocks: %u skipped, %u from stats, %u decoded (%.1f MB read)\n",
+               total.blocksSkipped,
+               total.blocksFromStats,
+               total.blocksDecoded,
+               (double)total.bytesRead / 1e6);
+        printf("%.3f s, %.1f M rows/s, %.1f MB/s of column values\n",
+               seconds,
+               (double)total.rows / 1e6 / (seconds > 0.0 ? seconds : 1e-9),
+               (double)columnBytes / 1e6 / (seconds > 0.0 ? seconds : 1e-9));
+    }
+    return result;
+}
@@ -0,0 +1,111 @@
+//---------------------------------------------------------------------------------
+// Purpose: decodes the player input of one or more demos into a table, one row per usercmd
+//
+//  usercmd_dump [-s] <demo.dem>...
+//      prints the columns tab separated: demo, tick, sequence, command, tickcount, pitch, yaw, roll, forwardmove,
+//      sidemove, upmove, buttons, impulse, weapon, subtype, mousedx, mousedy
+//      -s  only a summary per demo: usercmds, button changes, and command numbers that repeat or skip ahead, the
+//          usual signs of inputs that were replayed or edited
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+
+#include "demo_file.h"
+#include "usercmd_decoder.h"
+
+static void PrintRows(const char* path, const UserCmdTable_t& table)
+{
+    for (size_t i = 0; i < table.Size(); i++)
+    {
+        printf("%s\t%d\t%d\t%d\t%d\t%g\t%g\t%g\t%g\t%g\t%g\t0x%08x\t%u\t%u\t%u\t%d\t%d\n",
+               path,
+               table.demoTick[i],
+               table.sequence[i],
+               table.commandNumber[i],
+               table.tickCount[i],
+               (double)table.pitch[i],
+               (double)table.yaw[i],
+               (double)table.roll[i],
+               (double)table.forwardMove[i],
+               (double)table.sideMove[i],
+               (double)table.upMove[i],
+               table.buttons[i],
+               (unsigned)table.impulse[i],
+               (unsigned)table.weaponSelect[i],
+               (unsigned)table.weaponSubtype[i],
+               (int)table.mouseDx[i],
+               (int)table.mouseDy[i]);
+    }
+}
+
+static void PrintSummary(const char* path, const demoheader_t* header, const UserCmdTable_t& table)
+{
+    uint32_t repeated = 0;
+    uint32_t skipped = 0;
+    uint32_t buttonChanges = 0;
+    for (size_t i = 1; i < table.Size(); i++)
+    {
+        repeated += table.commandNumber[i] <= table.commandNumber[i - 1] ? 1 : 0;
+        skipped += table.commandNumber[i] > table.commandNumber[i - 1] + 1 ? 1 : 0;
+        buttonChanges += table.buttons[i] != table.buttons[i - 1] ? 1 : 0;
+    }
+
+    printf("%s: protocol %d, %u usercmds, %u truncated, %u button changes, %u repeated and %u skipped commands\n",
+           path,
+           header->networkprotocol,
+           (unsigned)table.Size(),
+           table.truncated,
+           buttonChanges,
+           repeated,
+           skipped);
+}
+
+int main(int argc, char** argv)
+{
+    bool summaryOnly = false;
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "-s") == 0)
+    {
+        summaryOnly = true;
+        first++;
+    }
+
+    if (first >= argc)
+    {
+        fprintf(stderr, "usage: %s [-s] <demo.dem>...\n", argv[0]);
+        return 2;
+    }
+
+    if (!summaryOnly)
+    {
+        printf("demo\ttick\tsequence\tcommand\ttickcount\tpitch\tyaw\troll\tforwardmove\tsidemove\tupmove\tbuttons\t"
+               "impulse\tweapon\tsubtype\tmousedx\tmousedy\n");
+    }
+
+    int result = 0;
+    UserCmdTable_t table;
+    for (int i = first; i < argc; i++)
+    {
+        CDemoFile demo;
+        DemoError error = demo.Open(argv[i]);
+        if (error != DEMERR_NONE)
+        {
+            fprintf(stderr, "%s: %s\n", argv[i], DemoErrorToString(error));
+            result = 1;
+            continue;
+        }
+
+        table.Clear();
+        DecodeDemoUserCmds(demo.GetData(), demo.GetSize(), table);
+        if (summaryOnly)
+        {
+            PrintSummary(argv[i], demo.GetHeader(), table);
+        }
+        else
+        {
+            PrintRows(argv[i], table);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,171 @@
+//---------------------------------------------------------------------------------
+// Purpose: checks every demo of one or more sessions or archives on all cores and totals their ticks
+//
+//  validate_sessions [-j threads] [-r tickrate] [-s] <dir|demo.dem>...
+//      -j  worker threads, every core by default
+//      -r  ticks per second for the times, 66.67 by default
+//      -s  also print the total of every session
+//  validate_sessions --scaling <dir|demo.dem>...
+//      runs the same validation with 1, 2, 4, ... threads up to the core count and prints the speedup
+//
+// Exits with 1 if any demo doesn't parse cleanly to its stop message.
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "session_timeline.h"
+#include "session_validator.h"
+
+static double s_TickRate = TIMELINE_DEFAULT_TICKRATE;
+
+static void PrintTicks(int64_t ticks)
+{
+    const double seconds = (double)ticks / s_TickRate;
+    const int64_t whole = (int64_t)seconds;
+    printf("%10lld ticks %4d:%02d:%06.3f",
+           (long long)ticks,
+           (int)(whole / 3600),
+           (int)(whole / 60 % 60),
+           seconds - (double)(whole - whole % 60));
+}
+
+static void PrintThroughput(const CSessionValidator& validator)
+{
+    const double seconds = validator.GetSeconds() > 0.0 ? validator.GetSeconds() : 1e-9;
+    printf("%u demos, %.1f MB in %.3f s on %u threads: %.0f demos/s, %.1f MB/s, %llu steals\n",
+           (unsigned)validator.GetResults().size(),
+           (double)validator.GetTotalBytes() / 1e6,
+           validator.GetSeconds(),
+           validator.GetThreadCount(),
+           (double)validator.GetResults().size() / seconds,
+           (double)validator.GetTotalBytes() / 1e6 / seconds,
+           (unsigned long long)validator.GetSteals());
+}
+
+static int RunScaling(const std::vector<std::string>& paths)
+{
+    unsigned maxThreads = std::thread::hardware_concurrency();
+    if (maxThreads == 0)
+    {
+        maxThreads = 1;
+    }
+
+    // Warm the page cache so the first run isn't the only one paying for the disk
+    CSessionValidator warmup;
+    warmup.Run(paths);
+
+    double baseline = 0.0;
+    for (unsigned threads = 1;; threads *= 2)
+    {
+        if (threads > maxThreads)
+        {
+            threads = maxThreads;
+        }
+
+        CSessionValidator validator(threads);
+        validator.Run(paths);
+        if (threads == 1)
+        {
+            baseline = validator.GetSeconds();
+        }
+        printf("%3u threads  %8.3f s  speedup %5.2f  ",
+               threads,
+               validator.GetSeconds(),
+               validator.GetSeconds() > 0.0 ? baseline / validator.GetSeconds() : 0.0);
+        PrintThroughput(validator);
+
+        if (threads == maxThreads)
+            break;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned threads = 0;
+    bool listSessions = false;
+    bool scaling = false;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            threads = (unsigned)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            s_TickRate = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0)
+        {
+            listSessions = true;
+        }
+        else if (strcmp(argv[i], "--scaling") == 0)
+        {
+            scaling = true;
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.empty() || s_TickRate <= 0.0)
+    {
+        fprintf(stderr, "usage: %s [-j threads] [-r tickrate] [-s] <dir|demo.dem>...\n", argv[0]);
+        fprintf(stderr, "       %s --scaling <dir|demo.dem>...\n", argv[0]);
+        return 2;
+    }
+
+    if (scaling)
+        return RunScaling(paths);
+
+    CSessionValidator validator(threads);
+    validator.Run(paths);
+
+    const std::vector<DemoCheck_t>& results = validator.GetResults();
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        if (results[i].error != DEMERR_NONE)
+        {
+            fprintf(stderr,
+                    "%s: %s at offset %llu\n",
+                    results[i].path.c_str(),
+                    DemoErrorToString(results[i].error),
+                    (unsigned long long)results[i].errorOffset);
+        }
+    }
+
+    std::vector<MapTicks_t> maps;
+    validator.GetMapTicks(maps);
+    for (size_t i = 0; i < maps.size(); i++)
+    {
+        printf("%-32s %6u demos ", maps[i].mapName.c_str(), maps[i].demos);
+        PrintTicks(maps[i].ticks);
+        printf("\n");
+    }
+
+    if (listSessions)
+    {
+        std::vector<SessionTicks_t> sessions;
+        validator.GetSessionTicks(sessions);
+        for (size_t i = 0; i < sessions.size(); i++)
+        {
+            printf("%s: %u demos, %u errors, ", sessions[i].session.c_str(), sessions[i].demos, sessions[i].errors);
+            PrintTicks(sessions[i].ticks);
+            printf("\n");
+        }
+    }
+
+    printf("total                            %6u demos ", (unsigned)results.size());
+    PrintTicks(validator.GetTotalTicks());
+    printf("\n%u errors\n", validator.GetErrorCount());
+    PrintThroughput(validator);
+    return validator.GetErrorCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+//---------------------------------------------------------------------------------
+// Purpose: writes the VDM chain that plays a session back demo after demo, what speedrun_playlist does in game
+//
+//  vdm_playlist [-r rate] [-w frames] [-e commands] [-p playDir] <sessionDir>...
+//      -r  playback rate set at the start of every demo, 10 by default, 0 leaves it alone
+//      -w  frames to wait at the end of a demo before the next one, 200 by default
+//      -e  commands run after the last demo, "exit" by default
+//      -p  the session dir as playdemo sees it, relative to the game dir. The session dir as given by default,
+//          which is right when running from the game dir.
+//
+// Demo order and end ticks come from the session journal, and the .dmi indexes for the demos it has no end tick
+// for. No demo is read.
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "file_list.h"
+#include "vdm_playlist.h"
+
+static std::string WithTrailingSlash(const std::string& dir)
+{
+    if (dir.empty() || dir[dir.size() - 1] == '/' || dir[dir.size() - 1] == '\\')
+        return dir;
+    return dir + '/';
+}
+
+int main(int argc, char** argv)
+{
+    PlaylistOptions_t options;
+    std::string playDir;
+    std::vector<std::string> sessions;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            options.playbackRate = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            options.waitFrames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+        {
+            options.finalCommands = argv[++i];
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            playDir = argv[++i];
+        }
+        else
+        {
+            sessions.push_back(argv[i]);
+        }
+    }
+
+    if (sessions.empty() || (!playDir.empty() && sessions.size() > 1))
+    {
+        fprintf(stderr, "usage: %s [-r rate] [-w frames] [-e commands] [-p playDir] <sessionDir>...\n", argv[0]);
+        fprintf(stderr, "       -p only with a single session\n");
+        return 2;
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < sessions.size(); i++)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        const std::string sessionDir = WithTrailingSlash(sessions[i]);
+
+        std::string journal;
+        std::vector<journalrecord_t> records;
+        if (!ReadWholeFile(sessionDir + JOURNAL_FILE_NAME, journal))
+        {
+            fprintf(stderr, "%s: no " JOURNAL_FILE_NAME "\n", sessions[i].c_str());
+            failed++;
+            continue;
+        }
+        ReadJournal(journal.data(), journal.size(), records);
+
+        int writeErrors = 0;
+        const PlaylistResult_t result = WritePlaylist(
+            records,
+            sessionDir,
+            playDir.empty() ? sessionDir : WithTrailingSlash(playDir),
+            options,
+            [](const std::string& path, std::string& contents) { return ReadWholeFile(path, contents); },
+            [&writeErrors](const std::string& path, const std::string& contents) {
+                FILE* file = fopen(path.c_str(), "wb");
+                bool ok = file && fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+                ok = file && fclose(file) == 0 && ok;
+                if (!ok)
+                {
+                    fprintf(stderr, "%s: unable to write\n", path.c_str());
+                    writeErrors++;
+                }
+            });
+
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("%s: %u .vdm written, %u end ticks from .dmi, %u demos left out, %.2f ms\n",
+               sessions[i].c_str(),
+               result.written,
+               result.fromIndex,
+               result.skipped,
+               ms);
+        failed += writeErrors > 0 || result.written == 0 ? 1 : 0;
+    }
+    return failed == 0 ? 0 : 1;
+}
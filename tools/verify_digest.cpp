@@ -0,0 +1,111 @@
+//---------------------------------------------------------------------------------
+// Purpose: checks sessions against the digest the plugin wrote when they stopped
+//
+//  verify_digest [-j threads] [-k key] <dir>...
+//      every directory at or below the given ones that holds a speedrun_democrecord.digest is a session. Its demos
+//      are checksummed on all cores and every block that changed is printed with its demo, byte and tick range.
+//      -j  worker threads, every core by default
+//      -k  the speedrun_digest_key the run was recorded with, needed for a keyed digest
+//
+// Exits with 1 if a session has no readable digest or doesn't match it.
+//---------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "session_digest.h"
+
+static void PrintMismatch(const DigestMismatch_t& mismatch)
+{
+    printf("  %s: %s", mismatch.demo.c_str(), DigestMismatchKindToString(mismatch.kind));
+    if (mismatch.size != 0)
+    {
+        printf(", bytes %llu-%llu",
+               (unsigned long long)mismatch.offset,
+               (unsigned long long)(mismatch.offset + mismatch.size - 1));
+    }
+    if (mismatch.lastTick >= 0)
+    {
+        printf(", ticks %d-%d", mismatch.firstTick >= 0 ? mismatch.firstTick : 0, mismatch.lastTick);
+    }
+    else if (mismatch.kind == DIGEST_MODIFIED)
+    {
+        printf(", header");
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    unsigned threads = 0;
+    std::string key;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            threads = (unsigned)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+        {
+            key = argv[++i];
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.empty())
+    {
+        fprintf(stderr, "usage: %s [-j threads] [-k key] <dir>...\n", argv[0]);
+        return 2;
+    }
+
+    CDigestVerifier verifier(threads);
+    verifier.Run(paths, key);
+
+    // Both lists are sorted by directory
+    const std::vector<SessionVerification_t>& sessions = verifier.GetSessions();
+    const std::vector<DigestMismatch_t>& mismatches = verifier.GetMismatches();
+    size_t next = 0;
+    for (size_t i = 0; i < sessions.size(); i++)
+    {
+        const SessionVerification_t& session = sessions[i];
+        while (next < mismatches.size() && mismatches[next].sessionDir < session.sessionDir)
+        {
+            next++;
+        }
+        const size_t first = next;
+        while (next < mismatches.size() && mismatches[next].sessionDir == session.sessionDir)
+        {
+            next++;
+        }
+
+        const char* status = session.result != DIGEST_OK ? DigestReadResultToString(session.result)
+                                                         : (first != next ? "MODIFIED" : "ok");
+        printf("%s: %s, %u demos, %.1f MB\n",
+               session.sessionDir.c_str(),
+               status,
+               session.demos,
+               (double)session.bytes / 1e6);
+        for (size_t j = first; j < next; j++)
+        {
+            PrintMismatch(mismatches[j]);
+        }
+    }
+
+    const double seconds = verifier.GetSeconds() > 0.0 ? verifier.GetSeconds() : 1e-9;
+    printf("%u sessions, %u failed, %.1f MB in %.3f s on %u threads: %.1f MB/s\n",
+           (unsigned)sessions.size(),
+           verifier.GetFailedCount(),
+           (double)verifier.GetTotalBytes() / 1e6,
+           verifier.GetSeconds(),
+           verifier.GetThreadCount(),
+           (double)verifier.GetTotalBytes() / 1e6 / seconds);
+    return verifier.GetFailedCount() == 0 ? 0 : 1;
+}